@@ -80,6 +80,18 @@ struct cache {
   /* Particle sound speed. */
   float *restrict soundspeed SWIFT_CACHE_ALIGN;
 
+  /* Particle internal energy. */
+  float *restrict u SWIFT_CACHE_ALIGN;
+
+  /* Particle pressure. */
+  float *restrict pressure SWIFT_CACHE_ALIGN;
+
+  /* Artificial viscosity parameter. */
+  float *restrict alpha_visc SWIFT_CACHE_ALIGN;
+
+  /* Thermal diffusion parameter. */
+  float *restrict alpha_diff SWIFT_CACHE_ALIGN;
+
   /* Cache size. */
   int count;
 };
@@ -146,6 +158,10 @@ __attribute__((always_inline)) INLINE void cache_init(struct cache *c,
     free(c->pOrho2);
     free(c->balsara);
     free(c->soundspeed);
+    free(c->u);
+    free(c->pressure);
+    free(c->alpha_visc);
+    free(c->alpha_diff);
   }
 
   error += posix_memalign((void **)&c->x, SWIFT_CACHE_ALIGNMENT, sizeBytes);
@@ -167,6 +183,13 @@ __attribute__((always_inline)) INLINE void cache_init(struct cache *c,
       posix_memalign((void **)&c->balsara, SWIFT_CACHE_ALIGNMENT, sizeBytes);
   error +=
       posix_memalign((void **)&c->soundspeed, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error += posix_memalign((void **)&c->u, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error +=
+      posix_memalign((void **)&c->pressure, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error +=
+      posix_memalign((void **)&c->alpha_visc, SWIFT_CACHE_ALIGNMENT, sizeBytes);
+  error +=
+      posix_memalign((void **)&c->alpha_diff, SWIFT_CACHE_ALIGNMENT, sizeBytes);
 
   if (error != 0)
     error("Couldn't allocate cache, no. of particles: %d", (int)count);
@@ -184,7 +207,7 @@ __attribute__((always_inline)) INLINE int cache_read_particles(
     const struct cell *restrict const ci,
     struct cache *restrict const ci_cache) {
 
-#if defined(GADGET2_SPH)
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -265,7 +288,7 @@ __attribute__((always_inline)) INLINE int cache_read_particles_subset_self(
     const struct cell *restrict const ci,
     struct cache *restrict const ci_cache) {
 
-#if defined(GADGET2_SPH)
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -348,7 +371,7 @@ __attribute__((always_inline)) INLINE void cache_read_particles_subset_pair(
     const struct sort_entry *restrict sort_i, int *first_pi, int *last_pi,
     const double *loc, const int flipped) {
 
-#if defined(GADGET2_SPH)
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -495,7 +518,7 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
     const struct cell *restrict const ci,
     struct cache *restrict const ci_cache) {
 
-#if defined(GADGET2_SPH)
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -516,6 +539,13 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
                             SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, soundspeed, ci_cache->soundspeed,
                             SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, u, ci_cache->u, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, pressure, ci_cache->pressure,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_visc, ci_cache->alpha_visc,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_diff, ci_cache->alpha_diff,
+                            SWIFT_CACHE_ALIGNMENT);
 
   const int count = ci->hydro.count;
   const struct part *restrict parts = ci->hydro.parts;
@@ -541,6 +571,10 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
       pOrho2[i] = 1.f;
       balsara[i] = 1.f;
       soundspeed[i] = 1.f;
+      u[i] = 1.f;
+      pressure[i] = 1.f;
+      alpha_visc[i] = 1.f;
+      alpha_diff[i] = 1.f;
 
       continue;
     }
@@ -555,9 +589,16 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
     vz[i] = parts[i].v[2];
     rho[i] = parts[i].rho;
     grad_h[i] = parts[i].force.f;
-    pOrho2[i] = parts[i].force.P_over_rho2;
     balsara[i] = parts[i].force.balsara;
     soundspeed[i] = parts[i].force.soundspeed;
+#if defined(GADGET2_SPH)
+    pOrho2[i] = parts[i].force.P_over_rho2;
+#elif defined(SPHENIX_SPH)
+    u[i] = parts[i].u;
+    pressure[i] = parts[i].force.pressure;
+    alpha_visc[i] = parts[i].viscosity.alpha;
+    alpha_diff[i] = parts[i].diffusion.alpha;
+#endif
   }
 
   /* Pad cache if there is a serial remainder. */
@@ -578,6 +619,10 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
       pOrho2[i] = 1.f;
       balsara[i] = 1.f;
       soundspeed[i] = 1.f;
+      u[i] = 1.f;
+      pressure[i] = 1.f;
+      alpha_visc[i] = 1.f;
+      alpha_diff[i] = 1.f;
     }
   }
 
@@ -689,7 +734,7 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
     vx[i] = parts_i[idx].v[0];
     vy[i] = parts_i[idx].v[1];
     vz[i] = parts_i[idx].v[2];
-#ifdef GADGET2_SPH
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
     m[i] = parts_i[idx].mass;
 #endif
   }
@@ -791,7 +836,7 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
     vxj[i] = parts_j[idx].v[0];
     vyj[i] = parts_j[idx].v[1];
     vzj[i] = parts_j[idx].v[2];
-#ifdef GADGET2_SPH
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
     mj[i] = parts_j[idx].mass;
 #endif
   }
@@ -915,6 +960,13 @@ cache_read_two_partial_cells_sorted_force(
                             SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, soundspeed, ci_cache->soundspeed,
                             SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, u, ci_cache->u, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, pressure, ci_cache->pressure,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_visc, ci_cache->alpha_visc,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_diff, ci_cache->alpha_diff,
+                            SWIFT_CACHE_ALIGNMENT);
 
   int ci_cache_count = ci->hydro.count - first_pi_align;
   const double max_dx = max(ci->hydro.dx_max_part, cj->hydro.dx_max_part);
@@ -944,6 +996,10 @@ cache_read_two_partial_cells_sorted_force(
       pOrho2[i] = 1.f;
       balsara[i] = 1.f;
       soundspeed[i] = 1.f;
+      u[i] = 1.f;
+      pressure[i] = 1.f;
+      alpha_visc[i] = 1.f;
+      alpha_diff[i] = 1.f;
 
       continue;
     }
@@ -955,13 +1011,20 @@ cache_read_two_partial_cells_sorted_force(
     vx[i] = parts_i[idx].v[0];
     vy[i] = parts_i[idx].v[1];
     vz[i] = parts_i[idx].v[2];
-#ifdef GADGET2_SPH
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
     m[i] = parts_i[idx].mass;
     rho[i] = parts_i[idx].rho;
     grad_h[i] = parts_i[idx].force.f;
-    pOrho2[i] = parts_i[idx].force.P_over_rho2;
     balsara[i] = parts_i[idx].force.balsara;
     soundspeed[i] = parts_i[idx].force.soundspeed;
+#endif
+#if defined(GADGET2_SPH)
+    pOrho2[i] = parts_i[idx].force.P_over_rho2;
+#elif defined(SPHENIX_SPH)
+    u[i] = parts_i[idx].u;
+    pressure[i] = parts_i[idx].force.pressure;
+    alpha_visc[i] = parts_i[idx].viscosity.alpha;
+    alpha_diff[i] = parts_i[idx].diffusion.alpha;
 #endif
   }
 
@@ -983,6 +1046,10 @@ cache_read_two_partial_cells_sorted_force(
     pOrho2[i] = 1.f;
     balsara[i] = 1.f;
     soundspeed[i] = 1.f;
+    u[i] = 1.f;
+    pressure[i] = 1.f;
+    alpha_visc[i] = 1.f;
+    alpha_diff[i] = 1.f;
   }
 
   /* Let the compiler know that the data is aligned and create pointers to the
@@ -1004,6 +1071,13 @@ cache_read_two_partial_cells_sorted_force(
                             SWIFT_CACHE_ALIGNMENT);
   swift_declare_aligned_ptr(float, soundspeedj, cj_cache->soundspeed,
                             SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, uj, cj_cache->u, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, pressurej, cj_cache->pressure,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_viscj, cj_cache->alpha_visc,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(float, alpha_diffj, cj_cache->alpha_diff,
+                            SWIFT_CACHE_ALIGNMENT);
 
   const float pos_padded_j[3] = {-(2. * cj->width[0] + max_dx),
                                  -(2. * cj->width[1] + max_dx),
@@ -1028,6 +1102,10 @@ cache_read_two_partial_cells_sorted_force(
       pOrho2j[i] = 1.f;
       balsaraj[i] = 1.f;
       soundspeedj[i] = 1.f;
+      uj[i] = 1.f;
+      pressurej[i] = 1.f;
+      alpha_viscj[i] = 1.f;
+      alpha_diffj[i] = 1.f;
 
       continue;
     }
@@ -1039,13 +1117,20 @@ cache_read_two_partial_cells_sorted_force(
     vxj[i] = parts_j[idx].v[0];
     vyj[i] = parts_j[idx].v[1];
     vzj[i] = parts_j[idx].v[2];
-#ifdef GADGET2_SPH
+#if defined(GADGET2_SPH) || defined(SPHENIX_SPH)
     mj[i] = parts_j[idx].mass;
     rhoj[i] = parts_j[idx].rho;
     grad_hj[i] = parts_j[idx].force.f;
-    pOrho2j[i] = parts_j[idx].force.P_over_rho2;
     balsaraj[i] = parts_j[idx].force.balsara;
     soundspeedj[i] = parts_j[idx].force.soundspeed;
+#endif
+#if defined(GADGET2_SPH)
+    pOrho2j[i] = parts_j[idx].force.P_over_rho2;
+#elif defined(SPHENIX_SPH)
+    uj[i] = parts_j[idx].u;
+    pressurej[i] = parts_j[idx].force.pressure;
+    alpha_viscj[i] = parts_j[idx].viscosity.alpha;
+    alpha_diffj[i] = parts_j[idx].diffusion.alpha;
 #endif
   }
 
@@ -1066,6 +1151,10 @@ cache_read_two_partial_cells_sorted_force(
     pOrho2j[i] = 1.f;
     balsaraj[i] = 1.f;
     soundspeedj[i] = 1.f;
+    uj[i] = 1.f;
+    pressurej[i] = 1.f;
+    alpha_viscj[i] = 1.f;
+    alpha_diffj[i] = 1.f;
   }
 }
 
@@ -1090,6 +1179,10 @@ static INLINE void cache_clean(struct cache *c) {
     free(c->pOrho2);
     free(c->balsara);
     free(c->soundspeed);
+    free(c->u);
+    free(c->pressure);
+    free(c->alpha_visc);
+    free(c->alpha_diff);
   }
   c->count = 0;
 }
@@ -491,6 +491,9 @@ struct cell {
   /*! The maximal depth of this cell and its progenies */
   char maxdepth;
 
+  /*! Bit-mask of the particle types present in this cell at the last split */
+  char particle_types;
+
 #if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
   /* Cell ID (for debugging) */
   long long cellID;
@@ -557,6 +560,11 @@ int cell_pack_multipoles(struct cell *c, struct gravity_tensors *m);
 int cell_unpack_multipoles(struct cell *c, struct gravity_tensors *m);
 int cell_pack_sf_counts(struct cell *c, struct pcell_sf *pcell);
 int cell_unpack_sf_counts(struct cell *c, struct pcell_sf *pcell);
+size_t cell_pack_parts_size(const enum task_subtypes subtype);
+void cell_pack_parts(const struct cell *c, const enum task_subtypes subtype,
+                     char *buff);
+void cell_unpack_parts(struct cell *c, const enum task_subtypes subtype,
+                       const char *buff);
 int cell_get_tree_size(struct cell *c);
 int cell_link_parts(struct cell *c, struct part *parts);
 int cell_link_gparts(struct cell *c, struct gpart *gparts);
@@ -169,6 +169,10 @@ struct cell_hydro {
   /*! Is the #part data of this cell being used in a sub-cell? */
   int hold;
 
+  /*! Queue of the runner that last ran a task on this cell's #part (only
+   * tracked for super-cells). */
+  short int last_runner;
+
   /*! Nr of #part in this cell. */
   int count;
 };
@@ -22,6 +22,9 @@
 /* Config parameters. */
 #include <config.h>
 
+/* Some standard headers. */
+#include <string.h>
+
 /* This object's header. */
 #include "cell.h"
 
@@ -729,3 +732,164 @@ int cell_unpack_sf_counts(struct cell *restrict c,
   return 0;
 #endif
 }
+
+#if defined(hydro_part_pack_modules)
+
+/* Size of one field of the #part. */
+#define cell_pack_part_field_size(name) +sizeof(((struct part *)NULL)->name)
+
+/* Copy one field of the #part to the buffer. */
+#define cell_pack_part_field(name)         \
+  memcpy(buff, &p->name, sizeof(p->name)); \
+  buff += sizeof(p->name);
+
+/* Copy one field of the #part from the buffer. */
+#define cell_unpack_part_field(name)       \
+  memcpy(&p->name, buff, sizeof(p->name)); \
+  buff += sizeof(p->name);
+
+#endif
+
+/**
+ * @brief Size of the packed data of one #part exchanged by the hydro
+ * communications of the given sub-type.
+ *
+ * @param subtype The sub-type of the send/recv task.
+ *
+ * @return The number of bytes per particle or 0 if the particles of this
+ * sub-type are exchanged whole.
+ */
+size_t cell_pack_parts_size(const enum task_subtypes subtype) {
+
+#if defined(hydro_part_pack_modules)
+  switch (subtype) {
+    case task_subtype_xv:
+      return 0 hydro_part_pack_xv(cell_pack_part_field_size)
+          hydro_part_pack_modules(cell_pack_part_field_size);
+    case task_subtype_rho:
+      return 0 hydro_part_pack_rho(cell_pack_part_field_size)
+          hydro_part_pack_modules(cell_pack_part_field_size);
+#ifdef hydro_part_pack_gradient
+    case task_subtype_gradient:
+      return 0 hydro_part_pack_gradient(cell_pack_part_field_size)
+          hydro_part_pack_modules(cell_pack_part_field_size);
+#endif
+    case task_subtype_part_prep1:
+      return 0 hydro_part_pack_modules(cell_pack_part_field_size);
+    default:
+      return 0;
+  }
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Pack the fields of the #part of the given cell exchanged by the
+ * hydro communications of the given sub-type.
+ *
+ * The buffer must hold c->hydro.count * cell_pack_parts_size(subtype) bytes.
+ *
+ * @param c The #cell.
+ * @param subtype The sub-type of the send task.
+ * @param buff (output) The buffer we pack into.
+ */
+void cell_pack_parts(const struct cell *c, const enum task_subtypes subtype,
+                     char *buff) {
+
+#if defined(hydro_part_pack_modules)
+  const int count = c->hydro.count;
+  const struct part *parts = c->hydro.parts;
+
+  switch (subtype) {
+    case task_subtype_xv:
+      for (int i = 0; i < count; ++i) {
+        const struct part *p = &parts[i];
+        hydro_part_pack_xv(cell_pack_part_field);
+        hydro_part_pack_modules(cell_pack_part_field);
+      }
+      break;
+    case task_subtype_rho:
+      for (int i = 0; i < count; ++i) {
+        const struct part *p = &parts[i];
+        hydro_part_pack_rho(cell_pack_part_field);
+        hydro_part_pack_modules(cell_pack_part_field);
+      }
+      break;
+#ifdef hydro_part_pack_gradient
+    case task_subtype_gradient:
+      for (int i = 0; i < count; ++i) {
+        const struct part *p = &parts[i];
+        hydro_part_pack_gradient(cell_pack_part_field);
+        hydro_part_pack_modules(cell_pack_part_field);
+      }
+      break;
+#endif
+    case task_subtype_part_prep1:
+      for (int i = 0; i < count; ++i) {
+        const struct part *p = &parts[i];
+        hydro_part_pack_modules(cell_pack_part_field);
+      }
+      break;
+    default:
+      error("Particles of sub-type '%s' are not packed.",
+            subtaskID_names[subtype]);
+  }
+#else
+  error("The particles of this hydro scheme are not packed.");
+#endif
+}
+
+/**
+ * @brief Unpack the fields of the #part of the given cell exchanged by the
+ * hydro communications of the given sub-type.
+ *
+ * @param c The #cell.
+ * @param subtype The sub-type of the recv task.
+ * @param buff The buffer we unpack from.
+ */
+void cell_unpack_parts(struct cell *c, const enum task_subtypes subtype,
+                       const char *buff) {
+
+#if defined(hydro_part_pack_modules)
+  const int count = c->hydro.count;
+  struct part *parts = c->hydro.parts;
+
+  switch (subtype) {
+    case task_subtype_xv:
+      for (int i = 0; i < count; ++i) {
+        struct part *p = &parts[i];
+        hydro_part_pack_xv(cell_unpack_part_field);
+        hydro_part_pack_modules(cell_unpack_part_field);
+      }
+      break;
+    case task_subtype_rho:
+      for (int i = 0; i < count; ++i) {
+        struct part *p = &parts[i];
+        hydro_part_pack_rho(cell_unpack_part_field);
+        hydro_part_pack_modules(cell_unpack_part_field);
+      }
+      break;
+#ifdef hydro_part_pack_gradient
+    case task_subtype_gradient:
+      for (int i = 0; i < count; ++i) {
+        struct part *p = &parts[i];
+        hydro_part_pack_gradient(cell_unpack_part_field);
+        hydro_part_pack_modules(cell_unpack_part_field);
+      }
+      break;
+#endif
+    case task_subtype_part_prep1:
+      for (int i = 0; i < count; ++i) {
+        struct part *p = &parts[i];
+        hydro_part_pack_modules(cell_unpack_part_field);
+      }
+      break;
+    default:
+      error("Particles of sub-type '%s' are not packed.",
+            subtaskID_names[subtype]);
+  }
+#else
+  error("The particles of this hydro scheme are not packed.");
+#endif
+}
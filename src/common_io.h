@@ -246,6 +246,10 @@ void io_duplicate_black_holes_gparts(struct threadpool* tp,
                                      struct gpart* const gparts, size_t Nstars,
                                      size_t Ndm);
 
+int io_get_ptype_fields(const int ptype, struct io_props* list,
+                        const int with_cosmology, const int with_fof,
+                        const int with_stf);
+
 void io_prepare_output_fields(struct output_options* output_options,
                               const int with_cosmology, const int with_fof,
                               const int with_stf, int verbose);
@@ -54,6 +54,7 @@
 #include "part.h"
 #include "part_type.h"
 #include "sink_io.h"
+#include "snapshot_async.h"
 #include "star_formation_io.h"
 #include "stars_io.h"
 #include "tools.h"
@@ -208,10 +209,15 @@ void write_distributed_array(
   tic = getticks();
 #endif
 
-  /* Write temporary buffer to HDF5 dataspace */
-  h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
-                   H5P_DEFAULT, temp);
-  if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  /* Write temporary buffer to HDF5 dataspace, or leave it to the thread
+   * writing the file in the background */
+  const int deferred =
+      snapshot_async_defer_write(h_data, io_hdf5_type(props.type), temp);
+  if (!deferred) {
+    h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
+                     H5P_DEFAULT, temp);
+    if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  }
 
 #ifdef IO_SPEED_MEASUREMENT
   ticks toc = getticks();
@@ -264,7 +270,7 @@ void write_distributed_array(
   io_write_attribute_s(h_data, "Description", props.description);
 
   /* Free and close everything */
-  swift_free("writebuff", temp);
+  if (!deferred) swift_free("writebuff", temp);
   H5Tclose(h_type);
   H5Pclose(h_prop);
   H5Dclose(h_data);
@@ -1017,7 +1023,9 @@ void write_output_distributed(struct engine* e,
 
   /* Open file */
   /* message("Opening file '%s'.", fileName); */
-  h_file = H5Fcreate(fileName, H5F_ACC_TRUNC, H5P_DEFAULT, h_props);
+  const size_t size_estimate = snapshot_async_estimate_size(
+      e, current_selection_name, N, to_write);
+  h_file = snapshot_async_create_file(e, fileName, h_props, size_estimate);
   if (h_file < 0) error("Error while opening file '%s'.", fileName);
 
   /* Open header to write simulation properties */
@@ -1501,8 +1509,8 @@ void write_output_distributed(struct engine* e,
 
   /* message("Done writing particles..."); */
 
-  /* Close file */
-  H5Fclose(h_file);
+  /* Close file (and write it out if it was built in memory) */
+  snapshot_async_close_file(e, h_file, fileName);
   H5Pclose(h_props);
 
 #if H5_VERSION_GE(1, 10, 0)
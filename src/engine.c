@@ -96,6 +96,7 @@
 #include "rt_properties.h"
 #include "runner.h"
 #include "sink_properties.h"
+#include "snapshot_async.h"
 #include "sort_part.h"
 #include "star_formation.h"
 #include "star_formation_logger.h"
@@ -228,7 +229,10 @@ void engine_repartition(struct engine *e) {
   if (e->s->cells_top != NULL) space_free_cells(e->s);
 
   /* Report the time spent in the different task categories */
-  if (e->verbose) scheduler_report_task_times(&e->sched, e->nr_threads);
+  if (e->verbose) {
+    scheduler_report_task_times(&e->sched, e->nr_threads);
+    scheduler_report_queue_stats(&e->sched);
+  }
 
   /* Task arrays. */
   scheduler_free_tasks(&e->sched);
@@ -1246,6 +1250,33 @@ int engine_estimate_nr_tasks(const struct engine *e) {
   return (int)(ncells * tasks_per_cell);
 }
 
+/**
+ * @brief Can the cell tree and the tasks be kept through the next rebuild?
+ *
+ * This is only attempted on a single node without self-gravity, where the
+ * tasks only depend on the cell tree and the particles' positions.
+ *
+ * @param e The #engine.
+ * @param repartitioned Did we just redistribute?
+ * @param clean_smoothing_length_values Are we cleaning up the values of
+ * the smoothing lengths before building the tasks ?
+ */
+static int engine_can_keep_tasks(const struct engine *e,
+                                 const int repartitioned,
+                                 const int clean_smoothing_length_values) {
+
+  const struct scheduler *sched = &e->sched;
+
+  if (!(sched->flags & scheduler_flag_keep_tasks)) return 0;
+  if (repartitioned || clean_smoothing_length_values || e->restarting)
+    return 0;
+  if (e->nr_nodes > 1) return 0;
+  if (e->policy & (engine_policy_self_gravity | engine_policy_grid)) return 0;
+
+  /* Only keep the graph made by the last engine_maketasks() as it is. */
+  return sched->nr_tasks > 0 && sched->nr_tasks == sched->nr_tasks_graph;
+}
+
 /**
  * @brief Rebuild the space and tasks.
  *
@@ -1259,16 +1290,23 @@ void engine_rebuild(struct engine *e, const int repartitioned,
 
   const ticks tic = getticks();
 
+  /* Can the cell tree and its tasks be kept through the rebuild? */
+  e->s->keep_cell_tasks = engine_can_keep_tasks(e, repartitioned,
+                                                clean_smoothing_length_values);
+  e->s->tree_changed = 0;
+
   /* Clear the forcerebuild flag, whatever it was. */
   e->forcerebuild = 0;
   e->restarting = 0;
 
   /* Report the time spent in the different task categories */
-  if (e->verbose && !repartitioned)
+  if (e->verbose && !repartitioned) {
     scheduler_report_task_times(&e->sched, e->nr_threads);
+    scheduler_report_queue_stats(&e->sched);
+  }
 
   /* Give some breathing space */
-  scheduler_free_tasks(&e->sched);
+  if (!e->s->keep_cell_tasks) scheduler_free_tasks(&e->sched);
 
   /* Free the foreign particles to get more breathing space. */
 #ifdef WITH_MPI
@@ -1421,8 +1459,9 @@ void engine_rebuild(struct engine *e, const int repartitioned,
 #endif
   }
 
-  /* Re-build the tasks. */
-  engine_maketasks(e);
+  /* Re-build the tasks, or keep the ones we have. */
+  engine_rebuild_tasks(e);
+  e->s->keep_cell_tasks = 0;
 
   /* Reallocate freed memory */
 #ifdef WITH_MPI
@@ -1615,6 +1654,13 @@ int engine_prepare(struct engine *e) {
   if (e->tasks_age % engine_tasksreweight == 1) {
     scheduler_reweight(&e->sched, e->verbose);
   }
+
+  /* With learned task costs, refresh the priorities if the rebuild did
+   * not just do it. */
+  else if ((e->sched.flags & scheduler_flag_cost_model) &&
+           !(e->step_props & engine_step_prop_rebuild)) {
+    scheduler_reweight(&e->sched, e->verbose);
+  }
   e->tasks_age += 1;
 
   TIMER_TOC2(timer_prepare);
@@ -1847,6 +1893,10 @@ void engine_launch(struct engine *e, const char *call) {
   /* Store the wallclock time */
   e->sched.total_ticks += getticks() - tic;
 
+  /* Learn from the times of the tasks that just ran. */
+  if (e->sched.flags & scheduler_flag_cost_model)
+    scheduler_update_cost_models(&e->sched, tic, e->verbose);
+
   /* accumulate active counts for all runners */
   ticks active_time = 0;
   for (int i = 0; i < e->nr_threads; ++i) {
@@ -3225,6 +3275,54 @@ void engine_numa_policies(int rank, int verbose) {
 #endif
 }
 
+/**
+ * @brief Find where a CPU sits in the machine's topology.
+ *
+ * The L3 cache domain is read from sysfs and the NUMA node from libnuma, when
+ * available. Unknown values are returned as -1.
+ *
+ * @param cpuid The ID of the CPU.
+ * @param l3_domain (return) The ID of the L3 cache shared by this CPU.
+ * @param numa_node (return) The NUMA node of this CPU.
+ */
+void engine_cpu_topology(const int cpuid, int *l3_domain, int *numa_node) {
+
+  *l3_domain = -1;
+  *numa_node = -1;
+
+#if defined(HAVE_LIBNUMA) && defined(_GNU_SOURCE)
+  if (numa_available() >= 0) *numa_node = numa_node_of_cpu(cpuid);
+#endif
+
+  /* Look for the level 3 cache amongst the ones of this CPU. */
+  for (int index = 0; index < 8; index++) {
+    char fname[128];
+    int level = 0;
+    sprintf(fname, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpuid,
+            index);
+    FILE *file = fopen(fname, "r");
+    if (file == NULL) break;
+    const int nread = fscanf(file, "%d", &level);
+    fclose(file);
+    if (nread != 1 || level != 3) continue;
+
+    /* Use the cache ID, or the first CPU sharing it if there is none. */
+    sprintf(fname, "/sys/devices/system/cpu/cpu%d/cache/index%d/id", cpuid,
+            index);
+    if ((file = fopen(fname, "r")) == NULL) {
+      sprintf(fname,
+              "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+              cpuid, index);
+      file = fopen(fname, "r");
+    }
+    if (file != NULL) {
+      if (fscanf(file, "%d", l3_domain) != 1) *l3_domain = -1;
+      fclose(file);
+    }
+    break;
+  }
+}
+
 /**
  * @brief init an engine struct with the necessary properties for the
  *        simulation.
@@ -3367,6 +3465,20 @@ void engine_init(
       parser_get_opt_param_int(params, "Snapshots:distributed", 0);
   e->snapshot_lustre_OST_count =
       parser_get_opt_param_int(params, "Snapshots:lustre_OST_count", 0);
+  e->snapshot_async = parser_get_opt_param_int(params, "Snapshots:async", 0);
+  e->snapshot_async_buffer_size =
+      (size_t)(parser_get_opt_param_float(params, "Snapshots:async_buffer_MB",
+                                          0.f) *
+               1024. * 1024.);
+#if defined(WITH_MPI)
+  if (e->snapshot_async && !e->snapshot_distributed) {
+    if (engine_rank == 0)
+      warning(
+          "Asynchronous snapshots require Snapshots:distributed when running "
+          "over MPI. Writing the snapshots synchronously.");
+    e->snapshot_async = 0;
+  }
+#endif
   e->snapshot_invoke_stf =
       parser_get_opt_param_int(params, "Snapshots:invoke_stf", 0);
   e->snapshot_invoke_fof =
@@ -3799,6 +3911,10 @@ void engine_recompute_displacement_constraint(struct engine *e) {
  * @param restart Was this a run that was restarted from check-point files?
  */
 void engine_clean(struct engine *e, const int fof, const int restart) {
+  /* Let any restart or snapshot file written in the background complete. */
+  restart_write_wait();
+  snapshot_async_wait();
+
   /* Start by telling the runners to stop. */
   e->step_props = engine_step_prop_done;
   swift_barrier_wait(&e->run_barrier);
@@ -351,6 +351,8 @@ struct engine {
   int snapshot_run_on_dump;
   int snapshot_distributed;
   int snapshot_lustre_OST_count;
+  int snapshot_async;
+  size_t snapshot_async_buffer_size;
   int snapshot_compression;
   int snapshot_invoke_stf;
   int snapshot_invoke_fof;
@@ -467,6 +469,13 @@ struct engine {
   /* Use synchronous redistributes. */
   int syncredist;
 
+  /* Maximal size in bytes of the messages of the streaming redistributes,
+   * 0 to exchange whole particle arrays. */
+  size_t redist_buffer_size;
+
+  /* Compress the positions and IDs in transit when streaming redistributes. */
+  int redist_compress;
+
 #endif
 
   /* Wallclock time of the last time-step */
@@ -592,6 +601,23 @@ struct engine {
   /* Number of Lustre OSTs on the system to use as rank-based striping offset */
   int restart_lustre_OST_count;
 
+  /* Whether to write a block index and checksums in the restart files. */
+  int restart_checksums;
+
+  /* Whether to write the restart files from a background thread. */
+  int restart_async;
+
+  /* Maximal size of the staging buffer of the background writes in bytes
+   * (0 for no limit). */
+  size_t restart_async_buffer_size;
+
+  /* zlib compression level of the restart files (0 for no compression). */
+  int restart_compression;
+
+  /* Number of dumps between two full restart dumps, the others only writing
+   * what changed (0 to always write full dumps). */
+  int restart_delta_full_every;
+
   /* Do we free the foreign data before writing restart files? */
   int free_foreign_when_dumping_restart;
 
@@ -770,6 +796,7 @@ void engine_activate_fof_attach_tasks(struct engine *e);
 
 /* Function prototypes, engine_maketasks.c. */
 void engine_maketasks(struct engine *e);
+void engine_rebuild_tasks(struct engine *e);
 
 /* Function prototypes, engine_maketasks.c. */
 void engine_make_fof_tasks(struct engine *e);
@@ -784,6 +811,7 @@ void engine_split_gas_particles(struct engine *e);
 cpu_set_t *engine_entry_affinity(void);
 #endif
 void engine_numa_policies(int rank, int verbose);
+void engine_cpu_topology(const int cpuid, int *l3_domain, int *numa_node);
 
 /* Struct dump/restore support. */
 void engine_struct_dump(struct engine *e, FILE *stream);
@@ -24,6 +24,7 @@
 
 /* System includes. */
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -418,6 +419,14 @@ void engine_config(int restart, int fof, struct engine *e,
     e->syncredist =
         parser_get_opt_param_int(params, "DomainDecomposition:synchronous", 0);
 
+    /* Exchange the particles in bounded chunks when redistributing? */
+    e->redist_buffer_size = (size_t)(
+        parser_get_opt_param_float(
+            params, "DomainDecomposition:streaming_buffer_MB", 0.f) *
+        1024. * 1024.);
+    e->redist_compress =
+        parser_get_opt_param_int(params, "DomainDecomposition:compress", 0);
+
     /* Collect the hostname of each rank into a file */
 
     const int hostname_buffer_length = 256;
@@ -835,6 +844,31 @@ void engine_config(int restart, int fof, struct engine *e,
     e->restart_lustre_OST_count =
         parser_get_opt_param_int(params, "Restarts:lustre_OST_count", 0);
 
+    /* Whether to write an index and checksums to verify the restart files
+     * and read them in parallel. Can be changed on restart. */
+    e->restart_checksums =
+        parser_get_opt_param_int(params, "Restarts:checksums", 0);
+
+    /* Whether to write the restarts in the background and with how much
+     * staging memory. Can be changed on restart. */
+    e->restart_async = parser_get_opt_param_int(params, "Restarts:async", 0);
+    e->restart_async_buffer_size =
+        (size_t)(parser_get_opt_param_float(params, "Restarts:async_buffer_MB",
+                                            0.f) *
+                 1024. * 1024.);
+
+    /* Compression and delta dumps. Can be changed on restart. */
+    e->restart_compression =
+        parser_get_opt_param_int(params, "Restarts:compression_level", 0);
+    if (e->restart_compression < 0 || e->restart_compression > 9)
+      error("Restarts:compression_level must be between 0 and 9.");
+#ifndef HAVE_ZLIB
+    if (e->restart_compression > 0)
+      error("Compressing restart files requires SWIFT to be built with zlib.");
+#endif
+    e->restart_delta_full_every =
+        parser_get_opt_param_int(params, "Restarts:delta_full_every", 0);
+
     /* Hours between restart dumps. Can be changed on restart. */
     float dhours =
         parser_get_opt_param_float(params, "Restarts:delta_hours", 5.0f);
@@ -909,9 +943,37 @@ void engine_config(int restart, int fof, struct engine *e,
   e->links_per_tasks =
       parser_get_opt_param_float(params, "Scheduler:links_per_tasks", 25.);
 
+  /* Which engine should the task queues use? */
+  unsigned int sched_flags = (e->policy & scheduler_flag_steal);
+  char queue_engine[PARSER_MAX_LINE_SIZE];
+  parser_get_opt_param_string(params, "Scheduler:queue_engine", queue_engine,
+                              queue_engine_names[queue_engine_heap]);
+  if (strcmp(queue_engine_names[queue_engine_deque], queue_engine) == 0) {
+    sched_flags |= scheduler_flag_deques;
+  } else if (strcmp(queue_engine_names[queue_engine_heap], queue_engine) != 0) {
+    error(
+        "Invalid choice of Scheduler:queue_engine '%s'. Permitted values are "
+        "'heap' or 'deque'.",
+        queue_engine);
+  }
+  if (e->nodeID == 0 && (sched_flags & scheduler_flag_deques))
+    message("Using work-stealing deques for the task queues");
+
+  /* Should the hydro loops follow the runner that last touched the cells? */
+  if (parser_get_opt_param_int(params, "Scheduler:cell_locality", 0))
+    sched_flags |= scheduler_flag_locality;
+
+  /* Should the task priorities be computed from the measured task times? */
+  if (parser_get_opt_param_int(params, "Scheduler:cost_model", 0))
+    sched_flags |= scheduler_flag_cost_model;
+
+  /* Should the task graph be kept over rebuilds that leave the tree intact? */
+  if (parser_get_opt_param_int(params, "Scheduler:keep_tasks", 0))
+    sched_flags |= scheduler_flag_keep_tasks;
+
   /* Init the scheduler. */
-  scheduler_init(&e->sched, e->s, maxtasks, nr_queues,
-                 (e->policy & scheduler_flag_steal), e->nodeID, &e->threadpool);
+  scheduler_init(&e->sched, e->s, maxtasks, nr_queues, sched_flags, e->nodeID,
+                 &e->threadpool);
 
   /* Maximum size of MPI task messages, in KB, that should not be buffered,
    * that is sent using MPI_Issend, not MPI_Isend. 4Mb by default. Can be
@@ -920,6 +982,21 @@ void engine_config(int restart, int fof, struct engine *e,
   e->sched.mpi_message_limit =
       parser_get_opt_param_int(params, "Scheduler:mpi_message_limit", 4) * 1024;
 
+  /* Only send the fields of the gas particles that changed since the last
+   * exchange in the hydro communications. Can be changed on restart. */
+  e->sched.mpi_pack_parts =
+      parser_get_opt_param_int(params, "Scheduler:mpi_pack_parts", 1);
+
+  /* Re-use the MPI requests of the gas particle communications from step to
+   * step until the next rebuild. Can be changed on restart. */
+  e->sched.mpi_persistent_requests =
+      parser_get_opt_param_int(params, "Scheduler:mpi_persistent_requests", 1);
+
+  /* Send all the gas particle communications of a sub-type between two ranks
+   * as a single message. Can be changed on restart. */
+  e->sched.mpi_aggregate =
+      parser_get_opt_param_int(params, "Scheduler:mpi_aggregate_messages", 1);
+
   if (restart) {
 
     /* Overwrite the constants for the scheduler */
@@ -1038,6 +1115,25 @@ void engine_config(int restart, int fof, struct engine *e,
     }
   }
 
+  /* Tell the scheduler where its queues live so that it can steal from close
+   * neighbours first. This only makes sense if the runners are pinned. */
+  if (with_aff &&
+      (e->policy & engine_policy_setaffinity) == engine_policy_setaffinity) {
+    int *l3_domain = (int *)malloc(nr_queues * sizeof(int));
+    int *numa_node = (int *)malloc(nr_queues * sizeof(int));
+    if (l3_domain == NULL || numa_node == NULL)
+      error("Failed to allocate queue topology.");
+    for (int k = 0; k < nr_queues; k++) l3_domain[k] = numa_node[k] = -1;
+    for (int k = e->nr_threads - 1; k >= 0; k--)
+      engine_cpu_topology(e->runners[k].cpuid,
+                          &l3_domain[e->runners[k].qid],
+                          &numa_node[e->runners[k].qid]);
+    scheduler_set_topology(&e->sched, l3_domain, numa_node,
+                           verbose && nodeID == 0);
+    free(l3_domain);
+    free(numa_node);
+  }
+
 #ifdef WITH_CSDS
   if ((e->policy & engine_policy_csds) && !restart) {
     /* Write the particle csds header */
@@ -42,6 +42,7 @@
 #include "power_spectrum.h"
 #include "serial_io.h"
 #include "single_io.h"
+#include "snapshot_async.h"
 #include "tracers.h"
 
 /* Standard includes */
@@ -208,6 +209,15 @@ int engine_dump_restarts(struct engine *e, const int drifted_all,
         message("Writing restart files");
       }
 
+      /* Finish writing the previous set of files, if done in the background,
+       * on all ranks before we touch any of them. */
+      if (e->restart_async) {
+        restart_write_wait();
+#ifdef WITH_MPI
+        MPI_Barrier(MPI_COMM_WORLD);
+#endif
+      }
+
       /* Clean out the previous saved files, if found. Do this now as we are
        * MPI synchronized. */
       restart_remove_previous(e->restart_file);
@@ -234,10 +244,19 @@ int engine_dump_restarts(struct engine *e, const int drifted_all,
 
       restart_write(e, e->restart_file);
 
+      /* Keep the FFT plans we measured for the next run. */
+      if ((e->policy & engine_policy_self_gravity && e->s->periodic) ||
+          (e->policy & engine_policy_power_spectra))
+        pm_mesh_export_fftw_wisdom(e->restart_dir, e->verbose);
+
+      /* Files written in the background must be complete before we stop. */
+      if (exit_run || force) restart_write_wait();
+
 #ifdef WITH_MPI
       /* Make sure all ranks finished writing to avoid having incomplete
        * sets of restart files should the code crash before all the ranks
-       * are done */
+       * are done (or at least staged their data when writing in the
+       * background) */
       MPI_Barrier(MPI_COMM_WORLD);
 
       /* Reallocate freed memory */
@@ -373,6 +392,14 @@ void engine_dump_snapshot(struct engine *e, const int fof) {
     message("writing particle properties took %.3f %s.",
             (float)clocks_diff(&time1, &time2), clocks_getunit());
 
+  /* The post-dump command may need the files written in the background */
+  if (e->snapshot_run_on_dump && e->snapshot_async) {
+    snapshot_async_wait();
+#ifdef WITH_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  }
+
   /* Run the post-dump command if required */
   if (e->nodeID == 0) {
     engine_run_on_dump(e);
@@ -4863,7 +4863,455 @@ void engine_maketasks(struct engine *e) {
   /* Set the tasks age. */
   e->tasks_age = 0;
 
+  /* Remember the graph we made, so that it can be kept over rebuilds. */
+  sched->nr_tasks_graph = sched->nr_tasks;
+
   if (e->verbose)
     message("took %.3f %s (including reweight).",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 }
+
+/* Data needed to check whether the kept tasks are still valid. */
+struct engine_check_kept_tasks_data {
+  const struct scheduler *sched;
+  int invalid;
+};
+
+/**
+ * @brief #threadpool_map function checking that the kept tasks are still the
+ * ones engine_maketasks() would make.
+ *
+ * The tasks must still be split down to the same cells by
+ * scheduler_splittasks() and the particles of the cells of the pair tasks
+ * must not have moved too much for the tasks to be valid. The latter uses the
+ * same criteria as cell_unskip_hydro_tasks() and friends.
+ *
+ * @param map_data The tasks.
+ * @param num_elements The number of tasks.
+ * @param extra_data The #engine_check_kept_tasks_data, whose invalid field is
+ * set to 1 if a task cannot be kept.
+ */
+void engine_check_kept_tasks_mapper(void *map_data, int num_elements,
+                                    void *extra_data) {
+
+  struct task *tasks = (struct task *)map_data;
+  struct engine_check_kept_tasks_data *data =
+      (struct engine_check_kept_tasks_data *)extra_data;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+    const struct task *t = &tasks[ind];
+
+    /* Would the task be split differently now? */
+    if (!scheduler_task_split_is_unchanged(data->sched, t)) {
+      data->invalid = 1;
+      return;
+    }
+
+    if (t->type != task_type_pair && t->type != task_type_sub_pair) continue;
+
+    const struct cell *ci = t->ci;
+    const struct cell *cj = t->cj;
+    int rebuild = 0;
+
+    switch (t->subtype) {
+      case task_subtype_density:
+        rebuild = cell_need_rebuild_for_hydro_pair(ci, cj);
+        break;
+      case task_subtype_stars_density:
+        rebuild = cell_need_rebuild_for_stars_pair(ci, cj) ||
+                  cell_need_rebuild_for_stars_pair(cj, ci);
+        break;
+      case task_subtype_bh_density:
+        rebuild = cell_need_rebuild_for_black_holes_pair(ci, cj) ||
+                  cell_need_rebuild_for_black_holes_pair(cj, ci);
+        break;
+      case task_subtype_sink_swallow:
+        rebuild = cell_need_rebuild_for_sinks_pair(ci, cj) ||
+                  cell_need_rebuild_for_sinks_pair(cj, ci);
+        break;
+      default:
+        break;
+    }
+
+    if (rebuild) {
+      data->invalid = 1;
+      return;
+    }
+  }
+}
+
+/**
+ * @brief #threadpool_map function preparing the kept tasks for a new step,
+ * as if they had just been made.
+ *
+ * @param map_data The tasks.
+ * @param num_elements The number of tasks.
+ * @param extra_data Unused.
+ */
+void engine_reset_kept_tasks_mapper(void *map_data, int num_elements,
+                                    void *extra_data) {
+
+  struct task *tasks = (struct task *)map_data;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+    struct task *t = &tasks[ind];
+    t->skip = 1;
+    if (t->type == task_type_sort || t->type == task_type_stars_sort ||
+        t->type == task_type_rt_sort)
+      t->flags = 0;
+#ifdef SWIFT_DEBUG_CHECKS
+    t->activated_by_unskip = 0;
+    t->activated_by_marktask = 0;
+#endif
+
+    /* The flags of the cells were cleared by the rebuild. */
+    if (t->ci != NULL) cell_set_flag(t->ci, cell_flag_has_tasks);
+    if (t->cj != NULL) cell_set_flag(t->cj, cell_flag_has_tasks);
+  }
+}
+
+#ifdef SWIFT_DEBUG_CHECKS
+/* Type, cells and flags of a task, to compare two task graphs. */
+struct engine_task_key {
+  int type, subtype;
+  long long flags;
+  const struct cell *ci, *cj;
+};
+
+/* A dependency between two tasks, to compare two task graphs. */
+struct engine_task_edge {
+  struct engine_task_key from, to;
+};
+
+/* The tasks and dependencies of a graph, sorted such that two graphs can be
+ * compared without relying on the order in which the tasks were made. */
+struct engine_task_graph {
+  struct engine_task_key *nodes;
+  struct engine_task_edge *edges;
+  int nr_nodes, nr_edges;
+};
+
+/**
+ * @brief Build the #engine_task_key of a task.
+ *
+ * The cells are compared directly, so tasks split down to different depths
+ * have different keys. The flags of the sorts are set when the tasks are
+ * activated and are ignored.
+ */
+static void engine_task_key_init(const struct task *t,
+                                 struct engine_task_key *k) {
+  k->type = t->type;
+  k->subtype = t->subtype;
+  k->flags = (t->type == task_type_sort || t->type == task_type_stars_sort ||
+              t->type == task_type_rt_sort)
+                 ? 0
+                 : t->flags;
+  k->ci = t->ci;
+  k->cj = t->cj;
+}
+
+/**
+ * @brief Compare two #engine_task_key for qsort().
+ */
+static int engine_task_key_cmp(const void *a, const void *b) {
+  const struct engine_task_key *ka = (const struct engine_task_key *)a;
+  const struct engine_task_key *kb = (const struct engine_task_key *)b;
+  if (ka->type != kb->type) return ka->type < kb->type ? -1 : 1;
+  if (ka->subtype != kb->subtype) return ka->subtype < kb->subtype ? -1 : 1;
+  if (ka->flags != kb->flags) return ka->flags < kb->flags ? -1 : 1;
+  if (ka->ci != kb->ci) return (uintptr_t)ka->ci < (uintptr_t)kb->ci ? -1 : 1;
+  if (ka->cj != kb->cj) return (uintptr_t)ka->cj < (uintptr_t)kb->cj ? -1 : 1;
+  return 0;
+}
+
+/**
+ * @brief Compare two #engine_task_edge for qsort().
+ */
+static int engine_task_edge_cmp(const void *a, const void *b) {
+  const struct engine_task_edge *ea = (const struct engine_task_edge *)a;
+  const struct engine_task_edge *eb = (const struct engine_task_edge *)b;
+  const int cmp = engine_task_key_cmp(&ea->from, &eb->from);
+  if (cmp != 0) return cmp;
+  return engine_task_key_cmp(&ea->to, &eb->to);
+}
+
+/**
+ * @brief Collect the tasks of a #scheduler and the dependencies between them
+ * into an #engine_task_graph.
+ *
+ * @param s The #scheduler.
+ * @param g (return) The graph, to be freed with engine_task_graph_clean().
+ */
+static void engine_task_graph_init(const struct scheduler *s,
+                                   struct engine_task_graph *g) {
+
+  int nr_edges = 0;
+  for (int k = 0; k < s->nr_tasks; k++) nr_edges += s->tasks[k].nr_unlock_tasks;
+
+  g->nr_nodes = s->nr_tasks;
+  g->nr_edges = nr_edges;
+  g->nodes = (struct engine_task_key *)malloc(sizeof(struct engine_task_key) *
+                                              (g->nr_nodes + 1));
+  g->edges = (struct engine_task_edge *)malloc(sizeof(struct engine_task_edge) *
+                                               (g->nr_edges + 1));
+  if (g->nodes == NULL || g->edges == NULL)
+    error("Failed to allocate the task graph.");
+
+  int e = 0;
+  for (int k = 0; k < s->nr_tasks; k++) {
+    const struct task *t = &s->tasks[k];
+    engine_task_key_init(t, &g->nodes[k]);
+    for (int j = 0; j < t->nr_unlock_tasks; j++) {
+      g->edges[e].from = g->nodes[k];
+      engine_task_key_init(t->unlock_tasks[j], &g->edges[e].to);
+      e++;
+    }
+  }
+
+  qsort(g->nodes, g->nr_nodes, sizeof(struct engine_task_key),
+        engine_task_key_cmp);
+  qsort(g->edges, g->nr_edges, sizeof(struct engine_task_edge),
+        engine_task_edge_cmp);
+}
+
+/**
+ * @brief Free the memory used by an #engine_task_graph.
+ */
+static void engine_task_graph_clean(struct engine_task_graph *g) {
+  free(g->nodes);
+  free(g->edges);
+}
+
+/**
+ * @brief Print an #engine_task_key.
+ */
+static void engine_task_key_print(const char *what,
+                                  const struct engine_task_key *k) {
+  message("%s: %s/%s flags=%lld ci=%p (depth %d) cj=%p (depth %d)", what,
+          taskID_names[k->type], subtaskID_names[k->subtype], k->flags,
+          (void *)k->ci, k->ci != NULL ? k->ci->depth : -1, (void *)k->cj,
+          k->cj != NULL ? k->cj->depth : -1);
+}
+
+/**
+ * @brief Check that two #engine_task_graph have the same tasks, split at the
+ * same depth, and the same dependencies.
+ *
+ * @param kept The graph kept over the rebuild.
+ * @param fresh The graph made from scratch.
+ */
+static void engine_task_graph_compare(const struct engine_task_graph *kept,
+                                      const struct engine_task_graph *fresh) {
+
+  const int nr_nodes = min(kept->nr_nodes, fresh->nr_nodes);
+  for (int k = 0; k < nr_nodes; k++) {
+    if (engine_task_key_cmp(&kept->nodes[k], &fresh->nodes[k]) != 0) {
+      engine_task_key_print("kept task", &kept->nodes[k]);
+      engine_task_key_print("new task", &fresh->nodes[k]);
+      error("Kept tasks differ from the new ones.");
+    }
+  }
+  if (kept->nr_nodes != fresh->nr_nodes)
+    error("Kept %d tasks but made %d new ones.", kept->nr_nodes,
+          fresh->nr_nodes);
+
+  const int nr_edges = min(kept->nr_edges, fresh->nr_edges);
+  for (int k = 0; k < nr_edges; k++) {
+    if (engine_task_edge_cmp(&kept->edges[k], &fresh->edges[k]) != 0) {
+      engine_task_key_print("kept dependency from", &kept->edges[k].from);
+      engine_task_key_print("kept dependency to", &kept->edges[k].to);
+      engine_task_key_print("new dependency from", &fresh->edges[k].from);
+      engine_task_key_print("new dependency to", &fresh->edges[k].to);
+      error("Kept task dependencies differ from the new ones.");
+    }
+  }
+  if (kept->nr_edges != fresh->nr_edges)
+    error("Kept %d dependencies but made %d new ones.", kept->nr_edges,
+          fresh->nr_edges);
+}
+
+/**
+ * @brief Count the cells of a tree.
+ */
+static size_t engine_count_cells_rec(const struct cell *c) {
+  size_t count = 1;
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) count += engine_count_cells_rec(c->progeny[k]);
+  return count;
+}
+
+/**
+ * @brief Copy the cells of a tree to or from a buffer, in depth-first order.
+ *
+ * @param c The #cell.
+ * @param buffer The buffer.
+ * @param to_buffer Are we copying the cells to the buffer?
+ *
+ * @return The position in the buffer after the last cell of the tree.
+ */
+static struct cell *engine_copy_cells_rec(struct cell *c, struct cell *buffer,
+                                          const int to_buffer) {
+  if (to_buffer)
+    memcpy(buffer, c, sizeof(struct cell));
+  else
+    memcpy(c, buffer, sizeof(struct cell));
+  buffer++;
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL)
+        buffer = engine_copy_cells_rec(c->progeny[k], buffer, to_buffer);
+  return buffer;
+}
+
+/**
+ * @brief Check the task graph kept over a rebuild against one made from
+ * scratch for the same cell tree.
+ *
+ * The kept graph, the cell-task links and the cells' pointers to their tasks
+ * are set aside while the new graph is made, and then put back, such that the
+ * kept graph is the one that runs.
+ *
+ * @param e The #engine.
+ */
+static void engine_check_kept_tasks(struct engine *e) {
+
+  struct space *s = e->s;
+  struct scheduler *sched = &e->sched;
+  const ticks tic = getticks();
+
+  struct engine_task_graph kept;
+  engine_task_graph_init(sched, &kept);
+
+  /* Set the kept graph aside. */
+  const struct scheduler kept_sched = *sched;
+  struct link *kept_links = e->links;
+  const size_t kept_nr_links = e->nr_links;
+  const size_t kept_size_links = e->size_links;
+
+  size_t nr_cells = 0;
+  for (int k = 0; k < s->nr_cells; k++)
+    nr_cells += engine_count_cells_rec(&s->cells_top[k]);
+  struct cell *kept_cells =
+      (struct cell *)malloc(sizeof(struct cell) * nr_cells);
+  if (kept_cells == NULL) error("Failed to allocate the kept cells.");
+  struct cell *buffer = kept_cells;
+  for (int k = 0; k < s->nr_cells; k++)
+    buffer = engine_copy_cells_rec(&s->cells_top[k], buffer, /*to_buffer=*/1);
+
+  /* Make a new graph in fresh arrays. */
+  sched->tasks = NULL;
+  sched->tasks_ind = NULL;
+  sched->tid_active = NULL;
+  sched->size = 0;
+  if ((sched->unlocks = (struct task **)swift_malloc(
+           "unlocks", sizeof(struct task *) * scheduler_init_nr_unlocks)) ==
+          NULL ||
+      (sched->unlock_ind = (int *)swift_malloc(
+           "unlock_ind", sizeof(int) * scheduler_init_nr_unlocks)) == NULL)
+    error("Failed to allocate unlocks.");
+  sched->nr_unlocks = 0;
+  sched->size_unlocks = scheduler_init_nr_unlocks;
+  e->links = NULL;
+  e->nr_links = 0;
+
+  space_clear_tasks(s);
+  engine_maketasks(e);
+
+  struct engine_task_graph fresh;
+  engine_task_graph_init(sched, &fresh);
+
+  /* Drop the new graph and put the kept one back. */
+  scheduler_free_tasks(sched);
+  swift_free("unlocks", sched->unlocks);
+  swift_free("unlock_ind", sched->unlock_ind);
+  swift_free("links", e->links);
+  *sched = kept_sched;
+  for (int k = 0; k < sched->nr_queues; k++)
+    sched->queues[k].tasks = sched->tasks;
+  e->links = kept_links;
+  e->nr_links = kept_nr_links;
+  e->size_links = kept_size_links;
+
+  buffer = kept_cells;
+  for (int k = 0; k < s->nr_cells; k++)
+    buffer = engine_copy_cells_rec(&s->cells_top[k], buffer,
+                                   /*to_buffer=*/0);
+  free(kept_cells);
+
+  engine_task_graph_compare(&kept, &fresh);
+  engine_task_graph_clean(&kept);
+  engine_task_graph_clean(&fresh);
+
+  if (e->verbose)
+    message("Checked %d kept tasks against a new graph, took %.3f %s.",
+            sched->nr_tasks, clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+#endif
+
+/**
+ * @brief Re-use the tasks kept through the last space_rebuild() if they are
+ * still valid for the new cell tree, or make new ones.
+ *
+ * The tasks can be kept when the tree has the same structure as the one
+ * they were made for, the particle counts and smoothing lengths still lead to
+ * the same split tasks and the particles have not moved too much for the pair
+ * tasks to still be valid. Only their weights then need to be updated. With
+ * debugging checks on, a new set of tasks is also made and compared, task by
+ * task and dependency by dependency, to the kept one, which then runs.
+ *
+ * @param e The #engine.
+ */
+void engine_rebuild_tasks(struct engine *e) {
+
+  struct space *s = e->s;
+  struct scheduler *sched = &e->sched;
+  const ticks tic = getticks();
+
+  /* Can we keep the tasks? */
+  int keep = s->keep_cell_tasks && !s->tree_changed;
+  if (keep) {
+    struct engine_check_kept_tasks_data data = {sched, /*invalid=*/0};
+    threadpool_map(&e->threadpool, engine_check_kept_tasks_mapper,
+                   sched->tasks, sched->nr_tasks, sizeof(struct task),
+                   threadpool_auto_chunk_size, &data);
+    keep = !data.invalid;
+  }
+
+  if (keep) {
+
+    /* Prepare the tasks as if they had just been made. The tasks activated
+     * by the unskip that triggered the rebuild are forgotten, as done by
+     * scheduler_reset() for a new graph. */
+    threadpool_map(&e->threadpool, engine_reset_kept_tasks_mapper,
+                   sched->tasks, sched->nr_tasks, sizeof(struct task),
+                   threadpool_auto_chunk_size, NULL);
+    scheduler_clear_active(sched);
+
+#ifdef SWIFT_DEBUG_CHECKS
+    /* Verify that a new graph would be the same. */
+    engine_check_kept_tasks(e);
+#endif
+
+    /* Weight the tasks for the new particle distribution. */
+    scheduler_reweight(sched, e->verbose);
+    e->tasks_age = 0;
+
+    if (e->verbose)
+      message("Kept %d tasks, took %.3f %s.", sched->nr_tasks,
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
+    return;
+  }
+
+  /* Drop the kept tasks and the cells' pointers to them. */
+  if (s->keep_cell_tasks) {
+    if (e->verbose)
+      message("Could not keep the tasks (tree changed: %d).",
+              s->tree_changed);
+    scheduler_free_tasks(sched);
+    space_clear_tasks(s);
+  }
+
+  engine_maketasks(e);
+}
@@ -26,6 +26,7 @@
 #include "engine.h"
 
 /* Local headers. */
+#include "intrinsics.h"
 #include "memswap.h"
 
 #ifdef WITH_MPI
@@ -236,6 +237,405 @@ static void *engine_do_redistribute(const char *label, int *counts, char *parts,
   /* And return new memory. */
   return parts_new;
 }
+
+/**
+ * @brief The fields of a particle type compressed in transit by the
+ * streaming redistribute.
+ *
+ * The position and the ID of each particle are stored as the bytes that
+ * differ from the ones of the previous particle (XOR), which are few as the
+ * particles are sorted by cell. The number of bytes kept for each 64-bit word
+ * is stored in a 4-bit header.
+ */
+struct redist_codec {
+
+  /*! Offsets of the fields in the particle structure, in increasing order */
+  size_t offset[2];
+
+  /*! Number of 64-bit words in each field */
+  int words[2];
+};
+
+/*! Number of 64-bit words compressed per particle (3 coordinates and ID) */
+#define engine_redistribute_codec_words 4
+
+/*! Bytes of header per particle (4 bits per compressed word) */
+#define engine_redistribute_codec_header \
+  ((engine_redistribute_codec_words + 1) / 2)
+
+/**
+ * @brief Initialise the description of the compressed fields.
+ *
+ * @param codec The #redist_codec to initialise.
+ * @param x_offset Offset of the (double[3]) position in the particle struct.
+ * @param id_offset Offset of the (long long) ID in the particle struct.
+ */
+static void engine_redistribute_codec_init(struct redist_codec *codec,
+                                           const size_t x_offset,
+                                           const size_t id_offset) {
+  const int x_first = x_offset < id_offset;
+  codec->offset[0] = x_first ? x_offset : id_offset;
+  codec->offset[1] = x_first ? id_offset : x_offset;
+  codec->words[0] = x_first ? 3 : 1;
+  codec->words[1] = x_first ? 1 : 3;
+}
+
+/**
+ * @brief Compress a run of particles into a buffer.
+ *
+ * @param codec The #redist_codec of this particle type.
+ * @param buff The buffer to write to, large enough for count * (sizeofparts +
+ * engine_redistribute_codec_header) bytes.
+ * @param parts The particles to compress.
+ * @param count The number of particles.
+ * @param sizeofparts sizeof the particle struct.
+ *
+ * @return The number of bytes written.
+ */
+static size_t engine_redistribute_compress(const struct redist_codec *codec,
+                                           char *buff, const char *parts,
+                                           const size_t count,
+                                           const size_t sizeofparts) {
+
+  uint64_t prev[engine_redistribute_codec_words] = {0};
+  char *out = buff;
+
+  for (size_t i = 0; i < count; i++) {
+    const char *p = &parts[i * sizeofparts];
+
+    /* Header with the number of bytes kept for each word. */
+    unsigned char *header = (unsigned char *)out;
+    memset(header, 0, engine_redistribute_codec_header);
+    out += engine_redistribute_codec_header;
+
+    /* Encoded fields followed by the bytes in between them. */
+    size_t done = 0;
+    int w = 0;
+    for (int f = 0; f < 2; f++) {
+      memcpy(out, &p[done], codec->offset[f] - done);
+      out += codec->offset[f] - done;
+
+      for (int k = 0; k < codec->words[f]; k++, w++) {
+        uint64_t word;
+        memcpy(&word, &p[codec->offset[f] + k * sizeof(uint64_t)],
+               sizeof(uint64_t));
+        const uint64_t diff = word ^ prev[w];
+        prev[w] = word;
+
+        const int nbytes = diff ? 8 - intrinsics_clzll(diff) / 8 : 0;
+        header[w / 2] |= nbytes << (4 * (w % 2));
+        for (int b = 0; b < nbytes; b++) *out++ = (diff >> (8 * b)) & 0xff;
+      }
+      done = codec->offset[f] + codec->words[f] * sizeof(uint64_t);
+    }
+    memcpy(out, &p[done], sizeofparts - done);
+    out += sizeofparts - done;
+  }
+
+  return out - buff;
+}
+
+/**
+ * @brief Decompress a run of particles written by
+ * engine_redistribute_compress().
+ *
+ * @param codec The #redist_codec of this particle type.
+ * @param parts The particles to write to.
+ * @param buff The compressed data.
+ * @param count The number of particles.
+ * @param sizeofparts sizeof the particle struct.
+ */
+static void engine_redistribute_decompress(const struct redist_codec *codec,
+                                           char *parts, const char *buff,
+                                           const size_t count,
+                                           const size_t sizeofparts) {
+
+  uint64_t prev[engine_redistribute_codec_words] = {0};
+  const char *in = buff;
+
+  for (size_t i = 0; i < count; i++) {
+    char *p = &parts[i * sizeofparts];
+
+    const unsigned char *header = (const unsigned char *)in;
+    in += engine_redistribute_codec_header;
+
+    size_t done = 0;
+    int w = 0;
+    for (int f = 0; f < 2; f++) {
+      memcpy(&p[done], in, codec->offset[f] - done);
+      in += codec->offset[f] - done;
+
+      for (int k = 0; k < codec->words[f]; k++, w++) {
+        const int nbytes = (header[w / 2] >> (4 * (w % 2))) & 0xf;
+        uint64_t diff = 0;
+        for (int b = 0; b < nbytes; b++)
+          diff |= (uint64_t)(unsigned char)*in++ << (8 * b);
+        prev[w] ^= diff;
+        memcpy(&p[codec->offset[f] + k * sizeof(uint64_t)], &prev[w],
+               sizeof(uint64_t));
+      }
+      done = codec->offset[f] + codec->words[f] * sizeof(uint64_t);
+    }
+    memcpy(&p[done], in, sizeofparts - done);
+    in += sizeofparts - done;
+  }
+}
+
+/**
+ * @brief Reverse the order of a run of particles.
+ *
+ * @param parts The particles.
+ * @param count The number of particles.
+ * @param sizeofparts sizeof the particle struct.
+ */
+static void engine_redistribute_reverse(char *parts, const size_t count,
+                                        const size_t sizeofparts) {
+  for (size_t i = 0, j = count - 1; i < j && j < count; i++, j--)
+    memswap(&parts[i * sizeofparts], &parts[j * sizeofparts], sizeofparts);
+}
+
+/**
+ * Do the exchange of one type of particles with all the other nodes, one
+ * pair of nodes and one bounded chunk of particles at a time.
+ *
+ * The nodes exchange their particles in nr_nodes - 1 rounds, sending to the
+ * node nodeID + d and receiving from the node nodeID - d in round d, in chunks
+ * of at most buffer_size bytes so that the MPI library never holds more than
+ * that in flight. When the current allocation is large enough to hold both
+ * the particles we still have to send and the ones we receive, the exchange
+ * is done in place: the particles to send are moved to the end of the
+ * allocation and the ones we keep and receive are placed at the front, so
+ * that no new particle array is needed. The layout of the result is the same
+ * as for engine_do_redistribute().
+ *
+ * @param label a label for the memory allocations of this particle type.
+ * @param counts 2D array with the counts of particles to exchange with
+ *               each other node.
+ * @param parts the particle data to exchange
+ * @param size_parts the number of particles the parts array can hold.
+ * @param new_nr_parts the number of particles this node will have after all
+ *                     exchanges have completed.
+ * @param sizeofparts sizeof the particle struct.
+ * @param alignsize the memory alignment required for this particle type.
+ * @param codec the fields to compress in transit, NULL to send the particles
+ *              as they are.
+ * @param nr_nodes the number of nodes to exchange with.
+ * @param nodeID the id of this node.
+ * @param buffer_size the maximal size in bytes of a message.
+ *
+ * @result the particle data constructed from all the exchanges, which is
+ *         parts if the exchange was done in place.
+ */
+static void *engine_do_redistribute_streaming(
+    const char *label, int *counts, char *parts, size_t size_parts,
+    size_t new_nr_parts, size_t sizeofparts, size_t alignsize,
+    const struct redist_codec *codec, int nr_nodes, int nodeID,
+    size_t buffer_size) {
+
+  /* Where do our particles go to and come from? */
+  size_t *send_offsets = NULL, *recv_offsets = NULL;
+  if ((send_offsets = (size_t *)malloc(sizeof(size_t) * nr_nodes)) == NULL ||
+      (recv_offsets = (size_t *)malloc(sizeof(size_t) * nr_nodes)) == NULL)
+    error("Failed to allocate offsets for the redistribution.");
+
+  size_t nr_parts = 0, nr_send = 0, nr_recv = 0, nr_keep = 0;
+  size_t offset_keep_old = 0, offset_keep_new = 0;
+  for (int k = 0; k < nr_nodes; k++) {
+    const size_t sending = counts[nodeID * nr_nodes + k];
+    const size_t receiving = counts[k * nr_nodes + nodeID];
+    if (k == nodeID) {
+      offset_keep_old = nr_parts;
+      offset_keep_new = nr_keep + nr_recv;
+      nr_keep = sending;
+    } else {
+      nr_send += sending;
+      nr_recv += receiving;
+    }
+    nr_parts += sending;
+  }
+
+  char *parts_new = NULL;
+  const char *send_base = NULL;
+  const int in_place =
+      nr_parts + nr_recv <= size_parts &&
+      new_nr_parts * engine_redistribute_alloc_margin <= size_parts;
+
+  if (in_place) {
+
+    /* Move the particles we keep to the front... */
+    const size_t nr_lower = offset_keep_old;
+    engine_redistribute_reverse(parts, nr_lower + nr_keep, sizeofparts);
+    engine_redistribute_reverse(parts, nr_keep, sizeofparts);
+    engine_redistribute_reverse(&parts[nr_keep * sizeofparts], nr_lower,
+                                sizeofparts);
+
+    /* ...the ones to send, still sorted by node, to the end... */
+    char *send_parts = &parts[(size_parts - nr_send) * sizeofparts];
+    memmove(send_parts, &parts[nr_keep * sizeofparts], nr_send * sizeofparts);
+
+    /* ...and then the ones we keep to their final position. */
+    memmove(&parts[offset_keep_new * sizeofparts], parts,
+            nr_keep * sizeofparts);
+
+    parts_new = parts;
+    send_base = send_parts;
+    size_t offset = 0;
+    for (int k = 0; k < nr_nodes; k++) {
+      send_offsets[k] = offset;
+      if (k != nodeID) offset += counts[nodeID * nr_nodes + k];
+    }
+
+  } else {
+
+    /* Allocate a new particle array with some extra margin */
+    if (swift_memalign(
+            label, (void **)&parts_new, alignsize,
+            sizeofparts * new_nr_parts * engine_redistribute_alloc_margin) != 0)
+      error("Failed to allocate new particle data.");
+
+    memcpy(&parts_new[offset_keep_new * sizeofparts],
+           &parts[offset_keep_old * sizeofparts], nr_keep * sizeofparts);
+
+    send_base = parts;
+    size_t offset = 0;
+    for (int k = 0; k < nr_nodes; k++) {
+      send_offsets[k] = offset;
+      offset += counts[nodeID * nr_nodes + k];
+    }
+  }
+
+  size_t offset = 0;
+  for (int k = 0; k < nr_nodes; k++) {
+    recv_offsets[k] = offset;
+    offset += counts[k * nr_nodes + nodeID];
+  }
+
+  /* Number of particles per message and staging buffers for the compressed
+   * ones. */
+  const size_t packed_size =
+      sizeofparts + (codec != NULL ? engine_redistribute_codec_header : 0);
+  size_t chunk = buffer_size / packed_size;
+  if (chunk < 1) chunk = 1;
+  if (chunk > INT_MAX / packed_size) chunk = INT_MAX / packed_size;
+
+  char *send_buff = NULL, *recv_buff = NULL;
+  if (codec != NULL) {
+    if ((send_buff = (char *)malloc(chunk * packed_size)) == NULL ||
+        (recv_buff = (char *)malloc(chunk * packed_size)) == NULL)
+      error("Failed to allocate the redistribution staging buffers.");
+  }
+
+  for (int d = 1; d < nr_nodes; d++) {
+
+    const int node_send = (nodeID + d) % nr_nodes;
+    const int node_recv = (nodeID - d + nr_nodes) % nr_nodes;
+    const size_t to_send = counts[nodeID * nr_nodes + node_send];
+    const size_t to_recv = counts[node_recv * nr_nodes + nodeID];
+    const char *send_parts = &send_base[send_offsets[node_send] * sizeofparts];
+    char *recv_parts = &parts_new[recv_offsets[node_recv] * sizeofparts];
+
+    for (size_t sent = 0, recvd = 0; sent < to_send || recvd < to_recv;) {
+
+      const size_t sending = min(chunk, to_send - sent);
+      const size_t receiving = min(chunk, to_recv - recvd);
+      MPI_Request reqs[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+
+      if (receiving > 0) {
+        char *buff = codec != NULL ? recv_buff
+                                   : &recv_parts[recvd * sizeofparts];
+        const int res =
+            MPI_Irecv(buff, receiving * packed_size, MPI_BYTE, node_recv, d,
+                      MPI_COMM_WORLD, &reqs[1]);
+        if (res != MPI_SUCCESS)
+          mpi_error(res, "Failed to emit irecv of parts from node %i.",
+                    node_recv);
+      }
+
+      if (sending > 0) {
+        const char *buff = &send_parts[sent * sizeofparts];
+        size_t size = sending * sizeofparts;
+        if (codec != NULL) {
+          size = engine_redistribute_compress(codec, send_buff, buff, sending,
+                                              sizeofparts);
+          buff = send_buff;
+        }
+        const int res = MPI_Isend(buff, size, MPI_BYTE, node_send, d,
+                                  MPI_COMM_WORLD, &reqs[0]);
+        if (res != MPI_SUCCESS)
+          mpi_error(res, "Failed to isend parts to node %i.", node_send);
+      }
+
+      const int res = MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+      if (res != MPI_SUCCESS)
+        mpi_error(res, "Failed during waitall for part data.");
+
+      if (receiving > 0 && codec != NULL)
+        engine_redistribute_decompress(codec, &recv_parts[recvd * sizeofparts],
+                                       recv_buff, receiving, sizeofparts);
+
+      sent += sending;
+      recvd += receiving;
+    }
+  }
+
+  /* Free temps. */
+  free(send_buff);
+  free(recv_buff);
+  free(send_offsets);
+  free(recv_offsets);
+
+  /* And return the particles. */
+  return parts_new;
+}
+
+/**
+ * @brief Exchange one type of particles with all the other nodes and release
+ * the old particle array.
+ *
+ * Uses the streaming exchange when a staging buffer size was given and the
+ * original exchange otherwise.
+ *
+ * @param e The #engine.
+ * @param label a label for the memory allocations of this particle type.
+ * @param counts 2D array with the counts of particles to exchange with
+ *               each other node.
+ * @param parts the particle data to exchange
+ * @param size_parts (in/out) the number of particles the particle array can
+ *                   hold.
+ * @param new_nr_parts the number of particles this node will have after all
+ *                     exchanges have completed.
+ * @param sizeofparts sizeof the particle struct.
+ * @param alignsize the memory alignment required for this particle type.
+ * @param mpi_type the MPI_Datatype for these particles.
+ * @param codec the fields that can be compressed in transit, or NULL.
+ *
+ * @result the new particle data.
+ */
+static void *engine_redistribute_particles(
+    const struct engine *e, const char *label, int *counts, char *parts,
+    size_t *size_parts, size_t new_nr_parts, size_t sizeofparts,
+    size_t alignsize, MPI_Datatype mpi_type, const struct redist_codec *codec) {
+
+  void *parts_new;
+  if (e->redist_buffer_size > 0) {
+    parts_new = engine_do_redistribute_streaming(
+        label, counts, parts, *size_parts, new_nr_parts, sizeofparts,
+        alignsize, e->redist_compress ? codec : NULL, e->nr_nodes, e->nodeID,
+        e->redist_buffer_size);
+  } else {
+    parts_new = engine_do_redistribute(label, counts, parts, new_nr_parts,
+                                       sizeofparts, alignsize, mpi_type,
+                                       e->nr_nodes, e->nodeID, e->syncredist);
+  }
+
+  /* Release the old array unless we re-used it. */
+  if (parts_new != parts) {
+    swift_free(label, parts);
+    *size_parts = engine_redistribute_alloc_margin * new_nr_parts;
+  }
+
+  return parts_new;
+}
 #endif
 
 #ifdef WITH_MPI /* redist_mapper */
@@ -1035,51 +1435,47 @@ void engine_redistribute(struct engine *e) {
   /* Now exchange the particles, type by type to keep the memory required
    * under control. */
 
-  /* SPH particles. */
-  void *new_parts = engine_do_redistribute(
-      "parts", counts, (char *)s->parts, nr_parts_new, sizeof(struct part),
-      part_align, part_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("parts", s->parts);
-  s->parts = (struct part *)new_parts;
+  /* Fields compressed in transit by the streaming exchanges. */
+  struct redist_codec part_codec, gpart_codec, spart_codec, bpart_codec;
+  engine_redistribute_codec_init(&part_codec, offsetof(struct part, x),
+                                 offsetof(struct part, id));
+  engine_redistribute_codec_init(&gpart_codec, offsetof(struct gpart, x),
+                                 offsetof(struct gpart, id_or_neg_offset));
+  engine_redistribute_codec_init(&spart_codec, offsetof(struct spart, x),
+                                 offsetof(struct spart, id));
+  engine_redistribute_codec_init(&bpart_codec, offsetof(struct bpart, x),
+                                 offsetof(struct bpart, id));
+
+  /* SPH particles. The xparts share the allocation size of the parts, so
+   * they end up in place when the parts do. */
+  size_t size_xparts = s->size_parts;
+  s->parts = (struct part *)engine_redistribute_particles(
+      e, "parts", counts, (char *)s->parts, &s->size_parts, nr_parts_new,
+      sizeof(struct part), part_align, part_mpi_type, &part_codec);
   s->nr_parts = nr_parts_new;
-  s->size_parts = engine_redistribute_alloc_margin * nr_parts_new;
 
   /* Extra SPH particle properties. */
-  new_parts = engine_do_redistribute(
-      "xparts", counts, (char *)s->xparts, nr_parts_new, sizeof(struct xpart),
-      xpart_align, xpart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("xparts", s->xparts);
-  s->xparts = (struct xpart *)new_parts;
+  s->xparts = (struct xpart *)engine_redistribute_particles(
+      e, "xparts", counts, (char *)s->xparts, &size_xparts, nr_parts_new,
+      sizeof(struct xpart), xpart_align, xpart_mpi_type, /*codec=*/NULL);
 
   /* Gravity particles. */
-  new_parts =
-      engine_do_redistribute("gparts", g_counts, (char *)s->gparts,
-                             nr_gparts_new, sizeof(struct gpart), gpart_align,
-                             gpart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("gparts", s->gparts);
-  s->gparts = (struct gpart *)new_parts;
+  s->gparts = (struct gpart *)engine_redistribute_particles(
+      e, "gparts", g_counts, (char *)s->gparts, &s->size_gparts, nr_gparts_new,
+      sizeof(struct gpart), gpart_align, gpart_mpi_type, &gpart_codec);
   s->nr_gparts = nr_gparts_new;
-  s->size_gparts = engine_redistribute_alloc_margin * nr_gparts_new;
 
   /* Star particles. */
-  new_parts =
-      engine_do_redistribute("sparts", s_counts, (char *)s->sparts,
-                             nr_sparts_new, sizeof(struct spart), spart_align,
-                             spart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("sparts", s->sparts);
-  s->sparts = (struct spart *)new_parts;
+  s->sparts = (struct spart *)engine_redistribute_particles(
+      e, "sparts", s_counts, (char *)s->sparts, &s->size_sparts, nr_sparts_new,
+      sizeof(struct spart), spart_align, spart_mpi_type, &spart_codec);
   s->nr_sparts = nr_sparts_new;
-  s->size_sparts = engine_redistribute_alloc_margin * nr_sparts_new;
 
   /* Black holes particles. */
-  new_parts =
-      engine_do_redistribute("bparts", b_counts, (char *)s->bparts,
-                             nr_bparts_new, sizeof(struct bpart), bpart_align,
-                             bpart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("bparts", s->bparts);
-  s->bparts = (struct bpart *)new_parts;
+  s->bparts = (struct bpart *)engine_redistribute_particles(
+      e, "bparts", b_counts, (char *)s->bparts, &s->size_bparts, nr_bparts_new,
+      sizeof(struct bpart), bpart_align, bpart_mpi_type, &bpart_codec);
   s->nr_bparts = nr_bparts_new;
-  s->size_bparts = engine_redistribute_alloc_margin * nr_bparts_new;
 
   /* All particles have now arrived. Time for some final operations on the
      stuff we just received */
@@ -24,6 +24,7 @@
 
 /* Local headers. */
 #include "inline.h"
+#include "vector.h"
 
 /* Standard headers */
 #include <math.h>
@@ -69,4 +70,37 @@ __attribute__((always_inline, const)) INLINE static float optimized_expf(
   return e.f;
 }
 
+#if defined(WITH_VECTORIZATION) && defined(VEC_HAVE_LDEXP)
+
+/**
+ * @brief Compute the exponential of a vector of numbers.
+ *
+ * Vector version of optimized_expf() with the same accuracy. The input is
+ * clamped to [-87, 88] to keep the result a normal number.
+ *
+ * @param x The numbers to take the exponential of.
+ * @param exp_x (return) The exponentials.
+ */
+__attribute__((always_inline)) INLINE static void optimized_expf_vec(
+    const vector *x, vector *exp_x) {
+
+  vector x_c, i, f;
+  x_c.v = vec_fmax(vec_fmin(x->v, vec_set1(88.f)), vec_set1(-87.f));
+
+  /* e^x = 2^i * e^f with f in the range [-ln(2)/2, ln(2)/2] */
+  i.v = vec_floor(vec_fma(x_c.v, vec_set1((float)M_LOG2E), vec_set1(0.5f)));
+  f.v = vec_fnma(vec_set1((float)M_LN2), i.v, x_c.v);
+
+  /* Same polynomial as the scalar version */
+  exp_x->v = vec_fma(vec_set1(0.041944388f), f.v, vec_set1(0.168006673f));
+  exp_x->v = vec_fma(exp_x->v, f.v, vec_set1(0.499999940f));
+  exp_x->v = vec_fma(exp_x->v, f.v, vec_set1(0.999956906f));
+  exp_x->v = vec_fma(exp_x->v, f.v, vec_set1(0.999999642f));
+
+  /* Shift i into the exponent */
+  exp_x->v = vec_ldexp(exp_x->v, i.v);
+}
+
+#endif /* WITH_VECTORIZATION && VEC_HAVE_LDEXP */
+
 #endif /* SWIFT_OPTIMIZED_EXP_H */
@@ -40,6 +40,7 @@
 #include "common_io.h"
 #include "engine.h"
 #include "fof_catalogue_io.h"
+#include "fof_so.h"
 #include "hashmap.h"
 #include "memuse.h"
 #include "proxy.h"
@@ -53,7 +54,6 @@
 
 /* Constants. */
 #define UNION_BY_SIZE_OVER_MPI (1)
-#define FOF_COMPRESS_PATHS_MIN_LENGTH (2)
 
 /* The FoF policy we are running */
 int current_fof_linking_type;
@@ -168,6 +168,16 @@ void fof_init(struct fof_props *props, struct swift_params *params,
   if (props->l_x_ratio <= 0. && props->l_x_absolute == -1.)
     error("The FOF linking length ratio can't be negative!");
 
+  /* Read how to merge the groups spanning more than one rank */
+  props->hierarchical_merge =
+      parser_get_opt_param_int(params, "FOF:hierarchical_merge", 0);
+
+  /* Read whether we compute the spherical overdensity properties */
+  props->compute_so_properties =
+      parser_get_opt_param_int(params, "FOF:compute_SO_properties", 0);
+  props->so_mass = NULL;
+  props->so_radius = NULL;
+
   if (!stand_alone_fof && props->seed_black_holes_enabled) {
 
     /* Read the minimal halo mass for black hole seeding */
@@ -714,7 +724,11 @@ __attribute__((always_inline)) INLINE static int gpart_is_ignorable(
  *
  * We follow the group_index array until reaching the root of the group.
  *
- * Also performs path compression if the path is long.
+ * Performs lock-free path halving on the way: each visited particle is made to
+ * point to its grandparent with a CAS that only succeeds if its parent has not
+ * changed in the meantime. Since parents are only ever replaced by one of
+ * their ancestors, a failed CAS is harmless and concurrent finds and unions
+ * never break a group apart.
  *
  * @param i The index of the particle.
  * @param group_index Array of group root indices.
@@ -723,21 +737,19 @@ __attribute__((always_inline)) INLINE static size_t fof_find(
     const size_t i, size_t *group_index) {
 
   size_t root = i;
-  int tree_depth = 0;
+  size_t parent = group_index[root];
 
-  while (root != group_index[root]) {
-#ifdef PATH_HALVING
-    atomic_cas(&group_index[root], group_index[root],
-               group_index[group_index[root]]);
-#endif
-    root = group_index[root];
-    tree_depth++;
-  }
+  while (root != parent) {
+
+    const size_t grandparent = group_index[parent];
 
-  /* Only perform path compression on trees with a depth of
-   * FOF_COMPRESS_PATHS_MIN_LENGTH or higher. */
-  if (tree_depth >= FOF_COMPRESS_PATHS_MIN_LENGTH)
-    atomic_cas(&group_index[i], group_index[i], root);
+    /* Shorten the path for the next searches */
+    if (parent != grandparent)
+      atomic_cas(&group_index[root], parent, grandparent);
+
+    root = grandparent;
+    parent = group_index[root];
+  }
 
   return root;
 }
@@ -745,33 +757,32 @@ __attribute__((always_inline)) INLINE static size_t fof_find(
 /**
  * @brief Atomically update the root of a group
  *
+ * The update only succeeds if the old root is still a root, i.e. if no other
+ * thread has attached it to another group since we found it.
+ *
  * @param address The address of the value to update.
+ * @param old_root The old root (expected value at the address).
  * @param y The new value to write.
  *
  * @return 1 If successful, 0 otherwise.
  */
 __attribute__((always_inline)) INLINE static int atomic_update_root(
-    volatile size_t *address, const size_t y) {
+    volatile size_t *address, const size_t old_root, const size_t y) {
 
   size_t *size_t_ptr = (size_t *)address;
 
-  size_t old_val = *address;
-  size_t test_val = old_val;
-  size_t new_val = y;
-
-  /* atomic_cas returns old_val if *size_t_ptr has not changed since being
-   * read.*/
-  old_val = atomic_cas(size_t_ptr, test_val, new_val);
-
-  if (test_val == old_val)
-    return 1;
-  else
-    return 0;
+  /* atomic_cas returns old_root if *size_t_ptr has not changed since being
+   * found to be a root.*/
+  return atomic_cas(size_t_ptr, old_root, y) == old_root;
 }
 
 /**
  * @brief Unifies two groups by setting them to the same root.
  *
+ * The root with the larger index is always attached to the one with the
+ * smaller index, which guarantees that no cycle can be created by concurrent
+ * unions.
+ *
  * @param root_i The root of the first group. Will be updated.
  * @param root_j The root of the second group.
  * @param group_index The list of group roots.
@@ -788,23 +799,26 @@ __attribute__((always_inline)) INLINE static void fof_union(
     const size_t root_j_new = fof_find(root_j, group_index);
 
     /* Skip particles in the same group. */
-    if (root_i_new == root_j_new) return;
+    if (root_i_new == root_j_new) {
+      *root_i = root_i_new;
+      return;
+    }
 
     /* If the root ID of pj is lower than pi's root ID set pi's root to point to
      * pj's. Otherwise set pj's root to point to pi's.*/
     if (root_j_new < root_i_new) {
 
-      /* Updates the root and checks that its value has not been changed since
-       * being read. */
-      result = atomic_update_root(&group_index[root_i_new], root_j_new);
+      /* Updates the root and checks that it is still a root. */
+      result = atomic_update_root(&group_index[root_i_new], root_i_new,
+                                  root_j_new);
 
       /* Update root_i on the fly. */
       *root_i = root_j_new;
     } else {
 
-      /* Updates the root and checks that its value has not been changed since
-       * being read. */
-      result = atomic_update_root(&group_index[root_j_new], root_i_new);
+      /* Updates the root and checks that it is still a root. */
+      result = atomic_update_root(&group_index[root_j_new], root_j_new,
+                                  root_i_new);
 
       /* Update root_i on the fly. */
       *root_i = root_i_new;
@@ -2068,19 +2082,16 @@ void rec_fof_attach_self(const struct fof_props *props, const double dim[3],
   }
 }
 
-/* Mapper function to atomically update the group size array. */
-void fof_update_group_size_mapper(hashmap_key_t key, hashmap_value_t *value,
-                                  void *data) {
-
-  size_t *group_size = (size_t *)data;
-
-  /* Use key to index into group size array. */
-  atomic_add(&group_size[key], value->value_st);
-}
-
 /**
  * @brief Mapper function to calculate the group sizes.
  *
+ * The particles are sorted by cell, so the members of a group mostly come in
+ * contiguous runs. We perform a segmented reduction over these runs and only
+ * touch the shared group size array (atomically) once per run.
+ *
+ * The group_index array is also flattened on the way, such that every particle
+ * directly points at its root for all the later searches.
+ *
  * @param map_data An array of #gpart%s.
  * @param num_elements Chunk size.
  * @param extra_data Pointer to a #space.
@@ -2098,59 +2109,43 @@ void fof_calc_group_size_mapper(void *map_data, int num_elements,
   const ptrdiff_t gparts_offset = (ptrdiff_t)(gparts - s->gparts);
   size_t *const group_index_offset = group_index + gparts_offset;
 
-  /* Create hash table. */
-  hashmap_t map;
-  hashmap_init(&map);
+  /* The current run of particles sharing the same root */
+  size_t run_root = 0;
+  size_t run_size = 0;
 
   for (int ind = 0; ind < num_elements; ind++) {
 
-    const hashmap_key_t root =
-        (hashmap_key_t)fof_find(group_index_offset[ind], group_index);
+    const size_t root = fof_find(group_index_offset[ind], group_index);
     const size_t gpart_index = gparts_offset + ind;
 
-    /* Only add particles which aren't the root of a group. Stops groups of size
-     * 1 being added to the hash table. */
-    if (root != gpart_index) {
-      hashmap_value_t *size = hashmap_get(&map, root);
+    /* Point directly at the root from now on */
+    if (group_index_offset[ind] != root)
+      atomic_cas(&group_index_offset[ind], group_index_offset[ind], root);
 
-      if (size != NULL)
-        (*size).value_st++;
-      else
-        error("Couldn't find key (%zu) or create new one.", root);
+    /* Only count particles which aren't the root of a group. Stops groups of
+     * size 1 being touched. */
+    if (root == gpart_index) continue;
+
+    /* New segment? Flush the previous one. */
+    if (root != run_root) {
+      if (run_size > 0) atomic_add(&group_size[run_root], run_size);
+      run_root = root;
+      run_size = 0;
     }
+    run_size++;
   }
 
-  /* Update the group size array. */
-  if (map.size > 0)
-    hashmap_iterate(&map, fof_update_group_size_mapper, group_size);
-
-  hashmap_free(&map);
-}
-
-/* Mapper function to atomically update the group mass array. */
-static INLINE void fof_update_group_mass_iterator(hashmap_key_t key,
-                                                  hashmap_value_t *value,
-                                                  void *data) {
-
-  double *group_mass = (double *)data;
-
-  /* Use key to index into group mass array. */
-  atomic_add_d(&group_mass[key], value->value_dbl);
-}
-
-/* Mapper function to atomically update the group size array. */
-static INLINE void fof_update_group_size_iterator(hashmap_key_t key,
-                                                  hashmap_value_t *value,
-                                                  void *data) {
-  long long *group_size = (long long *)data;
-
-  /* Use key to index into group mass array. */
-  atomic_add(&group_size[key], value->value_st);
+  /* Flush the last segment */
+  if (run_size > 0) atomic_add(&group_size[run_root], run_size);
 }
 
 /**
  * @brief Mapper function to calculate the group masses.
  *
+ * As for the sizes, this is a segmented reduction over the runs of
+ * consecutive particles belonging to the same group. The shared arrays are
+ * only updated (atomically) once per run.
+ *
  * @param map_data An array of #gpart%s.
  * @param num_elements Chunk size.
  * @param extra_data Pointer to a #space.
@@ -2166,36 +2161,41 @@ void fof_calc_group_mass_mapper(void *map_data, int num_elements,
   const size_t group_id_default = s->e->fof_properties->group_id_default;
   const size_t group_id_offset = s->e->fof_properties->group_id_offset;
 
-  /* Create hash table. */
-  hashmap_t map;
-  hashmap_init(&map);
+  /* The current run of particles sharing the same group */
+  size_t run_index = 0;
+  double run_mass = 0.;
+  long long run_size = 0;
 
   /* Loop over particles and increment the group mass for groups above
    * min_group_size. */
   for (int ind = 0; ind < num_elements; ind++) {
 
     /* Only check groups above the minimum size. */
-    if (gparts[ind].fof_data.group_id != group_id_default) {
+    if (gparts[ind].fof_data.group_id == group_id_default) continue;
 
-      hashmap_key_t index = gparts[ind].fof_data.group_id - group_id_offset;
-      hashmap_value_t *data = hashmap_get(&map, index);
+    const size_t index = gparts[ind].fof_data.group_id - group_id_offset;
 
-      /* Update group mass */
-      if (data != NULL) {
-        (*data).value_dbl += gparts[ind].mass;
-        (*data).value_st += 1;
-      } else
-        error("Couldn't find key (%zu) or create new one.", index);
+    /* New segment? Flush the previous one. */
+    if (index != run_index) {
+      if (run_size > 0) {
+        atomic_add_d(&group_mass[run_index], run_mass);
+        atomic_add(&group_size[run_index], run_size);
+      }
+      run_index = index;
+      run_mass = 0.;
+      run_size = 0;
     }
-  }
 
-  /* Update the group mass array. */
-  if (map.size > 0)
-    hashmap_iterate(&map, fof_update_group_mass_iterator, group_mass);
-  if (map.size > 0)
-    hashmap_iterate(&map, fof_update_group_size_iterator, group_size);
+    /* Update group mass and size */
+    run_mass += gparts[ind].mass;
+    run_size++;
+  }
 
-  hashmap_free(&map);
+  /* Flush the last segment */
+  if (run_size > 0) {
+    atomic_add_d(&group_mass[run_index], run_mass);
+    atomic_add(&group_size[run_index], run_size);
+  }
 }
 
 #ifdef WITH_MPI
@@ -2636,11 +2636,18 @@ void fof_calc_group_mass(struct fof_props *props, const struct space *s,
 
 #else
 
+  const ticks tic_calc_group_mass = getticks();
+
   /* Increment the group mass for groups above min_group_size. */
   threadpool_map(&s->e->threadpool, fof_calc_group_mass_mapper, gparts,
                  nr_gparts, sizeof(struct gpart), threadpool_auto_chunk_size,
                  (struct space *)s);
 
+  if (s->e->verbose)
+    message("FOF calc group mass took (FOF SCALING): %.3f %s.",
+            clocks_from_ticks(getticks() - tic_calc_group_mass),
+            clocks_getunit());
+
   /* Direct pointers to the arrays */
   long long *max_part_density_index = props->max_part_density_index;
   float *max_part_density = props->max_part_density;
@@ -3616,6 +3623,283 @@ void fof_finalise_attachables(struct fof_props *props, const struct space *s) {
             clocks_from_ticks(getticks() - tic_total), clocks_getunit());
 }
 
+#ifdef WITH_MPI
+
+/**
+ * @brief Comparison function for qsort call comparing group links by the
+ * ID of their first group.
+ *
+ * @param a The first #fof_mpi link.
+ * @param b The second #fof_mpi link.
+ */
+static int compare_fof_mpi_group_i(const void *a, const void *b) {
+
+  const struct fof_mpi *link_a = (const struct fof_mpi *)a;
+  const struct fof_mpi *link_b = (const struct fof_mpi *)b;
+
+  if (link_a->group_i < link_b->group_i) return -1;
+  if (link_a->group_i > link_b->group_i) return 1;
+  return 0;
+}
+
+/**
+ * @brief Compress a list of links between group fragments to a star forest.
+ *
+ * A union-find is run over the links, always attaching the fragment with the
+ * larger ID to the one with the smaller ID. Each fragment that is not the root
+ * of its set is then replaced by a single link to that root. The result only
+ * depends on the set of fragments and their connectivity, not on the order of
+ * the input, and is never longer than the input.
+ *
+ * @param links The list of links (overwritten with the compressed list).
+ * @param count The number of links (updated).
+ */
+static void fof_compress_links(struct fof_mpi *links, int *count) {
+
+  const int nr_links = *count;
+  if (nr_links == 0) return;
+
+  size_t *ids = (size_t *)malloc(2 * nr_links * sizeof(size_t));
+  size_t *sizes = (size_t *)malloc(2 * nr_links * sizeof(size_t));
+  size_t *index = (size_t *)malloc(2 * nr_links * sizeof(size_t));
+  size_t *offset_i = (size_t *)malloc(nr_links * sizeof(size_t));
+  size_t *offset_j = (size_t *)malloc(nr_links * sizeof(size_t));
+  if (ids == NULL || sizes == NULL || index == NULL || offset_i == NULL ||
+      offset_j == NULL)
+    error("Error while allocating memory for the FOF link compression");
+
+  /* Collect the distinct fragments */
+  hashmap_t map;
+  hashmap_init(&map);
+  size_t nr_frags = 0;
+  for (int k = 0; k < nr_links; k++) {
+    for (int side = 0; side < 2; side++) {
+
+      const size_t group = side ? links[k].group_j : links[k].group_i;
+      const size_t size = side ? links[k].group_j_size : links[k].group_i_size;
+
+      int created_new_element = 0;
+      hashmap_value_t *value =
+          hashmap_get_new(&map, group, &created_new_element);
+      if (value == NULL)
+        error("Couldn't find key (%zu) or create new one.", group);
+      if (created_new_element) {
+        value->value_st = nr_frags;
+        ids[nr_frags] = group;
+        sizes[nr_frags] = size;
+        index[nr_frags] = nr_frags;
+        nr_frags++;
+      }
+      if (side)
+        offset_j[k] = value->value_st;
+      else
+        offset_i[k] = value->value_st;
+    }
+  }
+  hashmap_free(&map);
+
+  /* Union-find, rooting every set at its smallest ID */
+  for (int k = 0; k < nr_links; k++) {
+    const size_t root_i = fof_find(offset_i[k], index);
+    const size_t root_j = fof_find(offset_j[k], index);
+    if (root_i == root_j) continue;
+    if (ids[root_j] < ids[root_i])
+      index[root_i] = root_j;
+    else
+      index[root_j] = root_i;
+  }
+
+  /* One link from each non-root fragment to its root */
+  int nr_out = 0;
+  for (size_t k = 0; k < nr_frags; k++) {
+    const size_t root = fof_find(k, index);
+    if (root == k) continue;
+    links[nr_out].group_i = ids[k];
+    links[nr_out].group_i_size = sizes[k];
+    links[nr_out].group_j = ids[root];
+    links[nr_out].group_j_size = sizes[root];
+    nr_out++;
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (nr_out > nr_links) error("Compressed list of links grew!");
+#endif
+
+  *count = nr_out;
+
+  free(offset_j);
+  free(offset_i);
+  free(index);
+  free(sizes);
+  free(ids);
+}
+
+/**
+ * @brief Append the links received from another rank to a list of links.
+ *
+ * @param links The list of links (may be re-allocated).
+ * @param count The number of links (updated).
+ * @param partner The rank to receive from.
+ * @param bytes (return) Incremented by the number of bytes received.
+ */
+static void fof_recv_links(struct fof_mpi **links, int *count,
+                           const int partner, size_t *bytes) {
+
+  int recv_count = 0;
+  MPI_Recv(&recv_count, 1, MPI_INT, partner, 0, MPI_COMM_WORLD,
+           MPI_STATUS_IGNORE);
+
+  struct fof_mpi *new_links = NULL;
+  if (swift_memalign("fof_global_group_links", (void **)&new_links,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     (*count + recv_count) * sizeof(struct fof_mpi)) != 0)
+    error("Error while allocating memory for the merged list of group links");
+
+  memcpy(new_links, *links, *count * sizeof(struct fof_mpi));
+  MPI_Recv(new_links + *count, recv_count, fof_mpi_type, partner, 1,
+           MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+  swift_free("fof_global_group_links", *links);
+  *links = new_links;
+  *count += recv_count;
+  *bytes += recv_count * sizeof(struct fof_mpi);
+}
+
+/**
+ * @brief Send a list of links to another rank.
+ *
+ * @param links The list of links.
+ * @param count The number of links.
+ * @param partner The rank to send to.
+ * @param bytes (return) Incremented by the number of bytes sent.
+ */
+static void fof_send_links(const struct fof_mpi *links, const int count,
+                           const int partner, size_t *bytes) {
+
+  MPI_Send(&count, 1, MPI_INT, partner, 0, MPI_COMM_WORLD);
+  MPI_Send(links, count, fof_mpi_type, partner, 1, MPI_COMM_WORLD);
+  *bytes += count * sizeof(struct fof_mpi);
+}
+
+/**
+ * @brief Builds the global list of links between group fragments using a
+ * recursive-doubling tree reduction.
+ *
+ * Every rank starts from its own (compressed) links. In each round, pairs of
+ * ranks swap their current lists, merge them and compress the result to a
+ * star forest (see fof_compress_links()). After log2(nr_nodes) rounds (plus
+ * two when the number of ranks is not a power of two) all the ranks hold the
+ * same compressed global list. Links that only close loops or that connect
+ * fragments already known to be in the same group are dropped along the way,
+ * so the volume exchanged stays close to the number of distinct fragments.
+ *
+ * @param local_links The links found by this rank.
+ * @param local_count The number of links found by this rank.
+ * @param global_links (return) The global list of links (to be freed with the
+ * "fof_global_group_links" label).
+ * @param global_count (return) The number of global links.
+ * @param verbose Are we talkative?
+ */
+static void fof_merge_links_hierarchical(const struct fof_mpi *local_links,
+                                         const int local_count,
+                                         struct fof_mpi **global_links,
+                                         int *global_count,
+                                         const int verbose) {
+
+  const ticks tic = getticks();
+
+  int nr_nodes, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  /* Start from our own links */
+  struct fof_mpi *links = NULL;
+  int count = local_count;
+  if (swift_memalign("fof_global_group_links", (void **)&links,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     count * sizeof(struct fof_mpi)) != 0)
+    error("Error while allocating memory for the merged list of group links");
+  memcpy(links, local_links, count * sizeof(struct fof_mpi));
+  fof_compress_links(links, &count);
+
+  /* Largest power of two not above the number of ranks */
+  int nr_pow2 = 1;
+  while (2 * nr_pow2 <= nr_nodes) nr_pow2 *= 2;
+
+  int nr_rounds = 0;
+  size_t bytes_sent = 0, bytes_recv = 0;
+
+  /* Fold the extra ranks onto the power-of-two subset */
+  if (nr_pow2 < nr_nodes) {
+    if (rank >= nr_pow2) {
+      fof_send_links(links, count, rank - nr_pow2, &bytes_sent);
+    } else if (rank + nr_pow2 < nr_nodes) {
+      fof_recv_links(&links, &count, rank + nr_pow2, &bytes_recv);
+      fof_compress_links(links, &count);
+    }
+    nr_rounds++;
+  }
+
+  /* Recursive doubling over the power-of-two subset */
+  for (int mask = 1; mask < nr_pow2; mask *= 2) {
+
+    if (rank < nr_pow2) {
+      const int partner = rank ^ mask;
+
+      /* Lower rank sends first to avoid a deadlock */
+      if (rank < partner) {
+        fof_send_links(links, count, partner, &bytes_sent);
+        fof_recv_links(&links, &count, partner, &bytes_recv);
+      } else {
+        struct fof_mpi *copy = NULL;
+        if (swift_memalign("fof_global_group_links", (void **)&copy,
+                           SWIFT_STRUCT_ALIGNMENT,
+                           count * sizeof(struct fof_mpi)) != 0)
+          error("Error while allocating memory for the list of group links");
+        memcpy(copy, links, count * sizeof(struct fof_mpi));
+        const int copy_count = count;
+        fof_recv_links(&links, &count, partner, &bytes_recv);
+        fof_send_links(copy, copy_count, partner, &bytes_sent);
+        swift_free("fof_global_group_links", copy);
+      }
+      fof_compress_links(links, &count);
+    }
+    nr_rounds++;
+  }
+
+  /* Send the result back to the extra ranks */
+  if (nr_pow2 < nr_nodes) {
+    if (rank >= nr_pow2) {
+      count = 0;
+      fof_recv_links(&links, &count, rank - nr_pow2, &bytes_recv);
+    } else if (rank + nr_pow2 < nr_nodes) {
+      fof_send_links(links, count, rank + nr_pow2, &bytes_sent);
+    }
+    nr_rounds++;
+  }
+
+  /* Same order on all the ranks such that the final union-find agrees */
+  qsort(links, count, sizeof(struct fof_mpi), compare_fof_mpi_group_i);
+
+  *global_links = links;
+  *global_count = count;
+
+  if (verbose) {
+    size_t total_bytes = 0;
+    MPI_Reduce(&bytes_sent, &total_bytes, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+    if (rank == 0)
+      message(
+          "Hierarchical merge: %d rounds, %d links kept, %.3f MB sent in "
+          "total (%.3f MB by rank 0) took: %.3f %s.",
+          nr_rounds, count, total_bytes / (1024. * 1024.),
+          bytes_sent / (1024. * 1024.), clocks_from_ticks(getticks() - tic),
+          clocks_getunit());
+  }
+}
+
+#endif /* WITH_MPI */
+
 /**
  * @brief Process all the group fragments spanning more than
  * one rank to link them.
@@ -3653,63 +3937,87 @@ void fof_link_foreign_fragments(struct fof_props *props,
   /* Local copy of the variable set in the mapper */
   const int group_link_count = props->group_link_count;
 
-  /* Sum the total number of links across MPI domains over each MPI rank. */
+  struct fof_mpi *global_group_links = NULL;
   int global_group_link_count = 0;
-  MPI_Allreduce(&group_link_count, &global_group_link_count, 1, MPI_INT,
-                MPI_SUM, MPI_COMM_WORLD);
 
-  if (global_group_link_count < 0)
-    error("Overflow of the size of the global list of foreign links");
+  if (props->hierarchical_merge) {
 
-  struct fof_mpi *global_group_links = NULL;
-  int *displ = NULL, *group_link_counts = NULL;
+    /* Merge the links with a tree reduction, compressing them on the way */
+    fof_merge_links_hierarchical(props->group_links, group_link_count,
+                                 &global_group_links, &global_group_link_count,
+                                 verbose);
 
-  if (swift_memalign("fof_global_group_links", (void **)&global_group_links,
-                     SWIFT_STRUCT_ALIGNMENT,
-                     global_group_link_count * sizeof(struct fof_mpi)) != 0)
-    error("Error while allocating memory for the global list of group links");
+    swift_free("fof_group_links", props->group_links);
+    props->group_links = NULL;
 
-  if (posix_memalign((void **)&group_link_counts, SWIFT_STRUCT_ALIGNMENT,
-                     e->nr_nodes * sizeof(int)) != 0)
-    error(
-        "Error while allocating memory for the number of group links on each "
-        "MPI rank");
+    if (verbose)
+      message("Communication took: %.3f %s.",
+              clocks_from_ticks(getticks() - comms_tic), clocks_getunit());
 
-  if (posix_memalign((void **)&displ, SWIFT_STRUCT_ALIGNMENT,
-                     e->nr_nodes * sizeof(int)) != 0)
-    error(
-        "Error while allocating memory for the displacement in memory for the "
-        "global group link list");
+  } else {
 
-  /* Gather the total number of links on each rank. */
-  MPI_Allgather(&group_link_count, 1, MPI_INT, group_link_counts, 1, MPI_INT,
-                MPI_COMM_WORLD);
+    /* Sum the total number of links across MPI domains over each MPI rank. */
+    MPI_Allreduce(&group_link_count, &global_group_link_count, 1, MPI_INT,
+                  MPI_SUM, MPI_COMM_WORLD);
 
-  /* Set the displacements into the global link list using the link counts from
-   * each rank */
-  displ[0] = 0;
-  for (int i = 1; i < e->nr_nodes; i++) {
-    displ[i] = displ[i - 1] + group_link_counts[i - 1];
-    if (displ[i] < 0) error("Number of group links overflowing!");
-  }
+    if (global_group_link_count < 0)
+      error("Overflow of the size of the global list of foreign links");
 
-  /* Gather the global link list on all ranks. */
-  MPI_Allgatherv(props->group_links, group_link_count, fof_mpi_type,
-                 global_group_links, group_link_counts, displ, fof_mpi_type,
-                 MPI_COMM_WORLD);
+    int *displ = NULL, *group_link_counts = NULL;
 
-  /* Clean up memory. */
-  free(group_link_counts);
-  free(displ);
-  swift_free("fof_group_links", props->group_links);
-  props->group_links = NULL;
+    if (swift_memalign("fof_global_group_links", (void **)&global_group_links,
+                       SWIFT_STRUCT_ALIGNMENT,
+                       global_group_link_count * sizeof(struct fof_mpi)) != 0)
+      error(
+          "Error while allocating memory for the global list of group links");
 
-  if (verbose) {
-    message("Communication took: %.3f %s.",
-            clocks_from_ticks(getticks() - comms_tic), clocks_getunit());
+    if (posix_memalign((void **)&group_link_counts, SWIFT_STRUCT_ALIGNMENT,
+                       e->nr_nodes * sizeof(int)) != 0)
+      error(
+          "Error while allocating memory for the number of group links on "
+          "each MPI rank");
 
-    message("Global comms took: %.3f %s.", clocks_from_ticks(getticks() - tic),
-            clocks_getunit());
+    if (posix_memalign((void **)&displ, SWIFT_STRUCT_ALIGNMENT,
+                       e->nr_nodes * sizeof(int)) != 0)
+      error(
+          "Error while allocating memory for the displacement in memory for "
+          "the global group link list");
+
+    /* Gather the total number of links on each rank. */
+    MPI_Allgather(&group_link_count, 1, MPI_INT, group_link_counts, 1,
+                  MPI_INT, MPI_COMM_WORLD);
+
+    /* Set the displacements into the global link list using the link counts
+     * from each rank */
+    displ[0] = 0;
+    for (int i = 1; i < e->nr_nodes; i++) {
+      displ[i] = displ[i - 1] + group_link_counts[i - 1];
+      if (displ[i] < 0) error("Number of group links overflowing!");
+    }
+
+    /* Gather the global link list on all ranks. */
+    MPI_Allgatherv(props->group_links, group_link_count, fof_mpi_type,
+                   global_group_links, group_link_counts, displ, fof_mpi_type,
+                   MPI_COMM_WORLD);
+
+    /* Clean up memory. */
+    free(group_link_counts);
+    free(displ);
+    swift_free("fof_group_links", props->group_links);
+    props->group_links = NULL;
+
+    if (verbose) {
+      message(
+          "Global gather: 1 round, %d links, %.3f MB received by each rank.",
+          global_group_link_count,
+          global_group_link_count * sizeof(struct fof_mpi) / (1024. * 1024.));
+
+      message("Communication took: %.3f %s.",
+              clocks_from_ticks(getticks() - comms_tic), clocks_getunit());
+
+      message("Global comms took: %.3f %s.",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
+    }
   }
 
   tic = getticks();
@@ -3895,9 +4203,6 @@ void fof_compute_local_sizes(struct fof_props *props, struct space *s) {
 
   const ticks tic_total = getticks();
 
-  if (engine_rank == 0 && verbose)
-    message("Size of hash table element: %ld", sizeof(hashmap_element_t));
-
 #ifdef WITH_MPI
 
   const ticks comms_tic = getticks();
@@ -3933,6 +4238,77 @@ void fof_compute_local_sizes(struct fof_props *props, struct space *s) {
             clocks_getunit());
 }
 
+/* Local group counts accumulated by fof_count_groups_mapper(). */
+struct fof_group_counts {
+  size_t num_groups;
+  size_t num_parts_in_groups;
+  size_t max_group_size;
+};
+
+/**
+ * @brief Mapper function to count the local groups, the number of particles
+ * in them and the size of the largest one.
+ *
+ * @param map_data The chunk of the group_size array.
+ * @param num_elements Chunk size.
+ * @param extra_data Pointer to the #fof_props.
+ * @param partial The #fof_group_counts of the calling thread.
+ */
+static void fof_count_groups_mapper(void *map_data, int num_elements,
+                                    void *extra_data, void *partial) {
+
+  /* Retrieve mapped data. */
+  const struct fof_props *props = (const struct fof_props *)extra_data;
+  const size_t *restrict group_size = (const size_t *)map_data;
+  const size_t *restrict group_index = props->group_index;
+  const size_t min_group_size = props->min_group_size;
+  struct fof_group_counts *counts = (struct fof_group_counts *)partial;
+
+  /* Offset into the group arrays. */
+  const size_t offset = group_size - props->group_size;
+
+  for (int ind = 0; ind < num_elements; ind++) {
+
+    const size_t i = offset + ind;
+
+    /* Find the largest group. */
+    if (group_size[ind] > counts->max_group_size)
+      counts->max_group_size = group_size[ind];
+
+    if (group_size[ind] < min_group_size) continue;
+
+    /* Find the total number of groups. */
+#ifdef WITH_MPI
+    if (group_index[i] == i + node_offset) counts->num_groups++;
+#else
+    if (group_index[i] == i) counts->num_groups++;
+#endif
+
+    /* Find the total number of particles in groups. */
+    counts->num_parts_in_groups += group_size[ind];
+  }
+}
+
+/**
+ * @brief Reduction function combining the #fof_group_counts of the threads.
+ *
+ * @param result The total #fof_group_counts.
+ * @param partial The #fof_group_counts of one thread.
+ * @param extra_data Unused.
+ */
+static void fof_count_groups_reduce(void *result, const void *partial,
+                                    void *extra_data) {
+
+  struct fof_group_counts *total = (struct fof_group_counts *)result;
+  const struct fof_group_counts *counts =
+      (const struct fof_group_counts *)partial;
+
+  total->num_groups += counts->num_groups;
+  total->num_parts_in_groups += counts->num_parts_in_groups;
+  if (counts->max_group_size > total->max_group_size)
+    total->max_group_size = counts->max_group_size;
+}
+
 /**
  * @brief Compute all the group properties
  *
@@ -3967,36 +4343,21 @@ void fof_compute_group_props(struct fof_props *props,
   const size_t group_id_offset = props->group_id_offset;
   const size_t group_id_default = props->group_id_default;
 
-  size_t num_groups_local = 0;
-  size_t num_parts_in_groups_local = 0;
-  size_t max_group_size_local = 0;
-
   /* Local copy of the arrays */
   size_t *restrict group_index = props->group_index;
   size_t *restrict group_size = props->group_size;
 
   const ticks tic_num_groups_calc = getticks();
 
-  for (size_t i = 0; i < nr_gparts; i++) {
-
-#ifdef WITH_MPI
-    /* Find the total number of groups. */
-    if (group_index[i] == i + node_offset && group_size[i] >= min_group_size)
-      num_groups_local++;
-#else
-    /* Find the total number of groups. */
-    if (group_index[i] == i && group_size[i] >= min_group_size)
-      num_groups_local++;
-#endif
-
-    /* Find the total number of particles in groups. */
-    if (group_size[i] >= min_group_size)
-      num_parts_in_groups_local += group_size[i];
-
-    /* Find the largest group. */
-    if (group_size[i] > max_group_size_local)
-      max_group_size_local = group_size[i];
-  }
+  /* Count the local groups, the particles in them and find the largest */
+  struct fof_group_counts counts = {0, 0, 0};
+  threadpool_map_reduce(&s->e->threadpool, fof_count_groups_mapper,
+                        fof_count_groups_reduce, group_size, nr_gparts,
+                        sizeof(size_t), threadpool_auto_chunk_size, props,
+                        &counts, sizeof(struct fof_group_counts));
+  const size_t num_groups_local = counts.num_groups;
+  const size_t num_parts_in_groups_local = counts.num_parts_in_groups;
+  const size_t max_group_size_local = counts.max_group_size;
 
   if (verbose)
     message(
@@ -4282,6 +4643,10 @@ void fof_compute_group_props(struct fof_props *props,
     message("Computing group properties took: %.3f %s.",
             clocks_from_ticks(getticks() - tic_seeding), clocks_getunit());
 
+  /* Spherical overdensities around the group centres */
+  if (props->compute_so_properties)
+    fof_compute_so_properties(props, s, num_groups_local);
+
   /* Dump group data. */
   if (dump_results) {
 #ifdef HAVE_HDF5
@@ -4321,11 +4686,15 @@ void fof_compute_group_props(struct fof_props *props,
   swift_free("fof_group_first_position", props->group_first_position);
   swift_free("fof_max_part_density_index", props->max_part_density_index);
   swift_free("fof_max_part_density", props->max_part_density);
+  swift_free("fof_so_mass", props->so_mass);
+  swift_free("fof_so_radius", props->so_radius);
   props->group_mass = NULL;
   props->final_group_size = NULL;
   props->group_centre_of_mass = NULL;
   props->max_part_density_index = NULL;
   props->max_part_density = NULL;
+  props->so_mass = NULL;
+  props->so_radius = NULL;
 
   swift_free("fof_distance", props->distance_to_link);
   swift_free("fof_group_index", props->group_index);
@@ -4366,6 +4735,8 @@ void fof_struct_dump(const struct fof_props *props, FILE *stream) {
   temp.group_centre_of_mass = NULL;
   temp.max_part_density_index = NULL;
   temp.max_part_density = NULL;
+  temp.so_mass = NULL;
+  temp.so_radius = NULL;
   temp.group_links = NULL;
 
   restart_write_blocks((void *)&temp, sizeof(struct fof_props), 1, stream,
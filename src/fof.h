@@ -54,6 +54,12 @@ struct fof_props {
   /*! The square of the linking length. */
   double l_x2;
 
+  /*! Merge the fragments spanning several ranks with a tree reduction? */
+  int hierarchical_merge;
+
+  /*! Are we computing the spherical overdensity masses and radii? */
+  int compute_so_properties;
+
   /*! The minimum halo mass for black hole seeding. */
   double seed_halo_mass;
 
@@ -120,6 +126,12 @@ struct fof_props {
   /*! Maximal density of all parts of each group. */
   float *max_part_density;
 
+  /*! Spherical overdensity masses of each group (fof_so_count per group). */
+  double *so_mass;
+
+  /*! Spherical overdensity radii of each group (fof_so_count per group). */
+  double *so_radius;
+
   /* ------------ MPI-related arrays --------------- */
 
   /*! The number of links between pairs of particles on this node and
@@ -28,6 +28,7 @@
 /* Local headers */
 #include "engine.h"
 #include "fof.h"
+#include "fof_so.h"
 #include "hydro_io.h"
 #include "tools.h"
 #include "version.h"
@@ -291,6 +292,45 @@ void write_virtual_fof_hdf5_array(
 #endif
 }
 
+/**
+ * @brief Create the output fields of the mass and radius of one spherical
+ * overdensity.
+ *
+ * @param props The #fof_props.
+ * @param k The index of the overdensity in #fof_so_definitions.
+ * @param fields (return) The mass and radius fields.
+ */
+static void fof_make_so_output_fields(const struct fof_props* props,
+                                      const int k, struct io_props fields[2]) {
+
+  const struct fof_so_definition* def = &fof_so_definitions[k];
+  const char* ref = def->critical ? "critical" : "mean matter";
+
+  /* Sized so that the copy made by io_make_output_field_() never truncates */
+  char name[FIELD_BUFFER_SIZE - 1];
+  char desc[DESCRIPTION_BUFFER_SIZE - 1];
+
+  snprintf(name, sizeof(name), "M%s", def->name);
+  snprintf(desc, sizeof(desc),
+           "Mass within the sphere of mean density %g times the %s density "
+           "around the FOF group centre of mass",
+           def->delta, ref);
+  fields[0] = io_make_output_field_(
+      name, DOUBLE, 1, UNIT_CONV_MASS, 0.f, (char*)(props->so_mass + k),
+      fof_so_count * sizeof(double), desc, /*physical=*/0,
+      /*convertible_to_comoving=*/1);
+
+  snprintf(name, sizeof(name), "R%s", def->name);
+  snprintf(desc, sizeof(desc),
+           "Radius of the sphere of mean density %g times the %s density "
+           "around the FOF group centre of mass",
+           def->delta, ref);
+  fields[1] = io_make_output_field_(
+      name, DOUBLE, 1, UNIT_CONV_LENGTH, 1.f, (char*)(props->so_radius + k),
+      fof_so_count * sizeof(double), desc, /*physical=*/0,
+      /*convertible_to_comoving=*/1);
+}
+
 void write_fof_virtual_file(const struct fof_props* props,
                             const size_t num_groups_total,
                             const long long* N_counts, const struct engine* e) {
@@ -323,6 +363,7 @@ void write_fof_virtual_file(const struct fof_props* props,
   if (h_grp < 0) error("Error while creating groups group.\n");
 
   struct io_props output_prop;
+  struct io_props output_prop_so[2];
   output_prop = io_make_output_field_("Masses", DOUBLE, 1, UNIT_CONV_MASS, 0.f,
                                       (char*)props->group_mass, sizeof(double),
                                       "FOF group masses", /*physical=*/0,
@@ -359,6 +400,18 @@ void write_fof_virtual_file(const struct fof_props* props,
                                compression_write_lossless, e->internal_units,
                                e->snapshot_units);
 
+  /* Spherical overdensity properties */
+  if (props->compute_so_properties) {
+    for (int k = 0; k < fof_so_count; ++k) {
+      fof_make_so_output_fields(props, k, output_prop_so);
+      for (int j = 0; j < 2; ++j)
+        write_virtual_fof_hdf5_array(
+            e, h_grp, file_name_base, "Groups", output_prop_so[j],
+            num_groups_total, N_counts, compression_write_lossless,
+            e->internal_units, e->snapshot_units);
+    }
+  }
+
   /* Close everything */
   H5Gclose(h_grp);
   H5Fclose(h_file);
@@ -571,6 +624,7 @@ void write_fof_hdf5_catalogue(const struct fof_props* props,
   if (h_grp < 0) error("Error while creating groups group.\n");
 
   struct io_props output_prop;
+  struct io_props output_prop_so[2];
   output_prop = io_make_output_field_("Masses", DOUBLE, 1, UNIT_CONV_MASS, 0.f,
                                       (char*)props->group_mass, sizeof(double),
                                       "FOF group masses", /*physical=*/0,
@@ -603,6 +657,17 @@ void write_fof_hdf5_catalogue(const struct fof_props* props,
                        num_groups_local, compression_write_lossless,
                        e->internal_units, e->snapshot_units);
 
+  /* Spherical overdensity properties */
+  if (props->compute_so_properties) {
+    for (int k = 0; k < fof_so_count; ++k) {
+      fof_make_so_output_fields(props, k, output_prop_so);
+      for (int j = 0; j < 2; ++j)
+        write_fof_hdf5_array(e, h_grp, file_name, "Groups", output_prop_so[j],
+                             num_groups_local, compression_write_lossless,
+                             e->internal_units, e->snapshot_units);
+    }
+  }
+
   /* Close everything */
   H5Gclose(h_grp);
   H5Fclose(h_file);
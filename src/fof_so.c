@@ -0,0 +1,719 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+/* Some standard headers. */
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+/* This object's header. */
+#include "fof_so.h"
+
+/* Local headers. */
+#include "active.h"
+#include "cell.h"
+#include "cosmology.h"
+#include "engine.h"
+#include "error.h"
+#include "fof.h"
+#include "memuse.h"
+#include "periodic.h"
+#include "space.h"
+#include "threadpool.h"
+
+#ifdef WITH_FOF
+
+/*! The overdensities computed for each group. */
+const struct fof_so_definition fof_so_definitions[fof_so_count] = {
+    {200., /*critical=*/1, "200crit"},
+    {500., /*critical=*/1, "500crit"},
+    {2500., /*critical=*/1, "2500crit"},
+    {200., /*critical=*/0, "200mean"}};
+
+/*! Factor by which the initial search radius exceeds the radius within which
+ * the FOF mass alone reaches the lowest overdensity. */
+#define fof_so_initial_radius_factor 1.5
+
+/**
+ * @brief A request for all the particles within a sphere.
+ */
+struct fof_so_request {
+
+  /*! Centre of the sphere */
+  double centre[3];
+
+  /*! Radius of the sphere */
+  double radius;
+
+  /*! Local index of the group on the rank that sent the request */
+  long long group;
+};
+
+/**
+ * @brief A particle found within the sphere of a #fof_so_request.
+ */
+struct fof_so_particle {
+
+  /*! Distance to the centre of the sphere */
+  double r;
+
+  /*! Mass of the particle */
+  double mass;
+
+  /*! Local index of the group on the rank that sent the request */
+  long long group;
+};
+
+/**
+ * @brief Range of top-level cells overlapping a sphere along each axis.
+ *
+ * The cells are lo[i], lo[i] + 1, ..., lo[i] + num[i] - 1 modulo cdim[i].
+ *
+ * @param s The #space.
+ * @param centre The centre of the sphere.
+ * @param radius The radius of the sphere.
+ * @param lo (return) The first cell along each axis.
+ * @param num (return) The number of cells along each axis.
+ */
+static void fof_so_top_cell_range(const struct space *s,
+                                  const double centre[3], const double radius,
+                                  int lo[3], int num[3]) {
+
+  for (int i = 0; i < 3; ++i) {
+    int first = (int)floor((centre[i] - radius) * s->iwidth[i]);
+    int last = (int)floor((centre[i] + radius) * s->iwidth[i]);
+
+    if (s->periodic) {
+      if (last - first + 1 >= s->cdim[i]) {
+        first = 0;
+        last = s->cdim[i] - 1;
+      }
+      lo[i] = (first % s->cdim[i] + s->cdim[i]) % s->cdim[i];
+    } else {
+      first = max(first, 0);
+      last = min(last, s->cdim[i] - 1);
+      lo[i] = first;
+    }
+    num[i] = max(last - first + 1, 0);
+  }
+}
+
+/**
+ * @brief Is any part of a #cell within a given distance of a point?
+ *
+ * @param c The #cell.
+ * @param centre The point.
+ * @param r2 The square of the distance.
+ * @param dim The size of the simulation box.
+ * @param periodic Are we using periodic boundary conditions?
+ */
+static int fof_so_cell_overlaps(const struct cell *c, const double centre[3],
+                                const double r2, const double dim[3],
+                                const int periodic) {
+
+  double d2 = 0.;
+  for (int i = 0; i < 3; ++i) {
+    double dx = centre[i] - (c->loc[i] + 0.5 * c->width[i]);
+    if (periodic) dx = nearest(dx, dim[i]);
+    const double d = max(fabs(dx) - 0.5 * c->width[i], 0.);
+    d2 += d * d;
+  }
+  return d2 <= r2;
+}
+
+/**
+ * @brief Recursively collect the particles of a #cell within a sphere.
+ *
+ * @param c The #cell.
+ * @param e The #engine.
+ * @param req The #fof_so_request describing the sphere.
+ * @param r2 The square of the radius of the sphere.
+ * @param parts Array to write the particles to or NULL to only count them.
+ * @param count (in/out) The number of particles found so far.
+ */
+static void fof_so_collect_rec(const struct cell *c, const struct engine *e,
+                               const struct fof_so_request *req,
+                               const double r2, struct fof_so_particle *parts,
+                               size_t *count) {
+
+  const struct space *s = e->s;
+  if (!fof_so_cell_overlaps(c, req->centre, r2, s->dim, s->periodic)) return;
+
+  if (c->split) {
+    for (int k = 0; k < 8; ++k)
+      if (c->progeny[k] != NULL)
+        fof_so_collect_rec(c->progeny[k], e, req, r2, parts, count);
+    return;
+  }
+
+  const struct gpart *gparts = c->grav.parts;
+  for (int j = 0; j < c->grav.count; ++j) {
+    const struct gpart *gp = &gparts[j];
+
+    if (gpart_is_inhibited(gp, e)) continue;
+    if (gp->type == swift_type_neutrino) continue;
+
+    double dx[3];
+    for (int i = 0; i < 3; ++i) {
+      dx[i] = gp->x[i] - req->centre[i];
+      if (s->periodic) dx[i] = nearest(dx[i], s->dim[i]);
+    }
+    const double d2 = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2];
+    if (d2 > r2) continue;
+
+    if (parts != NULL) {
+      parts[*count].r = sqrt(d2);
+      parts[*count].mass = gp->mass;
+      parts[*count].group = req->group;
+    }
+    (*count)++;
+  }
+}
+
+/**
+ * @brief Collect the local particles within the sphere of a request.
+ *
+ * @param e The #engine.
+ * @param req The #fof_so_request.
+ * @param parts Array to write the particles to or NULL to only count them.
+ *
+ * @return The number of particles found.
+ */
+static size_t fof_so_collect(const struct engine *e,
+                             const struct fof_so_request *req,
+                             struct fof_so_particle *parts) {
+
+  const struct space *s = e->s;
+  const double r2 = req->radius * req->radius;
+
+  int lo[3], num[3];
+  fof_so_top_cell_range(s, req->centre, req->radius, lo, num);
+
+  size_t count = 0;
+  for (int ii = 0; ii < num[0]; ++ii) {
+    const int i = (lo[0] + ii) % s->cdim[0];
+    for (int jj = 0; jj < num[1]; ++jj) {
+      const int j = (lo[1] + jj) % s->cdim[1];
+      for (int kk = 0; kk < num[2]; ++kk) {
+        const int k = (lo[2] + kk) % s->cdim[2];
+
+        const struct cell *c = &s->cells_top[cell_getid(s->cdim, i, j, k)];
+        if (c->nodeID != e->nodeID) continue;
+
+        fof_so_collect_rec(c, e, req, r2, parts, &count);
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Data shared by the threads collecting the particles of requests.
+ */
+struct fof_so_collect_data {
+
+  /*! The #engine */
+  const struct engine *e;
+
+  /*! The requests to serve */
+  const struct fof_so_request *requests;
+
+  /*! Number of particles found for each request */
+  size_t *counts;
+
+  /*! Offset of the particles of each request (NULL to only count them) */
+  const size_t *offsets;
+
+  /*! Array to write the particles to */
+  struct fof_so_particle *parts;
+};
+
+/**
+ * @brief Mapper function to count or collect the particles of requests.
+ *
+ * @param map_data The requests to serve.
+ * @param num_elements Chunk size.
+ * @param extra_data Pointer to a #fof_so_collect_data.
+ */
+static void fof_so_collect_mapper(void *map_data, int num_elements,
+                                  void *extra_data) {
+
+  struct fof_so_collect_data *data = (struct fof_so_collect_data *)extra_data;
+  const struct fof_so_request *requests = (struct fof_so_request *)map_data;
+  const ptrdiff_t offset = requests - data->requests;
+
+  for (int i = 0; i < num_elements; ++i) {
+    const size_t ind = offset + i;
+    if (data->offsets == NULL) {
+      data->counts[ind] = fof_so_collect(data->e, &requests[i], NULL);
+    } else {
+      fof_so_collect(data->e, &requests[i], data->parts + data->offsets[ind]);
+    }
+  }
+}
+
+/**
+ * @brief Compare two #fof_so_particle by distance to the centre.
+ */
+static int fof_so_compare_particles(const void *a, const void *b) {
+
+  const struct fof_so_particle *pa = (const struct fof_so_particle *)a;
+  const struct fof_so_particle *pb = (const struct fof_so_particle *)b;
+  return (pa->r > pb->r) - (pa->r < pb->r);
+}
+
+/**
+ * @brief Data shared by the threads computing the SO properties of groups.
+ */
+struct fof_so_evaluate_data {
+
+  /*! The FOF properties to write the SO masses and radii to */
+  struct fof_props *props;
+
+  /*! The particles around each group, sorted by group */
+  struct fof_so_particle *parts;
+
+  /*! Offset of the particles of each group */
+  const size_t *offsets;
+
+  /*! Current search radius of each group */
+  const double *radius;
+
+  /*! The reference densities of each overdensity (comoving) */
+  const double *rho;
+
+  /*! Is each group done? */
+  char *done;
+};
+
+/**
+ * @brief Mapper function to compute the SO properties of groups.
+ *
+ * A spherical overdensity is found when the mean density enclosed within a
+ * particle first drops below the threshold when walking out from the centre.
+ * If it never does, the search radius was too small and the group is left
+ * for the next iteration.
+ *
+ * @param map_data The (local) indices of the groups to process.
+ * @param num_elements Chunk size.
+ * @param extra_data Pointer to a #fof_so_evaluate_data.
+ */
+static void fof_so_evaluate_mapper(void *map_data, int num_elements,
+                                   void *extra_data) {
+
+  struct fof_so_evaluate_data *data = (struct fof_so_evaluate_data *)extra_data;
+  const long long *groups = (long long *)map_data;
+  double *so_mass = data->props->so_mass;
+  double *so_radius = data->props->so_radius;
+
+  for (int ind = 0; ind < num_elements; ++ind) {
+    const long long g = groups[ind];
+    struct fof_so_particle *parts = data->parts + data->offsets[g];
+    const size_t count = data->offsets[g + 1] - data->offsets[g];
+
+    qsort(parts, count, sizeof(struct fof_so_particle),
+          fof_so_compare_particles);
+
+    int found = 0;
+    for (int k = 0; k < fof_so_count; ++k) {
+      const double rho = data->rho[k];
+
+      double mass = 0.;
+      size_t j = 0;
+      for (; j < count; ++j) {
+        const double r = parts[j].r;
+        if (mass + parts[j].mass < rho * (4. * M_PI / 3.) * r * r * r) break;
+        mass += parts[j].mass;
+      }
+
+      /* Did the density drop below the threshold within the sphere? */
+      const double R = data->radius[g];
+      if (j < count || mass < rho * (4. * M_PI / 3.) * R * R * R) {
+        so_mass[g * fof_so_count + k] = mass;
+        so_radius[g * fof_so_count + k] = cbrt(3. * mass / (4. * M_PI * rho));
+        found++;
+      }
+    }
+
+    data->done[g] = (found == fof_so_count);
+  }
+}
+
+/**
+ * @brief List the ranks whose top-level cells overlap a sphere.
+ *
+ * @param s The #space.
+ * @param centre The centre of the sphere.
+ * @param radius The radius of the sphere.
+ * @param rank_seen Scratch array of size nr_nodes, all set to -1 on the first
+ * call.
+ * @param stamp A value unique to this call.
+ * @param ranks (return) The distinct ranks found.
+ *
+ * @return The number of ranks found.
+ */
+static int fof_so_sphere_ranks(const struct space *s, const double centre[3],
+                               const double radius, int *rank_seen,
+                               const int stamp, int *ranks) {
+
+  int lo[3], num[3];
+  fof_so_top_cell_range(s, centre, radius, lo, num);
+
+  int count = 0;
+  for (int ii = 0; ii < num[0]; ++ii) {
+    const int i = (lo[0] + ii) % s->cdim[0];
+    for (int jj = 0; jj < num[1]; ++jj) {
+      const int j = (lo[1] + jj) % s->cdim[1];
+      for (int kk = 0; kk < num[2]; ++kk) {
+        const int k = (lo[2] + kk) % s->cdim[2];
+
+        const int node = s->cells_top[cell_getid(s->cdim, i, j, k)].nodeID;
+        if (rank_seen[node] == stamp) continue;
+        rank_seen[node] = stamp;
+        ranks[count++] = node;
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Turn an array of counts into offsets, checking for overflows.
+ *
+ * @param counts The counts.
+ * @param offsets (return) The offsets, of size n + 1.
+ * @param n The number of counts.
+ */
+static void fof_so_counts_to_offsets(const int *counts, int *offsets,
+                                     const int n) {
+
+  size_t total = 0;
+  for (int i = 0; i < n; ++i) {
+    offsets[i] = (int)total;
+    total += counts[i];
+  }
+  if (total > INT_MAX) error("Too many elements in the SO exchange.");
+  offsets[n] = (int)total;
+}
+
+/**
+ * @brief Compute the spherical overdensity masses and radii of the groups.
+ *
+ * All the particles (bar neutrinos) around the centre of mass of each group
+ * are collected using the cell tree, including those of other ranks, and
+ * sorted by radius. The search radius is doubled until all the overdensities
+ * of the group are found.
+ *
+ * This function must be called by all ranks.
+ *
+ * @param props The FOF properties, with the group masses and centres set.
+ * @param s The #space.
+ * @param num_groups_local The number of groups on this rank.
+ */
+void fof_compute_so_properties(struct fof_props *props, const struct space *s,
+                               const size_t num_groups_local) {
+
+  const ticks tic = getticks();
+  struct engine *e = s->e;
+  const struct cosmology *cosmo = e->cosmology;
+  const int nr_nodes = e->nr_nodes;
+
+  if (!(e->policy & engine_policy_cosmology))
+    error("Spherical overdensities can only be computed in cosmological runs");
+
+  /* Reference densities (comoving) */
+  const double a3 = cosmo->a * cosmo->a * cosmo->a;
+  double rho[fof_so_count];
+  double rho_min = DBL_MAX;
+  for (int k = 0; k < fof_so_count; ++k) {
+    const double ref = fof_so_definitions[k].critical
+                           ? cosmo->critical_density
+                           : cosmo->mean_density_Omega_m;
+    rho[k] = fof_so_definitions[k].delta * ref * a3;
+    rho_min = min(rho_min, rho[k]);
+  }
+
+  /* Largest sphere we can search without seeing a particle twice */
+  double max_radius = DBL_MAX;
+  if (s->periodic) max_radius = 0.5 * min3(s->dim[0], s->dim[1], s->dim[2]);
+
+  /* Allocate the output and the per-group work arrays */
+  const size_t num_groups = num_groups_local;
+  props->so_mass = (double *)swift_malloc(
+      "fof_so_mass", num_groups * fof_so_count * sizeof(double));
+  props->so_radius = (double *)swift_malloc(
+      "fof_so_radius", num_groups * fof_so_count * sizeof(double));
+  double *radius = (double *)malloc(num_groups * sizeof(double));
+  char *done = (char *)malloc(num_groups * sizeof(char));
+  long long *todo = (long long *)malloc(num_groups * sizeof(long long));
+  size_t *offsets = (size_t *)malloc((num_groups + 1) * sizeof(size_t));
+  size_t *cursor = (size_t *)malloc(num_groups * sizeof(size_t));
+  if (props->so_mass == NULL || props->so_radius == NULL || radius == NULL ||
+      done == NULL || todo == NULL || offsets == NULL || cursor == NULL)
+    error("Failed to allocate memory for the SO properties.");
+  bzero(props->so_mass, num_groups * fof_so_count * sizeof(double));
+  bzero(props->so_radius, num_groups * fof_so_count * sizeof(double));
+
+  /* Start with the radius at which the FOF mass alone reaches the lowest
+   * overdensity */
+  long long num_todo = 0;
+  for (size_t g = 0; g < num_groups; ++g) {
+    const double r = fof_so_initial_radius_factor *
+                     cbrt(3. * props->group_mass[g] / (4. * M_PI * rho_min));
+    radius[g] = min(r, max_radius);
+    done[g] = 0;
+    todo[num_todo++] = g;
+  }
+
+  /* Communication counts and offsets */
+  int *rank_seen = (int *)malloc(nr_nodes * sizeof(int));
+  int *ranks = (int *)malloc(nr_nodes * sizeof(int));
+  int *rank_cursor = (int *)malloc(nr_nodes * sizeof(int));
+  int *send_counts = (int *)malloc(nr_nodes * sizeof(int));
+  int *recv_counts = (int *)malloc(nr_nodes * sizeof(int));
+  int *send_offsets = (int *)malloc((nr_nodes + 1) * sizeof(int));
+  int *recv_offsets = (int *)malloc((nr_nodes + 1) * sizeof(int));
+  if (rank_seen == NULL || ranks == NULL || rank_cursor == NULL ||
+      send_counts == NULL || recv_counts == NULL || send_offsets == NULL ||
+      recv_offsets == NULL)
+    error("Failed to allocate the SO communication counts.");
+
+#ifdef WITH_MPI
+  MPI_Datatype request_type, particle_type;
+  if (MPI_Type_contiguous(sizeof(struct fof_so_request), MPI_BYTE,
+                          &request_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&request_type) != MPI_SUCCESS ||
+      MPI_Type_contiguous(sizeof(struct fof_so_particle), MPI_BYTE,
+                          &particle_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&particle_type) != MPI_SUCCESS)
+    error("Failed to create the MPI types for the SO exchange.");
+#endif
+
+  int num_iterations = 0;
+  long long num_failed = 0;
+  long long num_todo_global = num_todo;
+#ifdef WITH_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &num_todo_global, 1, MPI_LONG_LONG_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+#endif
+
+  while (num_todo_global > 0) {
+
+    num_iterations++;
+
+    /* Count the requests to send to each rank */
+    for (int r = 0; r < nr_nodes; ++r) {
+      rank_seen[r] = -1;
+      send_counts[r] = 0;
+    }
+    for (long long t = 0; t < num_todo; ++t) {
+      const long long g = todo[t];
+      const int n =
+          fof_so_sphere_ranks(s, &props->group_centre_of_mass[3 * g],
+                              radius[g], rank_seen, (int)t, ranks);
+      for (int r = 0; r < n; ++r) send_counts[ranks[r]]++;
+    }
+    fof_so_counts_to_offsets(send_counts, send_offsets, nr_nodes);
+
+    /* Build the requests, sorted by destination rank */
+    struct fof_so_request *send_requests = (struct fof_so_request *)malloc(
+        (send_offsets[nr_nodes] + 1) * sizeof(struct fof_so_request));
+    if (send_requests == NULL) error("Failed to allocate the SO requests.");
+    for (int r = 0; r < nr_nodes; ++r) {
+      rank_seen[r] = -1;
+      rank_cursor[r] = send_offsets[r];
+    }
+    for (long long t = 0; t < num_todo; ++t) {
+      const long long g = todo[t];
+      const int n =
+          fof_so_sphere_ranks(s, &props->group_centre_of_mass[3 * g],
+                              radius[g], rank_seen, (int)t, ranks);
+      for (int r = 0; r < n; ++r) {
+        struct fof_so_request *req = &send_requests[rank_cursor[ranks[r]]++];
+        req->centre[0] = props->group_centre_of_mass[3 * g + 0];
+        req->centre[1] = props->group_centre_of_mass[3 * g + 1];
+        req->centre[2] = props->group_centre_of_mass[3 * g + 2];
+        req->radius = radius[g];
+        req->group = g;
+      }
+    }
+
+    /* Send the requests to the ranks holding the cells */
+#ifdef WITH_MPI
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                 MPI_COMM_WORLD);
+#else
+    recv_counts[0] = send_counts[0];
+#endif
+    fof_so_counts_to_offsets(recv_counts, recv_offsets, nr_nodes);
+    const int num_requests = recv_offsets[nr_nodes];
+    struct fof_so_request *requests = (struct fof_so_request *)malloc(
+        (num_requests + 1) * sizeof(struct fof_so_request));
+    if (requests == NULL) error("Failed to allocate the SO requests.");
+#ifdef WITH_MPI
+    MPI_Alltoallv(send_requests, send_counts, send_offsets, request_type,
+                  requests, recv_counts, recv_offsets, request_type,
+                  MPI_COMM_WORLD);
+#else
+    memcpy(requests, send_requests,
+           num_requests * sizeof(struct fof_so_request));
+#endif
+    free(send_requests);
+
+    /* Count the local particles within each requested sphere */
+    size_t *part_counts = (size_t *)malloc((num_requests + 1) * sizeof(size_t));
+    size_t *part_offsets =
+        (size_t *)malloc((num_requests + 1) * sizeof(size_t));
+    if (part_counts == NULL || part_offsets == NULL)
+      error("Failed to allocate the SO particle counts.");
+    struct fof_so_collect_data collect_data = {e, requests, part_counts,
+                                               /*offsets=*/NULL, NULL};
+    threadpool_map(&e->threadpool, fof_so_collect_mapper, requests,
+                   num_requests, sizeof(struct fof_so_request),
+                   threadpool_auto_chunk_size, &collect_data);
+
+    /* The replies to each rank follow the order of its requests */
+    part_offsets[0] = 0;
+    for (int i = 0; i < num_requests; ++i)
+      part_offsets[i + 1] = part_offsets[i] + part_counts[i];
+    for (int r = 0; r < nr_nodes; ++r) {
+      const size_t count = part_offsets[recv_offsets[r + 1]] -
+                           part_offsets[recv_offsets[r]];
+      if (count > INT_MAX) error("Too many particles in the SO exchange.");
+      send_counts[r] = (int)count;
+    }
+    fof_so_counts_to_offsets(send_counts, send_offsets, nr_nodes);
+
+    /* Collect the particles */
+    struct fof_so_particle *send_parts = (struct fof_so_particle *)swift_malloc(
+        "fof_so_parts",
+        (part_offsets[num_requests] + 1) * sizeof(struct fof_so_particle));
+    if (send_parts == NULL) error("Failed to allocate the SO particles.");
+    collect_data.offsets = part_offsets;
+    collect_data.parts = send_parts;
+    threadpool_map(&e->threadpool, fof_so_collect_mapper, requests,
+                   num_requests, sizeof(struct fof_so_request),
+                   threadpool_auto_chunk_size, &collect_data);
+    free(part_counts);
+    free(part_offsets);
+    free(requests);
+
+    /* Send them back to the ranks owning the groups */
+#ifdef WITH_MPI
+    MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT,
+                 MPI_COMM_WORLD);
+#else
+    recv_counts[0] = send_counts[0];
+#endif
+    fof_so_counts_to_offsets(recv_counts, recv_offsets, nr_nodes);
+    const size_t num_parts = recv_offsets[nr_nodes];
+    struct fof_so_particle *recv_parts = (struct fof_so_particle *)swift_malloc(
+        "fof_so_parts", (num_parts + 1) * sizeof(struct fof_so_particle));
+    if (recv_parts == NULL) error("Failed to allocate the SO particles.");
+#ifdef WITH_MPI
+    MPI_Alltoallv(send_parts, send_counts, send_offsets, particle_type,
+                  recv_parts, recv_counts, recv_offsets, particle_type,
+                  MPI_COMM_WORLD);
+#else
+    memcpy(recv_parts, send_parts, num_parts * sizeof(struct fof_so_particle));
+#endif
+
+    /* Sort the received particles by group */
+    bzero(offsets, (num_groups + 1) * sizeof(size_t));
+    for (size_t i = 0; i < num_parts; ++i) offsets[recv_parts[i].group + 1]++;
+    for (size_t g = 0; g < num_groups; ++g) {
+      offsets[g + 1] += offsets[g];
+      cursor[g] = offsets[g];
+    }
+    for (size_t i = 0; i < num_parts; ++i)
+      send_parts[cursor[recv_parts[i].group]++] = recv_parts[i];
+    swift_free("fof_so_parts", recv_parts);
+
+    /* Find the overdensities */
+    struct fof_so_evaluate_data evaluate_data = {props, send_parts, offsets,
+                                                 radius, rho, done};
+    threadpool_map(&e->threadpool, fof_so_evaluate_mapper, todo, num_todo,
+                   sizeof(long long), threadpool_auto_chunk_size,
+                   &evaluate_data);
+    swift_free("fof_so_parts", send_parts);
+
+    /* Grow the spheres of the groups that are not done yet */
+    long long num_left = 0;
+    for (long long t = 0; t < num_todo; ++t) {
+      const long long g = todo[t];
+      if (done[g]) continue;
+      if (radius[g] >= max_radius) {
+        num_failed++;
+        continue;
+      }
+      radius[g] = min(2. * radius[g], max_radius);
+      todo[num_left++] = g;
+    }
+    num_todo = num_left;
+
+    num_todo_global = num_todo;
+#ifdef WITH_MPI
+    MPI_Allreduce(MPI_IN_PLACE, &num_todo_global, 1, MPI_LONG_LONG_INT,
+                  MPI_SUM, MPI_COMM_WORLD);
+#endif
+  }
+
+#ifdef WITH_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &num_failed, 1, MPI_LONG_LONG_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+  MPI_Type_free(&request_type);
+  MPI_Type_free(&particle_type);
+#endif
+
+  if (num_failed > 0 && e->nodeID == 0)
+    warning(
+        "Could not find all the spherical overdensities of %lld groups within "
+        "half the box size.",
+        num_failed);
+
+  free(radius);
+  free(done);
+  free(todo);
+  free(offsets);
+  free(cursor);
+  free(rank_seen);
+  free(ranks);
+  free(rank_cursor);
+  free(send_counts);
+  free(recv_counts);
+  free(send_offsets);
+  free(recv_offsets);
+
+  if (e->verbose)
+    message("Computing SO properties took %.3f %s (%d iterations).",
+            clocks_from_ticks(getticks() - tic), clocks_getunit(),
+            num_iterations);
+}
+
+#endif /* WITH_FOF */
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_FOF_SO_H
+#define SWIFT_FOF_SO_H
+
+/* Config parameters. */
+#include <config.h>
+
+/* Standard headers */
+#include <stddef.h>
+
+/* Avoid cyclic inclusions */
+struct fof_props;
+struct space;
+
+/*! Number of spherical overdensities computed for each group */
+#define fof_so_count 4
+
+/**
+ * @brief The definition of a spherical overdensity.
+ */
+struct fof_so_definition {
+
+  /*! Overdensity with respect to the reference density */
+  double delta;
+
+  /*! Is the reference the critical density (1) or the mean matter density? */
+  int critical;
+
+  /*! Suffix used for the names of the output fields */
+  const char *name;
+};
+
+extern const struct fof_so_definition fof_so_definitions[fof_so_count];
+
+void fof_compute_so_properties(struct fof_props *props, const struct space *s,
+                               const size_t num_groups_local);
+
+#endif /* SWIFT_FOF_SO_H */
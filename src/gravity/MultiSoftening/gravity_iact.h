@@ -123,6 +123,93 @@ runner_iact_grav_pp_truncated(const float r2, const float h2, const float h_inv,
   *pot_ij *= corr_pot_lr;
 }
 
+#if defined(WITH_VECTORIZATION) && defined(VEC_HAVE_LDEXP) && \
+    !defined(GADGET2_SOFTENING_CORRECTION)
+
+/**
+ * @brief Computes the intensity of the force and the potential generated by
+ * a vector of point-masses.
+ *
+ * Vector version of runner_iact_grav_pp_full(). The softened kernel is only
+ * evaluated if at least one of the pairs is closer than its softening length.
+ *
+ * @param r2 Square of the distances to the point-masses.
+ * @param h2 Square of the softening lengths.
+ * @param h_inv Inverse of the softening lengths.
+ * @param h_inv3 Cube of the inverse of the softening lengths.
+ * @param mass Masses of the point-masses.
+ * @param f_ij (return) The force intensities.
+ * @param pot_ij (return) The potentials.
+ */
+__attribute__((always_inline)) INLINE static void runner_iact_grav_pp_full_vec(
+    const vector *r2, const vector *h2, const vector *h_inv,
+    const vector *h_inv3, const vector *mass, vector *f_ij, vector *pot_ij) {
+
+  /* Get the inverse distance */
+  vector r2_safe, r_inv, r_inv3;
+  r2_safe.v = vec_add(r2->v, vec_set1(FLT_MIN));
+  r_inv = vec_reciprocal_sqrt(r2_safe);
+  r_inv3.v = vec_mul(r_inv.v, vec_mul(r_inv.v, r_inv.v));
+
+  /* Get Newtonian gravity */
+  f_ij->v = vec_mul(mass->v, r_inv3.v);
+  pot_ij->v = vec_mul(vec_set1(-1.f), vec_mul(mass->v, r_inv.v));
+
+  /* Should we soften ? */
+  mask_t soften;
+  vec_create_mask(soften, vec_cmp_lt(r2->v, h2->v));
+  if (vec_is_mask_true(soften)) {
+
+    /* The kernel is only used for u < 1; clamp to avoid overflows */
+    vector ui, W_pot_ij, W_f_ij, f_soft, pot_soft;
+    ui.v = vec_mul(vec_mul(r2->v, r_inv.v), h_inv->v);
+    ui.v = vec_fmin(ui.v, vec_set1(1.f));
+    kernel_grav_eval_vec(&ui, &W_pot_ij, &W_f_ij);
+
+    /* Get softened gravity */
+    f_soft.v = vec_mul(mass->v, vec_mul(h_inv3->v, W_f_ij.v));
+    pot_soft.v = vec_mul(mass->v, vec_mul(h_inv->v, W_pot_ij.v));
+
+    f_ij->v = vec_blend(soften, f_ij->v, f_soft.v);
+    pot_ij->v = vec_blend(soften, pot_ij->v, pot_soft.v);
+  }
+}
+
+/**
+ * @brief Computes the intensity of the force and the potential generated by
+ * a vector of point-masses truncated for long-distance periodicity.
+ *
+ * Vector version of runner_iact_grav_pp_truncated().
+ *
+ * @param r2 Square of the distances to the point-masses.
+ * @param h2 Square of the softening lengths.
+ * @param h_inv Inverse of the softening lengths.
+ * @param h_inv3 Cube of the inverse of the softening lengths.
+ * @param mass Masses of the point-masses.
+ * @param r_s_inv Inverse of the mesh smoothing scale.
+ * @param f_ij (return) The force intensities.
+ * @param pot_ij (return) The potentials.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_grav_pp_truncated_vec(const vector *r2, const vector *h2,
+                                  const vector *h_inv, const vector *h_inv3,
+                                  const vector *mass, const float r_s_inv,
+                                  vector *f_ij, vector *pot_ij) {
+
+  /* Start with the non-truncated interaction */
+  runner_iact_grav_pp_full_vec(r2, h2, h_inv, h_inv3, mass, f_ij, pot_ij);
+
+  /* Get long-range correction */
+  vector r2_safe, u_lr, corr_f_lr, corr_pot_lr;
+  r2_safe.v = vec_add(r2->v, vec_set1(FLT_MIN));
+  u_lr.v = vec_mul(vec_sqrt(r2_safe.v), vec_set1(r_s_inv));
+  kernel_long_grav_eval_vec(&u_lr, &corr_f_lr, &corr_pot_lr);
+  f_ij->v = vec_mul(f_ij->v, corr_f_lr.v);
+  pot_ij->v = vec_mul(pot_ij->v, corr_pot_lr.v);
+}
+
+#endif /* WITH_VECTORIZATION && VEC_HAVE_LDEXP */
+
 /**
  * @brief Computes the forces at a point generated by a multipole.
  *
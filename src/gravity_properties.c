@@ -33,6 +33,7 @@
 #include "gravity.h"
 #include "kernel_gravity.h"
 #include "kernel_long_gravity.h"
+#include "mesh_assignment.h"
 #include "restart.h"
 
 #define gravity_props_default_a_smooth 1.25f
@@ -71,8 +72,55 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
     p->distributed_mesh =
         parser_get_opt_param_int(params, "Gravity:distributed_mesh",
                                  gravity_props_default_distributed_mesh);
-    p->mesh_uses_local_patches =
-        parser_get_opt_param_int(params, "Gravity:mesh_uses_local_patches", 1);
+
+    /* Read how the distributed mesh is split between the MPI ranks */
+    char decomposition[32] = {0};
+    parser_get_opt_param_string(params,
+                                "Gravity:distributed_mesh_decomposition",
+                                decomposition, "slabs");
+    if (strcmp(decomposition, "slabs") == 0) {
+      p->distributed_mesh_pencils = 0;
+    } else if (strcmp(decomposition, "pencils") == 0) {
+      p->distributed_mesh_pencils = 1;
+    } else {
+      error(
+          "Invalid choice of distributed mesh decomposition: '%s'. Should be "
+          "'slabs' or 'pencils'",
+          decomposition);
+    }
+
+    p->mesh_uses_private_tiles =
+        parser_get_opt_param_int(params, "Gravity:mesh_uses_private_tiles", 0);
+    p->mesh_uses_local_patches = parser_get_opt_param_int(
+        params, "Gravity:mesh_uses_local_patches", !p->mesh_uses_private_tiles);
+
+    /* Read the rigour with which FFTW searches for the fastest plan */
+    char planner[32] = {0};
+    parser_get_opt_param_string(params, "Gravity:mesh_fftw_planner", planner,
+                                "measure");
+    if (strcmp(planner, "estimate") == 0) {
+      p->mesh_fftw_planner = 0;
+    } else if (strcmp(planner, "measure") == 0) {
+      p->mesh_fftw_planner = 1;
+    } else if (strcmp(planner, "patient") == 0) {
+      p->mesh_fftw_planner = 2;
+    } else {
+      error(
+          "Invalid choice of FFTW planner: '%s'. Should be 'estimate', "
+          "'measure', or 'patient'",
+          planner);
+    }
+
+    /* Read the mass assignment window and whether to interlace */
+    char window[32] = {0};
+    parser_get_opt_param_string(params, "Gravity:mesh_assignment", window,
+                                "CIC");
+    p->mesh_assignment_order = mesh_assignment_order_from_name(window);
+    if (p->mesh_assignment_order < 2)
+      error("The NGP window cannot be used for the gravity mesh.");
+    p->mesh_interlacing =
+        parser_get_opt_param_int(params, "Gravity:mesh_interlacing", 0);
+
     p->a_smooth = parser_get_opt_param_float(params, "Gravity:a_smooth",
                                              gravity_props_default_a_smooth);
     p->r_cut_max_ratio = parser_get_opt_param_float(
@@ -90,13 +138,31 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
     if (p->a_smooth <= 0.)
       error("The mesh smoothing scale 'a_smooth' must be > 0.");
 
-#if !defined(WITH_MPI) || !defined(HAVE_MPI_FFTW)
+#if !defined(WITH_MPI)
     if (p->distributed_mesh)
       error(
           "Need to use MPI and FFTW MPI library (i.e. compile with "
           "--enable-mpi-mesh-gravity) to run with distributed mesh.");
+#elif !defined(HAVE_MPI_FFTW)
+    if (p->distributed_mesh && !p->distributed_mesh_pencils)
+      error(
+          "Need to use the FFTW MPI library (i.e. compile with "
+          "--enable-mpi-mesh-gravity) to run with a slab-decomposed "
+          "distributed mesh. Use distributed_mesh_decomposition: pencils "
+          "instead.");
 #endif
 
+    if (p->mesh_uses_private_tiles && p->mesh_uses_local_patches)
+      error(
+          "The mesh assignment can use either private tiles or local patches "
+          "but not both. Set Gravity:mesh_uses_local_patches to 0 to use the "
+          "private tiles.");
+
+    if (p->mesh_uses_private_tiles && p->distributed_mesh)
+      error(
+          "Private mesh tiles are only available for the non-distributed "
+          "mesh. Set Gravity:mesh_uses_private_tiles to 0.");
+
     if (2. * p->a_smooth * p->r_cut_max_ratio > p->mesh_size)
       error("Mesh too small given r_cut_max. Should be at least %d cells wide.",
             (int)(2. * p->a_smooth * p->r_cut_max_ratio) + 1);
@@ -110,6 +176,11 @@ void gravity_props_init(struct gravity_props *p, struct swift_params *params,
   } else {
     p->mesh_size = 0;
     p->distributed_mesh = 0;
+    p->distributed_mesh_pencils = 0;
+    p->mesh_uses_private_tiles = 0;
+    p->mesh_fftw_planner = 0;
+    p->mesh_assignment_order = 0;
+    p->mesh_interlacing = 0;
     p->a_smooth = 0.f;
     p->r_s = FLT_MAX;
     p->r_s_inv = 0.f;
@@ -371,7 +442,17 @@ void gravity_props_print(const struct gravity_props *p) {
 
   message("Self-gravity mesh side-length: N=%d", p->mesh_size);
   message("Self-gravity mesh smoothing-scale: a_smooth=%f", p->a_smooth);
-  message("Self-gravity distributed mesh enabled: %d", p->distributed_mesh);
+  message("Self-gravity distributed mesh enabled: %d (decomposition: %s)",
+          p->distributed_mesh,
+          p->distributed_mesh_pencils ? "pencils" : "slabs");
+  message("Self-gravity mesh deposit uses private tiles: %d",
+          p->mesh_uses_private_tiles);
+  message("Self-gravity mesh FFTW planner: %s",
+          p->mesh_fftw_planner == 2
+              ? "patient"
+              : (p->mesh_fftw_planner == 1 ? "measure" : "estimate"));
+  message("Self-gravity mesh assignment window: %s (interlacing: %d)",
+          mesh_assignment_name(p->mesh_assignment_order), p->mesh_interlacing);
 
   message("Self-gravity tree cut-off ratio: r_cut_max=%f", p->r_cut_max_ratio);
   message("Self-gravity truncation cut-off ratio: r_cut_min=%f",
@@ -446,6 +527,9 @@ void gravity_props_print_snapshot(hid_t h_grpgrav,
   io_write_attribute_f(h_grpgrav, "Mesh a_smooth", p->a_smooth);
   io_write_attribute_f(h_grpgrav, "Mesh r_cut_max ratio", p->r_cut_max_ratio);
   io_write_attribute_f(h_grpgrav, "Mesh r_cut_min ratio", p->r_cut_min_ratio);
+  io_write_attribute_s(h_grpgrav, "Mesh assignment window",
+                       mesh_assignment_name(p->mesh_assignment_order));
+  io_write_attribute_i(h_grpgrav, "Mesh interlacing", p->mesh_interlacing);
   io_write_attribute_f(h_grpgrav, "Tree update frequency",
                        p->rebuild_frequency);
   io_write_attribute_s(h_grpgrav, "Mesh truncation function",
@@ -134,10 +134,29 @@ struct gravity_props {
   /*! Whether mesh is distributed between MPI ranks when we use MPI  */
   int distributed_mesh;
 
+  /*! Is the distributed mesh split in pencils (1) rather than slabs (0)? */
+  int distributed_mesh_pencils;
+
   /*! Whether or not to use local patches rather than
    * direct atomic writes to the mesh when running without MPI */
   int mesh_uses_local_patches;
 
+  /*! Whether or not to deposit the mass into one private tile per top-level
+   * cell and reduce them without atomics in a deterministic order */
+  int mesh_uses_private_tiles;
+
+  /*! Rigour of the FFTW planner used for the mesh FFTs
+   * (0: estimate, 1: measure, 2: patient) */
+  int mesh_fftw_planner;
+
+  /*! Order of the mass assignment window used by the mesh
+   * (2: CIC, 3: TSC, 4: PCS) */
+  int mesh_assignment_order;
+
+  /*! Do we also assign the mass to a mesh shifted by half a cell and average
+   * the two in Fourier space? */
+  int mesh_interlacing;
+
   /*! Mesh smoothing scale in units of top-level cell size */
   float a_smooth;
 
@@ -28,6 +28,7 @@
 
 #include "adaptive_softening_iact.h"
 #include "adiabatic_index.h"
+#include "cache.h"
 #include "hydro_parameters.h"
 #include "minmax.h"
 #include "signal_velocity.h"
@@ -618,4 +619,296 @@ __attribute__((always_inline)) INLINE static void runner_iact_nonsym_force(
 #endif
 }
 
+#ifdef WITH_VECTORIZATION
+
+/**
+ * @brief Density interaction computed using 1 vector
+ * (non-symmetric vectorized version).
+ *
+ * Identical to the Gadget-2 version; the velocity divergence sum is stored
+ * in the viscosity sub-structure by the caller.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_1_vec_density(vector *r2, vector *dx, vector *dy, vector *dz,
+                                 vector hi_inv, vector vix, vector viy,
+                                 vector viz, float *Vjx, float *Vjy, float *Vjz,
+                                 float *Mj, vector *rhoSum, vector *rho_dhSum,
+                                 vector *wcountSum, vector *wcount_dhSum,
+                                 vector *div_vSum, vector *curlvxSum,
+                                 vector *curlvySum, vector *curlvzSum,
+                                 mask_t mask) {
+
+  vector r, ri, ui, wi, wi_dx;
+  vector dvx, dvy, dvz;
+  vector dvdr;
+  vector curlvrx, curlvry, curlvrz;
+
+  /* Fill the vectors. */
+  const vector mj = vector_load(Mj);
+  const vector vjx = vector_load(Vjx);
+  const vector vjy = vector_load(Vjy);
+  const vector vjz = vector_load(Vjz);
+
+  /* Get the radius and inverse radius. */
+  ri = vec_reciprocal_sqrt(*r2);
+  r.v = vec_mul(r2->v, ri.v);
+
+  ui.v = vec_mul(r.v, hi_inv.v);
+
+  /* Calculate the kernel. */
+  kernel_deval_1_vec(&ui, &wi, &wi_dx);
+
+  /* Compute dv. */
+  dvx.v = vec_sub(vix.v, vjx.v);
+  dvy.v = vec_sub(viy.v, vjy.v);
+  dvz.v = vec_sub(viz.v, vjz.v);
+
+  /* Compute dv dot r */
+  dvdr.v = vec_fma(dvx.v, dx->v, vec_fma(dvy.v, dy->v, vec_mul(dvz.v, dz->v)));
+  dvdr.v = vec_mul(dvdr.v, ri.v);
+
+  /* Compute dv cross r */
+  curlvrx.v = vec_fnma(dvz.v, dy->v, vec_mul(dvy.v, dz->v));
+  curlvry.v = vec_fnma(dvx.v, dz->v, vec_mul(dvz.v, dx->v));
+  curlvrz.v = vec_fnma(dvy.v, dx->v, vec_mul(dvx.v, dy->v));
+  curlvrx.v = vec_mul(curlvrx.v, ri.v);
+  curlvry.v = vec_mul(curlvry.v, ri.v);
+  curlvrz.v = vec_mul(curlvrz.v, ri.v);
+
+  vector wcount_dh_update;
+  wcount_dh_update.v =
+      vec_fma(vec_set1(hydro_dimension), wi.v, vec_mul(ui.v, wi_dx.v));
+
+  /* Mask updates to intermediate vector sums for particle pi. */
+  rhoSum->v = vec_mask_add(rhoSum->v, vec_mul(mj.v, wi.v), mask);
+  rho_dhSum->v =
+      vec_mask_sub(rho_dhSum->v, vec_mul(mj.v, wcount_dh_update.v), mask);
+  wcountSum->v = vec_mask_add(wcountSum->v, wi.v, mask);
+  wcount_dhSum->v = vec_mask_sub(wcount_dhSum->v, wcount_dh_update.v, mask);
+  div_vSum->v =
+      vec_mask_sub(div_vSum->v, vec_mul(mj.v, vec_mul(dvdr.v, wi_dx.v)), mask);
+  curlvxSum->v = vec_mask_add(curlvxSum->v,
+                              vec_mul(mj.v, vec_mul(curlvrx.v, wi_dx.v)), mask);
+  curlvySum->v = vec_mask_add(curlvySum->v,
+                              vec_mul(mj.v, vec_mul(curlvry.v, wi_dx.v)), mask);
+  curlvzSum->v = vec_mask_add(curlvzSum->v,
+                              vec_mul(mj.v, vec_mul(curlvrz.v, wi_dx.v)), mask);
+}
+
+/**
+ * @brief Gradient interaction computed using 1 vector
+ * (non-symmetric vectorized version).
+ *
+ * Accumulates the maximal signal velocity, the Laplacian of the internal
+ * energy and the maximal neighbour viscosity parameter of particle i.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_1_vec_gradient(
+    vector *r2, vector *dx, vector *dy, vector *dz, vector hi_inv, vector vix,
+    vector viy, vector viz, vector ui, vector ci, float *Vjx, float *Vjy,
+    float *Vjz, float *Mj, float *Rhoj, float *Uj, float *Cj,
+    float *Alpha_viscj, const float a, const float H, vector *v_sigMax,
+    vector *laplace_uSum, vector *alpha_visc_max_ngbMax, mask_t mask) {
+
+  vector r, ri, xi, wi_dx;
+  vector dvx, dvy, dvz, dvdr_Hubble;
+  vector mu_ij, v_sig, laplace_u;
+
+  /* Fill the vectors. */
+  const vector vjx = vector_load(Vjx);
+  const vector vjy = vector_load(Vjy);
+  const vector vjz = vector_load(Vjz);
+  const vector mj = vector_load(Mj);
+  const vector rhoj = vector_load(Rhoj);
+  const vector uj = vector_load(Uj);
+  const vector cj = vector_load(Cj);
+  const vector alpha_j = vector_load(Alpha_viscj);
+
+  /* Cosmological terms */
+  const float fac_mu = pow_three_gamma_minus_five_over_two(a);
+  const float a2_Hubble = a * a * H;
+
+  /* Get the radius and inverse radius. */
+  ri = vec_reciprocal_sqrt(*r2);
+  r.v = vec_mul(r2->v, ri.v);
+
+  /* Compute dv dot r, including the Hubble flow. */
+  dvx.v = vec_sub(vix.v, vjx.v);
+  dvy.v = vec_sub(viy.v, vjy.v);
+  dvz.v = vec_sub(viz.v, vjz.v);
+  dvdr_Hubble.v =
+      vec_fma(dvx.v, dx->v, vec_fma(dvy.v, dy->v, vec_mul(dvz.v, dz->v)));
+  dvdr_Hubble.v = vec_fma(vec_set1(a2_Hubble), r2->v, dvdr_Hubble.v);
+
+  /* Are the particles moving towards each others ? (0 or negative) */
+  mu_ij.v = vec_mul(vec_set1(fac_mu),
+                    vec_mul(ri.v, vec_fmin(dvdr_Hubble.v, vec_setzero())));
+
+  /* Signal velocity */
+  v_sig.v =
+      vec_fnma(vec_set1(const_viscosity_beta), mu_ij.v, vec_add(ci.v, cj.v));
+
+  /* Kernel gradient for hi (without the h^-(d+1) factor). */
+  xi.v = vec_mul(r.v, hi_inv.v);
+  kernel_eval_dWdx_force_vec(&xi, &wi_dx);
+
+  /* Del^2 u for the thermal diffusion coefficient. */
+  laplace_u.v = vec_div(
+      vec_mul(mj.v, vec_mul(vec_mul(vec_sub(ui.v, uj.v), ri.v), wi_dx.v)),
+      rhoj.v);
+
+  /* Mask updates to intermediate vector sums for particle pi. */
+  v_sigMax->v = vec_fmax(v_sigMax->v, vec_and_mask(v_sig.v, mask));
+  laplace_uSum->v = vec_mask_add(laplace_uSum->v, laplace_u.v, mask);
+  alpha_visc_max_ngbMax->v =
+      vec_fmax(alpha_visc_max_ngbMax->v, vec_and_mask(alpha_j.v, mask));
+}
+
+/**
+ * @brief Force interaction computed using 1 vector
+ * (non-symmetric vectorized version).
+ *
+ * Includes the artificial viscosity and the artificial conduction terms.
+ */
+__attribute__((always_inline)) INLINE static void
+runner_iact_nonsym_1_vec_force(
+    vector *r2, vector *dx, vector *dy, vector *dz, vector vix, vector viy,
+    vector viz, vector pirho, vector grad_hi, vector pressurei,
+    vector balsara_i, vector ci, vector ui, vector alpha_visc_i,
+    vector alpha_diff_i, vector mi, float *Vjx, float *Vjy, float *Vjz,
+    float *Pjrho, float *Grad_hj, float *Pressurej, float *Balsara_j,
+    float *Cj, float *Uj, float *Alpha_viscj, float *Alpha_diffj, float *Mj,
+    vector hi_inv, vector hj_inv, const float a, const float H,
+    vector *a_hydro_xSum, vector *a_hydro_ySum, vector *a_hydro_zSum,
+    vector *h_dtSum, vector *u_dtSum, mask_t mask) {
+
+  vector r, ri, xi, xj;
+  vector hid_inv, hjd_inv;
+  vector wi_dx, wj_dx, wi_dr, wj_dr;
+  vector dvx, dvy, dvz, dvdr, dvdr_Hubble, mu_ij, v_sig;
+  vector f_ij, f_ji, rho_ij, visc, visc_acc_term;
+  vector P_over_rho2_i, P_over_rho2_j, acc;
+  vector du_dt, alpha_diff, v_diff;
+
+  /* Fill the vectors. */
+  const vector vjx = vector_load(Vjx);
+  const vector vjy = vector_load(Vjy);
+  const vector vjz = vector_load(Vjz);
+  const vector mj = vector_load(Mj);
+  const vector pjrho = vector_load(Pjrho);
+  const vector grad_hj = vector_load(Grad_hj);
+  const vector pressurej = vector_load(Pressurej);
+  const vector balsara_j = vector_load(Balsara_j);
+  const vector cj = vector_load(Cj);
+  const vector uj = vector_load(Uj);
+  const vector alpha_visc_j = vector_load(Alpha_viscj);
+  const vector alpha_diff_j = vector_load(Alpha_diffj);
+
+  /* Cosmological terms */
+  const float fac_mu = pow_three_gamma_minus_five_over_two(a);
+  const float a2_Hubble = a * a * H;
+  const vector v_fac_mu = vector_set1(fac_mu);
+
+  /* Get the radius and inverse radius. */
+  ri = vec_reciprocal_sqrt(*r2);
+  r.v = vec_mul(r2->v, ri.v);
+
+  /* Get the kernel for hi. */
+  hid_inv = pow_dimension_plus_one_vec(hi_inv);
+  xi.v = vec_mul(r.v, hi_inv.v);
+  kernel_eval_dWdx_force_vec(&xi, &wi_dx);
+  wi_dr.v = vec_mul(hid_inv.v, wi_dx.v);
+
+  /* Get the kernel for hj. */
+  hjd_inv = pow_dimension_plus_one_vec(hj_inv);
+  xj.v = vec_mul(r.v, hj_inv.v);
+  kernel_eval_dWdx_force_vec(&xj, &wj_dx);
+  wj_dr.v = vec_mul(hjd_inv.v, wj_dx.v);
+
+  /* Compute dv dot r. */
+  dvx.v = vec_sub(vix.v, vjx.v);
+  dvy.v = vec_sub(viy.v, vjy.v);
+  dvz.v = vec_sub(viz.v, vjz.v);
+  dvdr.v = vec_fma(dvx.v, dx->v, vec_fma(dvy.v, dy->v, vec_mul(dvz.v, dz->v)));
+
+  /* Includes the hubble flow term; not used for du/dt */
+  dvdr_Hubble.v = vec_fma(vec_set1(a2_Hubble), r2->v, dvdr.v);
+
+  /* Are the particles moving towards each others ? (0 or negative) */
+  mu_ij.v = vec_mul(v_fac_mu.v,
+                    vec_mul(ri.v, vec_fmin(dvdr_Hubble.v, vec_setzero())));
+
+  /* Compute sound speeds and signal velocity */
+  v_sig.v =
+      vec_fnma(vec_set1(const_viscosity_beta), mu_ij.v, vec_add(ci.v, cj.v));
+
+  /* Variable smoothing length term */
+  f_ij.v = vec_sub(vec_set1(1.f), vec_div(grad_hi.v, mj.v));
+  f_ji.v = vec_sub(vec_set1(1.f), vec_div(grad_hj.v, mi.v));
+
+  /* Construct the full viscosity term */
+  rho_ij.v = vec_add(pirho.v, pjrho.v);
+  visc.v = vec_div(
+      vec_mul(vec_set1(-0.25f),
+              vec_mul(vec_add(alpha_visc_i.v, alpha_visc_j.v),
+                      vec_mul(vec_mul(v_sig.v, mu_ij.v),
+                              vec_add(balsara_i.v, balsara_j.v)))),
+      rho_ij.v);
+
+  /* Convolve with the kernel */
+  visc_acc_term.v =
+      vec_mul(vec_set1(0.5f),
+              vec_mul(visc.v, vec_mul(vec_fma(wi_dr.v, f_ij.v,
+                                              vec_mul(wj_dr.v, f_ji.v)),
+                                      ri.v)));
+
+  /* Compute gradient terms */
+  P_over_rho2_i.v =
+      vec_mul(vec_div(pressurei.v, vec_mul(pirho.v, pirho.v)), f_ij.v);
+  P_over_rho2_j.v =
+      vec_mul(vec_div(pressurej.v, vec_mul(pjrho.v, pjrho.v)), f_ji.v);
+
+  /* Assemble the acceleration */
+  acc.v = vec_fma(vec_fma(P_over_rho2_i.v, wi_dr.v,
+                          vec_mul(P_over_rho2_j.v, wj_dr.v)),
+                  ri.v, visc_acc_term.v);
+
+  /* Diffusion term, using the pressure-weighted diffusion parameter. */
+  alpha_diff.v = vec_div(vec_fma(pressurei.v, alpha_diff_i.v,
+                                 vec_mul(pressurej.v, alpha_diff_j.v)),
+                         vec_add(pressurei.v, pressurej.v));
+  v_diff.v = vec_mul(
+      vec_mul(alpha_diff.v, vec_set1(0.5f)),
+      vec_add(vec_sqrt(vec_div(
+                  vec_mul(vec_set1(2.f), vec_fabs(vec_sub(pressurei.v,
+                                                          pressurej.v))),
+                  rho_ij.v)),
+              vec_fabs(vec_mul(v_fac_mu.v, vec_mul(ri.v, dvdr_Hubble.v)))));
+
+  /* Assemble the energy equation term: SPH, viscosity and diffusion. */
+  du_dt.v = vec_mul(P_over_rho2_i.v, vec_mul(vec_mul(dvdr.v, ri.v), wi_dr.v));
+  du_dt.v = vec_fma(vec_mul(vec_set1(0.5f), visc_acc_term.v), dvdr_Hubble.v,
+                    du_dt.v);
+  du_dt.v = vec_fma(
+      vec_mul(v_diff.v, vec_sub(ui.v, uj.v)),
+      vec_add(vec_div(vec_mul(f_ij.v, wi_dr.v), pirho.v),
+              vec_div(vec_mul(f_ji.v, wj_dr.v), pjrho.v)),
+      du_dt.v);
+
+  /* Store the forces back on the particles. */
+  a_hydro_xSum->v =
+      vec_mask_sub(a_hydro_xSum->v, vec_mul(mj.v, vec_mul(acc.v, dx->v)), mask);
+  a_hydro_ySum->v =
+      vec_mask_sub(a_hydro_ySum->v, vec_mul(mj.v, vec_mul(acc.v, dy->v)), mask);
+  a_hydro_zSum->v =
+      vec_mask_sub(a_hydro_zSum->v, vec_mul(mj.v, vec_mul(acc.v, dz->v)), mask);
+  u_dtSum->v = vec_mask_add(u_dtSum->v, vec_mul(du_dt.v, mj.v), mask);
+  h_dtSum->v = vec_mask_sub(
+      h_dtSum->v,
+      vec_div(vec_mul(mj.v, vec_mul(vec_mul(dvdr.v, ri.v), wi_dr.v)), pjrho.v),
+      mask);
+}
+
+#endif /* WITH_VECTORIZATION */
+
 #endif /* SWIFT_SPHENIX_HYDRO_IACT_H */
@@ -312,4 +312,51 @@ struct part {
 
 } SWIFT_STRUCT_ALIGN;
 
+#ifndef SWIFT_HYDRO_DENSITY_CHECKS
+
+/* Fields of the #part sent to the foreign copies of the particles by the
+ * packed hydro halo exchanges (see cell_pack_parts()). Any field omitted from
+ * a stage must not be read by the foreign rank after that stage. */
+
+/**
+ * @brief Fields of the #part sent by the xv exchange.
+ *
+ * Everything read by the neighbour loops, including the force-loop quantities
+ * of the inactive particles that are not updated by the later exchanges.
+ * The density and force structures share their memory and have the same size.
+ */
+#ifdef SWIFT_DEBUG_CHECKS
+#define hydro_part_pack_xv(FIELD)                                             \
+  FIELD(id) FIELD(x) FIELD(v) FIELD(mass) FIELD(h) FIELD(u) FIELD(rho)       \
+  FIELD(viscosity) FIELD(diffusion) FIELD(force) FIELD(time_bin)             \
+  FIELD(ti_drift) FIELD(ti_kick)
+#else
+#define hydro_part_pack_xv(FIELD)                                       \
+  FIELD(id) FIELD(x) FIELD(v) FIELD(mass) FIELD(h) FIELD(u) FIELD(rho) \
+  FIELD(viscosity) FIELD(diffusion) FIELD(force) FIELD(time_bin)
+#endif
+
+/**
+ * @brief Fields of the #part updated by the density loop and the ghost.
+ */
+#define hydro_part_pack_rho(FIELD) \
+  FIELD(h) FIELD(rho) FIELD(viscosity) FIELD(diffusion) FIELD(force)
+
+/**
+ * @brief Fields of the #part updated by the gradient loop and the extra ghost.
+ */
+#define hydro_part_pack_gradient(FIELD) \
+  FIELD(viscosity) FIELD(diffusion) FIELD(force)
+
+/**
+ * @brief Sub-module data of the #part, sent whole by all the exchanges.
+ */
+#define hydro_part_pack_modules(FIELD)                                   \
+  FIELD(adaptive_softening_data) FIELD(mhd_data) FIELD(chemistry_data)  \
+  FIELD(cooling_data) FIELD(feedback_data) FIELD(black_holes_data)      \
+  FIELD(sink_data) FIELD(pressure_floor_data) FIELD(rt_data)            \
+  FIELD(rt_time_data) FIELD(limiter_data)
+
+#endif /* SWIFT_HYDRO_DENSITY_CHECKS */
+
 #endif /* SWIFT_SPHENIX_HYDRO_PART_H */
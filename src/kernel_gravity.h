@@ -25,6 +25,7 @@
 /* Includes. */
 #include "inline.h"
 #include "minmax.h"
+#include "vector.h"
 
 #ifdef GADGET2_SOFTENING_CORRECTION
 /*! Conversion factor between Plummer softening and internal softening */
@@ -259,4 +260,39 @@ __attribute__((const)) INLINE static float D_soft_6(const float u) {
   return phi;
 }
 
+#if defined(WITH_VECTORIZATION) && !defined(GADGET2_SOFTENING_CORRECTION)
+
+/**
+ * @brief Computes the gravity softening kernel for the potential and the
+ * forces on a vector of distances.
+ *
+ * Vector version of kernel_grav_pot_eval() and kernel_grav_force_eval().
+ * This functions assumes 0 < u < 1.
+ *
+ * @param u The ratios of the distance to the softening length $u = x/H$.
+ * @param W_pot (return) The kernel for the potential.
+ * @param W_f (return) The kernel for the forces.
+ */
+__attribute__((always_inline)) INLINE static void kernel_grav_eval_vec(
+    const vector *u, vector *W_pot, vector *W_f) {
+
+  /* W(u) = 3u^7 - 15u^6 + 28u^5 - 21u^4 + 7u^2 - 3 */
+  W_pot->v = vec_fma(vec_set1(3.f), u->v, vec_set1(-15.f));
+  W_pot->v = vec_fma(W_pot->v, u->v, vec_set1(28.f));
+  W_pot->v = vec_fma(W_pot->v, u->v, vec_set1(-21.f));
+  W_pot->v = vec_mul(W_pot->v, u->v);
+  W_pot->v = vec_fma(W_pot->v, u->v, vec_set1(7.f));
+  W_pot->v = vec_mul(W_pot->v, u->v);
+  W_pot->v = vec_fma(W_pot->v, u->v, vec_set1(-3.f));
+
+  /* W(u) = 21u^5 - 90u^4 + 140u^3 - 84u^2 + 14 */
+  W_f->v = vec_fma(vec_set1(21.f), u->v, vec_set1(-90.f));
+  W_f->v = vec_fma(W_f->v, u->v, vec_set1(140.f));
+  W_f->v = vec_fma(W_f->v, u->v, vec_set1(-84.f));
+  W_f->v = vec_mul(W_f->v, u->v);
+  W_f->v = vec_fma(W_f->v, u->v, vec_set1(14.f));
+}
+
+#endif /* WITH_VECTORIZATION && !GADGET2_SOFTENING_CORRECTION */
+
 #endif /* SWIFT_KERNEL_GRAVITY_H */
@@ -262,6 +262,67 @@ kernel_long_grav_eval(const float r_over_r_s, float *restrict corr_f,
 #endif
 }
 
+#if defined(WITH_VECTORIZATION) && defined(VEC_HAVE_LDEXP)
+
+/**
+ * @brief Computes the long-range correction terms for the potential and
+ * force calculations due to the mesh truncation on a vector of distances.
+ *
+ * Vector version of kernel_long_grav_eval().
+ *
+ * @param r_over_r_s The ratios of the distance to the mesh scale.
+ * @param corr_f (return) The correction for the force.
+ * @param corr_pot (return) The correction for the potential.
+ */
+__attribute__((always_inline)) INLINE static void kernel_long_grav_eval_vec(
+    const vector *r_over_r_s, vector *corr_f, vector *corr_pot) {
+
+#ifdef GADGET2_LONG_RANGE_CORRECTION
+
+  const float two_over_sqrt_pi = ((float)M_2_SQRTPI);
+
+  vector u, minus_u2, exp_u2, t, a;
+  u.v = vec_mul(vec_set1(0.5f), r_over_r_s->v);
+  minus_u2.v = vec_mul(vec_set1(-1.f), vec_mul(u.v, u.v));
+  optimized_expf_vec(&minus_u2, &exp_u2);
+
+  /* erfcf(u) using eq. 7.1.26 of Abramowitz & Stegun, 1972. */
+  t.v = vec_div(vec_set1(1.f), vec_fma(vec_set1(0.3275911f), u.v,
+                                       vec_set1(1.f)));
+
+  /* a1 * t + a2 * t^2 + a3 * t^3 + a4 * t^4 + a5 * t^5 */
+  a.v = vec_fma(vec_set1(1.061405429f), t.v, vec_set1(-1.453152027f));
+  a.v = vec_fma(a.v, t.v, vec_set1(1.421413741f));
+  a.v = vec_fma(a.v, t.v, vec_set1(-0.284496736f));
+  a.v = vec_fma(a.v, t.v, vec_set1(0.254829592f));
+  a.v = vec_mul(a.v, t.v);
+
+  corr_pot->v = vec_mul(a.v, exp_u2.v);
+  corr_f->v = vec_fma(vec_mul(vec_set1(two_over_sqrt_pi), u.v), exp_u2.v,
+                      corr_pot->v);
+
+#else
+
+  vector x, exp_x, alpha, W;
+  x.v = vec_mul(vec_set1(2.f), r_over_r_s->v);
+  optimized_expf_vec(&x, &exp_x);
+  alpha.v = vec_div(vec_set1(1.f), vec_add(vec_set1(1.f), exp_x.v));
+
+  /* We want 2 - 2 exp(x) * alpha */
+  W.v = vec_fnma(alpha.v, exp_x.v, vec_set1(1.f));
+  corr_pot->v = vec_mul(W.v, vec_set1(2.f));
+
+  /* We want 2*(x*alpha - x*alpha^2 - exp(x)*alpha + 1) */
+  W.v = vec_sub(vec_set1(1.f), alpha.v);
+  W.v = vec_sub(vec_mul(W.v, x.v), exp_x.v);
+  W.v = vec_fma(W.v, alpha.v, vec_set1(1.f));
+  corr_f->v = vec_mul(W.v, vec_set1(2.f));
+
+#endif
+}
+
+#endif /* WITH_VECTORIZATION && VEC_HAVE_LDEXP */
+
 /**
  * @brief Computes the long-range correction term for the force calculation
  * coming from FFT in double precision.
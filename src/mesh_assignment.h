@@ -0,0 +1,199 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_MESH_ASSIGNMENT_H
+#define SWIFT_MESH_ASSIGNMENT_H
+
+/* Config parameters. */
+#include <config.h>
+
+/* Standard headers */
+#include <math.h>
+#include <string.h>
+
+/* Local headers */
+#include "error.h"
+#include "inline.h"
+
+/*! Largest number of mesh points a window touches along one axis */
+#define mesh_assignment_max_width 4
+
+/**
+ * @brief Computes the 1D weights of a mass assignment window.
+ *
+ * The supported windows are nearest grid point (order 1), cloud-in-cell
+ * (order 2), triangular-shaped cloud (order 3) and piecewise cubic spline
+ * (order 4). Mesh point n sits at position n (in units of mesh cells). A
+ * particle at position u is assigned to the order points i0, ..., i0 + order
+ * - 1 with weights w[0], ..., w[order - 1] that add up to one. The same
+ * weights are used to interpolate a mesh back to the particle.
+ *
+ * @param u The position along the axis in units of mesh cells.
+ * @param order The order of the window.
+ * @param w (return) The weights.
+ * @return The index i0 of the first mesh point (not wrapped).
+ */
+__attribute__((always_inline)) INLINE static int mesh_assignment_weights(
+    const double u, const int order, double w[mesh_assignment_max_width]) {
+
+  switch (order) {
+    case 1: {
+      w[0] = 1.;
+      return (int)floor(u + 0.5);
+    }
+    case 2: {
+      const int i = (int)floor(u);
+      const double d = u - i;
+      w[0] = 1. - d;
+      w[1] = d;
+      return i;
+    }
+    case 3: {
+      const int i = (int)floor(u + 0.5);
+      const double d = u - i; /* in [-0.5, 0.5[ */
+      w[0] = 0.5 * (0.5 - d) * (0.5 - d);
+      w[1] = 0.75 - d * d;
+      w[2] = 0.5 * (0.5 + d) * (0.5 + d);
+      return i - 1;
+    }
+    case 4: {
+      const int i = (int)floor(u);
+      const double d = u - i; /* in [0, 1[ */
+      const double d2 = d * d;
+      const double d3 = d2 * d;
+      const double t = 1. - d;
+      w[0] = (1. / 6.) * t * t * t;
+      w[1] = (1. / 6.) * (4. - 6. * d2 + 3. * d3);
+      w[2] = (1. / 6.) * (1. + 3. * d + 3. * d2 - 3. * d3);
+      w[3] = (1. / 6.) * d3;
+      return i - 1;
+    }
+    default:
+#ifdef SWIFT_DEBUG_CHECKS
+      error("Invalid mass assignment order %d", order);
+#endif
+      return 0;
+  }
+}
+
+/**
+ * @brief Number of mesh points below floor(u) a window of a given order can
+ * touch.
+ *
+ * @param order The order of the window.
+ */
+__attribute__((always_inline, const)) INLINE static int
+mesh_assignment_reach_low(const int order) {
+  return (order > 2) ? 1 : 0;
+}
+
+/**
+ * @brief Number of mesh points above floor(u) a window of a given order can
+ * touch.
+ *
+ * @param order The order of the window.
+ */
+__attribute__((always_inline, const)) INLINE static int
+mesh_assignment_reach_high(const int order) {
+  return (order > 2) ? 2 : 1;
+}
+
+/**
+ * @brief Returns the short name of the window of a given order.
+ *
+ * @param order The order of the window.
+ */
+INLINE static const char *mesh_assignment_name(const int order) {
+  switch (order) {
+    case 1:
+      return "NGP";
+    case 2:
+      return "CIC";
+    case 3:
+      return "TSC";
+    case 4:
+      return "PCS";
+    default:
+      return "unknown";
+  }
+}
+
+/**
+ * @brief Returns the order of a window given its short name.
+ *
+ * @param name The name (NGP, CIC, TSC or PCS).
+ */
+INLINE static int mesh_assignment_order_from_name(const char *name) {
+  for (int order = 1; order <= mesh_assignment_max_width; ++order)
+    if (strcmp(name, mesh_assignment_name(order)) == 0) return order;
+  error("Invalid mass assignment window '%s' (must be NGP, CIC, TSC or PCS)",
+        name);
+  return 0;
+}
+
+/**
+ * @brief Computes the phase factors used to combine a mesh with its
+ * interlaced (shifted by half a cell along all axes) counterpart.
+ *
+ * A field assigned with all the particles shifted by +1/2 cell has its
+ * Fourier modes multiplied by exp(-i pi k / N) along each axis. Multiplying
+ * them back by exp(i pi k / N) and averaging with the unshifted field cancels
+ * the odd alias images.
+ *
+ * @param N The number of mesh cells along one axis.
+ * @param cos_phase (return) cos(pi k / N) for each of the N mesh indices.
+ * @param sin_phase (return) sin(pi k / N) for each of the N mesh indices.
+ */
+INLINE static void mesh_interlacing_phases(const int N, double *cos_phase,
+                                           double *sin_phase) {
+  for (int i = 0; i < N; ++i) {
+    const int k = (i > N / 2) ? i - N : i;
+    const double phase = M_PI * (double)k / (double)N;
+    cos_phase[i] = cos(phase);
+    sin_phase[i] = sin(phase);
+  }
+}
+
+/**
+ * @brief Averages a Fourier mode with the same mode of the interlaced mesh.
+ *
+ * @param cos_phase The table of cosines from mesh_interlacing_phases().
+ * @param sin_phase The table of sines from mesh_interlacing_phases().
+ * @param i The mesh index of the mode along the first axis.
+ * @param j The mesh index of the mode along the second axis.
+ * @param k The mesh index of the mode along the third axis.
+ * @param re_shift Real part of the mode of the interlaced mesh.
+ * @param im_shift Imaginary part of the mode of the interlaced mesh.
+ * @param re (in/out) Real part of the mode of the mesh.
+ * @param im (in/out) Imaginary part of the mode of the mesh.
+ */
+__attribute__((always_inline)) INLINE static void mesh_interlacing_combine(
+    const double *cos_phase, const double *sin_phase, const int i, const int j,
+    const int k, const double re_shift, const double im_shift, double *re,
+    double *im) {
+
+  const double c_xy = cos_phase[i] * cos_phase[j] - sin_phase[i] * sin_phase[j];
+  const double s_xy = sin_phase[i] * cos_phase[j] + cos_phase[i] * sin_phase[j];
+  const double c = c_xy * cos_phase[k] - s_xy * sin_phase[k];
+  const double s = s_xy * cos_phase[k] + c_xy * sin_phase[k];
+
+  *re = 0.5 * (*re + re_shift * c - im_shift * s);
+  *im = 0.5 * (*im + re_shift * s + im_shift * c);
+}
+
+#endif /* SWIFT_MESH_ASSIGNMENT_H */
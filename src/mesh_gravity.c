@@ -20,13 +20,6 @@
 /* Config parameters. */
 #include <config.h>
 
-#ifdef HAVE_FFTW
-#include <fftw3.h>
-#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
-#include <fftw3-mpi.h>
-#endif
-#endif
-
 /* This object's header. */
 #include "mesh_gravity.h"
 
@@ -36,9 +29,12 @@
 #include "engine.h"
 #include "error.h"
 #include "gravity_properties.h"
+#include "integer_power.h"
 #include "kernel_long_gravity.h"
+#include "mesh_assignment.h"
 #include "mesh_gravity_mpi.h"
 #include "mesh_gravity_patch.h"
+#include "mesh_gravity_pencil.h"
 #include "neutrino.h"
 #include "part.h"
 #include "restart.h"
@@ -52,91 +48,84 @@
 
 #ifdef HAVE_FFTW
 
+/*! Width of the local copy of the potential used by the 5-point stencil */
+#define mesh_stencil_width (mesh_assignment_max_width + 4)
+
 /**
- * @brief Interpolate values from a the mesh using CIC.
+ * @brief Interpolate values from the mesh using the assignment window.
  *
  * @param mesh The mesh to read from.
- * @param i The index of the cell along x
- * @param j The index of the cell along y
- * @param k The index of the cell along z
- * @param tx First CIC coefficient along x
- * @param ty First CIC coefficient along y
- * @param tz First CIC coefficient along z
- * @param dx Second CIC coefficient along x
- * @param dy Second CIC coefficient along y
- * @param dz Second CIC coefficient along z
+ * @param i The index of the first cell along x
+ * @param j The index of the first cell along y
+ * @param k The index of the first cell along z
+ * @param wx The window weights along x
+ * @param wy The window weights along y
+ * @param wz The window weights along z
+ * @param order The order of the window (number of cells along each axis).
  */
-__attribute__((always_inline, const)) INLINE static double CIC_get(
-    double mesh[6][6][6], const int i, const int j, const int k,
-    const double tx, const double ty, const double tz, const double dx,
-    const double dy, const double dz) {
-
-  double temp;
-  temp = mesh[i + 0][j + 0][k + 0] * tx * ty * tz;
-  temp += mesh[i + 0][j + 0][k + 1] * tx * ty * dz;
-  temp += mesh[i + 0][j + 1][k + 0] * tx * dy * tz;
-  temp += mesh[i + 0][j + 1][k + 1] * tx * dy * dz;
-  temp += mesh[i + 1][j + 0][k + 0] * dx * ty * tz;
-  temp += mesh[i + 1][j + 0][k + 1] * dx * ty * dz;
-  temp += mesh[i + 1][j + 1][k + 0] * dx * dy * tz;
-  temp += mesh[i + 1][j + 1][k + 1] * dx * dy * dz;
+__attribute__((always_inline)) INLINE static double window_get(
+    double mesh[mesh_stencil_width][mesh_stencil_width][mesh_stencil_width],
+    const int i, const int j, const int k, const double* wx, const double* wy,
+    const double* wz, const int order) {
+
+  double temp = 0.;
+  for (int ii = 0; ii < order; ++ii) {
+    for (int jj = 0; jj < order; ++jj) {
+      const double wxy = wx[ii] * wy[jj];
+      for (int kk = 0; kk < order; ++kk)
+        temp += mesh[i + ii][j + jj][k + kk] * wxy * wz[kk];
+    }
+  }
 
   return temp;
 }
 
 /**
- * @brief Interpolate a value to a mesh using CIC.
+ * @brief Assign a value to a mesh using the assignment window.
  *
  * @param mesh The mesh to write to
  * @param N The side-length of the mesh
- * @param i The index of the cell along x
- * @param j The index of the cell along y
- * @param k The index of the cell along z
- * @param tx First CIC coefficient along x
- * @param ty First CIC coefficient along y
- * @param tz First CIC coefficient along z
- * @param dx Second CIC coefficient along x
- * @param dy Second CIC coefficient along y
- * @param dz Second CIC coefficient along z
+ * @param i The index of the first cell along x
+ * @param j The index of the first cell along y
+ * @param k The index of the first cell along z
+ * @param wx The window weights along x
+ * @param wy The window weights along y
+ * @param wz The window weights along z
+ * @param order The order of the window (number of cells along each axis).
  * @param value The value to interpolate.
  */
-__attribute__((always_inline)) INLINE static void CIC_set(
-    double* mesh, const int N, const int i, const int j, const int k,
-    const double tx, const double ty, const double tz, const double dx,
-    const double dy, const double dz, const double value) {
-
-  /* Classic CIC interpolation */
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 0, k + 0, N)],
-               value * tx * ty * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 0, k + 1, N)],
-               value * tx * ty * dz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 1, k + 0, N)],
-               value * tx * dy * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 0, j + 1, k + 1, N)],
-               value * tx * dy * dz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 0, k + 0, N)],
-               value * dx * ty * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 0, k + 1, N)],
-               value * dx * ty * dz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 1, k + 0, N)],
-               value * dx * dy * tz);
-  atomic_add_d(&mesh[row_major_id_periodic(i + 1, j + 1, k + 1, N)],
-               value * dx * dy * dz);
+__attribute__((always_inline)) INLINE static void window_set(
+    mesh_real* mesh, const int N, const int i, const int j, const int k,
+    const double* wx, const double* wy, const double* wz, const int order,
+    const double value) {
+
+  for (int ii = 0; ii < order; ++ii) {
+    for (int jj = 0; jj < order; ++jj) {
+      const double wxy = value * wx[ii] * wy[jj];
+      for (int kk = 0; kk < order; ++kk)
+        mesh_atomic_add(&mesh[row_major_id_periodic(i + ii, j + jj, k + kk, N)],
+                        wxy * wz[kk]);
+    }
+  }
 }
 
 /**
- * @brief Assigns a given #gpart to a density mesh using the CIC method.
+ * @brief Assigns a given #gpart to a density mesh using the CIC method (or
+ * the higher-order window chosen by the user).
  *
  * @param gp The #gpart.
  * @param rho The density mesh.
  * @param N the size of the mesh along one axis.
  * @param fac The width of a mesh cell.
  * @param dim The dimensions of the simulation box.
+ * @param order The order of the mass assignment window.
+ * @param shift Shift of the particle positions in units of mesh cells.
  * @param nu_model Struct with neutrino constants
  */
-INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, double* rho,
+INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, mesh_real* rho,
                                      const int N, const double fac,
-                                     const double dim[3],
+                                     const double dim[3], const int order,
+                                     const double shift,
                                      const struct neutrino_model* nu_model) {
 
   /* Box wrap the multipole's position */
@@ -144,29 +133,21 @@ INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, double* rho,
   const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
   const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
 
-  /* Workout the CIC coefficients */
-  int i = (int)(fac * pos_x);
-  if (i >= N) i = N - 1;
-  const double dx = fac * pos_x - i;
-  const double tx = 1. - dx;
-
-  int j = (int)(fac * pos_y);
-  if (j >= N) j = N - 1;
-  const double dy = fac * pos_y - j;
-  const double ty = 1. - dy;
-
-  int k = (int)(fac * pos_z);
-  if (k >= N) k = N - 1;
-  const double dz = fac * pos_z - k;
-  const double tz = 1. - dz;
+  /* Workout the window coefficients (indices are wrapped when writing) */
+  double wx[mesh_assignment_max_width];
+  double wy[mesh_assignment_max_width];
+  double wz[mesh_assignment_max_width];
+  const int i = mesh_assignment_weights(fac * pos_x + shift, order, wx);
+  const int j = mesh_assignment_weights(fac * pos_y + shift, order, wy);
+  const int k = mesh_assignment_weights(fac * pos_z + shift, order, wz);
 
 #ifdef SWIFT_DEBUG_CHECKS
   if (gp->time_bin == time_bin_not_created)
     error("Found an extra particle in mesh CIC.");
 
-  if (i < 0 || i >= N) error("Invalid gpart position in x");
-  if (j < 0 || j >= N) error("Invalid gpart position in y");
-  if (k < 0 || k >= N) error("Invalid gpart position in z");
+  if (i < -1 || i > N) error("Invalid gpart position in x");
+  if (j < -1 || j > N) error("Invalid gpart position in y");
+  if (k < -1 || k > N) error("Invalid gpart position in z");
 #endif
 
   /* Compute weight (for neutrino delta-f weighting) */
@@ -178,22 +159,25 @@ INLINE static void gpart_to_mesh_CIC(const struct gpart* gp, double* rho,
   const double value = mass * weight;
 
   /* CIC ! */
-  CIC_set(rho, N, i, j, k, tx, ty, tz, dx, dy, dz, value);
+  window_set(rho, N, i, j, k, wx, wy, wz, order, value);
 }
 
 /**
  * @brief Assigns all the #gpart of a #cell to a density mesh using the CIC
- * method.
+ * method (or the higher-order window chosen by the user).
  *
  * @param c The #cell.
  * @param rho The density mesh.
  * @param N the size of the mesh along one axis.
  * @param fac The width of a mesh cell.
  * @param dim The dimensions of the simulation box.
+ * @param order The order of the mass assignment window.
+ * @param shift Shift of the particle positions in units of mesh cells.
  * @param nu_model Struct with neutrino constants
  */
-void cell_gpart_to_mesh_CIC(const struct cell* c, double* rho, const int N,
+void cell_gpart_to_mesh_CIC(const struct cell* c, mesh_real* rho, const int N,
                             const double fac, const double dim[3],
+                            const int order, const double shift,
                             const struct neutrino_model* nu_model) {
 
   const int gcount = c->grav.count;
@@ -202,7 +186,7 @@ void cell_gpart_to_mesh_CIC(const struct cell* c, double* rho, const int N,
   /* Assign all the gpart of that cell to the mesh */
   for (int i = 0; i < gcount; ++i) {
     if (gparts[i].time_bin == time_bin_inhibited) continue;
-    gpart_to_mesh_CIC(&gparts[i], rho, N, fac, dim, nu_model);
+    gpart_to_mesh_CIC(&gparts[i], rho, N, fac, dim, order, shift, nu_model);
   }
 }
 
@@ -212,9 +196,11 @@ void cell_gpart_to_mesh_CIC(const struct cell* c, double* rho, const int N,
  */
 struct cic_mapper_data {
   const struct cell* cells;
-  double* rho;
-  double* potential;
+  mesh_real* rho;
+  mesh_real* rho_shift;
+  mesh_real* potential;
   int N;
+  int order;
   int use_local_patches;
   double fac;
   double dim[3];
@@ -225,8 +211,10 @@ struct cic_mapper_data {
 void gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
 
   const struct cic_mapper_data* data = (struct cic_mapper_data*)extra;
-  double* rho = data->rho;
+  mesh_real* rho = data->rho;
+  mesh_real* rho_shift = data->rho_shift;
   const int N = data->N;
+  const int order = data->order;
   const double fac = data->fac;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
   const struct neutrino_model* nu_model = data->nu_model;
@@ -236,7 +224,13 @@ void gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
 
   for (int i = 0; i < num; ++i) {
     if (gparts[i].time_bin == time_bin_inhibited) continue;
-    gpart_to_mesh_CIC(&gparts[i], rho, N, fac, dim, nu_model);
+    gpart_to_mesh_CIC(&gparts[i], rho, N, fac, dim, order, /*shift=*/0.,
+                      nu_model);
+
+    /* Also assign to the interlaced mesh if we have one */
+    if (rho_shift != NULL)
+      gpart_to_mesh_CIC(&gparts[i], rho_shift, N, fac, dim, order,
+                        /*shift=*/0.5, nu_model);
   }
 }
 
@@ -252,8 +246,10 @@ void cell_gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
   /* Unpack the shared information */
   const struct cic_mapper_data* data = (struct cic_mapper_data*)extra;
   const struct cell* cells = data->cells;
-  double* rho = data->rho;
+  mesh_real* rho = data->rho;
+  mesh_real* rho_shift = data->rho_shift;
   const int N = data->N;
+  const int order = data->order;
   const double fac = data->fac;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
   const struct neutrino_model* nu_model = data->nu_model;
@@ -277,7 +273,8 @@ void cell_gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
 
       /* Do a CIC interpolation of all the particles in this cell onto
          the local patch (allocates memory in the patch) */
-      accumulate_cell_to_local_patch(N, fac, dim, c, &patch, nu_model);
+      accumulate_cell_to_local_patch(N, fac, dim, c, &patch, order,
+                                     /*shift=*/0., nu_model);
 
       /* Copy the local patch values back onto the global mesh */
       pm_add_patch_to_global_mesh(rho, &patch);
@@ -285,56 +282,247 @@ void cell_gpart_to_mesh_CIC_mapper(void* map_data, int num, void* extra) {
       /* Free the allocated memory */
       pm_mesh_patch_clean(&patch);
 
+      /* Same again for the interlaced mesh */
+      if (rho_shift != NULL) {
+        accumulate_cell_to_local_patch(N, fac, dim, c, &patch, order,
+                                       /*shift=*/0.5, nu_model);
+        pm_add_patch_to_global_mesh(rho_shift, &patch);
+        pm_mesh_patch_clean(&patch);
+      }
+
     } else {
 
       /* Assign this cell's content directly atomically to the mesh */
-      cell_gpart_to_mesh_CIC(c, rho, N, fac, dim, nu_model);
+      cell_gpart_to_mesh_CIC(c, rho, N, fac, dim, order, /*shift=*/0.,
+                             nu_model);
+      if (rho_shift != NULL)
+        cell_gpart_to_mesh_CIC(c, rho_shift, N, fac, dim, order,
+                               /*shift=*/0.5, nu_model);
     }
   }
 }
 
+/**
+ * @brief Shared information about the private mesh tiles to be used by all
+ * the threads in the pool.
+ */
+struct tile_mapper_data {
+  const struct cell* cells;
+  const int* local_cells;
+  struct pm_mesh_patch* tiles;
+  struct pm_mesh_patch* tiles_shift;
+  int N;
+  int order;
+  double fac;
+  double dim[3];
+  const struct neutrino_model* nu_model;
+};
+
+/**
+ * @brief Threadpool mapper function assigning the particles of each cell to
+ * its own private mesh tile.
+ *
+ * No memory is shared between the tiles so no atomics are needed. The tiles
+ * are stored in the order of the list of local cells.
+ *
+ * @param map_data A chunk of the list of local cells.
+ * @param num The number of cells in the chunk.
+ * @param extra The information about the mesh and cells.
+ */
+void cell_gpart_to_mesh_tile_mapper(void* map_data, int num, void* extra) {
+
+  /* Unpack the shared information */
+  const struct tile_mapper_data* data = (struct tile_mapper_data*)extra;
+  const struct cell* cells = data->cells;
+  const int N = data->N;
+  const int order = data->order;
+  const double fac = data->fac;
+  const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
+  const struct neutrino_model* nu_model = data->nu_model;
+
+  /* Pointer to the chunk to be processed */
+  const int* local_cells = (int*)map_data;
+
+  /* Start at the same position in the list of tiles */
+  const size_t offset = local_cells - data->local_cells;
+
+  /* Loop over the elements assigned to this thread */
+  for (int i = 0; i < num; ++i) {
+
+    /* Pointer to local cell */
+    const struct cell* c = &cells[local_cells[i]];
+
+    /* Skip empty cells (their tile stays empty) */
+    if (c->grav.count == 0) continue;
+
+    accumulate_cell_to_local_patch(N, fac, dim, c, &data->tiles[offset + i],
+                                   order, /*shift=*/0., nu_model);
+    if (data->tiles_shift != NULL)
+      accumulate_cell_to_local_patch(N, fac, dim, c,
+                                     &data->tiles_shift[offset + i], order,
+                                     /*shift=*/0.5, nu_model);
+  }
+}
+
+/**
+ * @brief Shared information needed to reduce the private tiles onto the mesh.
+ */
+struct tile_reduce_mapper_data {
+  const struct pm_mesh_patch* tiles;
+  const int* plane_offset;
+  const int* plane_tile;
+  const int* plane_slab;
+  mesh_real* rho;
+  int N;
+};
+
+/**
+ * @brief Threadpool mapper function adding the private tiles to a range of
+ * x-planes of the global mesh.
+ *
+ * Each plane is written by a single thread and the tiles are added in the
+ * order of the list of local cells, so the result does not depend on the
+ * number of threads.
+ *
+ * @param map_data The start of the range of planes (as an element of rho).
+ * @param num The number of planes in the range.
+ * @param extra The information about the tiles and the mesh.
+ */
+void mesh_tiles_reduce_mapper(void* map_data, int num, void* extra) {
+
+  /* Unpack the shared information */
+  const struct tile_reduce_mapper_data* data =
+      (struct tile_reduce_mapper_data*)extra;
+  const struct pm_mesh_patch* tiles = data->tiles;
+  mesh_real* rho = data->rho;
+  const int N = data->N;
+
+  /* Range of x-planes handled by this call */
+  const int i_start = (mesh_real*)map_data - rho;
+  const int i_end = i_start + num;
+
+  for (int i = i_start; i < i_end; ++i) {
+    for (int e = data->plane_offset[i]; e < data->plane_offset[i + 1]; ++e) {
+
+      const struct pm_mesh_patch* tile = &tiles[data->plane_tile[e]];
+      const int ii = data->plane_slab[e];
+
+      for (int jj = 0; jj < tile->mesh_size[1]; ++jj) {
+        for (int kk = 0; kk < tile->mesh_size[2]; ++kk) {
+
+          const int j = jj + tile->mesh_min[1];
+          const int k = kk + tile->mesh_min[2];
+
+          rho[row_major_id_periodic(i, j, k, N)] +=
+              tile->mesh[pm_mesh_patch_index(tile, ii, jj, kk)];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Adds a set of private tiles to the global mesh without atomics.
+ *
+ * We first list, for every x-plane of the mesh, the (tile, slab) pairs that
+ * overlap with it, in the order of the tiles. The planes are then handed out
+ * to the threads, which makes the summation order (and hence the result)
+ * independent of the number of threads.
+ *
+ * @param tiles The private tiles (one per local top-level cell).
+ * @param nr_tiles The number of tiles.
+ * @param rho The global mesh to add to.
+ * @param N The size of the mesh along one axis.
+ * @param tp The #threadpool object used for parallelisation.
+ */
+static void mesh_tiles_to_global_mesh(const struct pm_mesh_patch* tiles,
+                                      const int nr_tiles, mesh_real* rho,
+                                      const int N, struct threadpool* tp) {
+
+  /* Count the slabs overlapping with each x-plane */
+  int* plane_offset = (int*)calloc(N + 1, sizeof(int));
+  if (plane_offset == NULL) error("Error allocating the tile plane offsets");
+  for (int t = 0; t < nr_tiles; ++t) {
+    if (tiles[t].mesh == NULL) continue;
+    for (int ii = 0; ii < tiles[t].mesh_size[0]; ++ii) {
+      const int i = ((ii + tiles[t].mesh_min[0]) % N + N) % N;
+      plane_offset[i + 1]++;
+    }
+  }
+  for (int i = 0; i < N; ++i) plane_offset[i + 1] += plane_offset[i];
+
+  /* List them, keeping the order of the tiles */
+  const int count = plane_offset[N];
+  int* plane_tile = (int*)malloc(count * sizeof(int));
+  int* plane_slab = (int*)malloc(count * sizeof(int));
+  int* plane_fill = (int*)malloc(N * sizeof(int));
+  if (plane_tile == NULL || plane_slab == NULL || plane_fill == NULL)
+    error("Error allocating the tile plane lists");
+  memcpy(plane_fill, plane_offset, N * sizeof(int));
+  for (int t = 0; t < nr_tiles; ++t) {
+    if (tiles[t].mesh == NULL) continue;
+    for (int ii = 0; ii < tiles[t].mesh_size[0]; ++ii) {
+      const int i = ((ii + tiles[t].mesh_min[0]) % N + N) % N;
+      plane_tile[plane_fill[i]] = t;
+      plane_slab[plane_fill[i]] = ii;
+      plane_fill[i]++;
+    }
+  }
+  free(plane_fill);
+
+  /* Reduce the planes in parallel */
+  struct tile_reduce_mapper_data data;
+  data.tiles = tiles;
+  data.plane_offset = plane_offset;
+  data.plane_tile = plane_tile;
+  data.plane_slab = plane_slab;
+  data.rho = rho;
+  data.N = N;
+  threadpool_map(tp, mesh_tiles_reduce_mapper, rho, N, sizeof(mesh_real),
+                 threadpool_auto_chunk_size, &data);
+
+  free(plane_slab);
+  free(plane_tile);
+  free(plane_offset);
+}
+
 /**
  * @brief Computes the potential on a gpart from a given mesh using the CIC
- * method.
+ * method (or the higher-order window chosen by the user).
  *
- * Debugging routine.
+ * The same window as for the mass assignment is used to preserve momentum
+ * conservation.
  *
  * @param gp The #gpart.
  * @param pot The potential mesh.
  * @param N the size of the mesh along one axis.
  * @param fac width of a mesh cell.
  * @param dim The dimensions of the simulation box.
+ * @param order The order of the mass assignment window.
  */
-void mesh_to_gpart_CIC(struct gpart* gp, const double* pot, const int N,
-                       const double fac, const double dim[3]) {
+void mesh_to_gpart_CIC(struct gpart* gp, const mesh_real* pot, const int N,
+                       const double fac, const double dim[3],
+                       const int order) {
 
   /* Box wrap the gpart's position */
   const double pos_x = box_wrap(gp->x[0], 0., dim[0]);
   const double pos_y = box_wrap(gp->x[1], 0., dim[1]);
   const double pos_z = box_wrap(gp->x[2], 0., dim[2]);
 
-  int i = (int)(fac * pos_x);
-  if (i >= N) i = N - 1;
-  const double dx = fac * pos_x - i;
-  const double tx = 1. - dx;
-
-  int j = (int)(fac * pos_y);
-  if (j >= N) j = N - 1;
-  const double dy = fac * pos_y - j;
-  const double ty = 1. - dy;
-
-  int k = (int)(fac * pos_z);
-  if (k >= N) k = N - 1;
-  const double dz = fac * pos_z - k;
-  const double tz = 1. - dz;
+  double wx[mesh_assignment_max_width];
+  double wy[mesh_assignment_max_width];
+  double wz[mesh_assignment_max_width];
+  const int i = mesh_assignment_weights(fac * pos_x, order, wx);
+  const int j = mesh_assignment_weights(fac * pos_y, order, wy);
+  const int k = mesh_assignment_weights(fac * pos_z, order, wz);
 
 #ifdef SWIFT_DEBUG_CHECKS
   if (gp->time_bin == time_bin_not_created)
     error("Found an extra particle when computing gravity from mesh.");
 
-  if (i < 0 || i >= N) error("Invalid gpart position in x");
-  if (j < 0 || j >= N) error("Invalid gpart position in y");
-  if (k < 0 || k >= N) error("Invalid gpart position in z");
+  if (i < -1 || i > N) error("Invalid gpart position in x");
+  if (j < -1 || j > N) error("Invalid gpart position in y");
+  if (k < -1 || k > N) error("Invalid gpart position in z");
 #endif
 
 #ifdef SWIFT_GRAVITY_FORCE_CHECKS
@@ -346,12 +534,13 @@ void mesh_to_gpart_CIC(struct gpart* gp, const double* pot, const int N,
 
   /* First, copy the necessary part of the mesh for stencil operations */
   /* This includes box-wrapping in all 3 dimensions. */
-  double phi[6][6][6];
-  for (int iii = -2; iii <= 3; ++iii) {
-    for (int jjj = -2; jjj <= 3; ++jjj) {
-      for (int kkk = -2; kkk <= 3; ++kkk) {
-        phi[iii + 2][jjj + 2][kkk + 2] =
-            pot[row_major_id_periodic(i + iii, j + jjj, k + kkk, N)];
+  const int width = order + 4;
+  double phi[mesh_stencil_width][mesh_stencil_width][mesh_stencil_width];
+  for (int iii = 0; iii < width; ++iii) {
+    for (int jjj = 0; jjj < width; ++jjj) {
+      for (int kkk = 0; kkk < width; ++kkk) {
+        phi[iii][jjj][kkk] = pot[row_major_id_periodic(
+            i + iii - 2, j + jjj - 2, k + kkk - 2, N)];
       }
     }
   }
@@ -364,25 +553,25 @@ void mesh_to_gpart_CIC(struct gpart* gp, const double* pot, const int N,
   const int ii = 2, jj = 2, kk = 2;
 
   /* Simple CIC for the potential itself */
-  p += CIC_get(phi, ii, jj, kk, tx, ty, tz, dx, dy, dz);
+  p += window_get(phi, ii, jj, kk, wx, wy, wz, order);
 
   /* ---- */
 
   /* 5-point stencil along each axis for the accelerations */
-  a[0] += (1. / 12.) * CIC_get(phi, ii + 2, jj, kk, tx, ty, tz, dx, dy, dz);
-  a[0] -= (2. / 3.) * CIC_get(phi, ii + 1, jj, kk, tx, ty, tz, dx, dy, dz);
-  a[0] += (2. / 3.) * CIC_get(phi, ii - 1, jj, kk, tx, ty, tz, dx, dy, dz);
-  a[0] -= (1. / 12.) * CIC_get(phi, ii - 2, jj, kk, tx, ty, tz, dx, dy, dz);
+  a[0] += (1. / 12.) * window_get(phi, ii + 2, jj, kk, wx, wy, wz, order);
+  a[0] -= (2. / 3.) * window_get(phi, ii + 1, jj, kk, wx, wy, wz, order);
+  a[0] += (2. / 3.) * window_get(phi, ii - 1, jj, kk, wx, wy, wz, order);
+  a[0] -= (1. / 12.) * window_get(phi, ii - 2, jj, kk, wx, wy, wz, order);
 
-  a[1] += (1. / 12.) * CIC_get(phi, ii, jj + 2, kk, tx, ty, tz, dx, dy, dz);
-  a[1] -= (2. / 3.) * CIC_get(phi, ii, jj + 1, kk, tx, ty, tz, dx, dy, dz);
-  a[1] += (2. / 3.) * CIC_get(phi, ii, jj - 1, kk, tx, ty, tz, dx, dy, dz);
-  a[1] -= (1. / 12.) * CIC_get(phi, ii, jj - 2, kk, tx, ty, tz, dx, dy, dz);
+  a[1] += (1. / 12.) * window_get(phi, ii, jj + 2, kk, wx, wy, wz, order);
+  a[1] -= (2. / 3.) * window_get(phi, ii, jj + 1, kk, wx, wy, wz, order);
+  a[1] += (2. / 3.) * window_get(phi, ii, jj - 1, kk, wx, wy, wz, order);
+  a[1] -= (1. / 12.) * window_get(phi, ii, jj - 2, kk, wx, wy, wz, order);
 
-  a[2] += (1. / 12.) * CIC_get(phi, ii, jj, kk + 2, tx, ty, tz, dx, dy, dz);
-  a[2] -= (2. / 3.) * CIC_get(phi, ii, jj, kk + 1, tx, ty, tz, dx, dy, dz);
-  a[2] += (2. / 3.) * CIC_get(phi, ii, jj, kk - 1, tx, ty, tz, dx, dy, dz);
-  a[2] -= (1. / 12.) * CIC_get(phi, ii, jj, kk - 2, tx, ty, tz, dx, dy, dz);
+  a[2] += (1. / 12.) * window_get(phi, ii, jj, kk + 2, wx, wy, wz, order);
+  a[2] -= (2. / 3.) * window_get(phi, ii, jj, kk + 1, wx, wy, wz, order);
+  a[2] += (2. / 3.) * window_get(phi, ii, jj, kk - 1, wx, wy, wz, order);
+  a[2] -= (1. / 12.) * window_get(phi, ii, jj, kk - 2, wx, wy, wz, order);
 
   /* ---- */
 
@@ -393,9 +582,9 @@ void mesh_to_gpart_CIC(struct gpart* gp, const double* pot, const int N,
   gravity_add_comoving_mesh_potential(gp, p);
 }
 
-void cell_mesh_to_gpart_CIC(const struct cell* c, const double* potential,
+void cell_mesh_to_gpart_CIC(const struct cell* c, const mesh_real* potential,
                             const int N, const double fac, const float const_G,
-                            const double dim[3]) {
+                            const double dim[3], const int order) {
 
   const int gcount = c->grav.count;
   struct gpart* gparts = c->grav.parts;
@@ -414,7 +603,7 @@ void cell_mesh_to_gpart_CIC(const struct cell* c, const double* potential,
     gp->potential_mesh = 0.f;
 #endif
 
-    mesh_to_gpart_CIC(gp, potential, N, fac, dim);
+    mesh_to_gpart_CIC(gp, potential, N, fac, dim, order);
 
     gp->a_grav_mesh[0] *= const_G;
     gp->a_grav_mesh[1] *= const_G;
@@ -429,8 +618,9 @@ void mesh_to_gpart_CIC_mapper(void* map_data, int num, void* extra) {
 
   /* Unpack the shared information */
   const struct cic_mapper_data* data = (struct cic_mapper_data*)extra;
-  const double* const potential = data->potential;
+  const mesh_real* const potential = data->potential;
   const int N = data->N;
+  const int order = data->order;
   const double fac = data->fac;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
   const float const_G = data->const_G;
@@ -451,7 +641,7 @@ void mesh_to_gpart_CIC_mapper(void* map_data, int num, void* extra) {
     gp->potential_mesh = 0.f;
 #endif
 
-    mesh_to_gpart_CIC(gp, potential, N, fac, dim);
+    mesh_to_gpart_CIC(gp, potential, N, fac, dim, order);
 
     gp->a_grav_mesh[0] *= const_G;
     gp->a_grav_mesh[1] *= const_G;
@@ -474,8 +664,9 @@ void cell_mesh_to_gpart_CIC_mapper(void* map_data, int num, void* extra) {
   /* Unpack the shared information */
   const struct cic_mapper_data* data = (struct cic_mapper_data*)extra;
   const struct cell* cells = data->cells;
-  const double* const potential = data->potential;
+  const mesh_real* const potential = data->potential;
   const int N = data->N;
+  const int order = data->order;
   const double fac = data->fac;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
   const float const_G = data->const_G;
@@ -490,7 +681,7 @@ void cell_mesh_to_gpart_CIC_mapper(void* map_data, int num, void* extra) {
     const struct cell* c = &cells[local_cells[i]];
 
     /* Assign this cell's content to the mesh */
-    cell_mesh_to_gpart_CIC(c, potential, N, fac, const_G, dim);
+    cell_mesh_to_gpart_CIC(c, potential, N, fac, const_G, dim, order);
   }
 }
 
@@ -501,12 +692,16 @@ void cell_mesh_to_gpart_CIC_mapper(void* map_data, int num, void* extra) {
 struct Green_function_data {
 
   int N;
-  fftw_complex* frho;
+  int order;
+  mesh_complex* frho;
+  const mesh_complex* frho_shift;
+  const double* cos_phase;
+  const double* sin_phase;
   double green_fac;
   double a_smooth2;
   double k_fac;
-  int slice_offset;
-  int slice_width;
+  int start[3];
+  int width[3];
 };
 
 /**
@@ -521,21 +716,24 @@ void mesh_apply_Green_function_mapper(void* map_data, const int num,
 
   struct Green_function_data* data = (struct Green_function_data*)extra;
 
-  /* Unpack the array */
-  fftw_complex* const frho = data->frho;
+  /* Unpack the arrays */
+  mesh_complex* const frho = data->frho;
+  const mesh_complex* const frho_shift = data->frho_shift;
   const int N = data->N;
   const int N_half = N / 2;
+  const int order = data->order;
 
   /* Unpack the Green function properties */
   const double green_fac = data->green_fac;
   const double a_smooth2 = data->a_smooth2;
   const double k_fac = data->k_fac;
 
-  /* Find what slice of the full mesh is stored on this MPI rank */
-  const int slice_offset = data->slice_offset;
+  /* Find what block of the full mesh is stored on this MPI rank */
+  const int* start = data->start;
+  const int* width = data->width;
 
-  /* Range of x coordinates in the full mesh handled by this call */
-  const int i_start = ((fftw_complex*)map_data - frho) + slice_offset;
+  /* Range of first-axis coordinates in the full mesh handled by this call */
+  const int i_start = ((mesh_complex*)map_data - frho) + start[0];
   const int i_end = i_start + num;
 
   /* Loop over the x range corresponding to this thread */
@@ -547,7 +745,7 @@ void mesh_apply_Green_function_mapper(void* map_data, const int num,
     const double fx = k_fac * kx_d;
     const double sinc_kx_inv = (kx != 0) ? fx / sin(fx) : 1.;
 
-    for (int j = 0; j < N; ++j) {
+    for (int j = start[1]; j < start[1] + width[1]; ++j) {
 
       /* ky component of vector in Fourier space and 1/sinc(ky) */
       const int ky = (j > N_half ? j - N : j);
@@ -555,7 +753,7 @@ void mesh_apply_Green_function_mapper(void* map_data, const int num,
       const double fy = k_fac * ky_d;
       const double sinc_ky_inv = (ky != 0) ? fy / sin(fy) : 1.;
 
-      for (int k = 0; k < N_half + 1; ++k) {
+      for (int k = start[2]; k < start[2] + width[2]; ++k) {
 
         /* kz component of vector in Fourier space and 1/sinc(kz) */
         const int kz = (k > N_half ? k - N : k);
@@ -574,19 +772,29 @@ void mesh_apply_Green_function_mapper(void* map_data, const int num,
         fourier_kernel_long_grav_eval(k2 * a_smooth2, &W);
         const double green_cor = green_fac * W / (k2 + FLT_MIN);
 
-        /* Deconvolution of CIC */
+        /* Deconvolution of the assignment window (applied twice: once for
+         * the mass assignment and once for the force interpolation) */
         const double CIC_cor = sinc_kx_inv * sinc_ky_inv * sinc_kz_inv;
-        const double CIC_cor2 = CIC_cor * CIC_cor;
-        const double CIC_cor4 = CIC_cor2 * CIC_cor2;
+        const double window_cor = integer_pow(CIC_cor, 2 * order);
 
         /* Combined correction */
-        const double total_cor = green_cor * CIC_cor4;
+        const double total_cor = green_cor * window_cor;
+
+        const size_t index =
+            ((size_t)(i - start[0]) * width[1] + (j - start[1])) * width[2] +
+            (k - start[2]);
+
+        /* Average with the interlaced mesh */
+        double re = frho[index][0];
+        double im = frho[index][1];
+        if (frho_shift != NULL)
+          mesh_interlacing_combine(data->cos_phase, data->sin_phase, i, j, k,
+                                   frho_shift[index][0], frho_shift[index][1],
+                                   &re, &im);
 
         /* Apply to the mesh */
-        const int index =
-            N * (N_half + 1) * (i - slice_offset) + (N_half + 1) * j + k;
-        frho[index][0] *= total_cor;
-        frho[index][1] *= total_cor;
+        frho[index][0] = re * total_cor;
+        frho[index][1] = im * total_cor;
       }
     }
   }
@@ -596,45 +804,158 @@ void mesh_apply_Green_function_mapper(void* map_data, const int num,
  * @brief Apply the Green function in Fourier space to the density
  * array to get the potential.
  *
- * Also deconvolves the CIC kernel.
+ * Also deconvolves the mass assignment window and, if an interlaced mesh is
+ * provided, averages it with the density field first.
+ *
+ * The local part of the Fourier-space mesh is the block
+ * [start[0], start[0] + width[0][ x [start[1], ...[ x [start[2], ...[ stored
+ * in row-major order. The Green function, the window deconvolution and the
+ * interlacing phases are all symmetric under a permutation of the axes, so
+ * the axes of the block can be any permutation of (kx, ky, kz); the whole
+ * non-distributed mesh is the block {0, 0, 0} + {N, N, N/2+1}.
  *
  * @param tp The threadpool.
- * @param frho The NxNx(N/2) complex array of the Fourier transform of the
- * density field.
- * @param slice_offset The x coordinate of the start of the slice on this MPI
- * rank
- * @param slice_width The width of the local slice on this MPI rank
+ * @param frho The local block of the Fourier transform of the density field.
+ * @param frho_shift The Fourier transform of the density field assigned with
+ * a shift of half a cell (NULL if not interlacing).
+ * @param start The first index of the local block along each axis.
+ * @param width The size of the local block along each axis.
  * @param N The dimension of the array.
+ * @param order The order of the mass assignment window.
  * @param r_s The Green function smoothing scale.
  * @param box_size The physical size of the simulation box.
  */
-void mesh_apply_Green_function(struct threadpool* tp, fftw_complex* frho,
-                               const int slice_offset, const int slice_width,
-                               const int N, const double r_s,
+void mesh_apply_Green_function(struct threadpool* tp, mesh_complex* frho,
+                               const mesh_complex* frho_shift,
+                               const int start[3], const int width[3],
+                               const int N, const int order, const double r_s,
                                const double box_size) {
 
+  /* Phase factors of the interlaced mesh */
+  double* cos_phase = NULL;
+  double* sin_phase = NULL;
+  if (frho_shift != NULL) {
+    cos_phase = (double*)malloc(N * sizeof(double));
+    sin_phase = (double*)malloc(N * sizeof(double));
+    if (cos_phase == NULL || sin_phase == NULL)
+      error("Error allocating memory for the interlacing phases");
+    mesh_interlacing_phases(N, cos_phase, sin_phase);
+  }
+
   /* Some common factors */
   struct Green_function_data data;
   data.frho = frho;
+  data.frho_shift = frho_shift;
+  data.cos_phase = cos_phase;
+  data.sin_phase = sin_phase;
   data.N = N;
+  data.order = order;
   data.green_fac = -1. / (M_PI * box_size);
   data.a_smooth2 = 4. * M_PI * M_PI * r_s * r_s / (box_size * box_size);
   data.k_fac = M_PI / (double)N;
-  data.slice_offset = slice_offset;
-  data.slice_width = slice_width;
+  for (int i = 0; i < 3; ++i) {
+    data.start[i] = start[i];
+    data.width[i] = width[i];
+  }
 
   /* Parallelize the Green function application using the threadpool
-     to split the x-axis loop over the threads.
-     The array is N x N x (N/2). We use the thread to each deal with
-     a range [i_min, i_max[ x N x (N/2) */
-  threadpool_map(tp, mesh_apply_Green_function_mapper, frho, slice_width,
-                 sizeof(fftw_complex), threadpool_auto_chunk_size, &data);
+     to split the loop over the first axis over the threads.
+     We use the thread to each deal with a range
+     [i_min, i_max[ x width[1] x width[2] */
+  threadpool_map(tp, mesh_apply_Green_function_mapper, frho, width[0],
+                 sizeof(mesh_complex), threadpool_auto_chunk_size, &data);
 
   /* Correct singularity at (0,0,0) */
-  if (slice_offset == 0 && slice_width > 0) {
+  if (start[0] == 0 && start[1] == 0 && start[2] == 0 && width[0] > 0 &&
+      width[1] > 0 && width[2] > 0) {
     frho[0][0] = 0.;
     frho[0][1] = 0.;
   }
+
+  free(cos_phase);
+  free(sin_phase);
+}
+
+/**
+ * @brief Creates the cached FFTW plans of the full (non-distributed) mesh.
+ *
+ * The plans are created only once per run, with the planner rigour requested
+ * by the user, and are then executed on the arrays of every subsequent step.
+ * Anything but FFTW_ESTIMATE overwrites the arrays while planning.
+ *
+ * @param mesh The #pm_mesh holding the plans.
+ * @param rho The N*N*N real-space array.
+ * @param frho The N*N*(N/2+1) Fourier-space array.
+ * @param verbose Are we talkative?
+ */
+static void pm_mesh_plan_global(struct pm_mesh* mesh, mesh_real* rho,
+                                mesh_complex* frho, const int verbose) {
+
+  if (mesh->forward_plan != NULL) {
+    if (verbose)
+      message("Re-using the cached FFT plans (planning took %.3f %s).",
+              mesh->planning_time, clocks_getunit());
+    return;
+  }
+
+  const ticks tic = getticks();
+  const int N = mesh->N;
+
+  mesh->forward_plan = mesh_fftw(plan_dft_r2c_3d)(
+      N, N, N, rho, frho, mesh->planner_flags | FFTW_DESTROY_INPUT);
+  mesh->inverse_plan = mesh_fftw(plan_dft_c2r_3d)(
+      N, N, N, frho, rho, mesh->planner_flags | FFTW_DESTROY_INPUT);
+  if (mesh->forward_plan == NULL || mesh->inverse_plan == NULL)
+    error("Error creating the FFTW plans of the mesh.");
+
+  mesh->planning_time = clocks_from_ticks(getticks() - tic);
+  if (verbose)
+    message("Planning the FFT took %.3f %s.", mesh->planning_time,
+            clocks_getunit());
+}
+
+#endif
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+
+/**
+ * @brief Creates the cached FFTW MPI plans of the distributed mesh.
+ *
+ * Same as pm_mesh_plan_global() but for the slab-decomposed transforms. The
+ * first two dimensions are transposed in Fourier space.
+ *
+ * @param mesh The #pm_mesh holding the plans.
+ * @param rho_slice The local slice of the real-space mesh.
+ * @param frho_slice The local slice of the Fourier-space mesh.
+ * @param verbose Are we talkative?
+ */
+static void pm_mesh_plan_distributed(struct pm_mesh* mesh, mesh_real* rho_slice,
+                                     mesh_complex* frho_slice,
+                                     const int verbose) {
+
+  if (mesh->forward_plan != NULL) {
+    if (verbose)
+      message("Re-using the cached FFT plans (planning took %.3f %s).",
+              mesh->planning_time, clocks_getunit());
+    return;
+  }
+
+  const ticks tic = getticks();
+  const int N = mesh->N;
+
+  mesh->forward_plan = mesh_fftw(mpi_plan_dft_r2c_3d)(
+      N, N, N, rho_slice, frho_slice, MPI_COMM_WORLD,
+      mesh->planner_flags | FFTW_MPI_TRANSPOSED_OUT | FFTW_DESTROY_INPUT);
+  mesh->inverse_plan = mesh_fftw(mpi_plan_dft_c2r_3d)(
+      N, N, N, frho_slice, rho_slice, MPI_COMM_WORLD,
+      mesh->planner_flags | FFTW_MPI_TRANSPOSED_IN | FFTW_DESTROY_INPUT);
+  if (mesh->forward_plan == NULL || mesh->inverse_plan == NULL)
+    error("Error creating the FFTW MPI plans of the mesh.");
+
+  mesh->planning_time = clocks_from_ticks(getticks() - tic);
+  if (verbose)
+    message("Planning the FFT took %.3f %s.", mesh->planning_time,
+            clocks_getunit());
 }
 
 #endif
@@ -644,7 +965,8 @@ void mesh_apply_Green_function(struct threadpool* tp, fftw_complex* frho,
  *
  * Interpolates the top-level multipoles on-to a mesh, move to Fourier space,
  * compute the potential including short-range correction and move back
- * to real space. We use CIC for the interpolation.
+ * to real space. We use CIC (or the higher-order window chosen by the user)
+ * for the interpolation.
  *
  * The potential is stored as a hashmap containing the potential mesh cells
  * which will be needed on this MPI rank. This is stored in
@@ -674,6 +996,7 @@ void compute_potential_distributed(struct pm_mesh* mesh, const struct space* s,
 
   /* Some useful constants */
   const int N = mesh->N;
+  const int order = mesh->assignment_order;
   const double cell_fac = N / box_size;
 
   ticks tic = getticks();
@@ -686,56 +1009,66 @@ void compute_potential_distributed(struct pm_mesh* mesh, const struct space* s,
   memset(local_patches, 0, nr_local_cells * sizeof(struct pm_mesh_patch));
 
   /* Calculate contributions to density field on this MPI rank */
-  mpi_mesh_accumulate_gparts_to_local_patches(tp, N, cell_fac, s,
-                                              local_patches);
+  mpi_mesh_accumulate_gparts_to_local_patches(tp, N, cell_fac, s, order,
+                                              /*shift=*/0., local_patches);
+
+  /* Same for the interlaced mesh shifted by half a cell */
+  struct pm_mesh_patch* local_patches_shift = NULL;
+  if (mesh->interlacing) {
+    local_patches_shift = (struct pm_mesh_patch*)malloc(
+        nr_local_cells * sizeof(struct pm_mesh_patch));
+    if (local_patches_shift == NULL)
+      error("Could not allocate array of interlaced mesh patches!");
+    memset(local_patches_shift, 0,
+           nr_local_cells * sizeof(struct pm_mesh_patch));
+    mpi_mesh_accumulate_gparts_to_local_patches(
+        tp, N, cell_fac, s, order, /*shift=*/0.5, local_patches_shift);
+  }
   if (verbose)
     message("Accumulating mass to local patches took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
-  tic = getticks();
-
   /* Ask FFTW what slice of the density field we need to store on this task.
      Note that fftw_mpi_local_size_3d works in terms of the size of the complex
      output. The last dimension of the real input is padded to 2*(N/2+1). */
   ptrdiff_t local_n0, local_0_start;
   ptrdiff_t nalloc =
-      fftw_mpi_local_size_3d((ptrdiff_t)N, (ptrdiff_t)N, (ptrdiff_t)(N / 2 + 1),
-                             MPI_COMM_WORLD, &local_n0, &local_0_start);
+      mesh_fftw(mpi_local_size_3d)((ptrdiff_t)N, (ptrdiff_t)N,
+                                   (ptrdiff_t)(N / 2 + 1), MPI_COMM_WORLD,
+                                   &local_n0, &local_0_start);
   if (verbose)
     message("Local density field slice has thickness %d.", (int)local_n0);
   if (verbose)
     message("local patch size = %d, local mesh cells = %lld", nr_local_cells,
             (long long)(local_n0 * N * N));
-  if (verbose)
-    message("Planning the FFT took %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
 
   /* Allocate storage for mesh slices.
    *
    * Note: nalloc is the number of *complex* values.
    */
-  double* rho_slice = (double*)fftw_malloc(2 * nalloc * sizeof(double));
-  memset(rho_slice, 0, 2 * nalloc * sizeof(double));
-
-  tic = getticks();
-
-  /* Construct density field slices from contributions stored in the local
-   * patches.
-   * Note: This cleans up the local_patches entries. */
-  mpi_mesh_local_patches_to_slices(N, (int)local_n0, local_patches,
-                                   nr_local_cells, rho_slice, tp, verbose);
-  if (verbose)
-    message("Assembling mesh slices took %.3f %s.",
-            clocks_from_ticks(getticks() - tic), clocks_getunit());
-
-  tic = getticks();
+  mesh_real* rho_slice =
+      (mesh_real*)mesh_fftw(malloc)(2 * nalloc * sizeof(mesh_real));
 
   /* Allocate storage for the slices of the FFT of the density mesh */
-  fftw_complex* frho_slice =
-      (fftw_complex*)fftw_malloc(nalloc * sizeof(fftw_complex));
+  mesh_complex* frho_slice =
+      (mesh_complex*)mesh_fftw(malloc)(nalloc * sizeof(mesh_complex));
+
+  /* And the same for the interlaced mesh */
+  mesh_real* rho_slice_shift = NULL;
+  mesh_complex* frho_slice_shift = NULL;
+  if (mesh->interlacing) {
+    rho_slice_shift =
+        (mesh_real*)mesh_fftw(malloc)(2 * nalloc * sizeof(mesh_real));
+    frho_slice_shift =
+        (mesh_complex*)mesh_fftw(malloc)(nalloc * sizeof(mesh_complex));
+    if (rho_slice_shift == NULL || frho_slice_shift == NULL)
+      error("Error allocating memory for the interlaced mesh slices");
+  }
 
-  /* Carry out the MPI Fourier transform. We can save a bit of time
+  /* Plan the MPI Fourier transforms on first use. We can save a bit of time
    * if we allow FFTW to transpose the first two dimensions of the output.
+   * Planning may scribble over the slices so it must happen before they are
+   * filled.
    *
    * Layout of the MPI FFTW input and output:
    *
@@ -746,11 +1079,35 @@ void compute_potential_distributed(struct pm_mesh* mesh, const struct space* s,
    * the output. Each MPI rank has slice of thickness local_n0
    * starting at local_0_start in the first dimension.
    */
-  fftw_plan mpi_plan = fftw_mpi_plan_dft_r2c_3d(
-      N, N, N, rho_slice, frho_slice, MPI_COMM_WORLD,
-      FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_OUT | FFTW_DESTROY_INPUT);
-  fftw_execute(mpi_plan);
-  fftw_destroy_plan(mpi_plan);
+  pm_mesh_plan_distributed(mesh, rho_slice, frho_slice, verbose);
+
+  memset(rho_slice, 0, 2 * nalloc * sizeof(mesh_real));
+
+  tic = getticks();
+
+  /* Construct density field slices from contributions stored in the local
+   * patches.
+   * Note: This cleans up the local_patches entries. */
+  mpi_mesh_local_patches_to_slices(N, (int)local_n0, local_patches,
+                                   nr_local_cells, rho_slice, tp, verbose);
+  if (mesh->interlacing) {
+    memset(rho_slice_shift, 0, 2 * nalloc * sizeof(mesh_real));
+    mpi_mesh_local_patches_to_slices(N, (int)local_n0, local_patches_shift,
+                                     nr_local_cells, rho_slice_shift, tp,
+                                     verbose);
+    free(local_patches_shift);
+  }
+  if (verbose)
+    message("Assembling mesh slices took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  /* Carry out the MPI Fourier transform with the cached plan */
+  mesh_fftw(mpi_execute_dft_r2c)(mesh->forward_plan, rho_slice, frho_slice);
+  if (mesh->interlacing)
+    mesh_fftw(mpi_execute_dft_r2c)(mesh->forward_plan, rho_slice_shift,
+                                   frho_slice_shift);
   if (verbose)
     message("MPI Forward Fourier transform took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
@@ -758,12 +1115,20 @@ void compute_potential_distributed(struct pm_mesh* mesh, const struct space* s,
   tic = getticks();
 
   /* Apply Green function to local slice of the MPI mesh */
-  mesh_apply_Green_function(tp, frho_slice, local_0_start, local_n0, N, r_s,
-                            box_size);
+  const int slice_start[3] = {(int)local_0_start, 0, 0};
+  const int slice_width[3] = {(int)local_n0, N, N / 2 + 1};
+  mesh_apply_Green_function(tp, frho_slice, frho_slice_shift, slice_start,
+                            slice_width, N, order, r_s, box_size);
   if (verbose)
     message("Applying Green function took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
+  /* The interlaced mesh has now been folded into the main one */
+  if (mesh->interlacing) {
+    mesh_fftw(free)(rho_slice_shift);
+    mesh_fftw(free)(frho_slice_shift);
+  }
+
   tic = getticks();
 
   /* If using linear response neutrinos, apply to local slice of the MPI mesh */
@@ -779,36 +1144,32 @@ void compute_potential_distributed(struct pm_mesh* mesh, const struct space* s,
   }
 
   /* Carry out the reverse MPI Fourier transform */
-  fftw_plan mpi_inverse_plan = fftw_mpi_plan_dft_c2r_3d(
-      N, N, N, frho_slice, rho_slice, MPI_COMM_WORLD,
-      FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_IN | FFTW_DESTROY_INPUT);
-  fftw_execute(mpi_inverse_plan);
-  fftw_destroy_plan(mpi_inverse_plan);
+  mesh_fftw(mpi_execute_dft_c2r)(mesh->inverse_plan, frho_slice, rho_slice);
 
   if (verbose)
     message("MPI Reverse Fourier transform took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
   /* We can now free the Fourier-space data */
-  fftw_free(frho_slice);
+  mesh_fftw(free)(frho_slice);
 
   tic = getticks();
 
   /* Fetch MPI mesh entries we need on this rank from other ranks */
-  mpi_mesh_fetch_potential(N, cell_fac, s, local_0_start, local_n0, rho_slice,
-                           local_patches, tp, verbose);
+  mpi_mesh_fetch_potential(N, cell_fac, s, order, local_0_start, local_n0,
+                           rho_slice, local_patches, tp, verbose);
 
   if (verbose)
     message("Fetching local potential took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
   /* Free the local slice of the potential */
-  fftw_free(rho_slice);
+  mesh_fftw(free)(rho_slice);
 
   tic = getticks();
 
   /* Compute accelerations and potentials for the gparts */
-  mpi_mesh_update_gparts(local_patches, s, tp, N, cell_fac);
+  mpi_mesh_update_gparts(local_patches, s, tp, N, cell_fac, order);
 
   /* Clean the local patches array */
   for (int i = 0; i < nr_local_cells; ++i)
@@ -824,12 +1185,235 @@ void compute_potential_distributed(struct pm_mesh* mesh, const struct space* s,
 #endif
 }
 
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+/**
+ * @brief Creates the cached 1D FFTW plans of the pencil-decomposed mesh.
+ *
+ * Same as pm_mesh_plan_distributed() but for the pencil transforms.
+ *
+ * @param mesh The #pm_mesh holding the pencils.
+ * @param rho The local real-space pencil.
+ * @param frho A complex array large enough for any of the pencil layouts.
+ * @param work A second complex array of the same size.
+ * @param verbose Are we talkative?
+ */
+static void pm_mesh_plan_pencil(struct pm_mesh* mesh, mesh_real* rho,
+                                mesh_complex* frho, mesh_complex* work,
+                                const int verbose) {
+
+  if (mesh->pencil->plan_z_forward != NULL) {
+    if (verbose)
+      message("Re-using the cached FFT plans (planning took %.3f %s).",
+              mesh->planning_time, clocks_getunit());
+    return;
+  }
+
+  const ticks tic = getticks();
+
+  pm_mesh_pencil_plan(mesh->pencil, rho, frho, work, mesh->planner_flags);
+
+  mesh->planning_time = clocks_from_ticks(getticks() - tic);
+  if (verbose)
+    message("Planning the FFT took %.3f %s.", mesh->planning_time,
+            clocks_getunit());
+}
+
+#endif
+
+/**
+ * @brief Compute the mesh forces and potential on a pencil-decomposed mesh.
+ *
+ * Same as compute_potential_distributed() but the mesh is split between the
+ * ranks in a 2D grid of pencils and transformed with 1D FFTW plans and
+ * transposes within the rows and columns of the grid of ranks. This does not
+ * require the FFTW MPI library and scales to more ranks than there are mesh
+ * cells along one axis.
+ *
+ * @param mesh The #pm_mesh used to store the potential.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param verbose Are we talkative?
+ */
+void compute_potential_distributed_pencil(struct pm_mesh* mesh,
+                                          const struct space* s,
+                                          struct threadpool* tp,
+                                          const int verbose) {
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+  const struct pm_mesh_pencil* pencil = mesh->pencil;
+  const double r_s = mesh->r_s;
+  const double box_size = s->dim[0];
+  const double dim[3] = {s->dim[0], s->dim[1], s->dim[2]};
+  const int nr_local_cells = s->nr_local_cells;
+
+  if (pencil == NULL) error("Mesh pencils have not been initialised.");
+  if (r_s <= 0.) error("Invalid value of a_smooth");
+  if (mesh->dim[0] != dim[0] || mesh->dim[1] != dim[1] ||
+      mesh->dim[2] != dim[2])
+    error("Domain size does not match the value stored in the space.");
+  if (s->e->neutrino_properties->use_linear_response)
+    error(
+        "The linear response neutrinos require a slab-decomposed distributed "
+        "mesh.");
+
+  /* Some useful constants */
+  const int N = mesh->N;
+  const int order = mesh->assignment_order;
+  const double cell_fac = N / box_size;
+  const size_t real_size = pencil->real_size;
+  const size_t complex_size = pencil->complex_size;
+
+  ticks tic = getticks();
+
+  /* Create an array of mesh patches. One per local top-level cell. */
+  struct pm_mesh_patch* local_patches = (struct pm_mesh_patch*)malloc(
+      nr_local_cells * sizeof(struct pm_mesh_patch));
+  if (local_patches == NULL)
+    error("Could not allocate array of local mesh patches!");
+  memset(local_patches, 0, nr_local_cells * sizeof(struct pm_mesh_patch));
+
+  /* Calculate contributions to density field on this MPI rank */
+  mpi_mesh_accumulate_gparts_to_local_patches(tp, N, cell_fac, s, order,
+                                              /*shift=*/0., local_patches);
+
+  /* Same for the interlaced mesh shifted by half a cell */
+  struct pm_mesh_patch* local_patches_shift = NULL;
+  if (mesh->interlacing) {
+    local_patches_shift = (struct pm_mesh_patch*)malloc(
+        nr_local_cells * sizeof(struct pm_mesh_patch));
+    if (local_patches_shift == NULL)
+      error("Could not allocate array of interlaced mesh patches!");
+    memset(local_patches_shift, 0,
+           nr_local_cells * sizeof(struct pm_mesh_patch));
+    mpi_mesh_accumulate_gparts_to_local_patches(
+        tp, N, cell_fac, s, order, /*shift=*/0.5, local_patches_shift);
+  }
+  if (verbose)
+    message("Accumulating mass to local patches took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* Allocate the local pencil and the complex arrays of the transforms */
+  mesh_real* rho = (mesh_real*)mesh_fftw(malloc)(real_size * sizeof(mesh_real));
+  mesh_complex* frho =
+      (mesh_complex*)mesh_fftw(malloc)(complex_size * sizeof(mesh_complex));
+  mesh_complex* work =
+      (mesh_complex*)mesh_fftw(malloc)(complex_size * sizeof(mesh_complex));
+  if (rho == NULL || frho == NULL || work == NULL)
+    error("Error allocating memory for the mesh pencils");
+
+  /* And the same for the interlaced mesh */
+  mesh_real* rho_shift = NULL;
+  mesh_complex* frho_shift = NULL;
+  if (mesh->interlacing) {
+    rho_shift = (mesh_real*)mesh_fftw(malloc)(real_size * sizeof(mesh_real));
+    frho_shift =
+        (mesh_complex*)mesh_fftw(malloc)(complex_size * sizeof(mesh_complex));
+    if (rho_shift == NULL || frho_shift == NULL)
+      error("Error allocating memory for the interlaced mesh pencils");
+  }
+
+  /* Plan the transforms on first use (may scribble over the arrays) */
+  pm_mesh_plan_pencil(mesh, rho, frho, work, verbose);
+
+  tic = getticks();
+
+  /* Construct the local pencil from the contributions stored in the local
+   * patches.
+   * Note: This cleans up the local_patches entries. */
+  memset(rho, 0, real_size * sizeof(mesh_real));
+  pm_mesh_pencil_patches_to_mesh(pencil, local_patches, nr_local_cells, rho,
+                                 tp, verbose);
+  if (mesh->interlacing) {
+    memset(rho_shift, 0, real_size * sizeof(mesh_real));
+    pm_mesh_pencil_patches_to_mesh(pencil, local_patches_shift,
+                                   nr_local_cells, rho_shift, tp, verbose);
+    free(local_patches_shift);
+  }
+  if (verbose)
+    message("Assembling mesh pencils took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  /* Forward transform. frho is now the local [ky][kz][kx] block */
+  pm_mesh_pencil_forward(pencil, rho, frho, work, tp);
+  if (mesh->interlacing)
+    pm_mesh_pencil_forward(pencil, rho_shift, frho_shift, work, tp);
+  if (verbose)
+    message("Pencil forward Fourier transform took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  /* Apply Green function to the local block of the Fourier-space mesh */
+  const int block_start[3] = {pencil->ky_start, pencil->kz_start, 0};
+  const int block_width[3] = {pencil->ky_width, pencil->kz_width, N};
+  mesh_apply_Green_function(tp, frho, frho_shift, block_start, block_width, N,
+                            order, r_s, box_size);
+  if (verbose)
+    message("Applying Green function took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* The interlaced mesh has now been folded into the main one */
+  if (mesh->interlacing) {
+    mesh_fftw(free)(rho_shift);
+    mesh_fftw(free)(frho_shift);
+  }
+
+  tic = getticks();
+
+  /* Inverse transform back to the local real-space pencil */
+  pm_mesh_pencil_inverse(pencil, frho, rho, work, tp);
+
+  if (verbose)
+    message("Pencil reverse Fourier transform took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* We can now free the Fourier-space data */
+  mesh_fftw(free)(frho);
+  mesh_fftw(free)(work);
+
+  tic = getticks();
+
+  /* Fetch the mesh entries we need on this rank from other ranks */
+  pm_mesh_pencil_fetch_potential(pencil, cell_fac, s, order, rho,
+                                 local_patches, tp, verbose);
+
+  if (verbose)
+    message("Fetching local potential took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* Free the local pencil of the potential */
+  mesh_fftw(free)(rho);
+
+  tic = getticks();
+
+  /* Compute accelerations and potentials for the gparts */
+  mpi_mesh_update_gparts(local_patches, s, tp, N, cell_fac, order);
+
+  /* Clean the local patches array */
+  for (int i = 0; i < nr_local_cells; ++i)
+    pm_mesh_patch_clean(&local_patches[i]);
+  free(local_patches);
+
+  if (verbose)
+    message("Computing mesh accelerations took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+#else
+  error("No MPI or FFTW library available. Cannot compute distributed mesh.");
+#endif
+}
+
 /**
  * @brief Compute the mesh forces and potential, including periodic correction.
  *
  * Interpolates the top-level multipoles on-to a mesh, move to Fourier space,
  * compute the potential including short-range correction and move back
- * to real space. We use CIC for the interpolation.
+ * to real space. We use CIC (or the higher-order window chosen by the user)
+ * for the interpolation.
  *
  * This version stores the full N*N*N mesh on each MPI rank and uses the
  * non-MPI version of FFTW.
@@ -860,30 +1444,45 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   /* Some useful constants */
   const int N = mesh->N;
   const int N_half = N / 2;
+  const int order = mesh->assignment_order;
   const double cell_fac = N / box_size;
 
   /* Use the memory allocated for the potential to temporarily store rho */
-  double* restrict rho = mesh->potential_global;
+  mesh_real* restrict rho = mesh->potential_global;
   if (rho == NULL) error("Error allocating memory for density mesh");
 
   /* Allocates some memory for the mesh in Fourier space */
-  fftw_complex* restrict frho =
-      (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * N * N * (N_half + 1));
+  mesh_complex* restrict frho = (mesh_complex*)mesh_fftw(malloc)(
+      sizeof(mesh_complex) * N * N * (N_half + 1));
   if (frho == NULL)
     error("Error allocating memory for transform of density mesh");
   memuse_log_allocation("fftw_frho", frho, 1,
-                        sizeof(fftw_complex) * N * N * (N_half + 1));
+                        sizeof(mesh_complex) * N * N * (N_half + 1));
+
+  /* Allocate the interlaced (shifted by half a cell) mesh and its transform */
+  mesh_real* restrict rho_shift = NULL;
+  mesh_complex* restrict frho_shift = NULL;
+  if (mesh->interlacing) {
+    rho_shift = (mesh_real*)mesh_fftw(malloc)(sizeof(mesh_real) * N * N * N);
+    frho_shift = (mesh_complex*)mesh_fftw(malloc)(sizeof(mesh_complex) * N *
+                                                  N * (N_half + 1));
+    if (rho_shift == NULL || frho_shift == NULL)
+      error("Error allocating memory for the interlaced density mesh");
+    memuse_log_allocation("fftw_rho_shift", rho_shift, 1,
+                          sizeof(mesh_real) * N * N * N);
+    memuse_log_allocation("fftw_frho_shift", frho_shift, 1,
+                          sizeof(mesh_complex) * N * N * (N_half + 1));
+  }
 
-  /* Prepare the FFT library */
-  fftw_plan forward_plan = fftw_plan_dft_r2c_3d(
-      N, N, N, rho, frho, FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
-  fftw_plan inverse_plan = fftw_plan_dft_c2r_3d(
-      N, N, N, frho, rho, FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
+  /* Prepare the FFT library (only plans on the first call; this may
+   * overwrite the arrays so must happen before the mass assignment) */
+  pm_mesh_plan_global(mesh, rho, frho, verbose);
 
   ticks tic = getticks();
 
   /* Zero everything */
-  bzero(rho, N * N * N * sizeof(double));
+  bzero(rho, N * N * N * sizeof(mesh_real));
+  if (mesh->interlacing) bzero(rho_shift, N * N * N * sizeof(mesh_real));
 
   /* Gather some neutrino constants if using delta-f weighting on the mesh */
   struct neutrino_model nu_model;
@@ -895,8 +1494,10 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   struct cic_mapper_data data;
   data.cells = s->cells_top;
   data.rho = rho;
+  data.rho_shift = rho_shift;
   data.potential = NULL;
   data.N = N;
+  data.order = order;
   data.use_local_patches = mesh->use_local_patches;
   data.fac = cell_fac;
   data.dim[0] = dim[0];
@@ -913,6 +1514,47 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
                    sizeof(struct gpart), threadpool_auto_chunk_size,
                    (void*)&data);
 
+  } else if (mesh->use_private_tiles) {
+
+    /* Assign the gparts of each local top-level cell to its own tile */
+    struct pm_mesh_patch* tiles = (struct pm_mesh_patch*)calloc(
+        nr_local_cells, sizeof(struct pm_mesh_patch));
+    struct pm_mesh_patch* tiles_shift = NULL;
+    if (mesh->interlacing)
+      tiles_shift = (struct pm_mesh_patch*)calloc(nr_local_cells,
+                                                  sizeof(struct pm_mesh_patch));
+    if (tiles == NULL || (mesh->interlacing && tiles_shift == NULL))
+      error("Could not allocate array of private mesh tiles!");
+
+    struct tile_mapper_data tile_data;
+    tile_data.cells = s->cells_top;
+    tile_data.local_cells = local_cells;
+    tile_data.tiles = tiles;
+    tile_data.tiles_shift = tiles_shift;
+    tile_data.N = N;
+    tile_data.order = order;
+    tile_data.fac = cell_fac;
+    tile_data.dim[0] = dim[0];
+    tile_data.dim[1] = dim[1];
+    tile_data.dim[2] = dim[2];
+    tile_data.nu_model = &nu_model;
+    threadpool_map(tp, cell_gpart_to_mesh_tile_mapper, (void*)local_cells,
+                   nr_local_cells, sizeof(int), threadpool_auto_chunk_size,
+                   (void*)&tile_data);
+
+    /* Reduce the tiles onto the mesh(es) in a deterministic order */
+    mesh_tiles_to_global_mesh(tiles, nr_local_cells, rho, N, tp);
+    if (tiles_shift != NULL)
+      mesh_tiles_to_global_mesh(tiles_shift, nr_local_cells, rho_shift, N, tp);
+
+    /* Clean-up */
+    for (int i = 0; i < nr_local_cells; ++i) {
+      pm_mesh_patch_clean(&tiles[i]);
+      if (tiles_shift != NULL) pm_mesh_patch_clean(&tiles_shift[i]);
+    }
+    free(tiles);
+    free(tiles_shift);
+
   } else { /* Normal case */
 
     /* Do a parallel CIC mesh assignment of the gparts but only using
@@ -932,8 +1574,19 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   tic = getticks();
 
   /* Merge everybody's share of the density mesh */
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  MPI_Allreduce(MPI_IN_PLACE, rho, N * N * N, MPI_FLOAT, MPI_SUM,
+                MPI_COMM_WORLD);
+  if (mesh->interlacing)
+    MPI_Allreduce(MPI_IN_PLACE, rho_shift, N * N * N, MPI_FLOAT, MPI_SUM,
+                  MPI_COMM_WORLD);
+#else
   MPI_Allreduce(MPI_IN_PLACE, rho, N * N * N, MPI_DOUBLE, MPI_SUM,
                 MPI_COMM_WORLD);
+  if (mesh->interlacing)
+    MPI_Allreduce(MPI_IN_PLACE, rho_shift, N * N * N, MPI_DOUBLE, MPI_SUM,
+                  MPI_COMM_WORLD);
+#endif
 
   if (verbose)
     message("Mesh MPI-reduction took %.3f %s.",
@@ -946,7 +1599,9 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   tic = getticks();
 
   /* Fourier transform to go to magic-land */
-  fftw_execute(forward_plan);
+  mesh_fftw(execute_dft_r2c)(mesh->forward_plan, rho, frho);
+  if (mesh->interlacing)
+    mesh_fftw(execute_dft_r2c)(mesh->forward_plan, rho_shift, frho_shift);
 
   if (verbose)
     message("Forward Fourier transform took %.3f %s.",
@@ -958,13 +1613,23 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   tic = getticks();
 
   /* Now de-convolve the CIC kernel and apply the Green function */
-  mesh_apply_Green_function(tp, frho, /*slice_offset=*/0, /*slice_width=*/N,
-                            /* mesh_size=*/N, r_s, box_size);
+  const int mesh_start[3] = {0, 0, 0};
+  const int mesh_width[3] = {N, N, N / 2 + 1};
+  mesh_apply_Green_function(tp, frho, frho_shift, mesh_start, mesh_width,
+                            /* mesh_size=*/N, order, r_s, box_size);
 
   if (verbose)
     message("Applying Green function took %.3f %s.",
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
+  /* The interlaced mesh has now been folded into the main one */
+  if (mesh->interlacing) {
+    memuse_log_allocation("fftw_rho_shift", rho_shift, 0, 0);
+    mesh_fftw(free)(rho_shift);
+    memuse_log_allocation("fftw_frho_shift", frho_shift, 0, 0);
+    mesh_fftw(free)(frho_shift);
+  }
+
   tic = getticks();
 
   /* If using linear response neutrinos, apply the response to the mesh */
@@ -980,7 +1645,7 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   }
 
   /* Fourier transform to come back from magic-land */
-  fftw_execute(inverse_plan);
+  mesh_fftw(execute_dft_c2r)(mesh->inverse_plan, frho, rho);
 
   if (verbose)
     message("Reverse Fourier transform took %.3f %s.",
@@ -1000,8 +1665,10 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
   /* Gather the mesh shared information to be used by the threads */
   data.cells = s->cells_top;
   data.rho = NULL;
+  data.rho_shift = NULL;
   data.potential = mesh->potential_global;
   data.N = N;
+  data.order = order;
   data.fac = cell_fac;
   data.dim[0] = dim[0];
   data.dim[1] = dim[1];
@@ -1030,10 +1697,8 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
             clocks_from_ticks(getticks() - tic), clocks_getunit());
 
   /* Clean-up the mess */
-  fftw_destroy_plan(forward_plan);
-  fftw_destroy_plan(inverse_plan);
   memuse_log_allocation("fftw_frho", frho, 0, 0);
-  fftw_free(frho);
+  mesh_fftw(free)(frho);
 
 #else
   error("No FFTW library found. Cannot compute periodic long-range forces.");
@@ -1045,10 +1710,12 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
  *
  * Interpolates the top-level multipoles on-to a mesh, move to Fourier space,
  * compute the potential including short-range correction and move back
- * to real space. We use CIC for the interpolation.
+ * to real space. We use CIC (or the higher-order window chosen by the user)
+ * for the interpolation.
  *
  * This function calls the appropriate implementation depending on whether
- * we're using the MPI version of FFTW.
+ * the mesh is distributed and, if so, whether it is split in slabs (FFTW MPI)
+ * or in pencils.
  *
  * @param mesh The #pm_mesh used to store the potential.
  * @param s The #space containing the particles.
@@ -1057,7 +1724,9 @@ void compute_potential_global(struct pm_mesh* mesh, const struct space* s,
  */
 void pm_mesh_compute_potential(struct pm_mesh* mesh, const struct space* s,
                                struct threadpool* tp, const int verbose) {
-  if (mesh->distributed_mesh) {
+  if (mesh->distributed_mesh && mesh->distributed_mesh_pencils) {
+    compute_potential_distributed_pencil(mesh, s, tp, verbose);
+  } else if (mesh->distributed_mesh) {
     compute_potential_distributed(mesh, s, tp, verbose);
   } else {
     compute_potential_global(mesh, s, tp, verbose);
@@ -1079,11 +1748,12 @@ void pm_mesh_allocate(struct pm_mesh* mesh) {
     const int N = mesh->N;
 
     /* Allocate the memory for the combined density and potential array */
-    mesh->potential_global = (double*)fftw_malloc(sizeof(double) * N * N * N);
+    mesh->potential_global =
+        (mesh_real*)mesh_fftw(malloc)(sizeof(mesh_real) * N * N * N);
     if (mesh->potential_global == NULL)
       error("Error allocating memory for the long-range gravity mesh.");
     memuse_log_allocation("fftw_mesh.potential", mesh->potential_global, 1,
-                          sizeof(double) * N * N * N);
+                          sizeof(mesh_real) * N * N * N);
   }
 #else
   error("No FFTW library found. Cannot compute periodic long-range forces.");
@@ -1101,7 +1771,7 @@ void pm_mesh_free(struct pm_mesh* mesh) {
 
   if (!mesh->distributed_mesh && mesh->potential_global) {
     memuse_log_allocation("fftw_mesh.potential", mesh->potential_global, 0, 0);
-    free(mesh->potential_global);
+    mesh_fftw(free)(mesh->potential_global);
     mesh->potential_global = NULL;
   }
 
@@ -1119,15 +1789,15 @@ void initialise_fftw(int N, int nr_threads) {
 
 #ifdef HAVE_THREADED_FFTW
   /* Initialise the thread-parallel FFTW version */
-  if (N >= 64) fftw_init_threads();
+  if (N >= 64) mesh_fftw(init_threads)();
 #endif
 #if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
   /* Initialize FFTW MPI support - must be called after fftw_init_threads() */
-  fftw_mpi_init();
+  mesh_fftw(mpi_init)();
 #endif
 #ifdef HAVE_THREADED_FFTW
   /* Set  number of threads to use */
-  if (N >= 64) fftw_plan_with_nthreads(nr_threads);
+  if (N >= 64) mesh_fftw(plan_with_nthreads)(nr_threads);
 #endif
 }
 
@@ -1154,7 +1824,11 @@ void pm_mesh_init(struct pm_mesh* mesh, const struct gravity_props* props,
   mesh->periodic = 1;
   mesh->N = N;
   mesh->distributed_mesh = props->distributed_mesh;
+  mesh->distributed_mesh_pencils = props->distributed_mesh_pencils;
   mesh->use_local_patches = props->mesh_uses_local_patches;
+  mesh->use_private_tiles = props->mesh_uses_private_tiles;
+  mesh->assignment_order = props->mesh_assignment_order;
+  mesh->interlacing = props->mesh_interlacing;
   mesh->dim[0] = dim[0];
   mesh->dim[1] = dim[1];
   mesh->dim[2] = dim[2];
@@ -1163,7 +1837,24 @@ void pm_mesh_init(struct pm_mesh* mesh, const struct gravity_props* props,
   mesh->r_s_inv = 1. / mesh->r_s;
   mesh->r_cut_max = mesh->r_s * props->r_cut_max_ratio;
   mesh->r_cut_min = mesh->r_s * props->r_cut_min_ratio;
+  switch (props->mesh_fftw_planner) {
+    case 0:
+      mesh->planner_flags = FFTW_ESTIMATE;
+      break;
+    case 1:
+      mesh->planner_flags = FFTW_MEASURE;
+      break;
+    case 2:
+      mesh->planner_flags = FFTW_PATIENT;
+      break;
+    default:
+      error("Invalid FFTW planner choice (%d).", props->mesh_fftw_planner);
+  }
   mesh->potential_global = NULL;
+  mesh->forward_plan = NULL;
+  mesh->inverse_plan = NULL;
+  mesh->planning_time = 0.;
+  mesh->pencil = NULL;
   mesh->ti_beg_mesh_last = -1;
   mesh->ti_end_mesh_last = -1;
   mesh->ti_beg_mesh_next = -1;
@@ -1174,11 +1865,23 @@ void pm_mesh_init(struct pm_mesh* mesh, const struct gravity_props* props,
         "Mesh too big. The number of cells is larger than 2^31. "
         "Use a mesh side-length <= 1290 or a distributed mesh.");
 
+  if (mesh->assignment_order < 2 ||
+      mesh->assignment_order > mesh_assignment_max_width)
+    error("Invalid mesh assignment order (%d).", mesh->assignment_order);
+
   if (2. * mesh->r_cut_max > box_size)
     error("Mesh too small or r_cut_max too big for this box size");
 
   initialise_fftw(N, mesh->nr_threads);
 
+  if (mesh->distributed_mesh && mesh->distributed_mesh_pencils) {
+    mesh->pencil =
+        (struct pm_mesh_pencil*)malloc(sizeof(struct pm_mesh_pencil));
+    if (mesh->pencil == NULL)
+      error("Error allocating memory for the mesh pencils");
+    pm_mesh_pencil_init(mesh->pencil, N, engine_rank == 0);
+  }
+
   pm_mesh_allocate(mesh);
 
 #else
@@ -1219,11 +1922,27 @@ void pm_mesh_init_no_mesh(struct pm_mesh* mesh, double dim[3]) {
  */
 void pm_mesh_clean(struct pm_mesh* mesh) {
 
+#ifdef HAVE_FFTW
+  /* The plans must go before FFTW itself */
+  if (mesh->forward_plan != NULL)
+    mesh_fftw(destroy_plan)(mesh->forward_plan);
+  if (mesh->inverse_plan != NULL)
+    mesh_fftw(destroy_plan)(mesh->inverse_plan);
+  mesh->forward_plan = NULL;
+  mesh->inverse_plan = NULL;
+#endif
+
+  if (mesh->pencil != NULL) {
+    pm_mesh_pencil_clean(mesh->pencil);
+    free(mesh->pencil);
+    mesh->pencil = NULL;
+  }
+
 #ifdef HAVE_THREADED_FFTW
-  fftw_cleanup_threads();
+  mesh_fftw(cleanup_threads)();
 #endif
 #if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
-  fftw_mpi_cleanup();
+  mesh_fftw(mpi_cleanup)();
 #endif
 
   pm_mesh_free(mesh);
@@ -1257,7 +1976,24 @@ void pm_mesh_struct_restore(struct pm_mesh* mesh, FILE* stream) {
 #ifdef HAVE_FFTW
     const int N = mesh->N;
 
+    /* The plans do not survive a restart. They will be re-created on first
+     * use, hopefully from the wisdom we saved. */
+    mesh->forward_plan = NULL;
+    mesh->inverse_plan = NULL;
+    mesh->planning_time = 0.;
+
     initialise_fftw(N, mesh->nr_threads);
+
+    /* The communicators of the pencils are re-created as well */
+    mesh->pencil = NULL;
+    if (mesh->distributed_mesh && mesh->distributed_mesh_pencils) {
+      mesh->pencil =
+          (struct pm_mesh_pencil*)malloc(sizeof(struct pm_mesh_pencil));
+      if (mesh->pencil == NULL)
+        error("Error allocating memory for the mesh pencils");
+      pm_mesh_pencil_init(mesh->pencil, N, engine_rank == 0);
+    }
+
     pm_mesh_allocate(mesh);
 
 #else
@@ -1265,3 +2001,143 @@ void pm_mesh_struct_restore(struct pm_mesh* mesh, FILE* stream) {
 #endif
   }
 }
+
+#ifdef HAVE_FFTW
+/**
+ * @brief Builds the name of the file storing the FFTW wisdom.
+ *
+ * @param restart_dir The directory holding the restart files.
+ * @param flavour The FFTW flavour ("fftw" or "fftwf").
+ * @param filename (return) The name of the file.
+ * @param size The size of the filename buffer.
+ */
+static void pm_mesh_fftw_wisdom_name(const char* restart_dir,
+                                     const char* flavour, char* filename,
+                                     const size_t size) {
+  if (snprintf(filename, size, "%s/%s_wisdom.dat", restart_dir, flavour) >=
+      (int)size)
+    error("FFTW wisdom file name is too long.");
+}
+#endif
+
+/**
+ * @brief Reads the FFTW wisdom saved next to the restart files by a previous
+ * run, if any.
+ *
+ * This lets FFTW skip most of the (expensive) measurements when creating the
+ * mesh and power spectrum plans. Must be called before any plan is created.
+ * With the FFTW MPI library, rank 0 reads the file and broadcasts it.
+ *
+ * When the mesh is in single precision, the wisdom of the two FFTW flavours
+ * (double for the power spectra, single for the mesh) is kept in two files.
+ *
+ * @param restart_dir The directory holding the restart files.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_import_fftw_wisdom(const char* restart_dir, const int verbose) {
+
+#ifdef HAVE_FFTW
+  const ticks tic = getticks();
+
+  /* FFTW must be told about threads and MPI before anything else */
+#ifdef HAVE_THREADED_FFTW
+  fftw_init_threads();
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  fftwf_init_threads();
+#endif
+#endif
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  fftw_mpi_init();
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  fftwf_mpi_init();
+#endif
+#endif
+
+  char filename[PARSER_MAX_LINE_SIZE + 32];
+  pm_mesh_fftw_wisdom_name(restart_dir, "fftw", filename, sizeof(filename));
+
+  int found = 0;
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  if (engine_rank == 0) found = fftw_import_wisdom_from_filename(filename);
+  MPI_Bcast(&found, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (found) fftw_mpi_broadcast_wisdom(MPI_COMM_WORLD);
+#else
+  found = fftw_import_wisdom_from_filename(filename);
+#endif
+
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  char filename_f[PARSER_MAX_LINE_SIZE + 32];
+  pm_mesh_fftw_wisdom_name(restart_dir, "fftwf", filename_f,
+                           sizeof(filename_f));
+
+  int found_f = 0;
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  if (engine_rank == 0) found_f = fftwf_import_wisdom_from_filename(filename_f);
+  MPI_Bcast(&found_f, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (found_f) fftwf_mpi_broadcast_wisdom(MPI_COMM_WORLD);
+#else
+  found_f = fftwf_import_wisdom_from_filename(filename_f);
+#endif
+  found += found_f;
+#endif
+
+  if (engine_rank == 0 && found)
+    message("Imported FFTW wisdom from '%s' (took %.3f %s).", restart_dir,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+  else if (engine_rank == 0 && verbose)
+    message("No FFTW wisdom found in '%s'.", restart_dir);
+#endif
+}
+
+/**
+ * @brief Saves the wisdom accumulated by FFTW next to the restart files.
+ *
+ * With the FFTW MPI library, the wisdom of all ranks is gathered on rank 0,
+ * so this must be called by all ranks. The files are written under a temporary
+ * name and then moved into place so that a crash never leaves a truncated
+ * file behind.
+ *
+ * @param restart_dir The directory holding the restart files.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_export_fftw_wisdom(const char* restart_dir, const int verbose) {
+
+#ifdef HAVE_FFTW
+  const ticks tic = getticks();
+
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+  fftw_mpi_gather_wisdom(MPI_COMM_WORLD);
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  fftwf_mpi_gather_wisdom(MPI_COMM_WORLD);
+#endif
+#endif
+
+  if (engine_rank != 0) return;
+
+  char filename[PARSER_MAX_LINE_SIZE + 32];
+  char tmp_filename[PARSER_MAX_LINE_SIZE + 64];
+  pm_mesh_fftw_wisdom_name(restart_dir, "fftw", filename, sizeof(filename));
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+
+  if (!fftw_export_wisdom_to_filename(tmp_filename) ||
+      rename(tmp_filename, filename) != 0) {
+    message("WARNING: Could not write the FFTW wisdom to '%s'.", filename);
+    return;
+  }
+
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  pm_mesh_fftw_wisdom_name(restart_dir, "fftwf", filename, sizeof(filename));
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+
+  if (!fftwf_export_wisdom_to_filename(tmp_filename) ||
+      rename(tmp_filename, filename) != 0) {
+    message("WARNING: Could not write the FFTW wisdom to '%s'.", filename);
+    return;
+  }
+#endif
+
+  if (verbose)
+    message("Writing FFTW wisdom to '%s' took %.3f %s.", restart_dir,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+#endif
+}
@@ -24,6 +24,7 @@
 
 /* Local headers */
 #include "gravity_properties.h"
+#include "mesh_gravity_fftw.h"
 #include "timeline.h"
 
 /* Forward declarations */
@@ -32,6 +33,7 @@ struct space;
 struct gpart;
 struct threadpool;
 struct cell;
+struct pm_mesh_pencil;
 
 /**
  * @brief Data structure for the long-range periodic forces using a mesh
@@ -50,10 +52,23 @@ struct pm_mesh {
   /*! Whether mesh is distributed between MPI ranks */
   int distributed_mesh;
 
+  /*! Is the distributed mesh split in pencils rather than slabs? */
+  int distributed_mesh_pencils;
+
   /*! Whether or not to use local patches rather than
    * direct atomic writes to the mesh when running without MPI */
   int use_local_patches;
 
+  /*! Whether or not to deposit the mass into private per-cell tiles reduced
+   * in a deterministic order (non-distributed mesh only) */
+  int use_private_tiles;
+
+  /*! Order of the mass assignment window (2: CIC, 3: TSC, 4: PCS) */
+  int assignment_order;
+
+  /*! Do we average the mesh with a copy shifted by half a cell? */
+  int interlacing;
+
   /*! Integer time-step end of the mesh force for the last step */
   integertime_t ti_end_mesh_last;
 
@@ -85,7 +100,24 @@ struct pm_mesh {
   double r_cut_min;
 
   /*! Full N*N*N potential field */
-  double *potential_global;
+  mesh_real *potential_global;
+
+  /*! FFTW planner rigour (FFTW_ESTIMATE, FFTW_MEASURE, ...) */
+  unsigned int planner_flags;
+
+#ifdef HAVE_FFTW
+  /*! Cached real-to-complex plan (NULL until the first mesh step) */
+  mesh_plan forward_plan;
+
+  /*! Cached complex-to-real plan (NULL until the first mesh step) */
+  mesh_plan inverse_plan;
+
+  /*! Time spent creating the cached plans (in clocks_getunit() units) */
+  double planning_time;
+#endif
+
+  /*! Pencil decomposition of the distributed mesh (NULL if not used) */
+  struct pm_mesh_pencil *pencil;
 };
 
 void pm_mesh_init(struct pm_mesh *mesh, const struct gravity_props *props,
@@ -98,6 +130,10 @@ void pm_mesh_clean(struct pm_mesh *mesh);
 void pm_mesh_allocate(struct pm_mesh *mesh);
 void pm_mesh_free(struct pm_mesh *mesh);
 
+/* FFTW wisdom. */
+void pm_mesh_import_fftw_wisdom(const char *restart_dir, int verbose);
+void pm_mesh_export_fftw_wisdom(const char *restart_dir, int verbose);
+
 /* Dump/restore. */
 void pm_mesh_struct_dump(const struct pm_mesh *p, FILE *stream);
 void pm_mesh_struct_restore(struct pm_mesh *p, FILE *stream);
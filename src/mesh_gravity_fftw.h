@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_MESH_GRAVITY_FFTW_H
+#define SWIFT_MESH_GRAVITY_FFTW_H
+
+/* Config parameters. */
+#include <config.h>
+
+#ifdef HAVE_FFTW
+#include <fftw3.h>
+#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#include <fftw3-mpi.h>
+#endif
+#endif
+
+/* Local includes. */
+#include "atomic.h"
+#include "inline.h"
+
+/*
+ * Precision of the long-range gravity mesh.
+ *
+ * The density/potential mesh and its Fourier transform are stored and
+ * transformed in double precision unless the code is configured with
+ * --enable-mesh-single-precision, in which case the single-precision flavour
+ * of FFTW (fftwf_*) is used instead. The CIC weights, the local patches, the
+ * Green function factors and the interpolation back onto the particles are
+ * always evaluated in double precision.
+ *
+ * mesh_fftw(name) expands to the FFTW function or type of the mesh precision,
+ * e.g. mesh_fftw(execute_dft_r2c) is either fftw_execute_dft_r2c or
+ * fftwf_execute_dft_r2c.
+ */
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+typedef float mesh_real;
+#define mesh_fftw(name) fftwf_##name
+#else
+typedef double mesh_real;
+#define mesh_fftw(name) fftw_##name
+#endif
+
+#ifdef HAVE_FFTW
+typedef mesh_fftw(complex) mesh_complex;
+typedef mesh_fftw(plan) mesh_plan;
+#endif
+
+/**
+ * @brief Atomically adds a contribution to a mesh cell.
+ *
+ * @param address The mesh cell to update.
+ * @param y The value to add.
+ */
+__attribute__((always_inline)) INLINE static void mesh_atomic_add(
+    volatile mesh_real *const address, const double y) {
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  atomic_add_f(address, (float)y);
+#else
+  atomic_add_d(address, y);
+#endif
+}
+
+#endif /* SWIFT_MESH_GRAVITY_FFTW_H */
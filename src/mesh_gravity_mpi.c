@@ -35,6 +35,7 @@
 #include "error.h"
 #include "exchange_structs.h"
 #include "lock.h"
+#include "mesh_assignment.h"
 #include "mesh_gravity_patch.h"
 #include "mesh_gravity_sort.h"
 #include "neutrino.h"
@@ -56,20 +57,25 @@
  * @param dim The dimensions of the simulation box.
  * @param cell The #cell containing the particles.
  * @param patch The local mesh patch
+ * @param order The order of the mass assignment window.
+ * @param shift Shift of the particle positions in units of mesh cells.
  * @param nu_model Struct with neutrino constants
  *
  */
 void accumulate_cell_to_local_patch(const int N, const double fac,
                                     const double *dim, const struct cell *cell,
                                     struct pm_mesh_patch *patch,
+                                    const int order, const double shift,
                                     const struct neutrino_model *nu_model) {
 
   /* If the cell is empty, then there's nothing to do
      (and the code to find the extent of the cell would fail) */
   if (cell->grav.count == 0) return;
 
-  /* Initialise the local mesh patch */
-  pm_mesh_patch_init(patch, cell, N, fac, dim, /*boundary_size=*/1);
+  /* Initialise the local mesh patch. One cell of boundary is enough for all
+   * the windows; shifted positions can move one cell further up. */
+  const int boundary_size = (shift != 0.) ? 2 : 1;
+  pm_mesh_patch_init(patch, cell, N, fac, dim, boundary_size);
   pm_mesh_patch_zero(patch);
 
   /* Loop over particles in this cell */
@@ -85,18 +91,13 @@ void accumulate_cell_to_local_patch(const int N, const double fac,
     const double pos_z =
         box_wrap(gp->x[2], patch->wrap_min[2], patch->wrap_max[2]);
 
-    /* Workout the CIC coefficients */
-    int i = (int)floor(fac * pos_x);
-    const double dx = fac * pos_x - i;
-    const double tx = 1. - dx;
-
-    int j = (int)floor(fac * pos_y);
-    const double dy = fac * pos_y - j;
-    const double ty = 1. - dy;
-
-    int k = (int)floor(fac * pos_z);
-    const double dz = fac * pos_z - k;
-    const double tz = 1. - dz;
+    /* Workout the window coefficients */
+    double wx[mesh_assignment_max_width];
+    double wy[mesh_assignment_max_width];
+    double wz[mesh_assignment_max_width];
+    const int i = mesh_assignment_weights(fac * pos_x + shift, order, wx);
+    const int j = mesh_assignment_weights(fac * pos_y + shift, order, wy);
+    const int k = mesh_assignment_weights(fac * pos_z + shift, order, wz);
 
     /* Get coordinates within the mesh patch */
     const int ii = i - patch->mesh_min[0];
@@ -111,7 +112,7 @@ void accumulate_cell_to_local_patch(const int N, const double fac,
     /* Accumulate contributions to the local mesh patch */
     const double mass = gp->mass;
     const double value = mass * weight;
-    pm_mesh_patch_CIC_set(patch, ii, jj, kk, tx, ty, tz, dx, dy, dz, value);
+    pm_mesh_patch_window_set(patch, ii, jj, kk, wx, wy, wz, order, value);
   }
 }
 
@@ -124,7 +125,9 @@ struct accumulate_mapper_data {
   const int *local_cells;
   struct pm_mesh_patch *local_patches;
   int N;
+  int order;
   double fac;
+  double shift;
   double dim[3];
   struct neutrino_model *nu_model;
 };
@@ -144,7 +147,9 @@ void accumulate_cell_to_local_patches_mapper(void *map_data, int num,
       (struct accumulate_mapper_data *)extra;
   const struct cell *cells = data->cells;
   const int N = data->N;
+  const int order = data->order;
   const double fac = data->fac;
+  const double shift = data->shift;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
   const struct neutrino_model *nu_model = data->nu_model;
 
@@ -165,7 +170,8 @@ void accumulate_cell_to_local_patches_mapper(void *map_data, int num,
     if (c->grav.count == 0) continue;
 
     /* Assign this cell's content to the mesh */
-    accumulate_cell_to_local_patch(N, fac, dim, c, &local_patches[i], nu_model);
+    accumulate_cell_to_local_patch(N, fac, dim, c, &local_patches[i], order,
+                                   shift, nu_model);
   }
 }
 
@@ -179,14 +185,16 @@ void accumulate_cell_to_local_patches_mapper(void *map_data, int num,
  * @param N The size of the mesh
  * @param fac Inverse of the cell size
  * @param s The #space containing the particles.
+ * @param order The order of the mass assignment window.
+ * @param shift Shift of the particle positions in units of mesh cells.
  * @param local_patches The array of *local* mesh patches.
  *
  */
 void mpi_mesh_accumulate_gparts_to_local_patches(
     struct threadpool *tp, const int N, const double fac, const struct space *s,
-    struct pm_mesh_patch *local_patches) {
+    const int order, const double shift, struct pm_mesh_patch *local_patches) {
 
-#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#ifdef WITH_MPI
   const int *local_cells = s->local_cells_top;
   const int nr_local_cells = s->nr_local_cells;
   const double dim[3] = {s->dim[0], s->dim[1], s->dim[2]};
@@ -203,7 +211,9 @@ void mpi_mesh_accumulate_gparts_to_local_patches(
   data.local_cells = local_cells;
   data.local_patches = local_patches;
   data.N = N;
+  data.order = order;
   data.fac = fac;
+  data.shift = shift;
   data.dim[0] = dim[0];
   data.dim[1] = dim[1];
   data.dim[2] = dim[2];
@@ -211,10 +221,9 @@ void mpi_mesh_accumulate_gparts_to_local_patches(
   threadpool_map(tp, accumulate_cell_to_local_patches_mapper,
                  (void *)local_cells, nr_local_cells, sizeof(int),
                  threadpool_auto_chunk_size, (void *)&data);
-  if (lock_destroy(&lock) != 0) error("Impossible to destroy lock!");
 
 #else
-  error("FFTW MPI not found - unable to use distributed mesh");
+  error("No MPI library available - unable to use distributed mesh");
 #endif
 }
 
@@ -278,7 +287,7 @@ void mesh_patches_to_sorted_array(const struct pm_mesh_patch *local_patches,
  */
 void mpi_mesh_local_patches_to_slices(const int N, const int local_n0,
                                       struct pm_mesh_patch *local_patches,
-                                      const int nr_patches, double *mesh,
+                                      const int nr_patches, mesh_real *mesh,
                                       struct threadpool *tp,
                                       const int verbose) {
 
@@ -486,6 +495,41 @@ void mpi_mesh_local_patches_to_slices(const int N, const int local_n0,
 #endif
 }
 
+/**
+ * @brief Determine the range of FFT mesh cells needed to interpolate the
+ * potential to the particles of a top-level cell.
+ *
+ * The 5 point stencil used for accelerations requires 2 neighbouring FFT mesh
+ * cells in each direction on top of the cells touched by the assignment window
+ * (for CIC evaluation of the accelerations, one extra FFT mesh cell in the +ve
+ * direction).
+ *
+ * We also have to add a small buffer to avoid problems with rounding
+ *
+ * TODO: can we calculate exactly how big the rounding error can be?
+ * Will just assume that 1% of a mesh cell is enough for now.
+ *
+ * @param cell The top-level #cell.
+ * @param fac Inverse of the FFT mesh cell size
+ * @param order The order of the mass assignment window.
+ * @param ixmin (return) The first mesh cell needed along each axis.
+ * @param ixmax (return) The last mesh cell needed along each axis.
+ */
+static void required_mesh_cells_range(const struct cell *cell, const double fac,
+                                      const int order, int ixmin[3],
+                                      int ixmax[3]) {
+
+  const double low = 2. + mesh_assignment_reach_low(order) + 0.01;
+  const double high = 2. + mesh_assignment_reach_high(order) + 0.01;
+
+  for (int idim = 0; idim < 3; idim++) {
+    const double xmin = cell->loc[idim] - low / fac;
+    const double xmax = cell->loc[idim] + cell->width[idim] + high / fac;
+    ixmin[idim] = (int)floor(xmin * fac);
+    ixmax[idim] = (int)floor(xmax * fac);
+  }
+}
+
 /**
  * @brief Count the number of mesh cells we will need to request from other
  * nodes
@@ -493,9 +537,10 @@ void mpi_mesh_local_patches_to_slices(const int N, const int local_n0,
  * @param N the mesh size.
  * @param fac Inverse of the FFT mesh cell size
  * @param s The #space containing the particles.
+ * @param order The order of the mass assignment window.
  */
 size_t count_required_mesh_cells(const int N, const double fac,
-                                 const struct space *s) {
+                                 const struct space *s, const int order) {
 
   const int *local_cells = s->local_cells_top;
   const int nr_local_cells = s->nr_local_cells;
@@ -511,23 +556,10 @@ size_t count_required_mesh_cells(const int N, const double fac,
     if (cell->grav.count == 0) continue;
 
     /* Determine range of FFT mesh cells we need for particles in this top
-     * level cell. The 5 point stencil used for accelerations requires
-     * 2 neighbouring FFT mesh cells in each direction and for CIC
-     * evaluation of the accelerations we need one extra FFT mesh cell
-     * in the +ve direction.
-     *
-     * We also have to add a small buffer to avoid problems with rounding
-     *
-     * TODO: can we calculate exactly how big the rounding error can be?
-     * Will just assume that 1% of a mesh cell is enough for now.*/
+     * level cell. */
     int ixmin[3];
     int ixmax[3];
-    for (int idim = 0; idim < 3; idim++) {
-      const double xmin = cell->loc[idim] - 2.01 / fac;
-      const double xmax = cell->loc[idim] + cell->width[idim] + 3.01 / fac;
-      ixmin[idim] = (int)floor(xmin * fac);
-      ixmax[idim] = (int)floor(xmax * fac);
-    }
+    required_mesh_cells_range(cell, fac, order, ixmin, ixmax);
 
     const int delta_i = (ixmax[0] - ixmin[0]) + 1;
     const int delta_j = (ixmax[1] - ixmin[1]) + 1;
@@ -548,7 +580,7 @@ size_t count_required_mesh_cells(const int N, const double fac,
 }
 
 size_t init_required_mesh_cells(const int N, const double fac,
-                                const struct space *s,
+                                const struct space *s, const int order,
                                 struct mesh_key_value_pot *send_cells) {
 
   const int *local_cells = s->local_cells_top;
@@ -565,24 +597,10 @@ size_t init_required_mesh_cells(const int N, const double fac,
     if (cell->grav.count == 0) continue;
 
     /* Determine range of FFT mesh cells we need for particles in this top
-       level cell. The 5 point stencil used for accelerations requires
-       2 neighbouring FFT mesh cells in each direction and for CIC
-       evaluation of the accelerations we need one extra FFT mesh cell
-       in the +ve direction.
-
-       We also have to add a small buffer to avoid problems with rounding
-
-       TODO: can we calculate exactly how big the rounding error can be?
-       Will just assume that 1% of a mesh cell is enough for now.
-    */
+       level cell. */
     int ixmin[3];
     int ixmax[3];
-    for (int idim = 0; idim < 3; idim++) {
-      const double xmin = cell->loc[idim] - 2.01 / fac;
-      const double xmax = cell->loc[idim] + cell->width[idim] + 3.01 / fac;
-      ixmin[idim] = (int)floor(xmin * fac);
-      ixmax[idim] = (int)floor(xmax * fac);
-    }
+    required_mesh_cells_range(cell, fac, order, ixmin, ixmax);
 
 #ifdef SWIFT_DEBUG_CHECKS
     const int delta_i = (ixmax[0] - ixmin[0]) + 1;
@@ -636,7 +654,7 @@ size_t init_required_mesh_cells(const int N, const double fac,
 }
 
 void fill_local_patches_from_mesh_cells(
-    const int N, const double fac, const struct space *s,
+    const int N, const double fac, const struct space *s, const int order,
     const struct mesh_key_value_pot *mesh_cells,
     struct pm_mesh_patch *local_patches, const size_t nr_send_tot) {
 
@@ -664,12 +682,10 @@ void fill_local_patches_from_mesh_cells(
       patch->wrap_max[i] = cell->loc[i] + 0.5 * cell->width[i] + 0.5 * dim[i];
     }
 
+    required_mesh_cells_range(cell, fac, order, patch->mesh_min,
+                              patch->mesh_max);
     int num_cells = 1;
     for (int i = 0; i < 3; i++) {
-      const double xmin = cell->loc[i] - 2.01 / fac;
-      const double xmax = cell->loc[i] + cell->width[i] + 3.01 / fac;
-      patch->mesh_min[i] = (int)floor(xmin * fac);
-      patch->mesh_max[i] = (int)floor(xmax * fac);
       patch->mesh_size[i] = patch->mesh_max[i] - patch->mesh_min[i] + 1;
       num_cells *= patch->mesh_size[i];
     }
@@ -736,11 +752,12 @@ void fill_local_patches_from_mesh_cells(
  *
  * We need all cells containing points -2 and +3 mesh cell widths
  * away from each particle along each axis to compute the
- * potential gradient.
+ * potential gradient (one more on each side for the TSC and PCS windows).
  *
  * @param N The size of the mesh
  * @param fac Inverse of the FFT mesh cell size
  * @param s The #space containing the particles.
+ * @param order The order of the mass assignment window.
  * @param local_0_start Offset to the first mesh x coordinate on this rank
  * @param local_n0 Width of the mesh slab on this rank
  * @param potential_slice Array with the potential on the local slice of the
@@ -749,8 +766,9 @@ void fill_local_patches_from_mesh_cells(
  * @param verbose Are we talkative?
  */
 void mpi_mesh_fetch_potential(const int N, const double fac,
-                              const struct space *s, const int local_0_start,
-                              const int local_n0, double *potential_slice,
+                              const struct space *s, const int order,
+                              const int local_0_start, const int local_n0,
+                              mesh_real *potential_slice,
                               struct pm_mesh_patch *local_patches,
                               struct threadpool *tp, const int verbose) {
 
@@ -764,7 +782,7 @@ void mpi_mesh_fetch_potential(const int N, const double fac,
   ticks tic = getticks();
 
   /* Determine how many mesh cells we will need to request */
-  const size_t nr_send_tot = count_required_mesh_cells(N, fac, s);
+  const size_t nr_send_tot = count_required_mesh_cells(N, fac, s, order);
 
   if (verbose)
     message(" - Counting required mesh patches took %.3f %s.",
@@ -780,7 +798,7 @@ void mpi_mesh_fetch_potential(const int N, const double fac,
 
   /* Initialise the mesh cells we will request */
   const size_t check_count =
-      init_required_mesh_cells(N, fac, s, send_cells_unsorted);
+      init_required_mesh_cells(N, fac, s, order, send_cells_unsorted);
 
   if (nr_send_tot != check_count)
     error("Count and initialisation incompatible!");
@@ -972,7 +990,7 @@ void mpi_mesh_fetch_potential(const int N, const double fac,
   tic = getticks();
 
   /* Initialise the local patches with the data we just received */
-  fill_local_patches_from_mesh_cells(N, fac, s, send_cells_sorted,
+  fill_local_patches_from_mesh_cells(N, fac, s, order, send_cells_sorted,
                                      local_patches, nr_send_tot);
 
   if (verbose)
@@ -988,14 +1006,16 @@ void mpi_mesh_fetch_potential(const int N, const double fac,
 
 /**
  * @brief Computes the potential on a gpart from a given mesh using the CIC
- * method.
+ * method (or the higher-order window chosen by the user).
  *
  * @param gp The #gpart.
  * @param patch The local mesh patch
+ * @param order The order of the mass assignment window.
  */
-#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#ifdef WITH_MPI
 void mesh_patch_to_gparts_CIC(struct gpart *gp,
-                              const struct pm_mesh_patch *patch) {
+                              const struct pm_mesh_patch *patch,
+                              const int order) {
 
   const double fac = patch->fac;
 
@@ -1007,18 +1027,13 @@ void mesh_patch_to_gparts_CIC(struct gpart *gp,
   const double pos_z =
       box_wrap(gp->x[2], patch->wrap_min[2], patch->wrap_max[2]);
 
-  /* Workout the CIC coefficients */
-  int i = (int)floor(fac * pos_x);
-  const double dx = fac * pos_x - i;
-  const double tx = 1. - dx;
-
-  int j = (int)floor(fac * pos_y);
-  const double dy = fac * pos_y - j;
-  const double ty = 1. - dy;
-
-  int k = (int)floor(fac * pos_z);
-  const double dz = fac * pos_z - k;
-  const double tz = 1. - dz;
+  /* Workout the window coefficients */
+  double wx[mesh_assignment_max_width];
+  double wy[mesh_assignment_max_width];
+  double wz[mesh_assignment_max_width];
+  const int i = mesh_assignment_weights(fac * pos_x, order, wx);
+  const int j = mesh_assignment_weights(fac * pos_y, order, wy);
+  const int k = mesh_assignment_weights(fac * pos_z, order, wz);
 
 #ifdef SWIFT_GRAVITY_FORCE_CHECKS
   if (gp->a_grav_mesh[0] != 0.) error("Particle with non-initalised stuff");
@@ -1037,35 +1052,35 @@ void mesh_patch_to_gparts_CIC(struct gpart *gp,
   const int kk = k - patch->mesh_min[2];
 
   /* Simple CIC for the potential itself */
-  p += pm_mesh_patch_CIC_get(patch, ii, jj, kk, tx, ty, tz, dx, dy, dz);
+  p += pm_mesh_patch_window_get(patch, ii, jj, kk, wx, wy, wz, order);
 
   /* 5-point stencil along each axis for the accelerations */
   a[0] += (1. / 12.) *
-          pm_mesh_patch_CIC_get(patch, ii + 2, jj, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii + 2, jj, kk, wx, wy, wz, order);
   a[0] -= (2. / 3.) *
-          pm_mesh_patch_CIC_get(patch, ii + 1, jj, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii + 1, jj, kk, wx, wy, wz, order);
   a[0] += (2. / 3.) *
-          pm_mesh_patch_CIC_get(patch, ii - 1, jj, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii - 1, jj, kk, wx, wy, wz, order);
   a[0] -= (1. / 12.) *
-          pm_mesh_patch_CIC_get(patch, ii - 2, jj, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii - 2, jj, kk, wx, wy, wz, order);
 
   a[1] += (1. / 12.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj + 2, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj + 2, kk, wx, wy, wz, order);
   a[1] -= (2. / 3.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj + 1, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj + 1, kk, wx, wy, wz, order);
   a[1] += (2. / 3.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj - 1, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj - 1, kk, wx, wy, wz, order);
   a[1] -= (1. / 12.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj - 2, kk, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj - 2, kk, wx, wy, wz, order);
 
   a[2] += (1. / 12.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj, kk + 2, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj, kk + 2, wx, wy, wz, order);
   a[2] -= (2. / 3.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj, kk + 1, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj, kk + 1, wx, wy, wz, order);
   a[2] += (2. / 3.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj, kk - 1, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj, kk - 1, wx, wy, wz, order);
   a[2] -= (1. / 12.) *
-          pm_mesh_patch_CIC_get(patch, ii, jj, kk - 2, tx, ty, tz, dx, dy, dz);
+          pm_mesh_patch_window_get(patch, ii, jj, kk - 2, wx, wy, wz, order);
 
   /* Store things back */
   gp->a_grav_mesh[0] = fac * a[0];
@@ -1088,14 +1103,15 @@ void mesh_patch_to_gparts_CIC(struct gpart *gp,
  * @param fac Inverse of the FFT mesh cell size
  * @param const_G Gravitional constant
  * @param dim Dimensions of the #space
+ * @param order The order of the mass assignment window.
  */
 void cell_distributed_mesh_to_gpart_CIC(const struct cell *c,
                                         const struct pm_mesh_patch *patch,
                                         const int N, const double fac,
                                         const float const_G,
-                                        const double dim[3]) {
+                                        const double dim[3], const int order) {
 
-#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#ifdef WITH_MPI
 
   const int gcount = c->grav.count;
   struct gpart *gparts = c->grav.parts;
@@ -1116,7 +1132,7 @@ void cell_distributed_mesh_to_gpart_CIC(const struct cell *c,
     gp->potential_mesh = 0.f;
 #endif
 
-    mesh_patch_to_gparts_CIC(gp, patch);
+    mesh_patch_to_gparts_CIC(gp, patch, order);
 
     gp->a_grav_mesh[0] *= const_G;
     gp->a_grav_mesh[1] *= const_G;
@@ -1127,7 +1143,7 @@ void cell_distributed_mesh_to_gpart_CIC(const struct cell *c,
   }
 
 #else
-  error("FFTW MPI not found - unable to use distributed mesh");
+  error("No MPI library available - unable to use distributed mesh");
 #endif
 }
 
@@ -1140,6 +1156,7 @@ struct distributed_cic_mapper_data {
   const int *local_cells;
   const struct pm_mesh_patch *local_patches;
   int N;
+  int order;
   double fac;
   double dim[3];
   float const_G;
@@ -1155,13 +1172,14 @@ struct distributed_cic_mapper_data {
 void cell_distributed_mesh_to_gpart_CIC_mapper(void *map_data, int num,
                                                void *extra) {
 
-#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#ifdef WITH_MPI
 
   /* Unpack the shared information */
   const struct distributed_cic_mapper_data *data =
       (struct distributed_cic_mapper_data *)extra;
   const struct cell *cells = data->cells;
   const int N = data->N;
+  const int order = data->order;
   const double fac = data->fac;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
   const float const_G = data->const_G;
@@ -1181,19 +1199,20 @@ void cell_distributed_mesh_to_gpart_CIC_mapper(void *map_data, int num,
 
     /* Update acceleration and potential for gparts in this cell */
     cell_distributed_mesh_to_gpart_CIC(c, &local_patches[i], N, fac, const_G,
-                                       dim);
+                                       dim, order);
   }
 
 #else
-  error("FFTW MPI not found - unable to use distributed mesh");
+  error("No MPI library available - unable to use distributed mesh");
 #endif
 }
 
 void mpi_mesh_update_gparts(struct pm_mesh_patch *local_patches,
                             const struct space *s, struct threadpool *tp,
-                            const int N, const double cell_fac) {
+                            const int N, const double cell_fac,
+                            const int order) {
 
-#if defined(WITH_MPI) && defined(HAVE_MPI_FFTW)
+#ifdef WITH_MPI
 
   const int *local_cells = s->local_cells_top;
   const int nr_local_cells = s->nr_local_cells;
@@ -1204,6 +1223,7 @@ void mpi_mesh_update_gparts(struct pm_mesh_patch *local_patches,
   data.local_cells = local_cells;
   data.local_patches = local_patches;
   data.N = N;
+  data.order = order;
   data.fac = cell_fac;
   data.dim[0] = s->dim[0];
   data.dim[1] = s->dim[1];
@@ -1219,6 +1239,6 @@ void mpi_mesh_update_gparts(struct pm_mesh_patch *local_patches,
                    threadpool_auto_chunk_size, (void *)&data);
   }
 #else
-  error("FFTW MPI not found - unable to use distributed mesh");
+  error("No MPI library available - unable to use distributed mesh");
 #endif
 }
@@ -22,6 +22,12 @@
 /* Config parameters. */
 #include <config.h>
 
+/* Standard headers */
+#include <stddef.h>
+
+/* Local headers */
+#include "mesh_gravity_fftw.h"
+
 /* Forward declarations */
 struct space;
 struct cell;
@@ -29,28 +35,50 @@ struct threadpool;
 struct pm_mesh;
 struct pm_mesh_patch;
 struct neutrino_model;
+struct mesh_key_value_rho;
+struct mesh_key_value_pot;
 
 void accumulate_cell_to_local_patch(const int N, const double fac,
                                     const double *dim, const struct cell *cell,
                                     struct pm_mesh_patch *patch,
+                                    const int order, const double shift,
                                     const struct neutrino_model *nu_model);
 
 void mpi_mesh_accumulate_gparts_to_local_patches(
     struct threadpool *tp, const int N, const double fac, const struct space *s,
-    struct pm_mesh_patch *local_patches);
+    const int order, const double shift, struct pm_mesh_patch *local_patches);
+
+void mesh_patches_to_sorted_array(const struct pm_mesh_patch *local_patches,
+                                  const int nr_patches,
+                                  struct mesh_key_value_rho *array,
+                                  const size_t size);
+
+size_t count_required_mesh_cells(const int N, const double fac,
+                                 const struct space *s, const int order);
+
+size_t init_required_mesh_cells(const int N, const double fac,
+                                const struct space *s, const int order,
+                                struct mesh_key_value_pot *send_cells);
+
+void fill_local_patches_from_mesh_cells(
+    const int N, const double fac, const struct space *s, const int order,
+    const struct mesh_key_value_pot *mesh_cells,
+    struct pm_mesh_patch *local_patches, const size_t nr_send_tot);
 
 void mpi_mesh_local_patches_to_slices(const int N, const int local_n0,
                                       struct pm_mesh_patch *local_patches,
-                                      const int nr_patches, double *mesh,
+                                      const int nr_patches, mesh_real *mesh,
                                       struct threadpool *tp, const int verbose);
 
 void mpi_mesh_fetch_potential(const int N, const double fac,
-                              const struct space *s, int local_0_start,
-                              int local_n0, double *potential_slice,
+                              const struct space *s, const int order,
+                              int local_0_start, int local_n0,
+                              mesh_real *potential_slice,
                               struct pm_mesh_patch *local_patches,
                               struct threadpool *tp, const int verbose);
 
 void mpi_mesh_update_gparts(struct pm_mesh_patch *local_patches,
                             const struct space *s, struct threadpool *tp,
-                            const int N, const double cell_fac);
+                            const int N, const double cell_fac,
+                            const int order);
 #endif
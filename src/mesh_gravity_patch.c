@@ -108,7 +108,7 @@ void pm_mesh_patch_init(struct pm_mesh_patch *patch, const struct cell *cell,
  * @param global_mesh The global mesh to write to.
  * @param patch The #pm_mesh_patch object to write from.
  */
-void pm_add_patch_to_global_mesh(double *const global_mesh,
+void pm_add_patch_to_global_mesh(mesh_real *const global_mesh,
                                  const struct pm_mesh_patch *patch) {
 
   const int N = patch->N;
@@ -134,7 +134,7 @@ void pm_add_patch_to_global_mesh(double *const global_mesh,
         const int patch_index = pm_mesh_patch_index(patch, i, j, k);
         const int mesh_index = row_major_id_periodic(ii, jj, kk, N);
 
-        atomic_add_d(&global_mesh[mesh_index], mesh[patch_index]);
+        mesh_atomic_add(&global_mesh[mesh_index], mesh[patch_index]);
       }
     }
   }
@@ -27,6 +27,7 @@
 #include "align.h"
 #include "error.h"
 #include "inline.h"
+#include "mesh_gravity_fftw.h"
 
 /* Forward declarations */
 struct cell;
@@ -96,78 +97,69 @@ __attribute__((always_inline)) INLINE static int pm_mesh_patch_index(
 }
 
 /**
- * @brief Cloud in cell evaluation of the mesh patch
+ * @brief Evaluation of the mesh patch with the mass assignment window
  *
  * @param patch Pointer to the patch
- * @param i Integer x coordinate in the mesh patch
- * @param j Integer y coordinate in the mesh patch
- * @param k Integer z coordinate in the mesh patch
- * @param tx CIC parameter in the x direction
- * @param ty CIC parameter in the y direction
- * @param tz CIC parameter in the z direction
- * @param dx CIC parameter in the x direction
- * @param dy CIC parameter in the y direction
- * @param dz CIC parameter in the z direction
- *
+ * @param i Integer x coordinate of the first cell in the mesh patch
+ * @param j Integer y coordinate of the first cell in the mesh patch
+ * @param k Integer z coordinate of the first cell in the mesh patch
+ * @param wx Window weights in the x direction
+ * @param wy Window weights in the y direction
+ * @param wz Window weights in the z direction
+ * @param order Order of the window (number of cells along each axis)
  */
-__attribute__((always_inline)) INLINE static double pm_mesh_patch_CIC_get(
+__attribute__((always_inline)) INLINE static double pm_mesh_patch_window_get(
     const struct pm_mesh_patch *patch, const int i, const int j, const int k,
-    const double tx, const double ty, const double tz, const double dx,
-    const double dy, const double dz) {
+    const double *wx, const double *wy, const double *wz, const int order) {
 
   /* Remind the compiler that the arrays are nicely aligned */
   swift_declare_aligned_ptr(const double, mesh, patch->mesh,
                             SWIFT_CACHE_ALIGNMENT);
 
-  double temp;
-
-  /* Classic 3D CIC */
-  temp = mesh[pm_mesh_patch_index(patch, i + 0, j + 0, k + 0)] * tx * ty * tz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 0, j + 0, k + 1)] * tx * ty * dz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 0, j + 1, k + 0)] * tx * dy * tz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 0, j + 1, k + 1)] * tx * dy * dz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 1, j + 0, k + 0)] * dx * ty * tz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 1, j + 0, k + 1)] * dx * ty * dz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 1, j + 1, k + 0)] * dx * dy * tz;
-  temp += mesh[pm_mesh_patch_index(patch, i + 1, j + 1, k + 1)] * dx * dy * dz;
+  double temp = 0.;
+  for (int ii = 0; ii < order; ++ii) {
+    for (int jj = 0; jj < order; ++jj) {
+      const double wxy = wx[ii] * wy[jj];
+      for (int kk = 0; kk < order; ++kk)
+        temp += mesh[pm_mesh_patch_index(patch, i + ii, j + jj, k + kk)] *
+                wxy * wz[kk];
+    }
+  }
   return temp;
 }
 
 /**
- * @brief Cloud in cell assignment to the mesh patch
+ * @brief Assignment to the mesh patch with the mass assignment window
  *
  * @param patch Pointer to the patch
- * @param i Integer x coordinate in the mesh patch
- * @param j Integer y coordinate in the mesh patch
- * @param k Integer z coordinate in the mesh patch
- * @param tx CIC parameter in the x direction
- * @param ty CIC parameter in the y direction
- * @param tz CIC parameter in the z direction
- * @param dx CIC parameter in the x direction
- * @param dy CIC parameter in the y direction
- * @param dz CIC parameter in the z direction
+ * @param i Integer x coordinate of the first cell in the mesh patch
+ * @param j Integer y coordinate of the first cell in the mesh patch
+ * @param k Integer z coordinate of the first cell in the mesh patch
+ * @param wx Window weights in the x direction
+ * @param wy Window weights in the y direction
+ * @param wz Window weights in the z direction
+ * @param order Order of the window (number of cells along each axis)
  * @param value The value to set
  */
-__attribute__((always_inline)) INLINE static void pm_mesh_patch_CIC_set(
+__attribute__((always_inline)) INLINE static void pm_mesh_patch_window_set(
     const struct pm_mesh_patch *patch, const int i, const int j, const int k,
-    const double tx, const double ty, const double tz, const double dx,
-    const double dy, const double dz, const double value) {
+    const double *wx, const double *wy, const double *wz, const int order,
+    const double value) {
 
   /* Remind the compiler that the arrays are nicely aligned */
   swift_declare_aligned_ptr(double, mesh, patch->mesh, SWIFT_CACHE_ALIGNMENT);
 
-  /* Classic 3D CIC */
-  mesh[pm_mesh_patch_index(patch, i + 0, j + 0, k + 0)] += value * tx * ty * tz;
-  mesh[pm_mesh_patch_index(patch, i + 0, j + 0, k + 1)] += value * tx * ty * dz;
-  mesh[pm_mesh_patch_index(patch, i + 0, j + 1, k + 0)] += value * tx * dy * tz;
-  mesh[pm_mesh_patch_index(patch, i + 0, j + 1, k + 1)] += value * tx * dy * dz;
-  mesh[pm_mesh_patch_index(patch, i + 1, j + 0, k + 0)] += value * dx * ty * tz;
-  mesh[pm_mesh_patch_index(patch, i + 1, j + 0, k + 1)] += value * dx * ty * dz;
-  mesh[pm_mesh_patch_index(patch, i + 1, j + 1, k + 0)] += value * dx * dy * tz;
-  mesh[pm_mesh_patch_index(patch, i + 1, j + 1, k + 1)] += value * dx * dy * dz;
+  for (int ii = 0; ii < order; ++ii) {
+    for (int jj = 0; jj < order; ++jj) {
+      const double wxy = value * wx[ii] * wy[jj];
+      for (int kk = 0; kk < order; ++kk)
+        mesh[pm_mesh_patch_index(patch, i + ii, j + jj, k + kk)] +=
+            wxy * wz[kk];
+    }
+  }
 }
 
-void pm_add_patch_to_global_mesh(double *const global_mesh,
+void pm_add_patch_to_global_mesh(mesh_real *const global_mesh,
                                  const struct pm_mesh_patch *patch);
 
 #endif
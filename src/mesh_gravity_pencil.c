@@ -0,0 +1,885 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+/* Standard headers */
+#include <limits.h>
+#include <string.h>
+
+/* This object's header. */
+#include "mesh_gravity_pencil.h"
+
+/* Local includes. */
+#include "engine.h"
+#include "error.h"
+#include "exchange_structs.h"
+#include "mesh_gravity_mpi.h"
+#include "mesh_gravity_patch.h"
+#include "mesh_gravity_sort.h"
+#include "row_major_id.h"
+#include "space.h"
+#include "threadpool.h"
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+/**
+ * @brief Index of a mesh cell in the local real-space pencil.
+ *
+ * @param pencil The #pm_mesh_pencil.
+ * @param key The padded row-major id of the mesh cell in the full mesh.
+ */
+__attribute__((always_inline)) INLINE static size_t pencil_local_index(
+    const struct pm_mesh_pencil *pencil, const size_t key) {
+
+  const int N = pencil->N;
+  const int x = get_xcoord_from_padded_row_major_id(key, N) - pencil->x_start;
+  const int y = get_ycoord_from_padded_row_major_id(key, N) - pencil->y_start;
+  const int z = get_zcoord_from_padded_row_major_id(key, N);
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (x < 0 || x >= pencil->x_width)
+    error("Mesh cell is not in the local pencil (x=%d)", x + pencil->x_start);
+  if (y < 0 || y >= pencil->y_width)
+    error("Mesh cell is not in the local pencil (y=%d)", y + pencil->y_start);
+  if (z < 0 || z >= N) error("Mesh cell is not in the mesh (z=%d)", z);
+#endif
+
+  return ((size_t)x * pencil->y_width + y) * N + z;
+}
+
+/**
+ * @brief Copies a run of complex values between a mesh layout and a
+ * communication buffer.
+ *
+ * @param array The location in the mesh layout.
+ * @param buffer The location in the communication buffer.
+ * @param count The number of complex values to copy.
+ * @param to_buffer Are we copying from the mesh to the buffer (or back)?
+ */
+__attribute__((always_inline)) INLINE static void pencil_copy(
+    mesh_complex *array, mesh_complex *buffer, const int count,
+    const int to_buffer) {
+
+  if (to_buffer)
+    memcpy(buffer, array, count * sizeof(mesh_complex));
+  else
+    memcpy(array, buffer, count * sizeof(mesh_complex));
+}
+
+/**
+ * @brief Shared information about a transpose to be used by all the threads
+ * in the pool.
+ */
+struct pencil_transpose_data {
+  const struct pm_mesh_pencil *pencil;
+  mesh_complex *array;
+  mesh_complex *buffer;
+  int to_buffer;
+};
+
+/**
+ * @brief Mapper between the [x][y][kz] layout and the send buffer of the
+ * row transpose, ordered as [p][x][y][kz in block p].
+ *
+ * @param map_data The mesh array (used to find the range of local x).
+ * @param num The number of local x values to process.
+ * @param extra The #pencil_transpose_data.
+ */
+static void pencil_row_local_mapper(void *map_data, int num, void *extra) {
+
+  const struct pencil_transpose_data *data =
+      (struct pencil_transpose_data *)extra;
+  const struct pm_mesh_pencil *pencil = data->pencil;
+  const int Nz = pencil->N / 2 + 1;
+  const int ny = pencil->y_width;
+  const int P = pencil->dims[1];
+
+  const int x_start = (mesh_complex *)map_data - data->array;
+
+  for (int x = x_start; x < x_start + num; ++x) {
+    for (int p = 0; p < P; ++p) {
+      const int kz0 = mesh_pencil_block_start(p, Nz, P);
+      const int nkz = mesh_pencil_block_width(p, Nz, P);
+      for (int y = 0; y < ny; ++y) {
+        const size_t ia = ((size_t)x * ny + y) * Nz + kz0;
+        const size_t ib =
+            pencil->row_send_displs[p] + ((size_t)x * ny + y) * nkz;
+        pencil_copy(&data->array[ia], &data->buffer[ib], nkz, data->to_buffer);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Mapper between the receive buffer of the row transpose, ordered as
+ * [p][x][y in block p][kz], and the [x][kz][y] layout.
+ *
+ * @param map_data The mesh array (used to find the range of local x).
+ * @param num The number of local x values to process.
+ * @param extra The #pencil_transpose_data.
+ */
+static void pencil_row_remote_mapper(void *map_data, int num, void *extra) {
+
+  const struct pencil_transpose_data *data =
+      (struct pencil_transpose_data *)extra;
+  const struct pm_mesh_pencil *pencil = data->pencil;
+  const int N = pencil->N;
+  const int nkz = pencil->kz_width;
+  const int P = pencil->dims[1];
+
+  const int x_start = (mesh_complex *)map_data - data->array;
+
+  for (int x = x_start; x < x_start + num; ++x) {
+    for (int p = 0; p < P; ++p) {
+      const int y0 = mesh_pencil_block_start(p, N, P);
+      const int ny = mesh_pencil_block_width(p, N, P);
+      for (int y = 0; y < ny; ++y) {
+        for (int kz = 0; kz < nkz; ++kz) {
+          const size_t ia = ((size_t)x * nkz + kz) * N + y0 + y;
+          const size_t ib =
+              pencil->row_recv_displs[p] + ((size_t)x * ny + y) * nkz + kz;
+          pencil_copy(&data->array[ia], &data->buffer[ib], 1, data->to_buffer);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Mapper between the [x][kz][ky] layout and the send buffer of the
+ * column transpose, ordered as [q][x][kz][ky in block q].
+ *
+ * @param map_data The mesh array (used to find the range of local x).
+ * @param num The number of local x values to process.
+ * @param extra The #pencil_transpose_data.
+ */
+static void pencil_col_local_mapper(void *map_data, int num, void *extra) {
+
+  const struct pencil_transpose_data *data =
+      (struct pencil_transpose_data *)extra;
+  const struct pm_mesh_pencil *pencil = data->pencil;
+  const int N = pencil->N;
+  const int nkz = pencil->kz_width;
+  const int Q = pencil->dims[0];
+
+  const int x_start = (mesh_complex *)map_data - data->array;
+
+  for (int x = x_start; x < x_start + num; ++x) {
+    for (int q = 0; q < Q; ++q) {
+      const int ky0 = mesh_pencil_block_start(q, N, Q);
+      const int nky = mesh_pencil_block_width(q, N, Q);
+      for (int kz = 0; kz < nkz; ++kz) {
+        const size_t ia = ((size_t)x * nkz + kz) * N + ky0;
+        const size_t ib =
+            pencil->col_send_displs[q] + ((size_t)x * nkz + kz) * nky;
+        pencil_copy(&data->array[ia], &data->buffer[ib], nky, data->to_buffer);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Mapper between the receive buffer of the column transpose, ordered
+ * as [q][x in block q][kz][ky], and the [ky][kz][x] layout.
+ *
+ * @param map_data The mesh array (used to find the range of global x).
+ * @param num The number of global x values to process.
+ * @param extra The #pencil_transpose_data.
+ */
+static void pencil_col_remote_mapper(void *map_data, int num, void *extra) {
+
+  const struct pencil_transpose_data *data =
+      (struct pencil_transpose_data *)extra;
+  const struct pm_mesh_pencil *pencil = data->pencil;
+  const int N = pencil->N;
+  const int nkz = pencil->kz_width;
+  const int nky = pencil->ky_width;
+  const int Q = pencil->dims[0];
+
+  const int x_start = (mesh_complex *)map_data - data->array;
+
+  for (int x = x_start; x < x_start + num; ++x) {
+
+    /* Rank of the column that sent us this x */
+    const int q = mesh_pencil_block_owner(x, N, Q);
+    const int xq = x - mesh_pencil_block_start(q, N, Q);
+
+    for (int kz = 0; kz < nkz; ++kz) {
+      for (int ky = 0; ky < nky; ++ky) {
+        const size_t ia = ((size_t)ky * nkz + kz) * N + x;
+        const size_t ib =
+            pencil->col_recv_displs[q] + ((size_t)xq * nkz + kz) * nky + ky;
+        pencil_copy(&data->array[ia], &data->buffer[ib], 1, data->to_buffer);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Runs one of the transpose mappers over the threadpool.
+ *
+ * @param pencil The #pm_mesh_pencil.
+ * @param mapper The mapper function.
+ * @param count The number of x values to process.
+ * @param array The mesh layout.
+ * @param buffer The communication buffer.
+ * @param to_buffer Are we copying from the mesh to the buffer (or back)?
+ * @param tp The #threadpool object.
+ */
+static void pencil_transpose_map(const struct pm_mesh_pencil *pencil,
+                                 threadpool_map_function mapper,
+                                 const int count, mesh_complex *array,
+                                 mesh_complex *buffer, const int to_buffer,
+                                 struct threadpool *tp) {
+
+  struct pencil_transpose_data data;
+  data.pencil = pencil;
+  data.array = array;
+  data.buffer = buffer;
+  data.to_buffer = to_buffer;
+  threadpool_map(tp, mapper, array, count, sizeof(mesh_complex),
+                 threadpool_auto_chunk_size, &data);
+}
+
+/**
+ * @brief All-to-all exchange of complex values within a row or column of the
+ * grid of ranks.
+ */
+static void pencil_alltoall(const struct pm_mesh_pencil *pencil,
+                            mesh_complex *sendbuf, const int *send_counts,
+                            const int *send_displs, mesh_complex *recvbuf,
+                            const int *recv_counts, const int *recv_displs,
+                            MPI_Comm comm) {
+
+  if (MPI_Alltoallv(sendbuf, send_counts, send_displs, pencil->complex_type,
+                    recvbuf, recv_counts, recv_displs, pencil->complex_type,
+                    comm) != MPI_SUCCESS)
+    error("Failed to exchange the mesh pencils.");
+}
+
+/**
+ * @brief Transpose within a row of the grid of ranks between the [x][y][kz]
+ * layout (y local, all kz) and the [x][kz][y] layout (kz local, all y).
+ *
+ * The data is read from in and the result written to out. Both arrays are
+ * used as scratch space.
+ *
+ * @param pencil The #pm_mesh_pencil.
+ * @param in The input array.
+ * @param out The output array.
+ * @param inverse Are we going from [x][kz][y] back to [x][y][kz]?
+ * @param tp The #threadpool object.
+ */
+static void pencil_transpose_row(const struct pm_mesh_pencil *pencil,
+                                 mesh_complex *in, mesh_complex *out,
+                                 const int inverse, struct threadpool *tp) {
+
+  const int nx = pencil->x_width;
+
+  if (!inverse) {
+    pencil_transpose_map(pencil, pencil_row_local_mapper, nx, in, out,
+                         /*to_buffer=*/1, tp);
+    pencil_alltoall(pencil, out, pencil->row_send_counts,
+                    pencil->row_send_displs, in, pencil->row_recv_counts,
+                    pencil->row_recv_displs, pencil->comm_row);
+    pencil_transpose_map(pencil, pencil_row_remote_mapper, nx, out, in,
+                         /*to_buffer=*/0, tp);
+  } else {
+    pencil_transpose_map(pencil, pencil_row_remote_mapper, nx, in, out,
+                         /*to_buffer=*/1, tp);
+    pencil_alltoall(pencil, out, pencil->row_recv_counts,
+                    pencil->row_recv_displs, in, pencil->row_send_counts,
+                    pencil->row_send_displs, pencil->comm_row);
+    pencil_transpose_map(pencil, pencil_row_local_mapper, nx, out, in,
+                         /*to_buffer=*/0, tp);
+  }
+}
+
+/**
+ * @brief Transpose within a column of the grid of ranks between the
+ * [x][kz][ky] layout (x local, all ky) and the [ky][kz][x] layout (ky local,
+ * all x).
+ *
+ * The data is read from in and the result written to out. Both arrays are
+ * used as scratch space.
+ *
+ * @param pencil The #pm_mesh_pencil.
+ * @param in The input array.
+ * @param out The output array.
+ * @param inverse Are we going from [ky][kz][x] back to [x][kz][ky]?
+ * @param tp The #threadpool object.
+ */
+static void pencil_transpose_col(const struct pm_mesh_pencil *pencil,
+                                 mesh_complex *in, mesh_complex *out,
+                                 const int inverse, struct threadpool *tp) {
+
+  const int N = pencil->N;
+  const int nx = pencil->x_width;
+
+  if (!inverse) {
+    pencil_transpose_map(pencil, pencil_col_local_mapper, nx, in, out,
+                         /*to_buffer=*/1, tp);
+    pencil_alltoall(pencil, out, pencil->col_send_counts,
+                    pencil->col_send_displs, in, pencil->col_recv_counts,
+                    pencil->col_recv_displs, pencil->comm_col);
+    pencil_transpose_map(pencil, pencil_col_remote_mapper, N, out, in,
+                         /*to_buffer=*/0, tp);
+  } else {
+    pencil_transpose_map(pencil, pencil_col_remote_mapper, N, in, out,
+                         /*to_buffer=*/1, tp);
+    pencil_alltoall(pencil, out, pencil->col_recv_counts,
+                    pencil->col_recv_displs, in, pencil->col_send_counts,
+                    pencil->col_send_displs, pencil->comm_col);
+    pencil_transpose_map(pencil, pencil_col_local_mapper, nx, out, in,
+                         /*to_buffer=*/0, tp);
+  }
+}
+
+#endif
+
+/**
+ * @brief Sets up the pencil decomposition of the distributed mesh.
+ *
+ * Arranges the ranks in a 2D grid, creates the row and column communicators
+ * and pre-computes the counts of the two transposes.
+ *
+ * @param pencil The #pm_mesh_pencil to initialise.
+ * @param N The size of the mesh along one axis.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_pencil_init(struct pm_mesh_pencil *pencil, const int N,
+                         const int verbose) {
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+  int nr_nodes, nodeID;
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+  MPI_Comm_rank(MPI_COMM_WORLD, &nodeID);
+
+  bzero(pencil, sizeof(struct pm_mesh_pencil));
+  pencil->N = N;
+
+  /* Arrange the ranks in a grid as square as possible */
+  if (MPI_Dims_create(nr_nodes, 2, pencil->dims) != MPI_SUCCESS)
+    error("Failed to create the grid of ranks of the mesh.");
+
+  const int Nz = N / 2 + 1;
+  const int P0 = pencil->dims[0];
+  const int P1 = pencil->dims[1];
+  if (P0 > N || P1 > Nz)
+    error("Mesh of side-length %d too small to be split in %d x %d pencils.",
+          N, P0, P1);
+
+  /* Our place in the grid (must match mesh_pencil_rank_from_key()) */
+  const int c0 = nodeID / P1;
+  const int c1 = nodeID % P1;
+  pencil->coords[0] = c0;
+  pencil->coords[1] = c1;
+
+  /* Communicators of our row and column, ranked by position in the grid */
+  if (MPI_Comm_split(MPI_COMM_WORLD, c0, c1, &pencil->comm_row) !=
+          MPI_SUCCESS ||
+      MPI_Comm_split(MPI_COMM_WORLD, c1, c0, &pencil->comm_col) !=
+          MPI_SUCCESS)
+    error("Failed to create the communicators of the mesh pencils.");
+
+  /* Our blocks along each axis in each of the layouts */
+  pencil->x_start = mesh_pencil_block_start(c0, N, P0);
+  pencil->x_width = mesh_pencil_block_width(c0, N, P0);
+  pencil->y_start = mesh_pencil_block_start(c1, N, P1);
+  pencil->y_width = mesh_pencil_block_width(c1, N, P1);
+  pencil->kz_start = mesh_pencil_block_start(c1, Nz, P1);
+  pencil->kz_width = mesh_pencil_block_width(c1, Nz, P1);
+  pencil->ky_start = mesh_pencil_block_start(c0, N, P0);
+  pencil->ky_width = mesh_pencil_block_width(c0, N, P0);
+
+  const size_t nx = pencil->x_width;
+  const size_t ny = pencil->y_width;
+  const size_t nkz = pencil->kz_width;
+  const size_t nky = pencil->ky_width;
+
+  /* The complex arrays must hold any of the three intermediate layouts */
+  pencil->real_size = nx * ny * N;
+  pencil->complex_size = nx * ny * Nz;
+  if (nx * nkz * N > pencil->complex_size) pencil->complex_size = nx * nkz * N;
+  if (nky * nkz * N > pencil->complex_size)
+    pencil->complex_size = nky * nkz * N;
+  if (pencil->complex_size > INT_MAX)
+    error("Local mesh pencil too large for the MPI transposes.");
+
+  /* Counts of the row transpose (forward direction) */
+  pencil->row_send_counts = (int *)malloc(P1 * sizeof(int));
+  pencil->row_send_displs = (int *)malloc(P1 * sizeof(int));
+  pencil->row_recv_counts = (int *)malloc(P1 * sizeof(int));
+  pencil->row_recv_displs = (int *)malloc(P1 * sizeof(int));
+  if (pencil->row_send_counts == NULL || pencil->row_send_displs == NULL ||
+      pencil->row_recv_counts == NULL || pencil->row_recv_displs == NULL)
+    error("Failed to allocate the counts of the mesh row transpose.");
+  for (int p = 0; p < P1; ++p) {
+    pencil->row_send_counts[p] = nx * ny * mesh_pencil_block_width(p, Nz, P1);
+    pencil->row_recv_counts[p] = nx * mesh_pencil_block_width(p, N, P1) * nkz;
+    pencil->row_send_displs[p] =
+        (p == 0) ? 0
+                 : pencil->row_send_displs[p - 1] +
+                       pencil->row_send_counts[p - 1];
+    pencil->row_recv_displs[p] =
+        (p == 0) ? 0
+                 : pencil->row_recv_displs[p - 1] +
+                       pencil->row_recv_counts[p - 1];
+  }
+
+  /* Counts of the column transpose (forward direction) */
+  pencil->col_send_counts = (int *)malloc(P0 * sizeof(int));
+  pencil->col_send_displs = (int *)malloc(P0 * sizeof(int));
+  pencil->col_recv_counts = (int *)malloc(P0 * sizeof(int));
+  pencil->col_recv_displs = (int *)malloc(P0 * sizeof(int));
+  if (pencil->col_send_counts == NULL || pencil->col_send_displs == NULL ||
+      pencil->col_recv_counts == NULL || pencil->col_recv_displs == NULL)
+    error("Failed to allocate the counts of the mesh column transpose.");
+  for (int q = 0; q < P0; ++q) {
+    pencil->col_send_counts[q] = nx * nkz * mesh_pencil_block_width(q, N, P0);
+    pencil->col_recv_counts[q] = mesh_pencil_block_width(q, N, P0) * nkz * nky;
+    pencil->col_send_displs[q] =
+        (q == 0) ? 0
+                 : pencil->col_send_displs[q - 1] +
+                       pencil->col_send_counts[q - 1];
+    pencil->col_recv_displs[q] =
+        (q == 0) ? 0
+                 : pencil->col_recv_displs[q - 1] +
+                       pencil->col_recv_counts[q - 1];
+  }
+
+  /* MPI type of one complex value */
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+  MPI_Type_contiguous(2, MPI_FLOAT, &pencil->complex_type);
+#else
+  MPI_Type_contiguous(2, MPI_DOUBLE, &pencil->complex_type);
+#endif
+  if (MPI_Type_commit(&pencil->complex_type) != MPI_SUCCESS)
+    error("Failed to create the MPI type of the mesh complex values.");
+
+  /* The plans are created on first use */
+  pencil->plan_z_forward = NULL;
+  pencil->plan_z_inverse = NULL;
+  pencil->plan_y_forward = NULL;
+  pencil->plan_y_inverse = NULL;
+  pencil->plan_x_forward = NULL;
+  pencil->plan_x_inverse = NULL;
+
+  if (verbose)
+    message(
+        "Distributed mesh split in %d x %d pencils (rank 0 holds %d x %d x %d "
+        "cells).",
+        P0, P1, (int)nx, (int)ny, N);
+
+#else
+  error("No MPI or FFTW library available. Cannot use mesh pencils.");
+#endif
+}
+
+/**
+ * @brief Frees the plans, communicators and arrays of a #pm_mesh_pencil.
+ *
+ * Must be called before MPI and FFTW are shut down.
+ *
+ * @param pencil The #pm_mesh_pencil to clean.
+ */
+void pm_mesh_pencil_clean(struct pm_mesh_pencil *pencil) {
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+  if (pencil->plan_z_forward != NULL)
+    mesh_fftw(destroy_plan)(pencil->plan_z_forward);
+  if (pencil->plan_z_inverse != NULL)
+    mesh_fftw(destroy_plan)(pencil->plan_z_inverse);
+  if (pencil->plan_y_forward != NULL)
+    mesh_fftw(destroy_plan)(pencil->plan_y_forward);
+  if (pencil->plan_y_inverse != NULL)
+    mesh_fftw(destroy_plan)(pencil->plan_y_inverse);
+  if (pencil->plan_x_forward != NULL)
+    mesh_fftw(destroy_plan)(pencil->plan_x_forward);
+  if (pencil->plan_x_inverse != NULL)
+    mesh_fftw(destroy_plan)(pencil->plan_x_inverse);
+
+  MPI_Comm_free(&pencil->comm_row);
+  MPI_Comm_free(&pencil->comm_col);
+  MPI_Type_free(&pencil->complex_type);
+#endif
+
+  free(pencil->row_send_counts);
+  free(pencil->row_send_displs);
+  free(pencil->row_recv_counts);
+  free(pencil->row_recv_displs);
+  free(pencil->col_send_counts);
+  free(pencil->col_send_displs);
+  free(pencil->col_recv_counts);
+  free(pencil->col_recv_displs);
+
+  bzero(pencil, sizeof(struct pm_mesh_pencil));
+}
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+/**
+ * @brief Creates the 1D FFTW plans of the pencil transforms.
+ *
+ * Anything but FFTW_ESTIMATE overwrites the arrays while planning so this
+ * must be called before they are filled.
+ *
+ * @param pencil The #pm_mesh_pencil holding the plans.
+ * @param rho The local real-space pencil (real_size reals).
+ * @param frho A complex array of complex_size values.
+ * @param work A second complex array of complex_size values.
+ * @param planner_flags The FFTW planner rigour.
+ */
+void pm_mesh_pencil_plan(struct pm_mesh_pencil *pencil, mesh_real *rho,
+                         mesh_complex *frho, mesh_complex *work,
+                         const unsigned int planner_flags) {
+
+  const int N = pencil->N;
+  const int Nz = N / 2 + 1;
+  const int n[1] = {N};
+  const int nr_z = pencil->x_width * pencil->y_width;
+  const int nr_y = pencil->x_width * pencil->kz_width;
+  const int nr_x = pencil->ky_width * pencil->kz_width;
+  const unsigned int flags = planner_flags | FFTW_DESTROY_INPUT;
+
+  /* Real-to-complex along z: [x][y][z] <-> [x][y][kz] */
+  pencil->plan_z_forward = mesh_fftw(plan_many_dft_r2c)(
+      1, n, nr_z, rho, NULL, 1, N, frho, NULL, 1, Nz, flags);
+  pencil->plan_z_inverse = mesh_fftw(plan_many_dft_c2r)(
+      1, n, nr_z, frho, NULL, 1, Nz, rho, NULL, 1, N, flags);
+
+  /* Complex along y: [x][kz][y] */
+  pencil->plan_y_forward = mesh_fftw(plan_many_dft)(
+      1, n, nr_y, work, NULL, 1, N, frho, NULL, 1, N, FFTW_FORWARD, flags);
+  pencil->plan_y_inverse = mesh_fftw(plan_many_dft)(
+      1, n, nr_y, frho, NULL, 1, N, work, NULL, 1, N, FFTW_BACKWARD, flags);
+
+  /* Complex along x: [ky][kz][x] */
+  pencil->plan_x_forward = mesh_fftw(plan_many_dft)(
+      1, n, nr_x, work, NULL, 1, N, frho, NULL, 1, N, FFTW_FORWARD, flags);
+  pencil->plan_x_inverse = mesh_fftw(plan_many_dft)(
+      1, n, nr_x, frho, NULL, 1, N, work, NULL, 1, N, FFTW_BACKWARD, flags);
+
+  if (pencil->plan_z_forward == NULL || pencil->plan_z_inverse == NULL ||
+      pencil->plan_y_forward == NULL || pencil->plan_y_inverse == NULL ||
+      pencil->plan_x_forward == NULL || pencil->plan_x_inverse == NULL)
+    error("Error creating the FFTW plans of the mesh pencils.");
+}
+
+/**
+ * @brief Forward 3D transform of the pencil-decomposed mesh.
+ *
+ * On return frho holds the local [ky][kz][kx] block of the Fourier
+ * transform. rho and work are destroyed.
+ *
+ * @param pencil The #pm_mesh_pencil (with its plans created).
+ * @param rho The local real-space pencil.
+ * @param frho The complex output array.
+ * @param work A complex array used as scratch space.
+ * @param tp The #threadpool object.
+ */
+void pm_mesh_pencil_forward(const struct pm_mesh_pencil *pencil,
+                            mesh_real *rho, mesh_complex *frho,
+                            mesh_complex *work, struct threadpool *tp) {
+
+  mesh_fftw(execute_dft_r2c)(pencil->plan_z_forward, rho, frho);
+  pencil_transpose_row(pencil, frho, work, /*inverse=*/0, tp);
+  mesh_fftw(execute_dft)(pencil->plan_y_forward, work, frho);
+  pencil_transpose_col(pencil, frho, work, /*inverse=*/0, tp);
+  mesh_fftw(execute_dft)(pencil->plan_x_forward, work, frho);
+}
+
+/**
+ * @brief Inverse 3D transform of the pencil-decomposed mesh.
+ *
+ * As with FFTW, the result is not normalised. frho and work are destroyed.
+ *
+ * @param pencil The #pm_mesh_pencil (with its plans created).
+ * @param frho The local [ky][kz][kx] block of the Fourier transform.
+ * @param rho The real-space output pencil.
+ * @param work A complex array used as scratch space.
+ * @param tp The #threadpool object.
+ */
+void pm_mesh_pencil_inverse(const struct pm_mesh_pencil *pencil,
+                            mesh_complex *frho, mesh_real *rho,
+                            mesh_complex *work, struct threadpool *tp) {
+
+  mesh_fftw(execute_dft)(pencil->plan_x_inverse, frho, work);
+  pencil_transpose_col(pencil, work, frho, /*inverse=*/1, tp);
+  mesh_fftw(execute_dft)(pencil->plan_y_inverse, frho, work);
+  pencil_transpose_row(pencil, work, frho, /*inverse=*/1, tp);
+  mesh_fftw(execute_dft_c2r)(pencil->plan_z_inverse, frho, rho);
+}
+
+#endif
+
+/**
+ * @brief Convert the array of local patches to the local real-space pencil
+ * of the distributed mesh.
+ *
+ * Same as mpi_mesh_local_patches_to_slices() but the mesh cells are routed
+ * to the rank holding their (x, y) pencil.
+ *
+ * This function will clean the memory allocated by each of the entry
+ * in the local_patches array.
+ *
+ * @param pencil The #pm_mesh_pencil.
+ * @param local_patches The array of local patches.
+ * @param nr_patches The number of local patches.
+ * @param rho The local real-space pencil (to be added to).
+ * @param tp The #threadpool object.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_pencil_patches_to_mesh(const struct pm_mesh_pencil *pencil,
+                                    struct pm_mesh_patch *local_patches,
+                                    const int nr_patches, mesh_real *rho,
+                                    struct threadpool *tp, const int verbose) {
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+  const int N = pencil->N;
+  const int nr_nodes = pencil->dims[0] * pencil->dims[1];
+
+  ticks tic = getticks();
+
+  /* Count the total number of mesh cells we have (duplicates included) */
+  size_t count = 0;
+  for (int i = 0; i < nr_patches; ++i) {
+    const struct pm_mesh_patch *p = &local_patches[i];
+    count += p->mesh_size[0] * p->mesh_size[1] * p->mesh_size[2];
+  }
+
+  /* Flatten the patches to an array of (key, value) pairs */
+  struct mesh_key_value_rho *mesh_sendbuf_unsorted;
+  if (swift_memalign("mesh_sendbuf_unsorted", (void **)&mesh_sendbuf_unsorted,
+                     SWIFT_CACHE_ALIGNMENT,
+                     count * sizeof(struct mesh_key_value_rho)) != 0)
+    error("Failed to allocate array for unsorted mesh send buffer!");
+  mesh_patches_to_sorted_array(local_patches, nr_patches, mesh_sendbuf_unsorted,
+                               count);
+
+  /* Clean the local patches array */
+  for (int i = 0; i < nr_patches; ++i) pm_mesh_patch_clean(&local_patches[i]);
+
+  /* Sort the mesh cells by destination rank */
+  struct mesh_key_value_rho *mesh_sendbuf;
+  if (swift_memalign("mesh_sendbuf", (void **)&mesh_sendbuf,
+                     SWIFT_CACHE_ALIGNMENT,
+                     count * sizeof(struct mesh_key_value_rho)) != 0)
+    error("Failed to allocate array for sorted mesh send buffer!");
+
+  size_t *sorted_offsets = (size_t *)malloc((nr_nodes + 1) * sizeof(size_t));
+  bucket_sort_mesh_key_value_rho_pencil(mesh_sendbuf_unsorted, count, N,
+                                        pencil->dims, tp, mesh_sendbuf,
+                                        sorted_offsets);
+
+  swift_free("mesh_sendbuf_unsorted", mesh_sendbuf_unsorted);
+  mesh_sendbuf_unsorted = NULL;
+
+  if (verbose)
+    message(" - Flattening and sorting of mesh cells took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  /* The buckets are the ranks */
+  size_t *nr_send = (size_t *)malloc(nr_nodes * sizeof(size_t));
+  for (int i = 0; i < nr_nodes; ++i)
+    nr_send[i] = sorted_offsets[i + 1] - sorted_offsets[i];
+  free(sorted_offsets);
+
+  /* Determine how many mesh cells we'll receive from each MPI rank */
+  size_t *nr_recv = (size_t *)malloc(nr_nodes * sizeof(size_t));
+  MPI_Alltoall(nr_send, sizeof(size_t), MPI_BYTE, nr_recv, sizeof(size_t),
+               MPI_BYTE, MPI_COMM_WORLD);
+  size_t nr_recv_tot = 0;
+  for (int i = 0; i < nr_nodes; i++) nr_recv_tot += nr_recv[i];
+
+  struct mesh_key_value_rho *mesh_recvbuf;
+  if (swift_memalign("mesh_recvbuf", (void **)&mesh_recvbuf,
+                     SWIFT_CACHE_ALIGNMENT,
+                     nr_recv_tot * sizeof(struct mesh_key_value_rho)) != 0)
+    error("Failed to allocate receive buffer for the mesh pencils");
+
+  exchange_structs(nr_send, (char *)mesh_sendbuf, nr_recv, (char *)mesh_recvbuf,
+                   sizeof(struct mesh_key_value_rho));
+
+  if (verbose)
+    message(" - MPI exchange took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  /* Add the received contributions to our pencil */
+  for (size_t i = 0; i < nr_recv_tot; i++)
+    rho[pencil_local_index(pencil, mesh_recvbuf[i].key)] +=
+        mesh_recvbuf[i].value;
+
+  if (verbose)
+    message(" - Filling of the density values took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  /* Tidy up */
+  free(nr_send);
+  free(nr_recv);
+  swift_free("mesh_recvbuf", mesh_recvbuf);
+  swift_free("mesh_sendbuf", mesh_sendbuf);
+
+#else
+  error("No MPI or FFTW library available. Cannot use mesh pencils.");
+#endif
+}
+
+/**
+ * @brief Retrieve the potential in the mesh cells we need to compute the
+ * force on particles on this MPI rank from the pencil-decomposed mesh.
+ *
+ * Same as mpi_mesh_fetch_potential() but the requests are routed to the rank
+ * holding the (x, y) pencil of each mesh cell.
+ *
+ * @param pencil The #pm_mesh_pencil.
+ * @param fac Inverse of the FFT mesh cell size
+ * @param s The #space containing the particles.
+ * @param order The order of the mass assignment window.
+ * @param potential The local real-space pencil of the potential.
+ * @param local_patches The array of local patches (to be filled).
+ * @param tp The #threadpool object.
+ * @param verbose Are we talkative?
+ */
+void pm_mesh_pencil_fetch_potential(const struct pm_mesh_pencil *pencil,
+                                    const double fac, const struct space *s,
+                                    const int order,
+                                    const mesh_real *potential,
+                                    struct pm_mesh_patch *local_patches,
+                                    struct threadpool *tp, const int verbose) {
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+
+  const int N = pencil->N;
+  const int nr_nodes = pencil->dims[0] * pencil->dims[1];
+
+  ticks tic = getticks();
+
+  /* Build the list of mesh cells we need */
+  const size_t nr_send_tot = count_required_mesh_cells(N, fac, s, order);
+
+  struct mesh_key_value_pot *send_cells_unsorted;
+  if (swift_memalign("send_cells_unsorted", (void **)&send_cells_unsorted,
+                     SWIFT_CACHE_ALIGNMENT,
+                     nr_send_tot * sizeof(struct mesh_key_value_pot)) != 0)
+    error("Failed to allocate array for cells to request!");
+
+  const size_t check_count =
+      init_required_mesh_cells(N, fac, s, order, send_cells_unsorted);
+  if (nr_send_tot != check_count)
+    error("Count and initialisation incompatible!");
+
+  /* Sort the requests by destination rank */
+  struct mesh_key_value_pot *send_cells;
+  if (swift_memalign("send_cells", (void **)&send_cells, SWIFT_CACHE_ALIGNMENT,
+                     nr_send_tot * sizeof(struct mesh_key_value_pot)) != 0)
+    error("Failed to allocate array for cells to request!");
+
+  size_t *sorted_offsets = (size_t *)malloc((nr_nodes + 1) * sizeof(size_t));
+  bucket_sort_mesh_key_value_pot_pencil(send_cells_unsorted, nr_send_tot, N,
+                                        pencil->dims, tp, send_cells,
+                                        sorted_offsets);
+
+  swift_free("send_cells_unsorted", send_cells_unsorted);
+  send_cells_unsorted = NULL;
+
+  if (verbose)
+    message(" - Building and sorting the requests took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  size_t *nr_send = (size_t *)malloc(nr_nodes * sizeof(size_t));
+  for (int i = 0; i < nr_nodes; ++i)
+    nr_send[i] = sorted_offsets[i + 1] - sorted_offsets[i];
+  free(sorted_offsets);
+
+  /* Determine how many requests we'll receive from each MPI rank */
+  size_t *nr_recv = (size_t *)malloc(nr_nodes * sizeof(size_t));
+  MPI_Alltoall(nr_send, sizeof(size_t), MPI_BYTE, nr_recv, sizeof(size_t),
+               MPI_BYTE, MPI_COMM_WORLD);
+  size_t nr_recv_tot = 0;
+  for (int i = 0; i < nr_nodes; i++) nr_recv_tot += nr_recv[i];
+
+  struct mesh_key_value_pot *recv_cells;
+  if (swift_memalign("recv_cells", (void **)&recv_cells, SWIFT_CACHE_ALIGNMENT,
+                     nr_recv_tot * sizeof(struct mesh_key_value_pot)) != 0)
+    error("Failed to allocate array for mesh receive buffer!");
+
+  /* Send the requests, look up the potential and return the results */
+  exchange_structs(nr_send, (char *)send_cells, nr_recv, (char *)recv_cells,
+                   sizeof(struct mesh_key_value_pot));
+
+  for (size_t i = 0; i < nr_recv_tot; i++) {
+    const size_t local_id = pencil_local_index(pencil, recv_cells[i].key);
+    recv_cells[i].value = potential[local_id];
+  }
+
+  exchange_structs(nr_recv, (char *)recv_cells, nr_send, (char *)send_cells,
+                   sizeof(struct mesh_key_value_pot));
+
+  if (verbose)
+    message(" - Exchanging the potential took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+  tic = getticks();
+
+  swift_free("recv_cells", recv_cells);
+  free(nr_send);
+  free(nr_recv);
+
+  /* Sort the mesh cells by the patch they belong to and fill the patches */
+  struct mesh_key_value_pot *send_cells_sorted;
+  if (swift_memalign("send_cells_sorted", (void **)&send_cells_sorted,
+                     SWIFT_CACHE_ALIGNMENT,
+                     nr_send_tot * sizeof(struct mesh_key_value_pot)) != 0)
+    error("Failed to allocate array for cells to request!");
+
+  bucket_sort_mesh_key_value_pot_index(
+      send_cells, nr_send_tot, s->nr_local_cells, tp, send_cells_sorted);
+
+  swift_free("send_cells", send_cells);
+  send_cells = NULL;
+
+  fill_local_patches_from_mesh_cells(N, fac, s, order, send_cells_sorted,
+                                     local_patches, nr_send_tot);
+
+  swift_free("send_cells_sorted", send_cells_sorted);
+
+  if (verbose)
+    message(" - Filling the local patches took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+
+#else
+  error("No MPI or FFTW library available. Cannot use mesh pencils.");
+#endif
+}
@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_MESH_GRAVITY_PENCIL_H
+#define SWIFT_MESH_GRAVITY_PENCIL_H
+
+/* Config parameters. */
+#include <config.h>
+
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+/* Standard headers */
+#include <stddef.h>
+
+/* Local headers */
+#include "inline.h"
+#include "mesh_gravity_fftw.h"
+#include "row_major_id.h"
+
+/* Forward declarations */
+struct space;
+struct threadpool;
+struct pm_mesh_patch;
+
+/**
+ * @brief First index of block r when [0, N[ is split into P contiguous
+ * blocks of (almost) equal size.
+ *
+ * @param r The index of the block.
+ * @param N The size of the range.
+ * @param P The number of blocks.
+ */
+__attribute__((always_inline, const)) INLINE static int
+mesh_pencil_block_start(const int r, const int N, const int P) {
+  return (int)(((long long)r * N) / P);
+}
+
+/**
+ * @brief Width of block r when [0, N[ is split into P contiguous blocks of
+ * (almost) equal size.
+ *
+ * @param r The index of the block.
+ * @param N The size of the range.
+ * @param P The number of blocks.
+ */
+__attribute__((always_inline, const)) INLINE static int
+mesh_pencil_block_width(const int r, const int N, const int P) {
+  return mesh_pencil_block_start(r + 1, N, P) -
+         mesh_pencil_block_start(r, N, P);
+}
+
+/**
+ * @brief Index of the block containing element i when [0, N[ is split into P
+ * contiguous blocks of (almost) equal size.
+ *
+ * @param i The element.
+ * @param N The size of the range.
+ * @param P The number of blocks.
+ */
+__attribute__((always_inline, const)) INLINE static int
+mesh_pencil_block_owner(const int i, const int N, const int P) {
+  return (int)((((long long)i + 1) * P - 1) / N);
+}
+
+/**
+ * @brief Rank holding a mesh cell in the real-space pencil decomposition.
+ *
+ * The ranks form a dims[0] x dims[1] grid with rank = c0 * dims[1] + c1. Rank
+ * (c0, c1) holds the x block c0 and the y block c1 and all the z values.
+ *
+ * @param key The padded row-major id of the mesh cell.
+ * @param N The size of the mesh along one axis.
+ * @param dims The size of the grid of ranks.
+ */
+__attribute__((always_inline, pure)) INLINE static int
+mesh_pencil_rank_from_key(const size_t key, const int N, const int dims[2]) {
+  const int x = get_xcoord_from_padded_row_major_id(key, N);
+  const int y = get_ycoord_from_padded_row_major_id(key, N);
+  return mesh_pencil_block_owner(x, N, dims[0]) * dims[1] +
+         mesh_pencil_block_owner(y, N, dims[1]);
+}
+
+/**
+ * @brief A 2D (pencil) decomposition of the distributed mesh.
+ *
+ * The MPI ranks form a dims[0] x dims[1] grid. The 3D transform is done as
+ * three sets of 1D transforms separated by two transposes, each of which only
+ * involves the ranks of one row or one column of the grid:
+ *
+ * - Real space: x in the block coords[0] (over dims[0]), y in the block
+ *   coords[1] (over dims[1]), all z. Stored as [x][y][z].
+ * - After the r2c transform along z and the row transpose: x as above, kz in
+ *   the block coords[1] (over N/2+1), all y. Stored as [x][kz][y].
+ * - After the transform along y and the column transpose (Fourier space): ky
+ *   in the block coords[0] (over dims[0]), kz as above, all kx. Stored as
+ *   [ky][kz][kx].
+ *
+ * Contrary to the slab decomposition, the number of ranks can thus go up to
+ * N * (N/2+1).
+ */
+struct pm_mesh_pencil {
+
+  /*! Size of the mesh along one axis */
+  int N;
+
+  /*! Size of the grid of ranks */
+  int dims[2];
+
+  /*! Coordinates of this rank in the grid */
+  int coords[2];
+
+  /*! Real space: start and width of the local block along x and y */
+  int x_start, x_width;
+  int y_start, y_width;
+
+  /*! Intermediate and Fourier space: start and width of the kz block */
+  int kz_start, kz_width;
+
+  /*! Fourier space: start and width of the local ky block */
+  int ky_start, ky_width;
+
+  /*! Number of reals in the local real-space block */
+  size_t real_size;
+
+  /*! Number of complex values needed to hold any of the complex layouts */
+  size_t complex_size;
+
+  /*! Counts and displacements of the row transpose (forward direction) */
+  int *row_send_counts, *row_send_displs;
+  int *row_recv_counts, *row_recv_displs;
+
+  /*! Counts and displacements of the column transpose (forward direction) */
+  int *col_send_counts, *col_send_displs;
+  int *col_recv_counts, *col_recv_displs;
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+  /*! Communicator of the ranks sharing our x block (size dims[1]) */
+  MPI_Comm comm_row;
+
+  /*! Communicator of the ranks sharing our y/kz block (size dims[0]) */
+  MPI_Comm comm_col;
+
+  /*! MPI type of a mesh_complex */
+  MPI_Datatype complex_type;
+
+  /*! Cached 1D plans along each axis (NULL until the first mesh step) */
+  mesh_plan plan_z_forward, plan_z_inverse;
+  mesh_plan plan_y_forward, plan_y_inverse;
+  mesh_plan plan_x_forward, plan_x_inverse;
+#endif
+};
+
+void pm_mesh_pencil_init(struct pm_mesh_pencil *pencil, const int N,
+                         const int verbose);
+void pm_mesh_pencil_clean(struct pm_mesh_pencil *pencil);
+
+#if defined(WITH_MPI) && defined(HAVE_FFTW)
+void pm_mesh_pencil_plan(struct pm_mesh_pencil *pencil, mesh_real *rho,
+                         mesh_complex *frho, mesh_complex *work,
+                         const unsigned int planner_flags);
+void pm_mesh_pencil_forward(const struct pm_mesh_pencil *pencil,
+                            mesh_real *rho, mesh_complex *frho,
+                            mesh_complex *work, struct threadpool *tp);
+void pm_mesh_pencil_inverse(const struct pm_mesh_pencil *pencil,
+                            mesh_complex *frho, mesh_real *rho,
+                            mesh_complex *work, struct threadpool *tp);
+#endif
+
+void pm_mesh_pencil_patches_to_mesh(const struct pm_mesh_pencil *pencil,
+                                    struct pm_mesh_patch *local_patches,
+                                    const int nr_patches, mesh_real *rho,
+                                    struct threadpool *tp, const int verbose);
+void pm_mesh_pencil_fetch_potential(const struct pm_mesh_pencil *pencil,
+                                    const double fac, const struct space *s,
+                                    const int order,
+                                    const mesh_real *potential,
+                                    struct pm_mesh_patch *local_patches,
+                                    struct threadpool *tp, const int verbose);
+
+#endif /* SWIFT_MESH_GRAVITY_PENCIL_H */
@@ -27,6 +27,7 @@
 #include "align.h"
 #include "atomic.h"
 #include "error.h"
+#include "mesh_gravity_pencil.h"
 #include "row_major_id.h"
 #include "threadpool.h"
 
@@ -35,6 +36,9 @@ struct mapper_extra_data {
   /* Mesh size */
   int N;
 
+  /* Grid of ranks (pencil decomposition only) */
+  int dims[2];
+
   /* Buckets */
   size_t *bucket_counts;
 };
@@ -419,3 +423,221 @@ void bucket_sort_mesh_key_value_pot_index(
   free(bucket_offsets);
   free(bucket_counts);
 }
+
+/**
+ * @param Count how may mesh cells will end up in each pencil-rank bucket.
+ */
+void bucket_sort_mesh_key_value_rho_pencil_count_mapper(void *map_data,
+                                                        int nr_parts,
+                                                        void *extra_data) {
+
+  /* Unpack the data */
+  const struct mesh_key_value_rho *array_in =
+      (const struct mesh_key_value_rho *)map_data;
+  struct mapper_extra_data *data = (struct mapper_extra_data *)extra_data;
+  const int N = data->N;
+  const int nr_buckets = data->dims[0] * data->dims[1];
+  size_t *global_bucket_counts = data->bucket_counts;
+
+  /* Local buckets */
+  size_t *local_bucket_counts = (size_t *)calloc(nr_buckets, sizeof(size_t));
+
+  /* Count how many items will land in each bucket. */
+  for (int i = 0; i < nr_parts; ++i) {
+    const int rank = mesh_pencil_rank_from_key(array_in[i].key, N, data->dims);
+    local_bucket_counts[rank]++;
+  }
+
+  /* Now write back to memory */
+  for (int i = 0; i < nr_buckets; ++i) {
+    atomic_add(&global_bucket_counts[i], local_bucket_counts[i]);
+  }
+
+  /* Clean up */
+  free(local_bucket_counts);
+}
+
+/**
+ * @param Count how may mesh cells will end up in each pencil-rank bucket.
+ */
+void bucket_sort_mesh_key_value_pot_pencil_count_mapper(void *map_data,
+                                                        int nr_parts,
+                                                        void *extra_data) {
+
+  /* Unpack the data */
+  const struct mesh_key_value_pot *array_in =
+      (const struct mesh_key_value_pot *)map_data;
+  struct mapper_extra_data *data = (struct mapper_extra_data *)extra_data;
+  const int N = data->N;
+  const int nr_buckets = data->dims[0] * data->dims[1];
+  size_t *global_bucket_counts = data->bucket_counts;
+
+  /* Local buckets */
+  size_t *local_bucket_counts = (size_t *)calloc(nr_buckets, sizeof(size_t));
+
+  /* Count how many items will land in each bucket. */
+  for (int i = 0; i < nr_parts; ++i) {
+    const int rank = mesh_pencil_rank_from_key(array_in[i].key, N, data->dims);
+    local_bucket_counts[rank]++;
+  }
+
+  /* Now write back to memory */
+  for (int i = 0; i < nr_buckets; ++i) {
+    atomic_add(&global_bucket_counts[i], local_bucket_counts[i]);
+  }
+
+  /* Clean up */
+  free(local_bucket_counts);
+}
+
+/**
+ * @brief Bucket sort of the array of mesh cells based on the rank holding
+ * them in a pencil decomposition of the mesh.
+ *
+ * Note the two mesh_key_value_rho arrays must be aligned on
+ * SWIFT_CACHE_ALIGNMENT.
+ *
+ * @param array_in The unsorted array of mesh-key value pairs.
+ * @param count The number of elements in the mesh-key value pair arrays.
+ * @param N The size of the mesh.
+ * @param dims The size of the grid of ranks.
+ * @param tp The #threadpool object.
+ * @param array_out The sorted array of mesh-key value pairs (to be filled).
+ * @param bucket_offsets The offsets in the sorted array where we change rank
+ * (to be filled, dims[0] * dims[1] + 1 elements).
+ */
+void bucket_sort_mesh_key_value_rho_pencil(
+    const struct mesh_key_value_rho *array_in, const size_t count, const int N,
+    const int dims[2], struct threadpool *tp,
+    struct mesh_key_value_rho *array_out, size_t *bucket_offsets) {
+
+  const int nr_buckets = dims[0] * dims[1];
+
+  /* Create an array of bucket counts */
+  size_t *bucket_counts = (size_t *)calloc(nr_buckets, sizeof(size_t));
+
+  struct mapper_extra_data extra_data;
+  extra_data.N = N;
+  extra_data.dims[0] = dims[0];
+  extra_data.dims[1] = dims[1];
+  extra_data.bucket_counts = bucket_counts;
+
+  /* Collect the number of items that will end up in each bucket */
+  threadpool_map(tp, bucket_sort_mesh_key_value_rho_pencil_count_mapper,
+                 (void *)array_in, count, sizeof(struct mesh_key_value_rho),
+                 threadpool_auto_chunk_size, &extra_data);
+
+  /* Now we can build the array of offsets (cumsum of the counts) */
+  bucket_offsets[0] = 0;
+  for (int i = 1; i <= nr_buckets; ++i) {
+    bucket_offsets[i] = bucket_offsets[i - 1] + bucket_counts[i - 1];
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (bucket_offsets[nr_buckets] != count)
+    error("Bucket count is not matching");
+#endif
+
+  /* Remind the compiler that the array is nicely aligned */
+  swift_declare_aligned_ptr(struct mesh_key_value_rho, array_out_aligned,
+                            array_out, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(const struct mesh_key_value_rho, array_in_aligned,
+                            array_in, SWIFT_CACHE_ALIGNMENT);
+
+  /* Now, we can do the actual sorting */
+  for (size_t i = 0; i < count; ++i) {
+
+    const int rank =
+        mesh_pencil_rank_from_key(array_in_aligned[i].key, N, dims);
+
+    /* Copy the element to its correct position and move the start of this
+     * bucket by one */
+    memcpy(&array_out_aligned[bucket_offsets[rank]], &array_in_aligned[i],
+           sizeof(struct mesh_key_value_rho));
+    bucket_offsets[rank]++;
+  }
+
+  /* Restore the bucket offsets to their former glory */
+  for (int i = 0; i < nr_buckets; ++i) {
+    bucket_offsets[i] -= bucket_counts[i];
+  }
+
+  /* Clean up! */
+  free(bucket_counts);
+}
+
+/**
+ * @brief Bucket sort of the array of mesh cells based on the rank holding
+ * them in a pencil decomposition of the mesh.
+ *
+ * Note the two mesh_key_value_pot arrays must be aligned on
+ * SWIFT_CACHE_ALIGNMENT.
+ *
+ * @param array_in The unsorted array of mesh-key value pairs.
+ * @param count The number of elements in the mesh-key value pair arrays.
+ * @param N The size of the mesh.
+ * @param dims The size of the grid of ranks.
+ * @param tp The #threadpool object.
+ * @param array_out The sorted array of mesh-key value pairs (to be filled).
+ * @param bucket_offsets The offsets in the sorted array where we change rank
+ * (to be filled, dims[0] * dims[1] + 1 elements).
+ */
+void bucket_sort_mesh_key_value_pot_pencil(
+    const struct mesh_key_value_pot *array_in, const size_t count, const int N,
+    const int dims[2], struct threadpool *tp,
+    struct mesh_key_value_pot *array_out, size_t *bucket_offsets) {
+
+  const int nr_buckets = dims[0] * dims[1];
+
+  /* Create an array of bucket counts */
+  size_t *bucket_counts = (size_t *)calloc(nr_buckets, sizeof(size_t));
+
+  struct mapper_extra_data extra_data;
+  extra_data.N = N;
+  extra_data.dims[0] = dims[0];
+  extra_data.dims[1] = dims[1];
+  extra_data.bucket_counts = bucket_counts;
+
+  /* Collect the number of items that will end up in each bucket */
+  threadpool_map(tp, bucket_sort_mesh_key_value_pot_pencil_count_mapper,
+                 (void *)array_in, count, sizeof(struct mesh_key_value_pot),
+                 threadpool_auto_chunk_size, &extra_data);
+
+  /* Now we can build the array of offsets (cumsum of the counts) */
+  bucket_offsets[0] = 0;
+  for (int i = 1; i <= nr_buckets; ++i) {
+    bucket_offsets[i] = bucket_offsets[i - 1] + bucket_counts[i - 1];
+  }
+
+#ifdef SWIFT_DEBUG_CHECKS
+  if (bucket_offsets[nr_buckets] != count)
+    error("Bucket count is not matching");
+#endif
+
+  /* Remind the compiler that the array is nicely aligned */
+  swift_declare_aligned_ptr(struct mesh_key_value_pot, array_out_aligned,
+                            array_out, SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(const struct mesh_key_value_pot, array_in_aligned,
+                            array_in, SWIFT_CACHE_ALIGNMENT);
+
+  /* Now, we can do the actual sorting */
+  for (size_t i = 0; i < count; ++i) {
+
+    const int rank =
+        mesh_pencil_rank_from_key(array_in_aligned[i].key, N, dims);
+
+    /* Copy the element to its correct position and move the start of this
+     * bucket by one */
+    memcpy(&array_out_aligned[bucket_offsets[rank]], &array_in_aligned[i],
+           sizeof(struct mesh_key_value_pot));
+    bucket_offsets[rank]++;
+  }
+
+  /* Restore the bucket offsets to their former glory */
+  for (int i = 0; i < nr_buckets; ++i) {
+    bucket_offsets[i] -= bucket_counts[i];
+  }
+
+  /* Clean up! */
+  free(bucket_counts);
+}
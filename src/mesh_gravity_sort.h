@@ -61,4 +61,14 @@ void bucket_sort_mesh_key_value_pot_index(
     const struct mesh_key_value_pot *array_in, const size_t count, const int N,
     struct threadpool *tp, struct mesh_key_value_pot *array_out);
 
+void bucket_sort_mesh_key_value_rho_pencil(
+    const struct mesh_key_value_rho *array_in, const size_t count, const int N,
+    const int dims[2], struct threadpool *tp,
+    struct mesh_key_value_rho *array_out, size_t *bucket_offsets);
+
+void bucket_sort_mesh_key_value_pot_pencil(
+    const struct mesh_key_value_pot *array_in, const size_t count, const int N,
+    const int dims[2], struct threadpool *tp,
+    struct mesh_key_value_pot *array_out, size_t *bucket_offsets);
+
 #endif /* SWIFT_MESH_GRAVITY_SORT_H */
@@ -100,6 +100,9 @@ static volatile size_t mpiuse_log_size = 0;
 static volatile size_t mpiuse_log_count = 0;
 static volatile size_t mpiuse_log_done = 0;
 
+/* Bytes not sent thanks to the packing of the particle data. */
+static volatile size_t mpiuse_packed_saved = 0;
+
 /**
  * @brief reallocate the entries log if space is needed.
  */
@@ -179,6 +182,16 @@ void mpiuse_log_allocation(int type, int subtype, void *ptr, int activation,
   atomic_inc(&mpiuse_log_done);
 }
 
+/**
+ * @brief Log the sending of particle data in packed form.
+ *
+ * @param full_size the size in bytes of the data if sent unpacked.
+ * @param size the size in bytes of the packed data.
+ */
+void mpiuse_log_packed(size_t full_size, size_t size) {
+  if (full_size > size) atomic_add(&mpiuse_packed_saved, full_size - size);
+}
+
 /**
  * @brief dump the log to a file and reset, if anything to dump.
  *
@@ -325,6 +338,8 @@ void mpiuse_log_dump(const char *filename, ticks stepticks) {
   fprintf(fd, "## Sum of all requests: %.4f (MB)\n", mpiuse_sum / MEGABYTE);
   fprintf(fd, "## Mean of all requests: %.4f (MB)\n",
           mpiuse_sum / (double)mpiuse_actcount / MEGABYTE);
+  fprintf(fd, "## Bytes saved by packing: %.4f (MB)\n",
+          mpiuse_packed_saved / MEGABYTE);
   fprintf(fd, "##\n");
 
   /* Now check any still active logs, these are errors all should match. */
@@ -343,6 +358,7 @@ void mpiuse_log_dump(const char *filename, ticks stepticks) {
 
   /* Clear the log. We expect this to clear step to step, unlike memory. */
   mpiuse_log_count = 0;
+  mpiuse_packed_saved = 0;
   mpiuse_log_done = 0;
 
   /* Close the file. */
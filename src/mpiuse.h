@@ -34,12 +34,14 @@ void mpiuse_log_dump(const char *filename, ticks stepticks);
 void mpiuse_log_allocation(int type, int subtype, void *ptr, int activation,
                            size_t size, int otherrank, int tag);
 void mpiuse_log_dump_error(int rank);
+void mpiuse_log_packed(size_t full_size, size_t size);
 #else
 
 /* No-op when not reporting. */
 #define mpiuse_log_allocation(type, subtype, ptr, activation, size, otherrank, \
                               tag)                                             \
   ;
+#define mpiuse_log_packed(full_size, size) ;
 #endif /* defined(SWIFT_MPIUSE_REPORTS) && defined(WITH_MPI) */
 
 #endif /* SWIFT_MPIUSE_H */
@@ -408,7 +408,7 @@ struct neutrino_response_tp_data {
 
   /* Mesh properties */
   int N;
-  fftw_complex *frho;
+  mesh_complex *frho;
   double boxlen;
   int slice_offset;
   int slice_width;
@@ -439,7 +439,7 @@ void neutrino_response_apply_neutrino_response_mapper(void *map_data,
       (struct neutrino_response_tp_data *)extra;
 
   /* Unpack the mesh properties */
-  fftw_complex *const frho = data->frho;
+  mesh_complex *const frho = data->frho;
   const int N = data->N;
   const int N_half = N / 2;
   const double delta_k = 2.0 * M_PI / data->boxlen;
@@ -459,7 +459,7 @@ void neutrino_response_apply_neutrino_response_mapper(void *map_data,
   const int slice_offset = data->slice_offset;
 
   /* Range of x coordinates in the full mesh handled by this call */
-  const int x_start = ((fftw_complex *)map_data - frho) + slice_offset;
+  const int x_start = ((mesh_complex *)map_data - frho) + slice_offset;
   const int x_end = x_start + num;
 
   /* Loop over the x range corresponding to this thread */
@@ -526,7 +526,7 @@ void neutrino_response_apply_neutrino_response_mapper(void *map_data,
  * @param verbose Are we talkative?
  */
 void neutrino_response_compute(const struct space *s, struct pm_mesh *mesh,
-                               struct threadpool *tp, fftw_complex *frho,
+                               struct threadpool *tp, mesh_complex *frho,
                                const int slice_offset, const int slice_width,
                                int verbose) {
 #ifdef HAVE_FFTW
@@ -584,7 +584,7 @@ void neutrino_response_compute(const struct space *s, struct pm_mesh *mesh,
      to split the x-axis loop over the threads. The array is N x N x (N/2).
      We use the thread to each deal with a range [i_min, i_max[ x N x (N/2) */
   threadpool_map(tp, neutrino_response_apply_neutrino_response_mapper, frho,
-                 slice_width, sizeof(fftw_complex), threadpool_auto_chunk_size,
+                 slice_width, sizeof(mesh_complex), threadpool_auto_chunk_size,
                  &data);
 
   /* Correct singularity at (0,0,0) */
@@ -20,11 +20,8 @@
 #ifndef SWIFT_DEFAULT_NEUTRINO_RESPONSE_H
 #define SWIFT_DEFAULT_NEUTRINO_RESPONSE_H
 
-#ifdef HAVE_FFTW
-#include <fftw3.h>
-#endif
-
 #include "cosmology.h"
+#include "mesh_gravity_fftw.h"
 #include "neutrino_properties.h"
 #include "physical_constants.h"
 #include "units.h"
@@ -73,7 +70,7 @@ void neutrino_response_clean(struct neutrino_response *numesh);
 
 #ifdef HAVE_FFTW
 void neutrino_response_compute(const struct space *s, struct pm_mesh *mesh,
-                               struct threadpool *tp, fftw_complex *frho,
+                               struct threadpool *tp, mesh_complex *frho,
                                const int slice_offset, const int slice_width,
                                int verbose);
 #endif /* HAVE_FFTW */
@@ -55,6 +55,7 @@
 #include "output_options.h"
 #include "part.h"
 #include "part_type.h"
+#include "partial_io.h"
 #include "particle_splitting.h"
 #include "rt_io.h"
 #include "sink_io.h"
@@ -82,6 +83,9 @@ static const int io_max_size_output_list = 100;
  * @param props The #io_props of the field to read.
  * @param N The number of particles to write.
  * @param offset Offset in the array where this mpi task starts writing.
+ * @param ranges The #partial_io_range of particles to read (NULL for all). The
+ * offset is then counted within the selected particles.
+ * @param nr_ranges The number of ranges.
  * @param internal_units The #unit_system used internally.
  * @param ic_units The #unit_system used in the snapshots.
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -93,6 +97,8 @@ static const int io_max_size_output_list = 100;
 void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
                                const struct io_props props, size_t N,
                                long long offset,
+                               const struct partial_io_range* ranges,
+                               const size_t nr_ranges,
                                const struct unit_system* internal_units,
                                const struct unit_system* ic_units,
                                int cleanup_h, int cleanup_sqrt_a, double h,
@@ -132,7 +138,11 @@ void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
 
   /* Select hyper-slab in file */
   const hid_t h_filespace = H5Dget_space(h_data);
-  H5Sselect_hyperslab(h_filespace, H5S_SELECT_SET, offsets, NULL, shape, NULL);
+  if (ranges != NULL)
+    partial_io_select_hyperslab(h_filespace, ranges, nr_ranges, offset, N);
+  else
+    H5Sselect_hyperslab(h_filespace, H5S_SELECT_SET, offsets, NULL, shape,
+                        NULL);
 
   /* Read HDF5 dataspace in temporary buffer */
   /* Dirty version that happens to work for vectors but should be improved */
@@ -239,6 +249,8 @@ void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
  * @param N_total The total number of particles.
  * @param mpi_rank The MPI rank of this node.
  * @param offset The offset in the array on disk for this rank.
+ * @param ranges The #partial_io_range of particles to read (NULL for all).
+ * @param nr_ranges The number of ranges.
  * @param internal_units The #unit_system used internally.
  * @param ic_units The #unit_system used in the ICs.
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -249,12 +261,13 @@ void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
  */
 void read_array_parallel(hid_t grp, struct io_props props, size_t N,
                          long long N_total, int mpi_rank, long long offset,
+                         const struct partial_io_range* ranges,
+                         const size_t nr_ranges,
                          const struct unit_system* internal_units,
                          const struct unit_system* ic_units, int cleanup_h,
                          int cleanup_sqrt_a, double h, double a) {
 
   const size_t typeSize = io_sizeof_type(props.type);
-  const size_t copySize = typeSize * props.dimension;
 
   /* Check whether the dataspace exists or not */
   const htri_t exist = H5Lexists(grp, props.name, 0);
@@ -264,16 +277,7 @@ void read_array_parallel(hid_t grp, struct io_props props, size_t N,
     if (props.importance == COMPULSORY) {
       error("Compulsory data set '%s' not present in the file.", props.name);
     } else {
-
-      /* Create a single instance of the default value */
-      float* temp = (float*)malloc(copySize);
-      for (int i = 0; i < props.dimension; ++i) temp[i] = props.default_value;
-
-      /* Copy it everywhere in the particle array */
-      for (size_t i = 0; i < N; ++i)
-        memcpy(props.field + i * props.partSize, temp, copySize);
-
-      free(temp);
+      partial_io_fill_default(&props, N);
       return;
     }
   }
@@ -349,8 +353,8 @@ void read_array_parallel(hid_t grp, struct io_props props, size_t N,
     /* Write the first chunk */
     const size_t this_chunk = (N > max_chunk_size) ? max_chunk_size : N;
     read_array_parallel_chunk(h_data, h_plist_id, props, this_chunk, offset,
-                              internal_units, ic_units, cleanup_h,
-                              cleanup_sqrt_a, h, a);
+                              ranges, nr_ranges, internal_units, ic_units,
+                              cleanup_h, cleanup_sqrt_a, h, a);
 
     /* Compute how many items are left */
     if (N > max_chunk_size) {
@@ -762,6 +766,8 @@ void write_array_parallel(const struct engine* e, hid_t grp,
  * @param dry_run If 1, don't read the particle. Only allocates the arrays.
  * @param remap_ids Are we ignoring the ICs' IDs and remapping them to [1, N[ ?
  * @param ics_metadata Will store metadata group copied from the ICs file
+ * @param selection The #partial_io_selection of particles and fields to read
+ * (NULL to read everything).
  *
  */
 void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
@@ -777,7 +783,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
                       const int cleanup_sqrt_a, const double h, const double a,
                       const int mpi_rank, const int mpi_size, MPI_Comm comm,
                       MPI_Info info, const int n_threads, const int dry_run,
-                      const int remap_ids, struct ic_info* ics_metadata) {
+                      const int remap_ids, struct ic_info* ics_metadata,
+                      const struct partial_io_selection* selection) {
 
   hid_t h_file = 0, h_grp = 0;
   /* GADGET has only cubic boxes (in cosmological mode) */
@@ -873,6 +880,19 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   /* message("Found %lld particles in a %speriodic box of size [%f %f %f].", */
   /* 	  N_total[0], (periodic ? "": "non-"), dim[0], dim[1], dim[2]); */
 
+  /* Restrict the read to the selected particles */
+  struct partial_io_range* ranges[swift_type_count] = {NULL};
+  size_t nr_ranges[swift_type_count] = {0};
+  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+    const long long N_file = N_total[ptype];
+    N_total[ptype] = partial_io_select_particles(
+        h_file, selection, ptype, N_file, &ranges[ptype], &nr_ranges[ptype]);
+    if (mpi_rank == 0 && partial_io_selection_is_active(selection) &&
+        N_file > 0)
+      message("Reading %lld of the %lld particles of type %s.", N_total[ptype],
+              N_file, part_type_names[ptype]);
+  }
+
   /* Divide the particles among the tasks. */
   for (int ptype = 0; ptype < swift_type_count; ++ptype) {
     offset[ptype] = mpi_rank * N_total[ptype] / mpi_size;
@@ -1078,9 +1098,16 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
         /* If we are remapping ParticleIDs later, don't need to read them. */
         if (remap_ids && strcmp(list[i].name, "ParticleIDs") == 0) continue;
 
+        /* Skipped fields take their default value. */
+        if (partial_io_skip_field(selection, &list[i])) {
+          partial_io_fill_default(&list[i], Nparticles);
+          continue;
+        }
+
         /* Read array. */
         read_array_parallel(h_grp, list[i], Nparticles, N_total[ptype],
-                            mpi_rank, offset[ptype], internal_units, ic_units,
+                            mpi_rank, offset[ptype], ranges[ptype],
+                            nr_ranges[ptype], internal_units, ic_units,
                             cleanup_h, cleanup_sqrt_a, h, a);
       }
 
@@ -1136,6 +1163,7 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
 
   /* Clean up */
   free(ic_units);
+  for (int ptype = 0; ptype < swift_type_count; ++ptype) free(ranges[ptype]);
 
   /* Close property handler */
   H5Pclose(h_plist_id);
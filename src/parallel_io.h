@@ -32,6 +32,7 @@
 #include "part.h"
 
 struct engine;
+struct partial_io_selection;
 struct unit_system;
 
 void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
@@ -47,7 +48,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
                       const int cleanup_sqrt_a, const double h, const double a,
                       const int mpi_rank, const int mpi_size, MPI_Comm comm,
                       MPI_Info info, const int nr_threads, const int dry_run,
-                      const int remap_ids, struct ic_info* ics_metadata);
+                      const int remap_ids, struct ic_info* ics_metadata,
+                      const struct partial_io_selection* selection);
 
 void write_output_parallel(struct engine* e,
                            const struct unit_system* internal_units,
@@ -0,0 +1,478 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+/* Some standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* This object's header. */
+#include "partial_io.h"
+
+/* Local includes. */
+#include "error.h"
+#include "io_properties.h"
+#include "minmax.h"
+#include "parser.h"
+
+/**
+ * @brief Initialise a #partial_io_selection reading everything.
+ *
+ * @param sel The #partial_io_selection.
+ */
+void partial_io_selection_init_all(struct partial_io_selection *sel) {
+
+  bzero(sel, sizeof(struct partial_io_selection));
+  for (int ptype = 0; ptype < swift_type_count; ++ptype)
+    sel->read_type[ptype] = 1;
+}
+
+/**
+ * @brief Initialise a #partial_io_selection from the InitialConditions
+ * section of the parameter file.
+ *
+ * @param sel The #partial_io_selection.
+ * @param params The parsed parameter file.
+ *
+ * @return Whether only a part of the file will be read.
+ */
+int partial_io_selection_init(struct partial_io_selection *sel,
+                              struct swift_params *params) {
+
+  partial_io_selection_init_all(sel);
+
+  /* Region to read */
+  const int with_min =
+      parser_does_param_exist(params, "InitialConditions:region_min");
+  const int with_max =
+      parser_does_param_exist(params, "InitialConditions:region_max");
+  if (with_min != with_max)
+    error(
+        "InitialConditions:region_min and InitialConditions:region_max must "
+        "be given together.");
+  if (with_min) {
+    parser_get_param_double_array(params, "InitialConditions:region_min", 3,
+                                  sel->region_min);
+    parser_get_param_double_array(params, "InitialConditions:region_max", 3,
+                                  sel->region_max);
+    for (int k = 0; k < 3; ++k)
+      if (sel->region_max[k] < sel->region_min[k])
+        error("Invalid region to read: [%e, %e] along axis %d.",
+              sel->region_min[k], sel->region_max[k], k);
+    sel->with_region = 1;
+  }
+
+  /* Particle types to read */
+  if (parser_does_param_exist(params, "InitialConditions:read_types")) {
+
+    int nval = 0;
+    char **values = NULL;
+    parser_get_param_string_array(params, "InitialConditions:read_types",
+                                  &nval, &values);
+
+    for (int ptype = 0; ptype < swift_type_count; ++ptype)
+      sel->read_type[ptype] = 0;
+
+    for (int i = 0; i < nval; ++i) {
+      int found = 0;
+      for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+        if (strcmp(values[i], part_type_names[ptype]) == 0) {
+          sel->read_type[ptype] = 1;
+          found = 1;
+        }
+      }
+      if (!found) error("Unknown particle type '%s' to read.", values[i]);
+    }
+    parser_free_param_string_array(nval, values);
+  }
+
+  /* Fields not to read */
+  if (parser_does_param_exist(params, "InitialConditions:skip_fields")) {
+
+    int nval = 0;
+    char **values = NULL;
+    parser_get_param_string_array(params, "InitialConditions:skip_fields",
+                                  &nval, &values);
+
+    if (nval > partial_io_max_skipped_fields)
+      error("Too many fields to skip (%d). The maximum is %d.", nval,
+            partial_io_max_skipped_fields);
+
+    for (int i = 0; i < nval; ++i)
+      safe_strcpy(sel->skipped_fields[i], values[i], FIELD_BUFFER_SIZE);
+    sel->num_skipped_fields = nval;
+    parser_free_param_string_array(nval, values);
+  }
+
+  return partial_io_selection_is_active(sel);
+}
+
+/**
+ * @brief Does a #partial_io_selection restrict what is read from a file?
+ *
+ * @param sel The #partial_io_selection (can be NULL).
+ */
+int partial_io_selection_is_active(const struct partial_io_selection *sel) {
+
+  if (sel == NULL) return 0;
+  if (sel->with_region || sel->num_skipped_fields > 0) return 1;
+  for (int ptype = 0; ptype < swift_type_count; ++ptype)
+    if (!sel->read_type[ptype]) return 1;
+  return 0;
+}
+
+/**
+ * @brief Is a field skipped by a #partial_io_selection?
+ *
+ * Only optional fields can be skipped. They then take their default value.
+ *
+ * @param sel The #partial_io_selection (can be NULL).
+ * @param props The #io_props of the field.
+ */
+int partial_io_skip_field(const struct partial_io_selection *sel,
+                          const struct io_props *props) {
+
+  if (sel == NULL) return 0;
+
+  for (int i = 0; i < sel->num_skipped_fields; ++i) {
+    if (strcmp(sel->skipped_fields[i], props->name) == 0) {
+      if (props->importance == COMPULSORY)
+        error("The compulsory field '%s' cannot be skipped.", props->name);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Set a field of the particles to its default value.
+ *
+ * This is what happens to the optional fields absent from a file.
+ *
+ * @param props The #io_props of the field.
+ * @param N The number of particles.
+ */
+void partial_io_fill_default(const struct io_props *props, size_t N) {
+
+  const size_t copySize = io_sizeof_type(props->type) * props->dimension;
+
+  /* Create a single instance of the default value */
+  float *temp = (float *)malloc(copySize);
+  for (int i = 0; i < props->dimension; ++i) temp[i] = props->default_value;
+
+  /* Copy it everywhere in the particle array */
+  for (size_t i = 0; i < N; ++i)
+    memcpy(props->field + i * props->partSize, temp, copySize);
+
+  free(temp);
+}
+
+#if defined(HAVE_HDF5)
+
+/**
+ * @brief Does a cell overlap a region of a (periodic) box?
+ *
+ * The cell is also tested against the periodic copies of the region such
+ * that regions straddling the edge of the box are handled.
+ *
+ * @param lo The lower corner of the cell.
+ * @param hi The upper corner of the cell.
+ * @param sel The #partial_io_selection containing the region.
+ * @param box The size of the box.
+ */
+static int partial_io_cell_overlaps(const double lo[3], const double hi[3],
+                                    const struct partial_io_selection *sel,
+                                    const double box[3]) {
+
+  for (int k = 0; k < 3; ++k) {
+    int overlaps = 0;
+    for (int shift = -1; shift <= 1; ++shift) {
+      const double dx = shift * box[k];
+      if (lo[k] + dx <= sel->region_max[k] && hi[k] + dx >= sel->region_min[k])
+        overlaps = 1;
+    }
+    if (!overlaps) return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Sort #partial_io_range by offset.
+ */
+static int partial_io_range_cmp(const void *a, const void *b) {
+
+  const struct partial_io_range *ra = (const struct partial_io_range *)a;
+  const struct partial_io_range *rb = (const struct partial_io_range *)b;
+  return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+
+/**
+ * @brief Compute the particles of a given type to read from a file.
+ *
+ * The region is converted into a list of ranges of particles in the arrays
+ * of the file using the top-level cell meta-data written with the snapshots
+ * (group /Cells). All the particles of the cells whose envelope overlaps the
+ * region are read. Neighbouring ranges are merged.
+ *
+ * @param h_file The HDF5 file.
+ * @param sel The #partial_io_selection (can be NULL).
+ * @param ptype The type of particles.
+ * @param N_file The number of particles of that type in the file.
+ * @param ranges (return) The ranges to read. NULL if all the particles are
+ * to be read. To be freed by the caller.
+ * @param nr_ranges (return) The number of ranges.
+ *
+ * @return The number of particles to read.
+ */
+long long partial_io_select_particles(hid_t h_file,
+                                      const struct partial_io_selection *sel,
+                                      const int ptype, const long long N_file,
+                                      struct partial_io_range **ranges,
+                                      size_t *nr_ranges) {
+
+  *ranges = NULL;
+  *nr_ranges = 0;
+
+  if (sel == NULL) return N_file;
+  if (!sel->read_type[ptype]) return 0;
+  if (!sel->with_region || N_file == 0) return N_file;
+
+  /* Recover the size of the box */
+  double box[3] = {0.0, -1.0, -1.0};
+  const hid_t h_header = H5Gopen(h_file, "/Header", H5P_DEFAULT);
+  if (h_header < 0) error("Error while opening file header");
+  io_read_attribute(h_header, "BoxSize", DOUBLE, box);
+  H5Gclose(h_header);
+  if (box[1] < 0.) box[1] = box[0];
+  if (box[2] < 0.) box[2] = box[0];
+
+  /* Open the cell meta-data */
+  const htri_t exist = H5Lexists(h_file, "/Cells", H5P_DEFAULT);
+  if (exist <= 0)
+    error(
+        "Cannot read a region of a file without cell meta-data (group "
+        "'/Cells').");
+  const hid_t h_cells = H5Gopen(h_file, "/Cells", H5P_DEFAULT);
+  if (h_cells < 0) error("Error while opening the cell meta-data");
+
+  int nr_cells = 0;
+  double width[3];
+  const hid_t h_meta = H5Gopen(h_cells, "Meta-data", H5P_DEFAULT);
+  if (h_meta < 0) error("Error while opening the cell meta-data attributes");
+  io_read_attribute(h_meta, "nr_cells", INT, &nr_cells);
+  io_read_attribute(h_meta, "size", DOUBLE, width);
+  H5Gclose(h_meta);
+
+  char name[PARTICLE_GROUP_BUFFER_SIZE];
+  snprintf(name, PARTICLE_GROUP_BUFFER_SIZE, "PartType%d", ptype);
+
+  const hid_t h_counts = H5Gopen(h_cells, "Counts", H5P_DEFAULT);
+  const hid_t h_offsets = H5Gopen(h_cells, "OffsetsInFile", H5P_DEFAULT);
+  const hid_t h_files = H5Gopen(h_cells, "Files", H5P_DEFAULT);
+  if (h_counts < 0 || h_offsets < 0 || h_files < 0)
+    error("Error while opening the cell meta-data groups");
+  if (H5Lexists(h_counts, name, H5P_DEFAULT) <= 0)
+    error("No cell meta-data for particle type %d.", ptype);
+
+  long long *counts = (long long *)malloc(nr_cells * sizeof(long long));
+  long long *offsets = (long long *)malloc(nr_cells * sizeof(long long));
+  int *files = (int *)malloc(nr_cells * sizeof(int));
+  double *min_pos = (double *)malloc(3 * nr_cells * sizeof(double));
+  double *max_pos = (double *)malloc(3 * nr_cells * sizeof(double));
+  if (counts == NULL || offsets == NULL || files == NULL || min_pos == NULL ||
+      max_pos == NULL)
+    error("Unable to allocate memory for the cell meta-data");
+
+  io_read_array_dataset(h_counts, name, LONGLONG, counts, nr_cells);
+  io_read_array_dataset(h_offsets, name, LONGLONG, offsets, nr_cells);
+  io_read_array_dataset(h_files, name, INT, files, nr_cells);
+  H5Gclose(h_counts);
+  H5Gclose(h_offsets);
+  H5Gclose(h_files);
+
+  /* Use the envelope of the particles if we have it, the cells otherwise */
+  int with_envelope = 0;
+  if (H5Lexists(h_cells, "MinPositions", H5P_DEFAULT) > 0 &&
+      H5Lexists(h_cells, "MaxPositions", H5P_DEFAULT) > 0) {
+    const hid_t h_min = H5Gopen(h_cells, "MinPositions", H5P_DEFAULT);
+    const hid_t h_max = H5Gopen(h_cells, "MaxPositions", H5P_DEFAULT);
+    if (H5Lexists(h_min, name, H5P_DEFAULT) > 0 &&
+        H5Lexists(h_max, name, H5P_DEFAULT) > 0) {
+      io_read_array_dataset(h_min, name, DOUBLE, min_pos, 3 * nr_cells);
+      io_read_array_dataset(h_max, name, DOUBLE, max_pos, 3 * nr_cells);
+      with_envelope = 1;
+    }
+    H5Gclose(h_min);
+    H5Gclose(h_max);
+  }
+  if (!with_envelope) {
+    io_read_array_dataset(h_cells, "Centres", DOUBLE, min_pos, 3 * nr_cells);
+    for (int i = 0; i < 3 * nr_cells; ++i) {
+      max_pos[i] = min_pos[i] + 0.5 * width[i % 3];
+      min_pos[i] -= 0.5 * width[i % 3];
+    }
+  }
+  H5Gclose(h_cells);
+
+  /* Collect the cells overlapping the region */
+  struct partial_io_range *r = (struct partial_io_range *)malloc(
+      (nr_cells > 0 ? nr_cells : 1) * sizeof(struct partial_io_range));
+  if (r == NULL) error("Unable to allocate memory for the particle ranges");
+  size_t count = 0;
+  for (int i = 0; i < nr_cells; ++i) {
+
+    if (counts[i] == 0) continue;
+
+    if (files[i] != 0)
+      error(
+          "The particles of type %d are spread over several files. Regions "
+          "can only be read from single-file snapshots.",
+          ptype);
+
+    if (!partial_io_cell_overlaps(&min_pos[3 * i], &max_pos[3 * i], sel, box))
+      continue;
+
+    r[count].offset = offsets[i];
+    r[count].count = counts[i];
+    count++;
+  }
+
+  free(counts);
+  free(offsets);
+  free(files);
+  free(min_pos);
+  free(max_pos);
+
+  /* Sort the ranges and merge the contiguous ones */
+  qsort(r, count, sizeof(struct partial_io_range), partial_io_range_cmp);
+  size_t merged = 0;
+  long long total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (merged > 0 &&
+        r[merged - 1].offset + r[merged - 1].count == r[i].offset) {
+      r[merged - 1].count += r[i].count;
+    } else {
+      r[merged++] = r[i];
+    }
+    total += r[i].count;
+  }
+
+  if (total > N_file)
+    error("Cell meta-data inconsistent with the particle counts (%lld > %lld)",
+          total, N_file);
+
+  *ranges = r;
+  *nr_ranges = merged;
+  return total;
+}
+
+/**
+ * @brief Select some particles of a list of ranges in an HDF5 data space.
+ *
+ * The ranges are considered as one contiguous list of particles from which
+ * the elements [first, first + count[ are selected. The data space can be
+ * one- or two-dimensional (vector fields).
+ *
+ * @param h_space The HDF5 data space of the dataset in the file.
+ * @param ranges The #partial_io_range.
+ * @param nr_ranges The number of ranges.
+ * @param first The index of the first particle to select.
+ * @param count The number of particles to select.
+ */
+void partial_io_select_hyperslab(hid_t h_space,
+                                 const struct partial_io_range *ranges,
+                                 const size_t nr_ranges, long long first,
+                                 long long count) {
+
+  hsize_t dims[2] = {0, 1};
+  const int rank = H5Sget_simple_extent_ndims(h_space);
+  if (rank < 1 || rank > 2) error("Invalid rank for a particle array");
+  H5Sget_simple_extent_dims(h_space, dims, NULL);
+
+  if (H5Sselect_none(h_space) < 0) error("Error while resetting selection");
+
+  for (size_t i = 0; i < nr_ranges && count > 0; ++i) {
+
+    /* Skip the ranges before the first particle we want */
+    if (first >= ranges[i].count) {
+      first -= ranges[i].count;
+      continue;
+    }
+
+    const long long n = min(ranges[i].count - first, count);
+    const hsize_t start[2] = {(hsize_t)(ranges[i].offset + first), 0};
+    const hsize_t block[2] = {(hsize_t)n, rank > 1 ? dims[1] : 1};
+    if (H5Sselect_hyperslab(h_space, H5S_SELECT_OR, start, NULL, block,
+                            NULL) < 0)
+      error("Error while selecting a hyperslab");
+
+    first = 0;
+    count -= n;
+  }
+
+  if (count > 0) error("Selecting more particles than in the ranges");
+}
+
+/**
+ * @brief Read the selected particles of a dataset.
+ *
+ * No unit conversion is applied. The values are stored contiguously in the
+ * buffer in the order of the ranges.
+ *
+ * @param h_grp The HDF5 group containing the dataset.
+ * @param name The name of the dataset.
+ * @param type The #IO_DATA_TYPE of the buffer.
+ * @param dimension The number of elements per particle.
+ * @param ranges The #partial_io_range (NULL to read all the particles).
+ * @param nr_ranges The number of ranges.
+ * @param N The number of particles to read.
+ * @param buffer The buffer to fill (of size N * dimension elements).
+ */
+void partial_io_read_array(hid_t h_grp, const char *name,
+                           enum IO_DATA_TYPE type, const int dimension,
+                           const struct partial_io_range *ranges,
+                           const size_t nr_ranges, const long long N,
+                           void *buffer) {
+
+  const hid_t h_data = H5Dopen(h_grp, name, H5P_DEFAULT);
+  if (h_data < 0) error("Error while opening data space '%s'.", name);
+
+  hid_t h_memspace = H5S_ALL, h_filespace = H5S_ALL;
+  if (ranges != NULL) {
+    const hsize_t shape = (hsize_t)N * dimension;
+    h_memspace = H5Screate_simple(1, &shape, NULL);
+    h_filespace = H5Dget_space(h_data);
+    partial_io_select_hyperslab(h_filespace, ranges, nr_ranges, 0, N);
+  }
+
+  const herr_t h_err = H5Dread(h_data, io_hdf5_type(type), h_memspace,
+                               h_filespace, H5P_DEFAULT, buffer);
+  if (h_err < 0) error("Error while reading data array '%s'.", name);
+
+  if (ranges != NULL) {
+    H5Sclose(h_memspace);
+    H5Sclose(h_filespace);
+  }
+  H5Dclose(h_data);
+}
+
+#endif /* HAVE_HDF5 */
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_PARTIAL_IO_H
+#define SWIFT_PARTIAL_IO_H
+
+/* Config parameters. */
+#include <config.h>
+
+/* Standard headers */
+#include <stddef.h>
+
+/* Local includes. */
+#include "common_io.h"
+#include "part_type.h"
+
+/* Avoid cyclic inclusions */
+struct io_props;
+struct swift_params;
+
+/*! Maximal number of fields that can be skipped when reading a snapshot */
+#define partial_io_max_skipped_fields 32
+
+/**
+ * @brief What to read from a snapshot or an IC file.
+ */
+struct partial_io_selection {
+
+  /*! Are we restricting the read to a region? */
+  int with_region;
+
+  /*! Lower corner of the region (in the units of the file) */
+  double region_min[3];
+
+  /*! Upper corner of the region (in the units of the file) */
+  double region_max[3];
+
+  /*! Are we reading the particles of each type? */
+  int read_type[swift_type_count];
+
+  /*! Number of optional fields not read from the file */
+  int num_skipped_fields;
+
+  /*! Names of the optional fields not read from the file */
+  char skipped_fields[partial_io_max_skipped_fields][FIELD_BUFFER_SIZE];
+};
+
+/**
+ * @brief A contiguous range of particles in the arrays of a file.
+ */
+struct partial_io_range {
+
+  /*! Index of the first particle of the range */
+  long long offset;
+
+  /*! Number of particles in the range */
+  long long count;
+};
+
+void partial_io_selection_init_all(struct partial_io_selection *sel);
+int partial_io_selection_init(struct partial_io_selection *sel,
+                              struct swift_params *params);
+int partial_io_selection_is_active(const struct partial_io_selection *sel);
+int partial_io_skip_field(const struct partial_io_selection *sel,
+                          const struct io_props *props);
+void partial_io_fill_default(const struct io_props *props, size_t N);
+
+#if defined(HAVE_HDF5)
+
+/* HDF5 headers. */
+#include <hdf5.h>
+
+long long partial_io_select_particles(hid_t h_file,
+                                      const struct partial_io_selection *sel,
+                                      const int ptype, const long long N_file,
+                                      struct partial_io_range **ranges,
+                                      size_t *nr_ranges);
+void partial_io_select_hyperslab(hid_t h_space,
+                                 const struct partial_io_range *ranges,
+                                 const size_t nr_ranges, long long first,
+                                 long long count);
+void partial_io_read_array(hid_t h_grp, const char *name,
+                           enum IO_DATA_TYPE type, const int dimension,
+                           const struct partial_io_range *ranges,
+                           const size_t nr_ranges, const long long N,
+                           void *buffer);
+
+#endif /* HAVE_HDF5 */
+
+#endif /* SWIFT_PARTIAL_IO_H */
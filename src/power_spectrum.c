@@ -38,6 +38,7 @@
 /* Local includes. */
 #include "cooling.h"
 #include "engine.h"
+#include "mesh_assignment.h"
 #include "minmax.h"
 #include "neutrino.h"
 #include "random.h"
@@ -153,12 +154,16 @@ struct shot_mapper_data {
 /**
  * @brief Shared information about the mesh to be used by all the threads in the
  * pool.
+ *
+ * All the grids are filled in the same pass over the particles.
  */
 struct grid_mapper_data {
   const struct cell* cells;
-  double* dens;
+  double** grids;
+  double** grids_shift;
+  const enum power_type* types;
+  int nr_grids;
   int N;
-  enum power_type type;
   int windoworder;
   double dim[3];
   double fac;
@@ -176,6 +181,18 @@ struct conv_mapper_data {
   double invcellmean;
 };
 
+/**
+ * @brief Shared information needed for combining a Fourier grid with its
+ * interlaced counterpart.
+ */
+struct interlace_mapper_data {
+  fftw_complex* gridft;
+  const fftw_complex* gridft_shift;
+  int Ngrid;
+  const double* cos_phase;
+  const double* sin_phase;
+};
+
 /**
  * @brief Shared information needed for calculating power from a Fourier grid.
  */
@@ -231,6 +248,50 @@ int should_collect_mass(const enum power_type type, const struct gpart* gp,
   return 0;
 }
 
+/**
+ * @brief Collects the quantity carried by a #gpart for a given #power_type.
+ *
+ * @param type The #power_type we want to collect.
+ * @param gp The #gpart.
+ * @param e The #engine.
+ * @param nu_model The neutrino model used for delta-f weighting.
+ * @param quantity (return) The quantity carried by the particle.
+ * @return 1 if the particle contributes to this type, 0 otherwise.
+ */
+INLINE static int gpart_power_quantity(const enum power_type type,
+                                       const struct gpart* gp,
+                                       const struct engine* e,
+                                       struct neutrino_model* nu_model,
+                                       double* quantity) {
+
+  /* Special case first for the electron pressure */
+  if (type == pow_type_pressure) {
+
+    /* Skip non-gas particles */
+    if (gp->type != swift_type_gas) return 0;
+
+    const struct part* p = &e->s->parts[-gp->id_or_neg_offset];
+    const struct xpart* xp = &e->s->xparts[-gp->id_or_neg_offset];
+    *quantity = cooling_get_electron_pressure(
+        e->physical_constants, e->hydro_properties, e->internal_units,
+        e->cosmology, e->cooling_func, p, xp);
+    return 1;
+  }
+
+  /* We are collecting a mass of some kind.
+   * We skip any particle not matching the PS type we want */
+  if (!should_collect_mass(type, gp, e->ti_current)) return 0;
+
+  /* Compute weight (for neutrino delta-f weighting) */
+  double weight = 1.0;
+  if (gp->type == swift_type_neutrino)
+    gpart_neutrino_weight_mesh_only(gp, nu_model, &weight);
+
+  /* And eventually... collect */
+  *quantity = gp->mass * weight;
+  return 1;
+}
+
 /**
  * @brief Calculates the necessary mass terms for shot noise.
  *
@@ -247,17 +308,6 @@ void shotnoiseterms(const struct cell* c, double* tot12,
   const int gcount = c->grav.count;
   const struct gpart* gparts = c->grav.parts;
 
-  /* Handle on the other particle types */
-  const struct part* parts = e->s->parts;
-  const struct xpart* xparts = e->s->xparts;
-
-  /* Handle on the physics modules */
-  const struct cosmology* cosmo = e->cosmology;
-  const struct hydro_props* hydro_props = e->hydro_properties;
-  const struct unit_system* us = e->internal_units;
-  const struct phys_const* phys_const = e->physical_constants;
-  const struct cooling_function_data* cool_func = e->cooling_func;
-
   /* Local accumulator for this cell */
   double local_tot12 = 0.;
 
@@ -268,31 +318,8 @@ void shotnoiseterms(const struct cell* c, double* tot12,
     if (gparts[i].time_bin == time_bin_inhibited) continue;
 
     double quantity1;
-
-    /* Special case first for the electron pressure */
-    if (type1 == pow_type_pressure) {
-
-      /* Skip non-gas particles */
-      if (gparts[i].type != swift_type_gas) continue;
-
-      const struct part* p = &parts[-gparts[i].id_or_neg_offset];
-      const struct xpart* xp = &xparts[-gparts[i].id_or_neg_offset];
-      quantity1 = cooling_get_electron_pressure(phys_const, hydro_props, us,
-                                                cosmo, cool_func, p, xp);
-    } else {
-
-      /* We are collecting a mass of some kind.
-       * We skip any particle not matching the PS type we want */
-      if (!should_collect_mass(type1, &gparts[i], e->ti_current)) continue;
-
-      /* Compute weight (for neutrino delta-f weighting) */
-      double weight1 = 1.0;
-      if (gparts[i].type == swift_type_neutrino)
-        gpart_neutrino_weight_mesh_only(&gparts[i], nu_model, &weight1);
-
-      /* And eventually... collect */
-      quantity1 = gparts[i].mass * weight1;
-    }
+    if (!gpart_power_quantity(type1, &gparts[i], e, nu_model, &quantity1))
+      continue;
 
     /* Can we assign already? (i.e. this is an auto-spectrum) */
     if (type1 == type2) {
@@ -305,31 +332,8 @@ void shotnoiseterms(const struct cell* c, double* tot12,
     else {
 
       double quantity2;
-
-      /* Special case first for the electron pressure */
-      if (type2 == pow_type_pressure) {
-
-        /* Skip non-gas particles */
-        if (gparts[i].type != swift_type_gas) continue;
-
-        const struct part* p = &parts[-gparts[i].id_or_neg_offset];
-        const struct xpart* xp = &xparts[-gparts[i].id_or_neg_offset];
-        quantity2 = cooling_get_electron_pressure(phys_const, hydro_props, us,
-                                                  cosmo, cool_func, p, xp);
-      } else {
-
-        /* We are collecting a mass of some kind.
-         * We skip any particle not matching the PS type we want */
-        if (!should_collect_mass(type2, &gparts[i], e->ti_current)) continue;
-
-        /* Compute weight (for neutrino delta-f weighting) */
-        double weight2 = 1.0;
-        if (gparts[i].type == swift_type_neutrino)
-          gpart_neutrino_weight_mesh_only(&gparts[i], nu_model, &weight2);
-
-        /* And eventually... collect */
-        quantity2 = gparts[i].mass * weight2;
-      }
+      if (!gpart_power_quantity(type2, &gparts[i], e, nu_model, &quantity2))
+        continue;
 
       /* Now assign to the shot noise collection */
       local_tot12 += quantity1 * quantity2;
@@ -370,293 +374,139 @@ void shotnoise_mapper(void* map_data, int num, void* extra) {
   }
 }
 
-__attribute__((always_inline)) INLINE static void TSC_set(
-    double* mesh, const int N, const int i, const int j, const int k,
-    const double dx, const double dy, const double dz, const double value) {
-
-  const double lx = 0.5 * (0.5 - dx) * (0.5 - dx); /* left side, dist 1 + dx  */
-  const double mx = 0.75 - dx * dx;                /* center, dist |dx|  */
-  const double rx = 0.5 * (0.5 + dx) * (0.5 + dx); /* right side, dist 1 - dx */
-
-  const double ly = 0.5 * (0.5 - dy) * (0.5 - dy); /* left side, dist 1 + dy  */
-  const double my = 0.75 - dy * dy;                /* center, dist |dy|  */
-  const double ry = 0.5 * (0.5 + dy) * (0.5 + dy); /* right side, dist 1 - dy */
-
-  const double lz = 0.5 * (0.5 - dz) * (0.5 - dz); /* left side, dist 1 + dz  */
-  const double mz = 0.75 - dz * dz;                /* center, dist |dz|  */
-  const double rz = 0.5 * (0.5 + dz) * (0.5 + dz); /* right side, dist 1 - dz */
-
-  /* TSC interpolation */
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j - 1, k - 1, N, 2)],
-      value * lx * ly * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j - 1, k + 0, N, 2)],
-      value * lx * ly * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j - 1, k + 1, N, 2)],
-      value * lx * ly * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j + 0, k - 1, N, 2)],
-      value * lx * my * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j + 0, k + 0, N, 2)],
-      value * lx * my * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j + 0, k + 1, N, 2)],
-      value * lx * my * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j + 1, k - 1, N, 2)],
-      value * lx * ry * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j + 1, k + 0, N, 2)],
-      value * lx * ry * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i - 1, j + 1, k + 1, N, 2)],
-      value * lx * ry * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j - 1, k - 1, N, 2)],
-      value * mx * ly * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j - 1, k + 0, N, 2)],
-      value * mx * ly * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j - 1, k + 1, N, 2)],
-      value * mx * ly * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 0, k - 1, N, 2)],
-      value * mx * my * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 0, k + 0, N, 2)],
-      value * mx * my * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 0, k + 1, N, 2)],
-      value * mx * my * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 1, k - 1, N, 2)],
-      value * mx * ry * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 1, k + 0, N, 2)],
-      value * mx * ry * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 1, k + 1, N, 2)],
-      value * mx * ry * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j - 1, k - 1, N, 2)],
-      value * rx * ly * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j - 1, k + 0, N, 2)],
-      value * rx * ly * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j - 1, k + 1, N, 2)],
-      value * rx * ly * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 0, k - 1, N, 2)],
-      value * rx * my * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 0, k + 0, N, 2)],
-      value * rx * my * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 0, k + 1, N, 2)],
-      value * rx * my * rz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 1, k - 1, N, 2)],
-      value * rx * ry * lz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 1, k + 0, N, 2)],
-      value * rx * ry * mz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 1, k + 1, N, 2)],
-      value * rx * ry * rz);
-}
-
-INLINE static void gpart_to_grid_TSC(const struct gpart* gp, double* rho,
-                                     const int N, const double fac,
-                                     const double dim[3], const double value) {
-
-  /* Fold the particle position position */
-  const double pos_x = box_wrap_multiple(gp->x[0], 0., dim[0]) * fac;
-  const double pos_y = box_wrap_multiple(gp->x[1], 0., dim[1]) * fac;
-  const double pos_z = box_wrap_multiple(gp->x[2], 0., dim[2]) * fac;
-
-  /* Workout the TSC coefficients */
-  const int i = (int)(pos_x + 0.5);
-  const double dx = pos_x - i;
-
-  const int j = (int)(pos_y + 0.5);
-  const double dy = pos_y - j;
-
-  const int k = (int)(pos_z + 0.5);
-  const double dz = pos_z - k;
-
-#ifdef SWIFT_DEBUG_CHECKS
-  if (i < 0 || i > N) error("Invalid gpart position in x");
-  if (j < 0 || j > N) error("Invalid gpart position in y");
-  if (k < 0 || k > N) error("Invalid gpart position in z");
-#endif
-
-  TSC_set(rho, N, i, j, k, dx, dy, dz, value);
-}
-
-__attribute__((always_inline)) INLINE static void CIC_set(
-    double* mesh, const int N, const int i, const int j, const int k,
-    const double tx, const double ty, const double tz, const double dx,
-    const double dy, const double dz, const double value) {
-
-  /* Classic CIC interpolation */
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 0, k + 0, N, 2)],
-      value * tx * ty * tz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 0, k + 1, N, 2)],
-      value * tx * ty * dz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 1, k + 0, N, 2)],
-      value * tx * dy * tz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 0, j + 1, k + 1, N, 2)],
-      value * tx * dy * dz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 0, k + 0, N, 2)],
-      value * dx * ty * tz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 0, k + 1, N, 2)],
-      value * dx * ty * dz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 1, k + 0, N, 2)],
-      value * dx * dy * tz);
-  atomic_add_d(
-      &mesh[row_major_id_periodic_with_padding(i + 1, j + 1, k + 1, N, 2)],
-      value * dx * dy * dz);
-}
-
-INLINE static void gpart_to_grid_CIC(const struct gpart* gp, double* rho,
-                                     const int N, const double fac,
-                                     const double dim[3], const double value) {
+/**
+ * @brief Computes the mass assignment window of a #gpart on the power grid.
+ *
+ * @param gp The #gpart.
+ * @param N the size of the grid along one axis.
+ * @param fac Conversion factor of wrapped position to grid.
+ * @param dim The dimensions of the (folded) box.
+ * @param order The order of the mass assignment window.
+ * @param shift Shift (in units of grid cells) applied to the position.
+ * @param ijk (return) The first grid cell covered along each axis.
+ * @param wx (return) The window coefficients along x.
+ * @param wy (return) The window coefficients along y.
+ * @param wz (return) The window coefficients along z.
+ */
+INLINE static void gpart_grid_window(const struct gpart* gp, const int N,
+                                     const double fac, const double dim[3],
+                                     const int order, const double shift,
+                                     int ijk[3], double* wx, double* wy,
+                                     double* wz) {
 
   /* Fold the particle position position */
-  const double pos_x = box_wrap_multiple(gp->x[0], 0., dim[0]) * fac;
-  const double pos_y = box_wrap_multiple(gp->x[1], 0., dim[1]) * fac;
-  const double pos_z = box_wrap_multiple(gp->x[2], 0., dim[2]) * fac;
-
-  /* Workout the CIC coefficients */
-  const int i = (int)pos_x;
-  const double dx = pos_x - i;
-  const double tx = 1. - dx;
-
-  const int j = (int)pos_y;
-  const double dy = pos_y - j;
-  const double ty = 1. - dy;
+  const double pos_x = box_wrap_multiple(gp->x[0], 0., dim[0]) * fac + shift;
+  const double pos_y = box_wrap_multiple(gp->x[1], 0., dim[1]) * fac + shift;
+  const double pos_z = box_wrap_multiple(gp->x[2], 0., dim[2]) * fac + shift;
 
-  const int k = (int)pos_z;
-  const double dz = pos_z - k;
-  const double tz = 1. - dz;
+  /* Workout the window coefficients */
+  ijk[0] = mesh_assignment_weights(pos_x, order, wx);
+  ijk[1] = mesh_assignment_weights(pos_y, order, wy);
+  ijk[2] = mesh_assignment_weights(pos_z, order, wz);
 
 #ifdef SWIFT_DEBUG_CHECKS
-  if (i < 0 || i > N) error("Invalid gpart position in x");
-  if (j < 0 || j > N) error("Invalid gpart position in y");
-  if (k < 0 || k > N) error("Invalid gpart position in z");
+  if (ijk[0] < -1 || ijk[0] > N + 1) error("Invalid gpart position in x");
+  if (ijk[1] < -1 || ijk[1] > N + 1) error("Invalid gpart position in y");
+  if (ijk[2] < -1 || ijk[2] > N + 1) error("Invalid gpart position in z");
 #endif
-
-  CIC_set(rho, N, i, j, k, tx, ty, tz, dx, dy, dz, value);
 }
 
-INLINE static void gpart_to_grid_NGP(const struct gpart* gp, double* rho,
-                                     const int N, const double fac,
-                                     const double dim[3], const double value) {
-
-  /* Fold the particle position position */
-  const double pos_x = box_wrap_multiple(gp->x[0], 0., dim[0]) * fac;
-  const double pos_y = box_wrap_multiple(gp->x[1], 0., dim[1]) * fac;
-  const double pos_z = box_wrap_multiple(gp->x[2], 0., dim[2]) * fac;
-
-  const int xi = (int)(pos_x + 0.5) % N;
-  const int yi = (int)(pos_y + 0.5) % N;
-  const int zi = (int)(pos_z + 0.5) % N;
-  atomic_add_d(&rho[(xi * N + yi) * (N + 2) + zi], value);
+/**
+ * @brief Assigns a quantity to the power grid using pre-computed mass
+ * assignment window coefficients.
+ *
+ * @param rho The (padded) grid.
+ * @param N the size of the grid along one axis.
+ * @param order The order of the mass assignment window.
+ * @param ijk The first grid cell covered along each axis.
+ * @param wx The window coefficients along x.
+ * @param wy The window coefficients along y.
+ * @param wz The window coefficients along z.
+ * @param value The quantity to assign.
+ */
+INLINE static void grid_window_assign(double* rho, const int N,
+                                      const int order, const int ijk[3],
+                                      const double* wx, const double* wy,
+                                      const double* wz, const double value) {
+
+  for (int ii = 0; ii < order; ++ii) {
+    for (int jj = 0; jj < order; ++jj) {
+      const double wxy = value * wx[ii] * wy[jj];
+      for (int kk = 0; kk < order; ++kk) {
+        atomic_add_d(&rho[row_major_id_periodic_with_padding(
+                         ijk[0] + ii, ijk[1] + jj, ijk[2] + kk, N, 2)],
+                     wxy * wz[kk]);
+      }
+    }
+  }
 }
 
 /**
- * @brief Assigns all the #gpart of a #cell to the power grid using the
+ * @brief Assigns all the #gpart of a #cell to a set of power grids using the
  * chosen mass assignment method.
  *
+ * The window of a particle is computed once and re-used for all the grids it
+ * contributes to.
+ *
  * @param c The #cell.
- * @param rho The density grid.
+ * @param grids The density grids.
+ * @param grids_shift The interlaced density grids (NULL if not interlacing).
+ * @param types The #power_type assigned to each grid.
+ * @param nr_grids The number of grids.
  * @param N the size of the grid along one axis.
  * @param fac Conversion factor of wrapped position to grid.
- * @param type The #power_type we want to assign to the grid.
  * @param windoworder The window to use for grid assignment.
+ * @param dim The dimensions of the (folded) box.
  * @param e The #engine.
+ * @param nu_model The neutrino model used for delta-f weighting.
  */
-void cell_to_powgrid(const struct cell* c, double* rho, const int N,
-                     const double fac, const enum power_type type,
-                     const int windoworder, const double dim[3],
-                     const struct engine* e, struct neutrino_model* nu_model) {
+void cell_to_powgrids(const struct cell* c, double** grids,
+                      double** grids_shift, const enum power_type* types,
+                      const int nr_grids, const int N, const double fac,
+                      const int windoworder, const double dim[3],
+                      const struct engine* e,
+                      struct neutrino_model* nu_model) {
 
   const int gcount = c->grav.count;
   const struct gpart* gparts = c->grav.parts;
 
-  /* Handle on the other particle types */
-  const struct part* parts = e->s->parts;
-  const struct xpart* xparts = e->s->xparts;
-
-  /* Handle on the physics modules */
-  const struct cosmology* cosmo = e->cosmology;
-  const struct hydro_props* hydro_props = e->hydro_properties;
-  const struct unit_system* us = e->internal_units;
-  const struct phys_const* phys_const = e->physical_constants;
-  const struct cooling_function_data* cool_func = e->cooling_func;
-
   /* Assign all the gpart of that cell to the mesh */
   for (int i = 0; i < gcount; ++i) {
 
     /* Skip invalid particles */
     if (gparts[i].time_bin == time_bin_inhibited) continue;
 
-    /* Collect the quantity to assign to the mesh */
-    double quantity;
-
-    /* Special case first for the electron pressure */
-    if (type == pow_type_pressure) {
-
-      /* Skip non-gas particles */
-      if (gparts[i].type != swift_type_gas) continue;
-
-      const struct part* p = &parts[-gparts[i].id_or_neg_offset];
-      const struct xpart* xp = &xparts[-gparts[i].id_or_neg_offset];
-      quantity = cooling_get_electron_pressure(phys_const, hydro_props, us,
-                                               cosmo, cool_func, p, xp);
-    } else {
-
-      /* We are collecting a mass of some kind.
-       * We skip any particle not matching the PS type we want */
-      if (!should_collect_mass(type, &gparts[i], e->ti_current)) continue;
-
-      /* Compute weight (for neutrino delta-f weighting) */
-      double weight = 1.0;
-      if (gparts[i].type == swift_type_neutrino)
-        gpart_neutrino_weight_mesh_only(&gparts[i], nu_model, &weight);
+    /* Window of this particle (computed lazily) */
+    int have_window = 0;
+    int ijk[3], ijk_shift[3];
+    double wx[mesh_assignment_max_width], wx_shift[mesh_assignment_max_width];
+    double wy[mesh_assignment_max_width], wy_shift[mesh_assignment_max_width];
+    double wz[mesh_assignment_max_width], wz_shift[mesh_assignment_max_width];
+
+    for (int g = 0; g < nr_grids; ++g) {
+
+      /* Collect the quantity to assign to the mesh */
+      double quantity;
+      if (!gpart_power_quantity(types[g], &gparts[i], e, nu_model, &quantity))
+        continue;
+
+      if (!have_window) {
+        gpart_grid_window(&gparts[i], N, fac, dim, windoworder, /*shift=*/0.,
+                          ijk, wx, wy, wz);
+        if (grids_shift != NULL)
+          gpart_grid_window(&gparts[i], N, fac, dim, windoworder,
+                            /*shift=*/0.5, ijk_shift, wx_shift, wy_shift,
+                            wz_shift);
+        have_window = 1;
+      }
 
-      /* And eventually... collect */
-      quantity = gparts[i].mass * weight;
-    }
+      /* Assign the quantity to the grid */
+      grid_window_assign(grids[g], N, windoworder, ijk, wx, wy, wz, quantity);
 
-    /* Assign the quantity to the grid */
-    switch (windoworder) {
-      case 1:
-        gpart_to_grid_NGP(&gparts[i], rho, N, fac, dim, quantity);
-        break;
-      case 2:
-        gpart_to_grid_CIC(&gparts[i], rho, N, fac, dim, quantity);
-        break;
-      case 3:
-        gpart_to_grid_TSC(&gparts[i], rho, N, fac, dim, quantity);
-        break;
-      default:
-#ifdef SWIFT_DEBUG_CHECKS
-        error("Not implemented!");
-#endif
-        break;
+      /* And to the interlaced grid, if any */
+      if (grids_shift != NULL)
+        grid_window_assign(grids_shift[g], N, windoworder, ijk_shift, wx_shift,
+                           wy_shift, wz_shift, quantity);
     }
 
   } /* Loop over particles */
@@ -667,21 +517,14 @@ void cell_to_powgrid(const struct cell* c, double* rho, const int N,
  *
  * @param map_data A chunk of the list of local cells.
  * @param num The number of cells in the chunk.
- * @param extra The information about the grid and cells.
+ * @param extra The information about the grids and cells.
  */
 void cell_to_powgrid_mapper(void* map_data, int num, void* extra) {
 
   /* Unpack the shared information */
   const struct grid_mapper_data* data = (struct grid_mapper_data*)extra;
   const struct cell* cells = data->cells;
-  double* grid = data->dens;
-  const int Ngrid = data->N;
-  const enum power_type type = data->type;
-  const int order = data->windoworder;
   const double dim[3] = {data->dim[0], data->dim[1], data->dim[2]};
-  const double gridfac = data->fac;
-  const struct engine* e = data->e;
-  struct neutrino_model* nu_model = data->nu_model;
 
   /* Pointer to the chunk to be processed */
   int* local_cells = (int*)map_data;
@@ -691,8 +534,10 @@ void cell_to_powgrid_mapper(void* map_data, int num, void* extra) {
     /* Pointer to local cell */
     const struct cell* c = &cells[local_cells[i]];
 
-    /* Assign this cell's content to the grid */
-    cell_to_powgrid(c, grid, Ngrid, gridfac, type, order, dim, e, nu_model);
+    /* Assign this cell's content to the grids */
+    cell_to_powgrids(c, data->grids, data->grids_shift, data->types,
+                     data->nr_grids, data->N, data->fac, data->windoworder,
+                     dim, data->e, data->nu_model);
   }
 }
 
@@ -727,6 +572,44 @@ void mass_to_contrast_mapper(void* map_data, int num, void* extra) {
   }
 }
 
+/**
+ * @brief Mapper function combining a Fourier grid with its interlaced
+ * counterpart.
+ *
+ * @param map_data The array of the density field Fourier transform.
+ * @param num The number of elements to iterate on (along the x-axis).
+ * @param extra The interlaced grid and the phase tables.
+ */
+void interlace_grid_mapper(void* map_data, const int num, void* extra) {
+
+  const struct interlace_mapper_data* data =
+      (struct interlace_mapper_data*)extra;
+
+  /* Unpack the data struct */
+  fftw_complex* restrict gridft = data->gridft;
+  const fftw_complex* restrict gridft_shift = data->gridft_shift;
+  const int Ngrid = data->Ngrid;
+  const int Nhalf = Ngrid / 2;
+  const double* cos_phase = data->cos_phase;
+  const double* sin_phase = data->sin_phase;
+
+  /* Range handled by this call */
+  const int xi_start = (fftw_complex*)map_data - gridft;
+  const int xi_end = xi_start + num;
+
+  for (int xi = xi_start; xi < xi_end; ++xi) {
+    for (int yi = 0; yi < Ngrid; ++yi) {
+      for (int zi = 0; zi < (Nhalf + 1); ++zi) {
+
+        const int index = (xi * Ngrid + yi) * (Nhalf + 1) + zi;
+        mesh_interlacing_combine(cos_phase, sin_phase, xi, yi, zi,
+                                 gridft_shift[index][0], gridft_shift[index][1],
+                                 &gridft[index][0], &gridft[index][1]);
+      }
+    }
+  }
+}
+
 /**
  * @brief Mapper function for calculating the power from a Fourier grid.
  *
@@ -808,6 +691,79 @@ void pow_from_grid_mapper(void* map_data, const int num, void* extra) {
   } /* Loop over z */
 }
 
+/**
+ * @brief Sums the (padded) power grid of all the ranks onto rank 0.
+ *
+ * @param grid The grid.
+ * @param Ngrid The size of the grid along one axis.
+ * @param nodeID The rank of this node.
+ */
+INLINE static void power_reduce_grid(double* grid, const int Ngrid,
+                                     const int nodeID) {
+#ifdef WITH_MPI
+  const int count = Ngrid * Ngrid * (Ngrid + 2);
+  if (nodeID == 0)
+    MPI_Reduce(MPI_IN_PLACE, grid, count, MPI_DOUBLE, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+  else
+    MPI_Reduce(grid, NULL, count, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+#endif
+}
+
+/**
+ * @brief Converts the mass (or pressure) grid to a density contrast (or
+ * eV/cm^3).
+ *
+ * @param grid The grid.
+ * @param Ngrid The size of the grid along one axis.
+ * @param invcellmean The inverse of the mean quantity per cell.
+ * @param tp The #threadpool object used for parallelisation.
+ */
+INLINE static void power_grid_to_contrast(double* grid, const int Ngrid,
+                                          const double invcellmean,
+                                          struct threadpool* tp) {
+  struct conv_mapper_data convdata;
+  convdata.grid = grid;
+  convdata.Ngrid = Ngrid;
+  convdata.invcellmean = invcellmean;
+  if (Ngrid < 32) {
+    mass_to_contrast_mapper(grid, Ngrid, &convdata);
+  } else {
+    threadpool_map(tp, mass_to_contrast_mapper, grid, Ngrid, sizeof(double),
+                   threadpool_auto_chunk_size, &convdata);
+  }
+}
+
+/**
+ * @brief Averages a Fourier grid with its interlaced counterpart.
+ *
+ * @param gridft The Fourier grid (overwritten by the average).
+ * @param gridft_shift The Fourier transform of the interlaced grid.
+ * @param Ngrid The size of the grid along one axis.
+ * @param cos_phase The table of cosines from mesh_interlacing_phases().
+ * @param sin_phase The table of sines from mesh_interlacing_phases().
+ * @param tp The #threadpool object used for parallelisation.
+ */
+INLINE static void power_interlace_grid(fftw_complex* gridft,
+                                        const fftw_complex* gridft_shift,
+                                        const int Ngrid,
+                                        const double* cos_phase,
+                                        const double* sin_phase,
+                                        struct threadpool* tp) {
+  struct interlace_mapper_data data;
+  data.gridft = gridft;
+  data.gridft_shift = gridft_shift;
+  data.Ngrid = Ngrid;
+  data.cos_phase = cos_phase;
+  data.sin_phase = sin_phase;
+  if (Ngrid < 32) {
+    interlace_grid_mapper(gridft, Ngrid, &data);
+  } else {
+    threadpool_map(tp, interlace_grid_mapper, gridft, Ngrid,
+                   sizeof(fftw_complex), threadpool_auto_chunk_size, &data);
+  }
+}
+
 /**
  * @brief Initialize a power spectrum output file
  *
@@ -871,41 +827,358 @@ INLINE static void power_init_output_file(FILE* fp, const enum power_type type1,
 }
 
 /**
- * @brief Compute the power spectrum between type1 and type2, including
- * foldings and dealiasing. Only the real part of the power is returned.
+ * @brief Inverse of the cosmic mean quantity per grid cell of a component.
  *
- * Distributes the cells into slabs, performs the FFT, calculates the dealiased
- * power and writes this to file. Then repeats this procedure for a given
- * number of foldings.
+ * @param type The #power_type of the component.
+ * @param Ngrid The size of the grid along one axis.
+ * @param volume The volume of the (unfolded) box.
+ * @param meanrho The mean matter density.
+ * @param conv_EV Conversion factor of pressures to eV/cm^3.
+ */
+INLINE static double power_inv_cell_mean(const enum power_type type,
+                                         const int Ngrid, const double volume,
+                                         const double meanrho,
+                                         const double conv_EV) {
+
+  const double Ngrid3 = (double)Ngrid * Ngrid * Ngrid;
+
+  double invcellmean;
+  if (type != pow_type_pressure)
+    invcellmean = Ngrid3 / (meanrho * volume);
+  else
+    invcellmean = Ngrid3 / volume * conv_EV;
+
+  /* When splitting the neutrino ensemble in half, double the inverse mean */
+  if (type == pow_type_neutrino_0 || type == pow_type_neutrino_1)
+    invcellmean *= 2.0;
+
+  return invcellmean;
+}
+
+/**
+ * @brief Computes the shot noise of the type1-type2 power spectrum.
  *
- * @param type1 The #enum power_type indicating the first quantity to correlate.
- * @param type2 The #enum power_type indicating the second quantity to
- * correlate.
- * @param powdata The #power_spectrum_data containing power spectrum
- * parameters, FFT plans and pointers to the grids.
+ * @param type1 The component type of field 1.
+ * @param type2 The component type of field 2.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param nu_model The neutrino model used for delta-f weighting.
+ * @param volume The volume of the (unfolded) box.
+ * @param meanrho The mean matter density.
+ * @param conv_EV Conversion factor of pressures to eV/cm^3.
+ */
+static double power_shot_noise(const enum power_type type1,
+                               const enum power_type type2,
+                               const struct space* s, struct threadpool* tp,
+                               struct neutrino_model* nu_model,
+                               const double volume, const double meanrho,
+                               const double conv_EV) {
+
+  /* Note that for cross-power, there is only shot noise for particles
+     that occur in both fields */
+  if (!(type1 == pow_type_matter || type2 == pow_type_matter ||
+        type1 == type2 ||
+        (type1 == pow_type_gas && type2 == pow_type_pressure) ||
+        (type2 == pow_type_gas && type1 == pow_type_pressure)))
+    return 0.;
+
+  struct shot_mapper_data shotdata;
+  shotdata.cells = s->cells_top;
+  shotdata.tot12 = 0;
+  shotdata.type1 = type1;
+  shotdata.type2 = type2;
+  shotdata.e = s->e;
+  shotdata.nu_model = nu_model;
+  threadpool_map(tp, shotnoise_mapper, (void*)s->local_cells_top,
+                 s->nr_local_cells, sizeof(int), threadpool_auto_chunk_size,
+                 (void*)&shotdata);
+#ifdef WITH_MPI
+  /* Add up everybody's shot noise term */
+  MPI_Allreduce(MPI_IN_PLACE, &shotdata.tot12, 1, MPI_DOUBLE, MPI_SUM,
+                MPI_COMM_WORLD);
+#endif
+
+  /* Convert the shot noise to the units of the power */
+  double shot = shotdata.tot12 / volume;
+  if (type1 != pow_type_pressure)
+    shot /= meanrho;
+  else
+    shot *= conv_EV;
+  if (type2 != pow_type_pressure)
+    shot /= meanrho;
+  else
+    shot *= conv_EV;
+
+  return shot;
+}
+
+/**
+ * @brief Deposits a set of components onto their grids and Fourier transforms
+ * them.
+ *
+ * All the grids are filled in a single pass over the particles and then
+ * summed onto rank 0. There, they are converted to density contrast (or
+ * eV/cm^3), transformed in-place and averaged with their interlaced
+ * counterparts (if any).
+ *
+ * @param pow_data The #power_spectrum_data containing the FFT plan.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param nu_model The neutrino model used for delta-f weighting.
+ * @param types The #power_type of each grid.
+ * @param invcellmean The inverse of the mean quantity per cell of each grid.
+ * @param nr_grids The number of grids to fill.
+ * @param grids The grids.
+ * @param grids_shift The interlaced grids (NULL if not interlacing).
+ * @param dim The dimensions of the (folded) box.
+ * @param cos_phase The table of cosines from mesh_interlacing_phases().
+ * @param sin_phase The table of sines from mesh_interlacing_phases().
+ */
+static void power_load_grids(const struct power_spectrum_data* pow_data,
+                             const struct space* s, struct threadpool* tp,
+                             struct neutrino_model* nu_model,
+                             const enum power_type* types,
+                             const double* invcellmean, const int nr_grids,
+                             double** grids, double** grids_shift,
+                             const double dim[3], const double* cos_phase,
+                             const double* sin_phase) {
+
+  const int Ngrid = pow_data->Ngrid;
+  const size_t grid_size = (size_t)Ngrid * Ngrid * (Ngrid + 2);
+  const int nodeID = s->e->nodeID;
+
+  /* Empty the grid(s) */
+  for (int g = 0; g < nr_grids; ++g) {
+    bzero(grids[g], grid_size * sizeof(double));
+    if (grids_shift != NULL) bzero(grids_shift[g], grid_size * sizeof(double));
+  }
+
+  /* Gather the shared information to be used by the threads
+     for density computation */
+  struct grid_mapper_data densdata;
+  densdata.cells = s->cells_top;
+  densdata.grids = grids;
+  densdata.grids_shift = grids_shift;
+  densdata.types = types;
+  densdata.nr_grids = nr_grids;
+  densdata.N = Ngrid;
+  densdata.windoworder = pow_data->windoworder;
+  densdata.dim[0] = dim[0];
+  densdata.dim[1] = dim[1];
+  densdata.dim[2] = dim[2];
+  /* Note:  implicitly assuming a cubic box here */
+  densdata.fac = Ngrid / dim[0];
+  densdata.e = s->e;
+  densdata.nu_model = nu_model;
+
+  /* Fill out all the folded grid(s) in one go */
+  threadpool_map(tp, cell_to_powgrid_mapper, (void*)s->local_cells_top,
+                 s->nr_local_cells, sizeof(int), threadpool_auto_chunk_size,
+                 (void*)&densdata);
+
+  /* Merge everybody's share of the grid(s) onto rank 0 */
+  for (int g = 0; g < nr_grids; ++g) {
+    power_reduce_grid(grids[g], Ngrid, nodeID);
+    if (grids_shift != NULL) power_reduce_grid(grids_shift[g], Ngrid, nodeID);
+  }
+
+  /* Only rank 0 needs to perform all the remaining work */
+  if (nodeID != 0) return;
+
+  for (int g = 0; g < nr_grids; ++g) {
+
+    /* Convert mass to density contrast or pressure to eV/cm^3 */
+    power_grid_to_contrast(grids[g], Ngrid, invcellmean[g], tp);
+
+    /* Perform FFT. The plan is re-used on the (identically padded and
+     * aligned) grids. */
+    fftw_execute_dft_r2c(pow_data->fftplanpow, grids[g],
+                         (fftw_complex*)grids[g]);
+
+    /* Average with the interlaced grid to cancel the odd aliases. */
+    if (grids_shift != NULL) {
+      power_grid_to_contrast(grids_shift[g], Ngrid, invcellmean[g], tp);
+      fftw_execute_dft_r2c(pow_data->fftplanpow, grids_shift[g],
+                           (fftw_complex*)grids_shift[g]);
+      power_interlace_grid((fftw_complex*)grids[g],
+                           (fftw_complex*)grids_shift[g], Ngrid, cos_phase,
+                           sin_phase, tp);
+    }
+  }
+}
+
+/**
+ * @brief Construct the base name of the output files of a power spectrum.
+ *
+ * @param type1 The component type of field 1.
+ * @param type2 The component type of field 2.
+ * @param outputfileBase (return) The base name.
+ */
+INLINE static void power_output_base_name(const enum power_type type1,
+                                          const enum power_type type2,
+                                          char outputfileBase[200]) {
+
+  sprintf(outputfileBase, "power_%s", get_powtype_filename(type1));
+  if (type1 != type2) {
+    const int length = strlen(outputfileBase);
+    sprintf(outputfileBase + length, "-%s", get_powtype_filename(type2));
+  }
+}
+
+/**
+ * @brief Computes the power between two Fourier grids for one folding, writes
+ * it to the detail file and stores the most accurate bins for the combined
+ * spectrum.
+ *
+ * Only called on rank 0.
+ *
+ * @param pow_data The #power_spectrum_data containing the parameters.
+ * @param s The #space containing the particles.
+ * @param tp The #threadpool object used for parallelisation.
+ * @param type1 The component type of field 1.
+ * @param type2 The component type of field 2.
+ * @param gridft1 The Fourier transform of field 1.
+ * @param gridft2 The Fourier transform of field 2.
+ * @param fold The index of the folding.
+ * @param dim The dimensions of the (folded) box.
+ * @param shot The shot noise of this spectrum.
+ * @param kbin The lookup table for the k bins.
+ * @param modecounts Work array for the mode counts.
+ * @param powersum Work array for the power.
+ * @param pcomb (return) The combined power spectrum.
+ */
+static void power_from_grids(
+    const struct power_spectrum_data* pow_data, const struct space* s,
+    struct threadpool* tp, const enum power_type type1,
+    const enum power_type type2, fftw_complex* gridft1, fftw_complex* gridft2,
+    const int fold, const double dim[3], const double shot, int* kbin,
+    int* modecounts, double* powersum, double* pcomb) {
+
+  const int Ngrid = pow_data->Ngrid;
+  const int Nhalf = Ngrid / 2;
+  const double Ngrid3 = (double)Ngrid * Ngrid * Ngrid;
+  const int snapnum = s->e->ps_output_count; /* -1 if after snapshot dump */
+  const double volume = s->dim[0] * s->dim[1] * s->dim[2];
+  const double kfac = 2 * M_PI / dim[0];
+
+  struct pow_mapper_data powmapdata;
+  powmapdata.powgridft = gridft1;
+  powmapdata.powgridft2 = gridft2;
+  powmapdata.Ngrid = Ngrid;
+  powmapdata.windoworder = pow_data->windoworder;
+  powmapdata.modecounts = modecounts;
+  powmapdata.powersum = powersum;
+  powmapdata.kbin = kbin;
+  powmapdata.jfac = M_PI / Ngrid;
+
+  /* Zero the mode arrays */
+  bzero(modecounts, (Nhalf + 1) * sizeof(int));
+  bzero(powersum, (Nhalf + 1) * sizeof(double));
+
+  /* Calculate compensated mode contributions */
+  if (Ngrid < 32) {
+    pow_from_grid_mapper(gridft1, Ngrid, &powmapdata);
+  } else {
+    threadpool_map(tp, pow_from_grid_mapper, gridft1, Ngrid,
+                   sizeof(fftw_complex), threadpool_auto_chunk_size,
+                   &powmapdata);
+  }
+
+  /* Write this folding to the detail file */
+  char outputfileBase[200] = "";
+  char outputfileName[256] = "";
+  power_output_base_name(type1, type2, outputfileBase);
+
+  const double volfac = (volume / Ngrid3) / Ngrid3;
+  sprintf(outputfileName, "%s/%s_%04d_%d.txt", "power_spectra/foldings",
+          outputfileBase, snapnum, fold);
+  FILE* outputfile = fopen(outputfileName, "w");
+
+  /* Determine units of power */
+  char powunits[32] = "";
+  if (type1 != pow_type_pressure && type2 != pow_type_pressure)
+    sprintf(powunits, "Mpc^3");
+  else if (type1 == pow_type_pressure && type2 == pow_type_pressure)
+    sprintf(powunits, "Mpc^3 (eV cm^(-3))^2");
+  else
+    sprintf(powunits, "Mpc^3 eV cm^(-3)");
+
+  fprintf(outputfile,
+          "# Folding %d, all lengths/volumes are comoving. k-bin centres "
+          "are not corrected for the weights of the modes.\n",
+          fold);
+  fprintf(outputfile, "# Shotnoise [%s]\n", powunits);
+  fprintf(outputfile, "%g\n", shot);
+  fprintf(outputfile, "# Redshift [dimensionless]\n");
+  fprintf(outputfile, "%g\n", s->e->cosmology->z);
+  fprintf(outputfile, "# k [Mpc^(-1)]   p [%s]\n", powunits);
+
+  for (int j = 1; j <= Nhalf; ++j) {
+    fprintf(outputfile, "%g %g\n", j * kfac,
+            powersum[j] / modecounts[j] * volfac);
+  }
+  fclose(outputfile);
+
+  /* Combine most accurate measurements from foldings */
+  const int kcutn = (pow_data->windoworder >= 3) ? 90 : 70;
+  const int kcutleft = (int)(Ngrid / 256.0 * kcutn);
+  const int kcutright =
+      (int)(Ngrid / 256.0 * (double)kcutn / pow_data->foldfac);
+
+  if (fold == 0) {
+
+    for (int j = 0; j < kcutleft; ++j)
+      pcomb[j] = powersum[j + 1] / modecounts[j + 1] * volfac;
+
+  } else {
+
+    const int numstart = kcutleft + (fold - 1) * (kcutleft - kcutright + 1);
+    const int off = kcutright + 1;
+    for (int j = 0; j < (kcutleft - kcutright + 1); ++j)
+      pcomb[j + numstart] = powersum[j + off] / modecounts[j + off] * volfac;
+  }
+}
+
+/**
+ * @brief Compute all the requested power spectra, including foldings and
+ * dealiasing. Only the real part of the power is returned.
+ *
+ * The distinct components entering the requested spectra are deposited
+ * together in a single pass over the particles for each folding and each of
+ * them is Fourier transformed only once. All the auto- and cross-spectra are
+ * then formed from these cached transforms.
+ *
+ * If the grids of all the components do not fit in the memory budget, the
+ * components are processed in blocks that fill all but one of the available
+ * grids. The spare grid is then used to stream in the later components
+ * paired with one of the block. Each spectrum is computed exactly once.
+ *
+ * @param pow_data The #power_spectrum_data containing power spectrum
+ * parameters and FFT plans.
  * @param s The #space containing the particles.
  * @param tp The #threadpool object used for parallelisation.
  * @param verbose Are we talkative?
  */
-void power_spectrum(const enum power_type type1, const enum power_type type2,
-                    struct power_spectrum_data* pow_data, const struct space* s,
-                    struct threadpool* tp, const int verbose) {
+void power_spectra_all(struct power_spectrum_data* pow_data,
+                       const struct space* s, struct threadpool* tp,
+                       const int verbose) {
 
-  const int* local_cells = s->local_cells_top;
-  const int nr_local_cells = s->nr_local_cells;
   const struct engine* e = s->e;
   const struct unit_system* us = e->internal_units;
   const struct phys_const* phys_const = e->physical_constants;
   const int snapnum = e->ps_output_count; /* -1 if after snapshot dump */
+  const int nr_spectra = pow_data->spectrumcount;
 
   /* Extract some useful constants */
   const int Ngrid = pow_data->Ngrid;
-  const int Ngrid2 = Ngrid * Ngrid;
-  const int Ngrid3 = Ngrid2 * Ngrid;
   const int Nhalf = Ngrid / 2;
   const int Nfold = pow_data->Nfold;
   const int foldfac = pow_data->foldfac;
-  const double jfac = M_PI / Ngrid;
+  const size_t grid_size = (size_t)Ngrid * Ngrid * (Ngrid + 2);
+
+  /* could loop over particles but for now just abort */
+  if (s->nr_local_cells == 0)
+    error("Cell infrastructure is not in place for power spectra.");
 
   /* Gather some neutrino constants if using delta-f weighting on the mesh */
   struct neutrino_model nu_model;
@@ -913,27 +1186,83 @@ void power_spectrum(const enum power_type type1, const enum power_type type2,
   if (s->e->neutrino_properties->use_delta_f_mesh_only)
     gather_neutrino_consts(s, &nu_model);
 
-  if (verbose)
-    message("Preparing to calculate the %s-%s power spectrum.",
-            get_powtype_name(type1), get_powtype_name(type2));
+  /* Collect the distinct components and the ones entering each spectrum */
+  enum power_type comp_types[pow_type_count];
+  int nr_comps = 0;
+  int* spec_comp1 = (int*)malloc(nr_spectra * sizeof(int));
+  int* spec_comp2 = (int*)malloc(nr_spectra * sizeof(int));
+  if (spec_comp1 == NULL || spec_comp2 == NULL)
+    error("Error allocating memory for the power spectra components.");
+  for (int i = 0; i < nr_spectra; ++i) {
+    for (int side = 0; side < 2; ++side) {
+      const enum power_type type =
+          (side == 0) ? pow_data->types1[i] : pow_data->types2[i];
+      int c = 0;
+      while (c < nr_comps && comp_types[c] != type) ++c;
+      if (c == nr_comps) comp_types[nr_comps++] = type;
+      if (side == 0)
+        spec_comp1[i] = c;
+      else
+        spec_comp2[i] = c;
+    }
+  }
 
-  /* could loop over particles but for now just abort */
-  if (nr_local_cells == 0)
-    error("Cell infrastructure is not in place for power spectra.");
+  /* How many grids can we keep in memory? */
+  const size_t comp_bytes =
+      grid_size * sizeof(double) * (pow_data->interlacing ? 2 : 1);
+  int nr_slots = nr_comps;
+  if (pow_data->grid_memory_budget_MB > 0) {
+    const size_t budget =
+        (size_t)pow_data->grid_memory_budget_MB * 1024 * 1024;
+    const size_t max_slots = budget / comp_bytes;
+    if (max_slots < (size_t)nr_comps) {
+      const int slots = max(2, (int)max_slots);
+      nr_slots = min(nr_comps, slots);
+      if (max_slots < 2 && e->nodeID == 0)
+        message(
+            "WARNING: power spectrum memory budget too small, using %d "
+            "grids of %.1f MB anyway.",
+            nr_slots, comp_bytes / (1024. * 1024.));
+    }
+  }
 
-  /* Allocate the grids based on whether this is an auto- or cross-spectrum*/
-  pow_data->powgrid = fftw_alloc_real(Ngrid2 * (Ngrid + 2));
-  memuse_log_allocation("fftw_grid.grid", pow_data->powgrid, 1,
-                        sizeof(double) * Ngrid2 * (Ngrid + 2));
-  pow_data->powgridft = (fftw_complex*)pow_data->powgrid;
-  if (type1 != type2) {
-    pow_data->powgrid2 = fftw_alloc_real(Ngrid2 * (Ngrid + 2));
-    memuse_log_allocation("fftw_grid.grid2", pow_data->powgrid2, 1,
-                          sizeof(double) * Ngrid2 * (Ngrid + 2));
-    pow_data->powgridft2 = (fftw_complex*)pow_data->powgrid2;
-  } else {
-    pow_data->powgrid2 = pow_data->powgrid;
-    pow_data->powgridft2 = pow_data->powgridft;
+  /* Number of components loaded together (the rest is streamed) */
+  const int block_size = (nr_slots == nr_comps) ? nr_comps : nr_slots - 1;
+
+  if (verbose)
+    message(
+        "Calculating %d power spectra from %d components using %d resident "
+        "grids.",
+        nr_spectra, nr_comps, nr_slots);
+
+  /* Allocate the grids */
+  double** grids = (double**)malloc(nr_slots * sizeof(double*));
+  double** grids_shift = NULL;
+  if (grids == NULL) error("Error allocating memory for the power grids.");
+  for (int g = 0; g < nr_slots; ++g) {
+    grids[g] = fftw_alloc_real(grid_size);
+    if (grids[g] == NULL) error("Error allocating memory for the power grids.");
+    memuse_log_allocation("fftw_grid.grid", grids[g], 1,
+                          sizeof(double) * grid_size);
+  }
+
+  /* Allocate the interlaced grids and the phases used to combine them */
+  double* cos_phase = NULL;
+  double* sin_phase = NULL;
+  if (pow_data->interlacing) {
+    grids_shift = (double**)malloc(nr_slots * sizeof(double*));
+    cos_phase = (double*)malloc(Ngrid * sizeof(double));
+    sin_phase = (double*)malloc(Ngrid * sizeof(double));
+    if (grids_shift == NULL || cos_phase == NULL || sin_phase == NULL)
+      error("Error allocating memory for the interlaced power grids.");
+    for (int g = 0; g < nr_slots; ++g) {
+      grids_shift[g] = fftw_alloc_real(grid_size);
+      if (grids_shift[g] == NULL)
+        error("Error allocating memory for the interlaced power grids.");
+      memuse_log_allocation("fftw_grid.grid_shift", grids_shift[g], 1,
+                            sizeof(double) * grid_size);
+    }
+    mesh_interlacing_phases(Ngrid, cos_phase, sin_phase);
   }
 
   /* Constants used for the normalization */
@@ -947,87 +1276,19 @@ void power_spectrum(const enum power_type type1, const enum power_type type2,
                          phys_const->const_electron_volt;
 
   /* Inverse of the cosmic mean mass per grid cell in code units */
-  double invcellmean, invcellmean2;
-
-  if (type1 != pow_type_pressure)
-    invcellmean = Ngrid3 / (meanrho * volume);
-  else
-    invcellmean = Ngrid3 / volume * conv_EV;
-
-  if (type2 != pow_type_pressure)
-    invcellmean2 = Ngrid3 / (meanrho * volume);
-  else
-    invcellmean2 = Ngrid3 / volume * conv_EV;
-
-  /* When splitting the neutrino ensemble in half, double the inverse mean */
-  if (type1 == pow_type_neutrino_0 || type1 == pow_type_neutrino_1)
-    invcellmean *= 2.0;
-  if (type2 == pow_type_neutrino_0 || type2 == pow_type_neutrino_1)
-    invcellmean2 *= 2.0;
-
-  /* Gather the shared information to be used by the threads
-     for density computation */
-  struct grid_mapper_data densdata;
-  struct grid_mapper_data densdata2;
-
-  densdata.cells = s->cells_top;
-  densdata.dens = pow_data->powgrid;
-  densdata.N = Ngrid;
-  densdata.type = type1;
-  densdata.windoworder = pow_data->windoworder;
-  densdata.e = s->e;
-  densdata.nu_model = &nu_model;
-  if (type1 != type2) {
-    densdata2.cells = s->cells_top;
-    densdata2.dens = pow_data->powgrid2;
-    densdata2.N = Ngrid;
-    densdata2.type = type2;
-    densdata2.windoworder = pow_data->windoworder;
-    densdata2.e = s->e;
-    densdata2.nu_model = &nu_model;
-  }
+  double invcellmean[pow_type_count];
+  for (int c = 0; c < nr_comps; ++c)
+    invcellmean[c] =
+        power_inv_cell_mean(comp_types[c], Ngrid, volume, meanrho, conv_EV);
 
   if (verbose) message("Calculating the shot noise.");
 
   /* Calculate mass terms for shot noise */
-  double shot = 0.;
-  if (type1 == pow_type_matter || type2 == pow_type_matter || type1 == type2 ||
-      (type1 == pow_type_gas && type2 == pow_type_pressure) ||
-      (type2 == pow_type_gas && type1 == pow_type_pressure)) {
-
-    /* Note that for cross-power, there is only shot noise for particles
-       that occur in both fields */
-    struct shot_mapper_data shotdata;
-    shotdata.cells = s->cells_top;
-    shotdata.tot12 = 0;
-    shotdata.type1 = type1;
-    shotdata.type2 = type2;
-    shotdata.e = s->e;
-    shotdata.nu_model = &nu_model;
-    threadpool_map(tp, shotnoise_mapper, (void*)local_cells, nr_local_cells,
-                   sizeof(int), threadpool_auto_chunk_size, (void*)&shotdata);
-#ifdef WITH_MPI
-    /* Add up everybody's shot noise term */
-    MPI_Allreduce(MPI_IN_PLACE, &shotdata.tot12, 1, MPI_DOUBLE, MPI_SUM,
-                  MPI_COMM_WORLD);
-#endif
-
-    /* Store shot noise */
-    shot = shotdata.tot12 / volume;
-    if (type1 != pow_type_pressure)
-      shot /= meanrho;
-    else
-      shot *= conv_EV;
-    if (type2 != pow_type_pressure)
-      shot /= meanrho;
-    else
-      shot *= conv_EV;
-  }
-
-  /* Gather the shared information to be used by the threads
-     for density conversion */
-  struct conv_mapper_data convdata;
-  convdata.Ngrid = Ngrid;
+  double* shot = (double*)malloc(nr_spectra * sizeof(double));
+  if (shot == NULL) error("Error allocating memory for the shot noise.");
+  for (int i = 0; i < nr_spectra; ++i)
+    shot[i] = power_shot_noise(pow_data->types1[i], pow_data->types2[i], s, tp,
+                               &nu_model, volume, meanrho, conv_EV);
 
   /* Create a lookup table for k (could also do this when initializing) */
   int* kbin = (int*)malloc((Nhalf * Nhalf + 1) * sizeof(int));
@@ -1041,17 +1302,7 @@ void power_spectrum(const enum power_type type1, const enum power_type type2,
   int* modecounts = (int*)malloc((Nhalf + 1) * sizeof(int));
   double* powersum = (double*)malloc((Nhalf + 1) * sizeof(double));
 
-  struct pow_mapper_data powmapdata;
-  powmapdata.powgridft = pow_data->powgridft;
-  powmapdata.powgridft2 = pow_data->powgridft2;
-  powmapdata.Ngrid = Ngrid;
-  powmapdata.windoworder = pow_data->windoworder;
-  powmapdata.modecounts = modecounts;
-  powmapdata.powersum = powersum;
-  powmapdata.kbin = kbin;
-  powmapdata.jfac = jfac;
-
-  /* Allocate arrays for combined power spectrum */
+  /* Allocate arrays for combined power spectra */
   const int kcutn = (pow_data->windoworder >= 3) ? 90 : 70;
   const int kcutleft = (int)(Ngrid / 256.0 * kcutn);
   const int kcutright = (int)(Ngrid / 256.0 * (double)kcutn / foldfac);
@@ -1061,168 +1312,92 @@ void power_spectrum(const enum power_type type1, const enum power_type type2,
   int numstart = 0;
 
   double* kcomb = (double*)malloc(numtot * sizeof(double));
-  double* pcomb = (double*)malloc(numtot * sizeof(double));
-
-  /* Determine output file name */
-  char outputfileBase[200] = "";
-  char outputfileName[256] = "";
-
-  sprintf(outputfileBase, "power_%s", get_powtype_filename(type1));
-  if (type1 != type2) {
-    const int length = strlen(outputfileBase);
-    sprintf(outputfileBase + length, "-%s", get_powtype_filename(type2));
-  }
+  double* pcomb = (double*)malloc((size_t)nr_spectra * numtot * sizeof(double));
 
   /* Loop over foldings */
   for (int i = 0; i < Nfold; ++i) {
 
     if (verbose) message("Calculating the power for folding num. %d.", i);
 
-    /* Note:  implicitly assuming a cubic box here */
-    densdata.fac = Ngrid / dim[0];
-    densdata2.fac = Ngrid / dim[0];
-    densdata.dim[0] = dim[0];
-    densdata.dim[1] = dim[1];
-    densdata.dim[2] = dim[2];
-    densdata2.dim[0] = dim[0];
-    densdata2.dim[1] = dim[1];
-    densdata2.dim[2] = dim[2];
-    const double kfac = 2 * M_PI / dim[0];
-
-    /* Empty the grid(s) */
-    bzero(pow_data->powgrid, Ngrid2 * (Ngrid + 2) * sizeof(double));
-    if (type1 != type2)
-      bzero(pow_data->powgrid2, Ngrid2 * (Ngrid + 2) * sizeof(double));
-
-    /* Fill out the folded grid(s) */
-    threadpool_map(tp, cell_to_powgrid_mapper, (void*)local_cells,
-                   nr_local_cells, sizeof(int), threadpool_auto_chunk_size,
-                   (void*)&densdata);
-    if (type1 != type2)
-      threadpool_map(tp, cell_to_powgrid_mapper, (void*)local_cells,
-                     nr_local_cells, sizeof(int), threadpool_auto_chunk_size,
-                     (void*)&densdata2);
-#ifdef WITH_MPI
-    /* Merge everybody's share of the grid onto rank 0 */
-    if (e->nodeID == 0)
-      MPI_Reduce(MPI_IN_PLACE, pow_data->powgrid, Ngrid2 * (Ngrid + 2),
-                 MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-    else
-      MPI_Reduce(pow_data->powgrid, NULL, Ngrid2 * (Ngrid + 2), MPI_DOUBLE,
-                 MPI_SUM, 0, MPI_COMM_WORLD);
-
-    /* Same for the secondary grid */
-    if (type1 != type2) {
-
-      if (e->nodeID == 0)
-        MPI_Reduce(MPI_IN_PLACE, pow_data->powgrid2, Ngrid2 * (Ngrid + 2),
-                   MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-      else
-        MPI_Reduce(pow_data->powgrid2, NULL, Ngrid2 * (Ngrid + 2), MPI_DOUBLE,
-                   MPI_SUM, 0, MPI_COMM_WORLD);
-    }
-#endif
-
-    /* Only rank 0 needs to perform all the remaining work */
-    if (e->nodeID == 0) {
-
-      /* Convert mass to density contrast or pressure to eV/cm^3 */
-      convdata.grid = pow_data->powgrid;
-      convdata.invcellmean = invcellmean;
-      if (Ngrid < 32) {
-        mass_to_contrast_mapper(pow_data->powgrid, Ngrid, &convdata);
-      } else {
-        threadpool_map(tp, mass_to_contrast_mapper, pow_data->powgrid, Ngrid,
-                       sizeof(double), threadpool_auto_chunk_size, &convdata);
-      }
-
-      if (type1 != type2) {
-        convdata.grid = pow_data->powgrid2;
-        convdata.invcellmean = invcellmean2;
-        if (Ngrid < 32) {
-          mass_to_contrast_mapper(pow_data->powgrid2, Ngrid, &convdata);
-        } else {
-          threadpool_map(tp, mass_to_contrast_mapper, pow_data->powgrid2, Ngrid,
-                         sizeof(double), threadpool_auto_chunk_size, &convdata);
+    /* Loop over the blocks of resident components */
+    for (int b_start = 0; b_start < nr_comps; b_start += block_size) {
+
+      const int b_end = min(b_start + block_size, nr_comps);
+      const int b_count = b_end - b_start;
+
+      /* Deposit and transform the whole block at once */
+      power_load_grids(pow_data, s, tp, &nu_model, &comp_types[b_start],
+                       &invcellmean[b_start], b_count, grids, grids_shift, dim,
+                       cos_phase, sin_phase);
+
+      /* Spectra with both components in this block */
+      if (e->nodeID == 0) {
+        for (int j = 0; j < nr_spectra; ++j) {
+          const int c1 = spec_comp1[j];
+          const int c2 = spec_comp2[j];
+          if (c1 < b_start || c1 >= b_end || c2 < b_start || c2 >= b_end)
+            continue;
+          power_from_grids(pow_data, s, tp, pow_data->types1[j],
+                           pow_data->types2[j],
+                           (fftw_complex*)grids[c1 - b_start],
+                           (fftw_complex*)grids[c2 - b_start], i, dim, shot[j],
+                           kbin, modecounts, powersum, &pcomb[j * numtot]);
         }
       }
 
-      /* Perform FFT(s) */
-      fftw_execute_dft_r2c(pow_data->fftplanpow, pow_data->powgrid,
-                           pow_data->powgridft);
-      if (type1 != type2)
-        fftw_execute_dft_r2c(pow_data->fftplanpow2, pow_data->powgrid2,
-                             pow_data->powgridft2);
-
-      powmapdata.powgridft = pow_data->powgridft;
-      powmapdata.powgridft2 = pow_data->powgridft2;
-
-      /* Zero the mode arrays */
-      bzero(modecounts, (Nhalf + 1) * sizeof(int));
-      bzero(powersum, (Nhalf + 1) * sizeof(double));
-
-      /* Calculate compensated mode contributions */
-      if (Ngrid < 32) {
-        pow_from_grid_mapper(pow_data->powgridft, Ngrid, &powmapdata);
-      } else {
-        threadpool_map(tp, pow_from_grid_mapper, pow_data->powgridft, Ngrid,
-                       sizeof(fftw_complex), threadpool_auto_chunk_size,
-                       &powmapdata);
-      }
-
-      /* Write this folding to the detail file */
-      const double volfac = (volume / Ngrid3) / Ngrid3;
-      sprintf(outputfileName, "%s/%s_%04d_%d.txt", "power_spectra/foldings",
-              outputfileBase, snapnum, i);
-      FILE* outputfile = fopen(outputfileName, "w");
-
-      /* Determine units of power */
-      char powunits[32] = "";
-      if (type1 != pow_type_pressure && type2 != pow_type_pressure)
-        sprintf(powunits, "Mpc^3");
-      else if (type1 == pow_type_pressure && type2 == pow_type_pressure)
-        sprintf(powunits, "Mpc^3 (eV cm^(-3))^2");
-      else
-        sprintf(powunits, "Mpc^3 eV cm^(-3)");
-
-      fprintf(outputfile,
-              "# Folding %d, all lengths/volumes are comoving. k-bin centres "
-              "are not corrected for the weights of the modes.\n",
-              i);
-      fprintf(outputfile, "# Shotnoise [%s]\n", powunits);
-      fprintf(outputfile, "%g\n", shot);
-      fprintf(outputfile, "# Redshift [dimensionless]\n");
-      fprintf(outputfile, "%g\n", s->e->cosmology->z);
-      fprintf(outputfile, "# k [Mpc^(-1)]   p [%s]\n", powunits);
-
-      for (int j = 1; j <= Nhalf; ++j) {
-        fprintf(outputfile, "%g %g\n", j * kfac,
-                powersum[j] / modecounts[j] * volfac);
-      }
-      fclose(outputfile);
-
-      /* Combine most accurate measurements from foldings */
-      if (i == 0) {
-
-        for (int j = 0; j < kcutleft; ++j) {
-          kcomb[j] = (j + 1) * kfac;
-          pcomb[j] = powersum[j + 1] / modecounts[j + 1] * volfac;
+      /* Stream the later components paired with this block through the spare
+       * grid. The decision only depends on the request so all ranks agree. */
+      for (int c = b_end; c < nr_comps; ++c) {
+
+        int needed = 0;
+        for (int j = 0; j < nr_spectra; ++j) {
+          const int c1 = spec_comp1[j];
+          const int c2 = spec_comp2[j];
+          if ((c1 == c && c2 >= b_start && c2 < b_end) ||
+              (c2 == c && c1 >= b_start && c1 < b_end))
+            needed = 1;
         }
-
-        numstart += kcutleft;
-
-      } else {
-
-        const int off = kcutright + 1;
-        for (int j = 0; j < (kcutleft - kcutright + 1); ++j) {
-          kcomb[j + numstart] = (j + off) * kfac;
-          pcomb[j + numstart] =
-              powersum[j + off] / modecounts[j + off] * volfac;
+        if (!needed) continue;
+
+        power_load_grids(pow_data, s, tp, &nu_model, &comp_types[c],
+                         &invcellmean[c], 1, &grids[b_count],
+                         grids_shift != NULL ? &grids_shift[b_count] : NULL,
+                         dim, cos_phase, sin_phase);
+
+        if (e->nodeID != 0) continue;
+
+        for (int j = 0; j < nr_spectra; ++j) {
+          const int c1 = spec_comp1[j];
+          const int c2 = spec_comp2[j];
+          int g1, g2;
+          if (c1 == c && c2 >= b_start && c2 < b_end) {
+            g1 = b_count;
+            g2 = c2 - b_start;
+          } else if (c2 == c && c1 >= b_start && c1 < b_end) {
+            g1 = c1 - b_start;
+            g2 = b_count;
+          } else {
+            continue;
+          }
+          power_from_grids(pow_data, s, tp, pow_data->types1[j],
+                           pow_data->types2[j], (fftw_complex*)grids[g1],
+                           (fftw_complex*)grids[g2], i, dim, shot[j], kbin,
+                           modecounts, powersum, &pcomb[j * numtot]);
         }
-        numstart += (kcutleft - kcutright + 1);
-      }
+      } /* Loop over streamed components */
+    } /* Loop over blocks */
 
-    } /* Work of rank 0 */
+    /* Record the k values of the bins kept from this folding */
+    const double kfac = 2 * M_PI / dim[0];
+    if (i == 0) {
+      for (int j = 0; j < kcutleft; ++j) kcomb[j] = (j + 1) * kfac;
+      numstart += kcutleft;
+    } else {
+      const int off = kcutright + 1;
+      for (int j = 0; j < (kcutleft - kcutright + 1); ++j)
+        kcomb[j + numstart] = (j + off) * kfac;
+      numstart += (kcutleft - kcutright + 1);
+    }
 
     /* Fold the box */
     for (int j = 0; j < 3; ++j) dim[j] /= foldfac;
@@ -1231,29 +1406,41 @@ void power_spectrum(const enum power_type type1, const enum power_type type2,
 
   if (e->nodeID == 0) {
 
-    /* Output attempt at combined measurement */
-    sprintf(outputfileName, "%s/%s_%04d.txt", "power_spectra", outputfileBase,
-            snapnum);
+    for (int i = 0; i < nr_spectra; ++i) {
 
-    FILE* outputfile = fopen(outputfileName, "w");
+      const enum power_type type1 = pow_data->types1[i];
+      const enum power_type type2 = pow_data->types2[i];
 
-    /* Header and units */
-    power_init_output_file(outputfile, type1, type2, us, phys_const);
+      /* Output attempt at combined measurement */
+      char outputfileBase[200] = "";
+      char outputfileName[256] = "";
+      power_output_base_name(type1, type2, outputfileBase);
+      sprintf(outputfileName, "%s/%s_%04d.txt", "power_spectra",
+              outputfileBase, snapnum);
 
-    for (int j = 0; j < numtot; ++j) {
+      FILE* outputfile = fopen(outputfileName, "w");
 
-      float k = kcomb[j];
+      /* Header and units */
+      power_init_output_file(outputfile, type1, type2, us, phys_const);
 
-      /* Shall we correct the position of the k-space bin
-       * to account for the different weights of the modes entering the bin? */
-      if (pow_data->shift_centre_small_k_bins && j < number_of_corrected_bins) {
-        k *= correction_shift_k_values[j];
-      }
+      for (int j = 0; j < numtot; ++j) {
+
+        float k = kcomb[j];
+
+        /* Shall we correct the position of the k-space bin
+         * to account for the different weights of the modes entering the
+         * bin? */
+        if (pow_data->shift_centre_small_k_bins &&
+            j < number_of_corrected_bins) {
+          k *= correction_shift_k_values[j];
+        }
 
-      fprintf(outputfile, "%15.8f %15.8e %15.8e %15.8e\n", s->e->cosmology->z,
-              k, (pcomb[j] - shot), shot);
+        fprintf(outputfile, "%15.8f %15.8e %15.8e %15.8e\n",
+                s->e->cosmology->z, k, (pcomb[i * numtot + j] - shot[i]),
+                shot[i]);
+      }
+      fclose(outputfile);
     }
-    fclose(outputfile);
   }
 
   /* Done. Just clean up memory */
@@ -1264,16 +1451,23 @@ void power_spectrum(const enum power_type type1, const enum power_type type2,
   free(powersum);
   free(modecounts);
   free(kbin);
-  if (type1 != type2) {
-    memuse_log_allocation("fftw_grid.grid2", pow_data->powgrid2, 0, 0);
-    fftw_free(pow_data->powgrid2);
+  free(shot);
+  if (grids_shift != NULL) {
+    for (int g = 0; g < nr_slots; ++g) {
+      memuse_log_allocation("fftw_grid.grid_shift", grids_shift[g], 0, 0);
+      fftw_free(grids_shift[g]);
+    }
+    free(grids_shift);
+  }
+  free(sin_phase);
+  free(cos_phase);
+  for (int g = 0; g < nr_slots; ++g) {
+    memuse_log_allocation("fftw_grid.grid", grids[g], 0, 0);
+    fftw_free(grids[g]);
   }
-  pow_data->powgrid2 = NULL;
-  pow_data->powgridft2 = NULL;
-  memuse_log_allocation("fftw_grid.grid", pow_data->powgrid, 0, 0);
-  fftw_free(pow_data->powgrid);
-  pow_data->powgrid = NULL;
-  pow_data->powgridft = NULL;
+  free(grids);
+  free(spec_comp2);
+  free(spec_comp1);
 }
 
 #endif /* HAVE_FFTW */
@@ -1301,7 +1495,7 @@ void power_init(struct power_spectrum_data* p, struct swift_params* params,
   p->windoworder = parser_get_opt_param_int(
       params, "PowerSpectrum:window_order", power_data_default_window_order);
 
-  if (p->windoworder > 3 || p->windoworder < 1)
+  if (p->windoworder > mesh_assignment_max_width || p->windoworder < 1)
     error("Power spectrum calculation is not implemented for %dth order!",
           p->windoworder);
   if (p->windoworder == 1)
@@ -1310,14 +1504,22 @@ void power_init(struct power_spectrum_data* p, struct swift_params* params,
     message(
         "WARNING: fold factor is recommended not to exceed 4 for a "
         "mass assignment order of 2 (CIC) or below.");
-  if (p->windoworder == 3 && p->foldfac > 6)
+  if (p->windoworder >= 3 && p->foldfac > 6)
     message(
         "WARNING: fold factor is recommended not to exceed 6 for a "
-        "mass assignment order of 3 (TSC) or below.");
+        "mass assignment order of 3 (TSC) or above.");
+
+  p->interlacing =
+      parser_get_opt_param_int(params, "PowerSpectrum:interlacing", 0);
 
   p->shift_centre_small_k_bins = parser_get_opt_param_int(
       params, "PowerSpectrum:shift_centre_small_k_bins", 1);
 
+  p->grid_memory_budget_MB = parser_get_opt_param_int(
+      params, "PowerSpectrum:grid_memory_budget_MB", 0);
+  if (p->grid_memory_budget_MB < 0)
+    error("The power spectrum grid memory budget must be positive or zero!");
+
   /* Make sensible choices for the k-cuts */
   const int kcutn = (p->windoworder >= 3) ? 90 : 70;
   const int kcutleft = (int)(p->Ngrid / 256.0 * kcutn);
@@ -1370,7 +1572,8 @@ void power_init(struct power_spectrum_data* p, struct swift_params* params,
 
   /* Initialize the plan only once -- much faster for FFTs run often!
    * Does require us to allocate the grids, but we delete them right away.
-   * Plan can only be used for the same FFTW call */
+   * Plan can only be used for the same FFTW call, but is shared by all the
+   * (identically padded and aligned) grids of the calculation. */
   const int Ngrid = p->Ngrid;
 
   /* Grid is padded to allow for in-place FFT */
@@ -1385,20 +1588,6 @@ void power_init(struct power_spectrum_data* p, struct swift_params* params,
   p->powgrid = NULL;
   p->powgridft = NULL;
 
-  /* Do the same for a second grid/plan to allow for cross power */
-
-  /* Grid is padded to allow for in-place FFT */
-  p->powgrid2 = fftw_alloc_real(Ngrid * Ngrid * (Ngrid + 2));
-  /* Pointer to grid to interpret it as complex data */
-  p->powgridft2 = (fftw_complex*)p->powgrid2;
-
-  p->fftplanpow2 = fftw_plan_dft_r2c_3d(Ngrid, Ngrid, Ngrid, p->powgrid2,
-                                        p->powgridft2, FFTW_MEASURE);
-
-  fftw_free(p->powgrid2);
-  p->powgrid2 = NULL;
-  p->powgridft2 = NULL;
-
   /* Create directories for power spectra and foldings */
   if (engine_rank == 0) {
     safe_checkdir("power_spectra", /*create=*/1);
@@ -1417,10 +1606,8 @@ void calc_all_power_spectra(struct power_spectrum_data* pow_data,
 
   const ticks tic = getticks();
 
-  /* Loop over all type combinations the user requested */
-  for (int i = 0; i < pow_data->spectrumcount; ++i)
-    power_spectrum(pow_data->types1[i], pow_data->types2[i], pow_data, s, tp,
-                   verbose);
+  /* Compute all type combinations the user requested in one go */
+  power_spectra_all(pow_data, s, tp, verbose);
 
   /* Increment the PS output counter */
   s->e->ps_output_count++;
@@ -1439,7 +1626,6 @@ void calc_all_power_spectra(struct power_spectrum_data* pow_data,
 void power_clean(struct power_spectrum_data* pow_data) {
 #ifdef HAVE_FFTW
   fftw_destroy_plan(pow_data->fftplanpow);
-  fftw_destroy_plan(pow_data->fftplanpow2);
   free(pow_data->types2);
   free(pow_data->types1);
 #ifdef HAVE_THREADED_FFTW
@@ -1518,18 +1704,5 @@ void power_spectrum_struct_restore(struct power_spectrum_data* p,
   p->powgrid = NULL;
   p->powgridft = NULL;
 
-  /* Do the same for a second grid/plan to allow for cross power */
-
-  /* Grid is padded to allow for in-place FFT */
-  p->powgrid2 = fftw_alloc_real(Ngrid * Ngrid * (Ngrid + 2));
-  /* Pointer to grid to interpret it as complex data */
-  p->powgridft2 = (fftw_complex*)p->powgrid2;
-
-  p->fftplanpow2 = fftw_plan_dft_r2c_3d(Ngrid, Ngrid, Ngrid, p->powgrid2,
-                                        p->powgridft2, FFTW_MEASURE);
-
-  fftw_free(p->powgrid2);
-  p->powgrid2 = NULL;
-  p->powgridft2 = NULL;
 #endif /* HAVE_FFTW */
 }
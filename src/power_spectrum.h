@@ -71,33 +71,30 @@ struct power_spectrum_data {
   /*! The order of the mass assignment window */
   int windoworder;
 
+  /*! Are we averaging with a half-cell interlaced grid? */
+  int interlacing;
+
   /* Shall we correct the position of the k-space bin? */
   int shift_centre_small_k_bins;
 
+  /*! Memory (in MB) available for the resident grids (0 for no limit) */
+  int grid_memory_budget_MB;
+
   /*! Array of component types to correlate on the "left" side */
   enum power_type* types1;
 
   /*! Array of component types to correlate on the "right" side */
   enum power_type* types2;
 
-  /*! Pointer to the grid to be reused */
+  /*! Pointer to the grid used to create the FFT plan */
   double* powgrid;
 
-  /*! Pointer to a second grid for cross-power spectra */
-  double* powgrid2;
-
 #ifdef HAVE_FFTW
   /*! Pointer to the grid in Fourier space */
   fftw_complex* powgridft;
 
-  /*! Pointer to the second grid in Fourier space */
-  fftw_complex* powgridft2;
-
-  /*! The FFT plan to be reused */
+  /*! The FFT plan to be reused for all the grids */
   fftw_plan fftplanpow;
-
-  /*! The FFT plan to be reused for the second grid */
-  fftw_plan fftplanpow2;
 #endif
 };
 
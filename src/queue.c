@@ -21,6 +21,7 @@
 #include <config.h>
 
 /* Some standard headers. */
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,6 +39,13 @@
 #include "error.h"
 #include "memswap.h"
 
+/* Names of the queue engines. */
+const char *queue_engine_names[queue_engine_count] = {"heap", "deque"};
+
+/* Names of the steal levels. */
+const char *queue_steal_level_names[queue_steal_level_count] = {
+    "L3 domain", "NUMA node", "remote"};
+
 /**
  * @brief Push the task at the given index up the heap until it is either at the
  * top or smaller than its parent.
@@ -102,6 +110,146 @@ int queue_sift_down(struct queue *q, int ind) {
   return ind;
 }
 
+/**
+ * @brief Get the weight band of a task in the deque engine.
+ *
+ * Tasks are binned logarithmically in weight so that heavy tasks (i.e. the
+ * ones on the critical path) are handed out before light ones, even if the
+ * order within a band is LIFO for the owner and FIFO for the thieves.
+ *
+ * @param weight The weight of the #task.
+ */
+static int queue_deque_band(const float weight) {
+
+  if (!(weight > 1.f)) return 0;
+
+  int exponent;
+  frexpf(weight, &exponent);
+  const int band = exponent / queue_deque_band_width;
+  return band < queue_deque_nr_bands ? band : queue_deque_nr_bands - 1;
+}
+
+/**
+ * @brief Allocate a new circular array for a #queue_deque.
+ *
+ * @param size The number of elements, must be a power of two.
+ */
+static struct queue_deque_buffer *queue_deque_buffer_new(const long long size) {
+
+  struct queue_deque_buffer *buff =
+      (struct queue_deque_buffer *)malloc(sizeof(struct queue_deque_buffer));
+  if (buff == NULL) error("Failed to allocate deque buffer.");
+  if ((buff->tids = (int *)malloc(sizeof(int) * size)) == NULL)
+    error("Failed to allocate deque buffer elements.");
+  buff->size = size;
+  buff->retired = NULL;
+  return buff;
+}
+
+/**
+ * @brief Push a task offset at the bottom of a #queue_deque.
+ *
+ * @param d The #queue_deque, its #queue is assumed to be locked.
+ * @param tid The offset of the task.
+ */
+static void queue_deque_push(struct queue_deque *d, const int tid) {
+
+  const long long b = d->bottom;
+  const long long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  struct queue_deque_buffer *buff = d->buffer;
+
+  /* Does the array need to be grown? The old one is kept around since a thief
+   * may still be reading from it. */
+  if (b - t >= buff->size) {
+    struct queue_deque_buffer *temp =
+        queue_deque_buffer_new(buff->size * queue_sizegrow);
+    for (long long k = t; k < b; k++)
+      temp->tids[k & (temp->size - 1)] = buff->tids[k & (buff->size - 1)];
+    temp->retired = buff;
+    __atomic_store_n(&d->buffer, temp, __ATOMIC_RELEASE);
+    buff = temp;
+  }
+
+  buff->tids[b & (buff->size - 1)] = tid;
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Take the most recently pushed task offset from a #queue_deque.
+ *
+ * @param d The #queue_deque, its #queue is assumed to be locked.
+ *
+ * @return The offset of the task or -1 if the deque is empty.
+ */
+static int queue_deque_take(struct queue_deque *d) {
+
+  const long long b = d->bottom - 1;
+  struct queue_deque_buffer *buff = d->buffer;
+  __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  long long t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+  /* Empty deque? */
+  if (t > b) {
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return -1;
+  }
+
+  int tid = buff->tids[b & (buff->size - 1)];
+
+  /* Last element, race against the thieves for it. */
+  if (t == b) {
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, /*weak=*/0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      tid = -1;
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  }
+
+  return tid;
+}
+
+/**
+ * @brief Steal the oldest task offset from a #queue_deque.
+ *
+ * @param d The #queue_deque.
+ * @param conflict (return) Set to 1 if we lost a race with another thread.
+ *
+ * @return The offset of the task or -1 if nothing could be stolen.
+ */
+static int queue_deque_steal(struct queue_deque *d, int *conflict) {
+
+  long long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  const long long b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+
+  if (t >= b) return -1;
+
+  struct queue_deque_buffer *buff =
+      __atomic_load_n(&d->buffer, __ATOMIC_ACQUIRE);
+  const int tid = buff->tids[t & (buff->size - 1)];
+  if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, /*weak=*/0,
+                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    *conflict = 1;
+    return -1;
+  }
+
+  return tid;
+}
+
+/**
+ * @brief Push a task offset onto the deque matching the given weight.
+ *
+ * @param q The #queue, assumed to be locked.
+ * @param tid The offset of the task.
+ * @param weight The weight used to select the band.
+ */
+static void queue_deque_insert(struct queue *q, const int tid,
+                               const float weight) {
+
+  queue_deque_push(&q->deques[queue_deque_band(weight)], tid);
+  atomic_inc(&q->count);
+}
+
 /**
  * @brief Enqueue all tasks in the incoming DEQ.
  *
@@ -122,6 +270,13 @@ void queue_get_incoming(struct queue *q) {
     const int offset = atomic_swap(&q->tid_incoming[ind], -1);
     atomic_inc(&q->first_incoming);
 
+    /* Deques just need the task pushed on the right band. */
+    if (q->engine == queue_engine_deque) {
+      queue_deque_insert(q, offset, q->tasks[offset].weight);
+      atomic_dec(&q->count_incoming);
+      continue;
+    }
+
     /* Does the queue need to be grown? */
     if (q->count == q->size) {
       struct queue_entry *temp;
@@ -188,8 +343,9 @@ void queue_insert(struct queue *q, struct task *t) {
  *
  * @param q The #queue.
  * @param tasks List of tasks to which the queue indices refer to.
+ * @param engine The #queue_engine used to store the tasks.
  */
-void queue_init(struct queue *q, struct task *tasks) {
+void queue_init(struct queue *q, struct task *tasks, enum queue_engine engine) {
 
   /* Allocate the task list if needed. */
   q->size = queue_sizeinit;
@@ -216,6 +372,107 @@ void queue_init(struct queue *q, struct task *tasks) {
   q->first_incoming = 0;
   q->last_incoming = 0;
   q->count_incoming = 0;
+
+  /* Init the work-stealing deques. */
+  q->engine = engine;
+  q->deques = NULL;
+  if (engine == queue_engine_deque) {
+    if ((q->deques = (struct queue_deque *)malloc(
+             sizeof(struct queue_deque) * queue_deque_nr_bands)) == NULL)
+      error("Failed to allocate queue deques.");
+    for (int k = 0; k < queue_deque_nr_bands; k++) {
+      q->deques[k].top = 0;
+      q->deques[k].bottom = 0;
+      q->deques[k].buffer = queue_deque_buffer_new(queue_deque_sizeinit);
+    }
+  }
+
+  queue_stats_reset(q);
+}
+
+/**
+ * @brief Get a task free of conflicts from the deques of a #queue.
+ *
+ * The heaviest non-empty band is searched first. Tasks that cannot be locked
+ * are put back one band lower, mirroring the de-prioritisation done by the
+ * heap engine.
+ *
+ * @param q The task #queue, assumed to be locked.
+ */
+static struct task *queue_gettask_deque(struct queue *q) {
+
+  struct task *qtasks = q->tasks;
+  struct task *res = NULL;
+  int failed_tid[queue_search_window], failed_band[queue_search_window];
+  int nr_failed = 0;
+
+  for (int band = queue_deque_nr_bands - 1;
+       band >= 0 && res == NULL && nr_failed < queue_search_window; band--) {
+    while (nr_failed < queue_search_window) {
+      const int tid = queue_deque_take(&q->deques[band]);
+      if (tid < 0) break;
+      atomic_dec(&q->count);
+
+      /* Try to lock the task. */
+      if (task_lock(&qtasks[tid])) {
+        res = &qtasks[tid];
+        break;
+      }
+      failed_tid[nr_failed] = tid;
+      failed_band[nr_failed] = band > 0 ? band - 1 : 0;
+      nr_failed++;
+    }
+  }
+
+  /* Put back whatever we could not lock. */
+  for (int k = nr_failed - 1; k >= 0; k--) {
+    queue_deque_push(&q->deques[failed_band[k]], failed_tid[k]);
+    atomic_inc(&q->count);
+  }
+  if (nr_failed > 0) atomic_add(&q->stats.requeues, nr_failed);
+  if (res != NULL) q->stats.pops++;
+
+  return res;
+}
+
+/**
+ * @brief Steal a task free of conflicts from the deques of a #queue.
+ *
+ * This does not take the queue's lock. Tasks that were stolen but could not
+ * be locked are sent back to the incoming buffer of their queue. If the
+ * queue only has incoming tasks, we try to move them to the deques first.
+ *
+ * @param q The task #queue to steal from.
+ * @param stats The #queue_stats of the thief.
+ *
+ * @return The stolen #task or @c NULL.
+ */
+struct task *queue_steal(struct queue *q, struct queue_stats *stats) {
+
+  /* Help out a busy owner with its incoming tasks. */
+  if (q->count == 0 && q->count_incoming > 0) {
+    if (lock_trylock(&q->lock) != 0) return NULL;
+    queue_get_incoming(q);
+    lock_unlock_blind(&q->lock);
+  }
+
+  for (int band = queue_deque_nr_bands - 1; band >= 0; band--) {
+    int conflict = 0;
+    const int tid = queue_deque_steal(&q->deques[band], &conflict);
+    if (conflict) atomic_inc(&stats->steal_conflicts);
+    if (tid < 0) continue;
+    atomic_dec(&q->count);
+
+    struct task *t = &q->tasks[tid];
+    if (task_lock(t)) return t;
+
+    /* Give it back to the owner. */
+    atomic_inc(&stats->requeues);
+    queue_insert(q, t);
+    return NULL;
+  }
+
+  return NULL;
 }
 
 /**
@@ -241,6 +498,13 @@ struct task *queue_gettask(struct queue *q, const struct task *prev,
   /* Fill any tasks from the incoming DEQ. */
   queue_get_incoming(q);
 
+  /* Deques are searched by band. */
+  if (q->engine == queue_engine_deque) {
+    res = queue_gettask_deque(q);
+    if (lock_unlock(qlock) != 0) error("Unlocking the qlock failed.\n");
+    return res;
+  }
+
   /* If there are no tasks, leave immediately. */
   if (q->count == 0) {
     lock_unlock_blind(qlock);
@@ -291,6 +555,8 @@ struct task *queue_gettask(struct queue *q, const struct task *prev,
       ind = queue_sift_down(q, ind);
     }
 
+    q->stats.pops++;
+
   } else
     res = NULL;
 
@@ -312,6 +578,28 @@ void queue_clean(struct queue *q) {
 
   free(q->entries);
   free(q->tid_incoming);
+
+  if (q->deques != NULL) {
+    for (int k = 0; k < queue_deque_nr_bands; k++) {
+      struct queue_deque_buffer *buff = q->deques[k].buffer;
+      while (buff != NULL) {
+        struct queue_deque_buffer *next = buff->retired;
+        free(buff->tids);
+        free(buff);
+        buff = next;
+      }
+    }
+    free(q->deques);
+  }
+}
+
+/**
+ * @brief Zero the traffic counters of a #queue.
+ *
+ * @param q The task #queue.
+ */
+void queue_stats_reset(struct queue *q) {
+  bzero(&q->stats, sizeof(struct queue_stats));
 }
 
 /**
@@ -333,11 +621,24 @@ void queue_dump(int nodeID, int index, FILE *file, struct queue *q) {
   queue_get_incoming(q);
 
   /* Loop over the queue entries. */
-  for (int k = 0; k < q->count; k++) {
-    struct task *t = &q->tasks[q->entries[k].tid];
+  if (q->engine == queue_engine_deque) {
+    int k = 0;
+    for (int band = queue_deque_nr_bands - 1; band >= 0; band--) {
+      const struct queue_deque *d = &q->deques[band];
+      const struct queue_deque_buffer *buff = d->buffer;
+      for (long long i = d->bottom - 1; i >= d->top; i--, k++) {
+        struct task *t = &q->tasks[buff->tids[i & (buff->size - 1)]];
+        fprintf(file, "%d %d %d %s %s %.2f\n", nodeID, index, k,
+                taskID_names[t->type], subtaskID_names[t->subtype], t->weight);
+      }
+    }
+  } else {
+    for (int k = 0; k < q->count; k++) {
+      struct task *t = &q->tasks[q->entries[k].tid];
 
-    fprintf(file, "%d %d %d %s %s %.2f\n", nodeID, index, k,
-            taskID_names[t->type], subtaskID_names[t->subtype], t->weight);
+      fprintf(file, "%d %d %d %s %s %.2f\n", nodeID, index, k,
+              taskID_names[t->type], subtaskID_names[t->subtype], t->weight);
+    }
   }
 
   /* Release the task lock. */
@@ -32,6 +32,11 @@
 #define queue_incoming_size 10240
 #define queue_struct_align 64
 
+/* Constants dealing with the work-stealing deques. */
+#define queue_deque_nr_bands 16
+#define queue_deque_band_width 2
+#define queue_deque_sizeinit 256
+
 /* Constants dealing with task de-priorization. */
 #define queue_lock_fail_reweight_factor 0.5
 /* #define queue_lock_fail_reweight_mask \
@@ -45,6 +50,27 @@ enum {
 };
 extern int queue_counter[queue_counter_count];
 
+/**
+ * @brief The engines that can be used to store the tasks of a queue.
+ */
+enum queue_engine {
+  queue_engine_heap = 0, /* Locked binary heap sorted by weight. */
+  queue_engine_deque,    /* Weight-banded Chase-Lev work-stealing deques. */
+  queue_engine_count,
+};
+extern const char *queue_engine_names[queue_engine_count];
+
+/**
+ * @brief How close, in the machine topology, the victim of a steal is.
+ */
+enum queue_steal_level {
+  queue_steal_level_l3 = 0, /* Shares the thief's L3 cache. */
+  queue_steal_level_numa,   /* Shares the thief's NUMA node. */
+  queue_steal_level_remote, /* Anywhere else. */
+  queue_steal_level_count,
+};
+extern const char *queue_steal_level_names[queue_steal_level_count];
+
 /** Struct containing a task offset and a weight, used to build the binary heap
  * of tasks in the queue. */
 struct queue_entry {
@@ -56,6 +82,61 @@ struct queue_entry {
   float weight;
 };
 
+/** Circular array of task offsets used by a #queue_deque. */
+struct queue_deque_buffer {
+
+  /* Size of the array, always a power of two. */
+  long long size;
+
+  /* The task offsets. */
+  int *tids;
+
+  /* Older (smaller) arrays that may still be read by thieves. */
+  struct queue_deque_buffer *retired;
+};
+
+/**
+ * @brief A Chase-Lev work-stealing deque.
+ *
+ * Tasks are pushed and taken at the bottom by whoever holds the lock of the
+ * #queue it belongs to, and stolen lock-free from the top by anyone else.
+ */
+struct queue_deque {
+
+  /* Index of the oldest element, advanced by thieves. */
+  volatile long long top;
+
+  /* Index past the newest element, only modified by the owner. */
+  volatile long long bottom;
+
+  /* The current array of elements. */
+  struct queue_deque_buffer *volatile buffer;
+};
+
+/** Counters describing the traffic through a #queue. */
+struct queue_stats {
+
+  /* Number of tasks obtained from this queue by its owner. */
+  long long pops;
+
+  /* Number of tasks that could not be locked and were put back. */
+  long long requeues;
+
+  /* Number of steal attempts made by the owner(s) of this queue. */
+  long long steal_attempts;
+
+  /* Number of successful steals made by the owner(s) of this queue, per
+   * #queue_steal_level of the victim. */
+  long long steals[queue_steal_level_count];
+
+  /* Number of steals that lost a race against another thread. */
+  long long steal_conflicts;
+
+  /* Number of hydro loop tasks run by the runner that last touched their
+   * cells' particles, and total number of such tasks. */
+  long long locality_hits, locality_tasks;
+};
+
 /** The queue struct. */
 struct queue {
 
@@ -75,14 +156,25 @@ struct queue {
   int *tid_incoming;
   volatile unsigned int first_incoming, last_incoming, count_incoming;
 
+  /* Which engine stores the tasks? */
+  enum queue_engine engine;
+
+  /* Work-stealing deques, one per weight band (deque engine only). */
+  struct queue_deque *deques;
+
+  /* Traffic counters. */
+  struct queue_stats stats;
+
 } __attribute__((aligned(queue_struct_align)));
 
 /* Function prototypes. */
 struct task *queue_gettask(struct queue *q, const struct task *prev,
                            int blocking);
-void queue_init(struct queue *q, struct task *tasks);
+struct task *queue_steal(struct queue *q, struct queue_stats *stats);
+void queue_init(struct queue *q, struct task *tasks, enum queue_engine engine);
 void queue_insert(struct queue *q, struct task *t);
 void queue_clean(struct queue *q);
+void queue_stats_reset(struct queue *q);
 
 void queue_dump(int nodeID, int index, FILE *file, struct queue *q);
 
@@ -26,6 +26,7 @@
 #include <config.h>
 
 /* Standard headers. */
+#include "atomic.h"
 #include "engine.h"
 #include "error.h"
 #include "restart.h"
@@ -33,12 +34,18 @@
 
 #include <errno.h>
 #include <glob.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 /* The signature for restart files. */
 #define SWIFT_RESTART_SIGNATURE "SWIFT-restart-file"
 #define SWIFT_RESTART_END_SIGNATURE "SWIFT-restart-file:end"
@@ -46,12 +53,132 @@
 #define FNAMELEN 200
 #define LABLEN 20
 
+/* Label of the block describing how the rest of a file is encoded. */
+#define SWIFT_RESTART_ENCODING_LABEL "encoding"
+
+/* Label of the block holding the index of an encoded file. */
+#define SWIFT_RESTART_INDEX_LABEL "index"
+
+/* Size of the chunks blocks are compressed, hashed and read in parallel in. */
+#define RESTART_CHUNK_SIZE (16 * 1024 * 1024)
+
 /* Structure for a dumped header. */
 struct header {
   size_t len;             /* Total length of data in bytes. */
   char label[LABLEN + 1]; /* A label for data */
 };
 
+/* The ways the data of a block can be stored in an encoded restart file. */
+enum restart_block_type {
+  restart_block_raw = 0,  /* The data as is. */
+  restart_block_zlib = 1, /* A series of zlib compressed chunks. */
+  restart_block_base = 2, /* Unchanged, the data is in the base file. */
+};
+
+/* Structure describing how the blocks of a restart file are encoded.
+ * Written as a block labelled SWIFT_RESTART_ENCODING_LABEL right after the
+ * version. Files without it are read as plain headers followed by data. */
+struct restart_encoding {
+  int compression;     /* zlib compression level, 0 for none. */
+  int delta;           /* Can blocks refer to the base file? */
+  char base[FNAMELEN]; /* Name of the base file. */
+  size_t index_offset; /* Offset of the index, 0 until the file is complete. */
+  size_t nr_blocks;    /* Number of entries in the index. */
+};
+
+/* Structure following the header of each block of an encoded file. */
+struct block_desc {
+  int type;           /* The #restart_block_type of the data. */
+  size_t stored_len;  /* Number of bytes stored after this descriptor. */
+  size_t base_offset; /* Offset of the descriptor in the base file. */
+  uint64_t hash;      /* Checksum of the uncompressed data. */
+};
+
+/* Entry of the index written at the end of an encoded file. Also what we
+ * remember about the blocks of a base file. */
+struct index_entry {
+  char label[LABLEN + 1]; /* The label of the block. */
+  int type;               /* The #restart_block_type of the data. */
+  size_t len;             /* Uncompressed length. */
+  uint64_t hash;          /* Checksum of the uncompressed data. */
+  size_t offset;          /* Offset of the block descriptor in the file. */
+};
+
+/* A block copied out of the engine, waiting to be written. */
+struct staged_block {
+  struct staged_block *next;
+  struct header head;
+  char data[];
+};
+
+/* State of the restart file being written. Only one restart file is written
+ * at a time by each rank, so a single instance suffices. */
+static struct restart_writer {
+
+  /* The stream we encode, NULL when writing plain files. */
+  FILE *stream;
+
+  /* Name of the file we are writing. */
+  char filename[FNAMELEN];
+
+  /* The encoding written at the top of the file and where it is. */
+  struct restart_encoding enc;
+  off_t enc_offset;
+
+  /* Is this dump a full one that will become the next base file? */
+  int full;
+
+  /* Number of dumps since the last full one. */
+  int dumps_since_base;
+
+  /* Name of the current and previous base files. */
+  char base_current[FNAMELEN];
+  char base_previous[FNAMELEN];
+
+  /* Blocks of the current base file. */
+  struct index_entry *base_blocks;
+  int nr_base_blocks, size_base_blocks;
+
+  /* Blocks of the file being written, i.e. its index. */
+  struct index_entry *blocks;
+  int nr_blocks, size_blocks;
+
+  /* Background writing, if requested. */
+  int async;
+  int active;
+  int done;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct staged_block *first, *last;
+  size_t staged_size;
+  size_t max_staged_size;
+
+  /* For reporting. */
+  int verbose;
+  ticks tic;
+} restart_writer = {NULL};
+
+/* State of the encoded restart file being read, if any. */
+static struct restart_reader {
+
+  /* The encoded stream, NULL when reading a plain file. */
+  FILE *stream;
+
+  /* The encoding read from the top of the file. */
+  struct restart_encoding enc;
+
+  /* The index of the file and the next block we expect to read. */
+  struct index_entry *index;
+  size_t next_block;
+
+  /* The base file, opened on first use. */
+  FILE *base;
+
+  /* Number of threads reading large blocks. */
+  int nr_threads;
+} restart_reader = {NULL};
+
 /**
  * @brief generate a name for a restart file.
  *
@@ -121,18 +248,757 @@ void restart_locate_free(int nfiles, char **files) {
 }
 
 /**
- * @brief Write a restart file for the state of the given engine struct.
+ * @brief A fast 64-bit hash of a memory region.
+ *
+ * @param data the memory to hash.
+ * @param len the number of bytes to hash.
+ */
+static uint64_t restart_hash_chunk(const void *data, size_t len) {
+
+  const char *bytes = (const char *)data;
+  const uint64_t mult = 0x9e3779b97f4a7c15ULL;
+  uint64_t h = 0xcbf29ce484222325ULL ^ (len * mult);
+
+  /* Mix in one word at a time... */
+  const size_t nwords = len / sizeof(uint64_t);
+  for (size_t i = 0; i < nwords; i++) {
+    uint64_t k;
+    memcpy(&k, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+    h ^= k * mult;
+    h = ((h << 31) | (h >> 33)) * 0xff51afd7ed558ccdULL;
+  }
+
+  /* ...then whatever is left. */
+  for (size_t i = nwords * sizeof(uint64_t); i < len; i++)
+    h = (h ^ (unsigned char)bytes[i]) * 0x100000001b3ULL;
+
+  h ^= h >> 33;
+  return h;
+}
+
+/**
+ * @brief Add the hash of the next chunk of a block to its checksum.
+ *
+ * @param h the checksum so far.
+ * @param chunk_hash the hash of the chunk.
+ */
+static uint64_t restart_hash_combine(uint64_t h, uint64_t chunk_hash) {
+  h = (h ^ chunk_hash) * 0x9e3779b97f4a7c15ULL;
+  return h ^ (h >> 29);
+}
+
+/**
+ * @brief The checksum of a block, used to detect corrupted files and to spot
+ *        the blocks that did not change since the base file was written.
+ *
+ * The #RESTART_CHUNK_SIZE chunks are hashed independently so that they can
+ * be verified in parallel when reading.
+ *
+ * @param data the memory to hash.
+ * @param len the number of bytes to hash.
+ */
+static uint64_t restart_hash(const void *data, size_t len) {
+  uint64_t h = len;
+  for (size_t offset = 0; offset < len; offset += RESTART_CHUNK_SIZE) {
+    const size_t chunk = min(len - offset, (size_t)RESTART_CHUNK_SIZE);
+    h = restart_hash_combine(
+        h, restart_hash_chunk((const char *)data + offset, chunk));
+  }
+  return h;
+}
+
+/**
+ * @brief Write the data of one block to an encoded restart file, either as is,
+ *        compressed, or as a reference to the same block of the base file.
+ *
+ * @param w the #restart_writer.
+ * @param head the header of the block.
+ * @param data the data of the block.
+ */
+static void restart_writer_encode(struct restart_writer *w,
+                                  const struct header *head, const void *data) {
+
+  FILE *stream = w->stream;
+  const size_t len = head->len;
+
+  struct block_desc desc;
+  bzero(&desc, sizeof(struct block_desc));
+  desc.type = restart_block_raw;
+  desc.stored_len = len;
+  desc.hash = restart_hash(data, len);
+
+  /* Can we refer to the base file instead? */
+  const int index = w->nr_blocks;
+  if (w->enc.delta && !w->full && index < w->nr_base_blocks &&
+      w->base_blocks[index].len == len &&
+      w->base_blocks[index].hash == desc.hash) {
+    desc.type = restart_block_base;
+    desc.stored_len = 0;
+    desc.base_offset = w->base_blocks[index].offset;
+  } else if (w->enc.compression > 0) {
+    desc.type = restart_block_zlib;
+  }
+
+  if (fwrite(head, sizeof(struct header), 1, stream) != 1)
+    error("Failed to save %s header to restart file (%s)", head->label,
+          strerror(errno));
+  const off_t desc_offset = ftello(stream);
+
+  /* Add the block to the index, full dumps become the new base. */
+  if (w->nr_blocks == w->size_blocks) {
+    w->size_blocks = w->size_blocks ? 2 * w->size_blocks : 256;
+    w->blocks = (struct index_entry *)realloc(
+        w->blocks, w->size_blocks * sizeof(struct index_entry));
+    if (w->blocks == NULL) error("Failed to allocate restart block index");
+  }
+  bzero(&w->blocks[index], sizeof(struct index_entry));
+  memcpy(w->blocks[index].label, head->label, LABLEN); /* NUL from bzero */
+  w->blocks[index].type = desc.type;
+  w->blocks[index].len = len;
+  w->blocks[index].hash = desc.hash;
+  w->blocks[index].offset = desc_offset;
+  w->nr_blocks++;
+
+  if (fwrite(&desc, sizeof(struct block_desc), 1, stream) != 1)
+    error("Failed to save %s descriptor to restart file (%s)", head->label,
+          strerror(errno));
+
+  if (desc.type == restart_block_raw) {
+    if (fwrite(data, 1, len, stream) != len)
+      error("Failed to save %s to restart file (%s)", head->label,
+            strerror(errno));
+
+  } else if (desc.type == restart_block_zlib) {
+#ifdef HAVE_ZLIB
+    /* Compress one chunk at a time, each preceded by its compressed size. */
+    uLongf buff_size = compressBound(RESTART_CHUNK_SIZE);
+    Bytef *buff = (Bytef *)malloc(buff_size);
+    if (buff == NULL) error("Failed to allocate restart compression buffer");
+
+    size_t stored_len = 0;
+    for (size_t offset = 0; offset < len; offset += RESTART_CHUNK_SIZE) {
+      const size_t chunk = min(len - offset, (size_t)RESTART_CHUNK_SIZE);
+      uLongf clen = buff_size;
+      if (compress2(buff, &clen, (const Bytef *)data + offset, chunk,
+                    w->enc.compression) != Z_OK)
+        error("Failed to compress %s for the restart file", head->label);
+
+      const uint64_t clen64 = clen;
+      if (fwrite(&clen64, sizeof(uint64_t), 1, stream) != 1 ||
+          fwrite(buff, 1, clen, stream) != clen)
+        error("Failed to save %s to restart file (%s)", head->label,
+              strerror(errno));
+      stored_len += sizeof(uint64_t) + clen;
+    }
+    free(buff);
+
+    /* Now that we know it, go back and record the stored size. */
+    desc.stored_len = stored_len;
+    const off_t end_offset = ftello(stream);
+    if (fseeko(stream, desc_offset, SEEK_SET) != 0 ||
+        fwrite(&desc, sizeof(struct block_desc), 1, stream) != 1 ||
+        fseeko(stream, end_offset, SEEK_SET) != 0)
+      error("Failed to update %s descriptor in restart file (%s)",
+            head->label, strerror(errno));
+#else
+    error("SWIFT was not compiled with zlib, cannot compress restart files.");
+#endif
+  }
+}
+
+/**
+ * @brief Read exactly n bytes at a given offset of a file.
+ *
+ * @param fd the file descriptor.
+ * @param buf where to put the data.
+ * @param n the number of bytes to read.
+ * @param offset the offset in the file.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_pread(int fd, void *buf, size_t n, off_t offset,
+                          const char *errstr) {
+  char *cbuf = (char *)buf;
+  while (n > 0) {
+    const ssize_t nread = pread(fd, cbuf, n, offset);
+    if (nread <= 0)
+      error("Failed to restore %s from restart file (%s)", errstr,
+            nread < 0 ? strerror(errno) : "unexpected end of file");
+    cbuf += nread;
+    offset += nread;
+    n -= nread;
+  }
+}
+
+/* A large block read, decompressed and hashed by several threads, one chunk
+ * at a time. */
+struct restart_read_job {
+  int fd;                 /* The file to read from. */
+  int type;               /* The #restart_block_type of the data. */
+  char *ptr;              /* Where the data goes. */
+  size_t len;             /* The size of the data. */
+  size_t nr_chunks;       /* The number of chunks to process. */
+  off_t *chunk_offsets;   /* Offsets of the stored chunks in the file. */
+  size_t *chunk_sizes;    /* Sizes of the stored chunks. */
+  uint64_t *chunk_hashes; /* Hashes of the chunks once read. */
+  size_t next;            /* Next chunk to process. */
+  const char *errstr;     /* Context for errors. */
+};
+
+/**
+ * @brief Body of the threads processing a #restart_read_job.
+ *
+ * @param arg the #restart_read_job.
+ */
+static void *restart_read_job_runner(void *arg) {
+
+  struct restart_read_job *job = (struct restart_read_job *)arg;
+  char *buff = NULL;
+
+  size_t i;
+  while ((i = atomic_inc(&job->next)) < job->nr_chunks) {
+
+    char *chunk_ptr = job->ptr + i * RESTART_CHUNK_SIZE;
+    const size_t chunk =
+        min(job->len - i * RESTART_CHUNK_SIZE, (size_t)RESTART_CHUNK_SIZE);
+
+    if (job->type == restart_block_raw) {
+      restart_pread(job->fd, chunk_ptr, chunk, job->chunk_offsets[i],
+                    job->errstr);
+    } else {
+#ifdef HAVE_ZLIB
+      if (buff == NULL) {
+        buff = (char *)malloc(compressBound(RESTART_CHUNK_SIZE));
+        if (buff == NULL)
+          error("Failed to allocate restart compression buffer");
+      }
+      restart_pread(job->fd, buff, job->chunk_sizes[i], job->chunk_offsets[i],
+                    job->errstr);
+      uLongf ulen = chunk;
+      if (uncompress((Bytef *)chunk_ptr, &ulen, (Bytef *)buff,
+                     job->chunk_sizes[i]) != Z_OK ||
+          ulen != chunk)
+        error("Failed to uncompress %s from restart file", job->errstr);
+#endif
+    }
+
+    job->chunk_hashes[i] = restart_hash_chunk(chunk_ptr, chunk);
+  }
+
+  free(buff);
+  return NULL;
+}
+
+/**
+ * @brief Read a large block of an encoded restart file using several threads
+ *        issuing positioned reads.
+ *
+ * @param fd the file descriptor.
+ * @param desc the descriptor of the block.
+ * @param data_offset the offset of the stored data in the file.
+ * @param ptr pointer to the memory to fill.
+ * @param len the uncompressed size of the block.
+ * @param nr_threads the number of threads to use.
+ * @param errstr a context string to qualify any errors.
+ *
+ * @return the checksum of the data read.
+ */
+static uint64_t restart_read_parallel(int fd, const struct block_desc *desc,
+                                      off_t data_offset, void *ptr, size_t len,
+                                      int nr_threads, const char *errstr) {
+
+  struct restart_read_job job;
+  bzero(&job, sizeof(struct restart_read_job));
+  job.fd = fd;
+  job.type = desc->type;
+  job.ptr = (char *)ptr;
+  job.len = len;
+  job.nr_chunks = (len + RESTART_CHUNK_SIZE - 1) / RESTART_CHUNK_SIZE;
+  job.errstr = errstr;
+  job.chunk_offsets = (off_t *)malloc(job.nr_chunks * sizeof(off_t));
+  job.chunk_sizes = (size_t *)malloc(job.nr_chunks * sizeof(size_t));
+  job.chunk_hashes = (uint64_t *)malloc(job.nr_chunks * sizeof(uint64_t));
+  if (job.chunk_offsets == NULL || job.chunk_sizes == NULL ||
+      job.chunk_hashes == NULL)
+    error("Failed to allocate restart read job");
+
+  /* Where are the chunks? Compressed ones are preceded by their size. */
+  off_t offset = data_offset;
+  for (size_t i = 0; i < job.nr_chunks; i++) {
+    if (desc->type == restart_block_raw) {
+      job.chunk_offsets[i] = offset;
+      job.chunk_sizes[i] = RESTART_CHUNK_SIZE;
+      offset += RESTART_CHUNK_SIZE;
+    } else {
+      uint64_t clen;
+      restart_pread(fd, &clen, sizeof(uint64_t), offset, errstr);
+#ifdef HAVE_ZLIB
+      if (clen > compressBound(RESTART_CHUNK_SIZE))
+        error("Corrupted chunk size for %s in restart file", errstr);
+#endif
+      job.chunk_offsets[i] = offset + sizeof(uint64_t);
+      job.chunk_sizes[i] = clen;
+      offset += sizeof(uint64_t) + clen;
+    }
+  }
+  if (desc->type != restart_block_raw &&
+      (size_t)(offset - data_offset) != desc->stored_len)
+    error("Mismatched stored length in restart file for %s", errstr);
+
+  /* Get the threads going, we take part too. */
+  const int nr_workers = min(nr_threads, (int)job.nr_chunks) - 1;
+  pthread_t *workers = (pthread_t *)malloc(nr_workers * sizeof(pthread_t));
+  if (nr_workers > 0 && workers == NULL)
+    error("Failed to allocate restart reading threads");
+  for (int k = 0; k < nr_workers; k++)
+    if (pthread_create(&workers[k], NULL, restart_read_job_runner, &job) != 0)
+      error("Failed to create restart reading thread.");
+  restart_read_job_runner(&job);
+  for (int k = 0; k < nr_workers; k++)
+    if (pthread_join(workers[k], NULL) != 0)
+      error("Failed to join restart reading thread.");
+
+  uint64_t h = len;
+  for (size_t i = 0; i < job.nr_chunks; i++)
+    h = restart_hash_combine(h, job.chunk_hashes[i]);
+
+  free(workers);
+  free(job.chunk_offsets);
+  free(job.chunk_sizes);
+  free(job.chunk_hashes);
+  return h;
+}
+
+/**
+ * @brief Read the data of a block of an encoded restart file, the descriptor
+ *        having already been read.
+ *
+ * Blocks spanning several chunks are read in parallel when more than one
+ * thread is available.
+ *
+ * @param stream the file stream.
+ * @param desc the descriptor of the block.
+ * @param ptr pointer to the memory to fill.
+ * @param len the uncompressed size of the block.
+ * @param nr_threads the number of threads to use.
+ * @param errstr a context string to qualify any errors.
+ *
+ * @return the checksum of the data read.
+ */
+static uint64_t restart_decode(FILE *stream, const struct block_desc *desc,
+                               void *ptr, size_t len, int nr_threads,
+                               const char *errstr) {
+
+  if (desc->type == restart_block_raw && desc->stored_len != len)
+    error("Mismatched stored length in restart file for %s", errstr);
+  if (desc->type != restart_block_raw && desc->type != restart_block_zlib)
+    error("Unknown block type %d in restart file for %s", desc->type, errstr);
+#ifndef HAVE_ZLIB
+  if (desc->type == restart_block_zlib)
+    error(
+        "Restart file for %s is compressed but SWIFT was not compiled with "
+        "zlib.",
+        errstr);
+#endif
+
+  /* Large blocks are read with positioned reads by several threads. */
+  if (nr_threads > 1 && len > RESTART_CHUNK_SIZE) {
+    const off_t data_offset = ftello(stream);
+    const uint64_t h = restart_read_parallel(fileno(stream), desc, data_offset,
+                                             ptr, len, nr_threads, errstr);
+    if (fseeko(stream, data_offset + desc->stored_len, SEEK_SET) != 0)
+      error("Failed to seek in restart file (%s)", strerror(errno));
+    return h;
+  }
+
+  if (desc->type == restart_block_raw) {
+    if (fread(ptr, 1, len, stream) != len)
+      error("Failed to restore %s from restart file (%s)", errstr,
+            ferror(stream) ? strerror(errno) : "unexpected end of file");
+
+  } else {
+#ifdef HAVE_ZLIB
+    Bytef *buff = (Bytef *)malloc(compressBound(RESTART_CHUNK_SIZE));
+    if (buff == NULL) error("Failed to allocate restart compression buffer");
+
+    for (size_t offset = 0; offset < len; offset += RESTART_CHUNK_SIZE) {
+      const size_t chunk = min(len - offset, (size_t)RESTART_CHUNK_SIZE);
+      uint64_t clen;
+      if (fread(&clen, sizeof(uint64_t), 1, stream) != 1 ||
+          clen > compressBound(RESTART_CHUNK_SIZE) ||
+          fread(buff, 1, clen, stream) != clen)
+        error("Failed to restore %s from restart file (%s)", errstr,
+              ferror(stream) ? strerror(errno) : "unexpected end of file");
+
+      uLongf ulen = chunk;
+      if (uncompress((Bytef *)ptr + offset, &ulen, buff, clen) != Z_OK ||
+          ulen != chunk)
+        error("Failed to uncompress %s from restart file", errstr);
+    }
+    free(buff);
+#endif
+  }
+
+  return restart_hash(ptr, len);
+}
+
+/**
+ * @brief Read the data of a block of an encoded restart file, following the
+ *        reference to the base file if the block is stored there, and verify
+ *        its checksum.
+ *
+ * @param r the #restart_reader.
+ * @param ptr pointer to the memory to fill.
+ * @param len the size of the block.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_reader_decode(struct restart_reader *r, void *ptr,
+                                  size_t len, const char *errstr) {
+
+  /* The blocks must come in the order of the index. */
+  const off_t desc_offset = ftello(r->stream);
+  if (r->next_block >= r->enc.nr_blocks ||
+      r->index[r->next_block].offset != (size_t)desc_offset ||
+      r->index[r->next_block].len != len)
+    error("Restart file does not match its index when reading %s", errstr);
+  r->next_block++;
+
+  struct block_desc desc;
+  if (fread(&desc, sizeof(struct block_desc), 1, r->stream) != 1)
+    error("Failed to read the %s descriptor from restart file (%s)", errstr,
+          strerror(errno));
+
+  if (desc.type != restart_block_base) {
+    if (restart_decode(r->stream, &desc, ptr, len, r->nr_threads, errstr) !=
+        desc.hash)
+      error("Checksum mismatch for %s, the restart file is corrupted", errstr);
+    return;
+  }
+
+  /* The data is unchanged since the base file was written. */
+  if (r->base == NULL) {
+    r->base = fopen(r->enc.base, "r");
+    if (r->base == NULL)
+      error("Failed to open restart base file: %s (%s)", r->enc.base,
+            strerror(errno));
+  }
+
+  struct block_desc base_desc;
+  if (fseeko(r->base, desc.base_offset, SEEK_SET) != 0 ||
+      fread(&base_desc, sizeof(struct block_desc), 1, r->base) != 1)
+    error("Failed to read %s from restart base file %s (%s)", errstr,
+          r->enc.base, strerror(errno));
+  if (base_desc.type == restart_block_base)
+    error("Restart base file %s refers to another base file", r->enc.base);
+
+  const uint64_t h =
+      restart_decode(r->base, &base_desc, ptr, len, r->nr_threads, errstr);
+  if (h != base_desc.hash)
+    error("Checksum mismatch for %s, the restart base file %s is corrupted",
+          errstr, r->enc.base);
+
+  /* Make sure this is the base file the block was compared against. */
+  if (h != desc.hash)
+    error("Restart base file %s does not match the data expected for %s",
+          r->enc.base, errstr);
+}
+
+/**
+ * @brief Read the index of an encoded restart file and check that the file
+ *        is complete.
+ *
+ * @param r the #restart_reader, with the encoding already read.
+ * @param stream the file stream, left where it was.
+ * @param filename name of the file, for the error messages.
+ */
+static void restart_reader_load_index(struct restart_reader *r, FILE *stream,
+                                      const char *filename) {
+
+  /* The index is only recorded once everything else has been written. */
+  if (r->enc.index_offset == 0)
+    error("Restart file %s is incomplete, it has no index.", filename);
+
+  struct stat buf;
+  const size_t index_size = r->enc.nr_blocks * sizeof(struct index_entry);
+  if (fstat(fileno(stream), &buf) != 0 ||
+      (size_t)buf.st_size !=
+          r->enc.index_offset + sizeof(struct header) + index_size)
+    error("Restart file %s is truncated or has the wrong size.", filename);
+
+  r->index = (struct index_entry *)malloc(index_size);
+  if (r->index == NULL) error("Failed to allocate the restart file index");
+
+  const off_t offset = ftello(stream);
+  struct header head;
+  if (fseeko(stream, r->enc.index_offset, SEEK_SET) != 0 ||
+      fread(&head, sizeof(struct header), 1, stream) != 1 ||
+      head.len != index_size ||
+      strncmp(head.label, SWIFT_RESTART_INDEX_LABEL, LABLEN) != 0 ||
+      fread(r->index, sizeof(struct index_entry), r->enc.nr_blocks, stream) !=
+          r->enc.nr_blocks ||
+      fseeko(stream, offset, SEEK_SET) != 0)
+    error("Failed to read the index of restart file %s.", filename);
+
+  /* The blocks must be laid out one after the other. */
+  for (size_t k = 1; k < r->enc.nr_blocks; k++)
+    if (r->index[k].offset <= r->index[k - 1].offset ||
+        r->index[k].offset >= r->enc.index_offset)
+      error("Restart file %s has a corrupted index.", filename);
+}
+
+/**
+ * @brief Finish writing an encoded restart file and, for full dumps in delta
+ *        mode, make it the new base file.
+ *
+ * @param w the #restart_writer.
+ */
+static void restart_writer_finish(struct restart_writer *w) {
+
+  /* Write the index at the end... */
+  struct header head;
+  bzero(&head, sizeof(struct header));
+  head.len = w->nr_blocks * sizeof(struct index_entry);
+  strcpy(head.label, SWIFT_RESTART_INDEX_LABEL);
+  w->enc.index_offset = ftello(w->stream);
+  w->enc.nr_blocks = w->nr_blocks;
+  if (fwrite(&head, sizeof(struct header), 1, w->stream) != 1 ||
+      fwrite(w->blocks, sizeof(struct index_entry), w->nr_blocks, w->stream) !=
+          (size_t)w->nr_blocks)
+    error("Failed to save the index to restart file %s (%s)", w->filename,
+          strerror(errno));
+
+  /* ...and record where it is at the top, marking the file as complete. */
+  if (fseeko(w->stream, w->enc_offset, SEEK_SET) != 0 ||
+      fwrite(&w->enc, sizeof(struct restart_encoding), 1, w->stream) != 1)
+    error("Failed to update the encoding of restart file %s (%s)",
+          w->filename, strerror(errno));
+
+  if (fclose(w->stream) != 0)
+    error("Failed to close restart file: %s (%s)", w->filename,
+          strerror(errno));
+  w->stream = NULL;
+
+  if (w->enc.delta && w->full) {
+
+    /* Keep the data around under the base name, it survives the renaming of
+     * the file to .prev and its later deletion. */
+    unlink(w->enc.base);
+    if (link(w->filename, w->enc.base) != 0) {
+
+      /* Not fatal, the next dump will just be a full one again. */
+      message("Failed to link restart file '%s' to '%s' (%s)", w->filename,
+              w->enc.base, strerror(errno));
+      w->nr_base_blocks = 0;
+
+    } else {
+
+      /* The previous base is still needed by the .prev file, if any. Older
+       * ones are not referenced any more. */
+      if (w->base_previous[0] != '\0' &&
+          strcmp(w->base_previous, w->base_current) != 0)
+        unlink(w->base_previous);
+      strcpy(w->base_previous, w->base_current);
+      strcpy(w->base_current, w->enc.base);
+
+      /* The blocks of this file are what we compare against from now on. */
+      struct index_entry *tmp = w->base_blocks;
+      const int tmp_size = w->size_base_blocks;
+      w->base_blocks = w->blocks;
+      w->size_base_blocks = w->size_blocks;
+      w->nr_base_blocks = w->nr_blocks;
+      w->blocks = tmp;
+      w->size_blocks = tmp_size;
+    }
+  }
+
+  if (w->verbose)
+    message("writing %s took %.3f %s.", w->filename,
+            clocks_from_ticks(getticks() - w->tic), clocks_getunit());
+}
+
+/**
+ * @brief Body of the thread writing the staged blocks of a restart file in
+ *        the background.
+ *
+ * @param arg the #restart_writer.
+ */
+static void *restart_writer_thread(void *arg) {
+
+  struct restart_writer *w = (struct restart_writer *)arg;
+
+  while (1) {
+
+    /* Get the next block, waiting for one if needed. */
+    pthread_mutex_lock(&w->lock);
+    while (w->first == NULL && !w->done) pthread_cond_wait(&w->cond, &w->lock);
+    struct staged_block *b = w->first;
+    if (b != NULL) {
+      w->first = b->next;
+      if (w->first == NULL) w->last = NULL;
+    }
+    pthread_mutex_unlock(&w->lock);
+    if (b == NULL) break;
+
+    restart_writer_encode(w, &b->head, b->data);
+
+    /* Release the space for more staging. */
+    pthread_mutex_lock(&w->lock);
+    w->staged_size -= b->head.len;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    free(b);
+  }
+
+  restart_writer_finish(w);
+  return NULL;
+}
+
+/**
+ * @brief Copy a block out of the engine and queue it for the background
+ *        writer, waiting for space if the staging buffer is full.
+ *
+ * @param w the #restart_writer.
+ * @param head the header of the block.
+ * @param data the data of the block.
+ */
+static void restart_writer_stage(struct restart_writer *w,
+                                 const struct header *head, const void *data) {
+
+  /* Reserve the space, the writer frees it as it goes. */
+  pthread_mutex_lock(&w->lock);
+  while (w->max_staged_size > 0 && w->staged_size > 0 &&
+         w->staged_size + head->len > w->max_staged_size)
+    pthread_cond_wait(&w->cond, &w->lock);
+  w->staged_size += head->len;
+  pthread_mutex_unlock(&w->lock);
+
+  struct staged_block *b =
+      (struct staged_block *)malloc(sizeof(struct staged_block) + head->len);
+  if (b == NULL)
+    error("Failed to allocate %zu bytes to stage %s for the restart file",
+          head->len, head->label);
+  b->next = NULL;
+  b->head = *head;
+  memcpy(b->data, data, head->len);
+
+  pthread_mutex_lock(&w->lock);
+  if (w->last == NULL)
+    w->first = b;
+  else
+    w->last->next = b;
+  w->last = b;
+  pthread_cond_broadcast(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * @brief Start writing an encoded restart file. Writes the description of
+ *        the encoding and starts the background writer, if requested.
  *
  * @param e the engine with our state information.
+ * @param filename name of the file we are writing.
+ * @param stream the file stream, positioned after the version.
+ */
+static void restart_writer_start(struct engine *e, const char *filename,
+                                 FILE *stream) {
+
+  struct restart_writer *w = &restart_writer;
+
+  if (strlen(filename) + 16 >= FNAMELEN)
+    error("Restart file name too long: %s", filename);
+  strcpy(w->filename, filename);
+
+  bzero(&w->enc, sizeof(struct restart_encoding));
+  w->enc.compression = e->restart_compression;
+  w->enc.delta = (e->restart_delta_full_every > 0);
+
+#ifndef HAVE_ZLIB
+  if (w->enc.compression > 0)
+    error("SWIFT was not compiled with zlib, cannot compress restart files.");
+#endif
+
+  /* Full dump or delta against the current base? */
+  if (w->enc.delta) {
+    w->full = (w->nr_base_blocks == 0 ||
+               w->dumps_since_base + 1 >= e->restart_delta_full_every);
+    if (w->full) {
+      w->dumps_since_base = 0;
+      sprintf(w->enc.base, "%s.base-%08d", filename, e->step);
+    } else {
+      w->dumps_since_base++;
+      strcpy(w->enc.base, w->base_current);
+    }
+  }
+  w->nr_blocks = 0;
+
+  /* Tell the readers how to interpret the rest of the file. The index offset
+   * is filled in once the file is complete. */
+  w->enc_offset = ftello(stream) + sizeof(struct header);
+  restart_write_blocks(&w->enc, sizeof(struct restart_encoding), 1, stream,
+                       SWIFT_RESTART_ENCODING_LABEL, "restart encoding");
+
+  w->stream = stream;
+  w->verbose = e->verbose;
+  w->tic = getticks();
+
+  w->async = e->restart_async;
+  if (w->async) {
+    w->done = 0;
+    w->first = w->last = NULL;
+    w->staged_size = 0;
+    w->max_staged_size = e->restart_async_buffer_size;
+    if (pthread_mutex_init(&w->lock, NULL) != 0 ||
+        pthread_cond_init(&w->cond, NULL) != 0)
+      error("Failed to initialise the restart writer lock.");
+    if (pthread_create(&w->thread, NULL, restart_writer_thread, w) != 0)
+      error("Failed to create the restart writer thread.");
+    w->active = 1;
+  }
+}
+
+/**
+ * @brief Wait for the restart file being written in the background, if any,
+ *        to be complete.
+ */
+void restart_write_wait(void) {
+
+  struct restart_writer *w = &restart_writer;
+  if (!w->active) return;
+
+  if (pthread_join(w->thread, NULL) != 0)
+    error("Failed to join the restart writer thread.");
+  pthread_mutex_destroy(&w->lock);
+  pthread_cond_destroy(&w->cond);
+  w->active = 0;
+}
+
+/**
+ * @brief Write a restart file whose blocks are written by the given function,
+ *        using the restart options of the given engine.
+ *
+ * When asynchronous writes are requested, the data is only copied into a
+ * staging buffer and the file is written by a background thread. Call
+ * restart_write_wait() to make sure it is complete.
+ *
+ * @param e the engine with the restart options.
  * @param filename name of the file to write the restart data to.
+ * @param dump the function writing the blocks with restart_write_blocks().
+ * @param data the data passed to the dump function.
  */
-void restart_write(struct engine *e, const char *filename) {
+void restart_write_data(struct engine *e, const char *filename,
+                        restart_stream_function dump, void *data) {
+
+  /* Finish writing the previous file first, if still in progress. */
+  restart_write_wait();
 
   ticks tic = getticks();
 
   /* Save a backup the existing restart file, if requested. */
   if (e->restart_save) restart_save_previous(filename);
 
+  /* The existing file may also be the base of the delta dumps, under another
+   * name. Write a new file rather than truncating that one. */
+  if (e->restart_delta_full_every > 0) unlink(filename);
+
   /* Use a single Lustre stripe with a rank-based OST offset? */
   if (e->restart_lustre_OST_count != 0) {
 
@@ -163,14 +1029,32 @@ void restart_write(struct engine *e, const char *filename) {
   restart_write_blocks((void *)package_version(), strlen(package_version()), 1,
                        stream, "version", "SWIFT version");
 
-  engine_struct_dump(e, stream);
+  /* Checksums, compressed, delta or background writes need the blocks to be
+   * encoded. */
+  const int encoded = e->restart_checksums || e->restart_async ||
+                      e->restart_compression > 0 ||
+                      e->restart_delta_full_every > 0;
+  if (encoded) restart_writer_start(e, filename, stream);
+
+  dump(data, stream);
 
   /* Just an END statement to spot truncated files. */
   restart_write_blocks((void *)SWIFT_RESTART_END_SIGNATURE,
                        strlen(SWIFT_RESTART_END_SIGNATURE), 1, stream,
                        "endsignature", "SWIFT end signature");
 
-  fclose(stream);
+  if (!encoded) {
+    fclose(stream);
+  } else if (!restart_writer.async) {
+    restart_writer_finish(&restart_writer);
+  } else {
+
+    /* Let the background writer finish on its own. */
+    pthread_mutex_lock(&restart_writer.lock);
+    restart_writer.done = 1;
+    pthread_cond_broadcast(&restart_writer.cond);
+    pthread_mutex_unlock(&restart_writer.lock);
+  }
 
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
@@ -178,12 +1062,44 @@ void restart_write(struct engine *e, const char *filename) {
 }
 
 /**
- * @brief Read a restart file to construct a saved engine struct state.
+ * @brief #restart_stream_function dumping the state of an engine struct.
  *
- * @param e the engine to recover from the saved state.
- * @param filename name of the file containing the staved state.
+ * @param data the #engine.
+ * @param stream the file stream.
+ */
+static void restart_engine_dump(void *data, FILE *stream) {
+  engine_struct_dump((struct engine *)data, stream);
+}
+
+/**
+ * @brief Write a restart file for the state of the given engine struct.
+ *
+ * When asynchronous writes are requested, the data is only copied into a
+ * staging buffer and the file is written by a background thread. Call
+ * restart_write_wait() to make sure it is complete.
+ *
+ * @param e the engine with our state information.
+ * @param filename name of the file to write the restart data to.
+ */
+void restart_write(struct engine *e, const char *filename) {
+  restart_write_data(e, filename, restart_engine_dump, e);
+}
+
+/**
+ * @brief Read a restart file whose blocks are read by the given function.
+ *
+ * Files with an index are checked to be complete before anything is restored
+ * and the checksum of every block is verified as it is read.
+ *
+ * @param filename name of the file containing the saved state.
+ * @param nr_threads the number of threads to read large blocks with.
+ * @param restore the function reading the blocks with restart_read_blocks().
+ * @param data the data passed to the restore function.
+ * @param verbose are we talkative?
  */
-void restart_read(struct engine *e, const char *filename) {
+void restart_read_data(const char *filename, const int nr_threads,
+                       restart_stream_function restore, void *data,
+                       const int verbose) {
 
   const ticks tic = getticks();
 
@@ -215,14 +1131,57 @@ void restart_read(struct engine *e, const char *filename) {
         " badly.",
         package_version(), version);
 
-  engine_struct_restore(e, stream);
+  /* Newer files may describe how the rest of their blocks are encoded. */
+  const off_t offset = ftello(stream);
+  struct header head;
+  if (fread(&head, sizeof(struct header), 1, stream) == 1 &&
+      strncmp(head.label, SWIFT_RESTART_ENCODING_LABEL, LABLEN) == 0) {
+    if (fseeko(stream, offset, SEEK_SET) != 0)
+      error("Failed to seek in restart file (%s)", strerror(errno));
+    restart_read_blocks(&restart_reader.enc, sizeof(struct restart_encoding),
+                        1, stream, NULL, "restart encoding");
+    restart_reader_load_index(&restart_reader, stream, filename);
+    restart_reader.stream = stream;
+    restart_reader.nr_threads = nr_threads;
+  } else if (fseeko(stream, offset, SEEK_SET) != 0) {
+    error("Failed to seek in restart file (%s)", strerror(errno));
+  }
+
+  restore(data, stream);
   fclose(stream);
 
-  if (e->verbose)
+  if (restart_reader.base != NULL) fclose(restart_reader.base);
+  free(restart_reader.index);
+  bzero(&restart_reader, sizeof(struct restart_reader));
+
+  if (verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
 }
 
+/**
+ * @brief #restart_stream_function restoring the state of an engine struct.
+ *
+ * @param data the #engine.
+ * @param stream the file stream.
+ */
+static void restart_engine_restore(void *data, FILE *stream) {
+  engine_struct_restore((struct engine *)data, stream);
+}
+
+/**
+ * @brief Read a restart file to construct a saved engine struct state.
+ *
+ * @param e the engine to recover from the saved state.
+ * @param filename name of the file containing the staved state.
+ * @param nr_threads the number of threads to read large blocks with.
+ */
+void restart_read(struct engine *e, const char *filename,
+                  const int nr_threads) {
+  restart_read_data(filename, nr_threads, restart_engine_restore, e,
+                    e->verbose);
+}
+
 /**
  * @brief Read blocks of memory from a file stream into a memory location.
  *        Exits the application if the read fails and does nothing if the
@@ -256,6 +1215,12 @@ void restart_read_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
       strncpy(label, head.label, LABLEN + 1);
     }
 
+    /* Encoded files have a descriptor telling us how the data is stored. */
+    if (restart_reader.stream != NULL && stream == restart_reader.stream) {
+      restart_reader_decode(&restart_reader, ptr, head.len, errstr);
+      return;
+    }
+
     nread = fread(ptr, size, nblocks, stream);
     if (nread != nblocks)
       error("Failed to restore %s from restart file (%s)", errstr,
@@ -285,6 +1250,15 @@ void restart_write_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
     strncpy(head.label, label, LABLEN);
     head.label[LABLEN] = '\0';
 
+    /* Encoded files are written by the restart writer, possibly later. */
+    if (restart_writer.stream != NULL && stream == restart_writer.stream) {
+      if (restart_writer.async)
+        restart_writer_stage(&restart_writer, &head, ptr);
+      else
+        restart_writer_encode(&restart_writer, &head, ptr);
+      return;
+    }
+
     /* Now dump it and the data. */
     size_t nwrite = fwrite(&head, sizeof(struct header), 1, stream);
     if (nwrite != 1)
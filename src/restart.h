@@ -23,8 +23,17 @@
 
 struct engine;
 
+/* Function writing or reading all the blocks of a restart file. */
+typedef void (*restart_stream_function)(void *data, FILE *stream);
+
 void restart_write(struct engine *e, const char *filename);
-void restart_read(struct engine *e, const char *filename);
+void restart_write_data(struct engine *e, const char *filename,
+                        restart_stream_function dump, void *data);
+void restart_write_wait(void);
+void restart_read(struct engine *e, const char *filename, int nr_threads);
+void restart_read_data(const char *filename, int nr_threads,
+                       restart_stream_function restore, void *data,
+                       int verbose);
 
 char **restart_locate(const char *dir, const char *basename, int *nfiles);
 void restart_locate_free(int nfiles, char **files);
@@ -936,6 +936,13 @@ void DOPAIR_SUBSET_BRANCH(struct runner *r, struct cell *restrict ci,
                                        flipped, shift);
     else
       DOPAIR_SUBSET(r, ci, parts_i, ind, count, cj, sid, flipped, shift);
+#elif defined(WITH_SPHENIX_VECTORIZATION) && \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+    if (sort_is_face(sid))
+      runner_dopair_subset_vec_density(r, ci, parts_i, ind, count, cj, sid,
+                                       flipped, shift);
+    else
+      DOPAIR_SUBSET(r, ci, parts_i, ind, count, cj, sid, flipped, shift);
 #else
     DOPAIR_SUBSET(r, ci, parts_i, ind, count, cj, sid, flipped, shift);
 #endif
@@ -1057,6 +1064,9 @@ void DOSELF_SUBSET_BRANCH(struct runner *r, struct cell *restrict ci,
 
 #if defined(WITH_VECTORIZATION) && defined(GADGET2_SPH)
   runner_doself_subset_density_vec(r, ci, parts, ind, count);
+#elif defined(WITH_SPHENIX_VECTORIZATION) && \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+  runner_doself_subset_vec_density(r, ci, parts, ind, count);
 #else
   DOSELF_SUBSET(r, ci, parts, ind, count);
 #endif
@@ -1413,6 +1423,13 @@ void DOPAIR1_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
     runner_dopair1_density_vec(r, ci, cj, sid, shift);
   else
     DOPAIR1(r, ci, cj, sid, shift);
+#elif defined(WITH_SPHENIX_VECTORIZATION) &&     \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY ||  \
+     FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+  if (!sort_is_corner(sid))
+    DOPAIR_VEC(r, ci, cj, sid, shift);
+  else
+    DOPAIR1(r, ci, cj, sid, shift);
 #else
   DOPAIR1(r, ci, cj, sid, shift);
 #endif
@@ -2058,6 +2075,12 @@ void DOPAIR2_BRANCH(struct runner *r, struct cell *ci, struct cell *cj) {
     runner_dopair2_force_vec(r, ci, cj, sid, shift);
   else
     DOPAIR2(r, ci, cj, sid, shift);
+#elif defined(WITH_SPHENIX_VECTORIZATION) && \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+  if (!sort_is_corner(sid))
+    DOPAIR_VEC(r, ci, cj, sid, shift);
+  else
+    DOPAIR2(r, ci, cj, sid, shift);
 #else
   DOPAIR2(r, ci, cj, sid, shift);
 #endif
@@ -2302,6 +2325,10 @@ void DOSELF1_BRANCH(struct runner *r, struct cell *c) {
 #elif defined(WITH_VECTORIZATION) && defined(GADGET2_SPH) && \
     (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
   runner_doself1_density_vec(r, c);
+#elif defined(WITH_SPHENIX_VECTORIZATION) &&     \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY ||  \
+     FUNCTION_TASK_LOOP == TASK_LOOP_GRADIENT)
+  DOSELF_VEC(r, c);
 #else
   DOSELF1(r, c);
 #endif
@@ -2519,6 +2546,9 @@ void DOSELF2_BRANCH(struct runner *r, struct cell *c) {
 #elif defined(WITH_VECTORIZATION) && defined(GADGET2_SPH) && \
     (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
   runner_doself2_force_vec(r, c);
+#elif defined(WITH_SPHENIX_VECTORIZATION) && \
+    (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+  DOSELF_VEC(r, c);
 #else
   DOSELF2(r, c);
 #endif
@@ -0,0 +1,916 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Before including this file, define FUNCTION, which is the
+   name of the interaction function, and FUNCTION_TASK_LOOP. This creates the
+   vectorised interaction functions runner_doself_vec_FUNCTION and
+   runner_dopair_vec_FUNCTION (plus the subset versions for the density loop)
+   working one particle pi at a time against a vector of neighbours read from
+   the particle caches.
+
+   The per-loop work is delegated to hydro_vec_state_FUNCTION (the broadcast
+   values of pi and its accumulators), hydro_vec_init_FUNCTION,
+   hydro_vec_iact_FUNCTION, hydro_vec_store_FUNCTION and
+   hydro_vec_extra_FUNCTION (the scalar, non-hydro physics interactions). */
+
+#define PASTE(x, y) x##_##y
+
+#define _DOSELF_VEC(f) PASTE(runner_doself_vec, f)
+#define DOSELF_VEC _DOSELF_VEC(FUNCTION)
+
+#define _DOPAIR_VEC(f) PASTE(runner_dopair_vec, f)
+#define DOPAIR_VEC _DOPAIR_VEC(FUNCTION)
+
+#define _DOSELF_SUBSET_VEC(f) PASTE(runner_doself_subset_vec, f)
+#define DOSELF_SUBSET_VEC _DOSELF_SUBSET_VEC(FUNCTION)
+
+#define _DOPAIR_SUBSET_VEC(f) PASTE(runner_dopair_subset_vec, f)
+#define DOPAIR_SUBSET_VEC _DOPAIR_SUBSET_VEC(FUNCTION)
+
+#define _VEC_STATE(f) PASTE(hydro_vec_state, f)
+#define VEC_STATE _VEC_STATE(FUNCTION)
+
+#define _VEC_INIT(f) PASTE(hydro_vec_init, f)
+#define VEC_INIT _VEC_INIT(FUNCTION)
+
+#define _VEC_IACT(f) PASTE(hydro_vec_iact, f)
+#define VEC_IACT _VEC_IACT(FUNCTION)
+
+#define _VEC_STORE(f) PASTE(hydro_vec_store, f)
+#define VEC_STORE _VEC_STORE(FUNCTION)
+
+#define _VEC_EXTRA(f) PASTE(hydro_vec_extra, f)
+#define VEC_EXTRA _VEC_EXTRA(FUNCTION)
+
+#define _TIMER_DOSELF(f) PASTE(timer_doself, f)
+#define TIMER_DOSELF _TIMER_DOSELF(FUNCTION)
+
+#define _TIMER_DOPAIR(f) PASTE(timer_dopair, f)
+#define TIMER_DOPAIR _TIMER_DOPAIR(FUNCTION)
+
+/* The density loop only needs the positions, masses and velocities of the
+ * neighbours; the other loops read everything. */
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+#define CACHE_READ_PARTICLES cache_read_particles
+#define CACHE_READ_TWO_CELLS cache_read_two_partial_cells_sorted
+#else
+#define CACHE_READ_PARTICLES cache_read_force_particles
+#define CACHE_READ_TWO_CELLS cache_read_two_partial_cells_sorted_force
+#endif
+
+/**
+ * @brief Compute the cell self-interaction (non-symmetric) using vector
+ * intrinsics with one particle pi at a time.
+ *
+ * @param r The #runner.
+ * @param c The #cell.
+ */
+void DOSELF_VEC(struct runner *r, struct cell *restrict c) {
+
+  const struct engine *e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+  struct part *restrict parts = c->hydro.parts;
+  const int count = c->hydro.count;
+
+  TIMER_TIC;
+
+  /* Anything to do here? */
+  if (!cell_is_active_hydro(c, e)) return;
+
+  /* Check that everybody was drifted here */
+  if (!cell_are_part_drifted(c, e)) error("Interacting undrifted cell.");
+
+#ifdef SWIFT_DEBUG_CHECKS
+  for (int i = 0; i < count; i++) {
+    /* Check that particles have been drifted to the current time */
+    if (parts[i].ti_drift != e->ti_current && !part_is_inhibited(&parts[i], e))
+      error("Particle pi not drifted to current time");
+  }
+#endif
+
+  /* Get the particle cache from the runner and re-allocate
+   * the cache if it is not big enough for the cell. */
+  struct cache *restrict cell_cache = &r->ci_cache;
+  if (cell_cache->count < count) cache_init(cell_cache, count);
+
+  /* Read the particles from the cell and store them locally in the cache. */
+  const int count_align = CACHE_READ_PARTICLES(c, cell_cache);
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Loop over the particles in the cell. */
+  for (int pid = 0; pid < count; pid++) {
+
+    /* Get a pointer to the ith particle. */
+    struct part *restrict pi = &parts[pid];
+
+    /* Is the i^th particle active? */
+    if (!part_is_active(pi, e)) continue;
+
+    /* Fill particle pi vectors. */
+    const float hi = cell_cache->h[pid];
+    const vector v_pix = vector_set1(cell_cache->x[pid]);
+    const vector v_piy = vector_set1(cell_cache->y[pid]);
+    const vector v_piz = vector_set1(cell_cache->z[pid]);
+    const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+
+    /* Reset cumulative sums of update vectors. */
+    struct VEC_STATE state;
+    VEC_INIT(&state, pi);
+
+    /* Loop over all the particles in the cell one vector at a time. */
+    for (int pjd = 0; pjd < count_align; pjd += VEC_SIZE) {
+
+      /* Load 1 set of vectors from the particle cache. */
+      const vector v_pjx = vector_load(&cell_cache->x[pjd]);
+      const vector v_pjy = vector_load(&cell_cache->y[pjd]);
+      const vector v_pjz = vector_load(&cell_cache->z[pjd]);
+
+      /* Compute the pairwise distance. */
+      vector v_dx, v_dy, v_dz, v_r2;
+      v_dx.v = vec_sub(v_pix.v, v_pjx.v);
+      v_dy.v = vec_sub(v_piy.v, v_pjy.v);
+      v_dz.v = vec_sub(v_piz.v, v_pjz.v);
+
+      v_r2.v = vec_mul(v_dx.v, v_dx.v);
+      v_r2.v = vec_fma(v_dy.v, v_dy.v, v_r2.v);
+      v_r2.v = vec_fma(v_dz.v, v_dz.v, v_r2.v);
+
+      /* Form r2 > 0 mask.
+       * This is used to avoid self-interctions */
+      mask_t v_doi_mask_self_check;
+      vec_create_mask(v_doi_mask_self_check, vec_cmp_gt(v_r2.v, vec_setzero()));
+
+      mask_t v_doi_mask;
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+      /* Form a mask from r2 < hig2 mask and r2 < hjg2 mask.
+       * This is writen as r2 < max(hig2, hjg2) */
+      const vector v_hj = vector_load(&cell_cache->h[pjd]);
+      vector v_hjg2;
+      v_hjg2.v = vec_mul(vec_mul(v_hj.v, v_hj.v), kernel_gamma2_vec.v);
+      vec_create_mask(v_doi_mask,
+                      vec_cmp_lt(v_r2.v, vec_fmax(v_hig2.v, v_hjg2.v)));
+#else
+      /* Form r2 < hig2 mask. */
+      vec_create_mask(v_doi_mask, vec_cmp_lt(v_r2.v, v_hig2.v));
+#endif
+
+      /* Combine both masks. */
+      vec_combine_masks(v_doi_mask, v_doi_mask_self_check);
+
+      /* Anything to do? */
+      if (!vec_is_mask_true(v_doi_mask)) continue;
+
+      /* Interact with the non-hydro physics one neighbour at a time. */
+      for (int bit_index = 0; bit_index < VEC_SIZE; bit_index++) {
+        if (vec_is_mask_true(v_doi_mask) & (1 << bit_index)) {
+          struct part *restrict pj = &parts[pjd + bit_index];
+
+#ifdef SWIFT_DEBUG_CHECKS
+          if (pjd + bit_index >= count || part_is_inhibited(pj, e))
+            error("Inhibited particle in interaction cache! id=%lld", pj->id);
+#endif
+
+          const float dx[3] = {v_dx.f[bit_index], v_dy.f[bit_index],
+                               v_dz.f[bit_index]};
+          VEC_EXTRA(v_r2.f[bit_index], dx, hi, pj->h, pi, pj, a, H, e);
+        }
+      }
+
+      /* To stop floating point exceptions when particle separations are 0.
+       * Note that the results for r2==0 are masked out but may still raise
+       * an FPE as only the final operaion is masked, not the whole math
+       * operations sequence. */
+      v_r2.v = vec_add(v_r2.v, vec_set1(FLT_MIN));
+
+      VEC_IACT(&state, &v_r2, &v_dx, &v_dy, &v_dz, cell_cache, pjd, a, H,
+               v_doi_mask);
+
+    } /* Loop over all other particles. */
+
+    /* Perform horizontal adds on vector sums and store result in pi. */
+    VEC_STORE(&state, pi);
+
+  } /* loop over all particles. */
+
+  TIMER_TOC(TIMER_DOSELF);
+}
+
+/**
+ * @brief Compute the interactions between a cell pair (non-symmetric) using
+ * vector intrinsics.
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param sid The direction of the pair.
+ * @param shift The shift vector to apply to the particles in ci.
+ */
+void DOPAIR_VEC(struct runner *r, struct cell *restrict ci,
+                struct cell *restrict cj, const int sid, const double *shift) {
+
+  const struct engine *restrict e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+  const timebin_t max_active_bin = e->max_active_bin;
+
+  TIMER_TIC;
+
+  /* Check whether cells are local to the node. */
+  const int ci_local = (ci->nodeID == e->nodeID);
+  const int cj_local = (cj->nodeID == e->nodeID);
+
+  /* Get the cutoff shift. */
+  double rshift = 0.0;
+  for (int k = 0; k < 3; k++) rshift += shift[k] * runner_shift[sid][k];
+
+  /* Pick-out the sorted lists. */
+  const struct sort_entry *restrict sort_i = cell_get_hydro_sorts(ci, sid);
+  const struct sort_entry *restrict sort_j = cell_get_hydro_sorts(cj, sid);
+
+  /* Get some other useful values. */
+  const int count_i = ci->hydro.count;
+  const int count_j = cj->hydro.count;
+  struct part *restrict parts_i = ci->hydro.parts;
+  struct part *restrict parts_j = cj->hydro.parts;
+  const double di_max = sort_i[count_i - 1].d - rshift;
+  const double dj_min = sort_j[0].d;
+  const float dx_max = (ci->hydro.dx_max_sort + cj->hydro.dx_max_sort);
+  const int active_ci = cell_is_active_hydro(ci, e) && ci_local;
+  const int active_cj = cell_is_active_hydro(cj, e) && cj_local;
+
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+  const double hi_max_raw = ci->hydro.h_max;
+  const double hj_max_raw = cj->hydro.h_max;
+
+  /* Use the largest smoothing length to make sure that no interactions are
+   * missed. */
+  const double h_max =
+      max(ci->hydro.h_max * kernel_gamma, cj->hydro.h_max * kernel_gamma);
+  const double hi_max = h_max;
+  const double hj_max = h_max;
+#else
+  const double hi_max = ci->hydro.h_max * kernel_gamma - rshift;
+  const double hj_max = cj->hydro.h_max * kernel_gamma;
+#endif
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+#ifdef SWIFT_DEBUG_CHECKS
+  /* Check that particles have been drifted to the current time */
+  for (int pid = 0; pid < count_i; pid++)
+    if (parts_i[pid].ti_drift != e->ti_current &&
+        !part_is_inhibited(&parts_i[pid], e))
+      error("Particle pi not drifted to current time");
+  for (int pjd = 0; pjd < count_j; pjd++)
+    if (parts_j[pjd].ti_drift != e->ti_current &&
+        !part_is_inhibited(&parts_j[pjd], e))
+      error("Particle pj not drifted to current time");
+#endif
+
+  /* Count number of particles that are in range and active*/
+  int numActive = 0;
+
+  if (active_ci) {
+    for (int pid = count_i - 1;
+         pid >= 0 && sort_i[pid].d + hi_max + dx_max > dj_min; pid--) {
+      const struct part *restrict pi = &parts_i[sort_i[pid].i];
+      if (part_is_active_no_debug(pi, max_active_bin)) {
+        numActive++;
+        break;
+      }
+    }
+  }
+
+  if (!numActive && active_cj) {
+    for (int pjd = 0; pjd < count_j && sort_j[pjd].d - hj_max - dx_max < di_max;
+         pjd++) {
+      const struct part *restrict pj = &parts_j[sort_j[pjd].i];
+      if (part_is_active_no_debug(pj, max_active_bin)) {
+        numActive++;
+        break;
+      }
+    }
+  }
+
+  /* Return if there are no active particles within range */
+  if (numActive == 0) return;
+
+  /* Get both particle caches from the runner and re-allocate
+   * them if they are not big enough for the cells. */
+  struct cache *restrict ci_cache = &r->ci_cache;
+  struct cache *restrict cj_cache = &r->cj_cache;
+  if (ci_cache->count < count_i) cache_init(ci_cache, count_i);
+  if (cj_cache->count < count_j) cache_init(cj_cache, count_j);
+
+  /* Get a direct pointer to the index arrays */
+  int first_pi, last_pj;
+  swift_declare_aligned_ptr(int, max_index_i, r->ci_cache.max_index,
+                            SWIFT_CACHE_ALIGNMENT);
+  swift_declare_aligned_ptr(int, max_index_j, r->cj_cache.max_index,
+                            SWIFT_CACHE_ALIGNMENT);
+
+  /* Find particles maximum index into cj, max_index_i[] and ci, max_index_j[].
+   * Also find the first pi that interacts with any particle in cj and the last
+   * pj that interacts with any particle in ci. */
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+  populate_max_index_force(ci, cj, sort_i, sort_j, dx_max, rshift, hi_max_raw,
+                           hj_max_raw, h_max, di_max, dj_min, max_index_i,
+                           max_index_j, &first_pi, &last_pj, max_active_bin,
+                           active_ci, active_cj);
+#else
+  populate_max_index_density(ci, cj, sort_i, sort_j, dx_max, rshift, hi_max,
+                             hj_max, di_max, dj_min, max_index_i, max_index_j,
+                             &first_pi, &last_pj, max_active_bin, active_ci,
+                             active_cj);
+#endif
+
+  /* Limits of the outer loops. */
+  const int first_pi_loop = first_pi;
+  const int last_pj_loop_end = last_pj + 1;
+
+  /* Take the max/min of both values calculated to work out how many particles
+   * to read into the cache. */
+  last_pj = max(last_pj, max_index_i[count_i - 1]);
+  first_pi = min(first_pi, max_index_j[0]);
+
+  /* Read the required particles into the two caches. */
+  CACHE_READ_TWO_CELLS(ci, cj, ci_cache, cj_cache, sort_i, sort_j, shift,
+                       &first_pi, &last_pj);
+
+  /* Get the number of particles read into the ci cache. */
+  const int ci_cache_count = count_i - first_pi;
+
+  if (active_ci) {
+
+    /* Loop over the parts in ci until nothing is within range in cj. */
+    for (int pid = count_i - 1; pid >= first_pi_loop; pid--) {
+
+      /* Get a hold of the ith part in ci. */
+      struct part *restrict pi = &parts_i[sort_i[pid].i];
+      if (!part_is_active_no_debug(pi, max_active_bin)) continue;
+
+      /* Set the cache index. */
+      const int ci_cache_idx = pid - first_pi;
+
+      /* Skip this particle if no particle in cj is within range of it. */
+      const float hi = ci_cache->h[ci_cache_idx];
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+      const double di_test =
+          sort_i[pid].d + max(hi, hj_max_raw) * kernel_gamma + dx_max - rshift;
+#else
+      const double di_test =
+          sort_i[pid].d + hi * kernel_gamma + dx_max - rshift;
+#endif
+      if (di_test < dj_min) continue;
+
+      /* Determine the exit iteration of the interaction loop. */
+      const int exit_iteration_end = max_index_i[pid] + 1;
+
+      /* Fill particle pi vectors. */
+      const vector v_pix = vector_set1(ci_cache->x[ci_cache_idx]);
+      const vector v_piy = vector_set1(ci_cache->y[ci_cache_idx]);
+      const vector v_piz = vector_set1(ci_cache->z[ci_cache_idx]);
+      const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+
+      /* Reset cumulative sums of update vectors. */
+      struct VEC_STATE state;
+      VEC_INIT(&state, pi);
+
+      /* Loop over the parts in cj. Making sure to perform an iteration of the
+       * loop even if exit_iteration_align is zero and there is only one
+       * particle to interact with.*/
+      for (int pjd = 0; pjd < exit_iteration_end; pjd += VEC_SIZE) {
+
+        /* Get the cache index to the jth particle. */
+        const int cj_cache_idx = pjd;
+
+#ifdef SWIFT_DEBUG_CHECKS
+        if (cj_cache_idx % VEC_SIZE != 0 || cj_cache_idx < 0 ||
+            cj_cache_idx + (VEC_SIZE - 1) > (last_pj + 1 + VEC_SIZE)) {
+          error("Unaligned read!!! cj_cache_idx=%d, last_pj=%d", cj_cache_idx,
+                last_pj);
+        }
+#endif
+
+        /* Load 1 set of vectors from the particle cache. */
+        const vector v_pjx = vector_load(&cj_cache->x[cj_cache_idx]);
+        const vector v_pjy = vector_load(&cj_cache->y[cj_cache_idx]);
+        const vector v_pjz = vector_load(&cj_cache->z[cj_cache_idx]);
+
+        /* Compute the pairwise distance. */
+        vector v_dx, v_dy, v_dz, v_r2;
+        v_dx.v = vec_sub(v_pix.v, v_pjx.v);
+        v_dy.v = vec_sub(v_piy.v, v_pjy.v);
+        v_dz.v = vec_sub(v_piz.v, v_pjz.v);
+
+        v_r2.v = vec_mul(v_dx.v, v_dx.v);
+        v_r2.v = vec_fma(v_dy.v, v_dy.v, v_r2.v);
+        v_r2.v = vec_fma(v_dz.v, v_dz.v, v_r2.v);
+
+        mask_t v_doi_mask;
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+        /* Form a mask from r2 < hig2 mask and r2 < hjg2 mask. */
+        const vector v_hj = vector_load(&cj_cache->h[cj_cache_idx]);
+        vector v_hjg2;
+        v_hjg2.v = vec_mul(vec_mul(v_hj.v, v_hj.v), kernel_gamma2_vec.v);
+        vec_create_mask(v_doi_mask,
+                        vec_cmp_lt(v_r2.v, vec_fmax(v_hig2.v, v_hjg2.v)));
+#else
+        /* Form r2 < hig2 mask. */
+        vec_create_mask(v_doi_mask, vec_cmp_lt(v_r2.v, v_hig2.v));
+#endif
+
+        /* Anything to do? */
+        if (!vec_is_mask_true(v_doi_mask)) continue;
+
+        /* Interact with the non-hydro physics one neighbour at a time. */
+        for (int bit_index = 0; bit_index < VEC_SIZE; bit_index++) {
+          if (vec_is_mask_true(v_doi_mask) & (1 << bit_index)) {
+            struct part *restrict pj = &parts_j[sort_j[pjd + bit_index].i];
+
+#ifdef SWIFT_DEBUG_CHECKS
+            if (pjd + bit_index >= count_j || part_is_inhibited(pj, e))
+              error("Inhibited particle in interaction cache! id=%lld",
+                    pj->id);
+#endif
+
+            const float dx[3] = {v_dx.f[bit_index], v_dy.f[bit_index],
+                                 v_dz.f[bit_index]};
+            VEC_EXTRA(v_r2.f[bit_index], dx, hi, pj->h, pi, pj, a, H, e);
+          }
+        }
+
+        VEC_IACT(&state, &v_r2, &v_dx, &v_dy, &v_dz, cj_cache, cj_cache_idx,
+                 a, H, v_doi_mask);
+
+      } /* loop over the parts in cj. */
+
+      /* Perform horizontal adds on vector sums and store result in pi. */
+      VEC_STORE(&state, pi);
+
+    } /* loop over the parts in ci. */
+  }
+
+  if (active_cj) {
+
+    /* Loop over the parts in cj until nothing is within range in ci. */
+    for (int pjd = 0; pjd < last_pj_loop_end; pjd++) {
+
+      /* Get a hold of the jth part in cj. */
+      struct part *restrict pj = &parts_j[sort_j[pjd].i];
+      if (!part_is_active_no_debug(pj, max_active_bin)) continue;
+
+      /* Set the cache index. */
+      const int cj_cache_idx = pjd;
+
+      /* Skip this particle if no particle in ci is within range of it. */
+      const float hj = cj_cache->h[cj_cache_idx];
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+      const double dj_test =
+          sort_j[pjd].d - max(hj, hi_max_raw) * kernel_gamma - dx_max;
+#else
+      const double dj_test = sort_j[pjd].d - hj * kernel_gamma - dx_max;
+#endif
+      if (dj_test > di_max) continue;
+
+      /* Determine the exit iteration of the interaction loop. */
+      const int exit_iteration = max_index_j[pjd];
+
+      /* Fill particle pj vectors. */
+      const vector v_pjx = vector_set1(cj_cache->x[cj_cache_idx]);
+      const vector v_pjy = vector_set1(cj_cache->y[cj_cache_idx]);
+      const vector v_pjz = vector_set1(cj_cache->z[cj_cache_idx]);
+      const vector v_hjg2 = vector_set1(hj * hj * kernel_gamma2);
+
+      /* Reset cumulative sums of update vectors. */
+      struct VEC_STATE state;
+      VEC_INIT(&state, pj);
+
+      /* Convert exit iteration to cache indices. */
+      int exit_iteration_align = exit_iteration - first_pi;
+
+      /* Pad the exit iteration align so cache reads are aligned. */
+      const int rem = exit_iteration_align % VEC_SIZE;
+      if (exit_iteration_align < VEC_SIZE) {
+        exit_iteration_align = 0;
+      } else
+        exit_iteration_align -= rem;
+
+      /* Loop over the parts in ci. */
+      for (int ci_cache_idx = exit_iteration_align;
+           ci_cache_idx < ci_cache_count; ci_cache_idx += VEC_SIZE) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+        if (ci_cache_idx % VEC_SIZE != 0 || ci_cache_idx < 0 ||
+            ci_cache_idx + (VEC_SIZE - 1) > (count_i - first_pi + VEC_SIZE)) {
+          error(
+              "Unaligned read!!! ci_cache_idx=%d, first_pi=%d, "
+              "count_i=%d",
+              ci_cache_idx, first_pi, count_i);
+        }
+#endif
+
+        /* Load 1 set of vectors from the particle cache. */
+        const vector v_pix = vector_load(&ci_cache->x[ci_cache_idx]);
+        const vector v_piy = vector_load(&ci_cache->y[ci_cache_idx]);
+        const vector v_piz = vector_load(&ci_cache->z[ci_cache_idx]);
+
+        /* Compute the pairwise distance. */
+        vector v_dx, v_dy, v_dz, v_r2;
+        v_dx.v = vec_sub(v_pjx.v, v_pix.v);
+        v_dy.v = vec_sub(v_pjy.v, v_piy.v);
+        v_dz.v = vec_sub(v_pjz.v, v_piz.v);
+
+        v_r2.v = vec_mul(v_dx.v, v_dx.v);
+        v_r2.v = vec_fma(v_dy.v, v_dy.v, v_r2.v);
+        v_r2.v = vec_fma(v_dz.v, v_dz.v, v_r2.v);
+
+        mask_t v_doj_mask;
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_FORCE)
+        /* Form a mask from r2 < hjg2 mask and r2 < hig2 mask. */
+        const vector v_hi = vector_load(&ci_cache->h[ci_cache_idx]);
+        vector v_hig2;
+        v_hig2.v = vec_mul(vec_mul(v_hi.v, v_hi.v), kernel_gamma2_vec.v);
+        vec_create_mask(v_doj_mask,
+                        vec_cmp_lt(v_r2.v, vec_fmax(v_hjg2.v, v_hig2.v)));
+#else
+        /* Form r2 < hjg2 mask. */
+        vec_create_mask(v_doj_mask, vec_cmp_lt(v_r2.v, v_hjg2.v));
+#endif
+
+        /* Anything to do? */
+        if (!vec_is_mask_true(v_doj_mask)) continue;
+
+        /* Interact with the non-hydro physics one neighbour at a time. */
+        for (int bit_index = 0; bit_index < VEC_SIZE; bit_index++) {
+          if (vec_is_mask_true(v_doj_mask) & (1 << bit_index)) {
+            struct part *restrict pi =
+                &parts_i[sort_i[ci_cache_idx + first_pi + bit_index].i];
+
+#ifdef SWIFT_DEBUG_CHECKS
+            if (ci_cache_idx + bit_index >= ci_cache_count ||
+                part_is_inhibited(pi, e))
+              error("Inhibited particle in interaction cache! id=%lld",
+                    pi->id);
+#endif
+
+            const float dx[3] = {v_dx.f[bit_index], v_dy.f[bit_index],
+                                 v_dz.f[bit_index]};
+            VEC_EXTRA(v_r2.f[bit_index], dx, hj, pi->h, pj, pi, a, H, e);
+          }
+        }
+
+        VEC_IACT(&state, &v_r2, &v_dx, &v_dy, &v_dz, ci_cache, ci_cache_idx,
+                 a, H, v_doj_mask);
+
+      } /* loop over the parts in ci. */
+
+      /* Perform horizontal adds on vector sums and store result in pj. */
+      VEC_STORE(&state, pj);
+
+    } /* loop over the parts in cj. */
+  }
+
+  TIMER_TOC(TIMER_DOPAIR);
+}
+
+#if (FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY)
+
+/**
+ * @brief Compute the cell self-interaction (non-symmetric) using vector
+ * intrinsics for a subset of the particles of the cell.
+ *
+ * @param r The #runner.
+ * @param c The #cell.
+ * @param parts The #part array of the cell.
+ * @param ind The list of indices of particles in @c c to interact with.
+ * @param pi_count The number of particles in @c ind.
+ */
+void DOSELF_SUBSET_VEC(struct runner *r, struct cell *restrict c,
+                       struct part *restrict parts, int *restrict ind,
+                       int pi_count) {
+
+  const struct engine *e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+  struct part *restrict parts_j = c->hydro.parts;
+  const int count = c->hydro.count;
+
+  TIMER_TIC;
+
+  /* Get the particle cache from the runner and re-allocate
+   * the cache if it is not big enough for the cell. */
+  struct cache *restrict cell_cache = &r->ci_cache;
+  if (cell_cache->count < count) cache_init(cell_cache, count);
+
+  /* Read the particles from the cell and store them locally in the cache. */
+  const int count_align = cache_read_particles_subset_self(c, cell_cache);
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Loop over the subset of particles in the parts that need updating. */
+  for (int pid = 0; pid < pi_count; pid++) {
+
+    /* Get a pointer to the ith particle. */
+    struct part *restrict pi = &parts[ind[pid]];
+
+#ifdef SWIFT_DEBUG_CHECKS
+    if (!part_is_active(pi, e)) error("Inactive particle in subset function!");
+#endif
+
+    /* Fill particle pi vectors. */
+    const float hi = pi->h;
+    const vector v_pix = vector_set1(pi->x[0] - c->loc[0]);
+    const vector v_piy = vector_set1(pi->x[1] - c->loc[1]);
+    const vector v_piz = vector_set1(pi->x[2] - c->loc[2]);
+    const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+
+    /* Reset cumulative sums of update vectors. */
+    struct VEC_STATE state;
+    VEC_INIT(&state, pi);
+
+    /* Loop over all the particles in the cell one vector at a time. */
+    for (int pjd = 0; pjd < count_align; pjd += VEC_SIZE) {
+
+      /* Load 1 set of vectors from the particle cache. */
+      const vector v_pjx = vector_load(&cell_cache->x[pjd]);
+      const vector v_pjy = vector_load(&cell_cache->y[pjd]);
+      const vector v_pjz = vector_load(&cell_cache->z[pjd]);
+
+      /* Compute the pairwise distance. */
+      vector v_dx, v_dy, v_dz, v_r2;
+      v_dx.v = vec_sub(v_pix.v, v_pjx.v);
+      v_dy.v = vec_sub(v_piy.v, v_pjy.v);
+      v_dz.v = vec_sub(v_piz.v, v_pjz.v);
+
+      v_r2.v = vec_mul(v_dx.v, v_dx.v);
+      v_r2.v = vec_fma(v_dy.v, v_dy.v, v_r2.v);
+      v_r2.v = vec_fma(v_dz.v, v_dz.v, v_r2.v);
+
+      /* Form r2 > 0 and r2 < hig2 masks. */
+      mask_t v_doi_mask, v_doi_mask_self_check;
+      vec_create_mask(v_doi_mask_self_check, vec_cmp_gt(v_r2.v, vec_setzero()));
+      vec_create_mask(v_doi_mask, vec_cmp_lt(v_r2.v, v_hig2.v));
+      vec_combine_masks(v_doi_mask, v_doi_mask_self_check);
+
+      /* Anything to do? */
+      if (!vec_is_mask_true(v_doi_mask)) continue;
+
+      /* Interact with the non-hydro physics one neighbour at a time. */
+      for (int bit_index = 0; bit_index < VEC_SIZE; bit_index++) {
+        if (vec_is_mask_true(v_doi_mask) & (1 << bit_index)) {
+          struct part *restrict pj = &parts_j[pjd + bit_index];
+
+#ifdef SWIFT_DEBUG_CHECKS
+          if (pjd + bit_index >= count || part_is_inhibited(pj, e))
+            error("Inhibited particle in interaction cache! id=%lld", pj->id);
+#endif
+
+          const float dx[3] = {v_dx.f[bit_index], v_dy.f[bit_index],
+                               v_dz.f[bit_index]};
+          VEC_EXTRA(v_r2.f[bit_index], dx, hi, pj->h, pi, pj, a, H, e);
+        }
+      }
+
+      /* Avoid FPEs for the masked-out r2 == 0 entries. */
+      v_r2.v = vec_add(v_r2.v, vec_set1(FLT_MIN));
+
+      VEC_IACT(&state, &v_r2, &v_dx, &v_dy, &v_dz, cell_cache, pjd, a, H,
+               v_doi_mask);
+
+    } /* Loop over all other particles. */
+
+    /* Perform horizontal adds on vector sums and store result in pi. */
+    VEC_STORE(&state, pi);
+
+  } /* loop over all particles. */
+
+  TIMER_TOC(timer_doself_subset);
+}
+
+/**
+ * @brief Compute the interactions between a cell pair, but only for the
+ *      given indices in ci. (Vectorised)
+ *
+ * @param r The #runner.
+ * @param ci The first #cell.
+ * @param parts_i The #part to interact with @c cj.
+ * @param ind The list of indices of particles in @c ci to interact with.
+ * @param count The number of particles in @c ind.
+ * @param cj The second #cell.
+ * @param sid The direction of the pair.
+ * @param flipped Flag to check whether the cells have been flipped or not.
+ * @param shift The shift vector to apply to the particles in ci.
+ */
+void DOPAIR_SUBSET_VEC(struct runner *r, struct cell *restrict ci,
+                       struct part *restrict parts_i, int *restrict ind,
+                       int count, struct cell *restrict cj, const int sid,
+                       const int flipped, const double *shift) {
+
+  const struct engine *e = r->e;
+  const struct cosmology *restrict cosmo = e->cosmology;
+
+  TIMER_TIC;
+
+  const int count_j = cj->hydro.count;
+  struct part *restrict parts_j = cj->hydro.parts;
+
+  /* Pick-out the sorted lists. */
+  const struct sort_entry *sort_j = cell_get_hydro_sorts(cj, sid);
+  const float dxj = cj->hydro.dx_max_sort;
+
+  /* Get both particle caches from the runner and re-allocate
+   * them if they are not big enough for the cells. */
+  struct cache *restrict cj_cache = &r->cj_cache;
+  if (cj_cache->count < count_j) cache_init(cj_cache, count_j);
+
+  /* Pull each runner_shift from memory. */
+  const double runner_shift_x = runner_shift[sid][0];
+  const double runner_shift_y = runner_shift[sid][1];
+  const double runner_shift_z = runner_shift[sid][2];
+
+  const double total_ci_shift[3] = {
+      ci->loc[0] + shift[0], ci->loc[1] + shift[1], ci->loc[2] + shift[2]};
+
+  /* Calculate the correction to di after the particles have been shifted to the
+   * frame of cell ci. */
+  const double di_shift_correction = ci->loc[0] * runner_shift_x +
+                                     ci->loc[1] * runner_shift_y +
+                                     ci->loc[2] * runner_shift_z;
+
+  int *restrict max_index_i SWIFT_CACHE_ALIGN;
+  max_index_i = r->ci_cache.max_index;
+
+  /* Cosmological terms */
+  const float a = cosmo->a;
+  const float H = cosmo->H;
+
+  /* Find the range of cj to interact with for each particle and read them in
+   * the cache. Parts are on the left when not flipped. */
+  int first_pj = 0, last_pj = 0;
+  if (!flipped) {
+    last_pj = populate_max_index_subset(
+        count, count_j, parts_i, ind, total_ci_shift, dxj, di_shift_correction,
+        runner_shift_x, runner_shift_y, runner_shift_z, sort_j, max_index_i, 0);
+    cache_read_particles_subset_pair(cj, cj_cache, sort_j, 0, &last_pj, ci->loc,
+                                     0);
+  } else {
+    first_pj = populate_max_index_subset(
+        count, count_j, parts_i, ind, total_ci_shift, dxj, di_shift_correction,
+        runner_shift_x, runner_shift_y, runner_shift_z, sort_j, max_index_i, 1);
+    cache_read_particles_subset_pair(cj, cj_cache, sort_j, &first_pj, 0,
+                                     ci->loc, 1);
+  }
+
+  /* Get the number of particles read into the cj cache. */
+  const int cj_cache_count = count_j - first_pj;
+  const double dj_min = sort_j[0].d;
+  const double dj_max = sort_j[count_j - 1].d;
+
+  /* Loop over the parts_i. */
+  for (int pid = 0; pid < count; pid++) {
+
+    /* Get a hold of the ith part in ci. */
+    struct part *restrict pi = &parts_i[ind[pid]];
+    const float pix = pi->x[0] - total_ci_shift[0];
+    const float piy = pi->x[1] - total_ci_shift[1];
+    const float piz = pi->x[2] - total_ci_shift[2];
+    const float hi = pi->h;
+
+    /* Skip this particle if no particle in cj is within range of it and find
+     * the cache range to loop over. */
+    const double di_proj = pix * runner_shift_x + piy * runner_shift_y +
+                           piz * runner_shift_z + di_shift_correction;
+    int loop_start, loop_end;
+    if (!flipped) {
+      if (di_proj + hi * kernel_gamma + dxj < dj_min) continue;
+      loop_start = 0;
+      loop_end = max_index_i[pid] + 1;
+    } else {
+      if (di_proj - hi * kernel_gamma - dxj > dj_max) continue;
+
+      /* Convert exit iteration to cache indices and pad it so cache reads are
+       * aligned. */
+      loop_start = max_index_i[pid] - first_pj;
+      if (loop_start < VEC_SIZE)
+        loop_start = 0;
+      else
+        loop_start -= loop_start % VEC_SIZE;
+      loop_end = cj_cache_count;
+    }
+
+    /* Fill particle pi vectors. */
+    const vector v_pix = vector_set1(pix);
+    const vector v_piy = vector_set1(piy);
+    const vector v_piz = vector_set1(piz);
+    const vector v_hig2 = vector_set1(hi * hi * kernel_gamma2);
+
+    /* Reset cumulative sums of update vectors. */
+    struct VEC_STATE state;
+    VEC_INIT(&state, pi);
+
+    /* Loop over the parts in cj. */
+    for (int cj_cache_idx = loop_start; cj_cache_idx < loop_end;
+         cj_cache_idx += VEC_SIZE) {
+
+      /* Load 1 set of vectors from the particle cache. */
+      const vector v_pjx = vector_load(&cj_cache->x[cj_cache_idx]);
+      const vector v_pjy = vector_load(&cj_cache->y[cj_cache_idx]);
+      const vector v_pjz = vector_load(&cj_cache->z[cj_cache_idx]);
+
+      /* Compute the pairwise distance. */
+      vector v_dx, v_dy, v_dz, v_r2;
+      v_dx.v = vec_sub(v_pix.v, v_pjx.v);
+      v_dy.v = vec_sub(v_piy.v, v_pjy.v);
+      v_dz.v = vec_sub(v_piz.v, v_pjz.v);
+
+      v_r2.v = vec_mul(v_dx.v, v_dx.v);
+      v_r2.v = vec_fma(v_dy.v, v_dy.v, v_r2.v);
+      v_r2.v = vec_fma(v_dz.v, v_dz.v, v_r2.v);
+
+      /* Form r2 < hig2 mask. */
+      mask_t v_doi_mask;
+      vec_create_mask(v_doi_mask, vec_cmp_lt(v_r2.v, v_hig2.v));
+
+      /* Anything to do? */
+      if (!vec_is_mask_true(v_doi_mask)) continue;
+
+      /* Interact with the non-hydro physics one neighbour at a time. */
+      for (int bit_index = 0; bit_index < VEC_SIZE; bit_index++) {
+        if (vec_is_mask_true(v_doi_mask) & (1 << bit_index)) {
+          struct part *restrict pj =
+              &parts_j[sort_j[cj_cache_idx + first_pj + bit_index].i];
+
+#ifdef SWIFT_DEBUG_CHECKS
+          if (cj_cache_idx + bit_index >= cj_cache_count ||
+              part_is_inhibited(pj, e))
+            error("Inhibited particle in interaction cache! id=%lld", pj->id);
+#endif
+
+          const float dx[3] = {v_dx.f[bit_index], v_dy.f[bit_index],
+                               v_dz.f[bit_index]};
+          VEC_EXTRA(v_r2.f[bit_index], dx, hi, pj->h, pi, pj, a, H, e);
+        }
+      }
+
+      VEC_IACT(&state, &v_r2, &v_dx, &v_dy, &v_dz, cj_cache, cj_cache_idx, a,
+               H, v_doi_mask);
+
+    } /* loop over the parts in cj. */
+
+    /* Perform horizontal adds on vector sums and store result in pi. */
+    VEC_STORE(&state, pi);
+
+  } /* loop over the parts in ci. */
+
+  TIMER_TOC(timer_dopair_subset);
+}
+
+#endif /* FUNCTION_TASK_LOOP == TASK_LOOP_DENSITY */
+
+#undef PASTE
+#undef _DOSELF_VEC
+#undef DOSELF_VEC
+#undef _DOPAIR_VEC
+#undef DOPAIR_VEC
+#undef _DOSELF_SUBSET_VEC
+#undef DOSELF_SUBSET_VEC
+#undef _DOPAIR_SUBSET_VEC
+#undef DOPAIR_SUBSET_VEC
+#undef _VEC_STATE
+#undef VEC_STATE
+#undef _VEC_INIT
+#undef VEC_INIT
+#undef _VEC_IACT
+#undef VEC_IACT
+#undef _VEC_STORE
+#undef VEC_STORE
+#undef _VEC_EXTRA
+#undef VEC_EXTRA
+#undef _TIMER_DOSELF
+#undef TIMER_DOSELF
+#undef _TIMER_DOPAIR
+#undef TIMER_DOPAIR
+#undef CACHE_READ_PARTICLES
+#undef CACHE_READ_TWO_CELLS
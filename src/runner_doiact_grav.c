@@ -33,6 +33,140 @@
 #include "space_getsid.h"
 #include "timers.h"
 
+#if defined(WITH_VECTORIZATION) && defined(VEC_HAVE_LDEXP) && \
+    !defined(GADGET2_SOFTENING_CORRECTION) &&                 \
+    !defined(SWIFT_DEBUG_CHECKS) && !defined(SWIFT_GRAVITY_FORCE_CHECKS)
+
+/* The P-P loops use explicit vector intrinsics when no per-interaction
+ * debugging counters need to be updated. */
+#define GRAVITY_PP_VECTORIZATION
+
+/**
+ * @brief Accumulates the P-P gravity interactions of one particle with all
+ * the particles of a #gravity_cache using explicit vector intrinsics.
+ *
+ * @param cj_cache #gravity_cache contaning the source particles.
+ * @param gcount_padded_j The number of particles in the cache padded to the
+ * vector length.
+ * @param x_i The x-coordinate of the particle to update.
+ * @param y_i The y-coordinate of the particle to update.
+ * @param z_i The z-coordinate of the particle to update.
+ * @param h_i The softening length of the particle to update.
+ * @param skip Index in the cache of the particle itself (-1 if not there).
+ * @param periodic Are we using periodic BCs ?
+ * @param dim The size of the simulation volume.
+ * @param truncated Are we using the mesh-truncated interaction ?
+ * @param r_s_inv The inverse of the gravity-mesh smoothing-scale.
+ * @param a_x (return) The x-component of the acceleration.
+ * @param a_y (return) The y-component of the acceleration.
+ * @param a_z (return) The z-component of the acceleration.
+ * @param pot (return) The potential.
+ */
+__attribute__((always_inline)) INLINE static void runner_grav_pp_vec(
+    const struct gravity_cache *restrict cj_cache, const int gcount_padded_j,
+    const float x_i, const float y_i, const float z_i, const float h_i,
+    const int skip, const int periodic, const float dim[3],
+    const int truncated, const float r_s_inv, float *a_x, float *a_y,
+    float *a_z, float *pot) {
+
+  const vector v_x_i = vector_set1(x_i);
+  const vector v_y_i = vector_set1(y_i);
+  const vector v_z_i = vector_set1(z_i);
+  const vector v_h_i = vector_set1(h_i);
+
+  /* Box sizes for the periodic wrapping */
+  const vector v_dim_x = vector_set1(dim[0]);
+  const vector v_dim_y = vector_set1(dim[1]);
+  const vector v_dim_z = vector_set1(dim[2]);
+  const vector v_half_dim_x = vector_set1(0.5f * dim[0]);
+  const vector v_half_dim_y = vector_set1(0.5f * dim[1]);
+  const vector v_half_dim_z = vector_set1(0.5f * dim[2]);
+
+  /* Local accumulators for the acceleration and potential */
+  vector v_a_x = vector_setzero();
+  vector v_a_y = vector_setzero();
+  vector v_a_z = vector_setzero();
+  vector v_pot = vector_setzero();
+
+  /* Loop over every particle in the other cell one vector at a time. */
+  for (int pjd = 0; pjd < gcount_padded_j; pjd += VEC_SIZE) {
+
+    /* Get info about j */
+    const vector v_x_j = vector_load(&cj_cache->x[pjd]);
+    const vector v_y_j = vector_load(&cj_cache->y[pjd]);
+    const vector v_z_j = vector_load(&cj_cache->z[pjd]);
+    const vector v_h_j = vector_load(&cj_cache->epsilon[pjd]);
+    vector v_mass_j = vector_load(&cj_cache->m[pjd]);
+
+    /* Compute the pairwise distance. */
+    vector v_dx, v_dy, v_dz, v_r2;
+    v_dx.v = vec_sub(v_x_j.v, v_x_i.v);
+    v_dy.v = vec_sub(v_y_j.v, v_y_i.v);
+    v_dz.v = vec_sub(v_z_j.v, v_z_i.v);
+
+    /* Correct for periodic BCs (same as nearestf()) */
+    if (periodic) {
+      mask_t m_x_hi, m_x_lo, m_y_hi, m_y_lo, m_z_hi, m_z_lo;
+      vec_create_mask(m_x_hi, vec_cmp_gt(v_dx.v, v_half_dim_x.v));
+      vec_create_mask(m_y_hi, vec_cmp_gt(v_dy.v, v_half_dim_y.v));
+      vec_create_mask(m_z_hi, vec_cmp_gt(v_dz.v, v_half_dim_z.v));
+      vec_create_mask(m_x_lo, vec_cmp_lt(v_dx.v, vec_mul(vec_set1(-1.f),
+                                                         v_half_dim_x.v)));
+      vec_create_mask(m_y_lo, vec_cmp_lt(v_dy.v, vec_mul(vec_set1(-1.f),
+                                                         v_half_dim_y.v)));
+      vec_create_mask(m_z_lo, vec_cmp_lt(v_dz.v, vec_mul(vec_set1(-1.f),
+                                                         v_half_dim_z.v)));
+      v_dx.v = vec_mask_sub(v_dx.v, v_dim_x.v, m_x_hi);
+      v_dy.v = vec_mask_sub(v_dy.v, v_dim_y.v, m_y_hi);
+      v_dz.v = vec_mask_sub(v_dz.v, v_dim_z.v, m_z_hi);
+      v_dx.v = vec_mask_add(v_dx.v, v_dim_x.v, m_x_lo);
+      v_dy.v = vec_mask_add(v_dy.v, v_dim_y.v, m_y_lo);
+      v_dz.v = vec_mask_add(v_dz.v, v_dim_z.v, m_z_lo);
+    }
+
+    v_r2.v = vec_mul(v_dx.v, v_dx.v);
+    v_r2.v = vec_fma(v_dy.v, v_dy.v, v_r2.v);
+    v_r2.v = vec_fma(v_dz.v, v_dz.v, v_r2.v);
+
+    /* No self interaction: remove the mass and move the particle away */
+    if (skip >= pjd && skip < pjd + VEC_SIZE) {
+      v_mass_j.f[skip - pjd] = 0.f;
+      v_r2.f[skip - pjd] = 1.f;
+    }
+
+    /* Pick the maximal softening length of i and j */
+    vector v_h, v_h2, v_h_inv, v_h_inv3;
+    v_h.v = vec_fmax(v_h_i.v, v_h_j.v);
+    v_h2.v = vec_mul(v_h.v, v_h.v);
+    v_h_inv = vec_reciprocal(v_h);
+    v_h_inv3.v = vec_mul(v_h_inv.v, vec_mul(v_h_inv.v, v_h_inv.v));
+
+    /* Interact! */
+    vector v_f_ij, v_pot_ij;
+    if (truncated)
+      runner_iact_grav_pp_truncated_vec(&v_r2, &v_h2, &v_h_inv, &v_h_inv3,
+                                        &v_mass_j, r_s_inv, &v_f_ij,
+                                        &v_pot_ij);
+    else
+      runner_iact_grav_pp_full_vec(&v_r2, &v_h2, &v_h_inv, &v_h_inv3,
+                                   &v_mass_j, &v_f_ij, &v_pot_ij);
+
+    /* Store it back */
+    v_a_x.v = vec_fma(v_f_ij.v, v_dx.v, v_a_x.v);
+    v_a_y.v = vec_fma(v_f_ij.v, v_dy.v, v_a_y.v);
+    v_a_z.v = vec_fma(v_f_ij.v, v_dz.v, v_a_z.v);
+    v_pot.v = vec_add(v_pot_ij.v, v_pot.v);
+  }
+
+  /* Horizontal adds of the accumulators */
+  VEC_HADD(v_a_x, *a_x);
+  VEC_HADD(v_a_y, *a_y);
+  VEC_HADD(v_a_z, *a_z);
+  VEC_HADD(v_pot, *pot);
+}
+
+#endif /* GRAVITY_PP_VECTORIZATION */
+
 /**
  * @brief Clear the unskip flags of this cell.
  *
@@ -569,7 +703,8 @@ static INLINE void runner_dopair_grav_pp_truncated_no_cache(
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache should auto-vectorize
+ * unless it is written with explicit intrinsics (GRAVITY_PP_VECTORIZATION).
  *
  * @param ci_cache #gravity_cache contaning the particles to be updated.
  * @param cj_cache #gravity_cache contaning the source particles.
@@ -614,6 +749,12 @@ static INLINE void runner_dopair_grav_pp_full(
     /* Local accumulators for the acceleration and potential */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#ifdef GRAVITY_PP_VECTORIZATION
+    runner_grav_pp_vec(cj_cache, gcount_padded_j, x_i, y_i, z_i, h_i,
+                       /*skip=*/-1, periodic, dim, /*truncated=*/0,
+                       /*r_s_inv=*/0.f, &a_x, &a_y, &a_z, &pot);
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, cj_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, cj_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -709,6 +850,7 @@ static INLINE void runner_dopair_grav_pp_full(
         accumulate_inc_ll(&gparts_i[pid].num_interacted_p2p);
 #endif
     }
+#endif
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -729,7 +871,8 @@ static INLINE void runner_dopair_grav_pp_full(
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache should auto-vectorize
+ * unless it is written with explicit intrinsics (GRAVITY_PP_VECTORIZATION).
  *
  * This function only makes sense in periodic BCs.
  *
@@ -781,6 +924,12 @@ static INLINE void runner_dopair_grav_pp_truncated(
     /* Local accumulators for the acceleration and potential */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#ifdef GRAVITY_PP_VECTORIZATION
+    runner_grav_pp_vec(cj_cache, gcount_padded_j, x_i, y_i, z_i, h_i,
+                       /*skip=*/-1, /*periodic=*/1, dim, /*truncated=*/1,
+                       r_s_inv, &a_x, &a_y, &a_z, &pot);
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, cj_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, cj_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -876,6 +1025,7 @@ static INLINE void runner_dopair_grav_pp_truncated(
         accumulate_inc_ll(&gparts_i[pid].num_interacted_p2p);
 #endif
     }
+#endif
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -1483,7 +1633,8 @@ void runner_dopair_grav_pp_no_cache(struct runner *r, struct cell *restrict ci,
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache should auto-vectorize
+ * unless it is written with explicit intrinsics (GRAVITY_PP_VECTORIZATION).
  *
  * @param ci_cache #gravity_cache contaning the particles to be updated.
  * @param gcount The number of particles in the cell.
@@ -1511,6 +1662,14 @@ static INLINE void runner_doself_grav_pp_full(
     /* Local accumulators for the acceleration */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#ifdef GRAVITY_PP_VECTORIZATION
+    /* Note: no need for periodic wrapping inside a cell */
+    const float dim[3] = {0.f, 0.f, 0.f};
+    runner_grav_pp_vec(ci_cache, gcount_padded, x_i, y_i, z_i, h_i,
+                       /*skip=*/pid, /*periodic=*/0, dim, /*truncated=*/0,
+                       /*r_s_inv=*/0.f, &a_x, &a_y, &a_z, &pot);
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, ci_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, ci_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -1602,6 +1761,7 @@ static INLINE void runner_doself_grav_pp_full(
         accumulate_inc_ll(&gparts[pid].num_interacted_p2p);
 #endif
     }
+#endif
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -1622,7 +1782,8 @@ static INLINE void runner_doself_grav_pp_full(
  * of a cell and the particles of the other cell.
  *
  * The calculation is performed non-symmetrically using the pre-filled
- * #gravity_cache structures. The loop over the j cache should auto-vectorize.
+ * #gravity_cache structures. The loop over the j cache should auto-vectorize
+ * unless it is written with explicit intrinsics (GRAVITY_PP_VECTORIZATION).
  *
  * This function only makes sense in periodic BCs.
  *
@@ -1659,6 +1820,14 @@ static INLINE void runner_doself_grav_pp_truncated(
     /* Local accumulators for the acceleration and potential */
     float a_x = 0.f, a_y = 0.f, a_z = 0.f, pot = 0.f;
 
+#ifdef GRAVITY_PP_VECTORIZATION
+    /* Note: no need for periodic wrapping inside a cell */
+    const float dim[3] = {0.f, 0.f, 0.f};
+    runner_grav_pp_vec(ci_cache, gcount_padded, x_i, y_i, z_i, h_i,
+                       /*skip=*/pid, /*periodic=*/0, dim, /*truncated=*/1,
+                       r_s_inv, &a_x, &a_y, &a_z, &pot);
+#else
+
     /* Make the compiler understand we are in happy vectorization land */
     swift_align_information(float, ci_cache->x, SWIFT_CACHE_ALIGNMENT);
     swift_align_information(float, ci_cache->y, SWIFT_CACHE_ALIGNMENT);
@@ -1752,6 +1921,7 @@ static INLINE void runner_doself_grav_pp_truncated(
         accumulate_inc_ll(&gparts[pid].num_interacted_p2p);
 #endif
     }
+#endif
 
     /* Store everything back in cache */
     ci_cache->a_x[pid] += a_x;
@@ -80,6 +80,12 @@
 #define _DOSELF_SUBSET_BRANCH(f) PASTE(runner_doself_subset_branch, f)
 #define DOSELF_SUBSET_BRANCH _DOSELF_SUBSET_BRANCH(FUNCTION)
 
+#define _DOSELF_VEC(f) PASTE(runner_doself_vec, f)
+#define DOSELF_VEC _DOSELF_VEC(FUNCTION)
+
+#define _DOPAIR_VEC(f) PASTE(runner_dopair_vec, f)
+#define DOPAIR_VEC _DOPAIR_VEC(FUNCTION)
+
 #define _DOSUB_SELF1(f) PASTE(runner_dosub_self1, f)
 #define DOSUB_SELF1 _DOSUB_SELF1(FUNCTION)
 
@@ -23,10 +23,24 @@
 /* This object's header. */
 #include "runner_doiact_hydro_vec.h"
 
-#if defined(WITH_VECTORIZATION) && defined(GADGET2_SPH)
+/* Local headers. */
+#include "chemistry.h"
+#include "pressure_floor_iact.h"
+#include "rt.h"
+#include "sink_iact.h"
+#include "sink_properties.h"
+#include "star_formation_iact.h"
+#include "timestep_limiter_iact.h"
+
+#if defined(WITH_VECTORIZATION) && \
+    (defined(GADGET2_SPH) || defined(WITH_SPHENIX_VECTORIZATION))
 
 static const vector kernel_gamma2_vec = FILL_VEC(kernel_gamma2);
 
+#endif
+
+#if defined(WITH_VECTORIZATION) && defined(GADGET2_SPH)
+
 /**
  * @brief Compute the vector remainder interactions from the secondary cache.
  *
@@ -231,6 +245,11 @@ __attribute__((always_inline)) INLINE static void storeInteractions(
   }
 }
 
+#endif /* WITH_VECTORIZATION && GADGET2_SPH */
+
+#if defined(WITH_VECTORIZATION) && \
+    (defined(GADGET2_SPH) || defined(WITH_SPHENIX_VECTORIZATION))
+
 /**
  * @brief Populates the arrays max_index_i and max_index_j with the maximum
  * indices of
@@ -637,7 +656,7 @@ __attribute__((always_inline)) INLINE static int populate_max_index_subset(
   }
 }
 
-#endif /* WITH_VECTORIZATION && GADGET2_SPH */
+#endif /* WITH_VECTORIZATION && (GADGET2_SPH || SPHENIX) */
 
 /**
  * @brief Compute the cell self-interaction (non-symmetric) using vector
@@ -2486,3 +2505,292 @@ void runner_dopair2_force_vec(struct runner *r, struct cell *ci,
 
 #endif /* WITH_VECTORIZATION */
 }
+
+#ifdef WITH_SPHENIX_VECTORIZATION
+
+/* Glue between the generic SPHENIX vector loops and the interaction kernels:
+ * the broadcast values of the particle being updated, its vector
+ * accumulators and the scalar interactions of the other physics modules. */
+
+/**
+ * @brief Values of pi and vector sums for the SPHENIX density loop.
+ */
+struct hydro_vec_state_density {
+
+  vector hi_inv, vix, viy, viz;
+
+  vector rhoSum, rho_dhSum, wcountSum, wcount_dhSum;
+  vector div_vSum, curlvxSum, curlvySum, curlvzSum;
+};
+
+/**
+ * @brief Broadcast pi and reset the sums of the density loop.
+ *
+ * @param s The #hydro_vec_state_density to fill.
+ * @param pi The particle being updated.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_init_density(
+    struct hydro_vec_state_density *s, const struct part *pi) {
+
+  s->hi_inv = vector_set1(1.f / pi->h);
+  s->vix = vector_set1(pi->v[0]);
+  s->viy = vector_set1(pi->v[1]);
+  s->viz = vector_set1(pi->v[2]);
+
+  s->rhoSum = vector_setzero();
+  s->rho_dhSum = vector_setzero();
+  s->wcountSum = vector_setzero();
+  s->wcount_dhSum = vector_setzero();
+  s->div_vSum = vector_setzero();
+  s->curlvxSum = vector_setzero();
+  s->curlvySum = vector_setzero();
+  s->curlvzSum = vector_setzero();
+}
+
+/**
+ * @brief Density interactions of pi with one vector of cached neighbours.
+ *
+ * @param s The #hydro_vec_state_density of pi.
+ * @param r2 The squared distances.
+ * @param dx The x separations (pi - pj).
+ * @param dy The y separations (pi - pj).
+ * @param dz The z separations (pi - pj).
+ * @param c The #cache containing the neighbours.
+ * @param j The index of the first neighbour in the cache.
+ * @param a The current scale factor.
+ * @param H The current Hubble parameter.
+ * @param mask The mask of neighbours to interact with.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_iact_density(
+    struct hydro_vec_state_density *s, vector *r2, vector *dx, vector *dy,
+    vector *dz, const struct cache *c, const int j, const float a,
+    const float H, const mask_t mask) {
+
+  runner_iact_nonsym_1_vec_density(
+      r2, dx, dy, dz, s->hi_inv, s->vix, s->viy, s->viz, &c->vx[j], &c->vy[j],
+      &c->vz[j], &c->m[j], &s->rhoSum, &s->rho_dhSum, &s->wcountSum,
+      &s->wcount_dhSum, &s->div_vSum, &s->curlvxSum, &s->curlvySum,
+      &s->curlvzSum, mask);
+}
+
+/**
+ * @brief Reduce the density sums and add them to pi.
+ *
+ * @param s The #hydro_vec_state_density of pi.
+ * @param pi The particle being updated.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_store_density(
+    struct hydro_vec_state_density *s, struct part *pi) {
+
+  VEC_HADD(s->rhoSum, pi->rho);
+  VEC_HADD(s->rho_dhSum, pi->density.rho_dh);
+  VEC_HADD(s->wcountSum, pi->density.wcount);
+  VEC_HADD(s->wcount_dhSum, pi->density.wcount_dh);
+  VEC_HADD(s->div_vSum, pi->viscosity.div_v);
+  VEC_HADD(s->curlvxSum, pi->density.rot_v[0]);
+  VEC_HADD(s->curlvySum, pi->density.rot_v[1]);
+  VEC_HADD(s->curlvzSum, pi->density.rot_v[2]);
+}
+
+/**
+ * @brief Non-hydro density interactions of a single pair (pi updated).
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_extra_density(
+    const float r2, const float dx[3], const float hi, const float hj,
+    struct part *pi, struct part *pj, const float a, const float H,
+    const struct engine *e) {
+
+  runner_iact_nonsym_chemistry(r2, dx, hi, hj, pi, pj, a, H);
+  runner_iact_nonsym_pressure_floor(r2, dx, hi, hj, pi, pj, a, H);
+  runner_iact_nonsym_star_formation(r2, dx, hi, hj, pi, pj, a, H);
+  runner_iact_nonsym_sink(r2, dx, hi, hj, pi, pj, a, H,
+                          e->sink_properties->cut_off_radius);
+}
+
+/**
+ * @brief Values of pi and vector sums for the SPHENIX gradient loop.
+ */
+struct hydro_vec_state_gradient {
+
+  vector hi_inv, vix, viy, viz, ui, ci;
+
+  vector v_sigMax, laplace_uSum, alpha_visc_max_ngbMax;
+};
+
+/**
+ * @brief Broadcast pi and reset the sums of the gradient loop.
+ *
+ * The maxima start from the current values of pi so that the horizontal
+ * maximum can overwrite them.
+ *
+ * @param s The #hydro_vec_state_gradient to fill.
+ * @param pi The particle being updated.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_init_gradient(
+    struct hydro_vec_state_gradient *s, const struct part *pi) {
+
+  s->hi_inv = vector_set1(1.f / pi->h);
+  s->vix = vector_set1(pi->v[0]);
+  s->viy = vector_set1(pi->v[1]);
+  s->viz = vector_set1(pi->v[2]);
+  s->ui = vector_set1(pi->u);
+  s->ci = vector_set1(pi->force.soundspeed);
+
+  s->v_sigMax = vector_set1(pi->viscosity.v_sig);
+  s->laplace_uSum = vector_setzero();
+  s->alpha_visc_max_ngbMax = vector_set1(pi->force.alpha_visc_max_ngb);
+}
+
+/**
+ * @brief Gradient interactions of pi with one vector of cached neighbours.
+ *
+ * See hydro_vec_iact_density() for the parameters.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_iact_gradient(
+    struct hydro_vec_state_gradient *s, vector *r2, vector *dx, vector *dy,
+    vector *dz, const struct cache *c, const int j, const float a,
+    const float H, const mask_t mask) {
+
+  runner_iact_nonsym_1_vec_gradient(
+      r2, dx, dy, dz, s->hi_inv, s->vix, s->viy, s->viz, s->ui, s->ci,
+      &c->vx[j], &c->vy[j], &c->vz[j], &c->m[j], &c->rho[j], &c->u[j],
+      &c->soundspeed[j], &c->alpha_visc[j], a, H, &s->v_sigMax,
+      &s->laplace_uSum, &s->alpha_visc_max_ngbMax, mask);
+}
+
+/**
+ * @brief Reduce the gradient sums and maxima into pi.
+ *
+ * @param s The #hydro_vec_state_gradient of pi.
+ * @param pi The particle being updated.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_store_gradient(
+    struct hydro_vec_state_gradient *s, struct part *pi) {
+
+  VEC_HMAX(s->v_sigMax, pi->viscosity.v_sig);
+  VEC_HADD(s->laplace_uSum, pi->diffusion.laplace_u);
+  VEC_HMAX(s->alpha_visc_max_ngbMax, pi->force.alpha_visc_max_ngb);
+}
+
+/**
+ * @brief Non-hydro gradient interactions of a single pair (none).
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_extra_gradient(
+    const float r2, const float dx[3], const float hi, const float hj,
+    struct part *pi, struct part *pj, const float a, const float H,
+    const struct engine *e) {}
+
+/**
+ * @brief Values of pi and vector sums for the SPHENIX force loop.
+ */
+struct hydro_vec_state_force {
+
+  vector hi_inv, vix, viy, viz, rhoi, grad_hi, pressurei, balsara_i, ci, ui;
+  vector alpha_visc_i, alpha_diff_i, mi;
+
+  vector a_hydro_xSum, a_hydro_ySum, a_hydro_zSum, h_dtSum, u_dtSum;
+};
+
+/**
+ * @brief Broadcast pi and reset the sums of the force loop.
+ *
+ * @param s The #hydro_vec_state_force to fill.
+ * @param pi The particle being updated.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_init_force(
+    struct hydro_vec_state_force *s, const struct part *pi) {
+
+  s->hi_inv = vector_set1(1.f / pi->h);
+  s->vix = vector_set1(pi->v[0]);
+  s->viy = vector_set1(pi->v[1]);
+  s->viz = vector_set1(pi->v[2]);
+  s->rhoi = vector_set1(pi->rho);
+  s->grad_hi = vector_set1(pi->force.f);
+  s->pressurei = vector_set1(pi->force.pressure);
+  s->balsara_i = vector_set1(pi->force.balsara);
+  s->ci = vector_set1(pi->force.soundspeed);
+  s->ui = vector_set1(pi->u);
+  s->alpha_visc_i = vector_set1(pi->viscosity.alpha);
+  s->alpha_diff_i = vector_set1(pi->diffusion.alpha);
+  s->mi = vector_set1(pi->mass);
+
+  s->a_hydro_xSum = vector_setzero();
+  s->a_hydro_ySum = vector_setzero();
+  s->a_hydro_zSum = vector_setzero();
+  s->h_dtSum = vector_setzero();
+  s->u_dtSum = vector_setzero();
+}
+
+/**
+ * @brief Force interactions of pi with one vector of cached neighbours.
+ *
+ * See hydro_vec_iact_density() for the parameters.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_iact_force(
+    struct hydro_vec_state_force *s, vector *r2, vector *dx, vector *dy,
+    vector *dz, const struct cache *c, const int j, const float a,
+    const float H, const mask_t mask) {
+
+  vector hj_inv;
+  hj_inv = vec_reciprocal(vector_load(&c->h[j]));
+
+  runner_iact_nonsym_1_vec_force(
+      r2, dx, dy, dz, s->vix, s->viy, s->viz, s->rhoi, s->grad_hi,
+      s->pressurei, s->balsara_i, s->ci, s->ui, s->alpha_visc_i,
+      s->alpha_diff_i, s->mi, &c->vx[j], &c->vy[j], &c->vz[j], &c->rho[j],
+      &c->grad_h[j], &c->pressure[j], &c->balsara[j], &c->soundspeed[j],
+      &c->u[j], &c->alpha_visc[j], &c->alpha_diff[j], &c->m[j], s->hi_inv,
+      hj_inv, a, H, &s->a_hydro_xSum, &s->a_hydro_ySum, &s->a_hydro_zSum,
+      &s->h_dtSum, &s->u_dtSum, mask);
+}
+
+/**
+ * @brief Reduce the force sums and add them to pi.
+ *
+ * @param s The #hydro_vec_state_force of pi.
+ * @param pi The particle being updated.
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_store_force(
+    struct hydro_vec_state_force *s, struct part *pi) {
+
+  VEC_HADD(s->a_hydro_xSum, pi->a_hydro[0]);
+  VEC_HADD(s->a_hydro_ySum, pi->a_hydro[1]);
+  VEC_HADD(s->a_hydro_zSum, pi->a_hydro[2]);
+  VEC_HADD(s->h_dtSum, pi->force.h_dt);
+  VEC_HADD(s->u_dtSum, pi->u_dt);
+}
+
+/**
+ * @brief Non-hydro force interactions of a single pair (pi updated).
+ */
+__attribute__((always_inline)) INLINE static void hydro_vec_extra_force(
+    const float r2, const float dx[3], const float hi, const float hj,
+    struct part *pi, struct part *pj, const float a, const float H,
+    const struct engine *e) {
+
+  runner_iact_nonsym_timebin(r2, dx, hi, hj, pi, pj, a, H);
+  runner_iact_nonsym_rt_timebin(r2, dx, hi, hj, pi, pj, a, H);
+  runner_iact_nonsym_diffusion(r2, dx, hi, hj, pi, pj, a, H, e->time_base,
+                               e->ti_current, e->cosmology,
+                               (e->policy & engine_policy_cosmology));
+}
+
+#define FUNCTION density
+#define FUNCTION_TASK_LOOP TASK_LOOP_DENSITY
+#include "runner_doiact_functions_hydro_vec.h"
+#undef FUNCTION
+#undef FUNCTION_TASK_LOOP
+
+#define FUNCTION gradient
+#define FUNCTION_TASK_LOOP TASK_LOOP_GRADIENT
+#include "runner_doiact_functions_hydro_vec.h"
+#undef FUNCTION
+#undef FUNCTION_TASK_LOOP
+
+#define FUNCTION force
+#define FUNCTION_TASK_LOOP TASK_LOOP_FORCE
+#include "runner_doiact_functions_hydro_vec.h"
+#undef FUNCTION
+#undef FUNCTION_TASK_LOOP
+
+#endif /* WITH_SPHENIX_VECTORIZATION */
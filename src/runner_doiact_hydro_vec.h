@@ -33,6 +33,16 @@
 #include "timers.h"
 #include "vector.h"
 
+/* The SPHENIX loops are vectorised when asked for at configure time
+ * (--enable-sphenix-vec) and no physics module needs the per-interaction
+ * information the vector loops do not provide. */
+#if defined(WITH_VECTORIZATION) && defined(WITH_SPHENIX_HAND_VEC) &&        \
+    defined(SPHENIX_SPH) && defined(NONE_MHD) &&                            \
+    !defined(ADAPTIVE_SOFTENING) && !defined(SWIFT_HYDRO_DENSITY_CHECKS) && \
+    !defined(DEBUG_INTERACTIONS_SPH)
+#define WITH_SPHENIX_VECTORIZATION
+#endif
+
 /* Function prototypes. */
 void runner_doself_subset_density_vec(struct runner *r,
                                       struct cell *restrict ci,
@@ -53,4 +63,29 @@ void runner_dopair2_force_vec(struct runner *r, struct cell *restrict ci,
                               struct cell *restrict cj, const int sid,
                               const double *shift);
 
+#ifdef WITH_SPHENIX_VECTORIZATION
+void runner_doself_vec_density(struct runner *r, struct cell *restrict c);
+void runner_doself_vec_gradient(struct runner *r, struct cell *restrict c);
+void runner_doself_vec_force(struct runner *r, struct cell *restrict c);
+void runner_dopair_vec_density(struct runner *r, struct cell *restrict ci,
+                               struct cell *restrict cj, const int sid,
+                               const double *shift);
+void runner_dopair_vec_gradient(struct runner *r, struct cell *restrict ci,
+                                struct cell *restrict cj, const int sid,
+                                const double *shift);
+void runner_dopair_vec_force(struct runner *r, struct cell *restrict ci,
+                             struct cell *restrict cj, const int sid,
+                             const double *shift);
+void runner_doself_subset_vec_density(struct runner *r,
+                                      struct cell *restrict ci,
+                                      struct part *restrict parts,
+                                      int *restrict ind, int count);
+void runner_dopair_subset_vec_density(struct runner *r,
+                                      struct cell *restrict ci,
+                                      struct part *restrict parts_i,
+                                      int *restrict ind, int count,
+                                      struct cell *restrict cj, const int sid,
+                                      const int flipped, const double *shift);
+#endif
+
 #endif /* SWIFT_RUNNER_VEC_H */
@@ -22,6 +22,9 @@
 /* Config parameters. */
 #include <config.h>
 
+/* Some standard headers. */
+#include <string.h>
+
 /* MPI headers. */
 #ifdef WITH_MPI
 #include <mpi.h>
@@ -478,7 +481,9 @@ void *runner_main(void *data) {
           break;
 #ifdef WITH_MPI
         case task_type_send:
-          if (t->subtype == task_subtype_tend) {
+          if (e->sched.mpi_pack_parts && cell_pack_parts_size(t->subtype)) {
+            if (t->persistent == task_mpi_persistent_none) free(t->buff);
+          } else if (t->subtype == task_subtype_tend) {
             free(t->buff);
           } else if (t->subtype == task_subtype_sf_counts) {
             free(t->buff);
@@ -491,6 +496,13 @@ void *runner_main(void *data) {
           }
           break;
         case task_type_recv:
+          if (e->sched.mpi_pack_parts && cell_pack_parts_size(t->subtype)) {
+            cell_unpack_parts(ci, t->subtype, (const char *)t->buff);
+            if (t->persistent == task_mpi_persistent_none) free(t->buff);
+          } else if (t->persistent == task_mpi_persistent_aggregate) {
+            memcpy(ci->hydro.parts, t->buff,
+                   ci->hydro.count * sizeof(struct part));
+          }
           if (t->subtype == task_subtype_tend) {
             cell_unpack_end_step(ci, (struct pcell_step *)t->buff);
             free(t->buff);
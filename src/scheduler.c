@@ -1151,6 +1151,109 @@ void scheduler_write_cell_dependencies(struct scheduler *s, int verbose,
 #endif /* defined SWIFT_DEBUG_CHECKS || defined CELL_GRAPH */
 }
 
+/* What scheduler_splittasks() does with a task. */
+enum scheduler_split_decision {
+  scheduler_split_keep,  /* Leave the task as it is. */
+  scheduler_split_sub,   /* Turn it into a sub-task. */
+  scheduler_split_split, /* Split it over the progeny. */
+  scheduler_split_force  /* Force-split it over all the progeny pairs. */
+};
+
+/**
+ * @brief What to do with a hydrodynamic self-task.
+ *
+ * @param ci The #cell of the task.
+ */
+static enum scheduler_split_decision scheduler_split_self_hydro(
+    const struct cell *ci) {
+
+  /* Is this cell even split and the task does not violate h ? */
+  if (!cell_can_split_self_hydro_task(ci)) return scheduler_split_keep;
+
+  /* Make a sub? */
+  if (scheduler_dosub && (ci->hydro.count < space_subsize_self_hydro) &&
+      (ci->stars.count < space_subsize_self_stars))
+    return scheduler_split_sub;
+
+  return scheduler_split_split;
+}
+
+/**
+ * @brief What to do with a hydrodynamic pair-task.
+ *
+ * @param ci The first #cell of the task, after space_getsid_and_swap_cells().
+ * @param cj The second #cell of the task, after space_getsid_and_swap_cells().
+ * @param sid The sort ID of the pair.
+ */
+static enum scheduler_split_decision scheduler_split_pair_hydro(
+    const struct cell *ci, const struct cell *cj, const int sid) {
+
+  /* Should this task be split-up? */
+  if (cell_can_split_pair_hydro_task(ci) &&
+      cell_can_split_pair_hydro_task(cj)) {
+
+    const int h_count_i = ci->hydro.count;
+    const int h_count_j = cj->hydro.count;
+
+    const int s_count_i = ci->stars.count;
+    const int s_count_j = cj->stars.count;
+
+    int do_sub_hydro = 1;
+    int do_sub_stars_i = 1;
+    int do_sub_stars_j = 1;
+    if (h_count_i > 0 && h_count_j > 0) {
+
+      /* Note: Use division to avoid integer overflow. */
+      do_sub_hydro =
+          h_count_i * sid_scale[sid] < space_subsize_pair_hydro / h_count_j;
+    }
+    if (s_count_i > 0 && h_count_j > 0) {
+
+      /* Note: Use division to avoid integer overflow. */
+      do_sub_stars_i =
+          s_count_i * sid_scale[sid] < space_subsize_pair_stars / h_count_j;
+    }
+    if (s_count_j > 0 && h_count_i > 0) {
+
+      /* Note: Use division to avoid integer overflow. */
+      do_sub_stars_j =
+          s_count_j * sid_scale[sid] < space_subsize_pair_stars / h_count_i;
+    }
+
+    /* Replace by a single sub-task? */
+    if (scheduler_dosub && (do_sub_hydro && do_sub_stars_i && do_sub_stars_j) &&
+        !sort_is_corner(sid))
+      return scheduler_split_sub;
+
+    return scheduler_split_split;
+  }
+
+  /* Otherwise, break it up if it is too large? */
+  if (scheduler_doforcesplit && ci->split && cj->split &&
+      (ci->hydro.count > space_maxsize / cj->hydro.count))
+    return scheduler_split_force;
+
+  return scheduler_split_keep;
+}
+
+/**
+ * @brief What to do with a gravity self-task.
+ *
+ * Gravity self-tasks have no sub-task version, so they are left as they are
+ * in both the scheduler_split_keep and scheduler_split_sub cases.
+ *
+ * @param ci The #cell of the task.
+ */
+static enum scheduler_split_decision scheduler_split_self_gravity(
+    const struct cell *ci) {
+
+  /* Should we split this task? */
+  if (!cell_can_split_self_gravity_task(ci)) return scheduler_split_keep;
+  if (scheduler_dosub && ci->grav.count < space_subsize_self_grav)
+    return scheduler_split_sub;
+  return scheduler_split_split;
+}
+
 /**
  * @brief Split a hydrodynamic task if too large.
  *
@@ -1214,10 +1317,11 @@ static void scheduler_splittask_hydro(struct task *t, struct scheduler *s) {
       }
 
       /* Is this cell even split and the task does not violate h ? */
-      if (cell_can_split_self_hydro_task(ci)) {
+      const enum scheduler_split_decision split =
+          scheduler_split_self_hydro(ci);
+      if (split != scheduler_split_keep) {
         /* Make a sub? */
-        if (scheduler_dosub && (ci->hydro.count < space_subsize_self_hydro) &&
-            (ci->stars.count < space_subsize_self_stars)) {
+        if (split == scheduler_split_sub) {
           /* convert to a self-subtask. */
           t->type = task_type_sub_self;
 
@@ -1295,41 +1399,12 @@ static void scheduler_splittask_hydro(struct task *t, struct scheduler *s) {
 #endif
 
       /* Should this task be split-up? */
-      if (cell_can_split_pair_hydro_task(ci) &&
-          cell_can_split_pair_hydro_task(cj)) {
-
-        const int h_count_i = ci->hydro.count;
-        const int h_count_j = cj->hydro.count;
-
-        const int s_count_i = ci->stars.count;
-        const int s_count_j = cj->stars.count;
-
-        int do_sub_hydro = 1;
-        int do_sub_stars_i = 1;
-        int do_sub_stars_j = 1;
-        if (h_count_i > 0 && h_count_j > 0) {
-
-          /* Note: Use division to avoid integer overflow. */
-          do_sub_hydro =
-              h_count_i * sid_scale[sid] < space_subsize_pair_hydro / h_count_j;
-        }
-        if (s_count_i > 0 && h_count_j > 0) {
-
-          /* Note: Use division to avoid integer overflow. */
-          do_sub_stars_i =
-              s_count_i * sid_scale[sid] < space_subsize_pair_stars / h_count_j;
-        }
-        if (s_count_j > 0 && h_count_i > 0) {
-
-          /* Note: Use division to avoid integer overflow. */
-          do_sub_stars_j =
-              s_count_j * sid_scale[sid] < space_subsize_pair_stars / h_count_i;
-        }
+      const enum scheduler_split_decision split =
+          scheduler_split_pair_hydro(ci, cj, sid);
+      if (split == scheduler_split_sub || split == scheduler_split_split) {
 
         /* Replace by a single sub-task? */
-        if (scheduler_dosub &&
-            (do_sub_hydro && do_sub_stars_i && do_sub_stars_j) &&
-            !sort_is_corner(sid)) {
+        if (split == scheduler_split_sub) {
 
           /* Make this task a sub task. */
           t->type = task_type_sub_pair;
@@ -1360,8 +1435,7 @@ static void scheduler_splittask_hydro(struct task *t, struct scheduler *s) {
         }
 
         /* Otherwise, break it up if it is too large? */
-      } else if (scheduler_doforcesplit && ci->split && cj->split &&
-                 (ci->hydro.count > space_maxsize / cj->hydro.count)) {
+      } else if (split == scheduler_split_force) {
         // message( "force splitting pair with %i and %i parts." ,
         // ci->hydro.count , cj->hydro.count );
 
@@ -1422,8 +1496,10 @@ static void scheduler_splittask_gravity(struct task *t, struct scheduler *s) {
       }
 
       /* Should we split this task? */
-      if (cell_can_split_self_gravity_task(ci)) {
-        if (scheduler_dosub && ci->grav.count < space_subsize_self_grav) {
+      const enum scheduler_split_decision split =
+          scheduler_split_self_gravity(ci);
+      if (split != scheduler_split_keep) {
+        if (split == scheduler_split_sub) {
           /* Otherwise, split it. */
         } else {
           /* Take a step back (we're going to recycle the current task)... */
@@ -1694,6 +1770,82 @@ void scheduler_splittasks(struct scheduler *s, const int fof_tasks,
   }
 }
 
+/**
+ * @brief Would scheduler_splittasks() still split a task down to the same
+ * cells?
+ *
+ * Applies the splitting criteria, with the current particle counts and
+ * smoothing lengths, to the cells of the task and to all their parents, which
+ * must have been split for the task to exist. Only the tasks that are split
+ * by scheduler_splittasks() are checked; the others are always valid.
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ *
+ * @return 1 if the task would be made as it is, 0 otherwise.
+ */
+int scheduler_task_split_is_unchanged(const struct scheduler *s,
+                                      const struct task *t) {
+
+  if (t->subtype == task_subtype_external_grav) {
+    if (t->type != task_type_self) return 1;
+
+    const struct cell *c = t->ci;
+    if (scheduler_split_self_gravity(c) == scheduler_split_split) return 0;
+    for (c = c->parent; c != NULL; c = c->parent)
+      if (scheduler_split_self_gravity(c) != scheduler_split_split) return 0;
+    return 1;
+  }
+
+  if (t->subtype != task_subtype_density) return 1;
+
+  struct cell *ci = t->ci;
+  struct cell *cj = t->cj;
+  double shift[3];
+
+  /* The decision for the task itself */
+  switch (t->type) {
+    case task_type_self:
+      if (scheduler_split_self_hydro(ci) != scheduler_split_keep) return 0;
+      break;
+    case task_type_sub_self:
+      if (scheduler_split_self_hydro(ci) != scheduler_split_sub) return 0;
+      break;
+    case task_type_pair:
+    case task_type_sub_pair: {
+      const int sid = space_getsid_and_swap_cells(s->space, &ci, &cj, shift);
+      const enum scheduler_split_decision split =
+          scheduler_split_pair_hydro(ci, cj, sid);
+      if (split != (t->type == task_type_pair ? scheduler_split_keep
+                                               : scheduler_split_sub))
+        return 0;
+      break;
+    }
+    default:
+      return 1;
+  }
+
+  /* The parents must all have been split. A pair of siblings comes from the
+   * self-task of their parent, other pairs from the pair of their parents. */
+  while (ci->parent != NULL) {
+    if (cj == NULL || ci->parent == cj->parent) {
+      ci = ci->parent;
+      cj = NULL;
+      if (scheduler_split_self_hydro(ci) != scheduler_split_split) return 0;
+    } else {
+      ci = ci->parent;
+      cj = cj->parent;
+      const int sid = space_getsid_and_swap_cells(s->space, &ci, &cj, shift);
+      const enum scheduler_split_decision split =
+          scheduler_split_pair_hydro(ci, cj, sid);
+      if (split != scheduler_split_split && split != scheduler_split_force)
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
 /**
  * @brief Add a #task to the #scheduler.
  *
@@ -1732,8 +1884,14 @@ struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
   t->skip = 1; /* Mark tasks as skip by default. */
   t->implicit = implicit;
   t->weight = 0;
+  t->cost = 0.f;
   t->rank = 0;
   t->nr_unlock_tasks = 0;
+#ifdef WITH_MPI
+  t->buff = NULL;
+  t->persistent = task_mpi_persistent_none;
+  t->aggregate = NULL;
+#endif
 #ifdef SWIFT_DEBUG_TASKS
   t->rid = -1;
 #endif
@@ -1918,6 +2076,9 @@ void scheduler_ranktasks(struct scheduler *s) {
  */
 void scheduler_reset(struct scheduler *s, int size) {
 
+  /* The requests of the old tasks cannot be re-used. */
+  scheduler_free_persistent_requests(s);
+
   /* Do we need to re-allocate? */
   if (size > s->size) {
     /* Free existing task lists if necessary. */
@@ -1940,6 +2101,7 @@ void scheduler_reset(struct scheduler *s, int size) {
   /* Reset the counters. */
   s->size = size;
   s->nr_tasks = 0;
+  s->nr_tasks_graph = 0;
   s->tasks_next = 0;
   s->waiting = 0;
   s->nr_unlocks = 0;
@@ -1951,9 +2113,39 @@ void scheduler_reset(struct scheduler *s, int size) {
   for (int k = 0; k < s->nr_queues; k++) s->queues[k].tasks = s->tasks;
 }
 
+/**
+ * @brief Correct the estimated cost of a task with the times measured for
+ * tasks of the same type and sub-type in the previous steps.
+ *
+ * The result is expressed in the same units as the estimates, so that
+ * weights remain comparable to those of tasks without measurements.
+ *
+ * @param s The #scheduler.
+ * @param t The #task.
+ * @param cost The estimated cost of the task.
+ */
+static float scheduler_calibrate_cost(const struct scheduler *s,
+                                      const struct task *t, const float cost) {
+
+  if (s->cost_models == NULL || s->ticks_per_cost <= 0.f) return cost;
+
+  const struct scheduler_cost_model *model =
+      &s->cost_models[t->type * task_subtype_count + t->subtype];
+  if (cost > 0.f && model->ticks_per_cost > 0.f)
+    return cost * model->ticks_per_cost / s->ticks_per_cost;
+  if (cost == 0.f && !t->implicit && model->ticks_per_task > 0.f)
+    return model->ticks_per_task / s->ticks_per_cost;
+  return cost;
+}
+
 /**
  * @brief Compute the task weights
  *
+ * The weight of a task is its own cost plus the weight of the tasks it
+ * unlocks. With #scheduler_flag_cost_model, the costs are corrected using
+ * the measured task times and only the heaviest unlocked task is added, such
+ * that the weight is the length of the critical path starting at the task.
+ *
  * @param s The #scheduler.
  * @param verbose Are we talkative?
  */
@@ -1963,16 +2155,22 @@ void scheduler_reweight(struct scheduler *s, int verbose) {
   struct task *tasks = s->tasks;
   const int nodeID = s->nodeID;
   const float wscale = 0.001f;
+  const int critical_path = (s->flags & scheduler_flag_cost_model);
   const ticks tic = getticks();
 
   /* Run through the tasks backwards and set their weights. */
+  float max_weight = 0.f;
   for (int k = nr_tasks - 1; k >= 0; k--) {
     struct task *t = &tasks[tid[k]];
     float cost = 0.f;
     t->weight = 0.f;
 
-    for (int j = 0; j < t->nr_unlock_tasks; j++)
-      t->weight += t->unlock_tasks[j]->weight;
+    for (int j = 0; j < t->nr_unlock_tasks; j++) {
+      if (critical_path)
+        t->weight = max(t->weight, t->unlock_tasks[j]->weight);
+      else
+        t->weight += t->unlock_tasks[j]->weight;
+    }
 
     const float count_i = (t->ci != NULL) ? t->ci->hydro.count : 0.f;
     const float count_j = (t->cj != NULL) ? t->cj->hydro.count : 0.f;
@@ -2341,9 +2539,14 @@ void scheduler_reweight(struct scheduler *s, int verbose) {
         cost = 0;
         break;
     }
-    t->weight += cost;
+    t->cost = cost;
+    t->weight += scheduler_calibrate_cost(s, t, cost);
+    max_weight = max(max_weight, t->weight);
   }
 
+  if (verbose && critical_path)
+    message("Longest critical path has a weight of %e.", max_weight);
+
   if (verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -2357,6 +2560,618 @@ void scheduler_reweight(struct scheduler *s, int verbose) {
   message( "task weights are in [ %i , %i ]." , min , max ); */
 }
 
+/* Measured times and estimated costs of the tasks run in one step. */
+struct scheduler_cost_sums {
+
+  /* Ticks and estimated cost of the tasks with an estimate. */
+  double ticks[task_type_count * task_subtype_count];
+  double cost[task_type_count * task_subtype_count];
+
+  /* Ticks and number of the tasks without an estimate. */
+  double ticks_no_cost[task_type_count * task_subtype_count];
+  int count_no_cost[task_type_count * task_subtype_count];
+};
+
+/* Extra data of #scheduler_cost_sums_mapper. */
+struct scheduler_cost_sums_data {
+  const struct scheduler *s;
+  ticks tic;
+};
+
+/**
+ * @brief Add the times of the tasks that ran since a given time to a
+ * #scheduler_cost_sums.
+ *
+ * @param s The #scheduler.
+ * @param tic The time at which the tasks were launched.
+ * @param tid The indices of the tasks.
+ * @param num_elements The number of tasks.
+ * @param sums The #scheduler_cost_sums to add to.
+ */
+static void scheduler_cost_sums_add(const struct scheduler *s, const ticks tic,
+                                    const int *tid, const int num_elements,
+                                    struct scheduler_cost_sums *sums) {
+
+  for (int ind = 0; ind < num_elements; ind++) {
+    const struct task *t = &s->tasks[tid[ind]];
+
+    /* Skip the tasks that did not run, and the communications whose times
+     * are dominated by waiting. */
+    if (t->implicit || t->tic < tic || t->toc < t->tic) continue;
+    if (t->type == task_type_send || t->type == task_type_recv) continue;
+
+    const int k = t->type * task_subtype_count + t->subtype;
+    if (t->cost > 0.f) {
+      sums->ticks[k] += t->toc - t->tic;
+      sums->cost[k] += t->cost;
+    } else {
+      sums->ticks_no_cost[k] += t->toc - t->tic;
+      sums->count_no_cost[k] += 1;
+    }
+  }
+}
+
+/**
+ * @brief #threadpool_map function adding the times of the tasks that ran
+ * since a given time to the #scheduler_cost_sums of the calling thread.
+ */
+static void scheduler_cost_sums_mapper(void *map_data, int num_elements,
+                                       void *extra_data) {
+  const struct scheduler_cost_sums_data *data =
+      (struct scheduler_cost_sums_data *)extra_data;
+  scheduler_cost_sums_add(data->s, data->tic, (int *)map_data, num_elements,
+                          &data->s->cost_sums[threadpool_gettid()]);
+}
+
+/**
+ * @brief Blend a new measurement into a learned cost.
+ */
+static float scheduler_cost_model_blend(const float old, const double value) {
+  if (old <= 0.f) return value;
+  return (1.f - scheduler_cost_model_smoothing) * old +
+         scheduler_cost_model_smoothing * value;
+}
+
+/**
+ * @brief Update the learned task costs with the times of the tasks that
+ * ran since a given time.
+ *
+ * Only the active tasks are considered, so this must be called before the
+ * next call to #scheduler_clear_active.
+ *
+ * @param s The #scheduler.
+ * @param tic The time at which the tasks were launched.
+ * @param verbose Are we talkative?
+ */
+void scheduler_update_cost_models(struct scheduler *s, ticks tic,
+                                  int verbose) {
+
+  if (s->cost_models == NULL) return;
+  const ticks tic2 = getticks();
+
+  /* Clear the sums of the previous step in place. */
+  const int nr_sums = s->threadpool->num_threads;
+  bzero(s->cost_sums, nr_sums * sizeof(struct scheduler_cost_sums));
+
+  if (s->active_count > 1000) {
+    struct scheduler_cost_sums_data data = {s, tic};
+    threadpool_map(s->threadpool, scheduler_cost_sums_mapper, s->tid_active,
+                   s->active_count, sizeof(int), threadpool_auto_chunk_size,
+                   &data);
+  } else {
+    scheduler_cost_sums_add(s, tic, s->tid_active, s->active_count,
+                            &s->cost_sums[0]);
+  }
+
+  /* Combine the sums of all the threads into the first one. */
+  struct scheduler_cost_sums *sums = &s->cost_sums[0];
+  for (int i = 1; i < nr_sums; i++) {
+    const struct scheduler_cost_sums *p = &s->cost_sums[i];
+    for (int k = 0; k < task_type_count * task_subtype_count; k++) {
+      sums->ticks[k] += p->ticks[k];
+      sums->cost[k] += p->cost[k];
+      sums->ticks_no_cost[k] += p->ticks_no_cost[k];
+      sums->count_no_cost[k] += p->count_no_cost[k];
+    }
+  }
+
+  /* Blend the measurements of this step into the models. */
+  double total_ticks = 0., total_cost = 0.;
+  int nr_models = 0;
+  for (int k = 0; k < task_type_count * task_subtype_count; k++) {
+    struct scheduler_cost_model *model = &s->cost_models[k];
+    if (sums->cost[k] > 0.) {
+      model->ticks_per_cost = scheduler_cost_model_blend(
+          model->ticks_per_cost, sums->ticks[k] / sums->cost[k]);
+      total_ticks += sums->ticks[k];
+      total_cost += sums->cost[k];
+      nr_models++;
+    }
+    if (sums->count_no_cost[k] > 0) {
+      model->ticks_per_task = scheduler_cost_model_blend(
+          model->ticks_per_task,
+          sums->ticks_no_cost[k] / sums->count_no_cost[k]);
+      nr_models++;
+    }
+  }
+  if (total_cost > 0.)
+    s->ticks_per_cost = scheduler_cost_model_blend(s->ticks_per_cost,
+                                                   total_ticks / total_cost);
+
+  if (verbose)
+    message("Updated %d task cost models, took %.3f %s.", nr_models,
+            clocks_from_ticks(getticks() - tic2), clocks_getunit());
+}
+
+#ifdef WITH_MPI
+
+/* The tag of the aggregated messages. There is only one per sub-type and
+ * pair of ranks at a time and each sub-type has its own communicator. */
+#define scheduler_mpi_aggregate_tag 0
+
+/**
+ * @brief An entry of the offset table at the start of an aggregated message.
+ *
+ * The first entry holds the number of entries that follow and the size of the
+ * whole message. The others hold the tag of each cell and the offset of its
+ * particles from the start of the message.
+ */
+struct scheduler_mpi_aggregate_entry {
+  long long tag;
+  long long offset;
+};
+
+/**
+ * @brief The message aggregating all the gas particle communications of a
+ * sub-type between this rank and another.
+ *
+ * The tasks are the same until the next rebuild but only the ones active at
+ * a step are part of that step's message. Each time-bin keeps its own
+ * persistent request as long as the size of its message does not change.
+ */
+struct scheduler_mpi_aggregate {
+
+  /*! The send or recv tasks, sorted by tag */
+  struct task **tasks;
+
+  /*! The tasks active at this step, in the same order */
+  struct task **active;
+
+  /*! Number of tasks and of active tasks */
+  int nr_tasks, nr_active;
+
+  /*! Type of the tasks (send or recv) */
+  enum task_types type;
+
+  /*! Sub-type of the tasks */
+  enum task_subtypes subtype;
+
+  /*! The rank we exchange with */
+  int rank;
+
+  /*! The message: offset table followed by the particles of each cell */
+  char *buff;
+
+  /*! Size in bytes of the buffer and of this step's message */
+  size_t buff_size, size;
+
+  /*! The time-bin of this step */
+  int bin;
+
+  /*! The request of each time-bin */
+  MPI_Request req[num_time_bins + 1];
+
+  /*! Size of the message of each persistent request, 0 if there is none */
+  size_t req_size[num_time_bins + 1];
+
+  /*! Number of sends still to pack before the message goes */
+  volatile int waiting;
+
+  /*! Has the message of this step been started? Has it arrived? */
+  volatile int started, done;
+
+  /*! Lock protecting the request */
+  swift_lock_type lock;
+};
+
+/**
+ * @brief Is this sub-type one of the gas particle communications?
+ *
+ * @param subtype The #task_subtypes.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_mpi_is_part_comm(
+    const enum task_subtypes subtype) {
+  return subtype == task_subtype_xv || subtype == task_subtype_rho ||
+         subtype == task_subtype_gradient ||
+         subtype == task_subtype_rt_gradient ||
+         subtype == task_subtype_rt_transport ||
+         subtype == task_subtype_part_prep1;
+}
+
+/**
+ * @brief Size in bytes of the particles exchanged by a gas particle send/recv
+ * task.
+ *
+ * @param s The #scheduler.
+ * @param t The send/recv #task.
+ */
+__attribute__((always_inline)) INLINE static size_t scheduler_mpi_part_size(
+    const struct scheduler *s, const struct task *t) {
+  const size_t psize =
+      s->mpi_pack_parts ? cell_pack_parts_size(t->subtype) : 0;
+  return t->ci->hydro.count * (psize > 0 ? psize : sizeof(struct part));
+}
+
+/**
+ * @brief Index of the aggregated message of a task, from its direction,
+ * sub-type and rank, or -1 if the task is not aggregated.
+ *
+ * @param t The #task.
+ * @param nr_nodes The number of ranks.
+ */
+static int scheduler_mpi_aggregate_index(const struct task *t,
+                                         const int nr_nodes) {
+
+  if (!scheduler_mpi_is_part_comm(t->subtype)) return -1;
+
+  if (t->type == task_type_send)
+    return t->subtype * nr_nodes + t->cj->nodeID;
+  else if (t->type == task_type_recv)
+    return (task_subtype_count + t->subtype) * nr_nodes + t->ci->nodeID;
+  else
+    return -1;
+}
+
+/**
+ * @brief Sort function for the tasks of an aggregated message, by tag.
+ */
+static int scheduler_mpi_aggregate_cmp(const void *a, const void *b) {
+  const struct task *ta = *(struct task *const *)a;
+  const struct task *tb = *(struct task *const *)b;
+  return (ta->flags > tb->flags) - (ta->flags < tb->flags);
+}
+
+/**
+ * @brief Release the persistent request of a time-bin of an aggregated
+ * message, if any.
+ *
+ * @param g The #scheduler_mpi_aggregate.
+ * @param bin The time-bin.
+ */
+static void scheduler_mpi_aggregate_free_request(
+    struct scheduler_mpi_aggregate *g, const int bin) {
+
+  if (g->req_size[bin] == 0) return;
+
+  const int err = MPI_Request_free(&g->req[bin]);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to free persistent request.");
+  g->req_size[bin] = 0;
+}
+
+/**
+ * @brief Release all the aggregated messages of the #scheduler.
+ *
+ * @param s The #scheduler.
+ */
+static void scheduler_mpi_aggregate_free(struct scheduler *s) {
+
+  for (int k = 0; k < s->nr_mpi_aggregates; k++) {
+    struct scheduler_mpi_aggregate *g = &s->mpi_aggregates[k];
+    for (int bin = 0; bin <= num_time_bins; bin++)
+      scheduler_mpi_aggregate_free_request(g, bin);
+    if (lock_destroy(&g->lock) != 0)
+      error("Failed to destroy aggregated message lock.");
+    free(g->buff);
+    free(g->tasks);
+    free(g->active);
+  }
+  free(s->mpi_aggregates);
+  s->mpi_aggregates = NULL;
+  s->nr_mpi_aggregates = -1;
+}
+
+/**
+ * @brief Group the gas particle send/recv tasks into one aggregated message
+ * per direction, sub-type and rank.
+ *
+ * @param s The #scheduler.
+ */
+static void scheduler_mpi_aggregate_make(struct scheduler *s) {
+
+  const int nr_nodes = s->space->e->nr_nodes;
+  s->nr_mpi_aggregates = 0;
+  if (!s->mpi_aggregate || nr_nodes == 1) return;
+
+  /* Number the messages that have at least one task. */
+  const int nr_index = 2 * task_subtype_count * nr_nodes;
+  int *index = (int *)malloc(nr_index * sizeof(int));
+  if (index == NULL) error("Failed to allocate aggregated message index.");
+  for (int k = 0; k < nr_index; k++) index[k] = -1;
+
+  for (int k = 0; k < s->nr_tasks; k++) {
+    const int ind = scheduler_mpi_aggregate_index(&s->tasks[k], nr_nodes);
+    if (ind >= 0 && index[ind] < 0) index[ind] = s->nr_mpi_aggregates++;
+  }
+
+  if ((s->mpi_aggregates = (struct scheduler_mpi_aggregate *)calloc(
+           s->nr_mpi_aggregates, sizeof(struct scheduler_mpi_aggregate))) ==
+      NULL)
+    error("Failed to allocate aggregated messages.");
+
+  /* Count their tasks. */
+  for (int k = 0; k < s->nr_tasks; k++) {
+    struct task *t = &s->tasks[k];
+    const int ind = scheduler_mpi_aggregate_index(t, nr_nodes);
+    if (ind < 0) continue;
+
+    struct scheduler_mpi_aggregate *g = &s->mpi_aggregates[index[ind]];
+    g->type = t->type;
+    g->subtype = t->subtype;
+    g->rank = (t->type == task_type_send) ? t->cj->nodeID : t->ci->nodeID;
+    g->nr_tasks++;
+  }
+
+  for (int k = 0; k < s->nr_mpi_aggregates; k++) {
+    struct scheduler_mpi_aggregate *g = &s->mpi_aggregates[k];
+    if ((g->tasks = (struct task **)malloc(g->nr_tasks *
+                                           sizeof(struct task *))) == NULL ||
+        (g->active = (struct task **)malloc(g->nr_tasks *
+                                            sizeof(struct task *))) == NULL)
+      error("Failed to allocate aggregated message tasks.");
+    if (lock_init(&g->lock) != 0)
+      error("Failed to init aggregated message lock.");
+    g->nr_tasks = 0;
+  }
+
+  /* Collect the tasks. */
+  for (int k = 0; k < s->nr_tasks; k++) {
+    struct task *t = &s->tasks[k];
+    const int ind = scheduler_mpi_aggregate_index(t, nr_nodes);
+    if (ind < 0) continue;
+
+    struct scheduler_mpi_aggregate *g = &s->mpi_aggregates[index[ind]];
+    g->tasks[g->nr_tasks++] = t;
+    t->aggregate = g;
+    t->persistent = task_mpi_persistent_aggregate;
+  }
+
+  /* Both ranks list the cells of a message in the same order. */
+  for (int k = 0; k < s->nr_mpi_aggregates; k++) {
+    struct scheduler_mpi_aggregate *g = &s->mpi_aggregates[k];
+    qsort(g->tasks, g->nr_tasks, sizeof(struct task *),
+          scheduler_mpi_aggregate_cmp);
+  }
+
+  free(index);
+}
+
+/**
+ * @brief Start this step's aggregated message.
+ *
+ * The persistent request of the time-bin is re-used if the message has the
+ * same size as the last time, and re-created otherwise.
+ *
+ * @param s The #scheduler.
+ * @param g The #scheduler_mpi_aggregate.
+ */
+static void scheduler_mpi_aggregate_start(const struct scheduler *s,
+                                          struct scheduler_mpi_aggregate *g) {
+
+  MPI_Request *req = &g->req[g->bin];
+  const MPI_Comm comm = subtaskMPI_comms[g->subtype];
+  const int tag = scheduler_mpi_aggregate_tag;
+  int err;
+
+  if (s->mpi_persistent_requests) {
+
+    if (g->req_size[g->bin] != g->size) {
+      scheduler_mpi_aggregate_free_request(g, g->bin);
+
+      if (g->type == task_type_recv) {
+        err = MPI_Recv_init(g->buff, g->size, MPI_BYTE, g->rank, tag, comm,
+                            req);
+      } else if (g->size > s->mpi_message_limit) {
+        err = MPI_Send_init(g->buff, g->size, MPI_BYTE, g->rank, tag, comm,
+                            req);
+      } else {
+        err = MPI_Ssend_init(g->buff, g->size, MPI_BYTE, g->rank, tag, comm,
+                             req);
+      }
+      if (err != MPI_SUCCESS)
+        mpi_error(err, "Failed to create aggregated message request.");
+      g->req_size[g->bin] = g->size;
+    }
+    err = MPI_Start(req);
+
+  } else if (g->type == task_type_recv) {
+    err = MPI_Irecv(g->buff, g->size, MPI_BYTE, g->rank, tag, comm, req);
+  } else if (g->size > s->mpi_message_limit) {
+    err = MPI_Isend(g->buff, g->size, MPI_BYTE, g->rank, tag, comm, req);
+  } else {
+    err = MPI_Issend(g->buff, g->size, MPI_BYTE, g->rank, tag, comm, req);
+  }
+
+  if (err != MPI_SUCCESS)
+    mpi_error(err, "Failed to start aggregated message.");
+
+  /* And log, if logging enabled. */
+  mpiuse_log_allocation(g->type, g->subtype, req, 1, g->size, g->rank, tag);
+
+  g->started = 1;
+}
+
+/**
+ * @brief Lay out this step's aggregated messages.
+ *
+ * Collects the active tasks of each message and the size of their
+ * particles. Sends get their slot in the buffer, after the offset table, and
+ * receives are posted right away.
+ *
+ * @param s The #scheduler.
+ */
+static void scheduler_mpi_aggregate_prepare(struct scheduler *s) {
+
+  if (s->nr_mpi_aggregates < 0) scheduler_mpi_aggregate_make(s);
+
+  int bin = s->space->e->max_active_bin;
+  if (bin < 0 || bin > num_time_bins) bin = num_time_bins;
+
+  for (int k = 0; k < s->nr_mpi_aggregates; k++) {
+    struct scheduler_mpi_aggregate *g = &s->mpi_aggregates[k];
+
+    g->nr_active = 0;
+    g->started = 0;
+    g->done = 0;
+
+    /* Collect the active tasks. */
+    size_t size = 0, full_size = 0;
+    for (int i = 0; i < g->nr_tasks; i++) {
+      struct task *t = g->tasks[i];
+      const size_t part_size = scheduler_mpi_part_size(s, t);
+      full_size += part_size;
+      if (t->skip) continue;
+      g->active[g->nr_active++] = t;
+      size += part_size;
+    }
+    if (g->nr_active == 0) continue;
+
+    size_t offset =
+        (g->nr_active + 1) * sizeof(struct scheduler_mpi_aggregate_entry);
+    g->size = offset + size;
+    g->bin = bin;
+
+    /* Make room for all the tasks. The requests on the old buffer cannot be
+     * re-used. */
+    if (g->size > g->buff_size) {
+      for (int b = 0; b <= num_time_bins; b++)
+        scheduler_mpi_aggregate_free_request(g, b);
+      free(g->buff);
+      g->buff_size =
+          (g->nr_tasks + 1) * sizeof(struct scheduler_mpi_aggregate_entry) +
+          full_size;
+      if ((g->buff = (char *)malloc(g->buff_size)) == NULL)
+        error("Failed to allocate aggregated message buffer.");
+    }
+
+    if (g->type == task_type_recv) {
+      scheduler_mpi_aggregate_start(s, g);
+      continue;
+    }
+
+    /* Write the offset table and give each send its slot. */
+    struct scheduler_mpi_aggregate_entry *table =
+        (struct scheduler_mpi_aggregate_entry *)g->buff;
+    table[0].tag = g->nr_active;
+    table[0].offset = g->size;
+    for (int i = 0; i < g->nr_active; i++) {
+      struct task *t = g->active[i];
+      table[i + 1].tag = t->flags;
+      table[i + 1].offset = offset;
+      t->buff = g->buff + offset;
+      offset += scheduler_mpi_part_size(s, t);
+    }
+    g->waiting = g->nr_active;
+  }
+}
+
+/**
+ * @brief Copy the particles of a send task into its slot of the aggregated
+ * message. The last task of the message to do so sends it.
+ *
+ * @param s The #scheduler.
+ * @param t The send #task.
+ */
+static void scheduler_mpi_aggregate_pack(struct scheduler *s, struct task *t) {
+
+  struct scheduler_mpi_aggregate *g = t->aggregate;
+  const struct cell *c = t->ci;
+  const size_t psize =
+      s->mpi_pack_parts ? cell_pack_parts_size(t->subtype) : 0;
+
+  if (psize > 0) {
+    cell_pack_parts(c, t->subtype, (char *)t->buff);
+    mpiuse_log_packed(c->hydro.count * sizeof(struct part),
+                      c->hydro.count * psize);
+  } else {
+    memcpy(t->buff, c->hydro.parts, c->hydro.count * sizeof(struct part));
+  }
+
+  if (atomic_dec(&g->waiting) == 1) {
+    if (lock_lock(&g->lock) != 0)
+      error("Failed to lock aggregated message.");
+    scheduler_mpi_aggregate_start(s, g);
+    if (lock_unlock(&g->lock) != 0)
+      error("Failed to unlock aggregated message.");
+  }
+}
+
+/**
+ * @brief Point the receive tasks of an aggregated message that has arrived
+ * to their particles, using its offset table.
+ *
+ * @param g The #scheduler_mpi_aggregate.
+ */
+static void scheduler_mpi_aggregate_unpack_table(
+    struct scheduler_mpi_aggregate *g) {
+
+  const struct scheduler_mpi_aggregate_entry *table =
+      (const struct scheduler_mpi_aggregate_entry *)g->buff;
+
+  if (table[0].tag != g->nr_active || (size_t)table[0].offset != g->size)
+    error(
+        "Aggregated %s message from rank %d has %lld cells (%lld bytes) "
+        "instead of %d (%zd bytes).",
+        subtaskID_names[g->subtype], g->rank, table[0].tag, table[0].offset,
+        g->nr_active, g->size);
+
+  for (int i = 0; i < g->nr_active; i++) {
+    struct task *t = g->active[i];
+    if (table[i + 1].tag != t->flags)
+      error("Aggregated %s message from rank %d has cell tag %lld instead of "
+            "%lld.",
+            subtaskID_names[g->subtype], g->rank, table[i + 1].tag, t->flags);
+    t->buff = g->buff + table[i + 1].offset;
+  }
+}
+
+/**
+ * @brief Has this step's aggregated message been sent or received?
+ *
+ * Only one thread at a time tests the request, the others report that the
+ * message is not there yet.
+ *
+ * @param g The #scheduler_mpi_aggregate.
+ *
+ * @return 1 if the communication is complete, 0 otherwise.
+ */
+int scheduler_mpi_aggregate_test(struct scheduler_mpi_aggregate *g) {
+
+  if (g->done) return 1;
+  if (!g->started || lock_trylock(&g->lock) != 0) return 0;
+
+  if (!g->done) {
+    int res = 0;
+    MPI_Status stat;
+    const int err = MPI_Test(&g->req[g->bin], &res, &stat);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to test aggregated message request.");
+
+    if (res) {
+      /* And log deactivation, if logging enabled. */
+      mpiuse_log_allocation(g->type, g->subtype, &g->req[g->bin], 0, 0, 0, 0);
+
+      if (g->type == task_type_recv) scheduler_mpi_aggregate_unpack_table(g);
+      g->done = 1;
+    }
+  }
+
+  if (lock_unlock(&g->lock) != 0)
+    error("Failed to unlock aggregated message.");
+  return g->done;
+}
+
+#endif /* WITH_MPI */
+
 /**
  * @brief #threadpool_map function which runs through the task
  *        graph and re-computes the task wait counters.
@@ -2420,6 +3235,11 @@ void scheduler_start(struct scheduler *s) {
     scheduler_rewait_mapper(s->tid_active, s->active_count, s);
   }
 
+#ifdef WITH_MPI
+  /* Lay out this step's aggregated messages and post their receives. */
+  scheduler_mpi_aggregate_prepare(s);
+#endif
+
   /* Loop over the tasks and enqueue whoever is ready. */
   if (s->active_count > 1000) {
     threadpool_map(s->threadpool, scheduler_enqueue_mapper, s->tid_active,
@@ -2437,6 +3257,157 @@ void scheduler_start(struct scheduler *s) {
   pthread_mutex_unlock(&s->sleep_mutex);
 }
 
+/**
+ * @brief Is this task one of the hydro density, gradient or force loops?
+ *
+ * @param t The #task.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_is_hydro_loop(
+    const struct task *t) {
+  return t->subtype == task_subtype_density ||
+         t->subtype == task_subtype_gradient ||
+         t->subtype == task_subtype_force;
+}
+
+/**
+ * @brief Does this task read or write the #part of its cells?
+ *
+ * @param t The #task.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_task_touches_parts(
+    const struct task *t) {
+
+  switch (t->type) {
+    case task_type_drift_part:
+    case task_type_sort:
+    case task_type_ghost:
+    case task_type_extra_ghost:
+      return 1;
+    case task_type_self:
+    case task_type_sub_self:
+    case task_type_pair:
+    case task_type_sub_pair:
+      return scheduler_is_hydro_loop(t);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Get the queue of the runner that last touched the particles of the
+ * cells of a hydro loop task.
+ *
+ * For pairs, we favour the cell with the most particles as it is the one
+ * with the most data to re-use.
+ *
+ * @param t The #task.
+ *
+ * @return The ID of the #queue or -1 if there is none.
+ */
+__attribute__((always_inline)) INLINE static int scheduler_locality_qid(
+    const struct task *t) {
+
+  if (!scheduler_is_hydro_loop(t)) return -1;
+
+  const struct cell *ci = t->ci->hydro.super;
+  const struct cell *cj = (t->cj != NULL) ? t->cj->hydro.super : NULL;
+  if (ci == NULL) return -1;
+
+  if (cj == NULL || cj->hydro.last_runner < 0 ||
+      (ci->hydro.last_runner >= 0 && ci->hydro.count >= cj->hydro.count))
+    return ci->hydro.last_runner;
+  else
+    return cj->hydro.last_runner;
+}
+
+#ifdef WITH_MPI
+
+/**
+ * @brief Release the persistent MPI request of a send/recv task, if any.
+ *
+ * @param t The #task.
+ */
+static void scheduler_free_persistent_request(struct task *t) {
+
+  if (t->persistent == task_mpi_persistent_none) return;
+
+  /* The request and buffer of an aggregated message belong to the message. */
+  if (t->persistent != task_mpi_persistent_aggregate) {
+    const int err = MPI_Request_free(&t->req);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to free persistent request.");
+  }
+
+  if (t->persistent == task_mpi_persistent_buff) free(t->buff);
+  t->buff = NULL;
+  t->aggregate = NULL;
+  t->persistent = task_mpi_persistent_none;
+}
+
+/**
+ * @brief Start the communication of a send/recv task using a persistent MPI
+ * request.
+ *
+ * The request is created the first time the task is enqueued after a rebuild
+ * and only re-started at the following steps, sparing the MPI library the
+ * set-up of a new message every time.
+ *
+ * @param s The #scheduler.
+ * @param t The send/recv #task.
+ * @param buff The buffer to send from or receive into.
+ * @param count The number of elements to send/receive.
+ * @param type The MPI type of the elements.
+ * @param size The size in bytes of the message.
+ *
+ * @return The MPI error code.
+ */
+static int scheduler_start_persistent(const struct scheduler *s,
+                                      struct task *t, void *buff,
+                                      const size_t count, MPI_Datatype type,
+                                      const size_t size) {
+
+  if (t->persistent == task_mpi_persistent_none) {
+
+    int err;
+    if (t->type == task_type_recv) {
+      err = MPI_Recv_init(buff, count, type, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &t->req);
+    } else if (size > s->mpi_message_limit) {
+      err = MPI_Send_init(buff, count, type, t->cj->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &t->req);
+    } else {
+      err = MPI_Ssend_init(buff, count, type, t->cj->nodeID, t->flags,
+                           subtaskMPI_comms[t->subtype], &t->req);
+    }
+    if (err != MPI_SUCCESS) return err;
+  }
+
+  return MPI_Start(&t->req);
+}
+
+#endif /* WITH_MPI */
+
+/**
+ * @brief Release the persistent MPI requests of all the send/recv tasks.
+ *
+ * Needs to be called before the tasks are re-created or freed.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_free_persistent_requests(struct scheduler *s) {
+#ifdef WITH_MPI
+  scheduler_mpi_aggregate_free(s);
+
+  if (s->tasks == NULL) return;
+
+  for (int k = 0; k < s->nr_tasks; k++) {
+    struct task *t = &s->tasks[k];
+    if (t->type == task_type_send || t->type == task_type_recv)
+      scheduler_free_persistent_request(t);
+  }
+#endif
+}
+
 /**
  * @brief Put a task on one of the queues.
  *
@@ -2490,6 +3461,10 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
         } else {
           qid = t->ci->hydro.super->owner;
           owner = &t->ci->hydro.super->owner;
+          if (s->flags & scheduler_flag_locality) {
+            const int last = scheduler_locality_qid(t);
+            if (last >= 0) qid = last;
+          }
         }
         break;
       case task_type_sort:
@@ -2521,6 +3496,10 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           qid = t->cj->super->owner;
           owner = &t->cj->super->owner;
         }
+        if (s->flags & scheduler_flag_locality) {
+          const int last = scheduler_locality_qid(t);
+          if (last >= 0) qid = last;
+        }
         break;
       case task_type_recv:
 #ifdef WITH_MPI
@@ -2529,6 +3508,14 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
         size_t count = 0;             /* Number of elements to receive */
         MPI_Datatype type = MPI_BYTE; /* Type of the elements */
         void *buff = NULL;            /* Buffer to accept elements */
+        int persistent = 0;           /* Use a persistent request? */
+
+        /* Received within the aggregated message of its rank, which was
+         * posted when the scheduler started. */
+        if (t->aggregate != NULL) {
+          qid = 1 % s->nr_queues;
+          break;
+        }
 
         if (t->subtype == task_subtype_tend) {
 
@@ -2553,10 +3540,28 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
                    t->subtype == task_subtype_rt_transport ||
                    t->subtype == task_subtype_part_prep1) {
 
-          count = t->ci->hydro.count;
-          size = count * sizeof(struct part);
-          type = part_mpi_type;
-          buff = t->ci->hydro.parts;
+          /* Only receive the fields updated since the last exchange? */
+          const size_t psize =
+              s->mpi_pack_parts ? cell_pack_parts_size(t->subtype) : 0;
+
+          /* Have the foreign particles been re-allocated since the
+           * persistent request was created? */
+          if (t->persistent == task_mpi_persistent_parts &&
+              t->buff != t->ci->hydro.parts)
+            scheduler_free_persistent_request(t);
+
+          if (psize > 0) {
+            count = size = t->ci->hydro.count * psize;
+            if (t->persistent == task_mpi_persistent_none)
+              t->buff = malloc(count);
+            buff = t->buff;
+          } else {
+            count = t->ci->hydro.count;
+            size = count * sizeof(struct part);
+            type = part_mpi_type;
+            buff = t->buff = t->ci->hydro.parts;
+          }
+          persistent = s->mpi_persistent_requests;
 
         } else if (t->subtype == task_subtype_limiter) {
 
@@ -2599,8 +3604,15 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           error("Unknown communication sub-type");
         }
 
-        err = MPI_Irecv(buff, count, type, t->ci->nodeID, t->flags,
-                        subtaskMPI_comms[t->subtype], &t->req);
+        if (persistent) {
+          err = scheduler_start_persistent(s, t, buff, count, type, size);
+          t->persistent = (buff == t->ci->hydro.parts)
+                              ? task_mpi_persistent_parts
+                              : task_mpi_persistent_buff;
+        } else {
+          err = MPI_Irecv(buff, count, type, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &t->req);
+        }
 
         if (err != MPI_SUCCESS) {
           mpi_error(err, "Failed to emit irecv for particle data.");
@@ -2623,6 +3635,14 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
         size_t count = 0;             /* Number of elements to send */
         MPI_Datatype type = MPI_BYTE; /* Type of the elements */
         void *buff = NULL;            /* Buffer to send */
+        int persistent = 0;           /* Use a persistent request? */
+
+        /* Sent within the aggregated message of its rank. */
+        if (t->aggregate != NULL) {
+          scheduler_mpi_aggregate_pack(s, t);
+          qid = 0;
+          break;
+        }
 
         if (t->subtype == task_subtype_tend) {
 
@@ -2652,10 +3672,30 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
                    t->subtype == task_subtype_rt_transport ||
                    t->subtype == task_subtype_part_prep1) {
 
-          count = t->ci->hydro.count;
-          size = count * sizeof(struct part);
-          type = part_mpi_type;
-          buff = t->ci->hydro.parts;
+          /* Only send the fields updated since the last exchange? */
+          const size_t psize =
+              s->mpi_pack_parts ? cell_pack_parts_size(t->subtype) : 0;
+
+          /* Have the particles been moved since the persistent request was
+           * created? */
+          if (t->persistent == task_mpi_persistent_parts &&
+              t->buff != t->ci->hydro.parts)
+            scheduler_free_persistent_request(t);
+
+          if (psize > 0) {
+            size = count = t->ci->hydro.count * psize;
+            if (t->persistent == task_mpi_persistent_none)
+              t->buff = malloc(size);
+            buff = t->buff;
+            cell_pack_parts(t->ci, t->subtype, (char *)buff);
+            mpiuse_log_packed(t->ci->hydro.count * sizeof(struct part), size);
+          } else {
+            count = t->ci->hydro.count;
+            size = count * sizeof(struct part);
+            type = part_mpi_type;
+            buff = t->buff = t->ci->hydro.parts;
+          }
+          persistent = s->mpi_persistent_requests;
 
         } else if (t->subtype == task_subtype_limiter) {
 
@@ -2696,7 +3736,12 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           error("Unknown communication sub-type");
         }
 
-        if (size > s->mpi_message_limit) {
+        if (persistent) {
+          err = scheduler_start_persistent(s, t, buff, count, type, size);
+          t->persistent = (buff == t->ci->hydro.parts)
+                              ? task_mpi_persistent_parts
+                              : task_mpi_persistent_buff;
+        } else if (size > s->mpi_message_limit) {
           err = MPI_Isend(buff, count, type, t->cj->nodeID, t->flags,
                           subtaskMPI_comms[t->subtype], &t->req);
         } else {
@@ -2893,6 +3938,86 @@ void scheduler_check_deadlock(struct scheduler *s) {
 #endif
 }
 
+/**
+ * @brief Get the #queue_steal_level of a victim queue as seen from a thief.
+ *
+ * @param s The #scheduler.
+ * @param thief The ID of the #queue of the thief.
+ * @param victim The ID of the #queue of the victim.
+ */
+__attribute__((always_inline)) INLINE static enum queue_steal_level
+scheduler_steal_level(const struct scheduler *s, const int thief,
+                      const int victim) {
+
+  const int *l3 = s->queue_l3_domain;
+  const int *numa = s->queue_numa_node;
+
+  if (l3[thief] >= 0 && l3[thief] == l3[victim] &&
+      numa[thief] == numa[victim])
+    return queue_steal_level_l3;
+  if (numa[thief] >= 0 && numa[thief] == numa[victim])
+    return queue_steal_level_numa;
+  return queue_steal_level_remote;
+}
+
+/**
+ * @brief Steal a task from the other queues.
+ *
+ * Victims are first looked for amongst the queues whose runners share the
+ * thief's L3 cache, then amongst the ones on the same NUMA node and only then
+ * amongst all the others. Within a level, victims are picked at random.
+ *
+ * @param s The #scheduler.
+ * @param qid The ID of the #queue of the thief.
+ * @param prev the previous task that was run.
+ * @param seed The random seed of the thief.
+ *
+ * @return A pointer to a #task or @c NULL if nothing could be stolen.
+ */
+static struct task *scheduler_steal(struct scheduler *s, const int qid,
+                                    const struct task *prev,
+                                    unsigned int *seed) {
+
+  const int nr_queues = s->nr_queues;
+  const int with_deques = s->flags & scheduler_flag_deques;
+  struct queue_stats *stats = &s->queues[qid].stats;
+  struct task *res = NULL;
+  int qids[nr_queues];
+
+  for (int level = 0; level < queue_steal_level_count; level++) {
+
+    /* Collect the non-empty queues at this level. */
+    int count = 0;
+    for (int k = 0; k < nr_queues; k++) {
+      if (with_deques && k == qid) continue;
+      if (scheduler_steal_level(s, qid, k) != (enum queue_steal_level)level)
+        continue;
+      if (s->queues[k].count > 0 || s->queues[k].count_incoming > 0)
+        qids[count++] = k;
+    }
+
+    for (int k = 0; k < scheduler_maxsteal && count > 0; k++) {
+      const int ind = rand_r(seed) % count;
+      struct queue *victim = &s->queues[qids[ind]];
+      atomic_inc(&stats->steal_attempts);
+      TIMER_TIC
+      if (with_deques)
+        res = queue_steal(victim, stats);
+      else
+        res = queue_gettask(victim, prev, 0);
+      TIMER_TOC(timer_qsteal);
+      if (res != NULL) {
+        atomic_inc(&stats->steals[level]);
+        return res;
+      } else if (!with_deques || victim->count == 0) {
+        qids[ind] = qids[--count];
+      }
+    }
+  }
+
+  return NULL;
+}
+
 /**
  * @brief Get a task, preferably from the given queue.
  *
@@ -2926,22 +4051,7 @@ struct task *scheduler_gettask(struct scheduler *s, int qid,
 
       /* If unsuccessful, try stealing from the other queues. */
       if (s->flags & scheduler_flag_steal) {
-        int count = 0, qids[nr_queues];
-        for (int k = 0; k < nr_queues; k++)
-          if (s->queues[k].count > 0 || s->queues[k].count_incoming > 0) {
-            qids[count++] = k;
-          }
-        for (int k = 0; k < scheduler_maxsteal && count > 0; k++) {
-          const int ind = rand_r(&seed) % count;
-          TIMER_TIC
-          res = queue_gettask(&s->queues[qids[ind]], prev, 0);
-          TIMER_TOC(timer_qsteal);
-          if (res != NULL) {
-            break;
-          } else {
-            qids[ind] = qids[--count];
-          }
-        }
+        res = scheduler_steal(s, qid, prev, &seed);
         if (res != NULL) break;
       }
     }
@@ -2966,6 +4076,23 @@ struct task *scheduler_gettask(struct scheduler *s, int qid,
 
   if (res != NULL) {
     scheduler_mark_last_fetch(s);
+
+    /* Record who is about to touch these particles. */
+    if ((s->flags & scheduler_flag_locality) &&
+        scheduler_task_touches_parts(res)) {
+      struct cell *ci = res->ci->hydro.super;
+      struct cell *cj = (res->cj != NULL) ? res->cj->hydro.super : NULL;
+      if (scheduler_is_hydro_loop(res)) {
+        struct queue_stats *stats = &s->queues[qid].stats;
+        atomic_inc(&stats->locality_tasks);
+        if ((ci != NULL && ci->hydro.last_runner == qid) ||
+            (cj != NULL && cj->hydro.last_runner == qid))
+          atomic_inc(&stats->locality_hits);
+      }
+      if (ci != NULL) ci->hydro.last_runner = qid;
+      if (cj != NULL) cj->hydro.last_runner = qid;
+    }
+
     /* Start the timer on this task, if we got one. */
     res->tic = getticks();
 #ifdef SWIFT_DEBUG_TASKS
@@ -3000,7 +4127,10 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
     error("Failed to allocate queues.");
 
   /* Initialize each queue. */
-  for (int k = 0; k < nr_queues; k++) queue_init(&s->queues[k], NULL);
+  const enum queue_engine engine = (flags & scheduler_flag_deques)
+                                       ? queue_engine_deque
+                                       : queue_engine_heap;
+  for (int k = 0; k < nr_queues; k++) queue_init(&s->queues[k], NULL, engine);
 
   /* Init the sleep mutex and cond. */
   if (pthread_cond_init(&s->sleep_cond, NULL) != 0 ||
@@ -3017,6 +4147,29 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
   s->nr_unlocks = 0;
   s->size_unlocks = scheduler_init_nr_unlocks;
 
+  /* Without further information, all the queues are remote to each other. */
+  if ((s->queue_l3_domain = (int *)malloc(sizeof(int) * nr_queues)) == NULL ||
+      (s->queue_numa_node = (int *)malloc(sizeof(int) * nr_queues)) == NULL)
+    error("Failed to allocate queue topology.");
+  for (int k = 0; k < nr_queues; k++) {
+    s->queue_l3_domain[k] = -1;
+    s->queue_numa_node[k] = -1;
+  }
+
+  /* Nothing is known yet about the cost of the tasks. */
+  s->cost_models = NULL;
+  s->cost_sums = NULL;
+  s->ticks_per_cost = 0.f;
+  if (flags & scheduler_flag_cost_model) {
+    if ((s->cost_models = (struct scheduler_cost_model *)calloc(
+             task_type_count * task_subtype_count,
+             sizeof(struct scheduler_cost_model))) == NULL)
+      error("Failed to allocate task cost models.");
+    if ((s->cost_sums = (struct scheduler_cost_sums *)calloc(
+             tp->num_threads, sizeof(struct scheduler_cost_sums))) == NULL)
+      error("Failed to allocate task cost sums.");
+  }
+
   /* Set the scheduler variables. */
   s->nr_queues = nr_queues;
   s->flags = flags;
@@ -3028,6 +4181,10 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
   s->size = 0;
   s->tasks = NULL;
   s->tasks_ind = NULL;
+#ifdef WITH_MPI
+  s->mpi_aggregates = NULL;
+  s->nr_mpi_aggregates = -1;
+#endif
   scheduler_reset(s, nr_tasks);
 
 #if defined(SWIFT_DEBUG_CHECKS)
@@ -3036,6 +4193,32 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
 #endif
 }
 
+/**
+ * @brief Tell the #scheduler where in the machine its queues live.
+ *
+ * This is used to prefer stealing from queues that are close to the thief.
+ *
+ * @param s The #scheduler.
+ * @param l3_domain The L3 cache domain of each queue (-1 if unknown).
+ * @param numa_node The NUMA node of each queue (-1 if unknown).
+ * @param verbose Are we talkative?
+ */
+void scheduler_set_topology(struct scheduler *s, const int *l3_domain,
+                            const int *numa_node, const int verbose) {
+
+  int nr_l3 = 0, nr_numa = 0;
+  for (int k = 0; k < s->nr_queues; k++) {
+    s->queue_l3_domain[k] = l3_domain[k];
+    s->queue_numa_node[k] = numa_node[k];
+    nr_l3 = max(nr_l3, l3_domain[k] + 1);
+    nr_numa = max(nr_numa, numa_node[k] + 1);
+  }
+
+  if (verbose)
+    message("Task queues span %d L3 domain(s) over %d NUMA node(s).", nr_l3,
+            nr_numa);
+}
+
 /**
  * @brief Prints the list of tasks to a file
  *
@@ -3070,12 +4253,17 @@ void scheduler_clean(struct scheduler *s) {
   swift_free("unlock_ind", s->unlock_ind);
   for (int i = 0; i < s->nr_queues; ++i) queue_clean(&s->queues[i]);
   swift_free("queues", s->queues);
+  free(s->queue_l3_domain);
+  free(s->queue_numa_node);
+  free(s->cost_models);
+  free(s->cost_sums);
 }
 
 /**
  * @brief Free the task arrays allocated by this #scheduler.
  */
 void scheduler_free_tasks(struct scheduler *s) {
+  scheduler_free_persistent_requests(s);
   if (s->tasks != NULL) {
     swift_free("tasks", s->tasks);
     s->tasks = NULL;
@@ -3090,6 +4278,7 @@ void scheduler_free_tasks(struct scheduler *s) {
   }
   s->size = 0;
   s->nr_tasks = 0;
+  s->nr_tasks_graph = 0;
 }
 
 /**
@@ -3259,3 +4448,46 @@ void scheduler_report_task_times(const struct scheduler *s,
   message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
           clocks_getunit());
 }
+
+/**
+ * @brief Display the traffic through the task queues since the last call
+ * and reset the counters.
+ *
+ * @param s The #scheduler.
+ */
+void scheduler_report_queue_stats(struct scheduler *s) {
+
+  struct queue_stats total = {0};
+  for (int k = 0; k < s->nr_queues; k++) {
+    const struct queue_stats *stats = &s->queues[k].stats;
+    total.pops += stats->pops;
+    total.requeues += stats->requeues;
+    total.steal_attempts += stats->steal_attempts;
+    for (int l = 0; l < queue_steal_level_count; l++)
+      total.steals[l] += stats->steals[l];
+    total.steal_conflicts += stats->steal_conflicts;
+    total.locality_hits += stats->locality_hits;
+    total.locality_tasks += stats->locality_tasks;
+    queue_stats_reset(&s->queues[k]);
+  }
+
+  message("*** Task queues (%s engine, %d queues):",
+          queue_engine_names[s->queues[0].engine], s->nr_queues);
+  long long steals = 0;
+  for (int l = 0; l < queue_steal_level_count; l++) steals += total.steals[l];
+  message("*** %20s: %lld", "local pops", total.pops);
+  message("*** %20s: %lld (%.2f %% successful)", "steal attempts",
+          total.steal_attempts,
+          total.steal_attempts > 0 ? 100. * steals / (double)total.steal_attempts
+                                   : 0.);
+  for (int l = 0; l < queue_steal_level_count; l++)
+    message("*** %20s: %lld", queue_steal_level_names[l], total.steals[l]);
+  message("*** %20s: %lld", "steal conflicts", total.steal_conflicts);
+  message("*** %20s: %lld", "lock-fail requeues", total.requeues);
+  if (s->flags & scheduler_flag_locality)
+    message("*** %20s: %lld / %lld (%.2f %%)", "hydro cell re-use",
+            total.locality_hits, total.locality_tasks,
+            total.locality_tasks > 0
+                ? 100. * total.locality_hits / (double)total.locality_tasks
+                : 0.);
+}
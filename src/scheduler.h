@@ -53,11 +53,28 @@
 /* Flags . */
 #define scheduler_flag_none 0
 #define scheduler_flag_steal (1 << 1)
+#define scheduler_flag_deques (1 << 2)
+#define scheduler_flag_locality (1 << 3)
+#define scheduler_flag_cost_model (1 << 4)
+#define scheduler_flag_keep_tasks (1 << 5)
+
+/* Weight of the latest step in the learned task costs. */
+#define scheduler_cost_model_smoothing 0.5f
 
 #ifdef SWIFT_DEBUG_CHECKS
 extern int activate_by_unskip;
 #endif
 
+/* Cost of a task type and sub-type, learned from the measured task times. */
+struct scheduler_cost_model {
+
+  /* Ticks per unit of estimated cost, 0 if unknown. */
+  float ticks_per_cost;
+
+  /* Ticks per task for the tasks without an estimated cost, 0 if unknown. */
+  float ticks_per_task;
+};
+
 /* Data of a scheduler. */
 struct scheduler {
   /* Scheduler flags. */
@@ -69,9 +86,18 @@ struct scheduler {
   /* Array of queues. */
   struct queue *queues;
 
+  /* L3 cache domain and NUMA node of the runner(s) using each queue, -1 if
+   * unknown. */
+  int *queue_l3_domain;
+  int *queue_numa_node;
+
   /* Total number of tasks. */
   int nr_tasks, size, tasks_next;
 
+  /* Number of tasks made by the last engine_maketasks(), 0 if the graph
+   * has been freed since. */
+  int nr_tasks_graph;
+
   /* Total number of waiting tasks. */
   int waiting;
 
@@ -110,9 +136,36 @@ struct scheduler {
    * MPI. */
   size_t mpi_message_limit;
 
+  /* Only exchange the fields of the gas particles updated by each loop? */
+  int mpi_pack_parts;
+
+  /* Use persistent MPI requests for the gas particle communications? */
+  int mpi_persistent_requests;
+
+  /* Send all the gas particle communications of a sub-type to a rank as one
+   * message? */
+  int mpi_aggregate;
+
+#ifdef WITH_MPI
+  /* The aggregated messages, one per rank, sub-type and direction. */
+  struct scheduler_mpi_aggregate *mpi_aggregates;
+
+  /* Number of aggregated messages, -1 if not made since the last reset. */
+  int nr_mpi_aggregates;
+#endif
+
   /* Total ticks spent running the tasks */
   ticks total_ticks;
 
+  /* Learned cost of each task type and sub-type, NULL if not used. */
+  struct scheduler_cost_model *cost_models;
+
+  /* Per-thread sums of the measured task times, NULL if not used. */
+  struct scheduler_cost_sums *cost_sums;
+
+  /* Ticks per unit of estimated cost over all the tasks, 0 if unknown. */
+  float ticks_per_cost;
+
   struct {
     /* Total ticks spent waiting for runners to come home. */
     ticks waiting_ticks;
@@ -303,11 +356,14 @@ void scheduler_start(struct scheduler *s);
 void scheduler_reset(struct scheduler *s, int nr_tasks);
 void scheduler_ranktasks(struct scheduler *s);
 void scheduler_reweight(struct scheduler *s, int verbose);
+void scheduler_update_cost_models(struct scheduler *s, ticks tic, int verbose);
 struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
                                enum task_subtypes subtype, long long flags,
                                int implicit, struct cell *ci, struct cell *cj);
 void scheduler_splittasks(struct scheduler *s, const int fof_tasks,
                           const int verbose);
+int scheduler_task_split_is_unchanged(const struct scheduler *s,
+                                      const struct task *t);
 struct task *scheduler_done(struct scheduler *s, struct task *t);
 struct task *scheduler_unlock(struct scheduler *s, struct task *t);
 void scheduler_addunlock(struct scheduler *s, struct task *ta, struct task *tb);
@@ -316,6 +372,10 @@ void scheduler_dump_queue(struct scheduler *s);
 void scheduler_print_tasks(const struct scheduler *s, const char *fileName);
 void scheduler_clean(struct scheduler *s);
 void scheduler_free_tasks(struct scheduler *s);
+void scheduler_free_persistent_requests(struct scheduler *s);
+#ifdef WITH_MPI
+int scheduler_mpi_aggregate_test(struct scheduler_mpi_aggregate *g);
+#endif
 void scheduler_write_dependencies(struct scheduler *s, int verbose, int step);
 void scheduler_write_cell_dependencies(struct scheduler *s, int verbose,
                                        int step);
@@ -323,5 +383,8 @@ void scheduler_write_task_level(const struct scheduler *s, int step);
 void scheduler_dump_queues(struct engine *e);
 void scheduler_report_task_times(const struct scheduler *s,
                                  const int nr_threads);
+void scheduler_report_queue_stats(struct scheduler *s);
+void scheduler_set_topology(struct scheduler *s, const int *l3_domain,
+                            const int *numa_node, const int verbose);
 
 #endif /* SWIFT_SCHEDULER_H */
@@ -26,6 +26,7 @@
 /* Some standard headers. */
 #include <hdf5.h>
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -54,8 +55,10 @@
 #include "output_options.h"
 #include "part.h"
 #include "part_type.h"
+#include "partial_io.h"
 #include "rt_io.h"
 #include "sink_io.h"
+#include "snapshot_async.h"
 #include "star_formation_io.h"
 #include "stars_io.h"
 #include "tools.h"
@@ -66,12 +69,193 @@
 /* Max number of entries that can be written for a given particle type */
 static const int io_max_size_output_list = 100;
 
+/*! Maximal size of the chunks in which the particle arrays are read */
+static size_t io_read_chunk_max_bytes = 128 * 1024 * 1024;
+
+/**
+ * @brief Set the maximal size of the chunks in which read_ic_single() reads
+ * the particle arrays.
+ *
+ * The default is 128 MB. Smaller values are only useful for testing.
+ *
+ * @param bytes The maximal size of a chunk in bytes.
+ */
+void read_ic_single_set_chunk_size(const size_t bytes) {
+  io_read_chunk_max_bytes = bytes;
+}
+
+/**
+ * @brief A chunk of a particle array to read from an HDF5 dataset.
+ */
+struct read_array_chunk {
+
+  /*! The dataset and its data space in the file */
+  hid_t h_data, h_filespace;
+
+  /*! The HDF5 type of the data in memory */
+  hid_t h_type;
+
+  /*! The ranges of particles of the file to read from */
+  const struct partial_io_range* ranges;
+  size_t nr_ranges;
+
+  /*! The first particle (in the ranges) and number of particles to read */
+  size_t first, count;
+
+  /*! The number of elements per particle */
+  int dimension;
+
+  /*! Where to store the data */
+  void* buffer;
+
+  /*! Time spent in HDF5 reading the chunks */
+  ticks time;
+
+  /*! Name of the field (for error messages) */
+  const char* name;
+};
+
+/**
+ * @brief Read a chunk of a particle array.
+ *
+ * Can be run by a separate thread as long as no other thread calls HDF5
+ * at the same time.
+ *
+ * @param arg The #read_array_chunk.
+ */
+static void* read_array_single_chunk(void* arg) {
+
+  struct read_array_chunk* c = (struct read_array_chunk*)arg;
+  const ticks tic = getticks();
+
+  /* Select the particles of the chunk in the file */
+  partial_io_select_hyperslab(c->h_filespace, c->ranges, c->nr_ranges,
+                              c->first, c->count);
+
+  /* And read them contiguously in memory */
+  const hsize_t shape = c->count * c->dimension;
+  const hid_t h_memspace = H5Screate_simple(1, &shape, NULL);
+  const herr_t h_err = H5Dread(c->h_data, c->h_type, h_memspace,
+                               c->h_filespace, H5P_DEFAULT, c->buffer);
+  if (h_err < 0) error("Error while reading data array '%s'.", c->name);
+  H5Sclose(h_memspace);
+
+  c->time += getticks() - tic;
+  return NULL;
+}
+
+/**
+ * @brief Data needed to convert and copy a chunk of array to the particles.
+ */
+struct read_array_copy_data {
+
+  /*! The #io_props of the field, pointing at the first particle of the
+   * chunk */
+  struct io_props props;
+
+  /*! The buffer containing the chunk */
+  char* buffer;
+
+  /*! Size of the field of one particle */
+  size_t copySize;
+
+  /*! Conversion factors to apply (1 if none) */
+  double unit_factor, h_factor, vel_factor;
+};
+
+/**
+ * @brief Convert the units of a chunk of particle array and copy it to the
+ * particles.
+ *
+ * @param map_data The part of the buffer to treat.
+ * @param num_elements The number of particles to treat.
+ * @param extra_data The #read_array_copy_data.
+ */
+static void read_array_single_copy_mapper(void* map_data, int num_elements,
+                                          void* extra_data) {
+
+  const struct read_array_copy_data* data =
+      (const struct read_array_copy_data*)extra_data;
+  const struct io_props* props = &data->props;
+  const size_t copySize = data->copySize;
+  const size_t offset = ((char*)map_data - data->buffer) / copySize;
+  const size_t num_values = (size_t)num_elements * props->dimension;
+
+  /* Convert the units if necessary (only floating-point fields can be) */
+  if (data->unit_factor != 1. || data->h_factor != 1. ||
+      data->vel_factor != 1.) {
+    if (io_is_double_precision(props->type)) {
+      double* temp_d = (double*)map_data;
+
+      /* Unit conversion if necessary */
+      if (data->unit_factor != 1.)
+        for (size_t i = 0; i < num_values; ++i) temp_d[i] *= data->unit_factor;
+
+      /* Clean-up h if necessary */
+      if (data->h_factor != 1.)
+        for (size_t i = 0; i < num_values; ++i) temp_d[i] *= data->h_factor;
+
+      /* Clean-up a if necessary */
+      if (data->vel_factor != 1.)
+        for (size_t i = 0; i < num_values; ++i) temp_d[i] *= data->vel_factor;
+
+    } else {
+      float* temp_f = (float*)map_data;
+
+      /* Unit conversion if necessary */
+      if (data->unit_factor != 1.) {
+        for (size_t i = 0; i < num_values; ++i) {
+
+#ifdef SWIFT_DEBUG_CHECKS
+          /* The two possible errors: larger than float or smaller
+           * than float precision. */
+          const float abstemp_f = fabsf(temp_f[i]);
+          if (abstemp_f != 0.f) {
+            if (data->unit_factor * abstemp_f > FLT_MAX)
+              error("Unit conversion results in numbers larger than floats");
+            else if (data->unit_factor * abstemp_f < FLT_MIN)
+              error("Numbers smaller than float precision");
+          }
+#endif
+
+          /* Convert the float units */
+          temp_f[i] *= data->unit_factor;
+        }
+      }
+
+      /* Clean-up h if necessary */
+      if (data->h_factor != 1.) {
+        const float h_factor = data->h_factor;
+        for (size_t i = 0; i < num_values; ++i) temp_f[i] *= h_factor;
+      }
+
+      /* Clean-up a if necessary */
+      if (data->vel_factor != 1.) {
+        const float vel_factor = data->vel_factor;
+        for (size_t i = 0; i < num_values; ++i) temp_f[i] *= vel_factor;
+      }
+    }
+  }
+
+  /* Copy temporary buffer to particle data */
+  const char* temp_c = (const char*)map_data;
+  for (int i = 0; i < num_elements; ++i)
+    memcpy(props->field + (offset + i) * props->partSize, &temp_c[i * copySize],
+           copySize);
+}
+
 /**
  * @brief Reads a data array from a given HDF5 group.
  *
+ * The array is read in chunks. While the thread pool converts the units of a
+ * chunk and copies it to the particles, the next chunk is read by a separate
+ * thread.
+ *
  * @param h_grp The group from which to read.
  * @param prop The #io_props of the field to read
  * @param N The number of particles.
+ * @param ranges The #partial_io_range of particles to read (NULL for all).
+ * @param nr_ranges The number of ranges.
  * @param internal_units The #unit_system used internally
  * @param ic_units The #unit_system used in the ICs
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -79,18 +263,22 @@ static const int io_max_size_output_list = 100;
  * IC velocities?
  * @param h The value of the reduced Hubble constant.
  * @param a The current value of the scale-factor.
- *
- * @todo A better version using HDF5 hyper-slabs to read the file directly into
- * the part array will be written once the structures have been stabilized.
+ * @param tp The #threadpool used to convert and copy the data.
+ * @param read_time (return) Incremented by the time spent reading the file.
+ * @param copy_time (return) Incremented by the time spent converting and
+ * copying the data.
  */
 void read_array_single(hid_t h_grp, const struct io_props props, size_t N,
+                       const struct partial_io_range* ranges,
+                       const size_t nr_ranges,
                        const struct unit_system* internal_units,
                        const struct unit_system* ic_units, int cleanup_h,
-                       int cleanup_sqrt_a, double h, double a) {
+                       int cleanup_sqrt_a, double h, double a,
+                       struct threadpool* tp, ticks* read_time,
+                       ticks* copy_time) {
 
   const size_t typeSize = io_sizeof_type(props.type);
   const size_t copySize = typeSize * props.dimension;
-  const size_t num_elements = N * props.dimension;
 
   /* Check whether the dataspace exists or not */
   const htri_t exist = H5Lexists(h_grp, props.name, 0);
@@ -100,16 +288,7 @@ void read_array_single(hid_t h_grp, const struct io_props props, size_t N,
     if (props.importance == COMPULSORY) {
       error("Compulsory data set '%s' not present in the file.", props.name);
     } else {
-
-      /* Create a single instance of the default value */
-      float* temp = (float*)malloc(copySize);
-      for (int i = 0; i < props.dimension; ++i) temp[i] = props.default_value;
-
-      /* Copy it everywhere in the particle array */
-      for (size_t i = 0; i < N; ++i)
-        memcpy(props.field + i * props.partSize, temp, copySize);
-
-      free(temp);
+      partial_io_fill_default(&props, N);
       return;
     }
   }
@@ -118,107 +297,99 @@ void read_array_single(hid_t h_grp, const struct io_props props, size_t N,
   /*         props.importance == COMPULSORY ? "compulsory" : "optional  ", */
   /*         props.name); */
 
+  if (N == 0) return;
+
   /* Open data space */
   const hid_t h_data = H5Dopen(h_grp, props.name, H5P_DEFAULT);
   if (h_data < 0) error("Error while opening data space '%s'.", props.name);
-
-  /* Allocate temporary buffer */
-  void* temp = malloc(num_elements * typeSize);
-  if (temp == NULL) error("Unable to allocate memory for temporary buffer");
-
-  /* Read HDF5 dataspace in temporary buffer */
-  /* Dirty version that happens to work for vectors but should be improved */
-  /* Using HDF5 dataspaces would be better */
-  const hid_t h_err = H5Dread(h_data, io_hdf5_type(props.type), H5S_ALL,
-                              H5S_ALL, H5P_DEFAULT, temp);
-  if (h_err < 0) error("Error while reading data array '%s'.", props.name);
-
-  /* Unit conversion if necessary */
-  const double unit_factor =
+  const hid_t h_filespace = H5Dget_space(h_data);
+  if (h_filespace < 0)
+    error("Error while getting data space '%s'.", props.name);
+
+  /* Read all the particles if no ranges were given */
+  const struct partial_io_range all = {0, (long long)N};
+  const struct partial_io_range* read_ranges = ranges ? ranges : &all;
+  const size_t read_nr_ranges = ranges ? nr_ranges : 1;
+
+  /* Conversion factors to apply to the values read */
+  struct read_array_copy_data copy;
+  copy.copySize = copySize;
+  copy.unit_factor =
       units_conversion_factor(ic_units, internal_units, props.units);
-  if (unit_factor != 1. && exist != 0) {
-
-    /* message("Converting ! factor=%e", factor); */
-
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= unit_factor;
-
-    } else {
-      float* temp_f = (float*)temp;
-
-#ifdef SWIFT_DEBUG_CHECKS
-      float maximum = 0.f;
-      float minimum = FLT_MAX;
-#endif
-
-      /* Loop that converts the Units */
-      for (size_t i = 0; i < num_elements; ++i) {
-
-#ifdef SWIFT_DEBUG_CHECKS
-        /* Find the absolute minimum and maximum values */
-        const float abstemp_f = fabsf(temp_f[i]);
-        if (abstemp_f != 0.f) {
-          maximum = max(maximum, abstemp_f);
-          minimum = min(minimum, abstemp_f);
-        }
-#endif
-
-        /* Convert the float units */
-        temp_f[i] *= unit_factor;
-      }
-
-#ifdef SWIFT_DEBUG_CHECKS
-      /* The two possible errors: larger than float or smaller
-       * than float precision. */
-      if (unit_factor * maximum > FLT_MAX) {
-        error("Unit conversion results in numbers larger than floats");
-      } else if (unit_factor * minimum < FLT_MIN) {
-        error("Numbers smaller than float precision");
-      }
-#endif
-    }
-  }
-
-  /* Clean-up h if necessary */
   const float h_factor_exp = units_h_factor(internal_units, props.units);
-  if (cleanup_h && h_factor_exp != 0.f && exist != 0) {
+  copy.h_factor =
+      (cleanup_h && h_factor_exp != 0.f) ? pow(h, h_factor_exp) : 1.;
+  copy.vel_factor =
+      (cleanup_sqrt_a && a != 1. && (strcmp(props.name, "Velocities") == 0))
+          ? sqrt(a)
+          : 1.;
+
+  /* Allocate temporary buffers (two of them if we need several chunks) */
+  const size_t chunk_size = max(io_read_chunk_max_bytes / copySize, (size_t)1);
+  const size_t buffer_size = min(N, chunk_size);
+  char* temp[2] = {NULL, NULL};
+  for (int k = 0; k < (N > chunk_size ? 2 : 1); ++k) {
+    temp[k] = (char*)malloc(buffer_size * copySize);
+    if (temp[k] == NULL)
+      error("Unable to allocate memory for temporary buffer");
+  }
 
-    /* message("Multipltying '%s' by h^%f=%f", props.name, h_factor_exp,
-     * h_factor); */
+  struct read_array_chunk chunks[2];
+  for (int k = 0; k < 2; ++k) {
+    chunks[k].h_data = h_data;
+    chunks[k].h_filespace = h_filespace;
+    chunks[k].h_type = io_hdf5_type(props.type);
+    chunks[k].ranges = read_ranges;
+    chunks[k].nr_ranges = read_nr_ranges;
+    chunks[k].dimension = props.dimension;
+    chunks[k].buffer = temp[k];
+    chunks[k].time = 0;
+    chunks[k].name = props.name;
+  }
 
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= h_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float h_factor = pow(h, h_factor_exp);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= h_factor;
+  /* Read the first chunk */
+  chunks[0].first = 0;
+  chunks[0].count = buffer_size;
+  read_array_single_chunk(&chunks[0]);
+
+  int current = 0;
+  for (size_t first = 0; first < N; first += chunk_size) {
+
+    const size_t count = min(chunk_size, N - first);
+
+    /* Start reading the next chunk, if any */
+    pthread_t reader;
+    const int read_next = first + count < N;
+    if (read_next) {
+      struct read_array_chunk* next = &chunks[1 - current];
+      next->first = first + count;
+      next->count = min(chunk_size, N - next->first);
+      if (pthread_create(&reader, NULL, read_array_single_chunk, next) != 0)
+        error("Failed to create the thread reading '%s'.", props.name);
     }
-  }
 
-  /* Clean-up a if necessary */
-  if (cleanup_sqrt_a && a != 1. && (strcmp(props.name, "Velocities") == 0)) {
+    /* Convert and copy the current one */
+    const ticks tic = getticks();
+    copy.props = props;
+    copy.props.field += first * props.partSize;
+    copy.buffer = temp[current];
+    threadpool_map(tp, read_array_single_copy_mapper, temp[current], count,
+                   copySize, threadpool_auto_chunk_size, &copy);
+    *copy_time += getticks() - tic;
 
-    if (io_is_double_precision(props.type)) {
-      double* temp_d = (double*)temp;
-      const double vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_d[i] *= vel_factor;
-    } else {
-      float* temp_f = (float*)temp;
-      const float vel_factor = sqrt(a);
-      for (size_t i = 0; i < num_elements; ++i) temp_f[i] *= vel_factor;
-    }
+    /* Wait for the next one to be ready */
+    if (read_next && pthread_join(reader, NULL) != 0)
+      error("Failed to join the thread reading '%s'.", props.name);
+
+    current = 1 - current;
   }
 
-  /* Copy temporary buffer to particle data */
-  char* temp_c = (char*)temp;
-  for (size_t i = 0; i < N; ++i)
-    memcpy(props.field + i * props.partSize, &temp_c[i * copySize], copySize);
+  *read_time += chunks[0].time + chunks[1].time;
 
   /* Free and close everything */
-  free(temp);
+  free(temp[0]);
+  free(temp[1]);
+  H5Sclose(h_filespace);
   H5Dclose(h_data);
 }
 
@@ -340,10 +511,15 @@ void write_array_single(const struct engine* e, hid_t grp, const char* fileName,
                                  h_prop, H5P_DEFAULT);
   if (h_data < 0) error("Error while creating dataspace '%s'.", props.name);
 
-  /* Write temporary buffer to HDF5 dataspace */
-  h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
-                   H5P_DEFAULT, temp);
-  if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  /* Write temporary buffer to HDF5 dataspace, or leave it to the thread
+   * writing the file in the background */
+  const int deferred =
+      snapshot_async_defer_write(h_data, io_hdf5_type(props.type), temp);
+  if (!deferred) {
+    h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
+                     H5P_DEFAULT, temp);
+    if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  }
 
   /* Write XMF description for this data set */
   if (xmfFile != NULL)
@@ -390,7 +566,7 @@ void write_array_single(const struct engine* e, hid_t grp, const char* fileName,
   io_write_attribute_s(h_data, "Description", props.description);
 
   /* Free and close everything */
-  swift_free("writebuff", temp);
+  if (!deferred) swift_free("writebuff", temp);
   H5Tclose(h_type);
   H5Pclose(h_prop);
   H5Dclose(h_data);
@@ -432,6 +608,9 @@ void write_array_single(const struct engine* e, hid_t grp, const char* fileName,
  * @param dry_run If 1, don't read the particle. Only allocates the arrays.
  * @param remap_ids Are we ignoring the ICs' IDs and remapping them to [1, N[ ?
  * @param ics_metadata Will store metadata group copied from the ICs file
+ * @param selection The #partial_io_selection of particles and fields to read
+ * (NULL to read everything).
+ * @param verbose Are we talkative about the time spent in each phase?
  *
  * Opens the HDF5 file fileName and reads the particles contained
  * in the parts array. N is the returned number of particles found
@@ -450,8 +629,10 @@ void read_ic_single(
     const int with_stars, const int with_black_holes, const int with_cosmology,
     const int cleanup_h, const int cleanup_sqrt_a, const double h,
     const double a, const int n_threads, const int dry_run, const int remap_ids,
-    struct ic_info* ics_metadata) {
+    struct ic_info* ics_metadata, const struct partial_io_selection* selection,
+    const int verbose) {
 
+  ticks tic = getticks();
   hid_t h_file = 0, h_grp = 0;
   /* GADGET has only cubic boxes (in cosmological mode) */
   double boxSize[3] = {0.0, -1.0, -1.0};
@@ -541,6 +722,18 @@ void read_ic_single(
   /* message("Found %d particles in a %speriodic box of size [%f %f %f].",  */
   /* 	  *N, (periodic ? "": "non-"), dim[0], dim[1], dim[2]);  */
 
+  /* Restrict the read to the selected particles */
+  struct partial_io_range* ranges[swift_type_count] = {NULL};
+  size_t nr_ranges[swift_type_count] = {0};
+  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+    const long long N_file = N[ptype];
+    N[ptype] = partial_io_select_particles(h_file, selection, ptype, N_file,
+                                           &ranges[ptype], &nr_ranges[ptype]);
+    if (partial_io_selection_is_active(selection) && N_file > 0)
+      message("Reading %zd of the %lld particles of type %s.", N[ptype],
+              N_file, part_type_names[ptype]);
+  }
+
   /* Close header */
   H5Gclose(h_grp);
 
@@ -587,6 +780,11 @@ void read_ic_single(
     dim[j] *=
         units_conversion_factor(ic_units, internal_units, UNIT_CONV_LENGTH);
 
+  if (verbose)
+    message("Reading the header and meta-data took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+  tic = getticks();
+
   /* Allocate memory to store SPH particles */
   if (with_hydro) {
     *Ngas = N[swift_type_gas];
@@ -648,6 +846,16 @@ void read_ic_single(
   /* message("BoxSize = %lf", dim[0]); */
   /* message("NumPart = [%zd, %zd] Total = %zd", *Ngas, Ndm, *Ngparts); */
 
+  if (verbose)
+    message("Allocating the particle arrays took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+  tic = getticks();
+
+  /* Let's initialise a bit of thread parallelism here */
+  struct threadpool tp;
+  if (!dry_run) threadpool_init(&tp, n_threads);
+  ticks read_time = 0, copy_time = 0;
+
   /* Loop over all particle types */
   for (int ptype = 0; ptype < swift_type_count; ptype++) {
 
@@ -736,25 +944,38 @@ void read_ic_single(
         /* If we are remapping ParticleIDs later, don't need to read them. */
         if (remap_ids && strcmp(list[i].name, "ParticleIDs") == 0) continue;
 
+        /* Skipped fields take their default value. */
+        if (partial_io_skip_field(selection, &list[i])) {
+          partial_io_fill_default(&list[i], Nparticles);
+          continue;
+        }
+
         /* Read array. */
-        read_array_single(h_grp, list[i], Nparticles, internal_units, ic_units,
-                          cleanup_h, cleanup_sqrt_a, h, a);
+        read_array_single(h_grp, list[i], Nparticles, ranges[ptype],
+                          nr_ranges[ptype], internal_units, ic_units,
+                          cleanup_h, cleanup_sqrt_a, h, a, &tp, &read_time,
+                          &copy_time);
       }
 
     /* Close particle group */
     H5Gclose(h_grp);
   }
 
+  if (verbose && !dry_run)
+    message(
+        "Reading the particle arrays took %.3f %s (HDF5 reads: %.3f %s, unit "
+        "conversion and copy: %.3f %s).",
+        clocks_from_ticks(getticks() - tic), clocks_getunit(),
+        clocks_from_ticks(read_time), clocks_getunit(),
+        clocks_from_ticks(copy_time), clocks_getunit());
+  tic = getticks();
+
   /* If we are remapping ParticleIDs later, start by setting them to 1. */
   if (remap_ids) io_set_ids_to_one(*gparts, *Ngparts);
 
   /* Duplicate the parts for gravity */
   if (!dry_run && with_gravity) {
 
-    /* Let's initialise a bit of thread parallelism here */
-    struct threadpool tp;
-    threadpool_init(&tp, n_threads);
-
     /* Prepare the DM particles */
     io_prepare_dm_gparts(&tp, *gparts, Ndm);
 
@@ -787,13 +1008,17 @@ void read_ic_single(
           &tp, *bparts, *gparts, *Nblackholes,
           Ndm + Ndm_background + Ndm_neutrino + *Ngas + *Nsinks + *Nstars);
 
-    threadpool_clean(&tp);
+    if (verbose)
+      message("Preparing the gravity particles took %.3f %s.",
+              clocks_from_ticks(getticks() - tic), clocks_getunit());
   }
 
   /* message("Done Reading particles..."); */
 
   /* Clean up */
+  if (!dry_run) threadpool_clean(&tp);
   free(ic_units);
+  for (int ptype = 0; ptype < swift_type_count; ++ptype) free(ranges[ptype]);
 
   /* Close file */
   H5Fclose(h_file);
@@ -998,7 +1223,9 @@ void write_output_single(struct engine* e,
 
   /* Open file */
   /* message("Opening file '%s'.", fileName); */
-  h_file = H5Fcreate(fileName, H5F_ACC_TRUNC, H5P_DEFAULT, h_props);
+  const size_t size_estimate = snapshot_async_estimate_size(
+      e, current_selection_name, N_total, to_write);
+  h_file = snapshot_async_create_file(e, fileName, h_props, size_estimate);
   if (h_file < 0) error("Error while opening file '%s'.", fileName);
 
   /* Open header to write simulation properties */
@@ -1485,8 +1712,8 @@ void write_output_single(struct engine* e,
 
   /* message("Done writing particles..."); */
 
-  /* Close file */
-  H5Fclose(h_file);
+  /* Close file (and write it out if it was built in memory) */
+  snapshot_async_close_file(e, h_file, fileName);
   H5Pclose(h_props);
 
   e->snapshot_output_count++;
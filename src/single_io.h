@@ -29,6 +29,7 @@
 #include "part.h"
 
 struct engine;
+struct partial_io_selection;
 struct unit_system;
 
 void read_ic_single(
@@ -41,7 +42,10 @@ void read_ic_single(
     const int with_stars, const int with_black_holes, const int with_cosmology,
     const int cleanup_h, const int cleanup_sqrt_a, const double h,
     const double a, const int nr_threads, const int dry_run,
-    const int remap_ids, struct ic_info* ics_metadata);
+    const int remap_ids, struct ic_info* ics_metadata,
+    const struct partial_io_selection* selection, const int verbose);
+
+void read_ic_single_set_chunk_size(const size_t bytes);
 
 void write_output_single(struct engine* e,
                          const struct unit_system* internal_units,
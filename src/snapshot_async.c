@@ -0,0 +1,454 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+/* Some standard headers. */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* This object's header. */
+#include "snapshot_async.h"
+
+/* Local headers. */
+#include "clocks.h"
+#include "common_io.h"
+#include "engine.h"
+#include "error.h"
+#include "io_properties.h"
+#include "memuse.h"
+#include "output_options.h"
+
+/*! Granularity of the memory allocations of the in-memory HDF5 files */
+#define snapshot_async_core_increment (64 * 1024 * 1024)
+
+/*! Allowance for the header, groups and attributes of a snapshot file */
+#define snapshot_async_metadata_size (1024 * 1024)
+
+/*! Allowance for the attributes of a single dataset */
+#define snapshot_async_dataset_metadata_size (4 * 1024)
+
+#if defined(HAVE_HDF5)
+
+/* A dataset whose data is written by the background thread. */
+struct snapshot_async_dataset {
+
+  /* The dataset, kept open until written. */
+  hid_t h_data;
+
+  /* The type of the data in memory. */
+  hid_t h_mem_type;
+
+  /* The data, freed once written. */
+  void *buffer;
+};
+
+#endif /* HAVE_HDF5 */
+
+/* State of the snapshot file being written in the background, if any. */
+static struct snapshot_async_writer {
+
+  /* Name of the file we are writing. */
+  char fileName[1024];
+
+  /* The image of the HDF5 file, owned by the library until the file is
+   * closed. */
+  void *image;
+  size_t size;
+  int image_released;
+
+#if defined(HAVE_HDF5)
+
+  /* Is the current file built in memory? */
+  int staging;
+
+  /* Are the datasets of the current file written by the background
+   * thread? Only if the HDF5 library is thread-safe. */
+  int defer;
+
+  /* The file, closed by the background thread if the datasets are
+   * deferred. */
+  hid_t h_file;
+
+  /* The datasets left to write. */
+  struct snapshot_async_dataset *datasets;
+  int nr_datasets;
+  int size_datasets;
+
+#endif /* HAVE_HDF5 */
+
+  /* The background thread. */
+  int active;
+  pthread_t thread;
+
+  /* For reporting. */
+  int verbose;
+  ticks tic;
+} snapshot_async_writer;
+
+/**
+ * @brief Body of the thread writing a snapshot file to disk.
+ *
+ * Writes the deferred datasets into the in-memory file and closes it, if
+ * needed, then writes the image of the file to disk and frees it.
+ *
+ * @param arg the #snapshot_async_writer.
+ */
+static void *snapshot_async_writer_thread(void *arg) {
+
+  struct snapshot_async_writer *w = (struct snapshot_async_writer *)arg;
+
+#if defined(HAVE_HDF5)
+  if (w->defer) {
+
+    /* Convert, compress and write the data, freeing it as we go. */
+    for (int k = 0; k < w->nr_datasets; k++) {
+      struct snapshot_async_dataset *d = &w->datasets[k];
+      if (H5Dwrite(d->h_data, d->h_mem_type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                   d->buffer) < 0)
+        error("Error while writing a data array of file '%s'.", w->fileName);
+      swift_free("writebuff", d->buffer);
+      H5Dclose(d->h_data);
+    }
+    free(w->datasets);
+    w->datasets = NULL;
+    w->nr_datasets = 0;
+    w->size_datasets = 0;
+
+    /* Close the file, leaving us with its image. */
+    if (H5Fflush(w->h_file, H5F_SCOPE_GLOBAL) < 0)
+      error("Error while flushing file '%s'.", w->fileName);
+    const ssize_t size = H5Fget_file_image(w->h_file, NULL, 0);
+    if (size < 0) error("Error getting the size of file '%s'.", w->fileName);
+    w->size = size;
+    H5Fclose(w->h_file);
+    if (!w->image_released)
+      error("Objects of file '%s' are still open.", w->fileName);
+    w->defer = 0;
+  }
+#endif
+
+  FILE *file = fopen(w->fileName, "wb");
+  if (file == NULL) error("Error while opening file '%s'.", w->fileName);
+  if (fwrite(w->image, 1, w->size, file) != w->size)
+    error("Error while writing %zu bytes to file '%s'.", w->size,
+          w->fileName);
+  if (fclose(file) != 0) error("Error while closing file '%s'.", w->fileName);
+
+  if (w->verbose)
+    message("writing %s (%.3f MB) in the background took %.3f %s.",
+            w->fileName, w->size / (1024. * 1024.),
+            clocks_from_ticks(getticks() - w->tic), clocks_getunit());
+
+  free(w->image);
+  w->image = NULL;
+  w->size = 0;
+  w->image_released = 0;
+  return NULL;
+}
+
+/**
+ * @brief Wait for the snapshot file being written in the background, if any,
+ *        to be complete.
+ */
+void snapshot_async_wait(void) {
+
+  struct snapshot_async_writer *w = &snapshot_async_writer;
+  if (!w->active) return;
+
+  if (pthread_join(w->thread, NULL) != 0)
+    error("Failed to join the snapshot writer thread.");
+  w->active = 0;
+}
+
+#if defined(HAVE_HDF5)
+
+/**
+ * @brief Grow the image of the in-memory file, keeping track of it.
+ *
+ * @param ptr The current image, NULL for a new file.
+ * @param size The new size of the image.
+ * @param op The operation (unused).
+ * @param udata The user data (unused).
+ */
+static void *snapshot_async_image_realloc(void *ptr, size_t size,
+                                          H5FD_file_image_op_t op,
+                                          void *udata) {
+
+  struct snapshot_async_writer *w = &snapshot_async_writer;
+  void *image = realloc(ptr, size);
+  if (image != NULL) w->image = image;
+  return image;
+}
+
+/**
+ * @brief Release the image of the in-memory file.
+ *
+ * The image of the file being closed is kept to be written to disk rather
+ * than freed.
+ *
+ * @param ptr The image.
+ * @param op The operation.
+ * @param udata The user data (unused).
+ */
+static herr_t snapshot_async_image_free(void *ptr, H5FD_file_image_op_t op,
+                                        void *udata) {
+
+  struct snapshot_async_writer *w = &snapshot_async_writer;
+  if (op == H5FD_FILE_IMAGE_OP_FILE_CLOSE && ptr == w->image)
+    w->image_released = 1;
+  else
+    free(ptr);
+  return 0;
+}
+
+/**
+ * @brief Estimate the size of a snapshot file before it is written.
+ *
+ * Counts the raw size of all the fields of the selected output that can be
+ * written for each particle type, which bounds the size of the data once
+ * written (with or without compression), plus an allowance for the
+ * meta-data.
+ *
+ * @param e The #engine.
+ * @param current_selection_name The name of the current output selection.
+ * @param N The number of particles of each type in the file.
+ * @param to_write Whether each particle type is written.
+ *
+ * @return The estimated size in bytes, 0 if the snapshots are not written
+ * asynchronously.
+ */
+size_t snapshot_async_estimate_size(const struct engine *e,
+                                    const char *current_selection_name,
+                                    const long long N[swift_type_count],
+                                    const int to_write[swift_type_count]) {
+
+  if (!e->snapshot_async) return 0;
+
+  const int with_cosmology = e->policy & engine_policy_cosmology;
+  const int with_fof = e->policy & engine_policy_fof;
+#ifdef HAVE_VELOCIRAPTOR
+  const int with_stf = (e->policy & engine_policy_structure_finding) &&
+                       (e->s->gpart_group_data != NULL);
+#else
+  const int with_stf = 0;
+#endif
+
+  /* The cell meta-data: centres, counts, offsets and files */
+  size_t size = snapshot_async_metadata_size +
+                e->s->nr_cells *
+                    (3 * sizeof(double) +
+                     swift_type_count * (2 * sizeof(long long) + sizeof(int)));
+
+  for (int ptype = 0; ptype < swift_type_count; ptype++) {
+
+    if (!to_write[ptype]) continue;
+
+    struct io_props list[100];
+    const int num_fields =
+        io_get_ptype_fields(ptype, list, with_cosmology, with_fof, with_stf);
+
+    const enum lossy_compression_schemes ptype_default =
+        output_options_get_ptype_default_compression(
+            e->output_options->select_output, current_selection_name,
+            (enum part_type)ptype, /*verbose=*/0);
+
+    for (int i = 0; i < num_fields; i++) {
+
+      const enum lossy_compression_schemes compression_level =
+          output_options_get_field_compression(
+              e->output_options, current_selection_name, list[i].name,
+              (enum part_type)ptype, ptype_default, /*verbose=*/0);
+      if (compression_level == compression_do_not_write) continue;
+
+      size += snapshot_async_dataset_metadata_size +
+              N[ptype] * list[i].dimension * io_sizeof_type(list[i].type);
+    }
+  }
+
+  return size;
+}
+
+/**
+ * @brief Create the HDF5 file of a snapshot.
+ *
+ * When asynchronous writes are requested and the estimated size of the file
+ * fits within the staging budget, the file is built in memory and only
+ * written to disk by snapshot_async_close_file(). The library hands the
+ * image of the file over to us when it is closed. Larger files are written
+ * directly.
+ *
+ * @param e The #engine.
+ * @param fileName The name of the file.
+ * @param h_props The file access properties, modified to build the file in
+ * memory if needed.
+ * @param size_estimate The estimated size of the file (see
+ * snapshot_async_estimate_size()).
+ *
+ * @return The HDF5 handle of the file.
+ */
+hid_t snapshot_async_create_file(const struct engine *e, const char *fileName,
+                                 hid_t h_props, size_t size_estimate) {
+
+  struct snapshot_async_writer *w = &snapshot_async_writer;
+  w->staging = 0;
+  w->defer = 0;
+
+  if (e->snapshot_async) {
+
+    /* Only keep one file in memory at a time. */
+    snapshot_async_wait();
+
+    /* Too large to keep around? Write it directly. */
+    if (e->snapshot_async_buffer_size > 0 &&
+        size_estimate > e->snapshot_async_buffer_size) {
+      if (e->verbose)
+        message(
+            "File '%s' (estimated %.3f MB) exceeds the staging budget, "
+            "writing it synchronously.",
+            fileName, size_estimate / (1024. * 1024.));
+      return H5Fcreate(fileName, H5F_ACC_TRUNC, H5P_DEFAULT, h_props);
+    }
+
+    if (H5Pset_fapl_core(h_props, snapshot_async_core_increment,
+                         /*backing_store=*/0) < 0)
+      error("Error setting the in-memory driver for file '%s'.", fileName);
+
+    /* Take over the image of the file instead of copying it out. */
+    H5FD_file_image_callbacks_t callbacks = {
+        /*image_malloc=*/NULL,
+        /*image_memcpy=*/NULL,
+        snapshot_async_image_realloc,
+        snapshot_async_image_free,
+        /*udata_copy=*/NULL,
+        /*udata_free=*/NULL,
+        /*udata=*/NULL};
+    if (H5Pset_file_image_callbacks(h_props, &callbacks) < 0)
+      error("Error setting the file image callbacks for file '%s'.",
+            fileName);
+
+    /* Leave the conversion and compression of the data to the background
+     * thread if the library lets us. */
+    hbool_t is_threadsafe = 0;
+    H5is_library_threadsafe(&is_threadsafe);
+
+    if (strlen(fileName) >= sizeof(w->fileName))
+      error("Snapshot file name too long: %s", fileName);
+    strcpy(w->fileName, fileName);
+    w->image = NULL;
+    w->size = 0;
+    w->image_released = 0;
+    w->staging = 1;
+    w->defer = is_threadsafe;
+  }
+
+  return H5Fcreate(fileName, H5F_ACC_TRUNC, H5P_DEFAULT, h_props);
+}
+
+/**
+ * @brief Hand the data of a dataset of a snapshot over to the background
+ *        thread.
+ *
+ * Only done when the current file is built in memory and the HDF5 library
+ * is thread-safe. The background thread then owns the buffer, which must
+ * have been allocated with swift_memalign() under the "writebuff" label,
+ * and keeps a reference to the dataset.
+ *
+ * @param h_data The dataset.
+ * @param h_mem_type The type of the data in memory.
+ * @param buffer The data.
+ *
+ * @return 1 if the data will be written in the background, 0 if the caller
+ * has to write it.
+ */
+int snapshot_async_defer_write(hid_t h_data, hid_t h_mem_type, void *buffer) {
+
+  struct snapshot_async_writer *w = &snapshot_async_writer;
+  if (!w->defer) return 0;
+
+  if (w->nr_datasets == w->size_datasets) {
+    w->size_datasets = w->size_datasets > 0 ? 2 * w->size_datasets : 64;
+    w->datasets = (struct snapshot_async_dataset *)realloc(
+        w->datasets, w->size_datasets * sizeof(struct snapshot_async_dataset));
+    if (w->datasets == NULL)
+      error("Failed to allocate the list of deferred datasets.");
+  }
+
+  if (H5Iinc_ref(h_data) < 0)
+    error("Error while keeping a reference to a dataset.");
+
+  struct snapshot_async_dataset *d = &w->datasets[w->nr_datasets++];
+  d->h_data = h_data;
+  d->h_mem_type = h_mem_type;
+  d->buffer = buffer;
+  return 1;
+}
+
+/**
+ * @brief Close the HDF5 file of a snapshot.
+ *
+ * When the file was built in memory, a background thread writes its
+ * deferred datasets (if any), closes it and writes its image to disk while
+ * the simulation continues. Call snapshot_async_wait() to make sure it is
+ * complete.
+ *
+ * @param e The #engine.
+ * @param h_file The HDF5 handle of the file.
+ * @param fileName The name of the file.
+ */
+void snapshot_async_close_file(const struct engine *e, hid_t h_file,
+                               const char *fileName) {
+
+  struct snapshot_async_writer *w = &snapshot_async_writer;
+
+  if (!w->staging) {
+    H5Fclose(h_file);
+    return;
+  }
+  w->staging = 0;
+  w->verbose = e->verbose;
+  w->tic = getticks();
+
+  if (w->defer) {
+
+    /* The background thread closes the file. */
+    w->h_file = h_file;
+
+  } else {
+
+    /* Close the file, leaving us with its image. */
+    if (H5Fflush(h_file, H5F_SCOPE_GLOBAL) < 0)
+      error("Error while flushing file '%s'.", fileName);
+    const ssize_t size = H5Fget_file_image(h_file, NULL, 0);
+    if (size < 0) error("Error getting the size of file '%s'.", fileName);
+    w->size = size;
+    H5Fclose(h_file);
+    if (!w->image_released)
+      error("Objects of file '%s' are still open.", fileName);
+  }
+
+  if (pthread_create(&w->thread, NULL, snapshot_async_writer_thread, w) != 0)
+    error("Failed to create the snapshot writer thread.");
+  w->active = 1;
+}
+
+#endif /* HAVE_HDF5 */
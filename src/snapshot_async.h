@@ -0,0 +1,49 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_SNAPSHOT_ASYNC_H
+#define SWIFT_SNAPSHOT_ASYNC_H
+
+/* Config parameters. */
+#include <config.h>
+
+#if defined(HAVE_HDF5)
+
+/* HDF5 headers. */
+#include <hdf5.h>
+
+/* Local headers. */
+#include "part_type.h"
+
+struct engine;
+
+size_t snapshot_async_estimate_size(const struct engine* e,
+                                    const char* current_selection_name,
+                                    const long long N[swift_type_count],
+                                    const int to_write[swift_type_count]);
+hid_t snapshot_async_create_file(const struct engine* e, const char* fileName,
+                                 hid_t h_props, size_t size_estimate);
+int snapshot_async_defer_write(hid_t h_data, hid_t h_mem_type, void* buffer);
+void snapshot_async_close_file(const struct engine* e, hid_t h_file,
+                               const char* fileName);
+
+#endif /* HAVE_HDF5 */
+
+void snapshot_async_wait(void);
+
+#endif /* SWIFT_SNAPSHOT_ASYNC_H */
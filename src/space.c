@@ -505,6 +505,7 @@ void space_getcells(struct space *s, int nr_cells, struct cell **cells,
     bzero(cells[j], sizeof(struct cell));
     cells[j]->grav.multipole = temp;
     cells[j]->nodeID = -1;
+    cells[j]->hydro.last_runner = -1;
     cells[j]->tpid = tpid;
     if (lock_init(&cells[j]->hydro.lock) != 0 ||
         lock_init(&cells[j]->grav.plock) != 0 ||
@@ -145,6 +145,12 @@ struct space {
   /*! Total number of cells (top- and sub-) */
   int tot_cells;
 
+  /*! Keep the cell tree and its tasks through the next space_rebuild()? */
+  int keep_cell_tasks;
+
+  /*! Has the structure of a kept cell tree changed during the rebuild? */
+  volatile int tree_changed;
+
   /*! Number of *local* top-level cells */
   int nr_local_cells;
 
@@ -454,6 +460,10 @@ void space_check_cosmology(struct space *s, const struct cosmology *cosmo,
 void space_reset_task_counters(struct space *s);
 void space_clean(struct space *s);
 void space_free_cells(struct space *s);
+void space_reset_cells(struct space *s);
+void space_reset_cell(struct space *s, struct cell *c);
+void space_recycle_tree(struct space *s, struct cell *c);
+void space_clear_tasks(struct space *s);
 
 void space_free_foreign_parts(struct space *s, const int clear_cell_pointers);
 
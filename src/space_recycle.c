@@ -72,6 +72,165 @@ void space_rebuild_recycle_rec(struct space *s, struct cell *c,
       }
 }
 
+/**
+ * @brief Clear the pointers of a cell to its tasks.
+ *
+ * @param c The #cell.
+ */
+static void space_clear_tasks_of_cell(struct cell *c) {
+  c->hydro.sorts = NULL;
+  c->stars.sorts = NULL;
+  c->nr_tasks = 0;
+  c->grav.nr_mm_tasks = 0;
+  c->hydro.density = NULL;
+  c->hydro.gradient = NULL;
+  c->hydro.force = NULL;
+  c->hydro.limiter = NULL;
+  c->grav.grav = NULL;
+  c->grav.mm = NULL;
+  c->grav.init = NULL;
+  c->grav.init_out = NULL;
+  c->hydro.extra_ghost = NULL;
+  c->hydro.ghost_in = NULL;
+  c->hydro.ghost_out = NULL;
+  c->hydro.ghost = NULL;
+  c->hydro.prep1_ghost = NULL;
+  c->hydro.star_formation = NULL;
+  c->sinks.sink_formation = NULL;
+  c->sinks.star_formation_sink = NULL;
+  c->hydro.stars_resort = NULL;
+  c->stars.density_ghost = NULL;
+  c->stars.prep1_ghost = NULL;
+  c->stars.prep2_ghost = NULL;
+  c->stars.density = NULL;
+  c->stars.feedback = NULL;
+  c->stars.prepare1 = NULL;
+  c->stars.prepare2 = NULL;
+  c->sinks.swallow = NULL;
+  c->sinks.do_sink_swallow = NULL;
+  c->sinks.do_gas_swallow = NULL;
+  c->black_holes.density_ghost = NULL;
+  c->black_holes.swallow_ghost_1 = NULL;
+  c->black_holes.swallow_ghost_2 = NULL;
+  c->black_holes.swallow_ghost_3 = NULL;
+  c->black_holes.density = NULL;
+  c->black_holes.swallow = NULL;
+  c->black_holes.do_gas_swallow = NULL;
+  c->black_holes.do_bh_swallow = NULL;
+  c->black_holes.feedback = NULL;
+#ifdef WITH_CSDS
+  c->csds = NULL;
+#endif
+  c->kick1 = NULL;
+  c->kick2 = NULL;
+  c->timestep = NULL;
+  c->timestep_limiter = NULL;
+  c->timestep_sync = NULL;
+  c->timestep_collect = NULL;
+  c->hydro.end_force = NULL;
+  c->hydro.drift = NULL;
+  c->sinks.drift = NULL;
+  c->stars.drift = NULL;
+  c->stars.stars_in = NULL;
+  c->stars.stars_out = NULL;
+  c->black_holes.drift = NULL;
+  c->black_holes.black_holes_in = NULL;
+  c->black_holes.black_holes_out = NULL;
+  c->sinks.sink_in = NULL;
+  c->sinks.sink_ghost1 = NULL;
+  c->sinks.sink_ghost2 = NULL;
+  c->sinks.sink_out = NULL;
+  c->grav.drift = NULL;
+  c->grav.drift_out = NULL;
+  c->hydro.cooling_in = NULL;
+  c->hydro.cooling_out = NULL;
+  c->hydro.cooling = NULL;
+  c->grav.long_range = NULL;
+  c->grav.down_in = NULL;
+  c->grav.down = NULL;
+  c->grav.end_force = NULL;
+  c->grav.neutrino_weight = NULL;
+  c->rt.rt_in = NULL;
+  c->rt.rt_ghost1 = NULL;
+  c->rt.rt_gradient = NULL;
+  c->rt.rt_ghost2 = NULL;
+  c->rt.rt_transport = NULL;
+  c->rt.rt_transport_out = NULL;
+  c->rt.rt_tchem = NULL;
+  c->rt.rt_advance_cell_time = NULL;
+  c->rt.rt_sorts = NULL;
+  c->rt.rt_out = NULL;
+  c->rt.rt_collect_times = NULL;
+#if WITH_MPI
+  c->mpi.recv = NULL;
+  c->mpi.send = NULL;
+#endif
+}
+
+/**
+ * @brief Reset the particle data of a cell before it is split again.
+ *
+ * @param s The #space.
+ * @param c The #cell.
+ */
+void space_reset_cell(struct space *s, struct cell *c) {
+  c->hydro.dx_max_part = 0.0f;
+  c->hydro.dx_max_sort = 0.0f;
+  c->sinks.dx_max_part = 0.f;
+  c->stars.dx_max_part = 0.f;
+  c->stars.dx_max_sort = 0.f;
+  c->black_holes.dx_max_part = 0.f;
+  c->hydro.sorted = 0;
+  c->hydro.sort_allocated = 0;
+  c->stars.sorted = 0;
+  c->hydro.count = 0;
+  c->hydro.count_total = 0;
+  c->hydro.updated = 0;
+  c->grav.count = 0;
+  c->grav.count_total = 0;
+  c->grav.updated = 0;
+  c->sinks.count = 0;
+  c->stars.count = 0;
+  c->stars.count_total = 0;
+  c->stars.updated = 0;
+  c->black_holes.count = 0;
+  c->black_holes.count_total = 0;
+  c->black_holes.updated = 0;
+  c->hydro.parts = NULL;
+  c->hydro.xparts = NULL;
+  c->grav.parts = NULL;
+  c->grav.parts_rebuild = NULL;
+  c->sinks.parts = NULL;
+  c->stars.parts = NULL;
+  c->stars.parts_rebuild = NULL;
+  c->black_holes.parts = NULL;
+  c->flags = 0;
+  c->hydro.ti_end_min = -1;
+  c->grav.ti_end_min = -1;
+  c->sinks.ti_end_min = -1;
+  c->stars.ti_end_min = -1;
+  c->black_holes.ti_end_min = -1;
+  c->rt.ti_rt_end_min = -1;
+  c->rt.ti_rt_min_step_size = -1;
+  c->rt.updated = 0;
+#ifdef SWIFT_RT_DEBUG_CHECKS
+  c->rt.advanced_time = 0;
+#endif
+
+  star_formation_logger_init(&c->stars.sfh);
+#if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
+  c->cellID = 0;
+#endif
+  if (s->with_self_gravity)
+    bzero(c->grav.multipole, sizeof(struct gravity_tensors));
+
+  cell_free_hydro_sorts(c);
+  cell_free_stars_sorts(c);
+#if WITH_MPI
+  c->mpi.tag = -1;
+#endif
+}
+
 void space_rebuild_recycle_mapper(void *map_data, int num_elements,
                                   void *extra_data) {
 
@@ -80,161 +239,33 @@ void space_rebuild_recycle_mapper(void *map_data, int num_elements,
 
   for (int k = 0; k < num_elements; k++) {
     struct cell *c = &cells[k];
-    struct cell *cell_rec_begin = NULL, *cell_rec_end = NULL;
-    struct gravity_tensors *multipole_rec_begin = NULL,
-                           *multipole_rec_end = NULL;
-    space_rebuild_recycle_rec(s, c, &cell_rec_begin, &cell_rec_end,
-                              &multipole_rec_begin, &multipole_rec_end);
-    if (cell_rec_begin != NULL)
-      space_recycle_list(s, cell_rec_begin, cell_rec_end, multipole_rec_begin,
-                         multipole_rec_end);
-    c->hydro.sorts = NULL;
-    c->stars.sorts = NULL;
-    c->nr_tasks = 0;
-    c->grav.nr_mm_tasks = 0;
-    c->hydro.density = NULL;
-    c->hydro.gradient = NULL;
-    c->hydro.force = NULL;
-    c->hydro.limiter = NULL;
-    c->grav.grav = NULL;
-    c->grav.mm = NULL;
-    c->hydro.dx_max_part = 0.0f;
-    c->hydro.dx_max_sort = 0.0f;
-    c->sinks.dx_max_part = 0.f;
-    c->stars.dx_max_part = 0.f;
-    c->stars.dx_max_sort = 0.f;
-    c->black_holes.dx_max_part = 0.f;
-    c->hydro.sorted = 0;
-    c->hydro.sort_allocated = 0;
-    c->stars.sorted = 0;
-    c->hydro.count = 0;
-    c->hydro.count_total = 0;
-    c->hydro.updated = 0;
-    c->grav.count = 0;
-    c->grav.count_total = 0;
-    c->grav.updated = 0;
-    c->sinks.count = 0;
-    c->stars.count = 0;
-    c->stars.count_total = 0;
-    c->stars.updated = 0;
-    c->black_holes.count = 0;
-    c->black_holes.count_total = 0;
-    c->black_holes.updated = 0;
-    c->grav.init = NULL;
-    c->grav.init_out = NULL;
-    c->hydro.extra_ghost = NULL;
-    c->hydro.ghost_in = NULL;
-    c->hydro.ghost_out = NULL;
-    c->hydro.ghost = NULL;
-    c->hydro.prep1_ghost = NULL;
-    c->hydro.star_formation = NULL;
-    c->sinks.sink_formation = NULL;
-    c->sinks.star_formation_sink = NULL;
-    c->hydro.stars_resort = NULL;
-    c->stars.density_ghost = NULL;
-    c->stars.prep1_ghost = NULL;
-    c->stars.prep2_ghost = NULL;
-    c->stars.density = NULL;
-    c->stars.feedback = NULL;
-    c->stars.prepare1 = NULL;
-    c->stars.prepare2 = NULL;
-    c->sinks.swallow = NULL;
-    c->sinks.do_sink_swallow = NULL;
-    c->sinks.do_gas_swallow = NULL;
-    c->black_holes.density_ghost = NULL;
-    c->black_holes.swallow_ghost_1 = NULL;
-    c->black_holes.swallow_ghost_2 = NULL;
-    c->black_holes.swallow_ghost_3 = NULL;
-    c->black_holes.density = NULL;
-    c->black_holes.swallow = NULL;
-    c->black_holes.do_gas_swallow = NULL;
-    c->black_holes.do_bh_swallow = NULL;
-    c->black_holes.feedback = NULL;
-#ifdef WITH_CSDS
-    c->csds = NULL;
-#endif
-    c->kick1 = NULL;
-    c->kick2 = NULL;
-    c->timestep = NULL;
-    c->timestep_limiter = NULL;
-    c->timestep_sync = NULL;
-    c->timestep_collect = NULL;
-    c->hydro.end_force = NULL;
-    c->hydro.drift = NULL;
-    c->sinks.drift = NULL;
-    c->stars.drift = NULL;
-    c->stars.stars_in = NULL;
-    c->stars.stars_out = NULL;
-    c->black_holes.drift = NULL;
-    c->black_holes.black_holes_in = NULL;
-    c->black_holes.black_holes_out = NULL;
-    c->sinks.sink_in = NULL;
-    c->sinks.sink_ghost1 = NULL;
-    c->sinks.sink_ghost2 = NULL;
-    c->sinks.sink_out = NULL;
-    c->grav.drift = NULL;
-    c->grav.drift_out = NULL;
-    c->hydro.cooling_in = NULL;
-    c->hydro.cooling_out = NULL;
-    c->hydro.cooling = NULL;
-    c->grav.long_range = NULL;
-    c->grav.down_in = NULL;
-    c->grav.down = NULL;
-    c->grav.end_force = NULL;
-    c->grav.neutrino_weight = NULL;
+    space_recycle_tree(s, c);
+    space_clear_tasks_of_cell(c);
+    space_reset_cell(s, c);
     c->top = c;
     c->super = c;
     c->hydro.super = c;
     c->grav.super = c;
-    c->hydro.parts = NULL;
-    c->hydro.xparts = NULL;
-    c->grav.parts = NULL;
-    c->grav.parts_rebuild = NULL;
-    c->sinks.parts = NULL;
-    c->stars.parts = NULL;
-    c->stars.parts_rebuild = NULL;
-    c->black_holes.parts = NULL;
-    c->flags = 0;
-    c->hydro.ti_end_min = -1;
-    c->grav.ti_end_min = -1;
-    c->sinks.ti_end_min = -1;
-    c->stars.ti_end_min = -1;
-    c->black_holes.ti_end_min = -1;
-    c->rt.rt_in = NULL;
-    c->rt.rt_ghost1 = NULL;
-    c->rt.rt_gradient = NULL;
-    c->rt.rt_ghost2 = NULL;
-    c->rt.rt_transport = NULL;
-    c->rt.rt_transport_out = NULL;
-    c->rt.rt_tchem = NULL;
-    c->rt.rt_advance_cell_time = NULL;
-    c->rt.rt_sorts = NULL;
-    c->rt.rt_out = NULL;
-    c->rt.rt_collect_times = NULL;
-    c->rt.ti_rt_end_min = -1;
-    c->rt.ti_rt_min_step_size = -1;
-    c->rt.updated = 0;
-#ifdef SWIFT_RT_DEBUG_CHECKS
-    c->rt.advanced_time = 0;
-#endif
-
-    star_formation_logger_init(&c->stars.sfh);
-#if defined(SWIFT_DEBUG_CHECKS) || defined(SWIFT_CELL_GRAPH)
-    c->cellID = 0;
-#endif
-    if (s->with_self_gravity)
-      bzero(c->grav.multipole, sizeof(struct gravity_tensors));
-
-    cell_free_hydro_sorts(c);
-    cell_free_stars_sorts(c);
-#if WITH_MPI
-    c->mpi.tag = -1;
-    c->mpi.recv = NULL;
-    c->mpi.send = NULL;
-#endif
   }
 }
 
+/**
+ * @brief Recycle all the progeny of a cell.
+ *
+ * @param s The #space.
+ * @param c The #cell.
+ */
+void space_recycle_tree(struct space *s, struct cell *c) {
+  struct cell *cell_rec_begin = NULL, *cell_rec_end = NULL;
+  struct gravity_tensors *multipole_rec_begin = NULL,
+                         *multipole_rec_end = NULL;
+  space_rebuild_recycle_rec(s, c, &cell_rec_begin, &cell_rec_end,
+                            &multipole_rec_begin, &multipole_rec_end);
+  if (cell_rec_begin != NULL)
+    space_recycle_list(s, cell_rec_begin, cell_rec_end, multipole_rec_begin,
+                       multipole_rec_end);
+}
+
 /**
  * @brief Return a used cell to the buffer of unused sub-cells.
  *
@@ -327,6 +358,84 @@ void space_recycle_list(struct space *s, struct cell *cell_list_begin,
   lock_unlock_blind(&s->lock);
 }
 
+/**
+ * @brief #threadpool_map function resetting the particle data of the
+ * top-level cells, keeping their progeny and tasks.
+ */
+void space_reset_cells_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  struct space *s = (struct space *)extra_data;
+  struct cell *cells = (struct cell *)map_data;
+
+  for (int k = 0; k < num_elements; k++) space_reset_cell(s, &cells[k]);
+}
+
+/**
+ * @brief Reset the particle data of the top-level cells while keeping the
+ * tree below them and the tasks, to be re-used by space_split().
+ *
+ * @param s The #space.
+ */
+void space_reset_cells(struct space *s) {
+
+  ticks tic = getticks();
+
+  threadpool_map(&s->e->threadpool, space_reset_cells_mapper, s->cells_top,
+                 s->nr_cells, sizeof(struct cell), threadpool_auto_chunk_size,
+                 s);
+  s->maxdepth = 0;
+
+  if (s->e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
+/**
+ * @brief Recursively clear the pointers of a cell tree to its tasks.
+ *
+ * @param c The #cell.
+ */
+static void space_clear_tasks_rec(struct cell *c) {
+  space_clear_tasks_of_cell(c);
+  c->super = NULL;
+  c->hydro.super = NULL;
+  c->grav.super = NULL;
+  if (c->split)
+    for (int k = 0; k < 8; k++)
+      if (c->progeny[k] != NULL) space_clear_tasks_rec(c->progeny[k]);
+}
+
+/**
+ * @brief #threadpool_map function clearing the pointers of the cells to
+ * their tasks.
+ */
+void space_clear_tasks_mapper(void *map_data, int num_elements,
+                              void *extra_data) {
+
+  struct cell *cells = (struct cell *)map_data;
+
+  for (int k = 0; k < num_elements; k++) {
+    struct cell *c = &cells[k];
+    space_clear_tasks_rec(c);
+    c->super = c;
+    c->hydro.super = c;
+    c->grav.super = c;
+  }
+}
+
+/**
+ * @brief Clear the pointers of all the cells to their tasks, such that a new
+ * set of tasks can be made on a tree kept by space_reset_cells().
+ *
+ * @param s The #space.
+ */
+void space_clear_tasks(struct space *s) {
+  threadpool_map(&s->e->threadpool, space_clear_tasks_mapper, s->cells_top,
+                 s->nr_cells, sizeof(struct cell), threadpool_auto_chunk_size,
+                 s);
+}
+
 /**
  * @brief Free up any allocated cells.
  *
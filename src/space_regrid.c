@@ -198,6 +198,9 @@ void space_regrid(struct space *s, int verbose) {
     fflush(stdout);
 #endif
 
+    /* The tree cannot be kept across a regrid. */
+    s->tree_changed = 1;
+
     /* Free the old cells, if they were allocated. */
     if (s->cells_top != NULL) {
       space_free_cells(s);
@@ -306,6 +309,7 @@ void space_regrid(struct space *s, int verbose) {
           c->depth = 0;
           c->split = 0;
           c->hydro.count = 0;
+          c->hydro.last_runner = -1;
           c->grav.count = 0;
           c->stars.count = 0;
           c->sinks.count = 0;
@@ -391,8 +395,12 @@ void space_regrid(struct space *s, int verbose) {
   } /* re-build upper-level cells? */
   else { /* Otherwise, just clean up the cells. */
 
-    /* Free the old cells, if they were allocated. */
-    space_free_cells(s);
+    /* Free the old cells, if they were allocated, or only reset their
+     * particle data if the tree and its tasks are to be kept. */
+    if (s->keep_cell_tasks)
+      space_reset_cells(s);
+    else
+      space_free_cells(s);
   }
 
   if (verbose)
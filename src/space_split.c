@@ -91,11 +91,20 @@ void space_split_recursive(struct space *s, struct cell *c,
   struct engine *e = s->e;
   const integertime_t ti_current = e->ti_current;
   const int with_rt = e->policy & engine_policy_rt;
+  const int keep_tree = s->keep_cell_tasks;
 
   /* Set the top level cell tpid. Doing it here ensures top level cells
    * have the same tpid as their progeny. */
   if (depth == 0) c->tpid = tpid;
 
+  /* Record the types of particles present, a change of which changes the
+   * tasks this cell needs. */
+  const char particle_types = (count > 0) | ((gcount > 0) << 1) |
+                              ((scount > 0) << 2) | ((bcount > 0) << 3) |
+                              ((sink_count > 0) << 4);
+  if (keep_tree && c->particle_types != particle_types) s->tree_changed = 1;
+  c->particle_types = particle_types;
+
   /* If the buff is NULL, allocate it, and remember to free it. */
   const int allocate_buffer = (buff == NULL && gbuff == NULL && sbuff == NULL &&
                                bbuff == NULL && sink_buff == NULL);
@@ -197,11 +206,27 @@ void space_split_recursive(struct space *s, struct cell *c,
       (!with_self_gravity &&
        (count > space_splitsize || scount > space_splitsize))) {
 
+    /* Which progeny do we already have from the kept tree? */
+    char kept[8] = {0};
+    if (keep_tree && c->split) {
+      for (int k = 0; k < 8; k++) {
+        if (c->progeny[k] != NULL) {
+          kept[k] = 1;
+          space_reset_cell(s, c->progeny[k]);
+        } else {
+          space_getcells(s, 1, &c->progeny[k], tpid);
+        }
+      }
+    } else {
+      if (keep_tree) s->tree_changed = 1;
+
+      /* Create the cell's progeny. */
+      space_getcells(s, 8, c->progeny, tpid);
+    }
+
     /* No longer just a leaf. */
     c->split = 1;
 
-    /* Create the cell's progeny. */
-    space_getcells(s, 8, c->progeny, tpid);
     for (int k = 0; k < 8; k++) {
       struct cell *cp = c->progeny[k];
       cp->hydro.count = 0;
@@ -231,7 +256,7 @@ void space_split_recursive(struct space *s, struct cell *c,
       if (k & 2) cp->loc[1] += cp->width[1];
       if (k & 1) cp->loc[2] += cp->width[2];
       cp->depth = c->depth + 1;
-      cp->split = 0;
+      if (!kept[k]) cp->split = 0;
       cp->hydro.h_max = 0.f;
       cp->hydro.h_max_active = 0.f;
       cp->hydro.dx_max_part = 0.f;
@@ -249,9 +274,11 @@ void space_split_recursive(struct space *s, struct cell *c,
       cp->nodeID = c->nodeID;
       cp->parent = c;
       cp->top = c->top;
-      cp->super = NULL;
-      cp->hydro.super = NULL;
-      cp->grav.super = NULL;
+      if (!kept[k]) {
+        cp->super = NULL;
+        cp->hydro.super = NULL;
+        cp->grav.super = NULL;
+      }
       cp->flags = 0;
       star_formation_logger_init(&cp->stars.sfh);
 #ifdef WITH_MPI
@@ -281,11 +308,21 @@ void space_split_recursive(struct space *s, struct cell *c,
       if (cp->hydro.count == 0 && cp->grav.count == 0 && cp->stars.count == 0 &&
           cp->black_holes.count == 0 && cp->sinks.count == 0) {
 
+        /* Drop the sub-tree a kept progeny may still carry. */
+        if (kept[k]) {
+          space_recycle_tree(s, cp);
+          cp->tpid = tpid;
+          s->tree_changed = 1;
+        }
+
         space_recycle(s, cp);
         c->progeny[k] = NULL;
 
       } else {
 
+        /* A progeny appeared where the kept tree had none. */
+        if (keep_tree && !kept[k]) s->tree_changed = 1;
+
         /* Recurse */
         space_split_recursive(s, cp, progeny_buff, progeny_sbuff, progeny_bbuff,
                               progeny_gbuff, progeny_sink_buff, tpid);
@@ -444,6 +481,12 @@ void space_split_recursive(struct space *s, struct cell *c,
   /* Otherwise, collect the data from the particles this cell. */
   else {
 
+    /* Drop the sub-tree of a kept cell that is no longer split. */
+    if (keep_tree && c->split) {
+      space_recycle_tree(s, c);
+      s->tree_changed = 1;
+    }
+
     /* Clear the progeny. */
     bzero(c->progeny, sizeof(struct cell *) * 8);
     c->split = 0;
@@ -676,6 +719,7 @@ void space_split_recursive(struct space *s, struct cell *c,
 
   /* No runner owns this cell yet. We assign those during scheduling. */
   c->owner = -1;
+  c->hydro.last_runner = -1;
 
   /* Store the global max depth */
   if (c->depth == 0) atomic_max(&s->maxdepth, maxdepth);
@@ -767,6 +811,21 @@ void space_split(struct space *s, int verbose) {
                  s->nr_local_cells_with_particles, sizeof(int),
                  threadpool_auto_chunk_size, s);
 
+  /* The top-level cells left empty are not visited by the mapper. Drop what
+   * they may have kept of their tree. */
+  for (int k = 0; k < s->nr_cells; k++) {
+    struct cell *c = &s->cells_top[k];
+    if (c->hydro.count > 0 || c->grav.count > 0 || c->stars.count > 0 ||
+        c->black_holes.count > 0 || c->sinks.count > 0)
+      continue;
+    if (s->keep_cell_tasks) {
+      if (c->split || c->particle_types) s->tree_changed = 1;
+      space_recycle_tree(s, c);
+      c->split = 0;
+    }
+    c->particle_types = 0;
+  }
+
   if (verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
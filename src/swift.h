@@ -70,6 +70,7 @@
 #include "parallel_io.h"
 #include "parser.h"
 #include "part.h"
+#include "partial_io.h"
 #include "partition.h"
 #include "periodic.h"
 #include "physical_constants.h"
@@ -726,6 +726,10 @@ int task_lock(struct task *t) {
     case task_type_recv:
     case task_type_send:
 #ifdef WITH_MPI
+      /* Part of an aggregated message? */
+      if (t->aggregate != NULL)
+        return scheduler_mpi_aggregate_test(t->aggregate);
+
       /* Check the status of the MPI request. */
       if ((err = MPI_Test(&t->req, &res, &stat)) != MPI_SUCCESS) {
         char buff[MPI_MAX_ERROR_STRING];
@@ -205,6 +205,20 @@ enum task_categories {
   task_category_count
 };
 
+/**
+ * @brief The state of the persistent MPI request of a send/recv task.
+ */
+enum task_mpi_persistent {
+  /* Request started from scratch every step */
+  task_mpi_persistent_none,
+  /* Persistent request on the particle array */
+  task_mpi_persistent_parts,
+  /* Persistent request on the task's own buffer */
+  task_mpi_persistent_buff,
+  /* Sent or received within the aggregated message of its rank */
+  task_mpi_persistent_aggregate
+};
+
 /**
  * @brief Names of the task types.
  */
@@ -225,6 +239,9 @@ extern const char *task_category_names[];
  */
 #ifdef WITH_MPI
 extern MPI_Comm subtaskMPI_comms[task_subtype_count];
+
+/* Forward declaration. */
+struct scheduler_mpi_aggregate;
 #endif
 
 /**
@@ -249,6 +266,14 @@ struct task {
   /*! MPI request corresponding to this task */
   MPI_Request req;
 
+  /*! Is the MPI request persistent, i.e. re-started at every step until the
+   * next rebuild? (see #task_mpi_persistent) */
+  char persistent;
+
+  /*! The message aggregating this communication with all the others of the
+   * same sub-type and rank, NULL if sent on its own */
+  struct scheduler_mpi_aggregate *aggregate;
+
 #endif
 
   /*! Rank of a task in the order */
@@ -257,6 +282,9 @@ struct task {
   /*! Weight of the task */
   float weight;
 
+  /*! Cost of the task estimated from its particle counts */
+  float cost;
+
   /*! Number of tasks unlocked by this one */
   int nr_unlock_tasks;
 
@@ -38,10 +38,15 @@
 #include "atomic.h"
 #include "clocks.h"
 #include "error.h"
+#include "memuse.h"
 #include "minmax.h"
 
 /* Keys for thread specific data. */
 static pthread_key_t threadpool_tid;
+static pthread_key_t threadpool_current_job;
+
+/* ID of the main thread outside of the maps. */
+static int threadpool_main_tid = 0;
 
 /* Affinity mask shared by all threads, and if set. */
 #ifdef HAVE_SETAFFINITY
@@ -56,8 +61,9 @@ static void threadpool_apply_affinity_mask(void);
 /**
  * @brief Store a log entry of the given chunk.
  */
-static void threadpool_log(struct threadpool *tp, int tid, size_t chunk_size,
-                           ticks tic, ticks toc) {
+static void threadpool_log(struct threadpool *tp,
+                           threadpool_map_function map_function, int tid,
+                           size_t chunk_size, ticks tic, ticks toc) {
   struct mapper_log *log = &tp->logs[tid > 0 ? tid : 0];
 
   /* Check if we need to re-allocate the log buffer. */
@@ -78,7 +84,7 @@ static void threadpool_log(struct threadpool *tp, int tid, size_t chunk_size,
   entry->chunk_size = chunk_size;
   entry->tic = tic;
   entry->toc = toc;
-  entry->map_function = tp->map_function;
+  entry->map_function = map_function;
   log->count++;
 }
 
@@ -179,15 +185,326 @@ static void threadpool_chomp(struct threadpool *tp, int tid) {
     ticks tic = getticks();
 #endif
 
+    pthread_setspecific(threadpool_current_job, &tp->job);
     tp->map_function((char *)tp->map_data + (tp->map_data_stride * task_ind),
                      chunk_size, tp->map_extra_data);
+    pthread_setspecific(threadpool_current_job, NULL);
 
 #ifdef SWIFT_DEBUG_THREADPOOL
-    threadpool_log(tp, tid, chunk_size, tic, getticks());
+    threadpool_log(tp, tp->map_function, tid, chunk_size, tic, getticks());
 #endif
   }
 }
 
+/**
+ * @brief Get the number of elements to process in one go for a job.
+ *
+ * The chunks are sized such that each takes about
+ * #threadpool_adaptive_chunk_time to process, using the time per element
+ * measured so far in this job or, failing that, in previous calls with the
+ * same mapper function.
+ *
+ * @param tp The #threadpool.
+ * @param job The #threadpool_job.
+ * @param available The number of elements in the range we take from.
+ */
+static size_t threadpool_adaptive_chunk(const struct threadpool *tp,
+                                        const struct threadpool_job *job,
+                                        const size_t available) {
+
+  double chunk;
+  const size_t count = job->count;
+  if (count > 0 || job->history_ticks_per_element > 0.) {
+    const double ticks_per_element = count > 0
+                                         ? (double)job->ticks / (double)count
+                                         : job->history_ticks_per_element;
+    chunk = ticks_per_element > 0. ? tp->chunk_ticks / ticks_per_element
+                                   : (double)available;
+  } else {
+
+    /* Nothing known yet, start small to get a measurement quickly. */
+    chunk = (double)available / threadpool_default_chunk_ratio;
+  }
+
+  /* A chunk cannot exceed INT_MAX, as we use int elements in map_function. */
+  if (chunk > (double)available) chunk = (double)available;
+  if (chunk > (double)INT_MAX) chunk = (double)INT_MAX;
+  if (chunk < 1.) chunk = 1.;
+  return (size_t)chunk;
+}
+
+/**
+ * @brief Take a chunk from the front of this thread's range of a job.
+ *
+ * @param tp The #threadpool.
+ * @param job The #threadpool_job.
+ * @param tid The ID of this thread.
+ * @param begin (return) The first element of the chunk.
+ * @param end (return) One past the last element of the chunk.
+ *
+ * @return 1 if a chunk was found, 0 if the range is empty.
+ */
+static int threadpool_range_take(const struct threadpool *tp,
+                                 struct threadpool_job *job, const int tid,
+                                 size_t *begin, size_t *end) {
+
+  struct threadpool_range *range = &job->ranges[tid];
+  if (range->begin >= range->end) return 0;
+
+  lock_lock(&range->lock);
+  if (range->begin >= range->end) {
+    lock_unlock_blind(&range->lock);
+    return 0;
+  }
+  const size_t chunk =
+      threadpool_adaptive_chunk(tp, job, range->end - range->begin);
+  *begin = range->begin;
+  *end = range->begin + chunk;
+  range->begin = *end;
+  lock_unlock_blind(&range->lock);
+
+  return 1;
+}
+
+/**
+ * @brief Steal the back half of another thread's range of a job.
+ *
+ * This is the lazy binary splitting: ranges are only ever split when a
+ * thread runs out of work.
+ *
+ * @param tp The #threadpool.
+ * @param job The #threadpool_job.
+ * @param tid The ID of this thread, whose range is assumed to be empty.
+ *
+ * @return 1 if something was stolen, 0 otherwise.
+ */
+static int threadpool_range_steal(const struct threadpool *tp,
+                                  struct threadpool_job *job, const int tid) {
+
+  const int num_threads = tp->num_threads;
+  for (int k = 1; k < num_threads; k++) {
+    struct threadpool_range *victim = &job->ranges[(tid + k) % num_threads];
+    if (victim->begin >= victim->end) continue;
+
+    lock_lock(&victim->lock);
+    if (victim->begin >= victim->end) {
+      lock_unlock_blind(&victim->lock);
+      continue;
+    }
+    const size_t half = (victim->end - victim->begin + 1) / 2;
+    const size_t end = victim->end;
+    victim->end -= half;
+    lock_unlock_blind(&victim->lock);
+
+    struct threadpool_range *range = &job->ranges[tid];
+    lock_lock(&range->lock);
+    range->begin = end - half;
+    range->end = end;
+    lock_unlock_blind(&range->lock);
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Find and process one chunk of a job.
+ *
+ * @param tp The #threadpool.
+ * @param job The #threadpool_job.
+ * @param tid The ID of this thread.
+ *
+ * @return 1 if a chunk was processed, 0 if none was available.
+ */
+static int threadpool_job_step(struct threadpool *tp,
+                               struct threadpool_job *job, const int tid) {
+
+  size_t begin, end;
+  if (!threadpool_range_take(tp, job, tid, &begin, &end) &&
+      !(threadpool_range_steal(tp, job, tid) &&
+        threadpool_range_take(tp, job, tid, &begin, &end)))
+    return 0;
+
+  /* Call the mapper function, remembering which job we are in for the sake
+   * of nested maps. */
+  void *outer = pthread_getspecific(threadpool_current_job);
+  pthread_setspecific(threadpool_current_job, job);
+  const ticks tic = getticks();
+  job->map_function((char *)job->map_data + (job->map_data_stride * begin),
+                    end - begin, job->map_extra_data);
+  const ticks toc = getticks();
+  pthread_setspecific(threadpool_current_job, outer);
+
+#ifdef SWIFT_DEBUG_THREADPOOL
+  threadpool_log(tp, job->map_function, tid, end - begin, tic, toc);
+#endif
+
+  atomic_add(&job->ticks, toc - tic);
+  atomic_add(&job->count, end - begin);
+  atomic_sub(&job->remaining, end - begin);
+  return 1;
+}
+
+/**
+ * @brief Process one chunk of the innermost nested job that has work left.
+ *
+ * @param tp The #threadpool.
+ * @param tid The ID of this thread.
+ *
+ * @return 1 if a chunk was processed, 0 otherwise.
+ */
+static int threadpool_help_nested(struct threadpool *tp, const int tid) {
+
+  if (tp->nr_nested_jobs == 0) return 0;
+
+  struct threadpool_job *job = NULL;
+  lock_lock(&tp->nested_lock);
+  for (int k = tp->nr_nested_jobs - 1; k >= 0 && job == NULL; k--)
+    if (tp->nested_jobs[k]->remaining > 0) job = tp->nested_jobs[k];
+  if (job != NULL) atomic_inc(&job->users);
+  lock_unlock_blind(&tp->nested_lock);
+  if (job == NULL) return 0;
+
+  const int res = threadpool_job_step(tp, job, tid);
+  atomic_dec(&job->users);
+  return res;
+}
+
+/**
+ * @brief Prepare a #threadpool_job.
+ *
+ * @param tp The #threadpool.
+ * @param job The #threadpool_job.
+ * @param map_function The function that will be applied to the map data.
+ * @param map_data The data on which the mapping function will be called.
+ * @param N Number of elements in @c map_data.
+ * @param stride Size, in bytes, of each element of @c map_data.
+ * @param extra_data Addtitional pointer passed to the mapping function.
+ */
+static void threadpool_job_init(struct threadpool *tp,
+                                struct threadpool_job *job,
+                                threadpool_map_function map_function,
+                                void *map_data, size_t N, int stride,
+                                void *extra_data) {
+
+  job->map_function = map_function;
+  job->map_data = map_data;
+  job->map_extra_data = extra_data;
+  job->map_data_stride = stride;
+  job->remaining = N;
+  job->ticks = 0;
+  job->count = 0;
+  job->users = 0;
+
+  const struct threadpool_history *history =
+      &tp->history[((size_t)map_function >> 4) % threadpool_history_size];
+  job->history_ticks_per_element = (history->map_function == map_function)
+                                       ? history->ticks_per_element
+                                       : 0.;
+}
+
+/**
+ * @brief Remember the time per element of a finished #threadpool_job.
+ *
+ * @param tp The #threadpool.
+ * @param job The #threadpool_job.
+ */
+static void threadpool_job_record(struct threadpool *tp,
+                                  const struct threadpool_job *job) {
+
+  if (job->count == 0) return;
+  struct threadpool_history *history =
+      &tp->history[((size_t)job->map_function >> 4) % threadpool_history_size];
+  history->map_function = job->map_function;
+  history->ticks_per_element = (double)job->ticks / (double)job->count;
+}
+
+/**
+ * @brief Runner loop for adaptive maps, process chunks until the job is done.
+ *
+ * @param tp The #threadpool.
+ * @param tid The ID of this thread.
+ */
+static void threadpool_adaptive_chomp(struct threadpool *tp, int tid) {
+
+  /* Store the thread ID as thread specific data. */
+  int localtid = tid;
+  pthread_setspecific(threadpool_tid, &localtid);
+
+  struct threadpool_job *job = &tp->job;
+  while (job->remaining > 0) {
+    if (threadpool_job_step(tp, job, tid)) continue;
+
+    /* All that is left is being processed, help with nested maps. */
+    if (!threadpool_help_nested(tp, tid)) sched_yield();
+  }
+}
+
+/**
+ * @brief Map a function over an array from within a mapper function.
+ *
+ * The calling thread starts with all the elements, the other threads of the
+ * pool steal from it once they are done with their own work.
+ *
+ * @param tp The #threadpool.
+ * @param map_function The function that will be applied to the map data.
+ * @param map_data The data on which the mapping function will be called.
+ * @param N Number of elements in @c map_data.
+ * @param stride Size, in bytes, of each element of @c map_data.
+ * @param extra_data Addtitional pointer passed to the mapping function.
+ */
+static void threadpool_map_nested(struct threadpool *tp,
+                                  threadpool_map_function map_function,
+                                  void *map_data, size_t N, int stride,
+                                  void *extra_data) {
+
+  const int tid = threadpool_gettid();
+  struct threadpool_job job;
+  threadpool_job_init(tp, &job, map_function, map_data, N, stride,
+                      extra_data);
+
+  if (swift_memalign("threadpool_ranges", (void **)&job.ranges,
+                     SWIFT_CACHE_ALIGNMENT,
+                     tp->num_threads * sizeof(struct threadpool_range)) != 0)
+    error("Failed to allocate nested map ranges.");
+  for (int k = 0; k < tp->num_threads; k++) {
+    if (lock_init(&job.ranges[k].lock) != 0)
+      error("Failed to init nested map range lock.");
+    job.ranges[k].begin = 0;
+    job.ranges[k].end = (k == tid) ? N : 0;
+  }
+
+  /* Make this job visible to idle threads, if there is room. */
+  lock_lock(&tp->nested_lock);
+  const int visible = tp->nr_nested_jobs < threadpool_max_nested_jobs;
+  if (visible) tp->nested_jobs[tp->nr_nested_jobs++] = &job;
+  lock_unlock_blind(&tp->nested_lock);
+
+  /* Work until all the chunks, including the stolen ones, are done. */
+  while (job.remaining > 0)
+    if (!threadpool_job_step(tp, &job, tid)) sched_yield();
+
+  /* Retire the job and wait for the last helpers to let go of it. */
+  if (visible) {
+    lock_lock(&tp->nested_lock);
+    for (int k = 0; k < tp->nr_nested_jobs; k++)
+      if (tp->nested_jobs[k] == &job) {
+        for (int j = k + 1; j < tp->nr_nested_jobs; j++)
+          tp->nested_jobs[j - 1] = tp->nested_jobs[j];
+        tp->nr_nested_jobs--;
+        break;
+      }
+    lock_unlock_blind(&tp->nested_lock);
+  }
+  while (job.users > 0) sched_yield();
+
+  threadpool_job_record(tp, &job);
+  for (int k = 0; k < tp->num_threads; k++)
+    if (lock_destroy(&job.ranges[k].lock) != 0)
+      error("Failed to destroy nested map range lock.");
+  swift_free("threadpool_ranges", job.ranges);
+}
+
 /**
  * @brief The thread start routine. Loops until told to exit.
  *
@@ -215,7 +532,10 @@ static void *threadpool_runner(void *data) {
     if (tp->map_function == NULL) pthread_exit(NULL);
 
     /* Do actual work. */
-    threadpool_chomp(tp, atomic_inc(&tp->num_threads_running));
+    if (tp->map_adaptive)
+      threadpool_adaptive_chomp(tp, atomic_inc(&tp->num_threads_running));
+    else
+      threadpool_chomp(tp, atomic_inc(&tp->num_threads_running));
   }
 }
 
@@ -232,10 +552,18 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
 
   /* Create thread local data areas. Only do this once for all threads. */
   pthread_key_create(&threadpool_tid, NULL);
+  pthread_key_create(&threadpool_current_job, NULL);
+
+  /* Nothing is known about the cost of the mapper functions yet. */
+  tp->chunk_ticks = threadpool_adaptive_chunk_time * clocks_get_cpufreq();
+  bzero(tp->history, sizeof(struct threadpool_history) *
+                         threadpool_history_size);
+  tp->nr_nested_jobs = 0;
+  tp->map_adaptive = 0;
+  tp->job.ranges = NULL;
 
   /* Store the main thread ID as thread specific data. */
-  static int localtid = 0;
-  pthread_setspecific(threadpool_tid, &localtid);
+  pthread_setspecific(threadpool_tid, &threadpool_main_tid);
 
 #ifdef SWIFT_DEBUG_THREADPOOL
   if ((tp->logs = (struct mapper_log *)malloc(sizeof(struct mapper_log) *
@@ -259,6 +587,19 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
       swift_barrier_init(&tp->run_barrier, NULL, num_threads) != 0)
     error("Failed to initialize barriers.");
 
+  /* Allocate the ranges of the adaptive maps. */
+  if (swift_memalign("threadpool_ranges", (void **)&tp->job.ranges,
+                     SWIFT_CACHE_ALIGNMENT,
+                     num_threads * sizeof(struct threadpool_range)) != 0)
+    error("Failed to allocate threadpool ranges.");
+  for (int k = 0; k < num_threads; k++) {
+    if (lock_init(&tp->job.ranges[k].lock) != 0)
+      error("Failed to init threadpool range lock.");
+    tp->job.ranges[k].begin = tp->job.ranges[k].end = 0;
+  }
+  if (lock_init(&tp->nested_lock) != 0)
+    error("Failed to init threadpool nested lock.");
+
   /* Set the task counter to zero. */
   tp->map_data_size = 0;
   tp->map_data_count = 0;
@@ -289,6 +630,15 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
  * The function @c map_function is called on each element of @c map_data
  * in parallel.
  *
+ * With #threadpool_auto_chunk_size, each thread starts with an equal share
+ * of the elements and processes it in chunks sized from the time per element
+ * measured so far. Threads that run out of work steal half of the remaining
+ * elements of another thread.
+ *
+ * This function can also be called from within a mapper function, in which
+ * case the calling thread processes the elements while the idle threads of
+ * the pool steal from it.
+ *
  * @param tp The #threadpool on which to run.
  * @param map_function The function that will be applied to the map data.
  * @param map_data The data on which the mapping function will be called.
@@ -296,9 +646,9 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
  * @param stride Size, in bytes, of each element of @c map_data.
  * @param chunk Number of map data elements to pass to the function at a time,
  *        or #threadpool_auto_chunk_size to choose the number dynamically
- *        depending on the number of threads and tasks (recommended), or
- *        #threadpool_uniform_chunk_size to spread the tasks evenly over the
- *        threads in one go.
+ *        depending on the number of threads and the cost of the mapper
+ *        (recommended), or #threadpool_uniform_chunk_size to spread the tasks
+ *        evenly over the threads in one go.
  * @param extra_data Addtitional pointer that will be passed to the mapping
  *        function, may contain additional data.
  */
@@ -317,8 +667,7 @@ void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
       map_function(map_data, N, extra_data);
 
 #ifdef SWIFT_DEBUG_THREADPOOL
-      tp->map_function = map_function;
-      threadpool_log(tp, 0, N, tic_total, getticks());
+      threadpool_log(tp, map_function, 0, N, tic_total, getticks());
 #endif
     } else {
 
@@ -336,7 +685,7 @@ void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
         map_function((char *)map_data + (stride * data_count), chunk_size,
                      extra_data);
 #ifdef SWIFT_DEBUG_THREADPOOL
-        threadpool_log(tp, 0, chunk_size, tic, getticks());
+        threadpool_log(tp, map_function, 0, chunk_size, tic, getticks());
 #endif
         /* Get the next chunk and check its size. */
         data_count += chunk_size;
@@ -349,6 +698,25 @@ void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
     return;
   }
 
+  /* Called from within a mapper? Let the idle threads help. */
+  if (pthread_getspecific(threadpool_current_job) != NULL) {
+    if (N > 0)
+      threadpool_map_nested(tp, map_function, map_data, N, stride,
+                            extra_data);
+    return;
+  }
+
+  /* Adaptive chunks: share the elements evenly to start with. */
+  tp->map_adaptive = (chunk == threadpool_auto_chunk_size);
+  if (tp->map_adaptive) {
+    threadpool_job_init(tp, &tp->job, map_function, map_data, N, stride,
+                        extra_data);
+    for (int k = 0; k < tp->num_threads; k++) {
+      tp->job.ranges[k].begin = k * N / tp->num_threads;
+      tp->job.ranges[k].end = (k + 1) * N / tp->num_threads;
+    }
+  }
+
   /* Set the map data and signal the threads. */
   tp->map_data_stride = stride;
   tp->map_data_size = N;
@@ -370,17 +738,106 @@ void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
   swift_barrier_wait(&tp->run_barrier);
 
   /* Do some work while I'm at it. */
-  threadpool_chomp(tp, tp->num_threads - 1);
+  if (tp->map_adaptive)
+    threadpool_adaptive_chomp(tp, tp->num_threads - 1);
+  else
+    threadpool_chomp(tp, tp->num_threads - 1);
+
+  /* The chomp's thread ID went out of scope, restore the main one. */
+  pthread_setspecific(threadpool_tid, &threadpool_main_tid);
 
   /* Wait for all threads to be done. */
   swift_barrier_wait(&tp->wait_barrier);
 
+  if (tp->map_adaptive) threadpool_job_record(tp, &tp->job);
+
 #ifdef SWIFT_DEBUG_THREADPOOL
   /* Log the total call time to thread id -1. */
-  threadpool_log(tp, -1, N, tic_total, getticks());
+  threadpool_log(tp, map_function, -1, N, tic_total, getticks());
 #endif
 }
 
+/* Data passed through #threadpool_map by #threadpool_map_reduce. */
+struct threadpool_reduce_data {
+
+  /* The user's mapper function and extra data. */
+  threadpool_map_reduce_function map_function;
+  void *extra_data;
+
+  /* The per-thread partial results and their (padded) size. */
+  char *partials;
+  size_t partial_size;
+};
+
+/**
+ * @brief #threadpool_map function calling the user's mapper with the partial
+ * result of the current thread.
+ */
+static void threadpool_map_reduce_mapper(void *map_data, int num_elements,
+                                         void *extra_data) {
+  struct threadpool_reduce_data *data =
+      (struct threadpool_reduce_data *)extra_data;
+  const int tid = threadpool_gettid();
+  data->map_function(map_data, num_elements, data->extra_data,
+                     data->partials + tid * data->partial_size);
+}
+
+/**
+ * @brief Map a function to an array of data in parallel and reduce the
+ * results.
+ *
+ * Each thread accumulates into its own partial result, which starts as a
+ * copy of @c result. The partial results are then combined into @c result
+ * in thread order using @c reduce_function, so @c result must contain the
+ * identity of the reduction on entry.
+ *
+ * @param tp The #threadpool on which to run.
+ * @param map_function The function that will be applied to the map data. It
+ *        receives a pointer to the partial result of the calling thread.
+ * @param reduce_function The function combining a partial result into the
+ *        final result.
+ * @param map_data The data on which the mapping function will be called.
+ * @param N Number of elements in @c map_data.
+ * @param stride Size, in bytes, of each element of @c map_data.
+ * @param chunk Number of map data elements to pass to the function at a time,
+ *        see #threadpool_map.
+ * @param extra_data Addtitional pointer that will be passed to the mapping
+ *        and reduction functions.
+ * @param result The result of the reduction.
+ * @param result_size Size, in bytes, of @c result.
+ */
+void threadpool_map_reduce(struct threadpool *tp,
+                           threadpool_map_reduce_function map_function,
+                           threadpool_reduce_function reduce_function,
+                           void *map_data, size_t N, int stride, int chunk,
+                           void *extra_data, void *result,
+                           size_t result_size) {
+
+  /* Pad the partial results to avoid false sharing. */
+  struct threadpool_reduce_data data;
+  data.map_function = map_function;
+  data.extra_data = extra_data;
+  data.partial_size = ((result_size + SWIFT_CACHE_ALIGNMENT - 1) /
+                       SWIFT_CACHE_ALIGNMENT) *
+                      SWIFT_CACHE_ALIGNMENT;
+  if (swift_memalign("threadpool_partials", (void **)&data.partials,
+                     SWIFT_CACHE_ALIGNMENT,
+                     tp->num_threads * data.partial_size) != 0)
+    error("Failed to allocate partial results.");
+  for (int k = 0; k < tp->num_threads; k++)
+    memcpy(data.partials + k * data.partial_size, result, result_size);
+
+  threadpool_map(tp, threadpool_map_reduce_mapper, map_data, N, stride, chunk,
+                 &data);
+
+  /* Combine the partial results in a reproducible order. */
+  for (int k = 0; k < tp->num_threads; k++)
+    reduce_function(result, data.partials + k * data.partial_size,
+                    extra_data);
+
+  swift_free("threadpool_partials", data.partials);
+}
+
 /**
  * @brief Re-sets the log for this #threadpool.
  */
@@ -413,6 +870,12 @@ void threadpool_clean(struct threadpool *tp) {
 
     /* Clean up memory. */
     free(tp->threads);
+    for (int k = 0; k < tp->num_threads; k++)
+      if (lock_destroy(&tp->job.ranges[k].lock) != 0)
+        error("Failed to destroy threadpool range lock.");
+    swift_free("threadpool_ranges", tp->job.ranges);
+    if (lock_destroy(&tp->nested_lock) != 0)
+      error("Failed to destroy threadpool nested lock.");
   }
 
 #ifdef SWIFT_DEBUG_THREADPOOL
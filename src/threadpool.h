@@ -27,19 +27,78 @@
 #include <stddef.h>
 
 /* Local includes. */
+#include "align.h"
 #include "barrier.h"
 #include "cycle.h"
+#include "lock.h"
 
 /* Local defines. */
 #define threadpool_log_initial_size 1000
 #define threadpool_default_chunk_ratio 7
 #define threadpool_auto_chunk_size 0
 #define threadpool_uniform_chunk_size -1
+#define threadpool_adaptive_chunk_time 5e-5
+#define threadpool_max_nested_jobs 64
+#define threadpool_history_size 64
 
 /* Function type for mappings. */
 typedef void (*threadpool_map_function)(void *map_data, int num_elements,
                                         void *extra_data);
 
+/* Function types for reductions. */
+typedef void (*threadpool_map_reduce_function)(void *map_data,
+                                               int num_elements,
+                                               void *extra_data,
+                                               void *partial);
+typedef void (*threadpool_reduce_function)(void *result, const void *partial,
+                                           void *extra_data);
+
+/* A contiguous range of map data elements owned by one thread. */
+struct threadpool_range {
+
+  /* Lock protecting the range against thieves. */
+  swift_lock_type lock;
+
+  /* First element and one past the last element of the range. */
+  size_t begin, end;
+
+} __attribute__((aligned(SWIFT_CACHE_ALIGNMENT)));
+
+/* A map being processed with adaptive chunks and work-stealing. */
+struct threadpool_job {
+
+  /* The function, data and extra data of this map. */
+  threadpool_map_function map_function;
+  void *map_data, *map_extra_data;
+  size_t map_data_stride;
+
+  /* The range of elements of each thread. */
+  struct threadpool_range *ranges;
+
+  /* Number of elements not yet processed. */
+  volatile size_t remaining;
+
+  /* Time spent and number of elements processed so far. */
+  volatile ticks ticks;
+  volatile size_t count;
+
+  /* Ticks per element measured in previous calls, 0 if unknown. */
+  double history_ticks_per_element;
+
+  /* Number of threads helping with this nested job. */
+  volatile int users;
+};
+
+/* Cost of a mapper function measured in previous calls. */
+struct threadpool_history {
+
+  /* The mapper function. */
+  threadpool_map_function map_function;
+
+  /* Ticks per element. */
+  double ticks_per_element;
+};
+
 /* Data for threadpool logging. */
 struct mapper_log_entry {
 
@@ -89,6 +148,21 @@ struct threadpool {
   /* Counter for the number of threads that are done. */
   volatile int num_threads_running;
 
+  /* Top-level map being processed adaptively, if any. */
+  struct threadpool_job job;
+  int map_adaptive;
+
+  /* Nested maps that idle threads can help with. */
+  struct threadpool_job *nested_jobs[threadpool_max_nested_jobs];
+  int nr_nested_jobs;
+  swift_lock_type nested_lock;
+
+  /* Target duration of a chunk, in ticks. */
+  double chunk_ticks;
+
+  /* Cost of the recent mapper functions. */
+  struct threadpool_history history[threadpool_history_size];
+
 #ifdef SWIFT_DEBUG_THREADPOOL
   struct mapper_log *logs;
 #endif
@@ -99,6 +173,12 @@ void threadpool_init(struct threadpool *tp, int num_threads);
 void threadpool_map(struct threadpool *tp, threadpool_map_function map_function,
                     void *map_data, size_t N, int stride, int chunk,
                     void *extra_data);
+void threadpool_map_reduce(struct threadpool *tp,
+                           threadpool_map_reduce_function map_function,
+                           threadpool_reduce_function reduce_function,
+                           void *map_data, size_t N, int stride, int chunk,
+                           void *extra_data, void *result,
+                           size_t result_size);
 int threadpool_gettid(void);
 void threadpool_clean(struct threadpool *tp);
 #ifdef HAVE_SETAFFINITY
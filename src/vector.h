@@ -114,6 +114,10 @@
       1)
 #define vec_gather(base, offsets) _mm512_i32gather_ps(offsets.m, base, 1)
 
+/* Multiplies a by 2^n where n only contains integral values. */
+#define VEC_HAVE_LDEXP
+#define vec_ldexp(a, n) _mm512_scalef_ps(a, n)
+
 /* Initialises a vector struct with a default value. */
 #define FILL_VEC(a) \
   {.f[0] = a,       \
@@ -269,6 +273,12 @@
 /* Performs a left-pack on a vector based upon a mask and returns the result. */
 #define VEC_LEFT_PACK(a, mask, result) \
   vec_unaligned_store(_mm256_permutevar8x32_ps(a, mask.m), result)
+
+/* Multiplies a by 2^n where n only contains integral values. */
+#define VEC_HAVE_LDEXP
+#define vec_ldexp(a, n)                                 \
+  _mm256_castsi256_ps(_mm256_add_epi32(               \
+      _mm256_castps_si256(a), _mm256_slli_epi32(_mm256_cvtps_epi32(n), 23)))
 #endif /* HAVE_AVX2 */
 
 /* Create an FMA using vec_add and vec_mul if AVX2 is not present. */
@@ -390,6 +400,12 @@
 #define vec_dbl_fmin(a, b) _mm_min_pd(a, b)
 #define vec_dbl_fmax(a, b) _mm_max_pd(a, b)
 
+/* Multiplies a by 2^n where n only contains integral values. */
+#define VEC_HAVE_LDEXP
+#define vec_ldexp(a, n)                                 \
+  _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(a), \
+                                 _mm_slli_epi32(_mm_cvtps_epi32(n), 23)))
+
 /* Initialises a vector struct with a default value. */
 #define FILL_VEC(a) {.f[0] = a, .f[1] = a, .f[2] = a, .f[3] = a}
 
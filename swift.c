@@ -925,6 +925,11 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  /* Re-use the FFT plans measured by previous runs. This must happen before
+   * any FFTW plan is created (including when restoring from restart files). */
+  if (with_self_gravity || with_power)
+    pm_mesh_import_fftw_wisdom(restart_dir, verbose);
+
   /* Basename for any restart files. */
   char restart_name[PARSER_MAX_LINE_SIZE];
   parser_get_opt_param_string(params, "Restarts:basename", restart_name,
@@ -986,7 +991,7 @@ int main(int argc, char *argv[]) {
 #endif
 
     /* Now read it. */
-    restart_read(&e, restart_file);
+    restart_read(&e, restart_file, nr_threads);
 
 #ifdef WITH_MPI
     integertime_t min_ti_current = e.ti_current;
@@ -1248,6 +1253,10 @@ int main(int argc, char *argv[]) {
     /* Prepare struct to store metadata from ICs */
     ic_info_init(&ics_metadata, params);
 
+    /* What part of the ICs are we reading? */
+    struct partial_io_selection ic_selection;
+    partial_io_selection_init(&ic_selection, params);
+
     if (myrank == 0) clocks_gettime(&tic);
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
@@ -1258,8 +1267,11 @@ int main(int argc, char *argv[]) {
                      with_gravity, with_sinks, with_stars, with_black_holes,
                      with_cosmology, cleanup_h, cleanup_sqrt_a, cosmo.h,
                      cosmo.a, myrank, nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL,
-                     nr_threads, dry_run, remap_ids, &ics_metadata);
+                     nr_threads, dry_run, remap_ids, &ics_metadata,
+                     &ic_selection);
 #else
+    if (partial_io_selection_is_active(&ic_selection))
+      error("Reading only a part of the ICs requires parallel HDF5.");
     read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sinks, &sparts,
                    &bparts, &Ngas, &Ngpart, &Ngpart_background, &Nnupart,
                    &Nsink, &Nspart, &Nbpart, &flag_entropy_ICs, with_hydro,
@@ -1274,7 +1286,8 @@ int main(int argc, char *argv[]) {
                    &Nsink, &Nspart, &Nbpart, &flag_entropy_ICs, with_hydro,
                    with_gravity, with_sinks, with_stars, with_black_holes,
                    with_cosmology, cleanup_h, cleanup_sqrt_a, cosmo.h, cosmo.a,
-                   nr_threads, dry_run, remap_ids, &ics_metadata);
+                   nr_threads, dry_run, remap_ids, &ics_metadata,
+                   &ic_selection, talking);
 #endif
 #endif
 
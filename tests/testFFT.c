@@ -16,12 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *
  ******************************************************************************/
-
 /* Some standard headers. */
 #include <config.h>
 
-// MATTHIEU fix this test
-#if 1 || !defined(HAVE_FFTW)
+#ifndef HAVE_FFTW
 
 int main(int argc, char *argv[]) { return 0; }
 
@@ -29,441 +27,470 @@ int main(int argc, char *argv[]) { return 0; }
 
 /* Some standard headers. */
 #include <fenv.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* Includes. */
-#include "runner_doiact_fft.h"
+#include "row_major_id.h"
 #include "swift.h"
 
-__attribute__((always_inline)) INLINE static int row_major_id(int i, int j,
-                                                              int k, int N) {
-  return (((i + N) % N) * N * N + ((j + N) % N) * N + ((k + N) % N));
-}
-
-int is_close(double x, double y, double abs_err) {
-  return (abs(x - y) < abs_err);
-}
-
-int main(int argc, char *argv[]) {
-  /* Initialize CPU frequency, this also starts time. */
-  unsigned long long cpufreq = 0;
-  clocks_set_cpufreq(cpufreq);
-
-/* Choke on FP-exceptions */
-#ifdef HAVE_FE_ENABLE_EXCEPT
-  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
-#endif
+/* Size of the mesh and number of particles used in the test */
+#define N_MESH 32
+#define N_GPARTS 200
 
-  /* Make one particle */
-  int nr_gparts = 1;
-  struct gpart *gparts = NULL;
-  if (posix_memalign((void **)&gparts, gpart_align,
-                     nr_gparts * sizeof(struct gpart)) != 0)
-    error("Impossible to allocate memory for gparts.");
-  bzero(gparts, nr_gparts * sizeof(struct gpart));
-
-  gparts[0].x[0] = 0.3;
-  gparts[0].x[1] = 0.8;
-  gparts[0].x[2] = 0.2;
-  gparts[0].mass = 1.f;
-
-  /* Read the parameter file */
-  struct swift_params *params =
-      (struct swift_params *)malloc(sizeof(struct swift_params));
-  parser_read_file("fft_params.yml", params);
-
-  struct cosmology cosmo;
-  cosmology_init_no_cosmo(&cosmo);
-
-  /* Initialise the gravity properties */
-  struct gravity_props gravity_properties;
-  gravity_props_init(&gravity_properties, params, &cosmo);
-
-  /* Build the infrastructure */
-  struct space space;
-  double dim[3] = {1., 1., 1.};
-  space_init(&space, params, &cosmo, dim, NULL, gparts, NULL, 0, nr_gparts, 0,
-             1, 1, 0, 0, 1, 1, 0);
-
-  struct engine engine;
-  engine.s = &space;
-  space.e = &engine;
-  engine.time = 0.1f;
-  engine.ti_current = 0;
-  engine.ti_old = 0;
-  engine.max_active_bin = num_time_bins;
-  engine.gravity_properties = &gravity_properties;
-  engine.nr_threads = 1;
-  engine.nodeID = 0;
-  engine_rank = 0;
-  engine.verbose = 1;
-
-  struct runner runner;
-  runner.e = &engine;
-
-  /* Initialize the threadpool. */
-  threadpool_init(&engine.threadpool, engine.nr_threads);
-
-  /* Construct the space and all the multipoles. */
-  space_rebuild(&space, 1);
-
-/* Initialise the Ewald correction table */
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
-  gravity_exact_force_ewald_init(dim[0]);
-#endif
+/* Number of top-level cells along each axis for the private-tile test */
+#define CDIM_TILES 4
 
-  /* Run the FFT task */
-  runner_do_grav_fft(&runner, 1);
-
-  /* Now check that we got the right answer */
-  int nr_cells = space.nr_cells;
-  double *r = (double *)malloc(nr_cells * sizeof(double));
-  double *m = (double *)malloc(nr_cells * sizeof(double));
-  double *pot = (double *)malloc(nr_cells * sizeof(double));
-  double *pot_exact = (double *)malloc(nr_cells * sizeof(double));
-
-  FILE *file = fopen("potential.dat", "w");
-  for (int i = 0; i < nr_cells; ++i) {
-    pot[i] = space.multipoles_top[i].pot.F_000;
-    m[i] = space.multipoles_top[i].m_pole.M_000;
-    double dx =
-        nearest(space.multipoles_top[i].CoM[0] - gparts[0].x[0], dim[0]);
-    double dy =
-        nearest(space.multipoles_top[i].CoM[1] - gparts[0].x[1], dim[1]);
-    double dz =
-        nearest(space.multipoles_top[i].CoM[2] - gparts[0].x[2], dim[2]);
-
-    /* Distance */
-    r[i] = sqrt(dx * dx + dy * dy + dz * dz);
-
-    /* Potential with correction */
-    if (r[i] > 0) pot_exact[i] = 1. / r[i];
-
-#ifdef SWIFT_GRAVITY_FORCE_CHECKS
-    /* Get Ewald periodic correction */
-    double f_corr[3], pot_corr;
-    gravity_exact_force_ewald_evaluate(dx, dy, dz, f_corr, &pot_corr);
-    pot_exact[i] -= pot_corr;
+/* Maximal error on the mesh forces relative to the largest reference value */
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+#define MAX_REL_ERR 1e-3
+#define RMS_REL_ERR 1e-4
+#else
+#define MAX_REL_ERR 1e-5
+#define RMS_REL_ERR 1e-6
 #endif
 
-    fprintf(file, "%e %e %e %e\n", r[i], m[i], pot[i], pot_exact[i]);
+/**
+ * @brief Returns the index of the element #c along a line of a N^3 mesh.
+ *
+ * @param axis The axis along which the line runs.
+ * @param a The first index of the line in the other two directions.
+ * @param b The second index of the line in the other two directions.
+ * @param c The position along the line.
+ * @param N The size of the mesh along one axis.
+ */
+static size_t line_index(const int axis, const int a, const int b, const int c,
+                         const int N) {
+  switch (axis) {
+    case 0:
+      return ((size_t)c * N + a) * N + b;
+    case 1:
+      return ((size_t)a * N + c) * N + b;
+    default:
+      return ((size_t)a * N + b) * N + c;
   }
-  fclose(file);
-
-  /* Let's now check the interpolation functions */
-  int cdim[3] = {space.cdim[0], space.cdim[1], space.cdim[2]};
+}
 
-  /* Constant function --> Derivatives must be 0 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] = 1.;
-      }
-    }
-  }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-
-        if (!is_close(f->F_000, -1., 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, 0., 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
-      }
-    }
+/**
+ * @brief Brute-force un-normalised complex DFT of a N^3 mesh (in place).
+ *
+ * This is O(N^4) and only used to construct a double-precision reference
+ * independent of FFTW.
+ *
+ * @param re The real part of the mesh.
+ * @param im The imaginary part of the mesh.
+ * @param N The size of the mesh along one axis.
+ * @param sign The sign of the exponent (-1 forward, +1 backward).
+ */
+static void reference_dft(double *re, double *im, const int N,
+                          const int sign) {
+
+  double *cos_tab = malloc(N * sizeof(double));
+  double *sin_tab = malloc(N * sizeof(double));
+  double *line_re = malloc(N * sizeof(double));
+  double *line_im = malloc(N * sizeof(double));
+
+  for (int m = 0; m < N; ++m) {
+    cos_tab[m] = cos(2. * M_PI * m / N);
+    sin_tab[m] = sign * sin(2. * M_PI * m / N);
   }
 
-  /* Linear function in x --> Derivatives must be 1 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] = i / ((double)cdim[0]);
-      }
-    }
-  }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 2; i < cdim[0] - 3; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-
-        if (!is_close(f->F_000, -i / ((double)cdim[0]), 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, -1., 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
+  for (int axis = 0; axis < 3; ++axis) {
+    for (int a = 0; a < N; ++a) {
+      for (int b = 0; b < N; ++b) {
+
+        for (int c = 0; c < N; ++c) {
+          line_re[c] = re[line_index(axis, a, b, c, N)];
+          line_im[c] = im[line_index(axis, a, b, c, N)];
+        }
+
+        for (int k = 0; k < N; ++k) {
+          double sum_re = 0., sum_im = 0.;
+          for (int c = 0; c < N; ++c) {
+            const int m = (k * c) % N;
+            sum_re += line_re[c] * cos_tab[m] - line_im[c] * sin_tab[m];
+            sum_im += line_re[c] * sin_tab[m] + line_im[c] * cos_tab[m];
+          }
+          re[line_index(axis, a, b, k, N)] = sum_re;
+          im[line_index(axis, a, b, k, N)] = sum_im;
+        }
       }
     }
   }
 
-  /* Linear function in y --> Derivatives must be 1 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] = j / ((double)cdim[0]);
-      }
+  free(cos_tab);
+  free(sin_tab);
+  free(line_re);
+  free(line_im);
+}
+
+/**
+ * @brief CIC interpolation from a 2x2x2 block of a periodic mesh.
+ */
+static double reference_CIC_get(const double *mesh, const int N, const int i,
+                                const int j, const int k, const double dx,
+                                const double dy, const double dz) {
+  const double tx = 1. - dx, ty = 1. - dy, tz = 1. - dz;
+  double temp = 0.;
+  temp += mesh[row_major_id_periodic(i + 0, j + 0, k + 0, N)] * tx * ty * tz;
+  temp += mesh[row_major_id_periodic(i + 0, j + 0, k + 1, N)] * tx * ty * dz;
+  temp += mesh[row_major_id_periodic(i + 0, j + 1, k + 0, N)] * tx * dy * tz;
+  temp += mesh[row_major_id_periodic(i + 0, j + 1, k + 1, N)] * tx * dy * dz;
+  temp += mesh[row_major_id_periodic(i + 1, j + 0, k + 0, N)] * dx * ty * tz;
+  temp += mesh[row_major_id_periodic(i + 1, j + 0, k + 1, N)] * dx * ty * dz;
+  temp += mesh[row_major_id_periodic(i + 1, j + 1, k + 0, N)] * dx * dy * tz;
+  temp += mesh[row_major_id_periodic(i + 1, j + 1, k + 1, N)] * dx * dy * dz;
+  return temp;
+}
+
+/**
+ * @brief Computes the mesh accelerations and potential of a set of #gpart
+ * entirely in double precision.
+ *
+ * Follows the same steps (CIC assignment, Green function and CIC
+ * de-convolution, 5-point stencil) as the production code but uses a
+ * brute-force DFT and never stores anything in single precision.
+ *
+ * @param gparts The particles.
+ * @param count The number of particles.
+ * @param N The size of the mesh along one axis.
+ * @param box_size The size of the (cubic) box.
+ * @param r_s The gravity mesh smoothing scale.
+ * @param G Newton's constant.
+ * @param a_ref (return) The accelerations (3 per particle).
+ * @param pot_ref (return) The potentials.
+ */
+static void reference_mesh_forces(const struct gpart *gparts, const int count,
+                                  const int N, const double box_size,
+                                  const double r_s, const double G,
+                                  double *a_ref, double *pot_ref) {
+
+  const size_t N3 = (size_t)N * N * N;
+  const double fac = N / box_size;
+  double *re = calloc(N3, sizeof(double));
+  double *im = calloc(N3, sizeof(double));
+
+  /* CIC assignment */
+  for (int p = 0; p < count; ++p) {
+    double d[3];
+    int ijk[3];
+    for (int n = 0; n < 3; ++n) {
+      ijk[n] = (int)(fac * gparts[p].x[n]);
+      d[n] = fac * gparts[p].x[n] - ijk[n];
     }
+    for (int a = 0; a < 2; ++a)
+      for (int b = 0; b < 2; ++b)
+        for (int c = 0; c < 2; ++c)
+          re[row_major_id_periodic(ijk[0] + a, ijk[1] + b, ijk[2] + c, N)] +=
+              gparts[p].mass * (a ? d[0] : 1. - d[0]) *
+              (b ? d[1] : 1. - d[1]) * (c ? d[2] : 1. - d[2]);
   }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 2; j < cdim[1] - 3; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-
-        if (!is_close(f->F_000, -j / ((double)cdim[0]), 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, -1., 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
+
+  reference_dft(re, im, N, -1);
+
+  /* Green function and CIC de-convolution */
+  const double green_fac = -1. / (M_PI * box_size);
+  const double a_smooth2 = 4. * M_PI * M_PI * r_s * r_s / (box_size * box_size);
+  const double k_fac = M_PI / (double)N;
+  for (int i = 0; i < N; ++i) {
+    for (int j = 0; j < N; ++j) {
+      for (int k = 0; k < N; ++k) {
+
+        const size_t index = row_major_id_periodic(i, j, k, N);
+        const double kx = (i > N / 2 ? i - N : i);
+        const double ky = (j > N / 2 ? j - N : j);
+        const double kz = (k > N / 2 ? k - N : k);
+        const double k2 = kx * kx + ky * ky + kz * kz;
+
+        if (k2 == 0.) {
+          re[index] = 0.;
+          im[index] = 0.;
+          continue;
+        }
+
+        const double sinc_x = (kx != 0.) ? k_fac * kx / sin(k_fac * kx) : 1.;
+        const double sinc_y = (ky != 0.) ? k_fac * ky / sin(k_fac * ky) : 1.;
+        const double sinc_z = (kz != 0.) ? k_fac * kz / sin(k_fac * kz) : 1.;
+        const double CIC_cor = sinc_x * sinc_y * sinc_z;
+
+        double W = 1.;
+        fourier_kernel_long_grav_eval(k2 * a_smooth2, &W);
+        const double total_cor =
+            green_fac * W / k2 * CIC_cor * CIC_cor * CIC_cor * CIC_cor;
+
+        re[index] *= total_cor;
+        im[index] *= total_cor;
       }
     }
   }
 
-  /* Linear function in z --> Derivatives must be 1 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] = k / ((double)cdim[0]);
-      }
+  reference_dft(re, im, N, +1);
+
+  /* Interpolation back onto the particles */
+  for (int p = 0; p < count; ++p) {
+    double d[3];
+    int ijk[3];
+    for (int n = 0; n < 3; ++n) {
+      ijk[n] = (int)(fac * gparts[p].x[n]);
+      d[n] = fac * gparts[p].x[n] - ijk[n];
     }
-  }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 2; k < cdim[2] - 3; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-
-        if (!is_close(f->F_000, -k / ((double)cdim[0]), 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, -1., 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
-      }
+    const int i = ijk[0], j = ijk[1], k = ijk[2];
+
+    pot_ref[p] = G * reference_CIC_get(re, N, i, j, k, d[0], d[1], d[2]);
+
+    for (int n = 0; n < 3; ++n) {
+      const int di = (n == 0), dj = (n == 1), dk = (n == 2);
+      double a = 0.;
+      a += (1. / 12.) * reference_CIC_get(re, N, i + 2 * di, j + 2 * dj,
+                                          k + 2 * dk, d[0], d[1], d[2]);
+      a -= (2. / 3.) *
+           reference_CIC_get(re, N, i + di, j + dj, k + dk, d[0], d[1], d[2]);
+      a += (2. / 3.) *
+           reference_CIC_get(re, N, i - di, j - dj, k - dk, d[0], d[1], d[2]);
+      a -= (1. / 12.) * reference_CIC_get(re, N, i - 2 * di, j - 2 * dj,
+                                          k - 2 * dk, d[0], d[1], d[2]);
+      a_ref[3 * p + n] = G * fac * a;
     }
   }
 
-  /* Quadratic function in x --> Derivatives must be 2 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] =
-            i * i / ((double)cdim[0] * cdim[0]);
-      }
-    }
-  }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 2; i < cdim[0] - 3; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-        const double val = i / ((double)cdim[0]);
-        const double val2 = val * val;
-
-        if (!is_close(f->F_000, -val2, 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, -2 * val, 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 2.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
-      }
-    }
+  free(re);
+  free(im);
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+/* Choke on FP-exceptions */
+#ifdef HAVE_FE_ENABLE_EXCEPT
+  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+#endif
+
+  /* Initialise a few things to get us going */
+  const int seed = time(NULL);
+  message("Seed = %d", seed);
+  srand(seed);
+
+  const double dim[3] = {1., 1., 1.};
+
+  /* Physical constants in internal units */
+  struct phys_const phys_const;
+  bzero(&phys_const, sizeof(struct phys_const));
+  phys_const.const_newton_G = 1.;
+
+  /* No neutrinos */
+  struct neutrino_props neutrino_props;
+  bzero(&neutrino_props, sizeof(struct neutrino_props));
+
+  /* Gravity properties relevant to the mesh */
+  struct gravity_props grav_props;
+  bzero(&grav_props, sizeof(struct gravity_props));
+  grav_props.mesh_size = N_MESH;
+  grav_props.a_smooth = 1.25;
+  grav_props.r_cut_max_ratio = 4.5;
+  grav_props.r_cut_min_ratio = 0.1;
+  grav_props.mesh_uses_local_patches = 1;
+  grav_props.mesh_fftw_planner = 0;
+  grav_props.distributed_mesh = 0;
+  grav_props.mesh_assignment_order = 2;
+  grav_props.mesh_interlacing = 0;
+
+  /* Create a random particle distribution */
+  struct gpart *gparts = NULL;
+  if (posix_memalign((void **)&gparts, gpart_align,
+                     N_GPARTS * sizeof(struct gpart)) != 0)
+    error("Impossible to allocate memory for the gparts.");
+  bzero(gparts, N_GPARTS * sizeof(struct gpart));
+  for (int i = 0; i < N_GPARTS; ++i) {
+    gparts[i].x[0] = random_uniform(0., dim[0]);
+    gparts[i].x[1] = random_uniform(0., dim[1]);
+    gparts[i].x[2] = random_uniform(0., dim[2]);
+    gparts[i].mass = random_uniform(0.5, 1.5);
+    gparts[i].type = swift_type_dark_matter;
+    gparts[i].time_bin = 1;
   }
 
-  /* Quadratic function in y --> Derivatives must be 2 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] =
-            j * j / ((double)cdim[0] * cdim[0]);
-      }
+  /* Minimal engine and space (no cells: the mesh loops over the gparts) */
+  struct space s;
+  bzero(&s, sizeof(struct space));
+  struct engine e;
+  bzero(&e, sizeof(struct engine));
+  s.dim[0] = dim[0];
+  s.dim[1] = dim[1];
+  s.dim[2] = dim[2];
+  s.gparts = gparts;
+  s.nr_gparts = N_GPARTS;
+  s.nr_local_cells = 0;
+  s.e = &e;
+  e.s = &s;
+  e.physical_constants = &phys_const;
+  e.neutrino_properties = &neutrino_props;
+  e.gravity_properties = &grav_props;
+
+  struct threadpool tp;
+  threadpool_init(&tp, 4);
+
+  /* Compute the mesh forces with the production code */
+  struct pm_mesh mesh;
+  pm_mesh_init(&mesh, &grav_props, dim, /*nr_threads=*/1);
+  e.mesh = &mesh;
+  pm_mesh_compute_potential(&mesh, &s, &tp, /*verbose=*/1);
+
+  /* And the double-precision reference */
+  double *a_ref = malloc(3 * N_GPARTS * sizeof(double));
+  double *pot_ref = malloc(N_GPARTS * sizeof(double));
+  reference_mesh_forces(gparts, N_GPARTS, N_MESH, dim[0], mesh.r_s,
+                        phys_const.const_newton_G, a_ref, pot_ref);
+
+  /* Compare the accelerations */
+  double a_max = 0., a_err_max = 0., a_err_sum = 0.;
+  for (int i = 0; i < N_GPARTS; ++i) {
+    for (int n = 0; n < 3; ++n) {
+      const double diff = gparts[i].a_grav_mesh[n] - a_ref[3 * i + n];
+      a_max = max(a_max, fabs(a_ref[3 * i + n]));
+      a_err_max = max(a_err_max, fabs(diff));
+      a_err_sum += diff * diff;
     }
   }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 2; j < cdim[1] - 3; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-        const double val = j / ((double)cdim[0]);
-        const double val2 = val * val;
-
-        if (!is_close(f->F_000, -val2, 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, -2 * val, 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 2.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
-      }
-    }
+  const double a_err_rms = sqrt(a_err_sum / (3 * N_GPARTS));
+
+  message("Acceleration: max error = %e, rms error = %e (max |a| = %e)",
+          a_err_max / a_max, a_err_rms / a_max, a_max);
+
+  if (a_err_max > MAX_REL_ERR * a_max)
+    error("Mesh accelerations deviate too much from the reference.");
+  if (a_err_rms > RMS_REL_ERR * a_max)
+    error("Mesh accelerations deviate too much from the reference (rms).");
+
+#ifndef SWIFT_GRAVITY_NO_POTENTIAL
+
+  /* Compare the potentials */
+  double pot_max = 0., pot_err_max = 0.;
+  for (int i = 0; i < N_GPARTS; ++i) {
+    pot_max = max(pot_max, fabs(pot_ref[i]));
+    pot_err_max = max(pot_err_max, fabs(gparts[i].potential_mesh - pot_ref[i]));
   }
 
-  /* Quadratic function in z --> Derivatives must be 2 */
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 0; k < cdim[2]; ++k) {
-        pot[row_major_id(i, j, k, cdim[0])] =
-            k * k / ((double)cdim[0] * cdim[0]);
-      }
-    }
+  message("Potential: max error = %e (max |pot| = %e)", pot_err_max / pot_max,
+          pot_max);
+
+  if (pot_err_max > MAX_REL_ERR * pot_max)
+    error("Mesh potentials deviate too much from the reference.");
+#endif
+
+  /* Now group the particles in top-level cells and assign them to the mesh
+   * via private tiles, once with one thread and once with the full pool */
+  const int nr_cells = CDIM_TILES * CDIM_TILES * CDIM_TILES;
+  const double width = dim[0] / CDIM_TILES;
+  struct cell *cells = calloc(nr_cells, sizeof(struct cell));
+  int *local_cells = malloc(nr_cells * sizeof(int));
+  int *cell_offset = calloc(nr_cells + 1, sizeof(int));
+  int *cell_index = malloc(N_GPARTS * sizeof(int));
+  int *part_index = malloc(N_GPARTS * sizeof(int));
+  struct gpart *tile_gparts = NULL;
+  if (posix_memalign((void **)&tile_gparts, gpart_align,
+                     N_GPARTS * sizeof(struct gpart)) != 0)
+    error("Impossible to allocate memory for the gparts.");
+
+  for (int i = 0; i < N_GPARTS; ++i) {
+    const int ci = (int)(gparts[i].x[0] / width);
+    const int cj = (int)(gparts[i].x[1] / width);
+    const int ck = (int)(gparts[i].x[2] / width);
+    cell_index[i] = (ci * CDIM_TILES + cj) * CDIM_TILES + ck;
+    cell_offset[cell_index[i] + 1]++;
   }
-  for (int i = 0; i < nr_cells; ++i)
-    gravity_field_tensors_init(&space.multipoles_top[i].pot, engine.ti_current);
-  for (int i = 0; i < nr_cells; ++i)
-    mesh_to_multipole_CIC(&space.multipoles_top[i], pot, cdim[0], cdim[0], dim);
-  for (int i = 0; i < cdim[0]; ++i) {
-    for (int j = 0; j < cdim[1]; ++j) {
-      for (int k = 2; k < cdim[2] - 3; ++k) {
-        const struct grav_tensor *f =
-            &space.multipoles_top[row_major_id(i, j, k, cdim[0])].pot;
-        const double val = k / ((double)cdim[0]);
-        const double val2 = val * val;
-
-        if (!is_close(f->F_000, -val2, 1e-10))
-          error("Invalid value for (%d %d %d) F_000 (%e)", i, j, k, f->F_000);
-        if (!is_close(f->F_100, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_100 (%e)", i, j, k, f->F_100);
-        if (!is_close(f->F_010, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_010 (%e)", i, j, k, f->F_010);
-        if (!is_close(f->F_001, -2 * val, 1e-10))
-          error("Invalid value for (%d %d %d) F_001 (%e)", i, j, k, f->F_001);
-        if (!is_close(f->F_200, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_200 (%e)", i, j, k, f->F_200);
-        if (!is_close(f->F_020, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_020 (%e)", i, j, k, f->F_020);
-        if (!is_close(f->F_002, 2.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_002 (%e)", i, j, k, f->F_002);
-        if (!is_close(f->F_011, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_011 (%e)", i, j, k, f->F_011);
-        if (!is_close(f->F_101, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_101 (%e)", i, j, k, f->F_101);
-        if (!is_close(f->F_110, 0.f, 1e-10))
-          error("Invalid value for (%d %d %d) F_110 (%e)", i, j, k, f->F_110);
-      }
-    }
+  for (int c = 0; c < nr_cells; ++c) cell_offset[c + 1] += cell_offset[c];
+  for (int c = 0; c < nr_cells; ++c) {
+    local_cells[c] = c;
+    cells[c].loc[0] = width * (c / (CDIM_TILES * CDIM_TILES));
+    cells[c].loc[1] = width * ((c / CDIM_TILES) % CDIM_TILES);
+    cells[c].loc[2] = width * (c % CDIM_TILES);
+    cells[c].width[0] = width;
+    cells[c].width[1] = width;
+    cells[c].width[2] = width;
+    cells[c].grav.parts = &tile_gparts[cell_offset[c]];
+    cells[c].grav.count = 0;
+  }
+  for (int i = 0; i < N_GPARTS; ++i) {
+    struct cell *c = &cells[cell_index[i]];
+    part_index[cell_offset[cell_index[i]] + c->grav.count] = i;
+    c->grav.parts[c->grav.count++] = gparts[i];
   }
 
-  /* Clean up */
-  free(r);
-  free(m);
-  free(pot);
-  free(pot_exact);
-  free(params);
+  s.cdim[0] = CDIM_TILES;
+  s.cdim[1] = CDIM_TILES;
+  s.cdim[2] = CDIM_TILES;
+  s.width[0] = width;
+  s.width[1] = width;
+  s.width[2] = width;
+  s.cells_top = cells;
+  s.local_cells_top = local_cells;
+  s.nr_cells = nr_cells;
+  s.nr_local_cells = nr_cells;
+  s.gparts = tile_gparts;
+
+  grav_props.mesh_uses_local_patches = 0;
+  grav_props.mesh_uses_private_tiles = 1;
+  struct pm_mesh tile_mesh;
+  pm_mesh_init(&tile_mesh, &grav_props, dim, /*nr_threads=*/1);
+  e.mesh = &tile_mesh;
+
+  const size_t N3 = (size_t)N_MESH * N_MESH * N_MESH;
+  mesh_real *pot_serial = malloc(N3 * sizeof(mesh_real));
+  struct gpart *gparts_serial = malloc(N_GPARTS * sizeof(struct gpart));
+
+  struct threadpool tp_serial;
+  threadpool_init(&tp_serial, 1);
+  pm_mesh_compute_potential(&tile_mesh, &s, &tp_serial, /*verbose=*/0);
+  memcpy(pot_serial, tile_mesh.potential_global, N3 * sizeof(mesh_real));
+  memcpy(gparts_serial, tile_gparts, N_GPARTS * sizeof(struct gpart));
+  threadpool_clean(&tp_serial);
+
+  pm_mesh_compute_potential(&tile_mesh, &s, &tp, /*verbose=*/0);
+
+  /* The result must not depend on the number of threads... */
+  if (memcmp(pot_serial, tile_mesh.potential_global,
+             N3 * sizeof(mesh_real)) != 0)
+    error("Private-tile mesh differs between 1 and %d threads.",
+          tp.num_threads);
+  for (int i = 0; i < N_GPARTS; ++i)
+    if (memcmp(gparts_serial[i].a_grav_mesh, tile_gparts[i].a_grav_mesh,
+               sizeof(tile_gparts[i].a_grav_mesh)) != 0)
+      error("Private-tile accelerations differ between 1 and %d threads.",
+            tp.num_threads);
+
+  /* ...and must agree with the reference */
+  double tile_err_max = 0.;
+  for (int i = 0; i < N_GPARTS; ++i)
+    for (int n = 0; n < 3; ++n)
+      tile_err_max =
+          max(tile_err_max, fabs(tile_gparts[i].a_grav_mesh[n] -
+                                 a_ref[3 * part_index[i] + n]));
+
+  message("Private tiles: max acceleration error = %e", tile_err_max / a_max);
+
+  if (tile_err_max > MAX_REL_ERR * a_max)
+    error("Private-tile accelerations deviate too much from the reference.");
+
+  /* Clean everything */
+  pm_mesh_clean(&tile_mesh);
+  pm_mesh_clean(&mesh);
+  threadpool_clean(&tp);
+  free(pot_serial);
+  free(gparts_serial);
+  free(cells);
+  free(local_cells);
+  free(cell_offset);
+  free(cell_index);
+  free(part_index);
+  free(tile_gparts);
+  free(a_ref);
+  free(pot_ref);
   free(gparts);
+
   return 0;
 }
 
@@ -26,12 +26,15 @@
 #include <unistd.h>
 
 /* Local headers. */
+#include "gravity_iact.h"
 #include "runner_doiact_grav.h"
 #include "swift.h"
 
 const int num_M2L_runs = 1 << 23;
 const int num_M2P_runs = 1 << 23;
 const int num_PP_runs = 1;  // << 8;
+const int num_PP_kernel_pairs = 1 << 16;
+const int num_PP_kernel_runs = 1 << 8;
 
 void make_cell(struct cell *c, int N, const double loc[3], double width,
                int id_base, const struct gravity_props *grav_props) {
@@ -86,6 +89,123 @@ void make_cell(struct cell *c, int N, const double loc[3], double width,
   gravity_multipole_compute_power(&c->grav.multipole->m_pole);
 }
 
+#if defined(WITH_VECTORIZATION) && defined(VEC_HAVE_LDEXP) && \
+    !defined(GADGET2_SOFTENING_CORRECTION)
+
+/**
+ * @brief Times the scalar and vector P-P kernels against each other and
+ * verifies that they agree.
+ *
+ * Half of the pairs are within the softening length such that both branches
+ * of the kernels are exercised.
+ *
+ * @param truncated Use the truncated (periodic) kernels?
+ * @param r_s_inv The inverse of the gravity-mesh smoothing-scale.
+ */
+void test_pp_kernels(const int truncated, const float r_s_inv) {
+
+  const int N = num_PP_kernel_pairs;
+  float *r2 = NULL, *h2 = NULL, *h_inv = NULL, *h_inv3 = NULL, *mass = NULL;
+  float *f_scalar = NULL, *pot_scalar = NULL, *f_vec = NULL, *pot_vec = NULL;
+  if (posix_memalign((void **)&r2, SWIFT_CACHE_ALIGNMENT, N * sizeof(float)) ||
+      posix_memalign((void **)&h2, SWIFT_CACHE_ALIGNMENT, N * sizeof(float)) ||
+      posix_memalign((void **)&h_inv, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)) ||
+      posix_memalign((void **)&h_inv3, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)) ||
+      posix_memalign((void **)&mass, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)) ||
+      posix_memalign((void **)&f_scalar, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)) ||
+      posix_memalign((void **)&pot_scalar, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)) ||
+      posix_memalign((void **)&f_vec, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)) ||
+      posix_memalign((void **)&pot_vec, SWIFT_CACHE_ALIGNMENT,
+                     N * sizeof(float)))
+    error("Error allocating memory for the P-P kernel arrays.");
+
+  for (int n = 0; n < N; ++n) {
+    const float h = 0.5f + rand() / ((float)RAND_MAX);
+    const float r = 2.f * h * rand() / ((float)RAND_MAX) + 1e-3f;
+    r2[n] = r * r;
+    h2[n] = h * h;
+    h_inv[n] = 1.f / h;
+    h_inv3[n] = h_inv[n] * h_inv[n] * h_inv[n];
+    mass[n] = 1.f + rand() / ((float)RAND_MAX);
+  }
+
+  /* Scalar version */
+  ticks tic = getticks();
+  for (int k = 0; k < num_PP_kernel_runs; ++k) {
+    for (int n = 0; n < N; ++n) {
+      float f_ij, pot_ij;
+      if (truncated)
+        runner_iact_grav_pp_truncated(r2[n], h2[n], h_inv[n], h_inv3[n],
+                                      mass[n], r_s_inv, &f_ij, &pot_ij);
+      else
+        runner_iact_grav_pp_full(r2[n], h2[n], h_inv[n], h_inv3[n], mass[n],
+                                 &f_ij, &pot_ij);
+      f_scalar[n] = f_ij;
+      pot_scalar[n] = pot_ij;
+    }
+  }
+  ticks toc = getticks();
+  const double time_scalar =
+      1e6 * clocks_from_ticks(toc - tic) / num_PP_kernel_runs / N;
+
+  /* Vector version */
+  tic = getticks();
+  for (int k = 0; k < num_PP_kernel_runs; ++k) {
+    for (int n = 0; n < N; n += VEC_SIZE) {
+      vector v_r2, v_h2, v_h_inv, v_h_inv3, v_mass, v_f_ij, v_pot_ij;
+      v_r2.v = vec_load(&r2[n]);
+      v_h2.v = vec_load(&h2[n]);
+      v_h_inv.v = vec_load(&h_inv[n]);
+      v_h_inv3.v = vec_load(&h_inv3[n]);
+      v_mass.v = vec_load(&mass[n]);
+      if (truncated)
+        runner_iact_grav_pp_truncated_vec(&v_r2, &v_h2, &v_h_inv, &v_h_inv3,
+                                          &v_mass, r_s_inv, &v_f_ij,
+                                          &v_pot_ij);
+      else
+        runner_iact_grav_pp_full_vec(&v_r2, &v_h2, &v_h_inv, &v_h_inv3,
+                                     &v_mass, &v_f_ij, &v_pot_ij);
+      vec_store(v_f_ij.v, &f_vec[n]);
+      vec_store(v_pot_ij.v, &pot_vec[n]);
+    }
+  }
+  toc = getticks();
+  const double time_vec =
+      1e6 * clocks_from_ticks(toc - tic) / num_PP_kernel_runs / N;
+
+  /* Check that both versions agree */
+  for (int n = 0; n < N; ++n) {
+    if (fabsf(f_vec[n] - f_scalar[n]) > 1e-4f * fabsf(f_scalar[n]) ||
+        fabsf(pot_vec[n] - pot_scalar[n]) > 1e-4f * fabsf(pot_scalar[n]))
+      error(
+          "Vector and scalar P-P kernels disagree! r2=%e h2=%e f_ij=[%e %e] "
+          "pot_ij=[%e %e]",
+          r2[n], h2[n], f_scalar[n], f_vec[n], pot_scalar[n], pot_vec[n]);
+  }
+
+  message("%30s took %.3f (scalar) %.3f (vector) %s. Speedup: %.2fx.",
+          truncated ? "P-P truncated kernel" : "P-P full kernel", time_scalar,
+          time_vec, "ns", time_scalar / time_vec);
+
+  free(r2);
+  free(h2);
+  free(h_inv);
+  free(h_inv3);
+  free(mass);
+  free(f_scalar);
+  free(pot_scalar);
+  free(f_vec);
+  free(pot_vec);
+}
+
+#endif
+
 int main(int argc, char *argv[]) {
 
   /* Initialize CPU frequency, this also starts time. */
@@ -340,6 +460,13 @@ int main(int argc, char *argv[]) {
           SELF_GRAVITY_MULTIPOLE_ORDER,
           (int)(1e6 * clocks_from_ticks(toc - tic) / num_PP_runs), "ns");
 
+#if defined(WITH_VECTORIZATION) && defined(VEC_HAVE_LDEXP) && \
+    !defined(GADGET2_SOFTENING_CORRECTION)
+  /* Compare the explicitly vectorized P-P kernels to the scalar ones */
+  test_pp_kernels(/*truncated=*/0, r_s_inv);
+  test_pp_kernels(/*truncated=*/1, r_s_inv);
+#endif
+
   /* Be clean... */
   gravity_cache_clean(&r.ci_gravity_cache);
   gravity_cache_clean(&r.cj_gravity_cache);
@@ -0,0 +1,493 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (C) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <config.h>
+
+/* Some standard headers. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Includes. */
+#include "swift.h"
+
+#if defined(HAVE_HDF5)
+
+/* HDF5 headers. */
+#include <hdf5.h>
+
+/* Name of the file written and read by the test. */
+#define FILE_NAME "partial_input.hdf5"
+
+/* Number of top-level cells along each axis of the file. */
+#define CDIM 2
+
+/* Number of gas and DM particles per cell along each axis. */
+#define L_GAS 4
+#define L_DM 2
+
+/* Offset of the IDs of the DM particles. */
+#define ID_DM 100000
+
+/**
+ * @brief Write a particle array to a group of an HDF5 file.
+ */
+static void write_dataset(hid_t h_grp, const char *name, hid_t h_type,
+                          int dim, long long n, const void *data) {
+
+  const hsize_t shape[2] = {(hsize_t)n, (hsize_t)dim};
+  const hid_t h_space = H5Screate_simple(dim > 1 ? 2 : 1, shape, NULL);
+  const hid_t h_data = H5Dcreate(h_grp, name, h_type, h_space, H5P_DEFAULT,
+                                 H5P_DEFAULT, H5P_DEFAULT);
+  if (h_data < 0) error("Error while creating dataset '%s'.", name);
+  if (H5Dwrite(h_data, h_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) < 0)
+    error("Error while writing dataset '%s'.", name);
+  H5Dclose(h_data);
+  H5Sclose(h_space);
+}
+
+/**
+ * @brief Write the particles of one type, sorted by top-level cell, and
+ * fill their cell meta-data.
+ *
+ * @param h_file The HDF5 file.
+ * @param ptype The type of particles.
+ * @param L The number of particles per cell along each axis.
+ * @param id_offset The ID of the first particle.
+ * @param counts (return) The number of particles in each cell.
+ * @param offsets (return) The offset of the particles of each cell.
+ * @param min_pos (return) The lower corner of the particles of each cell.
+ * @param max_pos (return) The upper corner of the particles of each cell.
+ */
+static void write_particles(hid_t h_file, int ptype, int L,
+                            long long id_offset, long long *counts,
+                            long long *offsets, double *min_pos,
+                            double *max_pos) {
+
+  const int nr_cells = CDIM * CDIM * CDIM;
+  const long long N = (long long)nr_cells * L * L * L;
+  const double width = 1. / CDIM;
+
+  double *x = (double *)malloc(3 * N * sizeof(double));
+  float *v = (float *)malloc(3 * N * sizeof(float));
+  float *m = (float *)malloc(N * sizeof(float));
+  float *h = (float *)malloc(N * sizeof(float));
+  float *u = (float *)malloc(N * sizeof(float));
+  long long *ids = (long long *)malloc(N * sizeof(long long));
+  if (x == NULL || v == NULL || m == NULL || h == NULL || u == NULL ||
+      ids == NULL)
+    error("Unable to allocate the particles");
+
+  /* Particles on a grid, sorted by cell */
+  long long k = 0;
+  for (int c = 0; c < nr_cells; c++) {
+    const int ci[3] = {c / (CDIM * CDIM), (c / CDIM) % CDIM, c % CDIM};
+    counts[c] = (long long)L * L * L;
+    offsets[c] = k;
+    for (int d = 0; d < 3; d++) {
+      min_pos[3 * c + d] = ci[d] * width + 0.5 * width / L;
+      max_pos[3 * c + d] = (ci[d] + 1) * width - 0.5 * width / L;
+    }
+    for (int i = 0; i < L * L * L; i++, k++) {
+      const int pi[3] = {i / (L * L), (i / L) % L, i % L};
+      for (int d = 0; d < 3; d++) {
+        x[3 * k + d] = ci[d] * width + (pi[d] + 0.5) * width / L;
+        v[3 * k + d] = (d + 1) * 0.01f * k;
+      }
+      m[k] = 1.f + 1e-3f * k;
+      h[k] = 0.1f + 1e-4f * k;
+      u[k] = 1.f + 1e-2f * k;
+      ids[k] = id_offset + k;
+    }
+  }
+
+  char name[PARTICLE_GROUP_BUFFER_SIZE];
+  snprintf(name, PARTICLE_GROUP_BUFFER_SIZE, "/PartType%d", ptype);
+  const hid_t h_grp =
+      H5Gcreate(h_file, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (h_grp < 0) error("Error while creating group '%s'.", name);
+  write_dataset(h_grp, "Coordinates", H5T_NATIVE_DOUBLE, 3, N, x);
+  write_dataset(h_grp, "Velocities", H5T_NATIVE_FLOAT, 3, N, v);
+  write_dataset(h_grp, "Masses", H5T_NATIVE_FLOAT, 1, N, m);
+  write_dataset(h_grp, "ParticleIDs", H5T_NATIVE_LLONG, 1, N, ids);
+  if (ptype == swift_type_gas) {
+    write_dataset(h_grp, "SmoothingLength", H5T_NATIVE_FLOAT, 1, N, h);
+    write_dataset(h_grp, "InternalEnergy", H5T_NATIVE_FLOAT, 1, N, u);
+  }
+  H5Gclose(h_grp);
+
+  free(x);
+  free(v);
+  free(m);
+  free(h);
+  free(u);
+  free(ids);
+}
+
+/**
+ * @brief Write a single-file snapshot with gas and DM particles and the
+ * /Cells meta-data used to read parts of it.
+ *
+ * The gas has the envelope of the particles of each cell, the DM only the
+ * cell centres.
+ */
+static void write_file(void) {
+
+  const int nr_cells = CDIM * CDIM * CDIM;
+  const long long N_gas = (long long)nr_cells * L_GAS * L_GAS * L_GAS;
+  const long long N_dm = (long long)nr_cells * L_DM * L_DM * L_DM;
+
+  const hid_t h_file =
+      H5Fcreate(FILE_NAME, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (h_file < 0) error("Error while creating file '%s'.", FILE_NAME);
+
+  /* Header */
+  const hid_t h_header =
+      H5Gcreate(h_file, "/Header", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  const double box[3] = {1., 1., 1.};
+  long long N_total[swift_type_count] = {0};
+  long long N_high[swift_type_count] = {0};
+  unsigned int N_this[swift_type_count] = {0};
+  double mass_table[swift_type_count] = {0.};
+  N_total[swift_type_gas] = N_gas;
+  N_total[swift_type_dark_matter] = N_dm;
+  N_this[swift_type_gas] = N_gas;
+  N_this[swift_type_dark_matter] = N_dm;
+  io_write_attribute(h_header, "BoxSize", DOUBLE, box, 3);
+  io_write_attribute(h_header, "NumPart_Total", LONGLONG, N_total,
+                     swift_type_count);
+  io_write_attribute(h_header, "NumPart_Total_HighWord", LONGLONG, N_high,
+                     swift_type_count);
+  io_write_attribute(h_header, "NumPart_ThisFile", UINT, N_this,
+                     swift_type_count);
+  io_write_attribute(h_header, "MassTable", DOUBLE, mass_table,
+                     swift_type_count);
+  io_write_attribute_i(h_header, "Flag_Entropy_ICs", 0);
+  io_write_attribute_i(h_header, "NumFilesPerSnapshot", 1);
+  io_write_attribute_i(h_header, "Dimension", 3);
+  H5Gclose(h_header);
+
+  /* Particles */
+  long long counts[2][CDIM * CDIM * CDIM], offsets[2][CDIM * CDIM * CDIM];
+  double min_pos[2][3 * CDIM * CDIM * CDIM], max_pos[2][3 * CDIM * CDIM * CDIM];
+  write_particles(h_file, swift_type_gas, L_GAS, 1, counts[0], offsets[0],
+                  min_pos[0], max_pos[0]);
+  write_particles(h_file, swift_type_dark_matter, L_DM, ID_DM, counts[1],
+                  offsets[1], min_pos[1], max_pos[1]);
+
+  /* Cell meta-data */
+  const hid_t h_cells =
+      H5Gcreate(h_file, "/Cells", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  const hid_t h_meta =
+      H5Gcreate(h_cells, "Meta-data", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  const double width[3] = {1. / CDIM, 1. / CDIM, 1. / CDIM};
+  const int cdim[3] = {CDIM, CDIM, CDIM};
+  io_write_attribute(h_meta, "nr_cells", INT, &nr_cells, 1);
+  io_write_attribute(h_meta, "size", DOUBLE, width, 3);
+  io_write_attribute(h_meta, "dimension", INT, cdim, 3);
+  H5Gclose(h_meta);
+
+  double centres[3 * CDIM * CDIM * CDIM];
+  int files[CDIM * CDIM * CDIM];
+  for (int c = 0; c < nr_cells; c++) {
+    centres[3 * c + 0] = (c / (CDIM * CDIM) + 0.5) * width[0];
+    centres[3 * c + 1] = ((c / CDIM) % CDIM + 0.5) * width[1];
+    centres[3 * c + 2] = (c % CDIM + 0.5) * width[2];
+    files[c] = 0;
+  }
+  write_dataset(h_cells, "Centres", H5T_NATIVE_DOUBLE, 3, nr_cells, centres);
+
+  const char *groups[5] = {"Counts", "OffsetsInFile", "Files", "MinPositions",
+                           "MaxPositions"};
+  for (int g = 0; g < 5; g++) {
+    const hid_t h_grp =
+        H5Gcreate(h_cells, groups[g], H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    for (int t = 0; t < 2; t++) {
+      const char *name = t == 0 ? "PartType0" : "PartType1";
+      if (g == 0)
+        write_dataset(h_grp, name, H5T_NATIVE_LLONG, 1, nr_cells, counts[t]);
+      else if (g == 1)
+        write_dataset(h_grp, name, H5T_NATIVE_LLONG, 1, nr_cells, offsets[t]);
+      else if (g == 2)
+        write_dataset(h_grp, name, H5T_NATIVE_INT, 1, nr_cells, files);
+      else if (t == 0)
+        write_dataset(h_grp, name, H5T_NATIVE_DOUBLE, 3, nr_cells,
+                      g == 3 ? min_pos[t] : max_pos[t]);
+    }
+    H5Gclose(h_grp);
+  }
+  H5Gclose(h_cells);
+
+  H5Fclose(h_file);
+}
+
+/**
+ * @brief The particles read from the file.
+ */
+struct read_data {
+  struct part *parts;
+  struct gpart *gparts;
+  size_t Ngas, Ngpart, Ndm;
+};
+
+/**
+ * @brief Read the file, or a part of it.
+ *
+ * @param sel The #partial_io_selection (NULL to read everything).
+ * @param n_threads The number of threads converting the data read.
+ * @param data (return) The particles read.
+ */
+static void read_file(const struct partial_io_selection *sel,
+                      const int n_threads, struct read_data *data) {
+
+  size_t Ngpart_background = 0, Nnupart = 0, Nsink = 0, Nspart = 0,
+         Nbpart = 0;
+  int flag_entropy_ICs = -1;
+  double dim[3];
+  struct spart *sparts = NULL;
+  struct bpart *bparts = NULL;
+  struct sink *sinks = NULL;
+  struct ic_info ics_metadata;
+  strcpy(ics_metadata.group_name, "NoSUCH");
+
+  struct unit_system us;
+  units_init_cgs(&us);
+
+  data->parts = NULL;
+  data->gparts = NULL;
+  read_ic_single(FILE_NAME, &us, dim, &data->parts, &data->gparts, &sinks,
+                 &sparts, &bparts, &data->Ngas, &data->Ngpart,
+                 &Ngpart_background, &Nnupart, &Nsink, &Nspart, &Nbpart,
+                 &flag_entropy_ICs,
+                 /*with_hydro=*/1,
+                 /*with_gravity=*/1,
+                 /*with_sink=*/0,
+                 /*with_stars=*/0,
+                 /*with_black_holes=*/0,
+                 /*with_cosmology=*/0,
+                 /*cleanup_h=*/0,
+                 /*cleanup_sqrt_a=*/0,
+                 /*h=*/1., /*a=*/1., n_threads, /*dry_run=*/0,
+                 /*remap_ids=*/0, &ics_metadata, sel,
+                 /*verbose=*/0);
+
+  /* The gas is duplicated in the gparts */
+  data->Ndm = data->Ngpart - data->Ngas;
+}
+
+/**
+ * @brief Is a position in the region of a #partial_io_selection, using the
+ * top-level cells of the file and the periodicity of the box?
+ */
+static int in_region(const double x[3],
+                     const struct partial_io_selection *sel) {
+
+  if (!sel->with_region) return 1;
+
+  const double width = 1. / CDIM;
+  for (int d = 0; d < 3; d++) {
+    const double lo = floor(x[d] / width) * width;
+    const double hi = lo + width;
+    int overlaps = 0;
+    for (int shift = -1; shift <= 1; shift++)
+      if (lo + shift <= sel->region_max[d] && hi + shift >= sel->region_min[d])
+        overlaps = 1;
+    if (!overlaps) return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Compare a partial read with the full one.
+ *
+ * The particles selected in the full read, and only them, must be found in
+ * the partial read with the same values.
+ *
+ * @param full The particles of the full read.
+ * @param partial The particles of the partial read.
+ * @param sel The #partial_io_selection of the partial read.
+ * @param expected_gas The number of gas particles expected.
+ * @param expected_dm The number of DM particles expected.
+ */
+static void compare_reads(const struct read_data *full,
+                          const struct read_data *partial,
+                          const struct partial_io_selection *sel,
+                          size_t expected_gas, size_t expected_dm) {
+
+  /* Count the particles of the full read in the selection */
+  size_t count_gas = 0, count_dm = 0;
+  if (sel->read_type[swift_type_gas])
+    for (size_t i = 0; i < full->Ngas; i++)
+      if (in_region(full->parts[i].x, sel)) count_gas++;
+  if (sel->read_type[swift_type_dark_matter])
+    for (size_t i = 0; i < full->Ngpart; i++)
+      if (full->gparts[i].type == swift_type_dark_matter &&
+          in_region(full->gparts[i].x, sel))
+        count_dm++;
+
+  if (count_gas != expected_gas || partial->Ngas != expected_gas)
+    error("Wrong number of gas particles: read %zu, selected %zu, expected %zu",
+          partial->Ngas, count_gas, expected_gas);
+  if (count_dm != expected_dm || partial->Ndm != expected_dm)
+    error("Wrong number of DM particles: read %zu, selected %zu, expected %zu",
+          partial->Ndm, count_dm, expected_dm);
+
+  /* The IDs of the full read are the indices in the file (plus one) */
+  for (size_t i = 0; i < partial->Ngas; i++) {
+    const struct part *p = &partial->parts[i];
+    const long long id = p->id;
+    if (id < 1 || id > (long long)full->Ngas)
+      error("Unexpected gas particle ID %lld", id);
+
+    const struct part *q = NULL;
+    for (size_t j = 0; j < full->Ngas && q == NULL; j++)
+      if (full->parts[j].id == id) q = &full->parts[j];
+    if (q == NULL) error("Gas particle %lld not in the full read", id);
+
+    if (!in_region(p->x, sel))
+      error("Gas particle %lld read outside of the region", id);
+    for (int d = 0; d < 3; d++)
+      if (p->x[d] != q->x[d] || p->v[d] != q->v[d])
+        error("Wrong position or velocity for gas particle %lld", id);
+    if (hydro_get_mass(p) != hydro_get_mass(q) || p->h != q->h)
+      error("Wrong mass or smoothing length for gas particle %lld", id);
+  }
+
+  for (size_t i = 0; i < partial->Ngpart; i++) {
+    const struct gpart *gp = &partial->gparts[i];
+    if (gp->type != swift_type_dark_matter) continue;
+
+    const long long id = gp->id_or_neg_offset;
+    const struct gpart *gq = NULL;
+    for (size_t j = 0; j < full->Ngpart && gq == NULL; j++)
+      if (full->gparts[j].type == swift_type_dark_matter &&
+          full->gparts[j].id_or_neg_offset == id)
+        gq = &full->gparts[j];
+    if (gq == NULL) error("DM particle %lld not in the full read", id);
+
+    if (!in_region(gp->x, sel))
+      error("DM particle %lld read outside of the region", id);
+    for (int d = 0; d < 3; d++)
+      if (gp->x[d] != gq->x[d] || gp->v_full[d] != gq->v_full[d])
+        error("Wrong position or velocity for DM particle %lld", id);
+    if (gp->mass != gq->mass) error("Wrong mass for DM particle %lld", id);
+  }
+}
+
+/**
+ * @brief Free the particles of a read.
+ */
+static void clean_read(struct read_data *data) {
+  free(data->parts);
+  free(data->gparts);
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  const size_t gas_per_cell = L_GAS * L_GAS * L_GAS;
+  const size_t dm_per_cell = L_DM * L_DM * L_DM;
+  const size_t nr_cells = CDIM * CDIM * CDIM;
+
+  write_file();
+
+  /* Read everything */
+  struct read_data full;
+  read_file(NULL, /*n_threads=*/1, &full);
+  if (full.Ngas != nr_cells * gas_per_cell ||
+      full.Ndm != nr_cells * dm_per_cell)
+    error("Wrong number of particles in the full read");
+
+  struct partial_io_selection sel;
+  struct read_data partial;
+
+  /* A region within one cell */
+  partial_io_selection_init_all(&sel);
+  sel.with_region = 1;
+  for (int d = 0; d < 3; d++) {
+    sel.region_min[d] = 0.1;
+    sel.region_max[d] = 0.3;
+  }
+  read_file(&sel, /*n_threads=*/1, &partial);
+  compare_reads(&full, &partial, &sel, gas_per_cell, dm_per_cell);
+  clean_read(&partial);
+
+  /* A region across the periodic boundary, covering two cells */
+  sel.region_min[0] = 0.9;
+  sel.region_max[0] = 1.1;
+  read_file(&sel, /*n_threads=*/1, &partial);
+  compare_reads(&full, &partial, &sel, 2 * gas_per_cell, 2 * dm_per_cell);
+  clean_read(&partial);
+
+  /* The gas only */
+  partial_io_selection_init_all(&sel);
+  sel.read_type[swift_type_dark_matter] = 0;
+  read_file(&sel, /*n_threads=*/1, &partial);
+  compare_reads(&full, &partial, &sel, nr_cells * gas_per_cell, 0);
+  clean_read(&partial);
+
+  /* The gas only, in a region covering four cells */
+  sel.with_region = 1;
+  for (int d = 0; d < 3; d++) {
+    sel.region_min[d] = 0.2;
+    sel.region_max[d] = 0.8;
+  }
+  sel.region_min[2] = 0.1;
+  sel.region_max[2] = 0.2;
+  read_file(&sel, /*n_threads=*/1, &partial);
+  compare_reads(&full, &partial, &sel, 4 * gas_per_cell, 0);
+  clean_read(&partial);
+
+  /* Everything again, in chunks much smaller than the arrays, so that the
+   * next chunk is read while the current one is copied */
+  read_ic_single_set_chunk_size(1000);
+  partial_io_selection_init_all(&sel);
+  read_file(&sel, /*n_threads=*/1, &partial);
+  compare_reads(&full, &partial, &sel, nr_cells * gas_per_cell,
+                nr_cells * dm_per_cell);
+  clean_read(&partial);
+  read_file(&sel, /*n_threads=*/4, &partial);
+  compare_reads(&full, &partial, &sel, nr_cells * gas_per_cell,
+                nr_cells * dm_per_cell);
+  clean_read(&partial);
+
+  /* A region across the periodic boundary, in small chunks */
+  sel.with_region = 1;
+  for (int d = 0; d < 3; d++) {
+    sel.region_min[d] = 0.1;
+    sel.region_max[d] = 0.3;
+  }
+  sel.region_min[0] = 0.9;
+  sel.region_max[0] = 1.1;
+  read_file(&sel, /*n_threads=*/4, &partial);
+  compare_reads(&full, &partial, &sel, 2 * gas_per_cell, 2 * dm_per_cell);
+  clean_read(&partial);
+
+  clean_read(&full);
+  remove(FILE_NAME);
+
+  return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) { return 0; }
+
+#endif /* HAVE_HDF5 */
@@ -0,0 +1,326 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (C) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+/* Some standard headers. */
+#include <config.h>
+
+#if !defined(WITH_MPI) || !defined(HAVE_FFTW)
+
+int main(int argc, char *argv[]) { return 0; }
+
+#else
+
+/* Some standard headers. */
+#include <fenv.h>
+#include <math.h>
+#include <mpi.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Includes. */
+#include "swift.h"
+
+/* Number of particles used in the test */
+#define N_GPARTS 1000
+
+/* Number of top-level cells along each axis */
+#define CDIM 4
+
+/* Number of threads per rank */
+#define N_THREADS 2
+
+/* Maximal difference between the distributed and global mesh forces relative
+ * to the largest value */
+#ifdef MESH_GRAVITY_SINGLE_PRECISION
+#define MAX_REL_ERR 1e-3
+#else
+#define MAX_REL_ERR 1e-5
+#endif
+
+/* The mesh configurations tested: size, assignment order and interlacing.
+ * The odd size does not split evenly over the pencils. */
+static const int mesh_configs[][3] = {{32, 2, 0}, {30, 2, 0}, {32, 4, 1}};
+
+/**
+ * @brief Computes the mesh forces of the particles in the local cells and
+ * copies them out.
+ *
+ * @param grav_props The gravity properties selecting the kind of mesh.
+ * @param s The #space holding the particles.
+ * @param tp The #threadpool.
+ * @param a (return) The accelerations (3 per particle).
+ * @param pot (return) The potentials.
+ */
+static void compute_mesh_forces(const struct gravity_props *grav_props,
+                                struct space *s, struct threadpool *tp,
+                                double *a, double *pot) {
+
+  for (size_t i = 0; i < s->nr_gparts; ++i) {
+    s->gparts[i].a_grav_mesh[0] = 0.f;
+    s->gparts[i].a_grav_mesh[1] = 0.f;
+    s->gparts[i].a_grav_mesh[2] = 0.f;
+#ifndef SWIFT_GRAVITY_NO_POTENTIAL
+    s->gparts[i].potential_mesh = 0.f;
+#endif
+  }
+
+  struct pm_mesh mesh;
+  pm_mesh_init(&mesh, grav_props, s->dim, N_THREADS);
+  s->e->mesh = &mesh;
+  pm_mesh_compute_potential(&mesh, s, tp, /*verbose=*/0);
+
+  for (size_t i = 0; i < s->nr_gparts; ++i) {
+    for (int n = 0; n < 3; ++n) a[3 * i + n] = s->gparts[i].a_grav_mesh[n];
+#ifndef SWIFT_GRAVITY_NO_POTENTIAL
+    pot[i] = s->gparts[i].potential_mesh;
+#else
+    pot[i] = 0.;
+#endif
+  }
+
+  pm_mesh_clean(&mesh);
+  s->e->mesh = NULL;
+}
+
+/**
+ * @brief Compares the forces of the particles in the local cells with the
+ * ones obtained on the global mesh. Errors if they differ.
+ *
+ * @param what The name of the mesh being checked.
+ * @param s The #space holding the particles.
+ * @param a The accelerations to check.
+ * @param pot The potentials to check.
+ * @param a_ref The accelerations on the global mesh.
+ * @param pot_ref The potentials on the global mesh.
+ */
+static void compare_mesh_forces(const char *what, const struct space *s,
+                                const double *a, const double *pot,
+                                const double *a_ref, const double *pot_ref) {
+
+  double err[4] = {0., 0., 0., 0.};
+  for (int c = 0; c < s->nr_local_cells; ++c) {
+    const struct cell *cell = &s->cells_top[s->local_cells_top[c]];
+    const size_t offset = cell->grav.parts - s->gparts;
+    for (int k = 0; k < cell->grav.count; ++k) {
+      const size_t i = offset + k;
+      for (int n = 0; n < 3; ++n) {
+        err[0] = max(err[0], fabs(a[3 * i + n] - a_ref[3 * i + n]));
+        err[1] = max(err[1], fabs(a_ref[3 * i + n]));
+      }
+      err[2] = max(err[2], fabs(pot[i] - pot_ref[i]));
+      err[3] = max(err[3], fabs(pot_ref[i]));
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, err, 4, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+  if (engine_rank == 0)
+    message("%s: max acceleration error = %e, max potential error = %e", what,
+            err[0] / err[1], err[2] / max(err[3], FLT_MIN));
+
+  if (err[0] > MAX_REL_ERR * err[1])
+    error("%s accelerations deviate from the global mesh.", what);
+  if (err[2] > MAX_REL_ERR * err[3])
+    error("%s potentials deviate from the global mesh.", what);
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Start by initializing MPI. */
+  int res = 0, prov = 0;
+  if ((res = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &prov)) !=
+      MPI_SUCCESS)
+    error("Call to MPI_Init failed with error %i.", res);
+  int nr_nodes = 1;
+  MPI_Comm_size(MPI_COMM_WORLD, &nr_nodes);
+  MPI_Comm_rank(MPI_COMM_WORLD, &engine_rank);
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+/* Choke on FP-exceptions */
+#ifdef HAVE_FE_ENABLE_EXCEPT
+  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+#endif
+
+  /* All the ranks draw the same particles */
+  int seed = time(NULL);
+  MPI_Bcast(&seed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (engine_rank == 0) message("Seed = %d, %d ranks", seed, nr_nodes);
+  srand(seed);
+
+  const double dim[3] = {1., 1., 1.};
+
+  /* Physical constants in internal units */
+  struct phys_const phys_const;
+  bzero(&phys_const, sizeof(struct phys_const));
+  phys_const.const_newton_G = 1.;
+
+  /* No neutrinos */
+  struct neutrino_props neutrino_props;
+  bzero(&neutrino_props, sizeof(struct neutrino_props));
+
+  /* Gravity properties relevant to the mesh */
+  struct gravity_props grav_props;
+  bzero(&grav_props, sizeof(struct gravity_props));
+  grav_props.a_smooth = 1.25;
+  grav_props.r_cut_max_ratio = 4.5;
+  grav_props.r_cut_min_ratio = 0.1;
+  grav_props.mesh_uses_local_patches = 1;
+  grav_props.mesh_fftw_planner = 0;
+
+  /* Create a random particle distribution */
+  struct gpart *gparts = NULL;
+  if (posix_memalign((void **)&gparts, gpart_align,
+                     N_GPARTS * sizeof(struct gpart)) != 0)
+    error("Impossible to allocate memory for the gparts.");
+  bzero(gparts, N_GPARTS * sizeof(struct gpart));
+  for (int i = 0; i < N_GPARTS; ++i) {
+    gparts[i].x[0] = random_uniform(0., dim[0]);
+    gparts[i].x[1] = random_uniform(0., dim[1]);
+    gparts[i].x[2] = random_uniform(0., dim[2]);
+    gparts[i].mass = random_uniform(0.5, 1.5);
+    gparts[i].type = swift_type_dark_matter;
+    gparts[i].time_bin = 1;
+  }
+
+  /* Sort the particles into top-level cells */
+  const int nr_cells = CDIM * CDIM * CDIM;
+  const double width = dim[0] / CDIM;
+  struct cell *cells = calloc(nr_cells, sizeof(struct cell));
+  int *local_cells = malloc(nr_cells * sizeof(int));
+  int *cell_offset = calloc(nr_cells + 1, sizeof(int));
+  int *cell_index = malloc(N_GPARTS * sizeof(int));
+  struct gpart *cell_gparts = NULL;
+  if (posix_memalign((void **)&cell_gparts, gpart_align,
+                     N_GPARTS * sizeof(struct gpart)) != 0)
+    error("Impossible to allocate memory for the gparts.");
+
+  for (int i = 0; i < N_GPARTS; ++i) {
+    const int ci = (int)(gparts[i].x[0] / width);
+    const int cj = (int)(gparts[i].x[1] / width);
+    const int ck = (int)(gparts[i].x[2] / width);
+    cell_index[i] = (ci * CDIM + cj) * CDIM + ck;
+    cell_offset[cell_index[i] + 1]++;
+  }
+  for (int c = 0; c < nr_cells; ++c) cell_offset[c + 1] += cell_offset[c];
+
+  /* Deal the cells out to the ranks such that each rank holds particles all
+   * over the box */
+  int nr_local_cells = 0;
+  for (int c = 0; c < nr_cells; ++c) {
+    cells[c].loc[0] = width * (c / (CDIM * CDIM));
+    cells[c].loc[1] = width * ((c / CDIM) % CDIM);
+    cells[c].loc[2] = width * (c % CDIM);
+    cells[c].width[0] = width;
+    cells[c].width[1] = width;
+    cells[c].width[2] = width;
+    cells[c].grav.parts = &cell_gparts[cell_offset[c]];
+    cells[c].grav.count = 0;
+    cells[c].nodeID = c % nr_nodes;
+    if (cells[c].nodeID == engine_rank) local_cells[nr_local_cells++] = c;
+  }
+  for (int i = 0; i < N_GPARTS; ++i) {
+    struct cell *c = &cells[cell_index[i]];
+    c->grav.parts[c->grav.count++] = gparts[i];
+  }
+
+  /* Minimal engine and space */
+  struct space s;
+  bzero(&s, sizeof(struct space));
+  struct engine e;
+  bzero(&e, sizeof(struct engine));
+  s.dim[0] = dim[0];
+  s.dim[1] = dim[1];
+  s.dim[2] = dim[2];
+  s.cdim[0] = CDIM;
+  s.cdim[1] = CDIM;
+  s.cdim[2] = CDIM;
+  s.width[0] = width;
+  s.width[1] = width;
+  s.width[2] = width;
+  s.gparts = cell_gparts;
+  s.nr_gparts = N_GPARTS;
+  s.cells_top = cells;
+  s.local_cells_top = local_cells;
+  s.nr_cells = nr_cells;
+  s.nr_local_cells = nr_local_cells;
+  s.e = &e;
+  e.s = &s;
+  e.nodeID = engine_rank;
+  e.nr_nodes = nr_nodes;
+  e.physical_constants = &phys_const;
+  e.neutrino_properties = &neutrino_props;
+  e.gravity_properties = &grav_props;
+
+  struct threadpool tp;
+  threadpool_init(&tp, N_THREADS);
+
+  double *a_ref = malloc(3 * N_GPARTS * sizeof(double));
+  double *pot_ref = malloc(N_GPARTS * sizeof(double));
+  double *a = malloc(3 * N_GPARTS * sizeof(double));
+  double *pot = malloc(N_GPARTS * sizeof(double));
+
+  const int nr_configs = sizeof(mesh_configs) / sizeof(mesh_configs[0]);
+  for (int k = 0; k < nr_configs; ++k) {
+
+    grav_props.mesh_size = mesh_configs[k][0];
+    grav_props.mesh_assignment_order = mesh_configs[k][1];
+    grav_props.mesh_interlacing = mesh_configs[k][2];
+    if (engine_rank == 0)
+      message("Mesh size %d, assignment order %d, interlacing %d",
+              grav_props.mesh_size, grav_props.mesh_assignment_order,
+              grav_props.mesh_interlacing);
+
+    /* The mesh reduced over all the ranks is the reference */
+    grav_props.distributed_mesh = 0;
+    grav_props.distributed_mesh_pencils = 0;
+    compute_mesh_forces(&grav_props, &s, &tp, a_ref, pot_ref);
+
+    /* Mesh split in pencils */
+    grav_props.distributed_mesh = 1;
+    grav_props.distributed_mesh_pencils = 1;
+    compute_mesh_forces(&grav_props, &s, &tp, a, pot);
+    compare_mesh_forces("Pencil mesh", &s, a, pot, a_ref, pot_ref);
+
+#ifdef HAVE_MPI_FFTW
+    /* Mesh split in slabs by FFTW */
+    grav_props.distributed_mesh = 1;
+    grav_props.distributed_mesh_pencils = 0;
+    compute_mesh_forces(&grav_props, &s, &tp, a, pot);
+    compare_mesh_forces("Slab mesh", &s, a, pot, a_ref, pot_ref);
+#endif
+  }
+
+  /* Clean everything */
+  threadpool_clean(&tp);
+  free(a_ref);
+  free(pot_ref);
+  free(a);
+  free(pot);
+  free(cells);
+  free(local_cells);
+  free(cell_offset);
+  free(cell_index);
+  free(cell_gparts);
+  free(gparts);
+
+  return MPI_Finalize();
+}
+
+#endif
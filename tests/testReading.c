@@ -66,7 +66,8 @@ int main(int argc, char *argv[]) {
                  /*cleanup_h=*/0,
                  /*cleanup_sqrt_a=*/0,
                  /*h=*/1., /*a=*/1., /*n_threads=*/1, /*dry_run=*/0,
-                 /*remap_ids=*/0, &ics_metadata);
+                 /*remap_ids=*/0, &ics_metadata, /*selection=*/NULL,
+                 /*verbose=*/0);
 
   /* Check global properties read are correct */
   assert(dim[0] == boxSize);
@@ -0,0 +1,270 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (C) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <config.h>
+
+/* Some standard headers. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Includes. */
+#include "swift.h"
+
+/* Name of the file written and read by the test. */
+#define FILE_NAME "restart_test.rst"
+
+/* Number of doubles in the large block. It spans several of the 16 MB chunks
+ * the encoded files are compressed, hashed and read in parallel in. */
+#define N_LARGE (5 * 1024 * 1024 + 123)
+
+/* Number of ints in the small block. */
+#define N_SMALL 1000
+
+/* Number of threads reading the large block. */
+#define N_THREADS 4
+
+/* The data written to and read back from the restart files. */
+struct test_data {
+  int *small;
+  double *large;
+};
+
+/**
+ * @brief #restart_stream_function writing the test data.
+ */
+static void dump_data(void *data, FILE *stream) {
+  struct test_data *d = (struct test_data *)data;
+  restart_write_blocks(d->small, sizeof(int), N_SMALL, stream, "small",
+                       "small block");
+  restart_write_blocks(d->large, sizeof(double), N_LARGE, stream, "large",
+                       "large block");
+}
+
+/**
+ * @brief #restart_stream_function reading the test data.
+ */
+static void restore_data(void *data, FILE *stream) {
+  struct test_data *d = (struct test_data *)data;
+  restart_read_blocks(d->small, sizeof(int), N_SMALL, stream, NULL,
+                      "small block");
+  restart_read_blocks(d->large, sizeof(double), N_LARGE, stream, NULL,
+                      "large block");
+}
+
+/**
+ * @brief Allocate the arrays of a #test_data.
+ */
+static void data_init(struct test_data *d) {
+  d->small = (int *)calloc(N_SMALL, sizeof(int));
+  d->large = (double *)calloc(N_LARGE, sizeof(double));
+  if (d->small == NULL || d->large == NULL)
+    error("Failed to allocate the test data.");
+}
+
+/**
+ * @brief Free the arrays of a #test_data.
+ */
+static void data_clean(struct test_data *d) {
+  free(d->small);
+  free(d->large);
+}
+
+/**
+ * @brief Fill a #test_data with values that depend on a seed. Only the small
+ * block changes with the seed, such that delta files can refer to the large
+ * block of the base file.
+ */
+static void data_fill(struct test_data *d, const int seed) {
+  for (int i = 0; i < N_SMALL; i++) d->small[i] = seed * N_SMALL + i;
+  for (int i = 0; i < N_LARGE; i++) d->large[i] = 0.25 * (i % 1000) + i / 7;
+}
+
+/**
+ * @brief Size of a file in bytes.
+ */
+static size_t file_size(const char *name) {
+  struct stat buf;
+  if (stat(name, &buf) != 0) error("Failed to stat %s", name);
+  return buf.st_size;
+}
+
+/**
+ * @brief Read the restart file back with one and with several threads and
+ * check that we get the data that was written.
+ */
+static void check_file(const char *what, const struct test_data *ref) {
+
+  struct test_data d;
+  data_init(&d);
+
+  for (int nr_threads = 1; nr_threads <= N_THREADS;
+       nr_threads += N_THREADS - 1) {
+    bzero(d.small, N_SMALL * sizeof(int));
+    bzero(d.large, N_LARGE * sizeof(double));
+    restart_read_data(FILE_NAME, nr_threads, restore_data, &d,
+                      /*verbose=*/0);
+    if (memcmp(d.small, ref->small, N_SMALL * sizeof(int)) != 0 ||
+        memcmp(d.large, ref->large, N_LARGE * sizeof(double)) != 0)
+      error("%s restart file read with %d threads differs from the data.",
+            what, nr_threads);
+  }
+
+  message("%s restart file: %zu bytes, read back correctly.", what,
+          file_size(FILE_NAME));
+  data_clean(&d);
+}
+
+/**
+ * @brief Write a restart file with the options of the engine and check that
+ * it can be read back.
+ *
+ * @return the size of the file.
+ */
+static size_t write_and_check(struct engine *e, const char *what,
+                              struct test_data *d, const int step) {
+  e->step = step;
+  restart_write_data(e, FILE_NAME, dump_data, d);
+  restart_write_wait();
+  check_file(what, d);
+  return file_size(FILE_NAME);
+}
+
+/**
+ * @brief Flip a byte of the restart file and check that reading it fails.
+ *
+ * The file is read by a child process, as the failure aborts it.
+ */
+static void check_corruption_detected(const char *what, const size_t offset) {
+
+  FILE *file = fopen(FILE_NAME, "r+");
+  if (file == NULL) error("Failed to open %s", FILE_NAME);
+  unsigned char byte;
+  if (fseek(file, offset, SEEK_SET) != 0 || fread(&byte, 1, 1, file) != 1)
+    error("Failed to read %s", FILE_NAME);
+  byte ^= 0x10;
+  if (fseek(file, offset, SEEK_SET) != 0 || fwrite(&byte, 1, 1, file) != 1)
+    error("Failed to write %s", FILE_NAME);
+  fclose(file);
+
+  for (int nr_threads = 1; nr_threads <= N_THREADS;
+       nr_threads += N_THREADS - 1) {
+
+    message("Reading a corrupted %s file with %d threads, expect an error:",
+            what, nr_threads);
+    fflush(stdout);
+
+    const pid_t pid = fork();
+    if (pid < 0) error("Failed to fork.");
+    if (pid == 0) {
+      struct test_data d;
+      data_init(&d);
+      restart_read_data(FILE_NAME, nr_threads, restore_data, &d,
+                        /*verbose=*/0);
+      _exit(0);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) != pid) error("Failed to wait for child.");
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      error("Corrupted %s restart file was read without error.", what);
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+  /* Only the restart options of the engine are used. */
+  struct engine *e = (struct engine *)calloc(1, sizeof(struct engine));
+  if (e == NULL) error("Failed to allocate the engine.");
+
+  struct test_data d;
+  data_init(&d);
+  data_fill(&d, 0);
+
+  /* Plain file. */
+  const size_t plain_size = write_and_check(e, "Plain", &d, 0);
+
+  /* Index and checksums. */
+  e->restart_checksums = 1;
+  write_and_check(e, "Checksummed", &d, 0);
+  check_corruption_detected("checksummed", plain_size / 2);
+  e->restart_checksums = 0;
+
+#ifdef HAVE_ZLIB
+  /* Compressed. */
+  e->restart_compression = 6;
+  const size_t compressed_size = write_and_check(e, "Compressed", &d, 0);
+  if (compressed_size >= plain_size)
+    error("Compressed restart file is not smaller than the plain one.");
+  check_corruption_detected("compressed", compressed_size / 2);
+  e->restart_compression = 0;
+#endif
+
+  /* Delta files, with a full one every third dump. */
+  e->restart_delta_full_every = 3;
+  char base_name[200];
+  for (int step = 1; step <= 4; step++) {
+    data_fill(&d, step);
+    const int full = (step == 1 || step == 4);
+    const size_t size =
+        write_and_check(e, full ? "Full delta" : "Delta", &d, step);
+
+    /* Full files become the base, the others only hold the small block. */
+    sprintf(base_name, "%s.base-%08d", FILE_NAME, step);
+    if (full && access(base_name, F_OK) != 0)
+      error("Full delta restart file did not make the base file %s.",
+            base_name);
+    if (!full && size >= N_LARGE * sizeof(double))
+      error("Delta restart file contains the unchanged large block.");
+  }
+  e->restart_delta_full_every = 0;
+
+  /* Remove the base files. */
+  sprintf(base_name, "%s.base-%08d", FILE_NAME, 1);
+  unlink(base_name);
+  sprintf(base_name, "%s.base-%08d", FILE_NAME, 4);
+  unlink(base_name);
+
+  /* Written in the background, with a staging buffer smaller than the large
+   * block. */
+  e->restart_async = 1;
+  e->restart_async_buffer_size = 8 * 1024 * 1024;
+  data_fill(&d, 5);
+  write_and_check(e, "Asynchronous", &d, 5);
+
+#ifdef HAVE_ZLIB
+  e->restart_compression = 1;
+  write_and_check(e, "Asynchronous compressed", &d, 5);
+  e->restart_compression = 0;
+#endif
+  e->restart_async = 0;
+
+  /* Clean everything */
+  unlink(FILE_NAME);
+  data_clean(&d);
+  free(e);
+
+  return 0;
+}
@@ -0,0 +1,587 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (C) 2026 agent (agent@local).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#include <config.h>
+
+/* Some standard headers. */
+#include <fenv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local headers. */
+#include "runner_doiact_hydro_vec.h"
+#include "space_getsid.h"
+#include "swift.h"
+
+#ifdef WITH_SPHENIX_VECTORIZATION
+
+#define NODE_ID 0
+
+/* Relative difference allowed between the scalar and vector loops, which
+ * read the positions from the caches in single precision. */
+#define REL_TOL 5e-3f
+
+/* Difference allowed relative to the largest magnitude of a field, for the
+ * values near zero. */
+#define ABS_TOL 1e-3f
+
+/* Maximal number of particle fields compared after a loop. */
+#define MAX_FIELDS 8
+
+/* The loops compared by the test. */
+enum loop_type { loop_density, loop_gradient, loop_force, loop_count };
+
+static const char *loop_names[loop_count] = {"density", "gradient", "force"};
+
+/* Typdef function pointers for the interaction functions. */
+typedef void (*self_func)(struct runner *, struct cell *);
+typedef void (*pair_func)(struct runner *, struct cell *, struct cell *,
+                          const int, const double *);
+
+/* The scalar loops are not declared in any header. */
+void runner_doself1_density(struct runner *r, struct cell *c);
+void runner_doself1_gradient(struct runner *r, struct cell *c);
+void runner_doself2_force(struct runner *r, struct cell *c);
+void runner_dopair1_density(struct runner *r, struct cell *ci, struct cell *cj,
+                            const int sid, const double *shift);
+void runner_dopair1_gradient(struct runner *r, struct cell *ci,
+                             struct cell *cj, const int sid,
+                             const double *shift);
+void runner_dopair2_force(struct runner *r, struct cell *ci, struct cell *cj,
+                          const int sid, const double *shift);
+
+static const self_func scalar_self[loop_count] = {
+    runner_doself1_density, runner_doself1_gradient, runner_doself2_force};
+static const self_func vector_self[loop_count] = {
+    runner_doself_vec_density, runner_doself_vec_gradient,
+    runner_doself_vec_force};
+static const pair_func scalar_pair[loop_count] = {
+    runner_dopair1_density, runner_dopair1_gradient, runner_dopair2_force};
+static const pair_func vector_pair[loop_count] = {
+    runner_dopair_vec_density, runner_dopair_vec_gradient,
+    runner_dopair_vec_force};
+
+/* Time spent in the scalar and vector version of each loop. */
+static ticks scalar_ticks[loop_count], vector_ticks[loop_count];
+
+/**
+ * @brief Constructs a cell and all of its particles in a valid state prior to
+ * a density calculation.
+ *
+ * @param n The cube root of the number of particles.
+ * @param offset The position of the cell offset from (0,0,0).
+ * @param size The cell size.
+ * @param h The smoothing length of the particles in units of the inter-particle
+ * separation.
+ * @param partId The running counter of IDs.
+ * @param pert The perturbation to apply to the particles in the cell in units
+ * of the inter-particle separation.
+ * @param h_pert The perturbation to apply to the smoothing length.
+ * @param fraction_active The fraction of particles that should be active in the
+ * cell.
+ */
+static struct cell *make_cell(size_t n, const double *offset, double size,
+                              double h, long long *partId, double pert,
+                              double h_pert, double fraction_active) {
+  const size_t count = n * n * n;
+  const double volume = size * size * size;
+  float h_max = 0.f;
+  struct cell *cell = NULL;
+  if (posix_memalign((void **)&cell, cell_align, sizeof(struct cell)) != 0)
+    error("Couldn't allocate the cell");
+  bzero(cell, sizeof(struct cell));
+
+  if (posix_memalign((void **)&cell->hydro.parts, part_align,
+                     count * sizeof(struct part)) != 0)
+    error("couldn't allocate particles, no. of particles: %d", (int)count);
+  bzero(cell->hydro.parts, count * sizeof(struct part));
+  if (posix_memalign((void **)&cell->hydro.xparts, xpart_align,
+                     count * sizeof(struct xpart)) != 0)
+    error("couldn't allocate x particles, no. of particles: %d", (int)count);
+  bzero(cell->hydro.xparts, count * sizeof(struct xpart));
+
+  /* Construct the parts */
+  struct part *part = cell->hydro.parts;
+  struct xpart *xpart = cell->hydro.xparts;
+  for (size_t x = 0; x < n; ++x) {
+    for (size_t y = 0; y < n; ++y) {
+      for (size_t z = 0; z < n; ++z) {
+        part->x[0] =
+            offset[0] +
+            size * (x + 0.5 + random_uniform(-0.5, 0.5) * pert) / (float)n;
+        part->x[1] =
+            offset[1] +
+            size * (y + 0.5 + random_uniform(-0.5, 0.5) * pert) / (float)n;
+        part->x[2] =
+            offset[2] +
+            size * (z + 0.5 + random_uniform(-0.5, 0.5) * pert) / (float)n;
+        part->v[0] = random_uniform(-0.05, 0.05);
+        part->v[1] = random_uniform(-0.05, 0.05);
+        part->v[2] = random_uniform(-0.05, 0.05);
+        part->h = size * h * random_uniform(1.f, h_pert) / (float)n;
+        h_max = fmaxf(h_max, part->h);
+        part->id = ++(*partId);
+        part->mass = volume / count;
+
+        /* Vary the internal energy to get non-zero diffusion terms */
+        part->u = random_uniform(0.9, 1.1);
+
+        hydro_first_init_part(part, xpart);
+
+        /* Set the time-bin */
+        if (random_uniform(0, 1.f) < fraction_active)
+          part->time_bin = 1;
+        else
+          part->time_bin = num_time_bins + 1;
+
+#ifdef SWIFT_DEBUG_CHECKS
+        part->ti_drift = 8;
+        part->ti_kick = 8;
+#endif
+
+        ++part;
+        ++xpart;
+      }
+    }
+  }
+
+  /* Cell properties */
+  cell->split = 0;
+  cell->hydro.h_max = h_max;
+  cell->hydro.count = count;
+  cell->width[0] = size;
+  cell->width[1] = size;
+  cell->width[2] = size;
+  cell->dmin = size;
+  cell->loc[0] = offset[0];
+  cell->loc[1] = offset[1];
+  cell->loc[2] = offset[2];
+
+  cell->hydro.super = cell;
+  cell->hydro.ti_old_part = 8;
+  cell->hydro.ti_end_min = 8;
+  cell->nodeID = NODE_ID;
+
+  shuffle_particles(cell->hydro.parts, cell->hydro.count);
+
+  cell->hydro.sorted = 0;
+  cell->hydro.sort = NULL;
+
+  return cell;
+}
+
+/**
+ * @brief Frees a cell made by make_cell().
+ */
+static void clean_up(struct cell *c) {
+  cell_free_hydro_sorts(c);
+  free(c->hydro.parts);
+  free(c->hydro.xparts);
+  free(c);
+}
+
+/**
+ * @brief Prepares the particles of a cell for the given loop, using the
+ * results of the previous one.
+ */
+static void prepare_loop(struct cell *c, const struct engine *e,
+                         enum loop_type loop) {
+
+  for (int k = 0; k < c->hydro.count; k++) {
+    struct part *p = &c->hydro.parts[k];
+    struct xpart *xp = &c->hydro.xparts[k];
+
+    switch (loop) {
+      case loop_density:
+        hydro_init_part(p, NULL);
+        break;
+      case loop_gradient:
+        hydro_end_density(p, e->cosmology);
+        hydro_prepare_gradient(p, xp, e->cosmology, e->hydro_properties,
+                               e->pressure_floor_props);
+        break;
+      case loop_force:
+        hydro_end_gradient(p);
+        hydro_prepare_force(p, xp, e->cosmology, e->hydro_properties,
+                            e->pressure_floor_props, 0., 0.);
+        hydro_reset_acceleration(p);
+        break;
+      default:
+        error("Unknown loop");
+    }
+  }
+}
+
+/**
+ * @brief Collects the fields of a particle updated by the given loop.
+ *
+ * @return The number of fields.
+ */
+static int get_fields(const struct part *p, enum loop_type loop, float *f,
+                      const char **names) {
+
+  int n = 0;
+#define ADD_FIELD(field) \
+  names[n] = #field;     \
+  f[n++] = p->field;
+
+  switch (loop) {
+    case loop_density:
+      ADD_FIELD(rho);
+      ADD_FIELD(density.rho_dh);
+      ADD_FIELD(density.wcount);
+      ADD_FIELD(density.wcount_dh);
+      ADD_FIELD(viscosity.div_v);
+      ADD_FIELD(density.rot_v[0]);
+      ADD_FIELD(density.rot_v[1]);
+      ADD_FIELD(density.rot_v[2]);
+      break;
+    case loop_gradient:
+      ADD_FIELD(viscosity.v_sig);
+      ADD_FIELD(diffusion.laplace_u);
+      ADD_FIELD(force.alpha_visc_max_ngb);
+      break;
+    case loop_force:
+      ADD_FIELD(a_hydro[0]);
+      ADD_FIELD(a_hydro[1]);
+      ADD_FIELD(a_hydro[2]);
+      ADD_FIELD(u_dt);
+      ADD_FIELD(force.h_dt);
+      ADD_FIELD(viscosity.v_sig);
+      break;
+    default:
+      error("Unknown loop");
+  }
+#undef ADD_FIELD
+
+  return n;
+}
+
+/**
+ * @brief Compares the particles after the scalar and vector loops.
+ *
+ * Differences are measured relative to the larger of the two values, or to the
+ * largest magnitude of the field for the sums that cancel out.
+ *
+ * @return The number of values that differ by more than the tolerances.
+ */
+static int compare_parts(const struct part *parts_s, const struct part *parts_v,
+                         int count, enum loop_type loop) {
+
+  float f_s[MAX_FIELDS], f_v[MAX_FIELDS], scale[MAX_FIELDS] = {0.f};
+  const char *names[MAX_FIELDS];
+
+  /* Typical magnitude of each field */
+  int nr_fields = 0;
+  for (int k = 0; k < count; k++) {
+    nr_fields = get_fields(&parts_s[k], loop, f_s, names);
+    for (int i = 0; i < nr_fields; i++)
+      scale[i] = fmaxf(scale[i], fabsf(f_s[i]));
+  }
+
+  int errors = 0;
+  for (int k = 0; k < count; k++) {
+    get_fields(&parts_s[k], loop, f_s, names);
+    get_fields(&parts_v[k], loop, f_v, names);
+
+    for (int i = 0; i < nr_fields; i++) {
+      const float diff = fabsf(f_s[i] - f_v[i]);
+      const float norm = fmaxf(fabsf(f_s[i]), fabsf(f_v[i]));
+      if (diff > REL_TOL * norm && diff > ABS_TOL * scale[i]) {
+        message("%s: particle %lld, %s: scalar=%e vector=%e",
+                loop_names[loop], parts_s[k].id, names[i], f_s[i], f_v[i]);
+        errors++;
+      }
+    }
+  }
+
+  return errors;
+}
+
+/**
+ * @brief Runs one loop over a cell or a pair of cells with the scalar and
+ * vector functions, starting from the same particles, and compares them.
+ *
+ * The particles are left as computed by the scalar loop, ready for the
+ * next one.
+ *
+ * @param runner The #runner.
+ * @param ci The first #cell.
+ * @param cj The second #cell, NULL for a self-interaction.
+ * @param loop The loop to run.
+ * @param runs The number of times each version is run for the timings.
+ *
+ * @return The number of values that differ.
+ */
+static int test_loop(struct runner *runner, struct cell *ci, struct cell *cj,
+                     enum loop_type loop, int runs) {
+
+  const struct engine *e = runner->e;
+
+  /* Get the sort ID. */
+  double shift[3] = {0.0, 0.0, 0.0};
+  int sid = 0;
+  if (cj != NULL) sid = space_getsid_and_swap_cells(e->s, &ci, &cj, shift);
+
+  prepare_loop(ci, e, loop);
+  if (cj != NULL) prepare_loop(cj, e, loop);
+
+  /* Keep the input of the loop. */
+  const int count_i = ci->hydro.count;
+  const int count_j = cj != NULL ? cj->hydro.count : 0;
+  const size_t size_i = count_i * sizeof(struct part);
+  const size_t size_j = count_j * sizeof(struct part);
+  struct part *input = (struct part *)malloc(size_i + size_j);
+  struct part *results[2];
+  results[0] = (struct part *)malloc(size_i + size_j);
+  results[1] = (struct part *)malloc(size_i + size_j);
+  if (input == NULL || results[0] == NULL || results[1] == NULL)
+    error("Failed to allocate particles");
+  memcpy(input, ci->hydro.parts, size_i);
+  if (cj != NULL) memcpy(input + count_i, cj->hydro.parts, size_j);
+
+  /* Run the scalar (v = 0) and vector (v = 1) versions. */
+  for (int v = 0; v < 2; v++) {
+    for (int run = 0; run < runs; run++) {
+
+      /* Start again from the input. */
+      memcpy(ci->hydro.parts, input, size_i);
+      if (cj != NULL) memcpy(cj->hydro.parts, input + count_i, size_j);
+
+      const ticks tic = getticks();
+      if (cj == NULL && v == 0)
+        scalar_self[loop](runner, ci);
+      else if (cj == NULL)
+        vector_self[loop](runner, ci);
+      else if (v == 0)
+        scalar_pair[loop](runner, ci, cj, sid, shift);
+      else
+        vector_pair[loop](runner, ci, cj, sid, shift);
+      const ticks toc = getticks();
+
+      if (v == 0)
+        scalar_ticks[loop] += toc - tic;
+      else
+        vector_ticks[loop] += toc - tic;
+    }
+
+    memcpy(results[v], ci->hydro.parts, size_i);
+    if (cj != NULL) memcpy(results[v] + count_i, cj->hydro.parts, size_j);
+  }
+
+  /* Compare both cells at once so that the scale of the fields includes the
+   * particles of the pair that see most neighbours. */
+  const int errors =
+      compare_parts(results[0], results[1], count_i + count_j, loop);
+
+  /* Carry on from the scalar result. */
+  memcpy(ci->hydro.parts, results[0], size_i);
+  if (cj != NULL) memcpy(cj->hydro.parts, results[0] + count_i, size_j);
+
+  free(input);
+  free(results[0]);
+  free(results[1]);
+  return errors;
+}
+
+/**
+ * @brief Runs the density, gradient and force loops over a cell or a pair of
+ * cells and compares the scalar and vector versions.
+ */
+static int test_all_loops(struct runner *runner, const double *offset_j,
+                          size_t n_i, size_t n_j, double h, long long *partId,
+                          double pert, double h_pert, double active_i,
+                          double active_j, int runs) {
+
+  const double offset_i[3] = {0., 0., 0.};
+  struct cell *ci =
+      make_cell(n_i, offset_i, 1., h, partId, pert, h_pert, active_i);
+  struct cell *cj = NULL;
+  if (offset_j != NULL)
+    cj = make_cell(n_j, offset_j, 1., h, partId, pert, h_pert, active_j);
+
+  /* The particles do not move so one sort is enough. */
+  if (cj != NULL) {
+    runner_do_hydro_sort(runner, ci, 0x1FFF, 0, 0, 0);
+    runner_do_hydro_sort(runner, cj, 0x1FFF, 0, 0, 0);
+  }
+
+  int errors = 0;
+  for (int loop = 0; loop < loop_count; loop++)
+    errors += test_loop(runner, ci, cj, (enum loop_type)loop, runs);
+
+  clean_up(ci);
+  if (cj != NULL) clean_up(cj);
+
+  return errors;
+}
+
+int main(int argc, char *argv[]) {
+  size_t particles = 6;
+  int runs = 10;
+  double h = 1.23485, perturbation = 0.1, h_pert = 1.1;
+  struct space space;
+  struct engine engine;
+  struct cosmology cosmo;
+  struct hydro_props hydro_props;
+  struct pressure_floor_props pressure_floor;
+  struct phys_const prog_const;
+  struct runner *runner;
+  static long long partId = 0;
+
+  /* Initialize CPU frequency, this also starts time. */
+  unsigned long long cpufreq = 0;
+  clocks_set_cpufreq(cpufreq);
+
+/* Choke on FP-exceptions */
+#ifdef HAVE_FE_ENABLE_EXCEPT
+  feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW);
+#endif
+
+  /* Generate a RNG seed from time. */
+  unsigned int seed = time(NULL);
+
+  int c;
+  while ((c = getopt(argc, argv, "h:p:n:r:d:s:")) != -1) {
+    switch (c) {
+      case 'h':
+        sscanf(optarg, "%lf", &h);
+        break;
+      case 'p':
+        sscanf(optarg, "%lf", &h_pert);
+        break;
+      case 'n':
+        sscanf(optarg, "%zu", &particles);
+        break;
+      case 'r':
+        sscanf(optarg, "%d", &runs);
+        break;
+      case 'd':
+        sscanf(optarg, "%lf", &perturbation);
+        break;
+      case 's':
+        sscanf(optarg, "%u", &seed);
+        break;
+      case '?':
+        error("Unknown option.");
+        break;
+    }
+  }
+
+  if (h < 0 || particles == 0 || runs <= 0) {
+    printf(
+        "\nUsage: %s [OPTIONS...]\n"
+        "\nCompares the scalar and vector SPHENIX loops on cells filled with"
+        "\nparticles on a perturbed Cartesian grid."
+        "\n\nOptions:"
+        "\n-n PARTICLES=6     - particles per axis"
+        "\n-r RUNS=10         - runs of each loop for the timings"
+        "\n-h DISTANCE=1.2348 - smoothing length"
+        "\n-p                 - Random fractional change in h, h=h*random(1,p)"
+        "\n-d pert            - perturbation to apply to the particles [0,1["
+        "\n-s seed            - seed for RNG\n",
+        argv[0]);
+    exit(1);
+  }
+
+  /* Seed RNG. */
+  message("Seed used for RNG: %d", seed);
+  srand(seed);
+
+  bzero(&space, sizeof(struct space));
+  space.periodic = 0;
+  space.dim[0] = 3.;
+  space.dim[1] = 3.;
+  space.dim[2] = 3.;
+
+  bzero(&engine, sizeof(struct engine));
+  engine.s = &space;
+  engine.time = 0.1f;
+  engine.ti_current = 8;
+  engine.max_active_bin = num_time_bins;
+  engine.nodeID = NODE_ID;
+
+  prog_const.const_vacuum_permeability = 1.0;
+  engine.physical_constants = &prog_const;
+  cosmology_init_no_cosmo(&cosmo);
+  engine.cosmology = &cosmo;
+  hydro_props_init_no_hydro(&hydro_props);
+  engine.hydro_properties = &hydro_props;
+  bzero(&pressure_floor, sizeof(struct pressure_floor_props));
+  engine.pressure_floor_props = &pressure_floor;
+
+  if (posix_memalign((void **)&runner, SWIFT_STRUCT_ALIGNMENT,
+                     sizeof(struct runner)) != 0)
+    error("couldn't allocate runner");
+  bzero(runner, sizeof(struct runner));
+  runner->e = &engine;
+  cache_init(&runner->ci_cache, 512);
+  cache_init(&runner->cj_cache, 512);
+
+  int errors = 0;
+
+  /* Self-interactions, all and half of the particles active. */
+  errors += test_all_loops(runner, NULL, particles, 0, h, &partId,
+                           perturbation, h_pert, 1., 0., runs);
+  errors += test_all_loops(runner, NULL, particles, 0, h, &partId,
+                           perturbation, h_pert, 0.5, 0., runs);
+
+  /* Pairs sharing a face and an edge. Corners are always done by the scalar
+   * loops. */
+  const double offsets[2][3] = {{1., 0., 0.}, {1., 1., 0.}};
+  for (int k = 0; k < 2; k++) {
+    errors += test_all_loops(runner, offsets[k], particles, particles, h,
+                             &partId, perturbation, h_pert, 1., 1., runs);
+    errors += test_all_loops(runner, offsets[k], particles, particles, h,
+                             &partId, perturbation, h_pert, 0.5, 0.5, runs);
+    errors += test_all_loops(runner, offsets[k], particles, particles, h,
+                             &partId, perturbation, h_pert, 1., 0., runs);
+    errors += test_all_loops(runner, offsets[k], particles + 2, particles,
+                             h, &partId, perturbation, h_pert, 0.1, 0.75,
+                             runs);
+  }
+
+  for (int loop = 0; loop < loop_count; loop++)
+    message("%-8s scalar: %8.3f %s, vector: %8.3f %s, speed-up: %.2f",
+            loop_names[loop], clocks_from_ticks(scalar_ticks[loop]),
+            clocks_getunit(), clocks_from_ticks(vector_ticks[loop]),
+            clocks_getunit(),
+            (double)scalar_ticks[loop] / (double)vector_ticks[loop]);
+
+  cache_clean(&runner->ci_cache);
+  cache_clean(&runner->cj_cache);
+  free(runner);
+
+  if (errors > 0)
+    error("%d values differ between the scalar and vector loops", errors);
+
+  return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+
+  message("The SPHENIX loops are not vectorised in this configuration.");
+  return 0;
+}
+
+#endif /* WITH_SPHENIX_VECTORIZATION */
@@ -23,6 +23,7 @@
 // Standard includes.
 #include <stdio.h>
 #include <stdlib.h>
+#include <strings.h>
 #include <unistd.h>
 
 // Local includes.
@@ -70,6 +71,30 @@ void map_function_check_uniform(void *map_data, int num_elements,
   printf("    map_function_check_uniform handled %d elements\n", num_elements);
 }
 
+void map_function_count(void *map_data, int num_elements, void *extra_data) {
+  int *visits = (int *)map_data;
+  for (int ind = 0; ind < num_elements; ind++) atomic_inc(&visits[ind]);
+}
+
+void map_function_nested(void *map_data, int num_elements, void *extra_data) {
+  struct threadpool *tp = (struct threadpool *)extra_data;
+  int **rows = (int **)map_data;
+  for (int ind = 0; ind < num_elements; ind++)
+    threadpool_map(tp, map_function_count, rows[ind], 1000, sizeof(int),
+                   threadpool_auto_chunk_size, NULL);
+}
+
+void map_function_sum(void *map_data, int num_elements, void *extra_data,
+                      void *partial) {
+  const int *inputs = (int *)map_data;
+  for (int ind = 0; ind < num_elements; ind++)
+    *(long long *)partial += inputs[ind];
+}
+
+void reduce_function_sum(void *result, const void *partial, void *extra_data) {
+  *(long long *)result += *(const long long *)partial;
+}
+
 int main(int argc, char *argv[]) {
 
   // Some constants for this test.
@@ -169,5 +194,55 @@ int main(int argc, char *argv[]) {
 
   printf("# passed uniform checks\n");
 
+  printf("# threadpool_auto_chunk_size checks\n");
+
+  /* Check that every element is processed exactly once, also in nested maps,
+   * and that the reductions add up. */
+  const int num_rows = 50;
+  int *rows[num_rows];
+  int *visits = (int *)calloc(num_rows * 1000, sizeof(int));
+  for (int k = 0; k < num_rows; k++) rows[k] = &visits[k * 1000];
+  int *values = (int *)malloc(100000 * sizeof(int));
+  for (int k = 0; k < 100000; k++) values[k] = k;
+
+  for (int num_thread = 1; num_thread <= 16; num_thread *= 2) {
+    struct threadpool atp;
+    threadpool_init(&atp, num_thread);
+
+    for (int run = 0; run < 3; run++) {
+      bzero(visits, num_rows * 1000 * sizeof(int));
+      threadpool_map(&atp, map_function_count, visits, num_rows * 1000,
+                     sizeof(int), threadpool_auto_chunk_size, NULL);
+      threadpool_map(&atp, map_function_nested, rows, num_rows,
+                     sizeof(int *), threadpool_auto_chunk_size, &atp);
+      for (int k = 0; k < num_rows * 1000; k++) {
+        if (visits[k] != 2) {
+          printf("  auto chunking not correct, element %d visited %d times\n",
+                 k, visits[k]);
+          fflush(stdout);
+          exit(1);
+        }
+      }
+
+      long long total = 0;
+      threadpool_map_reduce(&atp, map_function_sum, reduce_function_sum,
+                            values, 100000, sizeof(int),
+                            threadpool_auto_chunk_size, NULL, &total,
+                            sizeof(long long));
+      if (total != 100000LL * 99999LL / 2) {
+        printf("  reduction not correct (%lld != %lld).\n", total,
+               100000LL * 99999LL / 2);
+        fflush(stdout);
+        exit(1);
+      }
+    }
+
+    threadpool_clean(&atp);
+  }
+  free(visits);
+  free(values);
+
+  printf("# passed auto checks\n");
+
   return 0;
 }